@@ -21,6 +21,7 @@
 #include "ham/check.h"
 #include "ham/fs.h"
 #include "ham/async.h"
+#include "ham/intern.h"
 
 #include "ham/std_vector.hpp"
 
@@ -43,8 +44,6 @@ struct ham_engine{
 	std::atomic_bool running;
 	std::atomic<int> status;
 	std::atomic<f64> min_dt;
-
-	ham::std_vector<ham::str_buffer8> interned;
 };
 
 ham::mutex ham_impl_gengine_mut;
@@ -241,6 +240,14 @@ ham_engine *ham_engine_create_alloc(const ham_allocator *allocator, const ham_en
 		return nullptr;
 	}
 
+	// cooked assets live next to the app unless a cache was chosen already
+	if(!ham_asset_cache_dir().len){
+		const auto cache_dir = ham::format("{}/.ham-cache", app_dir);
+		if(!ham_asset_cache_set_dir(cache_dir.get())){
+			ham::logapiwarn("Assets won't be cached");
+		}
+	}
+
 	const bool owns_ts = !ts;
 	if(owns_ts){
 		ts = ham_typeset_create_alloc(allocator);
@@ -274,20 +281,13 @@ ham_engine *ham_engine_create_alloc(const ham_allocator *allocator, const ham_en
 		return nullptr;
 	}
 
-	const auto dir_str = engine->interned.emplace_back(app->dir).c_str();
-	const auto name_str = engine->interned.emplace_back(app->name).c_str();
-	const auto display_str = engine->interned.emplace_back(app->display_name).c_str();
-	const auto author_str = engine->interned.emplace_back(app->author).c_str();
-	const auto license_str = engine->interned.emplace_back(app->license).c_str();
-	const auto desc_str = engine->interned.emplace_back(app->description).c_str();
-
 	engine->app.id = app->id;
-	engine->app.dir = ham::str8(dir_str);
-	engine->app.name = ham::str8(name_str);
-	engine->app.display_name = ham::str8(display_str);
-	engine->app.author = ham::str8(author_str);
-	engine->app.license = ham::str8(license_str);
-	engine->app.description = ham::str8(desc_str);
+	engine->app.dir = ham_symbol_str(ham_intern(app->dir));
+	engine->app.name = ham_symbol_str(ham_intern(app->name));
+	engine->app.display_name = ham_symbol_str(ham_intern(app->display_name));
+	engine->app.author = ham_symbol_str(ham_intern(app->author));
+	engine->app.license = ham_symbol_str(ham_intern(app->license));
+	engine->app.description = ham_symbol_str(ham_intern(app->description));
 	engine->app.version = app->version;
 	engine->app.init = app->init;
 	engine->app.fini = app->fini;
@@ -18,10 +18,237 @@
 
 #include "ham/engine/entity/draw-instance-component.h"
 
+#include "../world.hpp"
+
+#include "ham/check.h"
+
+#include <algorithm>
+
 using namespace ham::typedefs;
 
 HAM_C_API_BEGIN
 
+//
+// Batch registration
+//
+
+static inline bool ham_impl_draw_instance_less(const ham_entity_component_draw_instance *a, const ham_entity_component_draw_instance *b){
+	return a->id != b->id ? a->id < b->id : a < b;
+}
+
+static inline ham_world *ham_impl_draw_instance_world(ham_entity_component_draw_instance *comp){
+	return ham_super(comp)->ent->world_partition->world;
+}
+
+//! Caller must hold the draw instances lock.
+static bool ham_impl_draw_instance_register(ham_world_draw_instances *insts, ham_entity_component_draw_instance *comp){
+	if(comp->group == HAM_WORLD_DRAW_GROUP_NONE) return true;
+	else if(comp->group >= insts->batches.size()){
+		ham::logapierror("Draw group {} was never added to the world", comp->group);
+		return false;
+	}
+
+	auto &comps = insts->batches[comp->group].comps;
+
+	const auto it = std::lower_bound(comps.begin(), comps.end(), comp, ham_impl_draw_instance_less);
+	if(!comps.insert((usize)(it - comps.begin()), comp)){
+		ham::logapierror("Failed to insert draw instance into batch");
+		return false;
+	}
+
+	comp->_impl_dirty = true;
+	return true;
+}
+
+//! Caller must hold the draw instances lock.
+static void ham_impl_draw_instance_unregister(ham_world_draw_instances *insts, ham_entity_component_draw_instance *comp){
+	if(comp->group >= insts->batches.size()) return;
+
+	auto &comps = insts->batches[comp->group].comps;
+
+	const auto it = std::lower_bound(comps.begin(), comps.end(), comp, ham_impl_draw_instance_less);
+	if(it != comps.end() && *it == comp){
+		comps.erase((usize)(it - comps.begin()));
+	}
+}
+
+//
+// Draw groups
+//
+
+ham_u32 ham_world_add_draw_group(ham_world *world, ham_draw_group *group){
+	if(!ham_check(world != NULL) || !ham_check(group != NULL)) return HAM_WORLD_DRAW_GROUP_NONE;
+
+	auto &insts = world->draw_insts;
+
+	ham::scoped_lock lock(insts.mut);
+
+	for(usize i = 0; i < insts.batches.size(); i++){
+		if(insts.batches[i].group == group) return (u32)i;
+	}
+
+	if(insts.batches.size() >= HAM_WORLD_DRAW_GROUP_NONE){
+		ham::logapierror("Too many draw groups added to world");
+		return HAM_WORLD_DRAW_GROUP_NONE;
+	}
+
+	const auto ret = (u32)insts.batches.size();
+	insts.batches.emplace_back(ham_world_draw_batch{ group, ham::basic_buffer<ham_entity_component_draw_instance*>() });
+	return ret;
+}
+
+bool ham_world_remove_draw_group(ham_world *world, ham_u32 group){
+	if(!ham_check(world != NULL)) return false;
+
+	auto &insts = world->draw_insts;
+
+	ham::scoped_lock lock(insts.mut);
+
+	if(!ham_check(group < insts.batches.size()) || !ham_check(insts.batches[group].group != NULL)){
+		return false;
+	}
+
+	insts.batches[group].group = nullptr;
+	return true;
+}
+
+//
+// Component object
+//
+
+static inline ham_entity_component_draw_instance *ham_entity_component_draw_instance_ctor(ham_entity_component_draw_instance *comp, u32 nargs, va_list va){
+	if(nargs != 2){
+		ham::logapierror("Wrong number of arguments passed: {}, expected 2 (ham_u32 group, ham_u32 id)", nargs);
+		return nullptr;
+	}
+
+	const auto group = va_arg(va, ham_u32);
+	const auto id    = va_arg(va, ham_u32);
+
+	comp->group = group;
+	comp->id    = id;
+	comp->_impl_dirty = true;
+
+	auto &insts = ham_impl_draw_instance_world(comp)->draw_insts;
+
+	ham::scoped_lock lock(insts.mut);
+
+	if(!ham_impl_draw_instance_register(&insts, comp)){
+		return nullptr;
+	}
+
+	return comp;
+}
+
+ham_nothrow static inline void ham_entity_component_draw_instance_dtor(ham_entity_component_draw_instance *comp){
+	auto &insts = ham_impl_draw_instance_world(comp)->draw_insts;
+
+	ham::scoped_lock lock(insts.mut);
+	ham_impl_draw_instance_unregister(&insts, comp);
+}
+
+//! Stored group handle and id are taken as they are, registration is the only state to rebuild.
+static bool ham_entity_component_draw_instance_restore(ham_entity_component *comp_base){
+	const auto comp = (ham_entity_component_draw_instance*)comp_base;
+	auto &insts = ham_impl_draw_instance_world(comp)->draw_insts;
+
+	ham::scoped_lock lock(insts.mut);
+	return ham_impl_draw_instance_register(&insts, comp);
+}
+
+ham_define_object_x(
+	2, ham_entity_component_draw_instance,
+	1, ham_entity_component_vtable,
+	ham_entity_component_draw_instance_ctor,
+	ham_entity_component_draw_instance_dtor,
+	(
+		.update = nullptr,
+		.restore = ham_entity_component_draw_instance_restore,
+	)
+)
+
+bool ham_entity_component_draw_instance_set(ham_entity_component_draw_instance *comp, ham_u32 group, ham_u32 id){
+	if(!ham_check(comp != NULL)) return false;
+
+	auto &insts = ham_impl_draw_instance_world(comp)->draw_insts;
+
+	ham::scoped_lock lock(insts.mut);
+
+	ham_impl_draw_instance_unregister(&insts, comp);
+
+	comp->group = group;
+	comp->id    = id;
+
+	return ham_impl_draw_instance_register(&insts, comp);
+}
+
+//
+// Per-frame sync
+//
+
+struct ham_impl_draw_instance_sync{
+	const ham_world_hierarchy *hier;
+	const ham_world_draw_batch *batch;
+	usize num_written;
+};
+
+//! Matrices go straight into the instance buffer, each changed instance is written exactly once.
+static bool ham_impl_draw_instance_write(ham_draw_group_instance_data *insts, u32 num_insts, void *user){
+	const auto sync = (ham_impl_draw_instance_sync*)user;
+	const auto &hier = *sync->hier;
+	const auto &comps = sync->batch->comps;
+
+	bool result = true;
+
+	// comps are sorted by id, so the instance buffer is written front to back
+
+	for(const auto comp : comps){
+		const auto hier_idx = ham_super(comp)->ent->_impl_hier_idx;
+
+		// not yet placed by ham_world_update_transforms
+		if(hier_idx >= hier.changes.size() || hier.forced[hier_idx]) continue;
+
+		if(!comp->_impl_dirty && !hier.changes[hier_idx]) continue;
+
+		if(comp->id >= num_insts){
+			ham::logapierror("Draw instance {} out of range, {} instances in group", comp->id, num_insts);
+			result = false;
+			continue;
+		}
+
+		const auto &world_mat = hier.worlds[hier_idx];
+		const auto inst = insts + comp->id;
+
+		inst->trans      = world_mat;
+		inst->normal_mat = ham_mat4_transpose(ham_mat4_inverse(world_mat));
+
+		comp->_impl_dirty = false;
+		++sync->num_written;
+	}
+
+	return result;
+}
+
+ham_usize ham_world_sync_draw_instances(ham_world *world){
+	if(!ham_check(world != NULL)) return (usize)-1;
+
+	ham::scoped_lock lock(world->hier.mut, world->draw_insts.mut);
+
+	ham_impl_draw_instance_sync sync{ &world->hier, nullptr, 0 };
+	bool result = true;
+
+	for(const auto &batch : world->draw_insts.batches){
+		if(!batch.group || batch.comps.empty()) continue;
+
+		sync.batch = &batch;
+
+		if(!ham_draw_group_instance_write(batch.group, ham_impl_draw_instance_write, &sync)){
+			ham::logapierror("Failed to write draw group instances");
+			result = false;
+		}
+	}
 
+	return result ? sync.num_written : (usize)-1;
+}
 
 HAM_C_API_END
@@ -18,16 +18,82 @@
 
 #include "ham/engine/entity.h"
 
+#include "world.hpp"
+
+#include "ham/check.h"
 #include "ham/log.h"
 
 using namespace ham::typedefs;
 
 HAM_C_API_BEGIN
 
+//! Zeroed memory for a component of \p ent with its vtable and entity set.
+static ham_entity_component *ham_impl_entity_component_alloc(ham_entity *ent, const ham_entity_component_vtable *comp_vptr){
+	const auto world = ent->world_partition->world;
+	const auto obj_vptr = ham_super(comp_vptr);
+	const auto info = obj_vptr->info;
+
+	const auto mem = (ham_entity_component*)ham_allocator_alloc(world->allocator, info->alignment, info->size);
+	if(!mem){
+		ham::logapierror("Failed to allocate memory for component of type '{}'", info->type_id);
+		return nullptr;
+	}
+
+	memset(mem, 0, info->size);
+
+	ham_super(mem)->vptr = obj_vptr;
+	mem->ent = ent;
+
+	return mem;
+}
+
+static bool ham_impl_entity_component_attach(ham_entity *ent, ham_entity_component *comp){
+	ham::scoped_lock lock(ent->world_partition->mut);
+
+	if(!ham_buffer_insert(&ent->components, ham_buffer_size(&ent->components), &comp, sizeof(ham_entity_component*))){
+		ham::logapierror("Failed to add component to entity");
+		return false;
+	}
+
+	return true;
+}
+
+ham_entity_component *ham_impl_entity_component_new_uninit(ham_entity *ent, const ham_entity_component_vtable *comp_vptr){
+	const auto mem = ham_impl_entity_component_alloc(ent, comp_vptr);
+	if(!mem) return nullptr;
+
+	if(!ham_impl_entity_component_attach(ent, mem)){
+		ham_allocator_free(ent->world_partition->world->allocator, mem);
+		return nullptr;
+	}
+
+	return mem;
+}
+
 ham_entity_component *ham_entity_component_vcreate(ham_entity *ent, const ham_entity_component_vtable *comp_vptr, ham_u32 nargs, va_list va){
-	(void)ent; (void)comp_vptr; (void)nargs; (void)va;
-	ham::logapierror("Entity components unimplemented");
-	return nullptr;
+	if(!ham_check(ent != NULL) || !ham_check(comp_vptr != NULL)) return nullptr;
+
+	const auto world = ent->world_partition->world;
+	const auto obj_vptr = ham_super(comp_vptr);
+
+	const auto mem = ham_impl_entity_component_alloc(ent, comp_vptr);
+	if(!mem) return nullptr;
+
+	// components may look up their entity and world while constructing
+	const auto ret = (ham_entity_component*)obj_vptr->ctor(ham_super(mem), nargs, va);
+	if(!ret){
+		ham::logapierror("Failed to construct component of type '{}'", obj_vptr->info->type_id);
+		ham_allocator_free(world->allocator, mem);
+		return nullptr;
+	}
+
+	if(!ham_impl_entity_component_attach(ent, ret)){
+		obj_vptr->dtor(ham_super(ret));
+		ham_allocator_free(world->allocator, ret);
+		return nullptr;
+	}
+
+	return ret;
 }
 
 HAM_C_API_END
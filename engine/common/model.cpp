@@ -25,117 +25,592 @@
 
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
+#include "assimp/version.h"
 #include "assimp/Importer.hpp"
+#include "assimp/IOSystem.hpp"
+#include "assimp/MemoryIOWrapper.h"
 
 #include "robin_hood.h"
 
+#include <limits.h>
+#include <stdlib.h>
+
 using namespace ham::typedefs;
 
+static_assert(sizeof(ham_model_cooked_header) == 64);
+static_assert(sizeof(HAM_MODEL_COOKED_MAGIC) == sizeof(ham_model_cooked_header::magic));
+
+//! Where the cooked data a model points into came from, which decides how it gets released.
+enum ham_impl_model_storage{
+	HAM_IMPL_MODEL_STORAGE_BORROWED, //!< owned by whoever loaded the model
+	HAM_IMPL_MODEL_STORAGE_OWNED,    //!< allocated with the model's allocator
+	HAM_IMPL_MODEL_STORAGE_CACHE,    //!< mapped with `ham_asset_cache_map`
+	HAM_IMPL_MODEL_STORAGE_FILE,     //!< mapped from a file opened by `ham_model_load`
+};
+
 HAM_C_API_BEGIN
 
 struct ham_model{
+	const ham_allocator *allocator;
+
 	ham::basic_buffer<ham_shape*> shapes;
 	ham::basic_buffer<ham_image*> images;
+
+	//! Every shape, image and material points straight into this.
+	const ham_model_cooked_header *cooked;
+	usize cooked_len;
+	ham_impl_model_storage storage;
+	ham_file *file;
 };
 
-ham_model *ham_model_load_from_mem(ham_usize len, const void *data){
-	if(!ham_check(len > 0) || !ham_check(data != NULL)){
-		return nullptr;
+HAM_C_API_END
+
+constexpr unsigned int ham_impl_model_import_flags = aiProcess_MakeLeftHanded | aiProcessPreset_TargetRealtime_Fast;
+
+// matches what the renderers use for shapes without a material
+constexpr f32 ham_impl_model_default_metallic = 0.2f;
+constexpr f32 ham_impl_model_default_roughness = 0.6f;
+
+static inline usize ham_impl_model_image_size(ham_color_format format, u32 w, u32 h){
+	return (usize)w * h * ham_color_format_num_components(format) * ham_color_format_component_size(format);
+}
+
+static inline usize ham_impl_model_align(usize off){
+	return (off + HAM_MODEL_COOKED_ALIGNMENT - 1) & ~(usize)(HAM_MODEL_COOKED_ALIGNMENT - 1);
+}
+
+//
+// Dependencies
+//
+// Models imported from a file may pull in others, like OBJ material libraries and the textures
+// materials name. Every file the importer asks for is recorded along with a hash of its contents
+// as it was read, and the record goes into the key of the cooked model so a change to any of them
+// cooks the model again. The record is cached too, under the source alone, which is all a later
+// load has to start from.
+//
+
+#define HAM_IMPL_MODEL_DEPS_MAGIC "HAMMDEP"
+#define HAM_IMPL_MODEL_DEPS_VERSION 1
+
+//! Start of a cached record, followed by `num_deps` dependencies.
+struct ham_impl_model_deps_header{
+	char magic[8]; //!< `HAM_IMPL_MODEL_DEPS_MAGIC`
+	u32 version; //!< `HAM_IMPL_MODEL_DEPS_VERSION`
+	u32 num_deps;
+};
+
+//! A single dependency, followed by `path_len` bytes of path relative to the model's directory unless absolute.
+struct ham_impl_model_dep{
+	u32 path_len;
+	u32 exists;
+	ham_asset_key content; //!< zero for missing files
+};
+
+static_assert(sizeof(HAM_IMPL_MODEL_DEPS_MAGIC) == sizeof(ham_impl_model_deps_header::magic));
+
+struct ham_impl_model_deps{
+	ham::str8 dir; //!< directory of the model without a trailing separator, empty for the current directory
+	u32 num_deps = 0;
+	ham::basic_buffer<char> bytes; //!< dependencies laid out as they follow a `ham_impl_model_deps_header`
+};
+
+//! Whether a path starts with the model's directory.
+static bool ham_impl_model_dep_in_dir(ham::str8 dir, ham::str8 path){
+	return !dir.is_empty() && path.size() > dir.size() + 1 && path[dir.size()] == '/' && path.substr(0, dir.size()) == dir;
+}
+
+/**
+ * Gets the full path of a dependency, returns its length or ``(usize)-1`` if it doesn't fit.
+ * Paths Assimp already put the model's directory in front of are left alone.
+ */
+static usize ham_impl_model_dep_path(ham::str8 dir, ham::str8 path, ham_path_buffer_utf8 &buf){
+	const bool relative = !dir.is_empty() && !path.is_empty() && path[0] != '/' && !ham_impl_model_dep_in_dir(dir, path);
+	const usize len = relative ? dir.size() + 1 + path.size() : path.size();
+
+	if(len >= HAM_PATH_BUFFER_SIZE) return (usize)-1;
+
+	if(relative){
+		memcpy(buf, dir.ptr(), dir.size());
+		buf[dir.size()] = '/';
+		memcpy(buf + dir.size() + 1, path.ptr(), path.size());
+	}
+	else{
+		memcpy(buf, path.ptr(), path.size());
 	}
 
-	Assimp::Importer importer;
+	buf[len] = '\0';
+	return len;
+}
 
-	const ham::str8 mdl_mime = ham_mime_from_mem(len, data);
+//! Strips the model's directory from the full path of a dependency.
+static ham::str8 ham_impl_model_dep_rel(ham::str8 dir, ham::str8 full){
+	return ham_impl_model_dep_in_dir(dir, full) ? full.substr(dir.size() + 1) : full;
+}
 
-	constexpr ham::str8 glb_prefix = HAM_MIME_TYPE_GLB;
+static ham_asset_key ham_impl_model_dep_content(usize len, const void *data){
+	return ham_asset_key_from_mem(ham::str8("ham_model_dep"), 0, nullptr, len, data);
+}
 
-	const char *file_hint = nullptr;
+static void ham_impl_model_deps_add(ham_impl_model_deps &deps, ham::str8 full, bool exists, ham_asset_key content){
+	const auto rel = ham_impl_model_dep_rel(deps.dir, full);
 
-	if(mdl_mime.substr(0, glb_prefix.size()) == glb_prefix){
-		file_hint = "glb";
+	// the first read is the one the model came from
+	for(usize off = 0; off < deps.bytes.size();){
+		ham_impl_model_dep dep;
+		memcpy(&dep, deps.bytes.data() + off, sizeof(dep));
+
+		if(ham::str8(deps.bytes.data() + off + sizeof(dep), dep.path_len) == rel) return;
+
+		off += sizeof(dep) + dep.path_len;
 	}
 
-	const auto scene = importer.ReadFileFromMemory(
-		data, len,
-		aiProcess_MakeLeftHanded |
-		aiProcessPreset_TargetRealtime_Fast,
-		file_hint
-	);
+	const ham_impl_model_dep dep{ (u32)rel.size(), exists ? 1u : 0u, exists ? content : ham_asset_key{ 0, 0 } };
 
-	if(!scene){
-		ham::logapierror("Error in Assimp::Importer::ReadFile: {}", importer.GetErrorString());
+	const usize off = deps.bytes.size();
+	if(!deps.bytes.resize(off + sizeof(dep) + rel.size())){
+		ham::logapiwarn("Error recording model dependency '{}'", full);
+		return;
+	}
+
+	memcpy(deps.bytes.data() + off, &dep, sizeof(dep));
+	memcpy(deps.bytes.data() + off + sizeof(dep), rel.ptr(), rel.size());
+
+	++deps.num_deps;
+}
+
+/**
+ * Calls \p fn with the path relative to the model's directory of each dependency in a record.
+ * @returns whether the record is intact
+ */
+template<typename Fn>
+static bool ham_impl_model_deps_each(usize len, const char *bytes, u32 num_deps, Fn &&fn){
+	usize off = 0;
+
+	for(u32 i = 0; i < num_deps; i++){
+		ham_impl_model_dep dep;
+		if(len - off < sizeof(dep)) return false;
+
+		memcpy(&dep, bytes + off, sizeof(dep));
+		off += sizeof(dep);
+
+		if(!dep.path_len || len - off < dep.path_len || dep.path_len >= HAM_PATH_BUFFER_SIZE) return false;
+
+		fn(ham::str8(bytes + off, dep.path_len));
+		off += dep.path_len;
+	}
+
+	return off == len;
+}
+
+//! Maps a whole file read-only, files that aren't there are not an error.
+static bool ham_impl_model_map_file(ham::str8 path, ham_file **file_ret, const void **mapping_ret, usize *len_ret){
+	if(!ham_path_exists_utf8(path)) return false;
+
+	const auto file = ham_file_open_utf8(path, HAM_OPEN_READ);
+	if(!file) return false;
+
+	ham_file_info info;
+	if(!ham_file_get_info(file, &info)){
+		ham_file_close(file);
+		return false;
+	}
+
+	void *mapping = nullptr;
+
+	if(info.size){
+		mapping = ham_file_map(file, HAM_OPEN_READ, 0, info.size);
+		if(!mapping){
+			ham_file_close(file);
+			return false;
+		}
+	}
+
+	*file_ret = file;
+	*mapping_ret = mapping;
+	*len_ret = info.size;
+	return true;
+}
+
+static void ham_impl_model_unmap_file(ham_file *file, const void *mapping, usize len){
+	if(mapping && !ham_file_unmap(file, const_cast<void*>(mapping), len)){
+		ham::logwarn("ham_model_load", "Error in ham_file_unmap");
+	}
+
+	ham_file_close(file);
+}
+
+/**
+ * Reads a cached record back, hashing each of its dependencies as they are now.
+ * @returns whether the record was usable
+ */
+static bool ham_impl_model_deps_rehash(usize len, const void *record, ham_impl_model_deps &deps){
+	ham_impl_model_deps_header header;
+	if(len < sizeof(header)) return false;
+
+	memcpy(&header, record, sizeof(header));
+
+	if(memcmp(header.magic, HAM_IMPL_MODEL_DEPS_MAGIC, sizeof(header.magic)) != 0 || header.version != HAM_IMPL_MODEL_DEPS_VERSION){
+		return false;
+	}
+
+	return ham_impl_model_deps_each(len - sizeof(header), (const char*)record + sizeof(header), header.num_deps, [&deps](ham::str8 rel){
+		ham_path_buffer_utf8 path_buf;
+		const usize path_len = ham_impl_model_dep_path(deps.dir, rel, path_buf);
+		if(path_len == (usize)-1) return;
+
+		const ham::str8 path(path_buf, path_len);
+
+		ham_file *file;
+		const void *mapping;
+		usize mapping_len;
+
+		if(!ham_impl_model_map_file(path, &file, &mapping, &mapping_len)){
+			ham_impl_model_deps_add(deps, path, false, ham_asset_key{ 0, 0 });
+			return;
+		}
+
+		ham_impl_model_deps_add(deps, path, true, ham_impl_model_dep_content(mapping_len, mapping));
+		ham_impl_model_unmap_file(file, mapping, mapping_len);
+	});
+}
+
+//! Stream over a mapped file, which is unmapped and closed along with the stream.
+class ham_impl_model_file_stream: public Assimp::MemoryIOStream{
+	public:
+		ham_impl_model_file_stream(ham_file *file, const void *mapping, usize len)
+			: MemoryIOStream((const u8*)mapping, len), m_file(file), m_mapping(mapping), m_len(len){}
+
+		~ham_impl_model_file_stream(){ ham_impl_model_unmap_file(m_file, m_mapping, m_len); }
+
+	private:
+		ham_file *m_file;
+		const void *m_mapping;
+		usize m_len;
+};
+
+/**
+ * Opens files for Assimp through the runtime filesystem, so mounted packs are seen too, relative
+ * to the model's directory. Every file other than the model itself is recorded as a dependency.
+ */
+class ham_impl_model_io_system: public Assimp::IOSystem{
+	public:
+		ham_impl_model_io_system(ham::str8 src_path, ham_impl_model_deps *deps)
+			: m_src_path(src_path), m_deps(deps){}
+
+		bool Exists(const char *path) const override{
+			ham_path_buffer_utf8 path_buf;
+			const usize path_len = ham_impl_model_dep_path(m_deps->dir, path, path_buf);
+			if(path_len == (usize)-1) return false;
+
+			const ham::str8 full(path_buf, path_len);
+
+			const bool exists = ham_path_exists_utf8(full);
+			if(!exists && full != m_src_path){
+				ham_impl_model_deps_add(*m_deps, full, false, ham_asset_key{ 0, 0 });
+			}
+
+			return exists;
+		}
+
+		char getOsSeparator() const override{ return '/'; }
+
+		Assimp::IOStream *Open(const char *path, const char *mode) override{
+			// nothing gets written while importing
+			if(strchr(mode, 'w') || strchr(mode, 'a') || strchr(mode, '+')) return nullptr;
+
+			ham_path_buffer_utf8 path_buf;
+			const usize path_len = ham_impl_model_dep_path(m_deps->dir, path, path_buf);
+			if(path_len == (usize)-1) return nullptr;
+
+			const ham::str8 full(path_buf, path_len);
+			const bool is_src = full == m_src_path;
+
+			ham_file *file;
+			const void *mapping;
+			usize len;
+
+			if(!ham_impl_model_map_file(full, &file, &mapping, &len)){
+				if(!is_src) ham_impl_model_deps_add(*m_deps, full, false, ham_asset_key{ 0, 0 });
+				return nullptr;
+			}
+
+			if(!is_src){
+				ham_impl_model_deps_add(*m_deps, full, true, ham_impl_model_dep_content(len, mapping));
+			}
+
+			return new ham_impl_model_file_stream(file, mapping, len);
+		}
+
+		void Close(Assimp::IOStream *stream) override{ delete stream; }
+
+	private:
+		ham::str8 m_src_path;
+		ham_impl_model_deps *m_deps;
+};
+
+//
+// Cooking
+//
+// Converts what Assimp imported into the cooked layout. Empty meshes and anything that isn't a
+// triangle are dropped, every shape gets bone data and at least one bone so it can be used
+// without filling anything in.
+//
+
+struct ham_impl_model_mesh_data{
+	u32 material;
+
+	ham::basic_buffer<ham_vec3> verts;
+	ham::basic_buffer<ham_vec3> norms;
+	ham::basic_buffer<ham_vec2> uvs;
+	ham::basic_buffer<ham_vec4i> bone_indices;
+	ham::basic_buffer<ham_vec4> bone_weights;
+	ham::basic_buffer<ham_u32> indices;
+	ham::basic_buffer<ham_shape_bone> bones;
+
+	ham::basic_buffer<ham_u32> bone_index_counters;
+};
+
+static ham_image *ham_impl_model_import_texture(const aiTexture *tex){
+	// TODO: default texture for when a texture format is unrecognized
+
+	if(tex->mHeight == 0){
+		const auto img = ham_image_load_from_mem(HAM_RGBA8U, tex->mWidth, tex->pcData);
+		if(!img){
+			ham_logapiwarnf("Unrecognized compressed embedded texture format");
+		}
+
+		return img;
+	}
+
+	u32 num_comps;
+	ham_color_format format;
+
+	if(tex->CheckFormat("r8")){
+		num_comps = 1;
+		format = HAM_R8U;
+	}
+	else if(tex->CheckFormat("rg88")){
+		num_comps = 2;
+		format = HAM_RG8U;
+	}
+	else if(tex->CheckFormat("rgb888")){
+		num_comps = 3;
+		format = HAM_RGB8U;
+	}
+	else if(tex->CheckFormat("rgba8888")){
+		num_comps = 4;
+		format = HAM_RGBA8U;
+	}
+	else{
+		ham_logapiwarnf("Unrecognized embedded texture format");
 		return nullptr;
 	}
 
-	ham::basic_buffer<ham_shape*> shapes;
+	ham::basic_buffer<std::byte> bytes;
+	bytes.resize(tex->mWidth * tex->mHeight * num_comps);
+
+	for(u32 y = 0; y < tex->mHeight; y++){
+		for(u32 x = 0; x < tex->mWidth; x++){
+			const auto pix_idx = (y * tex->mWidth) + x;
+			const auto idx = pix_idx * num_comps;
+			const auto ai_pix = tex->pcData + pix_idx;
+
+			ham_u8 pix[4] = { ai_pix->r, ai_pix->g, ai_pix->b, ai_pix->a };
+
+			memcpy(bytes.data() + idx, pix, num_comps);
+		}
+	}
+
+	const auto img = ham_image_create(format, tex->mWidth, tex->mHeight, bytes.data());
+	if(!img){
+		ham_logapiwarnf("Error in ham_image_create");
+	}
+
+	return img;
+}
+
+//! Images of a model being cooked, its embedded textures followed by the files its materials name.
+struct ham_impl_model_images{
+	Assimp::IOSystem *io; //!< where to load files from, `nullptr` for models with no directory
 	ham::basic_buffer<ham_image*> images;
+	robin_hood::unordered_node_map<ham::str_buffer8, u32> files;
+};
 
-	struct mesh_data{
-		ham::basic_buffer<ham_vec3> verts;
-		ham::basic_buffer<ham_vec3> norms;
-		ham::basic_buffer<ham_vec2> uvs;
-		ham::basic_buffer<ham_vec4i> bone_indices;
-		ham::basic_buffer<ham_vec4> bone_weights;
-		ham::basic_buffer<ham_u32> indices;
-		ham::basic_buffer<ham_shape_bone> bones;
+static ham_image *ham_impl_model_import_texture_file(Assimp::IOSystem *io, const char *path){
+	const auto stream = io->Open(path, "rb");
+	if(!stream){
+		ham::logapiwarn("Texture '{}' not found", path);
+		return nullptr;
+	}
 
-		ham::basic_buffer<ham_u32> bone_index_counters;
-	};
+	const usize size = stream->FileSize();
 
-	robin_hood::unordered_flat_map<aiMesh*, mesh_data> shape_data_map;
+	ham::basic_buffer<char> bytes;
 
-	shapes.resize(scene->mNumMeshes);
-	images.resize(scene->mNumTextures);
+	const bool read = size && bytes.resize(size) && stream->Read(bytes.data(), 1, size) == size;
 
-	memset(shapes.data(), 0, sizeof(void*) * scene->mNumMeshes);
-	memset(images.data(), 0, sizeof(void*) * scene->mNumTextures);
+	io->Close(stream);
 
-	for(unsigned int mesh_idx = 0; mesh_idx < scene->mNumMeshes; mesh_idx++){
-		const auto mesh = scene->mMeshes[mesh_idx];
+	if(!read){
+		ham::logapiwarn("Error reading texture '{}'", path);
+		return nullptr;
+	}
+
+	const auto img = ham_image_load_from_mem(HAM_RGBA8U, size, bytes.data());
+	if(!img){
+		ham::logapiwarn("Unrecognized texture format for '{}'", path);
+	}
+
+	return img;
+}
+
+//! Index of the image a material refers to, files are loaded the first time they're named.
+static u32 ham_impl_model_material_texture(const aiScene *scene, const aiMaterial *mat, aiTextureType type, ham_impl_model_images &images){
+	aiString path;
+	if(mat->GetTexture(type, 0, &path) != AI_SUCCESS || !path.length){
+		return HAM_MODEL_COOKED_NONE;
+	}
+
+	const char *const path_str = path.C_Str();
+
+	if(path_str[0] == '*'){
+		const u32 idx = (u32)strtoul(path_str + 1, nullptr, 10);
+		return idx < scene->mNumTextures ? idx : HAM_MODEL_COOKED_NONE;
+	}
+
+	for(u32 i = 0; i < scene->mNumTextures; i++){
+		if(strcmp(scene->mTextures[i]->mFilename.C_Str(), path_str) == 0) return i;
+	}
+
+	if(!images.io || path.length >= HAM_PATH_BUFFER_SIZE){
+		return HAM_MODEL_COOKED_NONE;
+	}
+
+	// material libraries written on windows separate directories with backslashes
+	ham_path_buffer_utf8 file_buf;
+	memcpy(file_buf, path_str, path.length + 1);
+
+	for(u32 i = 0; i < path.length; i++){
+		if(file_buf[i] == '\\') file_buf[i] = '/';
+	}
+
+	const ham::str8 file_path(file_buf, path.length);
+
+	const auto found = images.files.find(file_path);
+	if(found != images.files.end()) return found->second;
+
+	const u32 idx = (u32)images.images.size();
+	images.images.emplace_back(ham_impl_model_import_texture_file(images.io, file_buf));
+	images.files.try_emplace(file_path, idx);
+
+	return idx;
+}
+
+static ham_model_cooked_material ham_impl_model_import_material(const aiScene *scene, const aiMaterial *mat, ham_impl_model_images &images){
+	ham_model_cooked_material ret;
+	memset(&ret, 0, sizeof(ret));
+
+	aiColor4D albedo(1.f, 1.f, 1.f, 1.f);
+	if(mat->Get(AI_MATKEY_BASE_COLOR, albedo) != AI_SUCCESS){
+		mat->Get(AI_MATKEY_COLOR_DIFFUSE, albedo);
+	}
 
-		const auto num_points  = mesh->mNumVertices;
-		const auto num_indices = mesh->mNumFaces * 3u;
+	ai_real metallic = ham_impl_model_default_metallic, roughness = ham_impl_model_default_roughness;
+	mat->Get(AI_MATKEY_METALLIC_FACTOR, metallic);
+	mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, roughness);
 
-		ham::basic_buffer<ham_vec3> verts, norms;
-		ham::basic_buffer<ham_vec2> uvs;
-		ham::basic_buffer<ham_u32> indices;
-		ham::basic_buffer<ham_u32> bone_index_counters;
+	ret.params.metallic = (f32)metallic;
+	ret.params.roughness = (f32)roughness;
+	ret.params.albedo = ham_make_vec4(albedo.r, albedo.g, albedo.b, albedo.a);
 
-		verts.resize(num_points);
-		norms.resize(num_points);
-		uvs.resize(num_points);
-		indices.resize(num_indices);
-		bone_index_counters.resize(num_points);
+	ret.albedo_image = ham_impl_model_material_texture(scene, mat, aiTextureType_BASE_COLOR, images);
+	if(ret.albedo_image == HAM_MODEL_COOKED_NONE){
+		ret.albedo_image = ham_impl_model_material_texture(scene, mat, aiTextureType_DIFFUSE, images);
+	}
+
+	ret.normal_image = ham_impl_model_material_texture(scene, mat, aiTextureType_NORMALS, images);
+
+	return ret;
+}
+
+static bool ham_impl_model_import_mesh(const aiMesh *mesh, u32 num_materials, ham_impl_model_mesh_data &ret){
+	u32 num_tris = 0;
+	for(unsigned int face_idx = 0; face_idx < mesh->mNumFaces; face_idx++){
+		if(mesh->mFaces[face_idx].mNumIndices == 3) ++num_tris;
+	}
 
-		memset(bone_index_counters.data(), 0, num_points * sizeof(ham_u32));
+	const auto num_points = mesh->mNumVertices;
+	if(!num_points || !num_tris) return false;
 
-		for(unsigned int point_idx = 0; point_idx < mesh->mNumVertices; point_idx++){
-			const auto vert = mesh->mVertices + point_idx;
+	ret.material = mesh->mMaterialIndex < num_materials ? mesh->mMaterialIndex : HAM_MODEL_COOKED_NONE;
+
+	ret.verts.resize(num_points);
+	ret.norms.resize(num_points);
+	ret.uvs.resize(num_points);
+	ret.bone_indices.resize(num_points);
+	ret.bone_weights.resize(num_points);
+	ret.indices.resize(num_tris * 3);
+	ret.bone_index_counters.resize(num_points);
+
+	const auto ai_uvs = mesh->mTextureCoords[0];
+
+	for(unsigned int point_idx = 0; point_idx < num_points; point_idx++){
+		const auto vert = mesh->mVertices + point_idx;
+
+		ret.verts[point_idx] = ham_vec3{vert->x, vert->y, vert->z};
+
+		if(mesh->mNormals){
 			const auto norm = mesh->mNormals + point_idx;
-			const auto uv = mesh->mTextureCoords[0] + point_idx;
+			ret.norms[point_idx] = ham_vec3{norm->x, norm->y, norm->z};
+		}
+		else{
+			ret.norms[point_idx] = ham_vec3{0.f, 0.f, 0.f};
+		}
 
-			verts[point_idx] = ham_vec3{vert->x, vert->y, vert->z};
-			norms[point_idx] = ham_vec3{norm->x, norm->y, norm->z};
-			uvs[point_idx]   = ham_vec2{uv->x, uv->y};
+		if(ai_uvs){
+			ret.uvs[point_idx] = ham_vec2{ai_uvs[point_idx].x, ai_uvs[point_idx].y};
+		}
+		else{
+			ret.uvs[point_idx] = ham_vec2{0.f, 0.f};
 		}
 
-		for(unsigned int face_idx = 0; face_idx < mesh->mNumFaces; face_idx++){
-			const auto face = mesh->mFaces + face_idx;
+		ret.bone_indices[point_idx] = ham_make_vec4i_scalar(0);
+		ret.bone_weights[point_idx] = ham_make_vec4(1.f, 0.f, 0.f, 0.f);
+		ret.bone_index_counters[point_idx] = 0;
+	}
 
-			for(unsigned int k = 0; k < 3; k++){
-				indices[(face_idx * 3) + k] = face->mIndices[k];
-			}
-		}
+	u32 index_counter = 0;
+	for(unsigned int face_idx = 0; face_idx < mesh->mNumFaces; face_idx++){
+		const auto face = mesh->mFaces + face_idx;
+		if(face->mNumIndices != 3) continue;
 
-		auto &shape_data = shape_data_map[mesh];
-		shape_data.verts = std::move(verts);
-		shape_data.norms = std::move(norms);
-		shape_data.uvs = std::move(uvs);
-		shape_data.indices = std::move(indices);
-		shape_data.bone_index_counters = std::move(bone_index_counters);
+		for(unsigned int k = 0; k < 3; k++){
+			ret.indices[index_counter++] = face->mIndices[k];
+		}
 	}
 
-	const auto allocator = ham_current_allocator();
+	return true;
+}
+
+/**
+ * Allocates the cooked form of an imported scene with the current allocator.
+ * Textures that aren't embedded are loaded through \p io, or left out if it's `nullptr`.
+ */
+static void *ham_impl_model_cook_scene(const aiScene *scene, Assimp::IOSystem *io, usize *len_ret){
+	robin_hood::unordered_node_map<const aiMesh*, ham_impl_model_mesh_data> mesh_data_map;
+
+	// shapes keep the order of the meshes they came from
+	ham::basic_buffer<const ham_impl_model_mesh_data*> meshes;
+
+	for(unsigned int mesh_idx = 0; mesh_idx < scene->mNumMeshes; mesh_idx++){
+		const auto mesh = scene->mMeshes[mesh_idx];
+
+		ham_impl_model_mesh_data data;
+		if(!ham_impl_model_import_mesh(mesh, scene->mNumMaterials, data)) continue;
+
+		const auto emplaced = mesh_data_map.try_emplace(mesh, std::move(data));
+		meshes.emplace_back(&emplaced.first->second);
+	}
 
 	for(unsigned int skel_i = 0; skel_i < scene->mNumSkeletons; skel_i++){
 		const auto ai_skel = scene->mSkeletons[skel_i];
@@ -143,7 +618,10 @@ ham_model *ham_model_load_from_mem(ham_usize len, const void *data){
 		for(unsigned int bone_i = 0; bone_i < ai_skel->mNumBones; bone_i++){
 			const auto ai_bone = ai_skel->mBones[bone_i];
 
-			auto &shape_data = shape_data_map[ai_bone->mMeshId];
+			const auto mesh_it = mesh_data_map.find(ai_bone->mMeshId);
+			if(mesh_it == mesh_data_map.end()) continue;
+
+			auto &shape_data = mesh_it->second;
 
 			const ham_u32 bone_idx = shape_data.bones.size();
 			ham_shape_bone &bone = shape_data.bones.emplace_back();
@@ -154,6 +632,7 @@ ham_model *ham_model_load_from_mem(ham_usize len, const void *data){
 
 			for(unsigned int weight_i = 0; weight_i < ai_bone->mNumnWeights; weight_i++){
 				const auto ai_weight = ai_bone->mWeights + weight_i;
+				if(ai_weight->mVertexId >= shape_data.verts.size()) continue;
 
 				ham_u32 &vert_bone_counter = shape_data.bone_index_counters[ai_weight->mVertexId];
 				if(vert_bone_counter >= 4){
@@ -169,98 +648,554 @@ ham_model *ham_model_load_from_mem(ham_usize len, const void *data){
 		}
 	}
 
-	ham_u32 shape_counter = 0;
-	for(auto &&shape_data_p : shape_data_map){
-		const auto &shape_data = shape_data_p.second;
-		shapes[shape_counter] = ham_shape_create_triangle_mesh(
-			(ham_u32)shape_data.verts.size(),
-			shape_data.verts.data(),
-			shape_data.norms.data(),
-			shape_data.uvs.data(),
-			shape_data.bone_indices.data(),
-			shape_data.bone_weights.data(),
-			(ham_u32)shape_data.indices.size(),
-			shape_data.indices.data(),
-			(ham_u32)shape_data.bones.size(),
-			shape_data.bones.data()
-		);
-		++shape_counter;
+	for(auto &&mesh_p : mesh_data_map){
+		if(mesh_p.second.bones.empty()){
+			mesh_p.second.bones.emplace_back().transform = ham_mat4_identity();
+		}
 	}
 
-	// TODO: load from central resource manager when not embedded/filename given
+	ham_impl_model_images material_images;
+	material_images.io = io;
+	material_images.images.resize(scene->mNumTextures);
 
 	for(unsigned int img_idx = 0; img_idx < scene->mNumTextures; img_idx++){
-		const auto tex = scene->mTextures[img_idx];
+		material_images.images[img_idx] = ham_impl_model_import_texture(scene->mTextures[img_idx]);
+	}
 
-		// TODO: default texture for when a texture format is unrecognized
-		ham_image *img = nullptr;
+	ham::basic_buffer<ham_model_cooked_material> materials;
+	materials.resize(scene->mNumMaterials);
 
-		if(tex->mHeight == 0){
-			img = ham_image_load_from_mem(HAM_RGBA8U, tex->mWidth, tex->pcData);
-			if(!img){
-				ham_logapiwarnf("Unrecognized compressed embedded texture format");
-				continue;
-			}
+	for(unsigned int mat_idx = 0; mat_idx < scene->mNumMaterials; mat_idx++){
+		materials[mat_idx] = ham_impl_model_import_material(scene, scene->mMaterials[mat_idx], material_images);
+	}
+
+	const auto &images = material_images.images;
+
+	// lay everything out
+
+	ham_model_cooked_header header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, HAM_MODEL_COOKED_MAGIC, sizeof(header.magic));
+	header.version = HAM_MODEL_COOKED_VERSION;
+	header.num_shapes = (u32)meshes.size();
+	header.num_images = (u32)images.size();
+	header.num_materials = (u32)materials.size();
+
+	usize off = ham_impl_model_align(sizeof(header));
+
+	const auto reserve = [&off](usize size){
+		const usize ret = off;
+		off = ham_impl_model_align(off + size);
+		return ret;
+	};
+
+	header.shapes_off = reserve(sizeof(ham_model_cooked_shape) * header.num_shapes);
+	header.images_off = reserve(sizeof(ham_model_cooked_image) * header.num_images);
+	header.materials_off = reserve(sizeof(ham_model_cooked_material) * header.num_materials);
+
+	ham::basic_buffer<ham_model_cooked_shape> cooked_shapes;
+	ham::basic_buffer<ham_model_cooked_image> cooked_images;
+
+	cooked_shapes.resize(header.num_shapes);
+	cooked_images.resize(header.num_images);
+
+	for(usize i = 0; i < meshes.size(); i++){
+		const auto &mesh = *meshes[i];
+		auto &cooked = cooked_shapes[i];
+
+		memset(&cooked, 0, sizeof(cooked));
+
+		cooked.num_points = (u32)mesh.verts.size();
+		cooked.num_indices = (u32)mesh.indices.size();
+		cooked.num_bones = (u32)mesh.bones.size();
+		cooked.material = mesh.material;
+
+		cooked.verts_off = reserve(sizeof(ham_vec3) * cooked.num_points);
+		cooked.norms_off = reserve(sizeof(ham_vec3) * cooked.num_points);
+		cooked.uvs_off = reserve(sizeof(ham_vec2) * cooked.num_points);
+		cooked.bone_indices_off = reserve(sizeof(ham_vec4i) * cooked.num_points);
+		cooked.bone_weights_off = reserve(sizeof(ham_vec4) * cooked.num_points);
+		cooked.indices_off = reserve(sizeof(u32) * cooked.num_indices);
+		cooked.bones_off = reserve(sizeof(ham_shape_bone) * cooked.num_bones);
+	}
+
+	for(usize i = 0; i < images.size(); i++){
+		const auto img = images[i];
+		auto &cooked = cooked_images[i];
+
+		memset(&cooked, 0, sizeof(cooked));
+
+		if(!img){
+			cooked.format = HAM_COLOR_FORMAT_COUNT;
+			continue;
 		}
-		else{
-			u32 num_comps;
-			ham_color_format format;
 
-			if(tex->CheckFormat("r8")){
-				num_comps = 1;
-				format = HAM_R8U;
-			}
-			if(tex->CheckFormat("rg88")){
-				num_comps = 2;
-				format = HAM_RG8U;
-			}
-			else if(tex->CheckFormat("rgb888")){
-				num_comps = 3;
-				format = HAM_RGB8U;
-			}
-			else if(tex->CheckFormat("rgba8888")){
-				num_comps = 4;
-				format = HAM_RGBA8U;
-			}
-			else{
-				ham_logapiwarnf("Unrecognized embedded texture format");
-				continue;
-			}
+		cooked.format = (u32)ham_image_format(img);
+		cooked.w = ham_image_width(img);
+		cooked.h = ham_image_height(img);
+		cooked.pixels_off = reserve(ham_impl_model_image_size((ham_color_format)cooked.format, cooked.w, cooked.h));
+	}
 
-			ham::basic_buffer<std::byte> bytes;
-			bytes.resize(tex->mWidth * tex->mHeight * num_comps);
+	header.size = off;
 
-			for(u32 y = 0; y < tex->mHeight; y++){
-				for(u32 x = 0; x < tex->mWidth; x++){
-					const auto idx = ((y * tex->mWidth) + x) * num_comps;
-					const auto ai_pix = tex->pcData + idx;
+	// and write it
 
-					ham_u8 pix[4] = { ai_pix->r, ai_pix->g, ai_pix->b, ai_pix->a };
+	const auto out = (char*)ham_allocator_alloc(ham_current_allocator(), HAM_MODEL_COOKED_ALIGNMENT, off);
+	if(!out){
+		ham::logapierror("Error allocating {} bytes for cooked model", off);
+		for(auto img : images) ham_image_destroy(img);
+		return nullptr;
+	}
 
-					memcpy(bytes.data() + idx, pix, num_comps);
-				}
+	memset(out, 0, off);
+
+	const auto write = [out](usize at, const void *data, usize size){
+		if(size) memcpy(out + at, data, size);
+	};
+
+	write(0, &header, sizeof(header));
+	write(header.shapes_off, cooked_shapes.data(), sizeof(ham_model_cooked_shape) * header.num_shapes);
+	write(header.images_off, cooked_images.data(), sizeof(ham_model_cooked_image) * header.num_images);
+	write(header.materials_off, materials.data(), sizeof(ham_model_cooked_material) * header.num_materials);
+
+	for(usize i = 0; i < meshes.size(); i++){
+		const auto &mesh = *meshes[i];
+		const auto &cooked = cooked_shapes[i];
+
+		write(cooked.verts_off, mesh.verts.data(), sizeof(ham_vec3) * cooked.num_points);
+		write(cooked.norms_off, mesh.norms.data(), sizeof(ham_vec3) * cooked.num_points);
+		write(cooked.uvs_off, mesh.uvs.data(), sizeof(ham_vec2) * cooked.num_points);
+		write(cooked.bone_indices_off, mesh.bone_indices.data(), sizeof(ham_vec4i) * cooked.num_points);
+		write(cooked.bone_weights_off, mesh.bone_weights.data(), sizeof(ham_vec4) * cooked.num_points);
+		write(cooked.indices_off, mesh.indices.data(), sizeof(u32) * cooked.num_indices);
+		write(cooked.bones_off, mesh.bones.data(), sizeof(ham_shape_bone) * cooked.num_bones);
+	}
+
+	for(usize i = 0; i < images.size(); i++){
+		const auto &cooked = cooked_images[i];
+
+		if(cooked.format != HAM_COLOR_FORMAT_COUNT){
+			write(cooked.pixels_off, ham_image_pixels(images[i]), ham_impl_model_image_size((ham_color_format)cooked.format, cooked.w, cooked.h));
+		}
+
+		ham_image_destroy(images[i]);
+	}
+
+	*len_ret = off;
+	return out;
+}
+
+//! Imports a model from memory with Assimp and cooks it, see `ham_impl_model_cook_scene`.
+static void *ham_impl_model_import(usize len, const void *data, usize *len_ret){
+	Assimp::Importer importer;
+
+	const ham::str8 mdl_mime = ham_mime_from_mem(len, data);
+
+	constexpr ham::str8 glb_prefix = HAM_MIME_TYPE_GLB;
+
+	const char *file_hint = nullptr;
+
+	if(mdl_mime.substr(0, glb_prefix.size()) == glb_prefix){
+		file_hint = "glb";
+	}
+
+	const auto scene = importer.ReadFileFromMemory(data, len, ham_impl_model_import_flags, file_hint);
+
+	if(!scene){
+		ham::logapierror("Error in Assimp::Importer::ReadFile: {}", importer.GetErrorString());
+		return nullptr;
+	}
+
+	return ham_impl_model_cook_scene(scene, nullptr, len_ret);
+}
+
+/**
+ * Imports a model from a file with Assimp and cooks it, recording every other file it reads in \p deps.
+ * @param path full path of the model, ``NUL`` terminated
+ */
+static void *ham_impl_model_import_file(ham::str8 path, ham_impl_model_deps &deps, usize *len_ret){
+	Assimp::Importer importer;
+
+	// the importer owns it from here on
+	const auto io = new ham_impl_model_io_system(path, &deps);
+	importer.SetIOHandler(io);
+
+	const auto scene = importer.ReadFile(path.ptr(), ham_impl_model_import_flags);
+
+	if(!scene){
+		ham::logapierror("Error in Assimp::Importer::ReadFile: {}", importer.GetErrorString());
+		return nullptr;
+	}
+
+	return ham_impl_model_cook_scene(scene, io, len_ret);
+}
+
+//
+// Loading cooked models
+//
+
+//! Checks every offset and index in a cooked model, including the vertex and bone indices its shapes point straight into.
+static bool ham_impl_model_cooked_is_valid(usize len, const void *data){
+	if(!ham_model_is_cooked(len, data)) return false;
+
+	const auto header = (const ham_model_cooked_header*)data;
+	const u64 size = header->size;
+
+	const auto in_bounds = [size](u64 off, u64 elem_size, u64 count){
+		return
+			(off % HAM_MODEL_COOKED_ALIGNMENT) == 0 &&
+			off >= sizeof(ham_model_cooked_header) && off <= size &&
+			(!elem_size || count <= (size - off) / elem_size);
+	};
+
+	if(
+		!in_bounds(header->shapes_off, sizeof(ham_model_cooked_shape), header->num_shapes) ||
+		!in_bounds(header->images_off, sizeof(ham_model_cooked_image), header->num_images) ||
+		!in_bounds(header->materials_off, sizeof(ham_model_cooked_material), header->num_materials)
+	){
+		return false;
+	}
+
+	const auto base = (const char*)data;
+
+	const auto is_ref = [](u32 idx, u32 count){ return idx == HAM_MODEL_COOKED_NONE || idx < count; };
+
+	const auto shapes = (const ham_model_cooked_shape*)(base + header->shapes_off);
+	for(u32 i = 0; i < header->num_shapes; i++){
+		const auto &shape = shapes[i];
+
+		if(
+			!shape.num_points || !shape.num_indices || !shape.num_bones ||
+			!is_ref(shape.material, header->num_materials) ||
+			!in_bounds(shape.verts_off, sizeof(ham_vec3), shape.num_points) ||
+			!in_bounds(shape.norms_off, sizeof(ham_vec3), shape.num_points) ||
+			!in_bounds(shape.uvs_off, sizeof(ham_vec2), shape.num_points) ||
+			!in_bounds(shape.bone_indices_off, sizeof(ham_vec4i), shape.num_points) ||
+			!in_bounds(shape.bone_weights_off, sizeof(ham_vec4), shape.num_points) ||
+			!in_bounds(shape.indices_off, sizeof(u32), shape.num_indices) ||
+			!in_bounds(shape.bones_off, sizeof(ham_shape_bone), shape.num_bones)
+		){
+			return false;
+		}
+
+		const auto indices = (const u32*)(base + shape.indices_off);
+		for(u32 j = 0; j < shape.num_indices; j++){
+			if(indices[j] >= shape.num_points) return false;
+		}
+
+		const auto bone_indices = (const ham_vec4i*)(base + shape.bone_indices_off);
+		for(u32 j = 0; j < shape.num_points; j++){
+			for(const i32 bone_idx : bone_indices[j].data){
+				if(bone_idx < 0 || (u32)bone_idx >= shape.num_bones) return false;
 			}
+		}
+	}
 
-			img = ham_image_create(format, tex->mWidth, tex->mHeight, bytes.data());
-			if(!img){
-				ham_logapiwarnf("Error in ham_image_create");
-				continue;
+	const auto images = (const ham_model_cooked_image*)(base + header->images_off);
+	for(u32 i = 0; i < header->num_images; i++){
+		const auto &img = images[i];
+		if(img.format == HAM_COLOR_FORMAT_COUNT) continue;
+
+		if(
+			img.format > HAM_COLOR_FORMAT_COUNT || !img.w || !img.h ||
+			!in_bounds(img.pixels_off, 1, ham_impl_model_image_size((ham_color_format)img.format, img.w, img.h))
+		){
+			return false;
+		}
+	}
+
+	const auto materials = (const ham_model_cooked_material*)(base + header->materials_off);
+	for(u32 i = 0; i < header->num_materials; i++){
+		if(!is_ref(materials[i].albedo_image, header->num_images) || !is_ref(materials[i].normal_image, header->num_images)){
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void ham_impl_model_release_storage(const ham_allocator *allocator, ham_impl_model_storage storage, const void *data, usize len, ham_file *file){
+	switch(storage){
+		case HAM_IMPL_MODEL_STORAGE_OWNED:{
+			ham_allocator_free(allocator, const_cast<void*>(data));
+			break;
+		}
+
+		case HAM_IMPL_MODEL_STORAGE_CACHE:{
+			ham_asset_cache_unmap(data, len);
+			break;
+		}
+
+		case HAM_IMPL_MODEL_STORAGE_FILE:{
+			if(!ham_file_unmap(file, const_cast<void*>(data), len)){
+				ham::logwarn("ham_model_destroy", "Error in ham_file_unmap");
 			}
+
+			ham_file_close(file);
+			break;
 		}
 
-		images[img_idx] = img;
+		default: break;
+	}
+}
+
+/**
+ * Creates a model that points into a cooked one, taking over its storage.
+ * The storage is released on error too.
+ */
+static ham_model *ham_impl_model_from_cooked(usize len, const void *data, ham_impl_model_storage storage, ham_file *file = nullptr){
+	const auto allocator = ham_current_allocator();
+
+	if(!ham_impl_model_cooked_is_valid(len, data)){
+		ham_impl_model_release_storage(allocator, storage, data, len, file);
+		return nullptr;
 	}
 
 	const auto mdl = ham_allocator_new(allocator, ham_model);
-	if(!mdl) return nullptr;
+	if(!mdl){
+		ham_impl_model_release_storage(allocator, storage, data, len, file);
+		return nullptr;
+	}
+
+	const auto header = (const ham_model_cooked_header*)data;
+	const auto base = (const char*)data;
+
+	mdl->allocator = allocator;
+	mdl->cooked = header;
+	mdl->cooked_len = len;
+	mdl->storage = storage;
+	mdl->file = file;
+
+	mdl->shapes.resize(header->num_shapes);
+	mdl->images.resize(header->num_images);
+
+	memset(mdl->shapes.data(), 0, sizeof(void*) * header->num_shapes);
+	memset(mdl->images.data(), 0, sizeof(void*) * header->num_images);
+
+	const auto cooked_shapes = (const ham_model_cooked_shape*)(base + header->shapes_off);
+	const auto cooked_images = (const ham_model_cooked_image*)(base + header->images_off);
+
+	for(u32 i = 0; i < header->num_shapes; i++){
+		const auto &cooked = cooked_shapes[i];
+
+		mdl->shapes[i] = ham_shape_create_triangle_mesh_view(
+			cooked.num_points,
+			(const ham_vec3*)(base + cooked.verts_off),
+			(const ham_vec3*)(base + cooked.norms_off),
+			(const ham_vec2*)(base + cooked.uvs_off),
+			(const ham_vec4i*)(base + cooked.bone_indices_off),
+			(const ham_vec4*)(base + cooked.bone_weights_off),
+			cooked.num_indices,
+			(const ham_u32*)(base + cooked.indices_off),
+			cooked.num_bones,
+			(const ham_shape_bone*)(base + cooked.bones_off)
+		);
+
+		if(!mdl->shapes[i]){
+			ham_model_destroy(mdl);
+			return nullptr;
+		}
+	}
 
-	mdl->shapes = std::move(shapes);
-	mdl->images = std::move(images);
+	for(u32 i = 0; i < header->num_images; i++){
+		const auto &cooked = cooked_images[i];
+		if(cooked.format == HAM_COLOR_FORMAT_COUNT) continue;
+
+		mdl->images[i] = ham_image_create_pixels_view((ham_color_format)cooked.format, cooked.w, cooked.h, base + cooked.pixels_off);
+
+		if(!mdl->images[i]){
+			ham_model_destroy(mdl);
+			return nullptr;
+		}
+	}
 
 	return mdl;
 }
 
+//! Copies a cooked model somewhere suitably aligned that the model can own.
+static ham_model *ham_impl_model_copy_cooked(usize len, const void *data){
+	const auto allocator = ham_current_allocator();
+
+	const auto copy = ham_allocator_alloc(allocator, HAM_MODEL_COOKED_ALIGNMENT, len);
+	if(!copy){
+		ham::logapierror("Error allocating {} bytes for cooked model", len);
+		return nullptr;
+	}
+
+	memcpy(copy, data, len);
+
+	return ham_impl_model_from_cooked(len, copy, HAM_IMPL_MODEL_STORAGE_OWNED);
+}
+
+//
+// Cached models
+//
+// Cooked models are kept in the asset cache under the source bytes, the files they depend on and
+// everything that changes how they import, so an unchanged model never goes through Assimp again
+// and is used straight from the cache mapping.
+//
+
+struct ham_impl_model_import_settings{
+	u32 flags;
+	u32 assimp_major, assimp_minor, assimp_revision;
+	u32 debug; // embedded JPEGs decode differently in debug builds
+	u32 cooked_version;
+};
+
+static ham_impl_model_import_settings ham_impl_model_settings(){
+	ham_impl_model_import_settings settings;
+	memset(&settings, 0, sizeof(settings));
+
+	settings.flags = ham_impl_model_import_flags;
+	settings.assimp_major = aiGetVersionMajor();
+	settings.assimp_minor = aiGetVersionMinor();
+	settings.assimp_revision = aiGetVersionRevision();
+#ifdef HAM_DEBUG
+	settings.debug = 1;
+#endif
+	settings.cooked_version = HAM_MODEL_COOKED_VERSION;
+
+	return settings;
+}
+
+//! Key of the cooked model, \p deps has the contents of every file it depends on as they are now.
+static ham_asset_key ham_impl_model_cache_key(usize len, const void *data, const ham_impl_model_deps *deps){
+	const auto settings = ham_impl_model_settings();
+
+	if(!deps || !deps->num_deps){
+		return ham_asset_key_from_mem(ham::str8("ham_model/3"), sizeof(settings), &settings, len, data);
+	}
+
+	ham::basic_buffer<char> key_settings;
+	key_settings.resize(sizeof(settings) + deps->bytes.size());
+
+	memcpy(key_settings.data(), &settings, sizeof(settings));
+	memcpy(key_settings.data() + sizeof(settings), deps->bytes.data(), deps->bytes.size());
+
+	return ham_asset_key_from_mem(ham::str8("ham_model/3"), key_settings.size(), key_settings.data(), len, data);
+}
+
+//! Key of the record of the files a model depends on, see `ham_impl_model_deps_header`.
+static ham_asset_key ham_impl_model_deps_key(usize len, const void *data){
+	const auto settings = ham_impl_model_settings();
+	return ham_asset_key_from_mem(ham::str8("ham_model_deps/1"), sizeof(settings), &settings, len, data);
+}
+
+static void ham_impl_model_deps_store(ham_asset_key key, const ham_impl_model_deps &deps){
+	ham::basic_buffer<char> record;
+	if(!record.resize(sizeof(ham_impl_model_deps_header) + deps.bytes.size())){
+		ham::logwarn("ham_model_load", "Error allocating model dependency record");
+		return;
+	}
+
+	ham_impl_model_deps_header header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, HAM_IMPL_MODEL_DEPS_MAGIC, sizeof(header.magic));
+	header.version = HAM_IMPL_MODEL_DEPS_VERSION;
+	header.num_deps = deps.num_deps;
+
+	memcpy(record.data(), &header, sizeof(header));
+	if(deps.num_deps) memcpy(record.data() + sizeof(header), deps.bytes.data(), deps.bytes.size());
+
+	ham_asset_cache_store(key, record.size(), record.data());
+}
+
+HAM_C_API_BEGIN
+
+ham_nothrow bool ham_model_is_cooked(ham_usize len, const void *data){
+	if(!data || len < sizeof(ham_model_cooked_header)) return false;
+
+	const auto header = (const ham_model_cooked_header*)data;
+
+	return
+		memcmp(header->magic, HAM_MODEL_COOKED_MAGIC, sizeof(header->magic)) == 0 &&
+		header->version == HAM_MODEL_COOKED_VERSION &&
+		header->size >= sizeof(ham_model_cooked_header) && header->size <= len;
+}
+
+ham_usize ham_model_cook(ham_usize len, const void *data, ham_model_write_fn write_fn, void *user){
+	if(!ham_check(len > 0) || !ham_check(data != NULL) || !ham_check(write_fn != NULL)){
+		return (ham_usize)-1;
+	}
+
+	usize cooked_len;
+	const auto cooked = ham_impl_model_import(len, data, &cooked_len);
+	if(!cooked) return (ham_usize)-1;
+
+	const auto written = write_fn(cooked_len, cooked, user);
+
+	ham_allocator_free(ham_current_allocator(), cooked);
+
+	if(written != cooked_len){
+		ham::logapierror("Error writing cooked model, {} of {} bytes written", written, cooked_len);
+		return (ham_usize)-1;
+	}
+
+	return written;
+}
+
+ham_model *ham_model_load_cooked(ham_usize len, const void *data){
+	if(!ham_check(len > 0) || !ham_check(data != NULL) || !ham_check(((ham_uptr)data % HAM_MODEL_COOKED_ALIGNMENT) == 0)){
+		return nullptr;
+	}
+
+	const auto mdl = ham_impl_model_from_cooked(len, data, HAM_IMPL_MODEL_STORAGE_BORROWED);
+	if(!mdl){
+		ham::logapierror("Invalid cooked model");
+	}
+
+	return mdl;
+}
+
+ham_model *ham_model_load_from_mem(ham_usize len, const void *data){
+	if(!ham_check(len > 0) || !ham_check(data != NULL)){
+		return nullptr;
+	}
+
+	if(ham_model_is_cooked(len, data)){
+		const auto mdl = ham_impl_model_copy_cooked(len, data);
+		if(!mdl){
+			ham::logapierror("Invalid cooked model");
+		}
+
+		return mdl;
+	}
+
+	const bool use_cache = ham_asset_cache_dir().len != 0;
+
+	ham_asset_key cache_key;
+
+	if(use_cache){
+		cache_key = ham_impl_model_cache_key(len, data, nullptr);
+
+		usize cached_len;
+		const auto cached = ham_asset_cache_map(cache_key, &cached_len);
+		if(cached){
+			const auto mdl = ham_impl_model_from_cooked(cached_len, cached, HAM_IMPL_MODEL_STORAGE_CACHE);
+			if(mdl) return mdl;
+
+			ham::logapiwarn("Ignoring bad cooked model");
+		}
+	}
+
+	usize cooked_len;
+	const auto cooked = ham_impl_model_import(len, data, &cooked_len);
+	if(!cooked) return nullptr;
+
+	if(use_cache){
+		ham_asset_cache_store(cache_key, cooked_len, cooked);
+	}
+
+	return ham_impl_model_from_cooked(cooked_len, cooked, HAM_IMPL_MODEL_STORAGE_OWNED);
+}
+
 ham_model *ham_model_load(ham_str8 filepath){
+	return ham_model_load_with_deps(filepath, nullptr, nullptr, nullptr);
+}
+
+ham_model *ham_model_load_with_deps(ham_str8 filepath, ham_model_dep_fn dep_fn, void *user, ham_asset_key *key_ret){
 	if(
 	   !ham_check(filepath.len && filepath.ptr) ||
 	   !ham_check(filepath.len < HAM_PATH_BUFFER_SIZE)
@@ -268,6 +1203,8 @@ ham_model *ham_model_load(ham_str8 filepath){
 		return nullptr;
 	}
 
+	if(key_ret) *key_ret = ham_asset_key{ 0, 0 };
+
 	const auto file = ham_file_open_utf8(filepath, HAM_OPEN_READ);
 	if(!file){
 		ham::logapierror("Error in ham_file_open_utf8");
@@ -288,7 +1225,78 @@ ham_model *ham_model_load(ham_str8 filepath){
 		return nullptr;
 	}
 
-	const auto ret = ham_model_load_from_mem(file_info.size, mapping);
+	// cooked models keep the mapping for as long as they live
+	if(ham_model_is_cooked(file_info.size, mapping)){
+		const auto mdl = ham_impl_model_from_cooked(file_info.size, mapping, HAM_IMPL_MODEL_STORAGE_FILE, file);
+		if(!mdl){
+			ham::logapierror("Invalid cooked model: {}", ham::str8(filepath));
+		}
+
+		return mdl;
+	}
+
+	// files the model names are found relative to wherever it really is, paths inside mounted packs stay as they are
+	ham_path_buffer_utf8 path_buf;
+	memcpy(path_buf, filepath.ptr, filepath.len);
+	path_buf[filepath.len] = '\0';
+
+	char real_buf[PATH_MAX];
+
+	const bool use_real = realpath(path_buf, real_buf) && strlen(real_buf) < HAM_PATH_BUFFER_SIZE;
+	const ham::str8 path = use_real ? ham::str8((const char*)real_buf) : ham::str8(path_buf, filepath.len);
+
+	const usize dir_end = path.rfind("/");
+
+	ham_impl_model_deps deps;
+	deps.dir = dir_end == (usize)-1 ? ham::str8() : path.substr(0, dir_end);
+
+	const bool use_cache = ham_asset_cache_dir().len != 0;
+
+	ham_asset_key cache_key{ 0, 0 };
+	ham_model *ret = nullptr;
+
+	if(use_cache){
+		// the record says which files to hash, any of them changing gives a different key
+		usize record_len;
+		const auto record = ham_asset_cache_map(ham_impl_model_deps_key(file_info.size, mapping), &record_len);
+		if(record){
+			const bool rehashed = ham_impl_model_deps_rehash(record_len, record, deps);
+			ham_asset_cache_unmap(record, record_len);
+
+			if(rehashed){
+				cache_key = ham_impl_model_cache_key(file_info.size, mapping, &deps);
+
+				usize cached_len;
+				const auto cached = ham_asset_cache_map(cache_key, &cached_len);
+				if(cached){
+					ret = ham_impl_model_from_cooked(cached_len, cached, HAM_IMPL_MODEL_STORAGE_CACHE);
+					if(!ret){
+						ham::logapiwarn("Ignoring bad cooked model");
+					}
+				}
+			}
+
+			if(!ret){
+				deps.num_deps = 0;
+				deps.bytes.resize(0);
+			}
+		}
+	}
+
+	if(!ret){
+		usize cooked_len;
+		const auto cooked = ham_impl_model_import_file(path, deps, &cooked_len);
+		if(cooked){
+			if(use_cache){
+				ham_impl_model_deps_store(ham_impl_model_deps_key(file_info.size, mapping), deps);
+
+				cache_key = ham_impl_model_cache_key(file_info.size, mapping, &deps);
+				ham_asset_cache_store(cache_key, cooked_len, cooked);
+			}
+
+			ret = ham_impl_model_from_cooked(cooked_len, cooked, HAM_IMPL_MODEL_STORAGE_OWNED);
+		}
+	}
 
 	if(!ham_file_unmap(file, mapping, file_info.size)){
 		ham::logapiwarn("Error in ham_file_unmap");
@@ -296,13 +1304,25 @@ ham_model *ham_model_load(ham_str8 filepath){
 
 	ham_file_close(file);
 
+	if(!ret) return nullptr;
+
+	if(dep_fn){
+		ham_impl_model_deps_each(deps.bytes.size(), deps.bytes.data(), deps.num_deps, [&deps, dep_fn, user](ham::str8 rel){
+			ham_path_buffer_utf8 dep_buf;
+			const usize dep_len = ham_impl_model_dep_path(deps.dir, rel, dep_buf);
+			if(dep_len != (usize)-1) dep_fn(ham::str8(dep_buf, dep_len), user);
+		});
+	}
+
+	if(key_ret && use_cache) *key_ret = cache_key;
+
 	return ret;
 }
 
 ham_nothrow void ham_model_destroy(ham_model *mdl){
 	if(ham_unlikely(!mdl)) return;
 
-	const auto allocator = mdl->shapes.allocator();
+	const auto allocator = mdl->allocator;
 
 	for(auto shape : mdl->shapes){
 		ham_shape_destroy(shape);
@@ -312,6 +1332,8 @@ ham_nothrow void ham_model_destroy(ham_model *mdl){
 		ham_image_destroy(img);
 	}
 
+	ham_impl_model_release_storage(allocator, mdl->storage, mdl->cooked, mdl->cooked_len, mdl->file);
+
 	ham_allocator_delete(allocator, mdl);
 }
 
@@ -334,9 +1356,31 @@ ham_nothrow const ham_shape *const *ham_model_shapes(const ham_model *mdl){
 	return mdl->shapes.data();
 }
 
+ham_nothrow ham_usize ham_model_num_images(const ham_model *mdl){
+	if(!ham_check(mdl != NULL)) return (ham_usize)-1;
+	return mdl->images.size();
+}
+
 ham_nothrow const ham_image *const *ham_model_images(const ham_model *mdl){
 	if(!ham_check(mdl != NULL)) return nullptr;
 	return mdl->images.data();
 }
 
+ham_nothrow ham_usize ham_model_num_materials(const ham_model *mdl){
+	if(!ham_check(mdl != NULL)) return (ham_usize)-1;
+	return mdl->cooked->num_materials;
+}
+
+ham_nothrow const ham_model_cooked_material *ham_model_materials(const ham_model *mdl){
+	if(!ham_check(mdl != NULL)) return nullptr;
+	return (const ham_model_cooked_material*)((const char*)mdl->cooked + mdl->cooked->materials_off);
+}
+
+ham_nothrow ham_u32 ham_model_shape_material(const ham_model *mdl, ham_usize shape_idx){
+	if(!ham_check(mdl != NULL) || !ham_check(shape_idx < mdl->shapes.size())) return HAM_MODEL_COOKED_NONE;
+
+	const auto cooked_shapes = (const ham_model_cooked_shape*)((const char*)mdl->cooked + mdl->cooked->shapes_off);
+	return cooked_shapes[shape_idx].material;
+}
+
 HAM_C_API_END
@@ -16,49 +16,218 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include "ham/check.h"
-#include "ham/async.h"
-#include "ham/engine/world.h"
+#include "world.hpp"
 
-#include "robin_hood.h"
+#include "ham/check.h"
 
 using namespace ham::typedefs;
 
 HAM_C_API_BEGIN
 
 //
-// World management
+// Transform hierarchy
 //
 
-typedef enum ham_world_partition_face{
-	HAM_WORLD_PARTITION_FRONT,
-	HAM_WORLD_PARTITION_BACK,
-	HAM_WORLD_PARTITION_LEFT,
-	HAM_WORLD_PARTITION_RIGHT,
-	HAM_WORLD_PARTITION_TOP,
-	HAM_WORLD_PARTITION_BOTTOM,
-
-	HAM_WORLD_PARTITION_FACE_COUNT
-} ham_world_partition_face;
-
-struct ham_world_partition{
-	ham::recursive_mutex mut;
-	ham_world *world;
-	ham_f64 length;
-	ham_world_partition *facing[HAM_WORLD_PARTITION_FACE_COUNT];
+bool ham_impl_world_hierarchy_insert_n(ham_world_hierarchy *hier, usize n, ham_entity *const *ents){
+	const auto idx = hier->ents.size();
+	if(n >= ham_impl_hier_npos - idx){
+		ham::logapierror("Too many entities in world transform hierarchy");
+		return false;
+	}
+
+	const auto new_size = idx + n;
+
+	if(
+		!hier->ents.resize(new_size)    ||
+		!hier->parents.resize(new_size) ||
+		!hier->keys.resize(new_size)    ||
+		!hier->locals.resize(new_size)  ||
+		!hier->worlds.resize(new_size)  ||
+		!hier->changes.resize(new_size) ||
+		!hier->forced.resize(new_size)
+	){
+		ham::logapierror("Failed to resize world transform hierarchy");
+
+		// shrinking never fails, keep every array the same length
+		(void)hier->ents.resize(idx);
+		(void)hier->parents.resize(idx);
+		(void)hier->keys.resize(idx);
+		(void)hier->locals.resize(idx);
+		(void)hier->worlds.resize(idx);
+		(void)hier->changes.resize(idx);
+		(void)hier->forced.resize(idx);
+		return false;
+	}
+
+	std::fill_n(hier->parents.begin() + idx, n, ham_impl_hier_npos);
+	std::fill_n(hier->locals.begin() + idx, n, ham_mat4_identity());
+	std::fill_n(hier->worlds.begin() + idx, n, ham_mat4_identity());
+	std::fill_n(hier->changes.begin() + idx, n, 0);
+	std::fill_n(hier->forced.begin() + idx, n, 1);
+
+	for(usize i = 0; i < n; i++){
+		hier->ents[idx + i] = ents[i];
+		ents[i]->_impl_hier_idx = (ham_u32)(idx + i);
+	}
+
+	hier->order_dirty = true;
+	return true;
+}
+
+bool ham_impl_world_hierarchy_insert(ham_world_hierarchy *hier, ham_entity *ent){
+	return ham_impl_world_hierarchy_insert_n(hier, 1, &ent);
+}
+
+void ham_impl_world_hierarchy_remove(ham_world_hierarchy *hier, ham_entity *ent){
+	const auto idx = ent->_impl_hier_idx;
+	if(idx >= hier->ents.size() || hier->ents[idx] != ent) return;
+
+	hier->ents[idx] = nullptr;
+	ent->_impl_hier_idx = ham_impl_hier_npos;
+
+	hier->order_dirty = true;
+}
+
+/**
+ * Compacts out removed entities and sorts the remaining ones by depth (stable, counting sort),
+ * carrying over the cached matrices so unchanged subtrees stay clean.
+ */
+static inline bool ham_impl_world_hierarchy_rebuild(ham_world_hierarchy *hier){
+	const auto old_size = hier->ents.size();
+
+	// no ancestor chain can be longer than the hierarchy itself, so this never grows during the walk
+	ham::basic_buffer<ham_u32> depths, chain;
+	if(!depths.resize(old_size) || !chain.resize(old_size)){
+		ham::logapierror("Failed to allocate hierarchy depth buffers");
+		return false;
+	}
+
+	ham_u32 max_depth = 0;
+	usize num_live = 0;
+
+	for(usize i = 0; i < old_size; i++){
+		if(!hier->ents[i]){
+			depths[i] = ham_impl_hier_npos;
+			continue;
+		}
+
+		depths[i] = ham_impl_hier_npos - 1; // unresolved
+		++num_live;
+	}
+
+	for(usize i = 0; i < old_size; i++){
+		if(depths[i] != ham_impl_hier_npos - 1) continue;
+
+		// walk up until we find a resolved ancestor, then assign depths on the way back down
+
+		usize chain_len = 0;
+
+		ham_u32 cur = (ham_u32)i;
+		ham_u32 base_depth = 0;
+
+		while(true){
+			chain[chain_len++] = cur;
+
+			const auto parent = hier->ents[cur]->parent;
+			if(!parent){
+				base_depth = 0;
+				break;
+			}
+
+			const auto parent_idx = parent->_impl_hier_idx;
+			if(depths[parent_idx] != ham_impl_hier_npos - 1){
+				base_depth = depths[parent_idx] + 1;
+				break;
+			}
+
+			cur = parent_idx;
+		}
+
+		for(usize j = chain_len; j-- > 0;){
+			const auto depth = base_depth + (ham_u32)(chain_len - 1 - j);
+			depths[chain[j]] = depth;
+			max_depth = ham_max(max_depth, depth);
+		}
+	}
+
+	ham::basic_buffer<ham_u32> level_offsets, new_idxs;
+	if(!level_offsets.resize(num_live > 0 ? max_depth + 2 : 1) || !new_idxs.resize(old_size)){
+		ham::logapierror("Failed to allocate hierarchy ordering buffers");
+		return false;
+	}
+
+	std::fill(level_offsets.begin(), level_offsets.end(), 0);
+
+	for(usize i = 0; i < old_size; i++){
+		if(depths[i] == ham_impl_hier_npos) continue;
+		++level_offsets[depths[i] + 1];
+	}
+
+	for(usize i = 1; i < level_offsets.size(); i++){
+		level_offsets[i] += level_offsets[i-1];
+	}
+
+	for(usize i = 0; i < old_size; i++){
+		if(depths[i] == ham_impl_hier_npos) continue;
+		new_idxs[i] = level_offsets[depths[i]]++;
+	}
+
 	ham::basic_buffer<ham_entity*> ents;
-};
+	ham::basic_buffer<ham_u32> parents;
+	ham::basic_buffer<ham_world_hierarchy_key> keys;
+	ham::basic_buffer<ham_mat4> locals;
+	ham::basic_buffer<ham_mat4> worlds;
+	ham::basic_buffer<ham_u8> changes;
+	ham::basic_buffer<ham_u8> forced;
+
+	// nothing in the hierarchy is touched until every new array exists
+	if(
+		!ents.resize(num_live)    ||
+		!parents.resize(num_live) ||
+		!keys.resize(num_live)    ||
+		!locals.resize(num_live)  ||
+		!worlds.resize(num_live)  ||
+		!changes.resize(num_live) ||
+		!forced.resize(num_live)
+	){
+		ham::logapierror("Failed to allocate reordered hierarchy arrays");
+		return false;
+	}
 
-struct ham_world{
-	const ham_allocator *allocator;
+	for(usize i = 0; i < old_size; i++){
+		const auto ent = hier->ents[i];
+		if(!ent) continue;
 
-	ham::str_buffer8 name;
+		const auto new_idx = new_idxs[i];
 
-	ham::mutex mut;
-	robin_hood::unordered_flat_map<const ham_entity_vtable*, ham_object_manager*> obj_mans;
+		ents[new_idx]    = ent;
+		parents[new_idx] = ent->parent ? new_idxs[ent->parent->_impl_hier_idx] : ham_impl_hier_npos;
+		keys[new_idx]    = hier->keys[i];
+		locals[new_idx]  = hier->locals[i];
+		worlds[new_idx]  = hier->worlds[i];
+		changes[new_idx] = 0;
+		forced[new_idx]  = hier->forced[i];
+	}
+
+	for(usize i = 0; i < num_live; i++){
+		ents[i]->_impl_hier_idx = (ham_u32)i;
+	}
+
+	hier->ents    = std::move(ents);
+	hier->parents = std::move(parents);
+	hier->keys    = std::move(keys);
+	hier->locals  = std::move(locals);
+	hier->worlds  = std::move(worlds);
+	hier->changes = std::move(changes);
+	hier->forced  = std::move(forced);
+
+	hier->order_dirty = false;
+	return true;
+}
 
-	ham_world_partition root_partition;
-};
+//
+// World management
+//
 
 ham_world *ham_world_create(ham_str8 name){
 	if(!ham_check(name.len > 0) || !ham_check(name.ptr != NULL)) return nullptr;
@@ -96,17 +265,16 @@ void ham_world_destroy(ham_world *world){
 	{
 		ham::scoped_lock lock(world->mut, world->root_partition.mut);
 
-		for(auto &&obj_man_p : world->obj_mans){
-			ham_object_manager_iterate(
-				obj_man_p.second,
-				[](ham_object *obj, void*) -> bool{
-					const auto ent = (ham_entity*)obj;
-					ham_entity_destroy(ent);
-					return true;
-				},
-				nullptr
-			);
+		// destroying an entity erases it and its whole subtree from the partition,
+		// so the managers can't be iterated directly without skipping objects
+		auto &ents = world->root_partition.ents;
+		while(ents.size() > 0){
+			auto ent = ents[ents.size() - 1];
+			while(ent->parent) ent = ent->parent;
+			ham_entity_destroy(ent);
+		}
 
+		for(auto &&obj_man_p : world->obj_mans){
 			ham_object_manager_destroy(obj_man_p.second);
 		}
 	}
@@ -114,72 +282,67 @@ void ham_world_destroy(ham_world *world){
 	ham_allocator_delete(allocator, world);
 }
 
-ham_entity *ham_entity_vcreate(ham_world *world, const ham_entity_vtable *ent_vt, ham_u32 nargs, va_list va){
-	if(!ham_check(world != NULL) || !ham_check(ent_vt != NULL)){
-		return nullptr;
-	}
+bool ham_impl_entity_init(ham_object *obj, void *user){
+	const auto world = (ham_world*)user;
+	const auto ent = (ham_entity*)obj;
 
-	constexpr auto create_from_man = [](ham_world *world, const ham_entity_vtable *ent_vt, ham_object_manager *man, ham_u32 nargs, va_list va) -> ham_entity*{
-		const auto obj = ham_object_vnew_init(
-			man,
-			[](ham_object *obj, void *user) -> bool{
-				const auto world = (ham_world*)user;
-				const auto ent = (ham_entity*)obj;
+	ham_transform_reset(&ent->transform);
 
-				ham_transform_reset(&ent->transform);
+	ent->world_partition = &world->root_partition;
+	ent->parent = nullptr;
+	ent->_impl_hier_idx = ham_impl_hier_npos;
 
-				ent->world_partition = &world->root_partition;
-				ent->parent = nullptr;
+	if(!ham_buffer_init_allocator(&ent->children, world->allocator, alignof(ham_entity*), sizeof(ham_entity*) * 8)){
+		return false;
+	}
 
-				if(!ham_buffer_init_allocator(&ent->children, world->allocator, alignof(ham_entity*), sizeof(ham_entity*) * 8)){
-					return false;
-				}
+	if(!ham_buffer_init_allocator(&ent->components, world->allocator, alignof(ham_entity_component*), sizeof(ham_entity_component*) * 8)){
+		ham_buffer_finish(&ent->children);
+		return false;
+	}
 
-				if(!ham_buffer_init_allocator(&ent->components, world->allocator, alignof(ham_entity_component*), sizeof(ham_entity_component*) * 8)){
-					ham_buffer_finish(&ent->children);
-					return false;
-				}
+	return true;
+}
 
-				return true;
-			}, world,
-			nargs, va
-		);
+ham_object_manager *ham_impl_world_entity_manager(ham_world *world, const ham_entity_vtable *ent_vt){
+	ham::scoped_lock lock(world->mut);
 
-		// TODO: fix leak here when object fails to be constructed but buffers aren't finalized
+	const auto man_res = world->obj_mans.find(ent_vt);
+	if(man_res != world->obj_mans.end()){
+		return man_res->second;
+	}
 
-		if(!obj){
-			ham::logerror("ham_entity_vcreate", "Failed to create entity of type '{}'", ham_super(ent_vt)->info->type_id);
-		}
+	const auto man = ham_object_manager_create(ham_super(ent_vt));
+	if(!man){
+		ham::logapierror("Failed to create object manager for entity of type '{}'", ham_super(ent_vt)->info->type_id);
+		return nullptr;
+	}
 
-		return (ham_entity*)obj;
-	};
+	const auto emplace_res = world->obj_mans.try_emplace(ent_vt, man);
+	if(!emplace_res.second){
+		ham::logapierror("Failed to emplace object manager for entity of type '{}'", ham_super(ent_vt)->info->type_id);
+		ham_object_manager_destroy(man);
+		return nullptr;
+	}
 
-	ham_object_manager *man;
+	return man;
+}
 
-	{
-		ham::scoped_lock lock(world->mut);
+ham_entity *ham_entity_vcreate(ham_world *world, const ham_entity_vtable *ent_vt, ham_u32 nargs, va_list va){
+	if(!ham_check(world != NULL) || !ham_check(ent_vt != NULL)){
+		return nullptr;
+	}
 
-		const auto man_res = world->obj_mans.find(ent_vt);
-		if(man_res != world->obj_mans.end()){
-			man = man_res->second;
-		}
-		else{
-			man = ham_object_manager_create(ham_super(ent_vt));
-			if(!man){
-				ham::logapierror("Failed to create object manager for entity of type '{}'", ham_super(ent_vt)->info->type_id);
-				return nullptr;
-			}
+	const auto man = ham_impl_world_entity_manager(world, ent_vt);
+	if(!man) return nullptr;
 
-			const auto emplace_res = world->obj_mans.try_emplace(ent_vt, man);
-			if(!emplace_res.second){
-				ham::logapierror("Failed to emplace object manager for entity of type '{}'", ham_super(ent_vt)->info->type_id);
-				ham_object_manager_destroy(man);
-				return nullptr;
-			}
-		}
-	}
+	// TODO: fix leak here when object fails to be constructed but buffers aren't finalized
 
-	const auto ret = create_from_man(world, ent_vt, man, nargs, va);
+	const auto ret = (ham_entity*)ham_object_vnew_init(man, ham_impl_entity_init, world, nargs, va);
+	if(!ret){
+		ham::logapierror("Failed to create entity of type '{}'", ham_super(ent_vt)->info->type_id);
+		return nullptr;
+	}
 
 	{
 		ham::scoped_lock lock(world->root_partition.mut);
@@ -187,12 +350,24 @@ ham_entity *ham_entity_vcreate(ham_world *world, const ham_entity_vtable *ent_vt
 		auto &ents_buf = world->root_partition.ents;
 
 		const auto insert_res = std::lower_bound(ents_buf.begin(), ents_buf.end(), ret);
-		if(!ents_buf.insert((uptr)(ents_buf.end() - insert_res), ret)){
+		if(!ents_buf.insert((uptr)(insert_res - ents_buf.begin()), ret)){
 			ham_entity_destroy(ret);
 			return nullptr;
 		}
 	}
 
+	bool hier_inserted;
+
+	{
+		ham::scoped_lock lock(world->hier.mut);
+		hier_inserted = ham_impl_world_hierarchy_insert(&world->hier, ret);
+	}
+
+	if(!hier_inserted){
+		ham_entity_destroy(ret);
+		return nullptr;
+	}
+
 	return ret;
 }
 
@@ -209,7 +384,7 @@ void ham_entity_destroy(ham_entity *ent){
 		const auto parent_it = std::find(children, children_end, ent);
 
 		if(parent_it != children_end){
-			ham_buffer_erase(&ent->parent->children, (uptr)(parent_it - children), sizeof(ham_entity*));
+			ham_buffer_erase(&ent->parent->children, (uptr)(parent_it - children) * sizeof(ham_entity*), sizeof(ham_entity*));
 		}
 	}
 
@@ -218,7 +393,7 @@ void ham_entity_destroy(ham_entity *ent){
 
 	const auto ent_it = std::lower_bound(partition->ents.begin(), partition->ents.end(), ent);
 	if(ent_it != partition->ents.end() && *ent_it == ent){
-		partition->ents.erase((uptr)(partition->ents.end() - ent_it));
+		partition->ents.erase((uptr)(ent_it - partition->ents.begin()));
 	}
 	else{
 		ham::logapiwarn("Entity could not be found within world partition");
@@ -226,9 +401,20 @@ void ham_entity_destroy(ham_entity *ent){
 
 	const auto allocator = world->allocator;
 
+	{
+		ham::scoped_lock hier_lock(world->hier.mut);
+		ham_impl_world_hierarchy_remove(&world->hier, ent);
+	}
+
 	const auto num_children = ham_buffer_size(&ent->children) / sizeof(ham_entity*);
-	for(usize i = 0; i < num_children; i++){
-		const auto child = *((ham_entity**)ham_buffer_data(&ent->children) + i);
+	const auto children = (ham_entity**)ham_buffer_data(&ent->children);
+
+	for(usize i = num_children; i-- > 0;){
+		const auto child = children[i];
+
+		// our children buffer is about to be freed, don't let the child erase itself from it
+		child->parent = nullptr;
+
 		ham_entity_destroy(child);
 	}
 
@@ -256,4 +442,170 @@ void ham_entity_destroy(ham_entity *ent){
 	}
 }
 
+bool ham_entity_set_parent(ham_entity *ent, ham_entity *parent){
+	if(!ham_check(ent != NULL) || !ham_check(parent != ent)) return false;
+
+	const auto world = ent->world_partition->world;
+
+	if(parent && parent->world_partition->world != world){
+		ham::logapierror("Parent entity belongs to a different world");
+		return false;
+	}
+
+	ham::scoped_lock lock(world->root_partition.mut);
+
+	if(ent->parent == parent) return true;
+
+	for(auto it = parent; it; it = it->parent){
+		if(it == ent){
+			ham::logapierror("Entity can not be parented to one of its own descendants");
+			return false;
+		}
+	}
+
+	if(parent && !ham_buffer_insert(&parent->children, ham_buffer_size(&parent->children), &ent, sizeof(ham_entity*))){
+		ham::logapierror("Failed to insert entity into children of new parent");
+		return false;
+	}
+
+	if(ent->parent){
+		const auto num_children = ham_buffer_size(&ent->parent->children)/sizeof(ham_entity*);
+		const auto children = (ham_entity**)ham_buffer_data(&ent->parent->children);
+		const auto children_end = children + num_children;
+
+		const auto child_it = std::find(children, children_end, ent);
+		if(child_it != children_end){
+			ham_buffer_erase(&ent->parent->children, (uptr)(child_it - children) * sizeof(ham_entity*), sizeof(ham_entity*));
+		}
+	}
+
+	ent->parent = parent;
+
+	{
+		ham::scoped_lock hier_lock(world->hier.mut);
+
+		const auto idx = ent->_impl_hier_idx;
+		if(idx < world->hier.ents.size()){
+			world->hier.forced[idx] = 1;
+		}
+
+		world->hier.order_dirty = true;
+	}
+
+	return true;
+}
+
+ham_mat4 ham_entity_world_matrix(const ham_entity *ent){
+	if(!ham_check(ent != NULL)) return ham_mat4_identity();
+
+	const auto world = ent->world_partition->world;
+
+	ham::scoped_lock lock(world->hier.mut);
+
+	const auto idx = ent->_impl_hier_idx;
+	if(idx >= world->hier.worlds.size() || world->hier.ents[idx] != ent){
+		return ham_transform_matrix(&ent->transform);
+	}
+
+	return world->hier.worlds[idx];
+}
+
+//! Value comparison so `-0.f` matches `0.f` and a NaN that stays NaN doesn't count as a change.
+static inline bool ham_impl_world_hierarchy_f32_equal(ham_f32 a, ham_f32 b){
+	return a == b || (a != a && b != b);
+}
+
+static inline bool ham_impl_world_hierarchy_key_equal(const ham_world_hierarchy_key *key, const ham_transform *trans){
+	bool ret = true;
+
+	for(int i = 0; i < 3; i++){
+		ret &= ham_impl_world_hierarchy_f32_equal(key->pos.data[i],   trans->pos.data[i]);
+		ret &= ham_impl_world_hierarchy_f32_equal(key->scale.data[i], trans->scale.data[i]);
+		ret &= ham_impl_world_hierarchy_f32_equal(key->pyr.data[i],   trans->pyr.data[i]);
+	}
+
+	return ret;
+}
+
+ham_usize ham_world_update_transforms(ham_world *world){
+	if(!ham_check(world != NULL)) return (usize)-1;
+
+	ham::scoped_lock lock(world->hier.mut);
+
+	const auto hier = &world->hier;
+
+	if(hier->order_dirty && !ham_impl_world_hierarchy_rebuild(hier)){
+		ham::logapierror("Failed to rebuild world transform hierarchy");
+		return (usize)-1;
+	}
+
+	const auto num_ents = hier->ents.size();
+
+	ham_entity *const *const ents            = hier->ents.data();
+	const ham_u32 *const parents             = hier->parents.data();
+	ham_world_hierarchy_key *const keys      = hier->keys.data();
+	ham_mat4 *const locals                   = hier->locals.data();
+	ham_mat4 *const worlds                   = hier->worlds.data();
+	ham_u8 *const changes                    = hier->changes.data();
+	ham_u8 *const forced                     = hier->forced.data();
+
+	// first pass: detect local changes and propagate dirtiness down the tree
+
+	for(usize i = 0; i < num_ents; i++){
+		const ham_transform *const trans = &ents[i]->transform;
+
+		ham_u8 changed = forced[i] | !ham_impl_world_hierarchy_key_equal(keys + i, trans);
+		if(changed){
+			memcpy(keys + i, trans, sizeof(ham_world_hierarchy_key));
+			locals[i] = ham_transform_matrix(trans);
+		}
+
+		const auto parent = parents[i];
+		if(parent != ham_impl_hier_npos){
+			changed |= changes[parent];
+		}
+
+		changes[i] = changed;
+	}
+
+	memset(forced, 0, num_ents);
+
+	// second pass: compose only the dirty entries, this never touches entity memory
+	// NOTE: entries are composed one at a time, each parent has to be finished before its children and
+	// ham_mat4_mul is already SIMD under HAM_SIMD, so there is no SoA batching across entities here
+
+	usize num_updated = 0;
+
+	for(usize i = 0; i < num_ents; i++){
+		if(!changes[i]) continue;
+
+		const auto parent = parents[i];
+		worlds[i] = parent == ham_impl_hier_npos ? locals[i] : ham_mat4_mul(worlds[parent], locals[i]);
+
+		++num_updated;
+	}
+
+	return num_updated;
+}
+
+ham_usize ham_world_num_transforms(const ham_world *world){
+	if(!ham_check(world != NULL)) return 0;
+	return world->hier.ents.size();
+}
+
+ham_entity *const *ham_world_transform_entities(const ham_world *world){
+	if(!ham_check(world != NULL)) return nullptr;
+	return world->hier.ents.data();
+}
+
+const ham_mat4 *ham_world_transform_matrices(const ham_world *world){
+	if(!ham_check(world != NULL)) return nullptr;
+	return world->hier.worlds.data();
+}
+
+const ham_u8 *ham_world_transform_changes(const ham_world *world){
+	if(!ham_check(world != NULL)) return nullptr;
+	return world->hier.changes.data();
+}
+
 HAM_C_API_END
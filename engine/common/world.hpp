@@ -0,0 +1,167 @@
+/*
+ * Ham World Engine Runtime
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAM_ENGINE_COMMON_WORLD_HPP
+#define HAM_ENGINE_COMMON_WORLD_HPP 1
+
+#include "ham/async.h"
+#include "ham/engine/world.h"
+#include "ham/engine/entity/draw-instance-component.h"
+#include "ham/std_vector.hpp"
+
+#include "robin_hood.h"
+
+HAM_C_API_BEGIN
+
+//
+// World management
+//
+
+typedef enum ham_world_partition_face{
+	HAM_WORLD_PARTITION_FRONT,
+	HAM_WORLD_PARTITION_BACK,
+	HAM_WORLD_PARTITION_LEFT,
+	HAM_WORLD_PARTITION_RIGHT,
+	HAM_WORLD_PARTITION_TOP,
+	HAM_WORLD_PARTITION_BOTTOM,
+
+	HAM_WORLD_PARTITION_FACE_COUNT
+} ham_world_partition_face;
+
+struct ham_world_partition{
+	ham::recursive_mutex mut;
+	ham_world *world;
+	ham_f64 length;
+	ham_world_partition *facing[HAM_WORLD_PARTITION_FACE_COUNT];
+	ham::basic_buffer<ham_entity*> ents;
+};
+
+//
+// Transform hierarchy
+//
+
+constexpr ham_u32 ham_impl_hier_npos = (ham_u32)-1;
+
+//! Local transform components as of the last time its matrix was built.
+struct ham_world_hierarchy_key{
+	ham_vec3 pos, scale, pyr;
+};
+
+// keys are copied from the head of ham_transform in one go
+static_assert(offsetof(ham_transform, pos)   == offsetof(ham_world_hierarchy_key, pos));
+static_assert(offsetof(ham_transform, scale) == offsetof(ham_world_hierarchy_key, scale));
+static_assert(offsetof(ham_transform, pyr)   == offsetof(ham_world_hierarchy_key, pyr));
+static_assert(sizeof(ham_world_hierarchy_key) <= offsetof(ham_transform, _impl_dirty));
+
+/**
+ * Every array is indexed by `ham_entity::_impl_hier_idx` and kept in parent-before-child order,
+ * so a single forward pass sees every parent's world matrix before any of its children.
+ */
+struct ham_world_hierarchy{
+	ham::mutex mut;
+	bool order_dirty = false;
+
+	ham::basic_buffer<ham_entity*> ents;
+	ham::basic_buffer<ham_u32> parents;
+	ham::basic_buffer<ham_world_hierarchy_key> keys;
+	ham::basic_buffer<ham_mat4> locals;
+	ham::basic_buffer<ham_mat4> worlds;
+	ham::basic_buffer<ham_u8> changes;
+	ham::basic_buffer<ham_u8> forced;
+};
+
+//
+// Draw instances
+//
+
+//! Draw instance components of a single draw group, sorted by instance id.
+struct ham_world_draw_batch{
+	ham_draw_group *group; //!< `NULL` once removed from the world, its components stay until they're destroyed or moved
+	ham::basic_buffer<ham_entity_component_draw_instance*> comps;
+};
+
+struct ham_world_draw_instances{
+	ham::mutex mut;
+
+	//! Indexed by draw group handle. Slots are never reused, so a stale handle can't reach another group.
+	ham::std_vector<ham_world_draw_batch> batches;
+};
+
+struct ham_world{
+	const ham_allocator *allocator;
+
+	ham::str_buffer8 name;
+
+	ham::mutex mut;
+	robin_hood::unordered_flat_map<const ham_entity_vtable*, ham_object_manager*> obj_mans;
+
+	ham_world_partition root_partition;
+
+	ham_world_hierarchy hier;
+
+	ham_world_draw_instances draw_insts;
+};
+
+//
+// Internal helpers shared between world translation units
+//
+
+//! Object manager init function for entities, \p user must be the owning `ham_world*`.
+bool ham_impl_entity_init(ham_object *obj, void *user);
+
+ham_object_manager *ham_impl_world_entity_manager(ham_world *world, const ham_entity_vtable *ent_vt);
+
+//! Attach a zeroed component to \p ent without constructing it, the caller restores it.
+ham_entity_component *ham_impl_entity_component_new_uninit(ham_entity *ent, const ham_entity_component_vtable *comp_vptr);
+
+bool ham_impl_world_hierarchy_insert(ham_world_hierarchy *hier, ham_entity *ent);
+
+//! Append \p n entities with one resize of every hierarchy array, nothing is inserted on failure.
+bool ham_impl_world_hierarchy_insert_n(ham_world_hierarchy *hier, ham_usize n, ham_entity *const *ents);
+
+void ham_impl_world_hierarchy_remove(ham_world_hierarchy *hier, ham_entity *ent);
+
+/**
+ * Append a snapshot of \p ents to \p out.
+ * Every entity and component type must be described by one of \p types .
+ * Parents outside of \p ents are dropped. Caller must hold the world, partition and hierarchy locks.
+ */
+bool ham_impl_world_snapshot_serialize(
+	ham_world *world, ham_usize num_types, const ham_type *const *types,
+	ham_usize num_ents, ham_entity *const *ents, ham::basic_buffer<char> *out
+);
+
+/**
+ * Size of the snapshot at the start of \p data including its padding, snapshots may be stored back to back.
+ * Returns `(ham_usize)-1` if \p data doesn't start with a valid snapshot header.
+ */
+ham_usize ham_impl_world_snapshot_size(const char *data, ham_usize size);
+
+/**
+ * Construct every entity and component in an in-memory snapshot.
+ * \p name is only used for error messages. If \p ret_ents is not `NULL` it receives every created entity.
+ */
+ham_usize ham_impl_world_snapshot_instantiate(
+	ham_world *world, ham_str8 name, const char *data, ham_usize size,
+	ham_usize num_types, const ham_type *const *types,
+	ham::basic_buffer<ham_entity*> *ret_ents
+);
+
+HAM_C_API_END
+
+#endif // !HAM_ENGINE_COMMON_WORLD_HPP
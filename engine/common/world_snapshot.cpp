@@ -0,0 +1,1039 @@
+/*
+ * Ham World Engine Runtime
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "world.hpp"
+
+#include "ham/check.h"
+#include "ham/fs.h"
+#include "ham/hash.h"
+#include "ham/intern.h"
+#include "ham/std_vector.hpp"
+
+#include <algorithm>
+
+using namespace ham::typedefs;
+
+HAM_C_API_BEGIN
+
+//
+// Snapshot format
+//
+// [header]
+// [per entity type columns: pos[n], scale[n], pyr[n], payloads]...
+// [parents: u32[num_ents]]
+// [component order: u32[num_comps]]
+// [per component type columns: owners[n], payloads]...
+// [type table: ham_impl_world_snapshot_type[num_types + num_comp_types]]
+// [string table]
+//
+// Entities are numbered globally in type order, so every type owns a contiguous range of
+// entity indices and every fixed size column can be bulk-copied straight out of the mapping.
+//
+// Payloads are everything after the `ham_entity` or `ham_entity_component` base, encoded with
+// `ham_type_serialize` using the object type given for each vtable. The component order holds the
+// type index of every component in entity and attachment order, so each entity gets its
+// components back in the order they were added.
+//
+
+constexpr char ham_impl_world_snapshot_magic[4] = { 'H', 'A', 'M', 'W' };
+constexpr ham_u32 ham_impl_world_snapshot_version = 2;
+constexpr ham_usize ham_impl_world_snapshot_align = 16;
+constexpr ham_usize ham_impl_world_snapshot_write_buf_size = 64 * 1024;
+
+struct ham_impl_world_snapshot_header{
+	char magic[4];
+	ham_u32 version;
+	ham_u32 num_types, num_comp_types;
+	ham_u64 num_ents, num_comps;
+	ham_u64 parents_offset;
+	ham_u64 comp_order_offset;
+	ham_u64 types_offset;
+	ham_u64 strtab_offset, strtab_len;
+};
+
+struct ham_impl_world_snapshot_type{
+	ham_u64 name_offset;
+	ham_u32 name_len;
+	ham_u32 reserved;
+	ham_u64 layout_hash;
+	ham_u64 first, num; //!< range of global entity indices, only `num` is used by component types
+	ham_u64 pos_offset, scale_offset, pyr_offset; //!< entity types only
+	ham_u64 owners_offset; //!< component types only, global entity index of each component
+	ham_u64 payload_offset, payload_len;
+};
+
+//
+// Payload layouts
+//
+
+//! How the part of an object after its base is stored.
+struct ham_impl_world_snapshot_layout{
+	const ham_type *type;
+	ham_usize payload_offset;
+	ham_u64 hash;
+	bool has_strs;
+};
+
+/**
+ * Check that \p type describes everything after a base of \p base_size bytes in objects of its vtable.
+ * Object types have no base in the type system, their members are laid out from the first suitably aligned byte after it.
+ */
+static bool ham_impl_world_snapshot_layout_init(ham_impl_world_snapshot_layout *ret, const ham_type *type, usize base_size){
+	const auto vptr = ham_type_vptr(type);
+	if(!ham_type_is_object(type) || !vptr){
+		ham::logapierror("Snapshot type '{}' is not an object type with a vtable", ham::str8(ham_type_name(type)));
+		return false;
+	}
+
+	const auto info = vptr->info;
+
+	const auto align = ham_max(ham_type_alignment(type), (usize)1);
+	const auto payload_offset = ((base_size + align - 1) / align) * align;
+	const auto payload_end = payload_offset + ham_type_size(type);
+
+	if(((payload_end + info->alignment - 1) / info->alignment) * info->alignment != info->size){
+		ham::logapierror(
+			"Type '{}' does not describe the layout of '{}': {} bytes after a {} byte base, object is {} bytes",
+			ham::str8(ham_type_name(type)), info->type_id, ham_type_size(type), base_size, info->size
+		);
+		return false;
+	}
+	else if(!ham_type_is_serializable(type)){
+		ham::logapierror("Type '{}' can not be stored in a snapshot", ham::str8(ham_type_name(type)));
+		return false;
+	}
+
+	const auto num_fields = ham_type_num_fields(type);
+	const auto fields = ham_type_fields(type);
+
+	ham_u64 hash = ham_hash_fast_64(info->type_id, strlen(info->type_id));
+	bool has_strs = false;
+
+	for(usize i = 0; i < num_fields; i++){
+		const auto field_type = fields[i].type;
+
+		if(ham_type_flags_kind(ham_type_get_flags(field_type)) == HAM_TYPE_STRING){
+			// loaded strings get interned, which only takes UTF-8
+			if(ham_type_flags_info(ham_type_get_flags(field_type)) != HAM_TYPE_INFO_STRING_UTF8){
+				ham::logapierror("Only UTF-8 strings can be stored in snapshots, found '{}' in '{}'", ham::str8(ham_type_name(field_type)), ham::str8(ham_type_name(type)));
+				return false;
+			}
+
+			has_strs = true;
+		}
+
+		const ham_u64 field_key[2] = { ham_type_hash(field_type), (ham_u64)fields[i].offset };
+		hash = ham_hash_fast_64_seeded((const char*)field_key, sizeof(field_key), hash);
+	}
+
+	ret->type = type;
+	ret->payload_offset = payload_offset;
+	ret->hash = hash;
+	ret->has_strs = has_strs;
+	return true;
+}
+
+static inline const ham_type *ham_impl_world_snapshot_type_by_vptr(const ham_object_vtable *vptr, ham_usize num_types, const ham_type *const *types){
+	for(usize i = 0; i < num_types; i++){
+		if(ham_type_vptr(types[i]) == vptr) return types[i];
+	}
+
+	return nullptr;
+}
+
+static inline const ham_type *ham_impl_world_snapshot_type_by_name(ham_str8 type_id, ham_usize num_types, const ham_type *const *types){
+	for(usize i = 0; i < num_types; i++){
+		const auto vptr = ham_type_vptr(types[i]);
+		if(vptr && ham::str8(vptr->info->type_id) == type_id) return types[i];
+	}
+
+	return nullptr;
+}
+
+//! Decoded strings point into the snapshot data, swap them for interned copies that outlive it.
+static bool ham_impl_world_snapshot_intern_strs(const ham_impl_world_snapshot_layout *layout, char *payload){
+	const auto num_fields = ham_type_num_fields(layout->type);
+	const auto fields = ham_type_fields(layout->type);
+
+	for(usize i = 0; i < num_fields; i++){
+		if(ham_type_flags_kind(ham_type_get_flags(fields[i].type)) != HAM_TYPE_STRING) continue;
+
+		ham_str8 str;
+		memcpy(&str, payload + fields[i].offset, sizeof(str));
+
+		const auto sym = ham_intern(str);
+		if(str.len && sym == HAM_SYMBOL_NULL){
+			ham::logapierror("Failed to intern snapshot string");
+			return false;
+		}
+
+		str = ham_symbol_str(sym);
+		memcpy(payload + fields[i].offset, &str, sizeof(str));
+	}
+
+	return true;
+}
+
+//
+// Streaming writer
+//
+
+//! Writes either to \p file through a fixed staging buffer or, if \p file is `NULL`, straight into \p out.
+struct ham_impl_world_snapshot_writer{
+	ham_file *file;
+	ham::basic_buffer<char> *out;
+	ham_u64 offset;
+	ham::basic_buffer<char> buf;
+	usize buf_len;
+};
+
+static inline bool ham_impl_world_snapshot_flush(ham_impl_world_snapshot_writer *w){
+	if(!w->file) return true;
+
+	usize written = 0;
+	while(written < w->buf_len){
+		const auto res = ham_file_write(w->file, w->buf.data() + written, w->buf_len - written);
+		if(res == (usize)-1 || res == 0){
+			ham::logapierror("Failed to write snapshot data");
+			return false;
+		}
+
+		written += res;
+	}
+
+	w->buf_len = 0;
+	return true;
+}
+
+static inline bool ham_impl_world_snapshot_write(ham_impl_world_snapshot_writer *w, const void *data, usize len){
+	if(len == 0) return true;
+
+	auto bytes = (const char*)data;
+
+	if(!w->file){
+		const auto out_off = (usize)w->offset;
+		if(out_off + len > w->out->size() && !w->out->resize(out_off + len)){
+			ham::logapierror("Failed to grow snapshot buffer");
+			return false;
+		}
+
+		memcpy(w->out->data() + out_off, bytes, len);
+		w->offset += len;
+		return true;
+	}
+
+	while(len > 0){
+		const auto n = ham_min(len, w->buf.size() - w->buf_len);
+		memcpy(w->buf.data() + w->buf_len, bytes, n);
+
+		w->buf_len += n;
+		w->offset += n;
+
+		if(w->buf_len == w->buf.size() && !ham_impl_world_snapshot_flush(w)){
+			return false;
+		}
+
+		bytes += n;
+		len -= n;
+	}
+
+	return true;
+}
+
+static inline bool ham_impl_world_snapshot_write_align(ham_impl_world_snapshot_writer *w){
+	constexpr char zeros[ham_impl_world_snapshot_align] = { 0 };
+	const auto rem = w->offset % ham_impl_world_snapshot_align;
+	return rem == 0 || ham_impl_world_snapshot_write(w, zeros, ham_impl_world_snapshot_align - rem);
+}
+
+//
+// Saving
+//
+
+//! Objects of a single type in snapshot order along with where their payloads get stored.
+struct ham_impl_world_snapshot_group{
+	ham_impl_world_snapshot_layout layout;
+	ham::std_vector<ham_object*> objs;
+	ham::std_vector<ham_u32> owners; //!< component groups only
+};
+
+/**
+ * Add \p obj to the group for its vtable, creating the group if required.
+ * \p base_size is the size of the base object the layout of the group is checked against.
+ */
+static ham_impl_world_snapshot_group *ham_impl_world_snapshot_group_add(
+	robin_hood::unordered_flat_map<const ham_object_vtable*, usize> *group_idxs,
+	ham::std_vector<ham_impl_world_snapshot_group> *groups,
+	usize base_size, ham_usize num_types, const ham_type *const *types,
+	ham_object *obj
+){
+	const auto vptr = obj->vptr;
+
+	const auto emplace_res = group_idxs->try_emplace(vptr, groups->size());
+	if(!emplace_res.second){
+		auto &group = (*groups)[emplace_res.first->second];
+		group.objs.emplace_back(obj);
+		return &group;
+	}
+
+	const auto type = ham_impl_world_snapshot_type_by_vptr(vptr, num_types, types);
+	if(!type){
+		ham::logapierror("No type given for '{}', it can not be stored in a snapshot", vptr->info->type_id);
+		group_idxs->erase(emplace_res.first);
+		return nullptr;
+	}
+
+	auto &group = groups->emplace_back();
+
+	if(!ham_impl_world_snapshot_layout_init(&group.layout, type, base_size)){
+		groups->pop_back();
+		group_idxs->erase(emplace_res.first);
+		return nullptr;
+	}
+
+	group.objs.emplace_back(obj);
+	return &group;
+}
+
+//! Write the encoded payloads of every object in \p group, returns the number of bytes written or `(usize)-1` on error.
+static usize ham_impl_world_snapshot_write_payloads(ham_impl_world_snapshot_writer *w, const ham_impl_world_snapshot_group *group, ham::basic_buffer<char> *scratch){
+	const auto type = group->layout.type;
+	const auto payload_offset = group->layout.payload_offset;
+
+	(void)scratch->resize(0);
+
+	for(const auto obj : group->objs){
+		if(ham_type_serialize(type, 1, (const char*)obj + payload_offset, scratch->handle()) == (usize)-1){
+			ham::logapierror("Failed to encode object of type '{}'", ham::str8(ham_type_name(type)));
+			return (usize)-1;
+		}
+	}
+
+	if(!ham_impl_world_snapshot_write(w, scratch->data(), scratch->size())){
+		return (usize)-1;
+	}
+
+	return scratch->size();
+}
+
+static inline void ham_impl_world_snapshot_type_name(ham_impl_world_snapshot_type *type, ham::str_buffer8 *strtab, const ham_impl_world_snapshot_layout *layout){
+	const ham::str8 type_id = ham_type_vptr(layout->type)->info->type_id;
+
+	type->name_offset = strtab->len();
+	type->name_len    = (ham_u32)type_id.len();
+	type->layout_hash = layout->hash;
+
+	*strtab += type_id;
+}
+
+//! Caller must hold the world, partition and hierarchy locks.
+static bool ham_impl_world_snapshot_write_ents(
+	ham_impl_world_snapshot_writer *w, const ham_world_hierarchy *hier,
+	ham_usize num_types, const ham_type *const *types,
+	usize num_in_ents, ham_entity *const *in_ents
+){
+	// group entities by type, keeping the given order within each type
+
+	robin_hood::unordered_flat_map<const ham_object_vtable*, usize> type_idxs;
+	ham::std_vector<ham_impl_world_snapshot_group> type_ents;
+
+	for(usize i = 0; i < num_in_ents; i++){
+		if(!ham_impl_world_snapshot_group_add(&type_idxs, &type_ents, sizeof(ham_entity), num_types, types, ham_super(in_ents[i]))){
+			return false;
+		}
+	}
+
+	// global indices, indexed by hierarchy index; parents outside of the given set become roots
+
+	ham::basic_buffer<ham_u32> global_idxs;
+	if(!global_idxs.resize(hier->ents.size())){
+		ham::logapierror("Failed to allocate snapshot entity indices");
+		return false;
+	}
+
+	std::fill(global_idxs.begin(), global_idxs.end(), ham_impl_hier_npos);
+
+	ham::std_vector<ham_impl_world_snapshot_type> ent_types(type_ents.size());
+	ham::str_buffer8 strtab;
+
+	usize num_ents = 0;
+
+	for(usize type_idx = 0; type_idx < type_ents.size(); type_idx++){
+		const auto &group = type_ents[type_idx];
+
+		auto &type = ent_types[type_idx];
+		memset(&type, 0, sizeof(type));
+
+		ham_impl_world_snapshot_type_name(&type, &strtab, &group.layout);
+
+		type.first = num_ents;
+		type.num   = group.objs.size();
+
+		for(usize i = 0; i < group.objs.size(); i++){
+			global_idxs[((ham_entity*)group.objs[i])->_impl_hier_idx] = (ham_u32)(num_ents + i);
+		}
+
+		num_ents += group.objs.size();
+	}
+
+	// components in entity order, grouped by type
+
+	robin_hood::unordered_flat_map<const ham_object_vtable*, usize> comp_type_idxs;
+	ham::std_vector<ham_impl_world_snapshot_group> comp_groups;
+	ham::std_vector<ham_u32> comp_order;
+
+	for(const auto &group : type_ents){
+		for(const auto obj : group.objs){
+			const auto ent = (ham_entity*)obj;
+
+			const auto num_comps = ham_buffer_size(&ent->components) / sizeof(ham_entity_component*);
+			const auto comps = (ham_entity_component**)ham_buffer_data(&ent->components);
+
+			for(usize i = 0; i < num_comps; i++){
+				const auto comp_group = ham_impl_world_snapshot_group_add(&comp_type_idxs, &comp_groups, sizeof(ham_entity_component), num_types, types, ham_super(comps[i]));
+				if(!comp_group) return false;
+
+				comp_group->owners.emplace_back(global_idxs[ent->_impl_hier_idx]);
+				comp_order.emplace_back((ham_u32)comp_type_idxs.find(ham_super(comps[i])->vptr)->second);
+			}
+		}
+	}
+
+	ham::std_vector<ham_impl_world_snapshot_type> comp_types(comp_groups.size());
+
+	for(usize type_idx = 0; type_idx < comp_groups.size(); type_idx++){
+		auto &type = comp_types[type_idx];
+		memset(&type, 0, sizeof(type));
+
+		ham_impl_world_snapshot_type_name(&type, &strtab, &comp_groups[type_idx].layout);
+
+		type.num = comp_groups[type_idx].objs.size();
+	}
+
+	ham_impl_world_snapshot_header header;
+	memset(&header, 0, sizeof(header));
+
+	const auto header_offset = w->offset;
+
+	bool result = ham_impl_world_snapshot_write(w, &header, sizeof(header));
+
+	ham::basic_buffer<char> scratch;
+
+	// columns, written straight from the entities without staging
+
+	for(usize type_idx = 0; result && type_idx < ent_types.size(); type_idx++){
+		auto &type = ent_types[type_idx];
+		const auto &ents = type_ents[type_idx].objs;
+
+		result = ham_impl_world_snapshot_write_align(w);
+		type.pos_offset = w->offset;
+		for(usize i = 0; result && i < ents.size(); i++){
+			result = ham_impl_world_snapshot_write(w, &((ham_entity*)ents[i])->transform.pos, sizeof(ham_vec3));
+		}
+
+		result = result && ham_impl_world_snapshot_write_align(w);
+		type.scale_offset = w->offset;
+		for(usize i = 0; result && i < ents.size(); i++){
+			result = ham_impl_world_snapshot_write(w, &((ham_entity*)ents[i])->transform.scale, sizeof(ham_vec3));
+		}
+
+		result = result && ham_impl_world_snapshot_write_align(w);
+		type.pyr_offset = w->offset;
+		for(usize i = 0; result && i < ents.size(); i++){
+			result = ham_impl_world_snapshot_write(w, &((ham_entity*)ents[i])->transform.pyr, sizeof(ham_vec3));
+		}
+
+		result = result && ham_impl_world_snapshot_write_align(w);
+		type.payload_offset = w->offset;
+
+		if(result){
+			type.payload_len = ham_impl_world_snapshot_write_payloads(w, &type_ents[type_idx], &scratch);
+			result = type.payload_len != (usize)-1;
+		}
+	}
+
+	// parents in global index order
+
+	result = result && ham_impl_world_snapshot_write_align(w);
+	header.parents_offset = w->offset;
+
+	for(usize type_idx = 0; result && type_idx < ent_types.size(); type_idx++){
+		for(const auto obj : type_ents[type_idx].objs){
+			const auto ent = (ham_entity*)obj;
+			const ham_u32 parent_idx = ent->parent ? global_idxs[ent->parent->_impl_hier_idx] : ham_impl_hier_npos;
+			result = ham_impl_world_snapshot_write(w, &parent_idx, sizeof(parent_idx));
+			if(!result) break;
+		}
+	}
+
+	result = result && ham_impl_world_snapshot_write_align(w);
+	header.comp_order_offset = w->offset;
+	result = result && ham_impl_world_snapshot_write(w, comp_order.data(), comp_order.size() * sizeof(ham_u32));
+
+	for(usize type_idx = 0; result && type_idx < comp_types.size(); type_idx++){
+		auto &type = comp_types[type_idx];
+		const auto &group = comp_groups[type_idx];
+
+		result = ham_impl_world_snapshot_write_align(w);
+		type.owners_offset = w->offset;
+		result = result && ham_impl_world_snapshot_write(w, group.owners.data(), group.owners.size() * sizeof(ham_u32));
+
+		result = result && ham_impl_world_snapshot_write_align(w);
+		type.payload_offset = w->offset;
+
+		if(result){
+			type.payload_len = ham_impl_world_snapshot_write_payloads(w, &group, &scratch);
+			result = type.payload_len != (usize)-1;
+		}
+	}
+
+	result = result && ham_impl_world_snapshot_write_align(w);
+	header.types_offset = w->offset;
+	result = result && ham_impl_world_snapshot_write(w, ent_types.data(), ent_types.size() * sizeof(ham_impl_world_snapshot_type));
+	result = result && ham_impl_world_snapshot_write(w, comp_types.data(), comp_types.size() * sizeof(ham_impl_world_snapshot_type));
+
+	header.strtab_offset = w->offset;
+	header.strtab_len    = strtab.len();
+	result = result && ham_impl_world_snapshot_write(w, strtab.ptr(), strtab.len());
+
+	// padded so snapshots stay aligned when concatenated
+	result = result && ham_impl_world_snapshot_write_align(w);
+
+	result = result && ham_impl_world_snapshot_flush(w);
+
+	if(!result) return false;
+
+	// go back and fill in the header now that every offset is known
+
+	memcpy(header.magic, ham_impl_world_snapshot_magic, sizeof(header.magic));
+	header.version        = ham_impl_world_snapshot_version;
+	header.num_types      = (ham_u32)ent_types.size();
+	header.num_comp_types = (ham_u32)comp_types.size();
+	header.num_ents       = num_ents;
+	header.num_comps      = comp_order.size();
+
+	if(!w->file){
+		memcpy(w->out->data() + header_offset, &header, sizeof(header));
+		return true;
+	}
+
+	w->offset = header_offset;
+
+	return
+		ham_file_seek(w->file, header_offset) == header_offset &&
+		ham_impl_world_snapshot_write(w, &header, sizeof(header)) &&
+		ham_impl_world_snapshot_flush(w);
+}
+
+bool ham_impl_world_snapshot_serialize(
+	ham_world *world, ham_usize num_types, const ham_type *const *types,
+	ham_usize num_ents, ham_entity *const *ents, ham::basic_buffer<char> *out
+){
+	ham_impl_world_snapshot_writer w{
+		.file = nullptr,
+		.out = out,
+		.offset = out->size(),
+		.buf = ham::basic_buffer<char>(),
+		.buf_len = 0,
+	};
+
+	return ham_impl_world_snapshot_write_ents(&w, &world->hier, num_types, types, num_ents, ents);
+}
+
+bool ham_world_save_snapshot(ham_world *world, ham_str8 path, ham_usize num_types, const ham_type *const *types){
+	if(
+		!ham_check(world != NULL) ||
+		!ham_check(path.ptr && path.len) ||
+		!ham_check(num_types == 0 || types != NULL)
+	){
+		return false;
+	}
+
+	ham::scoped_lock lock(world->mut, world->root_partition.mut, world->hier.mut);
+
+	ham::basic_buffer<ham_entity*> ents;
+
+	for(usize i = 0; i < world->hier.ents.size(); i++){
+		if(world->hier.ents[i]) ents.emplace_back(world->hier.ents[i]);
+	}
+
+	const auto file = ham_file_open_utf8(path, HAM_OPEN_WRITE | HAM_OPEN_CREATE);
+	if(!file){
+		ham::logapierror("Failed to open snapshot file '{}'", ham::str8(path));
+		return false;
+	}
+
+	ham_impl_world_snapshot_writer w{
+		.file = file,
+		.out = nullptr,
+		.offset = 0,
+		.buf = ham::basic_buffer<char>(ham_impl_world_snapshot_write_buf_size),
+		.buf_len = 0,
+	};
+
+	const bool result = ham_impl_world_snapshot_write_ents(&w, &world->hier, num_types, types, ents.size(), ents.data());
+	if(!result){
+		ham::logapierror("Failed to write snapshot '{}'", ham::str8(path));
+	}
+
+	ham_file_close(file);
+	return result;
+}
+
+//
+// Loading
+//
+
+static inline bool ham_impl_world_snapshot_range_ok(usize file_size, ham_u64 offset, ham_u64 len){
+	return offset <= file_size && len <= (file_size - offset);
+}
+
+ham_usize ham_impl_world_snapshot_size(const char *data, ham_usize size){
+	if(size < sizeof(ham_impl_world_snapshot_header)) return (usize)-1;
+
+	ham_impl_world_snapshot_header header;
+	memcpy(&header, data, sizeof(header));
+
+	if(
+		memcmp(header.magic, ham_impl_world_snapshot_magic, sizeof(header.magic)) != 0 ||
+		header.version != ham_impl_world_snapshot_version ||
+		!ham_impl_world_snapshot_range_ok(size, header.strtab_offset, header.strtab_len)
+	){
+		return (usize)-1;
+	}
+
+	const auto end = header.strtab_offset + header.strtab_len;
+	const auto padded = ((end + ham_impl_world_snapshot_align - 1) / ham_impl_world_snapshot_align) * ham_impl_world_snapshot_align;
+
+	return ham_min(size, (usize)padded);
+}
+
+//! Resolved snapshot type, \p layout is only valid if \p type is not `NULL`.
+struct ham_impl_world_snapshot_load_type{
+	const ham_impl_world_snapshot_type *stored;
+	ham_impl_world_snapshot_layout layout;
+};
+
+static bool ham_impl_world_snapshot_resolve_type(
+	ham_impl_world_snapshot_load_type *ret, ham_str8 name,
+	usize size, const char *strtab, ham_u64 strtab_len,
+	const ham_impl_world_snapshot_type *stored, usize base_size,
+	ham_usize num_types, const ham_type *const *types
+){
+	if(
+		!ham_impl_world_snapshot_range_ok(strtab_len, stored->name_offset, stored->name_len) ||
+		!ham_impl_world_snapshot_range_ok(size, stored->payload_offset, stored->payload_len)
+	){
+		ham::logapierror("Corrupt type table entry in '{}'", ham::str8(name));
+		return false;
+	}
+
+	const auto type_id = ham::str8(strtab + stored->name_offset, stored->name_len);
+
+	const auto type = ham_impl_world_snapshot_type_by_name(type_id, num_types, types);
+	if(!type){
+		ham::logapierror("No type given for '{}' stored in '{}'", type_id, ham::str8(name));
+		return false;
+	}
+	else if(!ham_impl_world_snapshot_layout_init(&ret->layout, type, base_size)){
+		return false;
+	}
+	else if(ret->layout.hash != stored->layout_hash){
+		ham::logapierror("Layout of '{}' differs from snapshot '{}'", type_id, ham::str8(name));
+		return false;
+	}
+
+	ret->stored = stored;
+	return true;
+}
+
+//! Decode the payload of one object and advance \p it past it.
+static bool ham_impl_world_snapshot_read_payload(const ham_impl_world_snapshot_layout *layout, ham_object *obj, const char *payload_end, const char **it){
+	const auto payload = (char*)obj + layout->payload_offset;
+
+	const auto num_read = ham_type_deserialize(layout->type, 1, payload, (usize)(payload_end - *it), *it);
+	if(num_read == (usize)-1){
+		return false;
+	}
+
+	*it += num_read;
+
+	return !layout->has_strs || ham_impl_world_snapshot_intern_strs(layout, payload);
+}
+
+ham_usize ham_impl_world_snapshot_instantiate(
+	ham_world *world, ham_str8 name, const char *data, ham_usize size,
+	ham_usize num_types, const ham_type *const *types,
+	ham::basic_buffer<ham_entity*> *ret_ents
+){
+	if(size < sizeof(ham_impl_world_snapshot_header)){
+		ham::logapierror("Invalid snapshot '{}'", ham::str8(name));
+		return (usize)-1;
+	}
+
+	ham_impl_world_snapshot_header header;
+	memcpy(&header, data, sizeof(header));
+
+	const ham_u64 num_all_types = (ham_u64)header.num_types + header.num_comp_types;
+
+	if(memcmp(header.magic, ham_impl_world_snapshot_magic, sizeof(header.magic)) != 0){
+		ham::logapierror("Bad snapshot magic in '{}'", ham::str8(name));
+		return (usize)-1;
+	}
+	else if(header.version != ham_impl_world_snapshot_version){
+		ham::logapierror("Unsupported snapshot version {} in '{}'", header.version, ham::str8(name));
+		return (usize)-1;
+	}
+	else if(
+		header.num_ents >= ham_impl_hier_npos ||
+		header.num_comps >= ham_impl_hier_npos ||
+		!ham_impl_world_snapshot_range_ok(size, header.parents_offset, header.num_ents * sizeof(ham_u32)) ||
+		!ham_impl_world_snapshot_range_ok(size, header.comp_order_offset, header.num_comps * sizeof(ham_u32)) ||
+		!ham_impl_world_snapshot_range_ok(size, header.types_offset, num_all_types * sizeof(ham_impl_world_snapshot_type)) ||
+		!ham_impl_world_snapshot_range_ok(size, header.strtab_offset, header.strtab_len)
+	){
+		ham::logapierror("Corrupt snapshot header in '{}'", ham::str8(name));
+		return (usize)-1;
+	}
+
+	const auto stored_types = (const ham_impl_world_snapshot_type*)(data + header.types_offset);
+	const auto parents      = (const ham_u32*)(data + header.parents_offset);
+	const auto comp_order   = (const ham_u32*)(data + header.comp_order_offset);
+	const auto strtab       = data + header.strtab_offset;
+
+	// validate every type before constructing anything
+
+	ham::std_vector<ham_impl_world_snapshot_load_type> ent_types(header.num_types);
+	ham::std_vector<ham_impl_world_snapshot_load_type> comp_types(header.num_comp_types);
+
+	for(usize i = 0; i < header.num_types; i++){
+		const auto &stored = stored_types[i];
+
+		if(
+			stored.first > header.num_ents || stored.num > header.num_ents - stored.first ||
+			!ham_impl_world_snapshot_range_ok(size, stored.pos_offset,   stored.num * sizeof(ham_vec3)) ||
+			!ham_impl_world_snapshot_range_ok(size, stored.scale_offset, stored.num * sizeof(ham_vec3)) ||
+			!ham_impl_world_snapshot_range_ok(size, stored.pyr_offset,   stored.num * sizeof(ham_vec3))
+		){
+			ham::logapierror("Corrupt entity type table entry {} in '{}'", i, ham::str8(name));
+			return (usize)-1;
+		}
+
+		if(!ham_impl_world_snapshot_resolve_type(&ent_types[i], name, size, strtab, header.strtab_len, &stored, sizeof(ham_entity), num_types, types)){
+			return (usize)-1;
+		}
+	}
+
+	{
+		ham::basic_buffer<ham_u64> comp_counts;
+		if(!comp_counts.resize(header.num_comp_types)){
+			ham::logapierror("Failed to allocate component counts");
+			return (usize)-1;
+		}
+
+		std::fill(comp_counts.begin(), comp_counts.end(), 0);
+
+		for(usize i = 0; i < header.num_comps; i++){
+			if(comp_order[i] >= header.num_comp_types){
+				ham::logapierror("Bad component type index for component {} in '{}'", i, ham::str8(name));
+				return (usize)-1;
+			}
+
+			++comp_counts[comp_order[i]];
+		}
+
+		for(usize i = 0; i < header.num_comp_types; i++){
+			const auto &stored = stored_types[header.num_types + i];
+
+			if(
+				stored.num != comp_counts[i] ||
+				!ham_impl_world_snapshot_range_ok(size, stored.owners_offset, stored.num * sizeof(ham_u32))
+			){
+				ham::logapierror("Corrupt component type table entry {} in '{}'", i, ham::str8(name));
+				return (usize)-1;
+			}
+
+			const auto owners = (const ham_u32*)(data + stored.owners_offset);
+			for(usize j = 0; j < stored.num; j++){
+				if(owners[j] >= header.num_ents){
+					ham::logapierror("Bad owner index for component {} in '{}'", j, ham::str8(name));
+					return (usize)-1;
+				}
+			}
+
+			if(!ham_impl_world_snapshot_resolve_type(&comp_types[i], name, size, strtab, header.strtab_len, &stored, sizeof(ham_entity_component), num_types, types)){
+				return (usize)-1;
+			}
+		}
+	}
+
+	// reject parent cycles up-front, the hierarchy rebuild assumes a forest
+
+	{
+		ham::basic_buffer<ham_u8> states;
+		if(!states.resize(header.num_ents)){
+			ham::logapierror("Failed to allocate snapshot parent states");
+			return (usize)-1;
+		}
+
+		std::fill(states.begin(), states.end(), 0);
+
+		for(usize i = 0; i < header.num_ents; i++){
+			usize cur = i;
+
+			while(cur != ham_impl_hier_npos && states[cur] == 0){
+				states[cur] = 1;
+
+				const auto parent = parents[cur];
+				if(parent != ham_impl_hier_npos && parent >= header.num_ents){
+					ham::logapierror("Bad parent index for entity {} in '{}'", cur, ham::str8(name));
+					return (usize)-1;
+				}
+
+				cur = parent;
+			}
+
+			if(cur != ham_impl_hier_npos && states[cur] == 1){
+				ham::logapierror("Parent cycle found in snapshot '{}'", ham::str8(name));
+				return (usize)-1;
+			}
+
+			for(cur = i; cur != ham_impl_hier_npos && states[cur] == 1; cur = parents[cur]){
+				states[cur] = 2;
+			}
+		}
+	}
+
+	ham::basic_buffer<ham_entity*> ents;
+	if(!ents.resize(header.num_ents)){
+		ham::logapierror("Failed to allocate snapshot entities");
+		return (usize)-1;
+	}
+
+	std::fill(ents.begin(), ents.end(), nullptr);
+
+	// bulk allocate without constructing, one manager lookup per type
+
+	usize num_created = 0;
+	bool created = true;
+
+	for(usize type_idx = 0; created && type_idx < header.num_types; type_idx++){
+		const auto &type = ent_types[type_idx];
+		const auto &stored = *type.stored;
+
+		const auto man = ham_impl_world_entity_manager(world, (const ham_entity_vtable*)ham_type_vptr(type.layout.type));
+		if(!man){
+			created = false;
+			break;
+		}
+
+		const auto type_ents = ents.data() + stored.first;
+
+		const auto num_type_created = ham_object_new_uninit_n(man, stored.num, ham_impl_entity_init, world, (ham_object**)type_ents);
+		num_created += num_type_created;
+
+		if(num_type_created != stored.num){
+			std::fill(type_ents + num_type_created, type_ents + stored.num, nullptr);
+			created = false;
+			break;
+		}
+
+		const auto poss        = (const ham_vec3*)(data + stored.pos_offset);
+		const auto scales      = (const ham_vec3*)(data + stored.scale_offset);
+		const auto pyrs        = (const ham_vec3*)(data + stored.pyr_offset);
+		const auto payload_end = data + stored.payload_offset + stored.payload_len;
+
+		const char *payload_it = data + stored.payload_offset;
+
+		for(usize i = 0; i < stored.num; i++){
+			const auto ent = type_ents[i];
+
+			ent->transform.pos   = poss[i];
+			ent->transform.scale = scales[i];
+			ent->transform.pyr   = pyrs[i];
+			ent->transform._impl_dirty = true;
+
+			if(!ham_impl_world_snapshot_read_payload(&type.layout, ham_super(ent), payload_end, &payload_it)){
+				ham::logapierror("Failed to decode entity {} in '{}'", stored.first + i, ham::str8(name));
+				created = false;
+				break;
+			}
+		}
+	}
+
+	if(created){
+		for(usize i = 0; i < header.num_ents; i++){
+			const auto parent_idx = parents[i];
+			if(parent_idx == ham_impl_hier_npos) continue;
+
+			const auto ent    = ents[i];
+			const auto parent = ents[parent_idx];
+
+			if(!ham_buffer_insert(&parent->children, ham_buffer_size(&parent->children), &ent, sizeof(ham_entity*))){
+				created = false;
+				break;
+			}
+
+			ent->parent = parent;
+		}
+	}
+	else{
+		// only the allocated prefix of each type is left, pack it so it can be registered and torn down below
+		usize out_idx = 0;
+		for(usize i = 0; i < header.num_ents; i++){
+			ents[out_idx] = ents[i];
+			out_idx += ents[i] != nullptr;
+		}
+	}
+
+	// register everything in one go, even on failure so the cleanup below can use ham_entity_destroy
+
+	{
+		ham::scoped_lock lock(world->root_partition.mut, world->hier.mut);
+
+		auto &part_ents = world->root_partition.ents;
+
+		const auto old_size = part_ents.size();
+		if(!part_ents.resize(old_size + num_created)){
+			ham::logapierror("Failed to grow world partition");
+			created = false;
+		}
+		else{
+			std::copy_n(ents.begin(), num_created, part_ents.begin() + old_size);
+
+			// partition is already sorted, so only the new tail needs sorting before merging
+			std::sort(part_ents.begin() + old_size, part_ents.end());
+			std::inplace_merge(part_ents.begin(), part_ents.begin() + old_size, part_ents.end());
+		}
+
+		if(!ham_impl_world_hierarchy_insert_n(&world->hier, num_created, ents.data())){
+			created = false;
+		}
+	}
+
+	// restore hooks see the whole hierarchy, like constructors of entities created one by one would
+
+	for(usize type_idx = 0; created && type_idx < header.num_types; type_idx++){
+		const auto &stored = *ent_types[type_idx].stored;
+
+		const auto ent_vptr = (const ham_entity_vtable*)ham_type_vptr(ent_types[type_idx].layout.type);
+		if(!ent_vptr->restore) continue;
+
+		for(usize i = 0; i < stored.num; i++){
+			if(!ent_vptr->restore(ents[stored.first + i])){
+				ham::logapierror("Failed to restore entity {} in '{}'", stored.first + i, ham::str8(name));
+				created = false;
+				break;
+			}
+		}
+	}
+
+	// components last, they may look up the world through their entity
+
+	if(created && header.num_comps){
+		ham::std_vector<usize> comp_idxs(header.num_comp_types, 0);
+		ham::std_vector<const char*> payload_its(header.num_comp_types);
+
+		for(usize i = 0; i < header.num_comp_types; i++){
+			payload_its[i] = data + comp_types[i].stored->payload_offset;
+		}
+
+		for(usize i = 0; created && i < header.num_comps; i++){
+			const auto type_idx = comp_order[i];
+			const auto &type = comp_types[type_idx];
+			const auto &stored = *type.stored;
+
+			const auto owner = ((const ham_u32*)(data + stored.owners_offset))[comp_idxs[type_idx]++];
+			const auto comp_vptr = (const ham_entity_component_vtable*)ham_type_vptr(type.layout.type);
+
+			const auto comp = ham_impl_entity_component_new_uninit(ents[owner], comp_vptr);
+			if(!comp){
+				created = false;
+				break;
+			}
+
+			const auto payload_end = data + stored.payload_offset + stored.payload_len;
+			if(!ham_impl_world_snapshot_read_payload(&type.layout, ham_super(comp), payload_end, &payload_its[type_idx])){
+				ham::logapierror("Failed to decode component {} in '{}'", i, ham::str8(name));
+				created = false;
+			}
+			else if(comp_vptr->restore && !comp_vptr->restore(comp)){
+				ham::logapierror("Failed to restore component {} in '{}'", i, ham::str8(name));
+				created = false;
+			}
+		}
+	}
+
+	if(!created){
+		ham::logapierror("Failed to construct entities from snapshot '{}'", ham::str8(name));
+
+		for(usize i = 0; i < num_created; i++){
+			// children get destroyed with their parents
+			if(!ents[i]->parent) ham_entity_destroy(ents[i]);
+		}
+
+		return (usize)-1;
+	}
+
+	if(ret_ents){
+		*ret_ents = std::move(ents);
+	}
+
+	return num_created;
+}
+
+ham_usize ham_world_load_snapshot(ham_world *world, ham_str8 path, ham_usize num_types, const ham_type *const *types){
+	if(
+		!ham_check(world != NULL) ||
+		!ham_check(path.ptr && path.len) ||
+		!ham_check(num_types == 0 || types != NULL)
+	){
+		return (usize)-1;
+	}
+
+	const auto file = ham_file_open_utf8(path, HAM_OPEN_READ);
+	if(!file){
+		ham::logapierror("Failed to open snapshot file '{}'", ham::str8(path));
+		return (usize)-1;
+	}
+
+	ham_file_info file_info;
+	if(!ham_file_get_info(file, &file_info) || file_info.size < sizeof(ham_impl_world_snapshot_header)){
+		ham::logapierror("Invalid snapshot file '{}'", ham::str8(path));
+		ham_file_close(file);
+		return (usize)-1;
+	}
+
+	const auto file_size = file_info.size;
+
+	const auto mapping = (const char*)ham_file_map(file, HAM_OPEN_READ, 0, file_size);
+	if(!mapping){
+		ham::logapierror("Failed to map snapshot file '{}'", ham::str8(path));
+		ham_file_close(file);
+		return (usize)-1;
+	}
+
+	const auto result = ham_impl_world_snapshot_instantiate(world, path, mapping, file_size, num_types, types, nullptr);
+
+	ham_file_unmap(file, (void*)mapping, file_size);
+	ham_file_close(file);
+
+	return result;
+}
+
+HAM_C_API_END
@@ -0,0 +1,959 @@
+/*
+ * Ham World Engine Runtime
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "world.hpp"
+
+#include "ham/check.h"
+#include "ham/fs.h"
+#include "ham/std_vector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace ham::typedefs;
+
+HAM_C_API_BEGIN
+
+constexpr ham_usize ham_impl_world_streamer_default_budget = 256 * 1024 * 1024;
+constexpr ham_usize ham_impl_world_streamer_read_chunk = 64 * 1024;
+
+//
+// Region keys
+//
+// Regions are axis-aligned cubes of side `region_size`, keyed by their integer grid coordinates
+// packed 21 bits per axis into a single u64.
+//
+
+struct ham_impl_world_region_coord{
+	ham_i32 x, y, z;
+};
+
+constexpr ham_i32 ham_impl_world_region_coord_max = (1 << 20) - 1;
+constexpr ham_i32 ham_impl_world_region_coord_min = -(1 << 20);
+
+static inline ham_u64 ham_impl_world_region_key(ham_impl_world_region_coord c){
+	constexpr ham_u64 mask = (ham_u64(1) << 21) - 1;
+	return ((ham_u64)c.x & mask) | (((ham_u64)c.y & mask) << 21) | (((ham_u64)c.z & mask) << 42);
+}
+
+static inline ham_i32 ham_impl_world_region_axis(ham_f64 p, ham_f64 region_size){
+	const auto c = std::floor(p / region_size);
+	return (ham_i32)std::clamp(c, (ham_f64)ham_impl_world_region_coord_min, (ham_f64)ham_impl_world_region_coord_max);
+}
+
+static inline ham_impl_world_region_coord ham_impl_world_region_coord_of(ham_vec3 p, ham_f64 region_size){
+	return {
+		ham_impl_world_region_axis(p.x, region_size),
+		ham_impl_world_region_axis(p.y, region_size),
+		ham_impl_world_region_axis(p.z, region_size),
+	};
+}
+
+//! Squared distance from \p p to the bounds of region \p c .
+static inline ham_f64 ham_impl_world_region_dist2(ham_impl_world_region_coord c, ham_vec3 p, ham_f64 region_size){
+	const ham_f64 mins[3] = { c.x * region_size, c.y * region_size, c.z * region_size };
+	const ham_f64 ps[3] = { p.x, p.y, p.z };
+
+	ham_f64 ret = 0.0;
+
+	for(int i = 0; i < 3; i++){
+		const auto d = ps[i] < mins[i] ? mins[i] - ps[i] : ham_max(0.0, ps[i] - (mins[i] + region_size));
+		ret += d * d;
+	}
+
+	return ret;
+}
+
+//
+// Streamer state
+//
+
+enum ham_impl_world_region_state{
+	HAM_IMPL_WORLD_REGION_QUEUED,   //!< waiting on the I/O thread
+	HAM_IMPL_WORLD_REGION_READY,    //!< bytes read, waiting to be instantiated on the next update
+	HAM_IMPL_WORLD_REGION_RESIDENT, //!< entities live in the world
+};
+
+struct ham_impl_world_region{
+	ham_impl_world_region_coord coord;
+	ham_impl_world_region_state state;
+	ham_usize bytes; //!< resident entity memory, estimated when the region was instantiated
+	ham::basic_buffer<char> data;
+	ham::basic_buffer<char> unloaded; //!< snapshots that failed to instantiate, written back verbatim on eviction
+};
+
+//! Snapshot bytes the I/O thread failed to write, handed back to the main thread so the entities aren't lost.
+struct ham_impl_world_region_unwritten{
+	ham_impl_world_region_coord coord;
+	bool is_append; //!< whether \ref data goes on the end of the region file rather than replacing it
+	ham::basic_buffer<char> data;
+};
+
+enum ham_impl_world_streamer_job_kind{
+	HAM_IMPL_WORLD_STREAMER_JOB_READ,
+	HAM_IMPL_WORLD_STREAMER_JOB_WRITE,  //!< replace the region file
+	HAM_IMPL_WORLD_STREAMER_JOB_APPEND, //!< add a snapshot to the end of the region file
+};
+
+struct ham_impl_world_streamer_job{
+	ham_u64 key;
+	ham_impl_world_region_coord coord;
+	ham_impl_world_streamer_job_kind kind;
+	ham::str_buffer8 path;
+	ham::basic_buffer<char> data;
+};
+
+struct ham_world_streamer{
+	const ham_allocator *allocator;
+	ham_world *world;
+
+	ham::str_buffer8 dir;
+	ham_f64 region_size;
+	ham_f64 prefetch_radius;
+	ham_usize budget;
+	ham_usize resident_bytes;
+
+	ham::std_vector<const ham_type*> types;
+
+	//! Guards `regions`, `unwritten` and `io_failed`, shared with the I/O thread.
+	ham::mutex mut;
+	robin_hood::unordered_flat_map<ham_u64, ham_impl_world_region> regions;
+	robin_hood::unordered_flat_map<ham_u64, ham_impl_world_region_unwritten> unwritten;
+	bool io_failed; //!< whether a write failed since the last flush
+
+	ham::mutex io_mut;
+	ham::cond io_cond, io_idle_cond;
+	ham::std_vector<ham_impl_world_streamer_job> io_jobs;
+	ham_usize io_pending;
+	bool io_quit;
+
+	ham_thread *io_thread;
+};
+
+static inline void ham_impl_world_streamer_region_path(const ham_world_streamer *streamer, ham_impl_world_region_coord c, ham::str_buffer8 *ret){
+	*ret = ham::format("{}/region.{}.{}.{}.hamw", streamer->dir, c.x, c.y, c.z);
+}
+
+//
+// Background I/O
+//
+
+static bool ham_impl_world_streamer_read_file(ham_str8 path, ham::basic_buffer<char> *ret){
+	// a region that was never written is simply empty
+	if(!ham_path_exists_utf8(path)) return true;
+
+	const auto file = ham_file_open_utf8(path, HAM_OPEN_READ);
+	if(!file){
+		ham::logapierror("Failed to open region file '{}'", ham::str8(path));
+		return false;
+	}
+
+	usize len = 0;
+	bool result = true;
+
+	while(true){
+		if(!ret->resize(len + ham_impl_world_streamer_read_chunk)){
+			ham::logapierror("Failed to allocate region buffer");
+			result = false;
+			break;
+		}
+
+		const auto res = ham_file_read(file, ret->data() + len, ham_impl_world_streamer_read_chunk);
+		if(res == (usize)-1){
+			ham::logapierror("Failed to read region file '{}'", ham::str8(path));
+			result = false;
+			break;
+		}
+		else if(res == 0){
+			break;
+		}
+
+		len += res;
+	}
+
+	ret->resize(len);
+	ham_file_close(file);
+	return result;
+}
+
+//! Written to the side and renamed over the old file, so a failed write never leaves a truncated region behind.
+static bool ham_impl_world_streamer_write_file(ham_str8 path, const ham::basic_buffer<char> &data){
+	const ham::str_buffer8 path_buf = path;
+	const auto tmp_path = ham::format("{}.tmp", ham::str8(path));
+
+	const auto file = ham_file_open_utf8(tmp_path, HAM_OPEN_WRITE | HAM_OPEN_CREATE);
+	if(!file){
+		ham::logapierror("Failed to open region file '{}'", tmp_path);
+		return false;
+	}
+
+	usize written = 0;
+	while(written < data.size()){
+		const auto res = ham_file_write(file, data.data() + written, data.size() - written);
+		if(res == (usize)-1 || res == 0){
+			ham::logapierror("Failed to write region file '{}'", tmp_path);
+			break;
+		}
+
+		written += res;
+	}
+
+	ham_file_close(file);
+
+	if(written != data.size()){
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+	else if(std::rename(tmp_path.c_str(), path_buf.c_str()) != 0){
+		ham::logapierror("Failed to move region file '{}' into place", path_buf);
+		std::remove(tmp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+//! Hand the bytes of a failed write back to the main thread, called with `streamer->mut` held.
+static void ham_impl_world_streamer_return_unwritten(ham_world_streamer *streamer, const ham_impl_world_streamer_job &job){
+	const bool is_append = job.kind == HAM_IMPL_WORLD_STREAMER_JOB_APPEND;
+
+	streamer->io_failed = true;
+
+	auto emplace_res = streamer->unwritten.try_emplace(job.key);
+	auto &unwritten = emplace_res.first->second;
+
+	if(emplace_res.second){
+		unwritten.coord     = job.coord;
+		unwritten.is_append = is_append;
+		unwritten.data      = job.data;
+		return;
+	}
+
+	// an earlier failure nobody has restored yet, the newer bytes go after it
+	const auto old_len = unwritten.data.size();
+	if(!unwritten.data.resize(old_len + job.data.size())){
+		ham::logapierror("Failed to keep unwritten region {},{},{}, its entities are lost", job.coord.x, job.coord.y, job.coord.z);
+		return;
+	}
+
+	memcpy(unwritten.data.data() + old_len, job.data.data(), job.data.size());
+	unwritten.is_append = unwritten.is_append && is_append;
+}
+
+static ham_uptr ham_impl_world_streamer_io_main(void *user){
+	const auto streamer = (ham_world_streamer*)user;
+
+	ham::std_vector<ham_impl_world_streamer_job> jobs;
+
+	while(true){
+		{
+			ham::unique_lock lock(streamer->io_mut);
+			streamer->io_cond.wait(lock, [streamer]{ return streamer->io_quit || !streamer->io_jobs.empty(); });
+
+			// only quit once every queued write has hit the disk
+			if(streamer->io_jobs.empty()) break;
+
+			jobs.swap(streamer->io_jobs);
+		}
+
+		// jobs are processed in submission order, so a region that is evicted and requested again
+		// always has its write finish before it is read back
+
+		for(auto &&job : jobs){
+			if(job.kind != HAM_IMPL_WORLD_STREAMER_JOB_READ){
+				bool written;
+
+				if(job.kind == HAM_IMPL_WORLD_STREAMER_JOB_WRITE){
+					written = ham_impl_world_streamer_write_file(job.path, job.data);
+				}
+				else{
+					// region files are small enough to rewrite whole
+					ham::basic_buffer<char> data;
+
+					written =
+						ham_impl_world_streamer_read_file(job.path, &data) &&
+						data.resize(data.size() + job.data.size());
+
+					if(written){
+						memcpy(data.data() + data.size() - job.data.size(), job.data.data(), job.data.size());
+						written = ham_impl_world_streamer_write_file(job.path, data);
+					}
+				}
+
+				if(!written){
+					ham::logapierror("Failed to save region file '{}', its entities are restored on the next update", ham::str8(job.path));
+
+					ham::scoped_lock lock(streamer->mut);
+					ham_impl_world_streamer_return_unwritten(streamer, job);
+				}
+
+				continue;
+			}
+
+			ham::basic_buffer<char> data;
+			if(!ham_impl_world_streamer_read_file(job.path, &data)){
+				data.resize(0);
+			}
+
+			ham::scoped_lock lock(streamer->mut);
+
+			const auto region_res = streamer->regions.find(job.key);
+			if(region_res == streamer->regions.end() || region_res->second.state != HAM_IMPL_WORLD_REGION_QUEUED) continue;
+
+			// writes are processed before any later read of the same region, so bytes that failed to
+			// save are newer than whatever is on disk
+			const auto unwritten_res = streamer->unwritten.find(job.key);
+			if(unwritten_res != streamer->unwritten.end()){
+				auto &unwritten = unwritten_res->second;
+
+				// otherwise left to be restored on its own once the region is resident
+				if(!unwritten.is_append){
+					data = std::move(unwritten.data);
+					streamer->unwritten.erase(unwritten_res);
+				}
+				else if(data.resize(data.size() + unwritten.data.size())){
+					memcpy(data.data() + data.size() - unwritten.data.size(), unwritten.data.data(), unwritten.data.size());
+					streamer->unwritten.erase(unwritten_res);
+				}
+			}
+
+			region_res->second.data  = std::move(data);
+			region_res->second.state = HAM_IMPL_WORLD_REGION_READY;
+		}
+
+		{
+			ham::scoped_lock lock(streamer->io_mut);
+			streamer->io_pending -= jobs.size();
+			if(streamer->io_pending == 0) streamer->io_idle_cond.broadcast();
+		}
+
+		jobs.clear();
+	}
+
+	return 0;
+}
+
+static inline bool ham_impl_world_streamer_submit(ham_world_streamer *streamer, ham_impl_world_streamer_job job){
+	ham::scoped_lock lock(streamer->io_mut);
+
+	streamer->io_jobs.emplace_back(std::move(job));
+	++streamer->io_pending;
+
+	return streamer->io_cond.signal();
+}
+
+static inline void ham_impl_world_streamer_wait_idle(ham_world_streamer *streamer){
+	ham::unique_lock lock(streamer->io_mut);
+	streamer->io_idle_cond.wait(lock, [streamer]{ return streamer->io_pending == 0; });
+}
+
+//
+// Main thread side
+//
+
+/**
+ * Instantiate every snapshot in \p data , returning the estimated memory of the entities created.
+ * Snapshots that fail to load are copied to \p unloaded so they can be written back untouched,
+ * a region file must never lose data just because this build couldn't read part of it.
+ */
+static usize ham_impl_world_streamer_instantiate_data(
+	ham_world_streamer *streamer, ham_impl_world_region_coord coord,
+	const ham::basic_buffer<char> &data, ham::basic_buffer<char> *unloaded
+){
+	if(data.empty()) return 0;
+
+	ham::str_buffer8 path;
+	ham_impl_world_streamer_region_path(streamer, coord, &path);
+
+	const auto keep_unloaded = [&](usize offset, usize len){
+		const auto old_len = unloaded->size();
+		if(!unloaded->resize(old_len + len)){
+			ham::logapierror("Failed to keep unloaded snapshot of region {},{},{}", coord.x, coord.y, coord.z);
+			return;
+		}
+
+		memcpy(unloaded->data() + old_len, data.data() + offset, len);
+	};
+
+	usize bytes = 0;
+
+	// entities that wandered in while the region was unloaded are appended as extra snapshots
+
+	usize offset = 0;
+	while(offset < data.size()){
+		const auto len = ham_impl_world_snapshot_size(data.data() + offset, data.size() - offset);
+		if(len == (usize)-1){
+			ham::logapierror("Bad snapshot at offset {} of region {},{},{}", offset, coord.x, coord.y, coord.z);
+			keep_unloaded(offset, data.size() - offset);
+			break;
+		}
+
+		ham::basic_buffer<ham_entity*> ents;
+		const auto res = ham_impl_world_snapshot_instantiate(
+			streamer->world, path, data.data() + offset, len,
+			streamer->types.size(), streamer->types.data(),
+			&ents
+		);
+
+		if(res == (usize)-1){
+			ham::logapierror("Failed to instantiate region {},{},{}", coord.x, coord.y, coord.z);
+			keep_unloaded(offset, len);
+		}
+		else{
+			for(const auto ent : ents){
+				bytes += ham_super(ent)->vptr->info->size;
+			}
+		}
+
+		offset += len;
+	}
+
+	return bytes;
+}
+
+/**
+ * Put the entities of writes that failed back into the world.
+ * A whole region comes back resident, appended entities are restored loose and appended again on the next eviction.
+ * Bytes still waiting on a read of their region are merged by the I/O thread instead.
+ */
+static void ham_impl_world_streamer_restore_unwritten(ham_world_streamer *streamer){
+	ham::std_vector<ham_impl_world_region_unwritten> restore;
+
+	{
+		ham::scoped_lock lock(streamer->mut);
+
+		for(auto it = streamer->unwritten.begin(); it != streamer->unwritten.end();){
+			const auto region_res = streamer->regions.find(it->first);
+			if(region_res != streamer->regions.end() && region_res->second.state != HAM_IMPL_WORLD_REGION_RESIDENT){
+				++it;
+				continue;
+			}
+
+			restore.emplace_back(std::move(it->second));
+			it = streamer->unwritten.erase(it);
+		}
+	}
+
+	for(auto &&unwritten : restore){
+		const auto key = ham_impl_world_region_key(unwritten.coord);
+
+		ham::basic_buffer<char> unloaded;
+		const auto bytes = ham_impl_world_streamer_instantiate_data(streamer, unwritten.coord, unwritten.data, &unloaded);
+
+		{
+			ham::scoped_lock lock(streamer->mut);
+
+			const auto region_res = streamer->regions.find(key);
+			if(region_res != streamer->regions.end()){
+				// the region was loaded meanwhile, so the entities are saved with it
+				auto &region = region_res->second;
+				const auto old_len = region.unloaded.size();
+
+				if(region.unloaded.resize(old_len + unloaded.size())){
+					memcpy(region.unloaded.data() + old_len, unloaded.data(), unloaded.size());
+					unloaded.resize(0);
+				}
+
+				region.bytes += bytes;
+				streamer->resident_bytes += bytes;
+			}
+			else if(!unwritten.is_append){
+				streamer->regions.emplace(key, ham_impl_world_region{
+					.coord    = unwritten.coord,
+					.state    = HAM_IMPL_WORLD_REGION_RESIDENT,
+					.bytes    = bytes,
+					.data     = ham::basic_buffer<char>(),
+					.unloaded = std::move(unloaded),
+				});
+
+				streamer->resident_bytes += bytes;
+				continue;
+			}
+		}
+
+		if(unloaded.empty()) continue;
+
+		// nothing in the world holds these any more, so they go straight back to the file
+
+		ham_impl_world_streamer_job job{
+			.key   = key,
+			.coord = unwritten.coord,
+			.kind  = HAM_IMPL_WORLD_STREAMER_JOB_APPEND,
+			.path  = ham::str_buffer8(),
+			.data  = std::move(unloaded),
+		};
+
+		ham_impl_world_streamer_region_path(streamer, unwritten.coord, &job.path);
+		ham_impl_world_streamer_submit(streamer, std::move(job));
+	}
+}
+
+//! Instantiate every region the I/O thread has finished reading, returns the number of regions made resident.
+static usize ham_impl_world_streamer_instantiate_ready(ham_world_streamer *streamer){
+	ham_impl_world_streamer_restore_unwritten(streamer);
+
+	ham::std_vector<ham_u64> ready;
+
+	{
+		ham::scoped_lock lock(streamer->mut);
+		for(auto &&region_p : streamer->regions){
+			if(region_p.second.state == HAM_IMPL_WORLD_REGION_READY){
+				ready.emplace_back(region_p.first);
+			}
+		}
+	}
+
+	usize num_resident = 0;
+
+	for(const auto key : ready){
+		ham::basic_buffer<char> data;
+		ham_impl_world_region_coord coord;
+
+		{
+			ham::scoped_lock lock(streamer->mut);
+			auto &region = streamer->regions.at(key);
+			data  = std::move(region.data);
+			coord = region.coord;
+		}
+
+		ham::basic_buffer<char> unloaded;
+		const auto bytes = ham_impl_world_streamer_instantiate_data(streamer, coord, data, &unloaded);
+
+		{
+			ham::scoped_lock lock(streamer->mut);
+			auto &region = streamer->regions.at(key);
+			region.state    = HAM_IMPL_WORLD_REGION_RESIDENT;
+			region.bytes    = bytes;
+			region.unloaded = std::move(unloaded);
+		}
+
+		streamer->resident_bytes += bytes;
+		++num_resident;
+	}
+
+	return num_resident;
+}
+
+static void ham_impl_world_streamer_collect_tree(ham_entity *ent, ham::basic_buffer<ham_entity*> *ret){
+	ret->emplace_back(ent);
+
+	const auto num_children = ham_buffer_size(&ent->children) / sizeof(ham_entity*);
+	const auto children = (ham_entity**)ham_buffer_data(&ent->children);
+
+	for(usize i = 0; i < num_children; i++){
+		ham_impl_world_streamer_collect_tree(children[i], ret);
+	}
+}
+
+//! Whether \p ent is one of the streamed entity types, anything else is left alone outside of evicted regions.
+static inline bool ham_impl_world_streamer_is_streamed(const ham_world_streamer *streamer, const ham_entity *ent){
+	const auto vptr = ham_super(ent)->vptr;
+
+	for(const auto type : streamer->types){
+		if(ham_type_vptr(type) == vptr) return true;
+	}
+
+	return false;
+}
+
+/**
+ * Serialize and destroy every root entity inside the given regions, then queue the region files for writing.
+ * Entities are owned by the region containing their position at eviction time, so entities that moved
+ * between regions while resident are saved with the region they ended up in. Entities that moved into
+ * a region the streamer isn't tracking are appended to that region's file if they are of a streamed type,
+ * otherwise nothing would ever save them.
+ */
+static bool ham_impl_world_streamer_evict(ham_world_streamer *streamer, const ham::std_vector<ham_u64> &keys){
+	if(keys.empty()) return true;
+
+	const auto world = streamer->world;
+
+	struct evict_target{
+		ham_u64 key;
+		ham_impl_world_region_coord coord;
+		bool is_append;
+		ham::basic_buffer<ham_entity*> roots;
+		ham::basic_buffer<char> data;
+	};
+
+	robin_hood::unordered_flat_map<ham_u64, usize> target_idxs;
+	ham::std_vector<evict_target> targets;
+
+	{
+		ham::scoped_lock lock(streamer->mut);
+
+		for(const auto key : keys){
+			target_idxs[key] = targets.size();
+			targets.emplace_back(evict_target{ key, streamer->regions.at(key).coord, false, ham::basic_buffer<ham_entity*>(), ham::basic_buffer<char>() });
+		}
+	}
+
+	bool result = true;
+
+	{
+		ham::scoped_lock lock(world->mut, world->root_partition.mut, world->hier.mut);
+
+		// one pass over the partition buckets every root by region
+
+		{
+			ham::scoped_lock regions_lock(streamer->mut);
+
+			for(const auto ent : world->root_partition.ents){
+				if(ent->parent) continue;
+
+				const auto coord = ham_impl_world_region_coord_of(ent->transform.pos, streamer->region_size);
+				const auto key = ham_impl_world_region_key(coord);
+
+				auto target_res = target_idxs.find(key);
+				if(target_res == target_idxs.end()){
+					// regions still loading get their entities back when they become resident
+					if(streamer->regions.contains(key) || !ham_impl_world_streamer_is_streamed(streamer, ent)) continue;
+
+					target_res = target_idxs.emplace(key, targets.size()).first;
+					targets.emplace_back(evict_target{ key, coord, true, ham::basic_buffer<ham_entity*>(), ham::basic_buffer<char>() });
+				}
+
+				targets[target_res->second].roots.emplace_back(ent);
+			}
+		}
+
+		for(auto &&target : targets){
+			ham::basic_buffer<ham_entity*> ents;
+
+			for(const auto root : target.roots){
+				ham_impl_world_streamer_collect_tree(root, &ents);
+			}
+
+			if(!ham_impl_world_snapshot_serialize(world, streamer->types.size(), streamer->types.data(), ents.size(), ents.data(), &target.data)){
+				ham::logapierror("Failed to serialize world region {},{},{}", target.coord.x, target.coord.y, target.coord.z);
+
+				// keep the entities alive rather than lose them
+				target.roots.resize(0);
+				target.data.resize(0);
+				result = false;
+			}
+		}
+	}
+
+	for(auto &&target : targets){
+		if(!target.is_append){
+			ham::scoped_lock lock(streamer->mut);
+
+			const auto region_res = streamer->regions.find(target.key);
+
+			streamer->resident_bytes -= ham_min(streamer->resident_bytes, region_res->second.bytes);
+
+			if(target.data.empty()){
+				region_res->second.bytes = 0;
+			}
+			else{
+				// whatever failed to load goes back after the entities, untouched
+				const auto &unloaded = region_res->second.unloaded;
+				const auto old_len = target.data.size();
+
+				if(!target.data.resize(old_len + unloaded.size())){
+					ham::logapierror("Failed to allocate region {},{},{} for writing", target.coord.x, target.coord.y, target.coord.z);
+					region_res->second.bytes = 0;
+					target.data.resize(0);
+					result = false;
+					continue;
+				}
+
+				memcpy(target.data.data() + old_len, unloaded.data(), unloaded.size());
+				streamer->regions.erase(region_res);
+			}
+		}
+
+		if(target.data.empty()) continue;
+
+		for(const auto root : target.roots){
+			ham_entity_destroy(root);
+		}
+
+		ham_impl_world_streamer_job job{
+			.key   = target.key,
+			.coord = target.coord,
+			.kind  = target.is_append ? HAM_IMPL_WORLD_STREAMER_JOB_APPEND : HAM_IMPL_WORLD_STREAMER_JOB_WRITE,
+			.path  = ham::str_buffer8(),
+			.data  = std::move(target.data),
+		};
+
+		ham_impl_world_streamer_region_path(streamer, target.coord, &job.path);
+
+		if(!ham_impl_world_streamer_submit(streamer, std::move(job))){
+			result = false;
+		}
+	}
+
+	return result;
+}
+
+//
+// Streamer management
+//
+
+ham_world_streamer *ham_world_streamer_create(ham_world *world, ham_str8 dir, ham_f64 region_size, ham_usize num_types, const ham_type *const *types){
+	if(
+		!ham_check(world != NULL) ||
+		!ham_check(dir.ptr && dir.len) ||
+		!ham_check(region_size >= 0.0) ||
+		!ham_check(num_types == 0 || types != NULL)
+	){
+		return nullptr;
+	}
+
+	if(!ham_path_exists_utf8(dir)){
+		ham::logapierror("Region directory '{}' does not exist", ham::str8(dir));
+		return nullptr;
+	}
+
+	const auto allocator = ham_current_allocator();
+
+	const auto ret = ham_allocator_new(allocator, ham_world_streamer);
+	if(!ret){
+		ham::logapierror("Error allocating ham_world_streamer");
+		return nullptr;
+	}
+
+	ret->allocator       = allocator;
+	ret->world           = world;
+	ret->dir             = dir;
+	ret->region_size     = region_size > 0.0 ? region_size : world->root_partition.length;
+	ret->prefetch_radius = ret->region_size;
+	ret->budget          = ham_impl_world_streamer_default_budget;
+	ret->resident_bytes  = 0;
+	ret->io_pending      = 0;
+	ret->io_quit         = false;
+	ret->io_failed       = false;
+
+	ret->types.assign(types, types + num_types);
+
+	ret->io_thread = ham_thread_create(ham_impl_world_streamer_io_main, ret);
+	if(!ret->io_thread){
+		ham::logapierror("Failed to create region I/O thread");
+		ham_allocator_delete(allocator, ret);
+		return nullptr;
+	}
+
+	ham_thread_set_name(ret->io_thread, HAM_LIT("ham-world-io"));
+
+	return ret;
+}
+
+void ham_world_streamer_destroy(ham_world_streamer *streamer){
+	if(ham_unlikely(!streamer)) return;
+
+	// drain every queued job before the thread goes away, writes may hold the only copy of evicted entities
+	ham_impl_world_streamer_wait_idle(streamer);
+
+	// and anything that failed to write goes back in the world rather than vanishing with the streamer
+	ham_impl_world_streamer_restore_unwritten(streamer);
+	ham_impl_world_streamer_wait_idle(streamer);
+
+	{
+		ham::scoped_lock lock(streamer->io_mut);
+		streamer->io_quit = true;
+		streamer->io_cond.signal();
+	}
+
+	ham_thread_destroy(streamer->io_thread);
+
+	ham_allocator_delete(streamer->allocator, streamer);
+}
+
+bool ham_world_streamer_set_budget(ham_world_streamer *streamer, ham_usize max_bytes){
+	if(!ham_check(streamer != NULL)) return false;
+	streamer->budget = max_bytes;
+	return true;
+}
+
+bool ham_world_streamer_set_prefetch_radius(ham_world_streamer *streamer, ham_f64 radius){
+	if(!ham_check(streamer != NULL) || !ham_check(radius >= 0.0)) return false;
+	streamer->prefetch_radius = radius;
+	return true;
+}
+
+ham_usize ham_world_streamer_resident_bytes(const ham_world_streamer *streamer){
+	if(!ham_check(streamer != NULL)) return (usize)-1;
+	return streamer->resident_bytes;
+}
+
+ham_usize ham_world_streamer_update(ham_world_streamer *streamer, ham_usize num_pois, const ham_vec3 *pois){
+	if(!ham_check(streamer != NULL) || !ham_check(num_pois == 0 || pois != NULL)) return (usize)-1;
+
+	const auto num_resident = ham_impl_world_streamer_instantiate_ready(streamer);
+
+	const auto region_size = streamer->region_size;
+	const auto radius      = streamer->prefetch_radius;
+	const auto radius2     = radius * radius;
+
+	// every region within the prefetch radius of a point of interest, keyed to its nearest distance
+
+	struct wanted_region{
+		ham_u64 key;
+		ham_impl_world_region_coord coord;
+		ham_f64 dist2;
+	};
+
+	robin_hood::unordered_flat_map<ham_u64, usize> wanted_idxs;
+	ham::std_vector<wanted_region> wanted;
+
+	for(usize i = 0; i < num_pois; i++){
+		const auto poi = pois[i];
+
+		const auto lo = ham_impl_world_region_coord_of(ham_make_vec3(poi.x - radius, poi.y - radius, poi.z - radius), region_size);
+		const auto hi = ham_impl_world_region_coord_of(ham_make_vec3(poi.x + radius, poi.y + radius, poi.z + radius), region_size);
+
+		for(ham_i32 z = lo.z; z <= hi.z; z++)
+		for(ham_i32 y = lo.y; y <= hi.y; y++)
+		for(ham_i32 x = lo.x; x <= hi.x; x++){
+			const ham_impl_world_region_coord coord{ x, y, z };
+
+			const auto dist2 = ham_impl_world_region_dist2(coord, poi, region_size);
+			if(dist2 > radius2) continue;
+
+			const auto key = ham_impl_world_region_key(coord);
+
+			const auto emplace_res = wanted_idxs.try_emplace(key, wanted.size());
+			if(emplace_res.second){
+				wanted.emplace_back(wanted_region{ key, coord, dist2 });
+			}
+			else{
+				auto &w = wanted[emplace_res.first->second];
+				w.dist2 = ham_min(w.dist2, dist2);
+			}
+		}
+	}
+
+	std::sort(wanted.begin(), wanted.end(), [](const wanted_region &a, const wanted_region &b){ return a.dist2 < b.dist2; });
+
+	// over budget: evict resident regions nobody wants any more, farthest first
+	// regions within the prefetch radius are never evicted, we just stop prefetching more of them
+
+	if(streamer->resident_bytes > streamer->budget && num_pois > 0){
+		struct evict_candidate{
+			ham_u64 key;
+			ham_usize bytes;
+			ham_f64 dist2;
+		};
+
+		ham::std_vector<evict_candidate> candidates;
+
+		{
+			ham::scoped_lock lock(streamer->mut);
+
+			for(auto &&region_p : streamer->regions){
+				const auto &region = region_p.second;
+				if(region.state != HAM_IMPL_WORLD_REGION_RESIDENT || wanted_idxs.contains(region_p.first)) continue;
+
+				ham_f64 dist2 = HUGE_VAL;
+				for(usize i = 0; i < num_pois; i++){
+					dist2 = ham_min(dist2, ham_impl_world_region_dist2(region.coord, pois[i], region_size));
+				}
+
+				candidates.emplace_back(evict_candidate{ region_p.first, region.bytes, dist2 });
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const evict_candidate &a, const evict_candidate &b){ return a.dist2 > b.dist2; });
+
+		ham::std_vector<ham_u64> evict_keys;
+
+		usize remaining = streamer->resident_bytes;
+		for(const auto &candidate : candidates){
+			if(remaining <= streamer->budget) break;
+			evict_keys.emplace_back(candidate.key);
+			remaining -= ham_min(remaining, candidate.bytes);
+		}
+
+		if(!ham_impl_world_streamer_evict(streamer, evict_keys)){
+			ham::logapierror("Failed to evict world regions");
+		}
+	}
+
+	// queue loads nearest first; regions containing a point of interest always load
+
+	{
+		ham::scoped_lock lock(streamer->mut);
+
+		for(const auto &w : wanted){
+			if(streamer->regions.contains(w.key)) continue;
+			else if(w.dist2 > 0.0 && streamer->resident_bytes >= streamer->budget) break;
+
+			streamer->regions.emplace(w.key, ham_impl_world_region{
+				.coord    = w.coord,
+				.state    = HAM_IMPL_WORLD_REGION_QUEUED,
+				.bytes    = 0,
+				.data     = ham::basic_buffer<char>(),
+				.unloaded = ham::basic_buffer<char>(),
+			});
+
+			ham_impl_world_streamer_job job{
+				.key   = w.key,
+				.coord = w.coord,
+				.kind  = HAM_IMPL_WORLD_STREAMER_JOB_READ,
+				.path  = ham::str_buffer8(),
+				.data  = ham::basic_buffer<char>(),
+			};
+
+			ham_impl_world_streamer_region_path(streamer, w.coord, &job.path);
+
+			if(!ham_impl_world_streamer_submit(streamer, std::move(job))){
+				streamer->regions.erase(w.key);
+			}
+		}
+	}
+
+	return num_resident;
+}
+
+bool ham_world_streamer_flush(ham_world_streamer *streamer){
+	if(!ham_check(streamer != NULL)) return false;
+
+	// finish any reads in flight so their regions can be written back too
+
+	ham_impl_world_streamer_wait_idle(streamer);
+	ham_impl_world_streamer_instantiate_ready(streamer);
+
+	ham::std_vector<ham_u64> keys;
+
+	{
+		ham::scoped_lock lock(streamer->mut);
+
+		streamer->io_failed = false;
+
+		for(auto &&region_p : streamer->regions){
+			keys.emplace_back(region_p.first);
+		}
+	}
+
+	bool result = ham_impl_world_streamer_evict(streamer, keys);
+
+	ham_impl_world_streamer_wait_idle(streamer);
+
+	{
+		ham::scoped_lock lock(streamer->mut);
+		if(streamer->io_failed) result = false;
+	}
+
+	return result;
+}
+
+HAM_C_API_END
@@ -54,6 +54,13 @@ struct ham_entity_component_vtable{
 	ham_derive(ham_object_vtable)
 
 	void(*update)(ham_entity_component *self, ham_f64 dt);
+
+	/**
+	 * @brief Rebuild runtime state of a component loaded from a snapshot, may be `NULL`.
+	 * Called instead of the constructor once the stored members are written over zeroed memory.
+	 * Types without it are restored from their stored members alone.
+	 */
+	bool(*restore)(ham_entity_component *self);
 };
 
 ham_engine_api ham_entity_component *ham_entity_component_vcreate(ham_entity *ent, const ham_entity_component_vtable *comp_vptr, ham_u32 nargs, va_list va);
@@ -92,12 +99,23 @@ struct ham_entity{
 
 	//! @brief Buffer of `ham_entity_component*`.
 	ham_buffer components;
+
+	//! @cond ignore
+	ham_u32 _impl_hier_idx;
+	//! @endcond
 };
 
 struct ham_entity_vtable{
 	ham_derive(ham_object_vtable)
 
 	void(*tick)(ham_entity *self, ham_f64 dt);
+
+	/**
+	 * @brief Rebuild runtime state of an entity loaded from a snapshot, may be `NULL`.
+	 * Called instead of the constructor once the stored members and hierarchy are in place.
+	 * Types without it are restored from their stored members alone.
+	 */
+	bool(*restore)(ham_entity *self);
 };
 
 HAM_C_API_END
@@ -29,23 +29,75 @@
 
 #include "ham/renderer.h"
 
+typedef struct ham_world ham_world;
+
 HAM_C_API_BEGIN
 
+//! Draw group handle of a component that isn't drawn.
+#define HAM_WORLD_DRAW_GROUP_NONE ((ham_u32)-1)
+
+/**
+ * @brief Add a draw group to a world so draw instance components can refer to it.
+ * Components store the returned handle rather than the group pointer, so they stay valid across snapshots
+ * as long as groups are added to each world in the same order.
+ * @param world world to add the group to
+ * @param group group to add
+ * @returns handle of the group, the existing handle if it was already added, or `HAM_WORLD_DRAW_GROUP_NONE` on error
+ */
+ham_engine_api ham_u32 ham_world_add_draw_group(ham_world *world, ham_draw_group *group);
+
+/**
+ * @brief Remove a draw group from a world, must be called before the group is destroyed.
+ * Components using it are no longer synced. The handle is never given to another group.
+ * @param world world to remove the group from
+ * @param group handle of the group to remove
+ * @returns whether the group was removed
+ */
+ham_engine_api bool ham_world_remove_draw_group(ham_world *world, ham_u32 group);
+
 ham_declare_object(ham_entity_component_draw_instance, ham_entity_component)
 
+/**
+ * @brief Keeps a single draw group instance at the world transform of its entity.
+ * Created with `ham_entity_component_create(ent, vptr, group, id)` where `group` is a handle from \ref ham_world_add_draw_group .
+ * \ref id and \ref group must only be changed through \ref ham_entity_component_draw_instance_set .
+ */
 struct ham_entity_component_draw_instance{
 	ham_derive(ham_entity_component)
 
 	ham_u32 id;
-	ham_draw_group *group;
+	ham_u32 group; //!< handle from \ref ham_world_add_draw_group or `HAM_WORLD_DRAW_GROUP_NONE`
+
+	//! @cond ignore
+	bool _impl_dirty;
+	//! @endcond
 };
 
 struct ham_entity_component_draw_instance_vtable{
 	ham_derive(ham_entity_component_vtable)
-
-	// TODO: draw instance component functions
 };
 
+ham_expose_object_vptr(ham_entity_component_draw_instance)
+
+/**
+ * @brief Move a draw instance component to another instance.
+ * The new instance gets the entity transform on the next \ref ham_world_sync_draw_instances .
+ * @param comp component to modify
+ * @param group handle of the new draw group or `HAM_WORLD_DRAW_GROUP_NONE`
+ * @param id new instance index within \p group
+ * @returns whether the component was successfully moved
+ */
+ham_engine_api bool ham_entity_component_draw_instance_set(ham_entity_component_draw_instance *comp, ham_u32 group, ham_u32 id);
+
+/**
+ * @brief Write the world matrices of every changed draw instance in a world to their draw groups.
+ * Should be called once per frame after \ref ham_world_update_transforms .
+ * Each group is written in place in a single pass in instance order, instances whose entity didn't move are skipped.
+ * @param world world to sync
+ * @returns number of instances written or `(ham_usize)-1` on error
+ */
+ham_engine_api ham_usize ham_world_sync_draw_instances(ham_world *world);
+
 HAM_C_API_END
 
 /**
@@ -29,13 +29,123 @@
 
 #include "ham/shape.h"
 #include "ham/image.h"
+#include "ham/fs.h"
 
 HAM_C_API_BEGIN
 
 typedef struct ham_model ham_model;
 
+/**
+ * @defgroup HAM_ENGINE_MODEL_COOKED Cooked models
+ * @{
+ * A model as it is used at runtime, laid out so it can be mapped from disk and used in place.
+ *
+ * A cooked model starts with a `ham_model_cooked_header`. Every offset in it is counted from
+ * the start of the header and aligned to `HAM_MODEL_COOKED_ALIGNMENT`. Each shape keeps its
+ * vertex streams in separate arrays of `num_points` elements, followed by its indices and bones.
+ * All values are little endian.
+ */
+
+#define HAM_MODEL_COOKED_MAGIC "HAMMODL"
+#define HAM_MODEL_COOKED_VERSION 1
+#define HAM_MODEL_COOKED_ALIGNMENT 16
+
+//! Index used by cooked shapes and materials to refer to nothing.
+#define HAM_MODEL_COOKED_NONE ((ham_u32)-1)
+
+typedef struct ham_model_cooked_header{
+	char magic[8]; //!< `HAM_MODEL_COOKED_MAGIC`
+	ham_u32 version; //!< `HAM_MODEL_COOKED_VERSION`
+	ham_u32 reserved0;
+	ham_u64 size; //!< size of the whole cooked model in bytes
+	ham_u32 num_shapes, num_images, num_materials;
+	ham_u32 reserved1;
+	ham_u64 shapes_off; //!< array of `num_shapes` `ham_model_cooked_shape`
+	ham_u64 images_off; //!< array of `num_images` `ham_model_cooked_image`
+	ham_u64 materials_off; //!< array of `num_materials` `ham_model_cooked_material`
+} ham_model_cooked_header;
+
+typedef struct ham_model_cooked_shape{
+	ham_u32 num_points, num_indices;
+	ham_u32 num_bones; //!< always at least 1
+	ham_u32 material; //!< index into the materials or `HAM_MODEL_COOKED_NONE`
+	ham_u64 verts_off, norms_off, uvs_off;
+	ham_u64 bone_indices_off, bone_weights_off;
+	ham_u64 indices_off, bones_off;
+} ham_model_cooked_shape;
+
+typedef struct ham_model_cooked_image{
+	ham_u32 format; //!< `HAM_COLOR_FORMAT_COUNT` for images that couldn't be loaded
+	ham_u32 w, h;
+	ham_u32 reserved;
+	ham_u64 pixels_off;
+} ham_model_cooked_image;
+
+typedef struct ham_model_cooked_material{
+	ham_shape_material params;
+	ham_u32 albedo_image, normal_image; //!< index into the images or `HAM_MODEL_COOKED_NONE`
+	ham_u32 reserved[2];
+} ham_model_cooked_material;
+
+typedef ham_usize(*ham_model_write_fn)(ham_usize len, const void *bytes, void *user);
+
+/**
+ * Import a model with Assimp and write out its cooked form.
+ * @param len size of \p data in bytes
+ * @param data model file contents
+ * @param write_fn called with consecutive pieces of the cooked model, must return the number of bytes written
+ * @param user passed to \p write_fn
+ * @returns number of bytes written or ``(ham_usize)-1`` on error
+ */
+ham_engine_api ham_usize ham_model_cook(ham_usize len, const void *data, ham_model_write_fn write_fn, void *user);
+
+/**
+ * Load a cooked model in place without copying anything.
+ * @param len size of \p data in bytes
+ * @param data cooked model aligned to `HAM_MODEL_COOKED_ALIGNMENT`, must outlive the model
+ * @returns newly created model or ``NULL`` on error
+ */
+ham_engine_api ham_model *ham_model_load_cooked(ham_usize len, const void *data);
+
+//! Check whether some memory holds a cooked model of the current version.
+ham_engine_api ham_nothrow bool ham_model_is_cooked(ham_usize len, const void *data);
+
+/**
+ * @}
+ */
+
+/**
+ * Load a model from a file.
+ * Cooked models are mapped and used in place, anything else is imported like `ham_model_load_with_deps` does.
+ */
 ham_engine_api ham_model *ham_model_load(ham_str8 filepath);
 
+/**
+ * Called with the full path of each file a model depends on.
+ * @param path path of the file, it may not exist
+ * @param user user data passed to `ham_model_load_with_deps`
+ */
+typedef void(*ham_model_dep_fn)(ham_str8 path, void *user);
+
+/**
+ * Load a model from a file and report the other files it depends on.
+ * Models are imported from their real path, so the files they name such as OBJ material libraries and
+ * textures are found next to them. Every file the importer looks for is a dependency, including ones
+ * that weren't there, and the contents of each are part of the key the cooked model is cached under.
+ * Textures that aren't embedded are loaded and cooked into the model.
+ * @param filepath path of the model
+ * @param dep_fn called for every dependency of a loaded model, may be ``NULL``
+ * @param user passed to \p dep_fn
+ * @param key_ret where to write the key of the cache entry holding the cooked model, zeroed if the model wasn't cached; may be ``NULL``
+ * @returns newly created model or ``NULL`` on error
+ */
+ham_engine_api ham_model *ham_model_load_with_deps(ham_str8 filepath, ham_model_dep_fn dep_fn, void *user, ham_asset_key *key_ret);
+
+/**
+ * Load a model from memory.
+ * Cooked models are copied in one go, anything else is imported with Assimp unless the asset cache
+ * already holds its cooked form. There is no directory to look in, so files the model names aren't loaded.
+ */
 ham_engine_api ham_model *ham_model_load_from_mem(ham_usize len, const void *data);
 
 ham_engine_api ham_nothrow void ham_model_destroy(ham_model *mdl);
@@ -44,6 +154,13 @@ ham_engine_api ham_nothrow ham_usize ham_model_num_shapes(const ham_model *mdl);
 ham_engine_api ham_nothrow const ham_shape *const *ham_model_shapes(const ham_model *mdl);
 ham_engine_api ham_nothrow const ham_image *const *ham_model_images(const ham_model *mdl);
 
+ham_engine_api ham_nothrow ham_usize ham_model_num_images(const ham_model *mdl);
+ham_engine_api ham_nothrow ham_usize ham_model_num_materials(const ham_model *mdl);
+ham_engine_api ham_nothrow const ham_model_cooked_material *ham_model_materials(const ham_model *mdl);
+
+//! Get the index of the material used by a shape or `HAM_MODEL_COOKED_NONE`.
+ham_engine_api ham_nothrow ham_u32 ham_model_shape_material(const ham_model *mdl, ham_usize shape_idx);
+
 ham_engine_api void ham_model_fill_blank_images(ham_model *mdl, const ham_image *img);
 
 HAM_C_API_END
@@ -79,8 +196,15 @@ namespace ham{
 
 			usize num_shapes() const noexcept{ return ham_model_num_shapes(m_handle.get()); }
 			const ham_shape *const *shapes() const noexcept{ return ham_model_shapes(m_handle.get()); }
+
+			usize num_images() const noexcept{ return ham_model_num_images(m_handle.get()); }
 			const ham_image *const *images() const noexcept{ return ham_model_images(m_handle.get()); }
 
+			usize num_materials() const noexcept{ return ham_model_num_materials(m_handle.get()); }
+			const ham_model_cooked_material *materials() const noexcept{ return ham_model_materials(m_handle.get()); }
+
+			u32 shape_material(usize shape_idx) const noexcept{ return ham_model_shape_material(m_handle.get(), shape_idx); }
+
 			void fill_blank_images(const ham_image *img){ ham_model_fill_blank_images(m_handle.get(), img); }
 
 		private:
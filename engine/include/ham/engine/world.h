@@ -31,6 +31,8 @@
 
 #include "entity.h"
 
+#include "ham/typesys.h"
+
 HAM_C_API_BEGIN
 
 typedef struct ham_world ham_world;
@@ -59,6 +61,169 @@ ham_used static inline ham_entity *ham_impl_entity_create(ham_world *world, cons
 #define ham_entity_create(world, ent_vt, ...) \
 	ham_impl_entity_create((world), (ent_vt), HAM_NARGS(__VA_ARGS__) __VA_OPT__(,) __VA_ARGS__)
 
+/**
+ * @brief Re-parent an entity within its world.
+ * @param ent entity to re-parent
+ * @param parent new parent or `NULL` to make \p ent a root entity
+ * @returns whether the entity was successfully re-parented
+ */
+ham_engine_api bool ham_entity_set_parent(ham_entity *ent, ham_entity *parent);
+
+/**
+ * @brief Get the world matrix of an entity.
+ * The value is only as fresh as the last call to \ref ham_world_update_transforms .
+ * @param ent entity to get the world matrix of
+ * @returns composed world matrix of \p ent
+ */
+ham_engine_api ham_mat4 ham_entity_world_matrix(const ham_entity *ent);
+
+/**
+ * @defgroup HAM_ENGINE_WORLD_TRANSFORMS Transform hierarchy
+ * The accessors below hand out the hierarchy arrays directly and take no lock,
+ * only call them from the thread that creates entities and calls \ref ham_world_update_transforms .
+ * The returned pointers are invalidated by the next update or entity creation.
+ * @{
+ */
+
+/**
+ * @brief Recompute the world matrices of every dirty subtree in a world.
+ * Entities are stored in parent-before-child order so this is a single linear pass over contiguous arrays.
+ * @param world world to update
+ * @returns number of world matrices that were recomputed or `(ham_usize)-1` on error
+ */
+ham_engine_api ham_usize ham_world_update_transforms(ham_world *world);
+
+//! Number of entries in the hierarchy arrays; some entries may be `NULL` entities until the next update.
+ham_engine_api ham_usize ham_world_num_transforms(const ham_world *world);
+
+//! Entities in hierarchy order, parallel to \ref ham_world_transform_matrices .
+ham_engine_api ham_entity *const *ham_world_transform_entities(const ham_world *world);
+
+//! World matrices in hierarchy order.
+ham_engine_api const ham_mat4 *ham_world_transform_matrices(const ham_world *world);
+
+//! Non-zero entries for every world matrix that changed in the last update.
+ham_engine_api const ham_u8 *ham_world_transform_changes(const ham_world *world);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup HAM_ENGINE_WORLD_SNAPSHOTS Snapshots
+ * @{
+ */
+
+/**
+ * @brief Write a binary snapshot of every entity in a world.
+ * Entity transforms and parents are stored column-wise per entity type, followed by every component.
+ * Everything after the `ham_entity` or `ham_entity_component` base of an object is encoded with \ref ham_type_serialize
+ * using the object type in \p types whose vtable matches. Members of those types start at the first suitably aligned byte after the base.
+ * @param world world to snapshot
+ * @param path file to write, created or truncated as required
+ * @param num_types number of types in \p types
+ * @param types object types describing every entity and component type in \p world
+ * @returns whether the snapshot was successfully written
+ */
+ham_engine_api bool ham_world_save_snapshot(ham_world *world, ham_str8 path, ham_usize num_types, const ham_type *const *types);
+
+/**
+ * @brief Load the entities from a snapshot into a world.
+ * Stored types are matched against the vtables of \p types by `type_id`, every type in the snapshot must be present with the same layout.
+ * Objects are not constructed: their stored members are decoded into zeroed memory and strings are interned,
+ * then the `restore` hook of their vtable is called if it has one. Destructors of stored types must accept
+ * an object whose restore hook never ran, which happens when loading fails part way.
+ * @param world world to load entities into
+ * @param path snapshot file to load
+ * @param num_types number of types in \p types
+ * @param types object types that may appear in the snapshot
+ * @returns number of entities loaded or `(ham_usize)-1` on error
+ */
+ham_engine_api ham_usize ham_world_load_snapshot(ham_world *world, ham_str8 path, ham_usize num_types, const ham_type *const *types);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup HAM_ENGINE_WORLD_STREAMING Region streaming
+ * @{
+ */
+
+/**
+ * @brief Pages regions of a world in and out of memory around points of interest.
+ * Regions are cubes on a fixed grid, each stored as a snapshot file. All file I/O happens on a background thread;
+ * entities are only created and destroyed from \ref ham_world_streamer_update .
+ */
+typedef struct ham_world_streamer ham_world_streamer;
+
+/**
+ * @brief Create a region streamer for a world.
+ * Every root entity is owned by the region containing its position, children are stored with their root.
+ * Streamed entities that move into a region that isn't loaded are added to that region's file on the next eviction.
+ * @param world world to stream regions into
+ * @param dir existing directory containing the region files
+ * @param region_size side length of each region or `0` to use the length of the root world partition
+ * @param num_types number of types in \p types
+ * @param types object types of every entity and component that may be stored in region files, see \ref ham_world_save_snapshot
+ * @returns newly created streamer or `NULL` on error
+ */
+ham_engine_api ham_world_streamer *ham_world_streamer_create(ham_world *world, ham_str8 dir, ham_f64 region_size, ham_usize num_types, const ham_type *const *types);
+
+/**
+ * @brief Destroy a region streamer.
+ * Waits for every queued read and write to finish, resident regions are left in the world.
+ * Entities whose region could not be written are put back in the world too.
+ * @param streamer streamer to destroy
+ */
+ham_engine_api void ham_world_streamer_destroy(ham_world_streamer *streamer);
+
+/**
+ * @brief Set the memory budget for resident regions.
+ * Regions outside the prefetch radius are evicted when the budget is exceeded and no more regions are prefetched,
+ * regions containing a point of interest are always loaded.
+ * @param streamer streamer to modify
+ * @param max_bytes budget in bytes of entity memory
+ * @returns whether the budget was set
+ */
+ham_engine_api bool ham_world_streamer_set_budget(ham_world_streamer *streamer, ham_usize max_bytes);
+
+/**
+ * @brief Set how far around each point of interest regions are loaded.
+ * @param streamer streamer to modify
+ * @param radius distance from a point of interest to the closest point of a region
+ * @returns whether the radius was set
+ */
+ham_engine_api bool ham_world_streamer_set_prefetch_radius(ham_world_streamer *streamer, ham_f64 radius);
+
+//! Estimated bytes of entity memory currently owned by resident regions.
+ham_engine_api ham_usize ham_world_streamer_resident_bytes(const ham_world_streamer *streamer);
+
+/**
+ * @brief Advance region streaming by one tick.
+ * Instantiates regions finished loading since the last update, evicts regions if over budget
+ * then queues loads for regions around \p pois nearest first. Never blocks on file I/O.
+ * @param streamer streamer to update
+ * @param num_pois number of points in \p pois
+ * @param pois points of interest, e.g. player or camera positions
+ * @returns number of regions that became resident or `(ham_usize)-1` on error
+ */
+ham_engine_api ham_usize ham_world_streamer_update(ham_world_streamer *streamer, ham_usize num_pois, const ham_vec3 *pois);
+
+/**
+ * @brief Write every resident region back to disk and remove its entities from the world.
+ * Blocks until all region I/O has finished. Region files are replaced atomically, so a failed write leaves the old file intact
+ * and the region's entities are restored into the world on the next \ref ham_world_streamer_update .
+ * Snapshots in a region file that fail to load are kept and written back unchanged.
+ * @param streamer streamer to flush
+ * @returns whether every region was written
+ */
+ham_engine_api bool ham_world_streamer_flush(ham_world_streamer *streamer);
+
+/**
+ * @}
+ */
+
 HAM_C_API_END
 
 #ifdef __cplusplus
@@ -619,9 +619,11 @@ namespace ham{
 
 			template<mutex_kind Kind, typename CheckFn>
 			bool wait(unique_lock<basic_mutex<Kind>> &lock, CheckFn &&check_fn){
-				bool wait_res = false;
-				while((wait_res = wait(lock)) && !check_fn()){}
-				return wait_res;
+				while(!check_fn()){
+					if(!wait(lock)) return false;
+				}
+
+				return true;
 			}
 
 		private:
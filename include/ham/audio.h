@@ -26,6 +26,7 @@
  */
 
 #include "math.h"
+#include "fs.h"
 
 HAM_C_API_BEGIN
 
@@ -46,6 +47,15 @@ typedef enum ham_audio_sample_format{
 typedef struct ham_audio_data ham_audio_data;
 
 ham_api ham_audio_data *ham_audio_data_load(ham_usize len, const void *data);
+
+/**
+ * Get the key decoded audio is stored under in the asset cache.
+ * @param len size of the source
+ * @param data source contents
+ * @returns key of the cooked audio
+ */
+ham_api ham_nothrow ham_asset_key ham_audio_data_cache_key(ham_usize len, const void *data);
+
 ham_api void ham_audio_data_destroy(ham_audio_data *data);
 
 ham_api ham_usize ham_audio_data_size(const ham_audio_data *data);
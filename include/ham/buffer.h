@@ -42,7 +42,7 @@ struct ham_buffer{
 #define HAM_EMPTY_BUFFER ((ham_buffer){ ham_null, ham_null, 0, 0, 0 })
 
 ham_used ham_constexpr static inline ham_u32 ham_bit_ceil32(ham_u32 x){ return x == 1 ? 1 : 1 << (32UL - ham_lzcnt32(x - 1UL)); }
-ham_used ham_constexpr static inline ham_u64 ham_bit_ceil64(ham_u64 x){ return x == 1 ? 1 : 1 << (64UL - ham_lzcnt64(x - 1UL)); }
+ham_used ham_constexpr static inline ham_u64 ham_bit_ceil64(ham_u64 x){ return x == 1 ? 1 : (ham_u64)1 << (64UL - ham_lzcnt64(x - 1UL)); }
 //! @endcond
 
 static inline bool ham_buffer_init_allocator(ham_buffer *buf, const ham_allocator *allocator, ham_usize alignment, ham_usize initial_capacity){
@@ -125,6 +125,7 @@ static inline bool ham_buffer_reserve(ham_buffer *buf, ham_usize req_size){
 	ham_allocator_free(buf->allocator, buf->mem);
 
 	buf->mem = new_mem;
+	buf->capacity = req_size;
 	return true;
 }
 
@@ -181,7 +182,7 @@ static inline bool ham_buffer_insert(ham_buffer *buf, ham_usize offset, const vo
 	char *const it_end = it + len;
 
 	if(rem > 0){
-		memcpy(it_end, it, rem);
+		memmove(it_end, it, rem);
 	}
 
 	memcpy(it, data, len);
@@ -359,6 +360,9 @@ namespace ham{
 
 			const ham_allocator *allocator() const noexcept{ return ham_buffer_allocator(&m_buf); }
 
+			ham_buffer *handle() noexcept{ return &m_buf; }
+			const ham_buffer *handle() const noexcept{ return &m_buf; }
+
 			bool resize(usize new_size) noexcept(noexcept(value_type())){
 				if(new_size == size()){
 					return true;
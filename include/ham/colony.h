@@ -38,6 +38,15 @@ ham_api ham_nothrow void ham_colony_destroy(ham_colony *colony);
 
 ham_api void *ham_colony_emplace(ham_colony *colony);
 
+/**
+ * @brief Emplace \p n elements while taking the colony lock once.
+ * @param colony colony to emplace into
+ * @param n number of elements to emplace
+ * @param ret array of at least \p n pointers receiving the new elements
+ * @returns whether every element was emplaced, nothing is emplaced on failure
+ */
+ham_api bool ham_colony_emplace_n(ham_colony *colony, ham_usize n, void **ret);
+
 ham_api ham_nothrow bool ham_colony_erase(ham_colony *colony, void *ptr);
 
 ham_api ham_nothrow bool ham_colony_contains(const ham_colony *colony, const void *ptr);
@@ -123,7 +132,7 @@ namespace ham{
 			}
 
 			bool erase(T *ptr) noexcept{
-				return ham_colony_view_erase(m_handle.get(), ptr, [](void *ptr, void*){ std::destroy_at((T*)ptr); }, nullptr);
+				return ham_colony_view_erase(m_handle.get(), ptr, [](void *ptr, void*){ std::destroy_at((T*)ptr); return true; }, nullptr);
 			}
 
 			bool compact() noexcept{ return ham_colony_compact(m_handle.get()); }
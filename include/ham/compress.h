@@ -0,0 +1,67 @@
+/*
+ * Ham Runtime
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAM_COMPRESS_H
+#define HAM_COMPRESS_H 1
+
+/**
+ * @defgroup HAM_COMPRESS Compression
+ * @ingroup HAM
+ * Fast byte compression in the LZ4 block format, so data written here can be read by any LZ4 implementation and vice versa.
+ * Blocks carry no header; the caller keeps track of the compressed and decompressed sizes.
+ * @{
+ */
+
+#include "typedefs.h"
+
+HAM_C_API_BEGIN
+
+/**
+ * @brief Get the largest size \p len bytes can compress to.
+ */
+ham_constexpr ham_nothrow static inline ham_usize ham_lz4_compress_bound(ham_usize len){
+	return len + (len / 255) + 16;
+}
+
+/**
+ * @brief Compress bytes into a single LZ4 block.
+ * @param len number of bytes to compress, at most 2GiB
+ * @param src bytes to compress
+ * @param dst_cap size of \p dst, `ham_lz4_compress_bound(len)` is always enough
+ * @param dst where to write the compressed block
+ * @returns size of the compressed block or `0` if it didn't fit in \p dst_cap bytes
+ */
+ham_api ham_nothrow ham_usize ham_lz4_compress(ham_usize len, const void *src, ham_usize dst_cap, void *dst);
+
+/**
+ * @brief Decompress a single LZ4 block.
+ * @param len size of the compressed block
+ * @param src compressed block
+ * @param dst_cap size of \p dst
+ * @param dst where to write the decompressed bytes
+ * @returns number of bytes written or `(ham_usize)-1` if the block is malformed or doesn't fit in \p dst_cap bytes
+ */
+ham_api ham_nothrow ham_usize ham_lz4_decompress(ham_usize len, const void *src, ham_usize dst_cap, void *dst);
+
+HAM_C_API_END
+
+/**
+ * @}
+ */
+
+#endif // !HAM_COMPRESS_H
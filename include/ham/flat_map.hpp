@@ -0,0 +1,672 @@
+/*
+ * Ham Runtime
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAM_FLAT_MAP_HPP
+#define HAM_FLAT_MAP_HPP 1
+
+/**
+ * @defgroup HAM_FLAT_MAP Flat hash map
+ * Open-addressing hash map in the style of <a href="https://abseil.io/about/design/swisstables">Swiss tables</a>.
+ * @ingroup HAM
+ * @{
+ */
+
+#include "hash.h"
+#include "memory.h"
+
+#include <bit>
+#include <utility>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#	include <arm_neon.h>
+#endif
+
+namespace ham{
+	class flat_map_alloc_error: public exception{
+		public:
+			const char *api() const noexcept override{ return "ham::flat_map"; }
+			const char *what() const noexcept override{ return "Error allocating flat_map storage"; }
+	};
+
+	/**
+	 * @brief Default hasher of `ham::flat_map`.
+	 * String-like keys are hashed through a ``str8`` view so they may be looked up by any other string-like type.
+	 */
+	template<typename Key, typename = void>
+	struct flat_hash: hash_functor<Key>{};
+
+	template<typename Key>
+	struct flat_hash<Key, std::enable_if_t<std::is_integral_v<Key> || std::is_enum_v<Key> || std::is_pointer_v<Key>>>{
+		constexpr u64 operator()(Key key) const noexcept{
+			u64 bits;
+			if constexpr(std::is_pointer_v<Key>) bits = (u64)(uptr)key;
+			else bits = (u64)key;
+
+			return ham_impl_hash_mix(bits ^ HAM_HASH_FAST_SECRET_0, HAM_HASH_FAST_SECRET_1);
+		}
+	};
+
+	template<typename Key>
+	struct flat_hash<Key, std::enable_if_t<std::is_convertible_v<const Key&, str8> && !std::is_pointer_v<Key>>>{
+		using is_transparent = void;
+
+		constexpr u64 operator()(str8 key) const noexcept{ return hash_fast(key); }
+	};
+
+	/**
+	 * @brief Default key comparison of `ham::flat_map`, transparent for string-like keys.
+	 */
+	template<typename Key, typename = void>
+	struct flat_equal{
+		constexpr bool operator()(const Key &a, const Key &b) const noexcept(noexcept(a == b)){ return a == b; }
+	};
+
+	template<typename Key>
+	struct flat_equal<Key, std::enable_if_t<std::is_convertible_v<const Key&, str8> && !std::is_pointer_v<Key>>>{
+		using is_transparent = void;
+
+		constexpr bool operator()(str8 a, str8 b) const noexcept{ return a == b; }
+	};
+
+	namespace detail{
+		/**
+		 * Control byte of a slot. Full slots store the low 7 bits of their hash,
+		 * every special value has the high bit set.
+		 */
+		enum class flat_ctrl: i8{
+			empty    = -128, // 0b10000000
+			deleted  = -2,   // 0b11111110
+			sentinel = -1,   // 0b11111111
+		};
+
+		constexpr inline bool flat_ctrl_is_full(i8 ctrl) noexcept{ return ctrl >= 0; }
+
+		//! Set bits of a group match, one per matching slot.
+		template<usize Shift>
+		class flat_bitmask{
+			public:
+				constexpr explicit flat_bitmask(u64 mask_) noexcept: m_mask(mask_){}
+
+				constexpr explicit operator bool() const noexcept{ return m_mask != 0; }
+
+				constexpr u32 lowest() const noexcept{ return (u32)std::countr_zero(m_mask) >> Shift; }
+
+				constexpr void clear_lowest() noexcept{ m_mask &= m_mask - 1; }
+
+			private:
+				u64 m_mask;
+		};
+
+#if defined(__SSE2__)
+
+		struct flat_group{
+			static constexpr usize width = 16;
+
+			using bitmask = flat_bitmask<0>;
+
+			explicit flat_group(const i8 *ctrl) noexcept
+				: vec(_mm_loadu_si128((const __m128i*)ctrl)){}
+
+			bitmask match(i8 h2) const noexcept{
+				return bitmask((u32)_mm_movemask_epi8(_mm_cmpeq_epi8(vec, _mm_set1_epi8(h2))));
+			}
+
+			bitmask match_empty() const noexcept{
+				return bitmask((u32)_mm_movemask_epi8(_mm_cmpeq_epi8(vec, _mm_set1_epi8((char)flat_ctrl::empty))));
+			}
+
+			// sentinel is the only special value greater than deleted
+			bitmask match_empty_or_deleted() const noexcept{
+				return bitmask((u32)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8((char)flat_ctrl::sentinel), vec)));
+			}
+
+			__m128i vec;
+		};
+
+#elif defined(__ARM_NEON)
+
+		struct flat_group{
+			static constexpr usize width = 8;
+
+			using bitmask = flat_bitmask<3>;
+
+			static constexpr u64 msbs = 0x8080808080808080ull;
+
+			explicit flat_group(const i8 *ctrl) noexcept
+				: vec(vld1_s8(ctrl)){}
+
+			bitmask match(i8 h2) const noexcept{
+				return bitmask(vget_lane_u64(vreinterpret_u64_u8(vceq_s8(vec, vdup_n_s8(h2))), 0) & msbs);
+			}
+
+			bitmask match_empty() const noexcept{
+				return bitmask(vget_lane_u64(vreinterpret_u64_u8(vceq_s8(vec, vdup_n_s8((i8)flat_ctrl::empty))), 0) & msbs);
+			}
+
+			bitmask match_empty_or_deleted() const noexcept{
+				return bitmask(vget_lane_u64(vreinterpret_u64_u8(vcgt_s8(vdup_n_s8((i8)flat_ctrl::sentinel), vec)), 0) & msbs);
+			}
+
+			int8x8_t vec;
+		};
+
+#else
+
+		// portable fallback working on 8 control bytes at a time
+		struct flat_group{
+			static constexpr usize width = 8;
+
+			using bitmask = flat_bitmask<3>;
+
+			static constexpr u64 lsbs = 0x0101010101010101ull;
+			static constexpr u64 msbs = 0x8080808080808080ull;
+
+			explicit flat_group(const i8 *ctrl) noexcept{
+				memcpy(&ctrl_bits, ctrl, sizeof(ctrl_bits));
+			}
+
+			// may report false positives, those are weeded out by the key comparison
+			bitmask match(i8 h2) const noexcept{
+				const u64 x = ctrl_bits ^ (lsbs * (u8)h2);
+				return bitmask((x - lsbs) & ~x & msbs);
+			}
+
+			bitmask match_empty() const noexcept{ return bitmask((ctrl_bits & ~(ctrl_bits << 6)) & msbs); }
+
+			bitmask match_empty_or_deleted() const noexcept{ return bitmask((ctrl_bits & ~(ctrl_bits << 7)) & msbs); }
+
+			u64 ctrl_bits;
+		};
+
+#endif
+	}
+
+	/**
+	 * @brief Hash map storing its values inline in a single allocation.
+	 *
+	 * Lookups compare a whole group of control bytes against 7 bits of the hash at once,
+	 * so most probes touch a single cache line of metadata before the matching slot.
+	 * Storage comes from a `ham_allocator`, the current allocator by default.
+	 *
+	 * Values are not address-stable across insertions. If `Hash` and `KeyEqual` declare
+	 * `is_transparent`, lookups accept any key type they can be called with (e.g. a ``str8`` for ``str_buffer8`` keys).
+	 */
+	template<typename Key, typename T, typename Hash = flat_hash<Key>, typename KeyEqual = flat_equal<Key>>
+	class flat_map{
+		public:
+			using key_type    = Key;
+			using mapped_type = T;
+			using value_type  = std::pair<Key, T>;
+			using size_type   = usize;
+			using hasher      = Hash;
+			using key_equal   = KeyEqual;
+
+			template<bool Const>
+			class basic_iterator{
+				public:
+					using value_type = flat_map::value_type;
+					using reference  = std::conditional_t<Const, const value_type&, value_type&>;
+					using pointer    = std::conditional_t<Const, const value_type*, value_type*>;
+
+					basic_iterator() noexcept = default;
+
+					template<bool OtherConst, std::enable_if_t<Const && !OtherConst, int> = 0>
+					basic_iterator(const basic_iterator<OtherConst> &other) noexcept
+						: m_ctrl(other.m_ctrl), m_slot(other.m_slot){}
+
+					reference operator*() const noexcept{ return *m_slot; }
+					pointer operator->() const noexcept{ return m_slot; }
+
+					basic_iterator &operator++() noexcept{
+						++m_ctrl;
+						++m_slot;
+						skip_empty();
+						return *this;
+					}
+
+					basic_iterator operator++(int) noexcept{
+						const auto ret = *this;
+						++(*this);
+						return ret;
+					}
+
+					bool operator==(const basic_iterator &other) const noexcept{ return m_slot == other.m_slot; }
+					bool operator!=(const basic_iterator &other) const noexcept{ return m_slot != other.m_slot; }
+
+				private:
+					basic_iterator(const i8 *ctrl_, pointer slot_) noexcept
+						: m_ctrl(ctrl_), m_slot(slot_){}
+
+					// the sentinel control byte stops the scan at end()
+					void skip_empty() noexcept{
+						while(!detail::flat_ctrl_is_full(*m_ctrl) && *m_ctrl != (i8)detail::flat_ctrl::sentinel){
+							++m_ctrl;
+							++m_slot;
+						}
+					}
+
+					const i8 *m_ctrl = nullptr;
+					pointer m_slot = nullptr;
+
+					friend class flat_map;
+
+					template<bool>
+					friend class basic_iterator;
+			};
+
+			using iterator       = basic_iterator<false>;
+			using const_iterator = basic_iterator<true>;
+
+			explicit flat_map(const ham_allocator *allocator_ = nullptr) noexcept
+				: m_allocator(allocator_ ? allocator_ : ham_current_allocator()){}
+
+			flat_map(flat_map &&other) noexcept
+				: m_allocator(other.m_allocator)
+				, m_ctrl(std::exchange(other.m_ctrl, nullptr))
+				, m_slots(std::exchange(other.m_slots, nullptr))
+				, m_capacity(std::exchange(other.m_capacity, 0))
+				, m_size(std::exchange(other.m_size, 0))
+				, m_growth_left(std::exchange(other.m_growth_left, 0))
+			{}
+
+			flat_map(const flat_map &other)
+				: m_allocator(other.m_allocator)
+			{
+				reserve(other.m_size);
+				for(const auto &val : other){
+					emplace(val.first, val.second);
+				}
+			}
+
+			~flat_map(){ destroy(); }
+
+			flat_map &operator=(flat_map &&other) noexcept{
+				if(this != &other){
+					destroy();
+
+					m_allocator   = other.m_allocator;
+					m_ctrl        = std::exchange(other.m_ctrl, nullptr);
+					m_slots       = std::exchange(other.m_slots, nullptr);
+					m_capacity    = std::exchange(other.m_capacity, 0);
+					m_size        = std::exchange(other.m_size, 0);
+					m_growth_left = std::exchange(other.m_growth_left, 0);
+				}
+
+				return *this;
+			}
+
+			flat_map &operator=(const flat_map &other){
+				if(this != &other){
+					clear();
+					reserve(other.m_size);
+					for(const auto &val : other){
+						emplace(val.first, val.second);
+					}
+				}
+
+				return *this;
+			}
+
+			const ham_allocator *allocator() const noexcept{ return m_allocator; }
+
+			bool empty() const noexcept{ return m_size == 0; }
+			usize size() const noexcept{ return m_size; }
+			usize capacity() const noexcept{ return m_capacity; }
+
+			iterator begin() noexcept{
+				if(!m_capacity) return end();
+				iterator ret(m_ctrl, m_slots);
+				ret.skip_empty();
+				return ret;
+			}
+
+			const_iterator begin() const noexcept{
+				if(!m_capacity) return end();
+				const_iterator ret(m_ctrl, m_slots);
+				ret.skip_empty();
+				return ret;
+			}
+
+			iterator end() noexcept{ return iterator(m_ctrl + m_capacity, m_slots + m_capacity); }
+			const_iterator end() const noexcept{ return const_iterator(m_ctrl + m_capacity, m_slots + m_capacity); }
+
+			/**
+			 * @brief Destroy every value, keeping the storage around.
+			 */
+			void clear() noexcept{
+				if(!m_capacity) return;
+
+				for(usize i = 0; i < m_capacity; i++){
+					if(detail::flat_ctrl_is_full(m_ctrl[i])) std::destroy_at(m_slots + i);
+				}
+
+				reset_ctrl();
+				m_size = 0;
+				m_growth_left = capacity_to_growth(m_capacity);
+			}
+
+			/**
+			 * @brief Make room for at least `n` values without rehashing.
+			 * @throws flat_map_alloc_error if new storage couldn't be allocated
+			 */
+			void reserve(usize n){
+				if(n <= m_size + m_growth_left) return;
+				rehash(growth_to_capacity(n));
+			}
+
+			template<typename K>
+			iterator find(const K &key) noexcept{
+				const auto idx = find_index(key);
+				return idx == m_capacity ? end() : iterator(m_ctrl + idx, m_slots + idx);
+			}
+
+			template<typename K>
+			const_iterator find(const K &key) const noexcept{
+				const auto idx = find_index(key);
+				return idx == m_capacity ? end() : const_iterator(m_ctrl + idx, m_slots + idx);
+			}
+
+			template<typename K>
+			bool contains(const K &key) const noexcept{ return find_index(key) != m_capacity; }
+
+			/**
+			 * @brief Get a pointer to the value mapped to `key`.
+			 * @returns pointer to the mapped value or ``nullptr`` if `key` isn't in the map
+			 */
+			template<typename K>
+			T *get(const K &key) noexcept{
+				const auto idx = find_index(key);
+				return idx == m_capacity ? nullptr : &m_slots[idx].second;
+			}
+
+			template<typename K>
+			const T *get(const K &key) const noexcept{
+				const auto idx = find_index(key);
+				return idx == m_capacity ? nullptr : &m_slots[idx].second;
+			}
+
+			/**
+			 * @brief Insert a value constructed from `args` if `key` isn't mapped yet.
+			 * @returns iterator to the value mapped to `key` and whether it was inserted
+			 * @throws flat_map_alloc_error if the map needed to grow and couldn't
+			 */
+			template<typename K, typename ... Args>
+			std::pair<iterator, bool> try_emplace(K &&key, Args &&... args){
+				const u64 hash = m_hash(key);
+
+				const auto idx = find_index(key, hash);
+				if(idx != m_capacity) return { iterator(m_ctrl + idx, m_slots + idx), false };
+
+				const auto new_idx = prepare_insert(hash);
+
+				new(m_slots + new_idx) value_type(
+					std::piecewise_construct,
+					std::forward_as_tuple(std::forward<K>(key)),
+					std::forward_as_tuple(std::forward<Args>(args)...)
+				);
+
+				return { iterator(m_ctrl + new_idx, m_slots + new_idx), true };
+			}
+
+			template<typename K, typename V>
+			std::pair<iterator, bool> emplace(K &&key, V &&val){
+				return try_emplace(std::forward<K>(key), std::forward<V>(val));
+			}
+
+			std::pair<iterator, bool> insert(const value_type &val){ return try_emplace(val.first, val.second); }
+			std::pair<iterator, bool> insert(value_type &&val){ return try_emplace(std::move(val.first), std::move(val.second)); }
+
+			template<typename K, typename V>
+			std::pair<iterator, bool> insert_or_assign(K &&key, V &&val){
+				auto res = try_emplace(std::forward<K>(key), std::forward<V>(val));
+				if(!res.second) res.first->second = std::forward<V>(val);
+				return res;
+			}
+
+			template<typename K>
+			T &operator[](K &&key){ return try_emplace(std::forward<K>(key)).first->second; }
+
+			/**
+			 * @brief Remove the value mapped to `key`.
+			 * @returns whether a value was removed
+			 */
+			template<typename K>
+			bool erase(const K &key) noexcept{
+				const auto idx = find_index(key);
+				if(idx == m_capacity) return false;
+
+				erase_at(idx);
+				return true;
+			}
+
+			iterator erase(const_iterator it) noexcept{
+				const auto idx = (usize)(it.m_slot - m_slots);
+				erase_at(idx);
+
+				iterator ret(m_ctrl + idx, m_slots + idx);
+				ret.skip_empty();
+				return ret;
+			}
+
+			iterator erase(iterator it) noexcept{ return erase(const_iterator(it)); }
+
+		private:
+			using group = detail::flat_group;
+
+			// capacities are always 2^n - 1 so the capacity doubles as the probe mask
+			static constexpr usize min_capacity = group::width - 1;
+
+			// the control bytes of the first group are cloned after the sentinel,
+			// so a group load at any slot index stays in bounds
+			static constexpr usize num_cloned_bytes = group::width - 1;
+
+			static constexpr usize capacity_to_growth(usize cap) noexcept{
+				// max load factor 7/8, but always leave an empty slot so probing terminates
+				return cap == 7 ? 6 : cap - (cap / 8);
+			}
+
+			static constexpr usize growth_to_capacity(usize growth) noexcept{
+				const usize wanted = growth + ((growth - 1) / 7);
+				const usize cap = ((usize)1 << (64 - std::countl_zero((u64)wanted))) - 1;
+				return cap < min_capacity ? min_capacity : cap;
+			}
+
+			static constexpr usize alloc_alignment = alignof(value_type) > alignof(u64) ? alignof(value_type) : alignof(u64);
+
+			static constexpr usize ctrl_bytes(usize cap) noexcept{ return cap + 1 + num_cloned_bytes; }
+
+			static constexpr usize slots_offset(usize cap) noexcept{
+				return (ctrl_bytes(cap) + alignof(value_type) - 1) & ~(alignof(value_type) - 1);
+			}
+
+			static constexpr usize h1(u64 hash) noexcept{ return (usize)(hash >> 7); }
+			static constexpr i8 h2(u64 hash) noexcept{ return (i8)(hash & 0x7f); }
+
+			void set_ctrl(usize idx, i8 ctrl) noexcept{
+				m_ctrl[idx] = ctrl;
+				m_ctrl[((idx - num_cloned_bytes) & m_capacity) + (num_cloned_bytes & m_capacity)] = ctrl;
+			}
+
+			void reset_ctrl() noexcept{
+				memset(m_ctrl, (int)(u8)detail::flat_ctrl::empty, ctrl_bytes(m_capacity));
+				m_ctrl[m_capacity] = (i8)detail::flat_ctrl::sentinel;
+			}
+
+			template<typename K>
+			usize find_index(const K &key) const noexcept{
+				if(!m_capacity) return 0;
+				return find_index(key, m_hash(key));
+			}
+
+			template<typename K>
+			usize find_index(const K &key, u64 hash) const noexcept{
+				if(!m_capacity) return 0;
+
+				const auto tag = h2(hash);
+
+				usize pos = h1(hash) & m_capacity;
+
+				for(usize step = group::width; ; step += group::width){
+					const group g(m_ctrl + pos);
+
+					for(auto matches = g.match(tag); matches; matches.clear_lowest()){
+						const usize idx = (pos + matches.lowest()) & m_capacity;
+						if(ham_likely(m_eq(m_slots[idx].first, key))) return idx;
+					}
+
+					if(g.match_empty()) return m_capacity;
+
+					// triangular probing visits every group once for power-of-two tables
+					pos = (pos + step) & m_capacity;
+				}
+			}
+
+			usize find_first_non_full(u64 hash) const noexcept{
+				usize pos = h1(hash) & m_capacity;
+
+				for(usize step = group::width; ; step += group::width){
+					const auto matches = group(m_ctrl + pos).match_empty_or_deleted();
+					if(matches) return (pos + matches.lowest()) & m_capacity;
+
+					pos = (pos + step) & m_capacity;
+				}
+			}
+
+			//! Claims a slot for a new value with `hash`, growing the table if needed.
+			usize prepare_insert(u64 hash){
+				usize idx = m_capacity ? find_first_non_full(hash) : 0;
+
+				if(ham_unlikely(m_growth_left == 0 && (!m_capacity || m_ctrl[idx] != (i8)detail::flat_ctrl::deleted))){
+					// mostly tombstones: rehash in place instead of growing
+					if(m_capacity > group::width && (m_size * 32) <= (m_capacity * 25)){
+						rehash(m_capacity);
+					}
+					else{
+						rehash(m_capacity ? (m_capacity * 2) + 1 : min_capacity);
+					}
+
+					idx = find_first_non_full(hash);
+				}
+
+				if(m_ctrl[idx] == (i8)detail::flat_ctrl::empty) --m_growth_left;
+
+				set_ctrl(idx, h2(hash));
+				++m_size;
+				return idx;
+			}
+
+			void rehash(usize new_cap){
+				const usize total_bytes = slots_offset(new_cap) + (sizeof(value_type) * new_cap);
+
+				const auto mem = (char*)ham_allocator_alloc(m_allocator, alloc_alignment, total_bytes);
+				if(!mem) throw flat_map_alloc_error();
+
+				const auto old_ctrl  = m_ctrl;
+				const auto old_slots = m_slots;
+				const auto old_cap   = m_capacity;
+
+				m_ctrl        = (i8*)mem;
+				m_slots       = (value_type*)(mem + slots_offset(new_cap));
+				m_capacity    = new_cap;
+				m_growth_left = capacity_to_growth(new_cap) - m_size;
+
+				reset_ctrl();
+
+				if(!old_cap) return;
+
+				for(usize i = 0; i < old_cap; i++){
+					if(!detail::flat_ctrl_is_full(old_ctrl[i])) continue;
+
+					auto &&old_val = old_slots[i];
+
+					const u64 hash = m_hash(old_val.first);
+					const auto idx = find_first_non_full(hash);
+
+					set_ctrl(idx, h2(hash));
+
+					new(m_slots + idx) value_type(std::move(old_val));
+					std::destroy_at(&old_val);
+				}
+
+				ham_allocator_free(m_allocator, old_ctrl);
+			}
+
+			void erase_at(usize idx) noexcept{
+				std::destroy_at(m_slots + idx);
+
+				// the slot can go back to empty if no probe sequence ever had to step past it,
+				// which is the case if its surrounding window never filled up completely
+				const usize idx_before = (idx - group::width) & m_capacity;
+
+				const auto empty_after  = group(m_ctrl + idx).match_empty();
+				const auto empty_before = group(m_ctrl + idx_before).match_empty();
+
+				const bool was_never_full =
+					empty_before && empty_after &&
+					(num_full_at_start(m_ctrl + idx) + num_full_at_end(m_ctrl + idx_before)) < group::width;
+
+				set_ctrl(idx, was_never_full ? (i8)detail::flat_ctrl::empty : (i8)detail::flat_ctrl::deleted);
+				if(was_never_full) ++m_growth_left;
+
+				--m_size;
+			}
+
+			// number of non-empty control bytes before the first empty one in a group
+			static usize num_full_at_start(const i8 *ctrl) noexcept{
+				usize n = 0;
+				while(n < group::width && ctrl[n] != (i8)detail::flat_ctrl::empty) ++n;
+				return n;
+			}
+
+			// number of non-empty control bytes after the last empty one in a group
+			static usize num_full_at_end(const i8 *ctrl) noexcept{
+				usize n = 0;
+				while(n < group::width && ctrl[group::width - 1 - n] != (i8)detail::flat_ctrl::empty) ++n;
+				return n;
+			}
+
+			void destroy() noexcept{
+				if(!m_capacity) return;
+
+				for(usize i = 0; i < m_capacity; i++){
+					if(detail::flat_ctrl_is_full(m_ctrl[i])) std::destroy_at(m_slots + i);
+				}
+
+				ham_allocator_free(m_allocator, m_ctrl);
+
+				m_ctrl = nullptr;
+				m_slots = nullptr;
+				m_capacity = m_size = m_growth_left = 0;
+			}
+
+			const ham_allocator *m_allocator;
+			i8 *m_ctrl = nullptr;
+			value_type *m_slots = nullptr;
+			usize m_capacity = 0, m_size = 0, m_growth_left = 0;
+			[[no_unique_address]] Hash m_hash;
+			[[no_unique_address]] KeyEqual m_eq;
+	};
+}
+
+/**
+ * @}
+ */
+
+#endif // !HAM_FLAT_MAP_HPP
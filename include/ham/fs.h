@@ -34,6 +34,9 @@ typedef enum ham_file_open_flags{
 	HAM_OPEN_WRITE = 0x2,
 
 	HAM_OPEN_RDWR = HAM_OPEN_READ | HAM_OPEN_WRITE,
+
+	//! Create the file if it doesn't exist, truncating any existing contents.
+	HAM_OPEN_CREATE = 0x4,
 } ham_file_open_flags;
 
 typedef enum ham_file_kind{
@@ -79,6 +82,364 @@ ham_api ham_usize ham_file_tell(const ham_file *file);
 ham_api void *ham_file_map(ham_file *file, ham_file_open_flags flags, ham_usize from, ham_usize len);
 ham_api bool ham_file_unmap(ham_file *file, void *mapping, ham_usize len);
 
+/**
+ * @defgroup HAM_FS_IO Asynchronous file I/O
+ * Queues of reads and writes on `ham_file` handles that are submitted in batches and completed out of order.
+ * Backed by io_uring where the kernel supports it, otherwise by a small pool of threads doing positional reads and writes.
+ * A queue must only be used by one thread at a time.
+ * @{
+ */
+
+#define HAM_FILE_IO_DEFAULT_QUEUE_DEPTH 128
+
+//! Buffer index of a request that doesn't use a registered buffer.
+#define HAM_FILE_IO_NO_BUFFER ((ham_u32)-1)
+
+typedef struct ham_file_io ham_file_io;
+
+typedef enum ham_file_io_flags{
+	//! Use the thread pool even if io_uring is available.
+	HAM_FILE_IO_FORCE_THREADS = 0x1,
+} ham_file_io_flags;
+
+typedef enum ham_file_io_backend{
+	HAM_FILE_IO_BACKEND_IO_URING,
+	HAM_FILE_IO_BACKEND_THREADS,
+
+	HAM_FILE_IO_BACKEND_COUNT,
+} ham_file_io_backend;
+
+typedef enum ham_file_io_op{
+	HAM_FILE_IO_READ,
+	HAM_FILE_IO_WRITE,
+
+	HAM_FILE_IO_OP_COUNT,
+} ham_file_io_op;
+
+typedef struct ham_file_io_request{
+	ham_file_io_op op;
+	ham_file *file;
+	void *buf; //!< Must lie within registered buffer `buf_index` unless that is `HAM_FILE_IO_NO_BUFFER`
+	ham_u32 len;
+	ham_u32 buf_index;
+	ham_usize off; //!< Offset in the file, the file position isn't used or changed
+	void *user; //!< Passed back in the result
+} ham_file_io_request;
+
+typedef struct ham_file_io_result{
+	void *user;
+	ham_isize res; //!< Number of bytes transferred, which may be short at the end of a file, or a negated `errno` value
+} ham_file_io_result;
+
+/**
+ * @brief Create an I/O queue.
+ * @param queue_depth maximum number of requests in flight at once
+ * @param flags bitwise or of `ham_file_io_flags`
+ * @returns newly created queue or `NULL` on error
+ */
+ham_api ham_file_io *ham_file_io_create(ham_u32 queue_depth, ham_u32 flags);
+
+/**
+ * @brief Wait for every request in flight, discarding the results, and destroy a queue.
+ * @param io queue to destroy
+ */
+ham_api ham_nothrow void ham_file_io_destroy(ham_file_io *io);
+
+ham_api ham_nothrow ham_file_io_backend ham_file_io_get_backend(const ham_file_io *io);
+
+//! Get the number of requests submitted but not completed yet.
+ham_api ham_nothrow ham_u32 ham_file_io_num_pending(const ham_file_io *io);
+
+/**
+ * @brief Register buffers to read into and write from without the kernel mapping them for every request.
+ * Replaces any buffers registered before. May only be called with nothing in flight.
+ * @param io queue to register the buffers with
+ * @param num_bufs number of buffers or `0` to unregister every buffer
+ * @param bufs buffers to register
+ * @param lens size of each buffer
+ * @returns whether the buffers were registered
+ */
+ham_api bool ham_file_io_register_buffers(ham_file_io *io, ham_u32 num_bufs, void *const *bufs, const ham_usize *lens);
+
+/**
+ * @brief Submit a batch of requests with a single call into the kernel.
+ * Submits as many requests from the front of \p reqs as there is room for in the queue.
+ * Requests past the returned count were not taken, e.g. because the kernel rejected them, and can be submitted again.
+ * @param io queue to submit to
+ * @param num_reqs number of requests
+ * @param reqs requests to submit
+ * @returns number of requests submitted or `(ham_u32)-1` on error
+ */
+ham_api ham_u32 ham_file_io_submit(ham_file_io *io, ham_u32 num_reqs, const ham_file_io_request *reqs);
+
+/**
+ * @brief Collect the results of completed requests, in the order they completed.
+ * @param io queue to collect from
+ * @param min_results number of results to wait for, clamped to the number of requests in flight
+ * @param max_results maximum number of results to return
+ * @param results where to write the results
+ * @returns number of results written or `(ham_u32)-1` on error
+ */
+ham_api ham_u32 ham_file_io_complete(ham_file_io *io, ham_u32 min_results, ham_u32 max_results, ham_file_io_result *results);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup HAM_FS_WATCH File watching
+ * Notifications of files changing inside watched directories, so assets can be reloaded one at a time while running.
+ * A background thread collects changes and holds each one back until its path has been quiet for the debounce interval,
+ * so a file saved in several writes or replaced through a temporary file produces a single event.
+ * Only implemented on Linux, with inotify.
+ * @{
+ */
+
+#define HAM_FS_WATCH_DEFAULT_DEBOUNCE_MS 50
+
+typedef struct ham_fs_watch ham_fs_watch;
+
+typedef enum ham_fs_watch_flags{
+	//! Also watch every directory below, including ones created later.
+	HAM_FS_WATCH_RECURSIVE = 0x1,
+} ham_fs_watch_flags;
+
+typedef enum ham_fs_watch_event_kind{
+	HAM_FS_WATCH_CREATED, //!< A file appeared at the path, which includes renaming a file over an existing one
+	HAM_FS_WATCH_MODIFIED, //!< A file was written and closed
+	HAM_FS_WATCH_REMOVED, //!< A file was deleted or moved away
+
+	HAM_FS_WATCH_EVENT_KIND_COUNT,
+} ham_fs_watch_event_kind;
+
+typedef struct ham_fs_watch_event{
+	ham_fs_watch_event_kind kind;
+	ham_str8 path; //!< Watched directory as it was added joined with the file name, valid until the next poll
+} ham_fs_watch_event;
+
+/**
+ * @brief Create a watch and start its thread.
+ * @param debounce_ms how long a path must go without changes before its event is delivered
+ * @returns newly created watch or `NULL` on error
+ */
+ham_api ham_fs_watch *ham_fs_watch_create(ham_u32 debounce_ms);
+
+/**
+ * @brief Stop the thread of a watch and destroy it, dropping any events not polled yet.
+ * @param watch watch to destroy
+ */
+ham_api ham_nothrow void ham_fs_watch_destroy(ham_fs_watch *watch);
+
+/**
+ * @brief Start watching the files in a directory.
+ * Safe to call from any thread.
+ * @param watch watch to add the directory to
+ * @param dir path of the directory
+ * @param flags bitwise or of `ham_fs_watch_flags`
+ * @returns whether the directory is being watched
+ */
+ham_api bool ham_fs_watch_add(ham_fs_watch *watch, ham_str8 dir, ham_u32 flags);
+
+/**
+ * @brief Stop watching a directory, along with the directories below it if it was added with `HAM_FS_WATCH_RECURSIVE`.
+ * Safe to call from any thread. Events already delivered aren't taken back.
+ * @param watch watch to remove the directory from
+ * @param dir path of the directory, spelled the same as when it was added
+ * @returns whether the directory was being watched
+ */
+ham_api bool ham_fs_watch_remove(ham_fs_watch *watch, ham_str8 dir);
+
+/**
+ * @brief Take delivered events without blocking.
+ * Events come through a lock-free queue, so this is cheap enough to call every frame, but only from one thread at a time.
+ * Events for different paths come in no particular order.
+ * Paths are owned by the watch and stay valid until the next poll or until the watch is destroyed, copy any that are kept longer.
+ * @param watch watch to take events from
+ * @param max_events maximum number of events to return
+ * @param events where to write the events
+ * @returns number of events written
+ */
+ham_api ham_nothrow ham_u32 ham_fs_watch_poll(ham_fs_watch *watch, ham_u32 max_events, ham_fs_watch_event *events);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup HAM_FS_PACK Packed archives
+ * Read-only archives of many files in one, found by a hashed lookup in a memory-mapped index.
+ * Mounting a pack makes its entries visible to `ham_file_open_utf8`, `ham_path_exists_utf8` and `ham_path_file_info_utf8` as if they were regular files,
+ * so anything loading through `ham_file` reads from packs without changes. Only files opened with just `HAM_OPEN_READ` are looked up in packs.
+ * @{
+ */
+
+//! Alignment of the data of every entry in a pack.
+#define HAM_PACK_DATA_ALIGNMENT 64
+
+typedef struct ham_pack ham_pack;
+typedef struct ham_pack_builder ham_pack_builder;
+
+typedef enum ham_pack_add_flags{
+	//! Compress the entry, unless it doesn't get any smaller.
+	HAM_PACK_COMPRESS = 0x1,
+} ham_pack_add_flags;
+
+typedef struct ham_pack_entry_info{
+	ham_str8 path, mime; //!< Both point into the pack and are null-terminated
+	ham_usize size; //!< Size of the entry's data
+	ham_usize stored_size; //!< Size of the entry's data in the pack
+	bool compressed;
+} ham_pack_entry_info;
+
+/**
+ * @brief Open a pack, mapping it into memory.
+ * @param path path to the pack
+ * @returns newly opened pack or `NULL` on error
+ */
+ham_api ham_pack *ham_pack_open(ham_str8 path);
+
+/**
+ * @brief Close a pack.
+ * Mounts and files opened from the pack keep it open until they are done with it.
+ * @param pack pack to close
+ */
+ham_api ham_nothrow void ham_pack_close(ham_pack *pack);
+
+ham_api ham_nothrow ham_u32 ham_pack_num_entries(const ham_pack *pack);
+
+ham_api ham_nothrow bool ham_pack_get_entry(const ham_pack *pack, ham_u32 idx, ham_pack_entry_info *ret);
+
+/**
+ * @brief Look up an entry in a pack.
+ * @param pack pack to search
+ * @param path path of the entry relative to the root of the pack
+ * @param ret where to write info about the entry
+ * @returns whether the entry was found
+ */
+ham_api ham_nothrow bool ham_pack_find(const ham_pack *pack, ham_str8 path, ham_pack_entry_info *ret);
+
+/**
+ * @brief Mount a pack so its entries are found by the filesystem functions.
+ * A pack mounted later hides entries of the same path in packs mounted before it, packs hide files on disk.
+ * @param pack pack to mount
+ * @param mount_point path prefix the entries appear under, empty for the working directory
+ * @returns whether the pack was mounted
+ */
+ham_api bool ham_fs_mount_pack(ham_pack *pack, ham_str8 mount_point);
+
+/**
+ * @brief Unmount the most recent mount of a pack.
+ * @param pack pack to unmount
+ * @returns whether the pack was mounted
+ */
+ham_api bool ham_fs_unmount_pack(ham_pack *pack);
+
+ham_api ham_pack_builder *ham_pack_builder_create();
+ham_api ham_nothrow void ham_pack_builder_destroy(ham_pack_builder *builder);
+
+ham_api ham_nothrow ham_usize ham_pack_builder_num_entries(const ham_pack_builder *builder);
+
+/**
+ * @brief Add an entry to a pack.
+ * @param builder builder to add the entry to
+ * @param path path of the entry relative to the root of the pack
+ * @param mime mime type of the entry, detected from \p data if empty
+ * @param len size of the entry's data
+ * @param data entry's data, copied into the builder
+ * @param flags bitwise or of `ham_pack_add_flags`
+ * @returns whether the entry was added
+ */
+ham_api bool ham_pack_builder_add(ham_pack_builder *builder, ham_str8 path, ham_str8 mime, ham_usize len, const void *data, ham_u32 flags);
+
+/**
+ * @brief Add a file to a pack.
+ * @param builder builder to add the file to
+ * @param path path of the entry relative to the root of the pack
+ * @param file_path path of the file to add
+ * @param flags bitwise or of `ham_pack_add_flags`
+ * @returns whether the file was added
+ */
+ham_api bool ham_pack_builder_add_file(ham_pack_builder *builder, ham_str8 path, ham_str8 file_path, ham_u32 flags);
+
+/**
+ * @brief Write out a pack of every entry added so far.
+ * @param builder builder to write
+ * @param path path to write the pack to
+ * @returns whether the pack was written, fails if two entries have the same path
+ */
+ham_api bool ham_pack_builder_write(const ham_pack_builder *builder, ham_str8 path);
+
+/**
+ * @}
+ */
+
+/**
+ * @defgroup HAM_FS_CACHE Cooked asset cache
+ * Results of importing assets, stored in a directory under a hash of the source contents and the import settings,
+ * so loading an unchanged asset skips the importer and maps its cooked form instead.
+ * Entries are written to a temporary file and renamed into place, so processes sharing a cache never see half-written entries.
+ * Nothing is cached until a directory is set.
+ * @{
+ */
+
+//! Alignment of mapped cache entries.
+#define HAM_ASSET_CACHE_DATA_ALIGNMENT 64
+
+typedef struct ham_asset_key{
+	ham_u64 lo, hi;
+} ham_asset_key;
+
+/**
+ * @brief Set the directory cooked assets are cached in, creating it if it doesn't exist.
+ * @param dir path of the directory or an empty string to stop caching
+ * @returns whether the directory is usable
+ */
+ham_api bool ham_asset_cache_set_dir(ham_str8 dir);
+
+//! Get the directory cooked assets are cached in, empty if caching is off.
+ham_api ham_nothrow ham_str8 ham_asset_cache_dir();
+
+/**
+ * @brief Compute the key of a cooked asset.
+ * @param cooker name of whatever cooks the asset, which should change along with its output format, e.g. `"ham_image/1"`
+ * @param settings_len size of the import settings
+ * @param settings import settings, anything that changes the cooked result for the same source
+ * @param len size of the source
+ * @param data source contents
+ * @returns key of the cooked asset
+ */
+ham_api ham_nothrow ham_asset_key ham_asset_key_from_mem(ham_str8 cooker, ham_usize settings_len, const void *settings, ham_usize len, const void *data);
+
+/**
+ * @brief Map a cached entry read-only.
+ * @param key key of the entry
+ * @param len_ret where to write the size of the entry
+ * @returns data of the entry, aligned to `HAM_ASSET_CACHE_DATA_ALIGNMENT`, or `NULL` if there is no usable entry or caching is off
+ * @see ham_asset_cache_unmap
+ */
+ham_api const void *ham_asset_cache_map(ham_asset_key key, ham_usize *len_ret);
+
+/**
+ * @brief Unmap an entry mapped by `ham_asset_cache_map`.
+ * @param data data of the entry
+ * @param len size of the entry
+ */
+ham_api ham_nothrow void ham_asset_cache_unmap(const void *data, ham_usize len);
+
+/**
+ * @brief Store an entry in the cache, replacing any entry with the same key.
+ * Failures are only logged as warnings, callers should carry on with whatever they cooked.
+ * @param key key of the entry
+ * @param len size of the entry
+ * @param data data of the entry
+ * @returns whether the entry was stored
+ */
+ham_api bool ham_asset_cache_store(ham_asset_key key, ham_usize len, const void *data);
+
+/**
+ * @}
+ */
+
 HAM_C_API_END
 
 #ifdef __cplusplus
@@ -115,6 +476,8 @@ namespace ham{
 		write = HAM_OPEN_WRITE,
 
 		rdwr = HAM_OPEN_RDWR,
+
+		create = HAM_OPEN_CREATE,
 	};
 
 	class file_open_error: public exception{
@@ -166,6 +529,130 @@ namespace ham{
 		private:
 			unique_handle<ham_file*, ham_file_close> m_handle;
 	};
+
+	enum class file_io_backend{
+		io_uring = HAM_FILE_IO_BACKEND_IO_URING,
+		threads = HAM_FILE_IO_BACKEND_THREADS,
+	};
+
+	class file_io{
+		public:
+			explicit file_io(u32 queue_depth = HAM_FILE_IO_DEFAULT_QUEUE_DEPTH, u32 flags = 0)
+				: m_handle(ham_file_io_create(queue_depth, flags)){}
+
+			file_io(file_io&&) noexcept = default;
+
+			file_io &operator=(file_io&&) noexcept = default;
+
+			operator bool() const noexcept{ return (bool)m_handle; }
+
+			ham_file_io *ptr() noexcept{ return m_handle.get(); }
+			const ham_file_io *ptr() const noexcept{ return m_handle.get(); }
+
+			file_io_backend backend() const noexcept{ return static_cast<file_io_backend>(ham_file_io_get_backend(m_handle.get())); }
+
+			u32 num_pending() const noexcept{ return ham_file_io_num_pending(m_handle.get()); }
+
+			bool register_buffers(u32 num_bufs, void *const *bufs, const usize *lens){
+				return ham_file_io_register_buffers(m_handle.get(), num_bufs, bufs, lens);
+			}
+
+			u32 submit(u32 num_reqs, const ham_file_io_request *reqs){ return ham_file_io_submit(m_handle.get(), num_reqs, reqs); }
+
+			u32 complete(u32 min_results, u32 max_results, ham_file_io_result *results){
+				return ham_file_io_complete(m_handle.get(), min_results, max_results, results);
+			}
+
+		private:
+			unique_handle<ham_file_io*, ham_file_io_destroy> m_handle;
+	};
+
+	enum class fs_watch_event_kind{
+		created = HAM_FS_WATCH_CREATED,
+		modified = HAM_FS_WATCH_MODIFIED,
+		removed = HAM_FS_WATCH_REMOVED,
+	};
+
+	class fs_watch{
+		public:
+			explicit fs_watch(u32 debounce_ms = HAM_FS_WATCH_DEFAULT_DEBOUNCE_MS)
+				: m_handle(ham_fs_watch_create(debounce_ms)){}
+
+			fs_watch(fs_watch&&) noexcept = default;
+
+			fs_watch &operator=(fs_watch&&) noexcept = default;
+
+			operator bool() const noexcept{ return (bool)m_handle; }
+
+			ham_fs_watch *ptr() noexcept{ return m_handle.get(); }
+			const ham_fs_watch *ptr() const noexcept{ return m_handle.get(); }
+
+			bool add(const str8 &dir, u32 flags = 0){ return ham_fs_watch_add(m_handle.get(), dir, flags); }
+			bool remove(const str8 &dir){ return ham_fs_watch_remove(m_handle.get(), dir); }
+
+			u32 poll(u32 max_events, ham_fs_watch_event *events) noexcept{ return ham_fs_watch_poll(m_handle.get(), max_events, events); }
+
+		private:
+			unique_handle<ham_fs_watch*, ham_fs_watch_destroy> m_handle;
+	};
+
+	class pack{
+		public:
+			pack() = default;
+
+			explicit pack(const str8 &path)
+				: m_handle(ham_pack_open(path)){}
+
+			pack(pack&&) noexcept = default;
+
+			pack &operator=(pack&&) noexcept = default;
+
+			operator bool() const noexcept{ return (bool)m_handle; }
+
+			ham_pack *ptr() noexcept{ return m_handle.get(); }
+			const ham_pack *ptr() const noexcept{ return m_handle.get(); }
+
+			u32 num_entries() const noexcept{ return ham_pack_num_entries(m_handle.get()); }
+
+			bool get_entry(u32 idx, ham_pack_entry_info *ret) const noexcept{ return ham_pack_get_entry(m_handle.get(), idx, ret); }
+			bool find(const str8 &path, ham_pack_entry_info *ret) const noexcept{ return ham_pack_find(m_handle.get(), path, ret); }
+
+			bool mount(const str8 &mount_point = str8()){ return ham_fs_mount_pack(m_handle.get(), mount_point); }
+			bool unmount(){ return ham_fs_unmount_pack(m_handle.get()); }
+
+		private:
+			unique_handle<ham_pack*, ham_pack_close> m_handle;
+	};
+
+	class pack_builder{
+		public:
+			pack_builder()
+				: m_handle(ham_pack_builder_create()){}
+
+			pack_builder(pack_builder&&) noexcept = default;
+
+			pack_builder &operator=(pack_builder&&) noexcept = default;
+
+			operator bool() const noexcept{ return (bool)m_handle; }
+
+			ham_pack_builder *ptr() noexcept{ return m_handle.get(); }
+			const ham_pack_builder *ptr() const noexcept{ return m_handle.get(); }
+
+			usize num_entries() const noexcept{ return ham_pack_builder_num_entries(m_handle.get()); }
+
+			bool add(const str8 &path, const str8 &mime, usize len, const void *data, u32 flags = 0){
+				return ham_pack_builder_add(m_handle.get(), path, mime, len, data, flags);
+			}
+
+			bool add_file(const str8 &path, const str8 &file_path, u32 flags = 0){
+				return ham_pack_builder_add_file(m_handle.get(), path, file_path, flags);
+			}
+
+			bool write(const str8 &path) const{ return ham_pack_builder_write(m_handle.get(), path); }
+
+		private:
+			unique_handle<ham_pack_builder*, ham_pack_builder_destroy> m_handle;
+	};
 }
 
 #endif // __cplusplus
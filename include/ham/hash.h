@@ -27,13 +27,30 @@
 
 #include "typedefs.h"
 
+// The SIMD variant of the bulk hash loop is chosen at compile time from the target flags,
+// there is no run-time CPU dispatch. Every variant matches the scalar loop bit for bit.
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define HAM_HASH_SIMD_AVX2 1
+#elif defined(__SSE2__)
+#	include <emmintrin.h>
+#	define HAM_HASH_SIMD_SSE2 1
+#elif defined(__ARM_NEON)
+#	include <arm_neon.h>
+#	define HAM_HASH_SIMD_NEON 1
+#endif
+
+#if defined(HAM_HASH_SIMD_AVX2) || defined(HAM_HASH_SIMD_SSE2) || defined(HAM_HASH_SIMD_NEON)
+#	define HAM_HASH_SIMD 1
+#endif
+
 HAM_C_API_BEGIN
 
 #define HAM_FNV1A_OFFSET_BIAS_32 0x811c9dc5
 #define HAM_FNV1A_OFFSET_BIAS_64 0xcbf29ce484222325
 
 #define HAM_FNV1A_PRIME_32 0x01000193
-#define HAM_FNV1A_PRIME_64 0x811c9dc5
+#define HAM_FNV1A_PRIME_64 0x100000001b3
 
 //
 // Byte hashing functions
@@ -61,12 +78,392 @@ ham_constexpr ham_nothrow static inline ham_u64 ham_hash_fnv1a_64(const char *by
 	return hash;
 }
 
+//
+// Fast hashing functions
+//
+
+/**
+ * @brief 128-bit hash value.
+ */
+typedef struct ham_hash128{
+	ham_u64 lo, hi;
+} ham_hash128;
+
+#define HAM_HASH_FAST_SECRET_0 0xa0761d6478bd642full
+#define HAM_HASH_FAST_SECRET_1 0xe7037ed1a0b428dbull
+#define HAM_HASH_FAST_SECRET_2 0x8ebc6af09c88c6e3ull
+#define HAM_HASH_FAST_SECRET_3 0x589965cc75374cc3ull
+
+//! Inputs at least this many bytes long are hashed with the striped bulk loop.
+#define HAM_HASH_FAST_BULK_THRESHOLD 256
+
+#define HAM_IMPL_HASH_STRIPE_SIZE 64
+#define HAM_IMPL_HASH_STRIPES_PER_BLOCK 16
+#define HAM_IMPL_HASH_SCRAMBLE_PRIME 0x9e3779b1u
+
+ham_constexpr ham_nothrow static inline ham_u64 ham_impl_hash_read64(const char *p){
+	return
+		 (ham_u64)(unsigned char)p[0]        | ((ham_u64)(unsigned char)p[1] << 8)  |
+		((ham_u64)(unsigned char)p[2] << 16) | ((ham_u64)(unsigned char)p[3] << 24) |
+		((ham_u64)(unsigned char)p[4] << 32) | ((ham_u64)(unsigned char)p[5] << 40) |
+		((ham_u64)(unsigned char)p[6] << 48) | ((ham_u64)(unsigned char)p[7] << 56);
+}
+
+ham_constexpr ham_nothrow static inline ham_u64 ham_impl_hash_read32(const char *p){
+	return
+		 (ham_u64)(unsigned char)p[0]        | ((ham_u64)(unsigned char)p[1] << 8) |
+		((ham_u64)(unsigned char)p[2] << 16) | ((ham_u64)(unsigned char)p[3] << 24);
+}
+
+//! Reads 1-3 bytes.
+ham_constexpr ham_nothrow static inline ham_u64 ham_impl_hash_read3(const char *p, ham_usize len){
+	return
+		((ham_u64)(unsigned char)p[0] << 16) |
+		((ham_u64)(unsigned char)p[len >> 1] << 8) |
+		 (ham_u64)(unsigned char)p[len - 1];
+}
+
+//! Full 64x64 -> 128-bit multiply; low half in `*a`, high half in `*b`.
+ham_constexpr ham_nothrow static inline void ham_impl_hash_mum(ham_u64 *a, ham_u64 *b){
+#ifdef HAM_INT128
+	const ham_u128 r = (ham_u128)*a * *b;
+	*a = (ham_u64)r;
+	*b = (ham_u64)(r >> 64);
+#else
+	const ham_u64 ha = *a >> 32, hb = *b >> 32, la = (ham_u32)*a, lb = (ham_u32)*b;
+	const ham_u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	const ham_u64 t = rl + (rm0 << 32);
+	const ham_u64 lo = t + (rm1 << 32);
+	const ham_u64 c = (ham_u64)(t < rl) + (ham_u64)(lo < t);
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+ham_constexpr ham_nothrow static inline ham_u64 ham_impl_hash_mix(ham_u64 a, ham_u64 b){
+	ham_impl_hash_mum(&a, &b);
+	return a ^ b;
+}
+
+ham_constexpr ham_nothrow static inline ham_u64 ham_impl_hash_avalanche(ham_u64 h){
+	h ^= h >> 37;
+	h *= 0x165667919e3779f9ull;
+	h ^= h >> 32;
+	return h;
+}
+
+//! Per-lane keys of the bulk loop.
+ham_constexpr ham_nothrow static inline ham_u64 ham_impl_hash_lane_key(ham_usize lane){
+	switch(lane){
+		case 0:  return 0xbe4ba423396cfeb8ull;
+		case 1:  return 0x1cad21f72c81017cull;
+		case 2:  return 0xdb979083e96dd4deull;
+		case 3:  return 0x1f67b3b7a4a44072ull;
+		case 4:  return 0x78e5c0cc4ee679cbull;
+		case 5:  return 0x2172ffcc7dd05a82ull;
+		case 6:  return 0x8e2443f7744608b8ull;
+		default: return 0x4c263a81e69035e0ull;
+	}
+}
+
+/**
+ * Scalar bulk loop, bit-identical to the SIMD loops below.
+ *
+ * Each 64-byte stripe feeds 8 independent 64-bit lanes: a lane adds the 32x32 product of
+ * its keyed input word and also the raw word of its neighbour lane. Every
+ * `HAM_IMPL_HASH_STRIPES_PER_BLOCK` stripes the lanes are scrambled so high bits spread back down.
+ */
+ham_constexpr ham_nothrow static inline void ham_impl_hash_accumulate_scalar(ham_u64 *acc, const char *p, ham_usize num_stripes){
+	for(ham_usize s = 0; s < num_stripes; s++){
+		const char *const stripe = p + (s * HAM_IMPL_HASH_STRIPE_SIZE);
+
+		for(ham_usize i = 0; i < 8; i++){
+			const ham_u64 d = ham_impl_hash_read64(stripe + (i * 8));
+			const ham_u64 k = d ^ ham_impl_hash_lane_key(i);
+			acc[i ^ 1] += d;
+			acc[i] += (k & 0xffffffffull) * (k >> 32);
+		}
+
+		if((s % HAM_IMPL_HASH_STRIPES_PER_BLOCK) == (HAM_IMPL_HASH_STRIPES_PER_BLOCK - 1)){
+			for(ham_usize i = 0; i < 8; i++){
+				acc[i] ^= acc[i] >> 47;
+				acc[i] ^= ham_impl_hash_lane_key(i);
+				acc[i] *= HAM_IMPL_HASH_SCRAMBLE_PRIME;
+			}
+		}
+	}
+}
+
+#if defined(HAM_HASH_SIMD_AVX2)
+
+ham_nothrow static inline void ham_impl_hash_accumulate_simd(ham_u64 *acc, const char *p, ham_usize num_stripes){
+	const __m256i k0 = _mm256_setr_epi64x(
+		(long long)ham_impl_hash_lane_key(0), (long long)ham_impl_hash_lane_key(1),
+		(long long)ham_impl_hash_lane_key(2), (long long)ham_impl_hash_lane_key(3)
+	);
+	const __m256i k1 = _mm256_setr_epi64x(
+		(long long)ham_impl_hash_lane_key(4), (long long)ham_impl_hash_lane_key(5),
+		(long long)ham_impl_hash_lane_key(6), (long long)ham_impl_hash_lane_key(7)
+	);
+	const __m256i prime = _mm256_set1_epi32((int)HAM_IMPL_HASH_SCRAMBLE_PRIME);
+
+	__m256i a0 = _mm256_loadu_si256((const __m256i*)acc);
+	__m256i a1 = _mm256_loadu_si256((const __m256i*)(acc + 4));
+
+	for(ham_usize s = 0; s < num_stripes; s++){
+		const char *const stripe = p + (s * HAM_IMPL_HASH_STRIPE_SIZE);
+
+		const __m256i d0 = _mm256_loadu_si256((const __m256i*)stripe);
+		const __m256i d1 = _mm256_loadu_si256((const __m256i*)(stripe + 32));
+
+		const __m256i x0 = _mm256_xor_si256(d0, k0);
+		const __m256i x1 = _mm256_xor_si256(d1, k1);
+
+		const __m256i p0 = _mm256_mul_epu32(x0, _mm256_srli_epi64(x0, 32));
+		const __m256i p1 = _mm256_mul_epu32(x1, _mm256_srli_epi64(x1, 32));
+
+		// swap neighbouring 64-bit lanes
+		const __m256i w0 = _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2));
+		const __m256i w1 = _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2));
+
+		a0 = _mm256_add_epi64(a0, _mm256_add_epi64(p0, w0));
+		a1 = _mm256_add_epi64(a1, _mm256_add_epi64(p1, w1));
+
+		if((s % HAM_IMPL_HASH_STRIPES_PER_BLOCK) == (HAM_IMPL_HASH_STRIPES_PER_BLOCK - 1)){
+			a0 = _mm256_xor_si256(_mm256_xor_si256(a0, _mm256_srli_epi64(a0, 47)), k0);
+			a1 = _mm256_xor_si256(_mm256_xor_si256(a1, _mm256_srli_epi64(a1, 47)), k1);
+
+			a0 = _mm256_add_epi64(_mm256_mul_epu32(a0, prime), _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a0, 32), prime), 32));
+			a1 = _mm256_add_epi64(_mm256_mul_epu32(a1, prime), _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a1, 32), prime), 32));
+		}
+	}
+
+	_mm256_storeu_si256((__m256i*)acc, a0);
+	_mm256_storeu_si256((__m256i*)(acc + 4), a1);
+}
+
+#elif defined(HAM_HASH_SIMD_SSE2)
+
+ham_nothrow static inline void ham_impl_hash_accumulate_simd(ham_u64 *acc, const char *p, ham_usize num_stripes){
+	const __m128i prime = _mm_set1_epi32((int)HAM_IMPL_HASH_SCRAMBLE_PRIME);
+
+	__m128i a[4], k[4];
+	for(int i = 0; i < 4; i++){
+		a[i] = _mm_loadu_si128((const __m128i*)(acc + (i * 2)));
+		k[i] = _mm_set_epi64x((long long)ham_impl_hash_lane_key((i * 2) + 1), (long long)ham_impl_hash_lane_key(i * 2));
+	}
+
+	for(ham_usize s = 0; s < num_stripes; s++){
+		const char *const stripe = p + (s * HAM_IMPL_HASH_STRIPE_SIZE);
+
+		for(int i = 0; i < 4; i++){
+			const __m128i d = _mm_loadu_si128((const __m128i*)(stripe + (i * 16)));
+			const __m128i x = _mm_xor_si128(d, k[i]);
+			const __m128i m = _mm_mul_epu32(x, _mm_srli_epi64(x, 32));
+			const __m128i w = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+			a[i] = _mm_add_epi64(a[i], _mm_add_epi64(m, w));
+		}
+
+		if((s % HAM_IMPL_HASH_STRIPES_PER_BLOCK) == (HAM_IMPL_HASH_STRIPES_PER_BLOCK - 1)){
+			for(int i = 0; i < 4; i++){
+				const __m128i x = _mm_xor_si128(_mm_xor_si128(a[i], _mm_srli_epi64(a[i], 47)), k[i]);
+				a[i] = _mm_add_epi64(_mm_mul_epu32(x, prime), _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), prime), 32));
+			}
+		}
+	}
+
+	for(int i = 0; i < 4; i++){
+		_mm_storeu_si128((__m128i*)(acc + (i * 2)), a[i]);
+	}
+}
+
+#elif defined(HAM_HASH_SIMD_NEON)
+
+ham_nothrow static inline void ham_impl_hash_accumulate_simd(ham_u64 *acc, const char *p, ham_usize num_stripes){
+	const uint32x2_t prime = vdup_n_u32(HAM_IMPL_HASH_SCRAMBLE_PRIME);
+
+	uint64x2_t a[4], k[4];
+	for(int i = 0; i < 4; i++){
+		const ham_u64 keys[2] = { ham_impl_hash_lane_key(i * 2), ham_impl_hash_lane_key((i * 2) + 1) };
+		a[i] = vld1q_u64(acc + (i * 2));
+		k[i] = vld1q_u64(keys);
+	}
+
+	for(ham_usize s = 0; s < num_stripes; s++){
+		const char *const stripe = p + (s * HAM_IMPL_HASH_STRIPE_SIZE);
+
+		for(int i = 0; i < 4; i++){
+			const uint64x2_t d = vreinterpretq_u64_u8(vld1q_u8((const uint8_t*)(stripe + (i * 16))));
+			const uint64x2_t x = veorq_u64(d, k[i]);
+			const uint64x2_t m = vmull_u32(vmovn_u64(x), vshrn_n_u64(x, 32));
+			const uint64x2_t w = vextq_u64(d, d, 1);
+			a[i] = vaddq_u64(a[i], vaddq_u64(m, w));
+		}
+
+		if((s % HAM_IMPL_HASH_STRIPES_PER_BLOCK) == (HAM_IMPL_HASH_STRIPES_PER_BLOCK - 1)){
+			for(int i = 0; i < 4; i++){
+				const uint64x2_t x = veorq_u64(veorq_u64(a[i], vshrq_n_u64(a[i], 47)), k[i]);
+				a[i] = vaddq_u64(vmull_u32(vmovn_u64(x), prime), vshlq_n_u64(vmull_u32(vshrn_n_u64(x, 32), prime), 32));
+			}
+		}
+	}
+
+	for(int i = 0; i < 4; i++){
+		vst1q_u64(acc + (i * 2), a[i]);
+	}
+}
+
+#endif // HAM_HASH_SIMD_*
+
+ham_constexpr ham_nothrow static inline void ham_impl_hash_accumulate(ham_u64 *acc, const char *p, ham_usize num_stripes){
+#ifdef HAM_HASH_SIMD
+#	ifdef __cplusplus
+	if(!std::is_constant_evaluated())
+#	endif
+	{
+		ham_impl_hash_accumulate_simd(acc, p, num_stripes);
+		return;
+	}
+#endif
+
+	ham_impl_hash_accumulate_scalar(acc, p, num_stripes);
+}
+
+/**
+ * Shared body of the fast hashes. The high half is only computed if `hi_ret` is non-null.
+ *
+ * Short inputs follow wyhash; inputs of at least `HAM_HASH_FAST_BULK_THRESHOLD` bytes go
+ * through the striped loop which vectorizes without changing the result.
+ */
+ham_constexpr ham_nothrow static inline ham_u64 ham_impl_hash_fast(const char *bytes, ham_usize len, ham_u64 seed, ham_u64 *hi_ret){
+	const char *p = bytes;
+
+	seed ^= ham_impl_hash_mix(seed ^ HAM_HASH_FAST_SECRET_0, HAM_HASH_FAST_SECRET_1);
+
+	if(len >= HAM_HASH_FAST_BULK_THRESHOLD){
+		ham_u64 acc[8] = {0};
+		for(ham_usize i = 0; i < 8; i++){
+			acc[i] = ham_impl_hash_lane_key(7 - i) ^ seed;
+		}
+
+		// the final (possibly partial) stripe overlaps the one before it
+		ham_impl_hash_accumulate(acc, p, (len - 1) / HAM_IMPL_HASH_STRIPE_SIZE);
+		ham_impl_hash_accumulate(acc, p + len - HAM_IMPL_HASH_STRIPE_SIZE, 1);
+
+		ham_u64 lo = (ham_u64)len * HAM_HASH_FAST_SECRET_0;
+		ham_u64 hi = ~((ham_u64)len * HAM_HASH_FAST_SECRET_1);
+
+		for(ham_usize i = 0; i < 8; i += 2){
+			lo += ham_impl_hash_mix(acc[i] ^ HAM_HASH_FAST_SECRET_2, acc[i + 1] ^ ham_impl_hash_lane_key(i));
+			if(hi_ret){
+				hi += ham_impl_hash_mix(acc[i] ^ HAM_HASH_FAST_SECRET_3, acc[i + 1] ^ ham_impl_hash_lane_key(i + 1));
+			}
+		}
+
+		if(hi_ret) *hi_ret = ham_impl_hash_avalanche(hi);
+		return ham_impl_hash_avalanche(lo);
+	}
+
+	ham_u64 a = 0, b = 0;
+
+	if(len <= 16){
+		if(len >= 4){
+			const ham_usize off = (len >> 3) << 2;
+			a = (ham_impl_hash_read32(p) << 32) | ham_impl_hash_read32(p + off);
+			b = (ham_impl_hash_read32(p + len - 4) << 32) | ham_impl_hash_read32(p + len - 4 - off);
+		}
+		else if(len > 0){
+			a = ham_impl_hash_read3(p, len);
+		}
+	}
+	else{
+		ham_usize i = len;
+
+		if(i > 48){
+			ham_u64 see1 = seed, see2 = seed;
+
+			do{
+				seed = ham_impl_hash_mix(ham_impl_hash_read64(p)      ^ HAM_HASH_FAST_SECRET_1, ham_impl_hash_read64(p + 8)  ^ seed);
+				see1 = ham_impl_hash_mix(ham_impl_hash_read64(p + 16) ^ HAM_HASH_FAST_SECRET_2, ham_impl_hash_read64(p + 24) ^ see1);
+				see2 = ham_impl_hash_mix(ham_impl_hash_read64(p + 32) ^ HAM_HASH_FAST_SECRET_3, ham_impl_hash_read64(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while(i > 48);
+
+			seed ^= see1 ^ see2;
+		}
+
+		while(i > 16){
+			seed = ham_impl_hash_mix(ham_impl_hash_read64(p) ^ HAM_HASH_FAST_SECRET_1, ham_impl_hash_read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+
+		// may reach back into already consumed bytes, len > 16 so it stays in bounds
+		a = ham_impl_hash_read64(p + i - 16);
+		b = ham_impl_hash_read64(p + i - 8);
+	}
+
+	a ^= HAM_HASH_FAST_SECRET_1;
+	b ^= seed;
+	ham_impl_hash_mum(&a, &b);
+
+	if(hi_ret) *hi_ret = ham_impl_hash_mix(b ^ HAM_HASH_FAST_SECRET_2 ^ len, a ^ HAM_HASH_FAST_SECRET_3);
+	return ham_impl_hash_mix(a ^ HAM_HASH_FAST_SECRET_0 ^ len, b ^ HAM_HASH_FAST_SECRET_1);
+}
+
+/**
+ * @brief Fast seeded 64-bit hash of a range of bytes.
+ * Gives the same result at compile-time and run-time, the run-time path of long inputs is vectorized where possible.
+ * @param bytes bytes to hash
+ * @param len number of bytes to hash
+ * @param seed value to seed the hash with
+ * @returns hash of the bytes
+ */
+ham_constexpr ham_nothrow static inline ham_u64 ham_hash_fast_64_seeded(const char *bytes, ham_usize len, ham_u64 seed){
+	return ham_impl_hash_fast(bytes, len, seed, NULL);
+}
+
+/**
+ * @brief Fast 64-bit hash of a range of bytes.
+ * @param bytes bytes to hash
+ * @param len number of bytes to hash
+ * @returns hash of the bytes
+ */
+ham_constexpr ham_nothrow static inline ham_u64 ham_hash_fast_64(const char *bytes, ham_usize len){
+	return ham_impl_hash_fast(bytes, len, 0, NULL);
+}
+
+/**
+ * @brief Fast seeded 128-bit hash of a range of bytes.
+ * The low half is equal to ``ham_hash_fast_64_seeded(bytes, len, seed)``.
+ * @param bytes bytes to hash
+ * @param len number of bytes to hash
+ * @param seed value to seed the hash with
+ * @returns hash of the bytes
+ */
+ham_constexpr ham_nothrow static inline ham_hash128 ham_hash_fast_128_seeded(const char *bytes, ham_usize len, ham_u64 seed){
+	ham_hash128 ret = { 0, 0 };
+	ret.lo = ham_impl_hash_fast(bytes, len, seed, &ret.hi);
+	return ret;
+}
+
+/**
+ * @brief Fast 128-bit hash of a range of bytes.
+ * @param bytes bytes to hash
+ * @param len number of bytes to hash
+ * @returns hash of the bytes
+ */
+ham_constexpr ham_nothrow static inline ham_hash128 ham_hash_fast_128(const char *bytes, ham_usize len){
+	return ham_hash_fast_128_seeded(bytes, len, 0);
+}
+
 //
 // UUID hashing functions
 //
 
 ham_constexpr ham_nothrow static inline ham_u32 ham_uuid_hash32(ham_uuid uuid){ return ham_hash_fnv1a_32(uuid.bytes, 16); }
-ham_constexpr ham_nothrow static inline ham_u64 ham_uuid_hash64(ham_uuid uuid){ return ham_hash_fnv1a_64(uuid.bytes, 16); }
+ham_constexpr ham_nothrow static inline ham_u64 ham_uuid_hash64(ham_uuid uuid){ return ham_hash_fast_64(uuid.bytes, 16); }
 
 #define ham_uuid_hash ham_uuid_hash64
 
@@ -119,7 +516,7 @@ ham_constexpr ham_nothrow static inline ham_u32 ham_str_hash32_utf32(ham_str32 s
 }
 
 ham_constexpr ham_nothrow static inline ham_u64 ham_str_hash64_utf8(ham_str8 str){
-	return ham_hash_fnv1a_64(str.ptr, str.len);
+	return ham_hash_fast_64(str.ptr, str.len);
 }
 
 ham_constexpr ham_nothrow static inline ham_u64 ham_str_hash64_utf16(ham_str16 str){
@@ -163,7 +560,7 @@ ham_constexpr ham_nothrow static inline ham_u64 ham_str_hash64_utf32(ham_str32 s
 }
 
 #define ham_hash32 ham_hash_fnv1a_32
-#define ham_hash64 ham_hash_fnv1a_64
+#define ham_hash64 ham_hash_fast_64
 
 #define ham_hash ham_hash64
 
@@ -200,6 +597,32 @@ namespace ham{
 		using namespace hash_literals;
 	}
 
+	//
+	// Hash function alternatives
+	//
+
+	constexpr static inline u64 hash_fnv1a(str8 bytes) noexcept{ return ham_hash_fnv1a_64(bytes.ptr(), bytes.len()); }
+
+	constexpr static inline u64 hash_fast(str8 bytes, u64 seed = 0) noexcept{ return ham_hash_fast_64_seeded(bytes.ptr(), bytes.len(), seed); }
+
+	constexpr static inline ham_hash128 hash_fast128(str8 bytes, u64 seed = 0) noexcept{ return ham_hash_fast_128_seeded(bytes.ptr(), bytes.len(), seed); }
+
+	/**
+	 * @brief FNV-1a string hasher for tables that need the legacy hash values.
+	 */
+	struct fnv1a_hash_functor{
+		constexpr ham_uptr operator()(const str8 &s) const noexcept{ return hash_fnv1a(s); }
+	};
+
+	/**
+	 * @brief Seedable fast string hasher, the default for ``str8`` keys.
+	 */
+	struct fast_hash_functor{
+		u64 seed = 0;
+
+		constexpr ham_uptr operator()(const str8 &s) const noexcept{ return hash_fast(s, seed); }
+	};
+
 	template<typename T>
 	struct hash_functor;
 
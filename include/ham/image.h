@@ -8,6 +8,7 @@
  */
 
 #include "ham/memory.h"
+#include "ham/fs.h"
 
 HAM_C_API_BEGIN
 
@@ -23,14 +24,34 @@ static inline ham_image *ham_image_create(ham_color_format format, ham_u32 w, ha
 
 ham_api ham_image *ham_image_create_view(const ham_image *img);
 
+/**
+ * Create an image that reads its pixels straight from memory owned by the caller.
+ * @param format format of \p pixels
+ * @param w width in pixels
+ * @param h height in pixels
+ * @param pixels tightly packed pixel data, must outlive the image
+ * @returns newly created image or ``NULL`` on error
+ */
+ham_api ham_image *ham_image_create_pixels_view(ham_color_format format, ham_u32 w, ham_u32 h, const void *pixels);
+
 ham_api void ham_image_destroy(ham_image *img);
 
 ham_api ham_image *ham_image_load_from_mem(ham_color_format format, ham_usize len, const void *data);
 ham_api ham_image *ham_image_load(ham_color_format format, ham_str8 filepath);
 
+/**
+ * Get the key a decoded image is stored under in the asset cache.
+ * @param format format the image is loaded as
+ * @param len size of the source
+ * @param data source contents
+ * @returns key of the cooked image
+ */
+ham_api ham_nothrow ham_asset_key ham_image_cache_key(ham_color_format format, ham_usize len, const void *data);
+
 ham_api const void *ham_image_pixels(const ham_image *img);
 ham_api ham_u32 ham_image_width(const ham_image *img);
 ham_api ham_u32 ham_image_height(const ham_image *img);
+ham_api ham_color_format ham_image_format(const ham_image *img);
 
 HAM_C_API_END
 
@@ -0,0 +1,106 @@
+/*
+ * Ham Runtime
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAM_INTERN_H
+#define HAM_INTERN_H 1
+
+/**
+ * @defgroup HAM_INTERN String interning
+ * @ingroup HAM
+ * @{
+ */
+
+#include "typedefs.h"
+
+HAM_C_API_BEGIN
+
+/**
+ * @brief Runtime-wide identifier of an interned string.
+ * Equal strings always intern to the same symbol, so comparing symbols compares strings.
+ */
+typedef ham_u32 ham_symbol;
+
+//! Not a symbol. Returned for empty strings, failed lookups and errors.
+#define HAM_SYMBOL_NULL ((ham_symbol)0)
+
+/**
+ * @brief Intern a string.
+ * Safe to call from any thread. Interned strings live until the process exits.
+ * @param str string to intern
+ * @returns symbol of \p str or `HAM_SYMBOL_NULL` if \p str is empty or on error
+ */
+ham_api ham_symbol ham_intern(ham_str8 str);
+
+/**
+ * @brief Find the symbol of an already interned string.
+ * Never allocates or blocks.
+ * @param str string to find
+ * @returns symbol of \p str or `HAM_SYMBOL_NULL` if it was never interned
+ */
+ham_api ham_nothrow ham_symbol ham_intern_find(ham_str8 str);
+
+/**
+ * @brief Get the string of a symbol.
+ * The returned view is stable and null-terminated.
+ * @param sym symbol to get the string of
+ * @returns interned string or an empty string for `HAM_SYMBOL_NULL` and unknown symbols
+ */
+ham_api ham_nothrow ham_str8 ham_symbol_str(ham_symbol sym);
+
+/**
+ * @brief Get the number of interned strings.
+ * @returns number of symbols handed out so far
+ */
+ham_api ham_nothrow ham_usize ham_intern_num_symbols();
+
+HAM_C_API_END
+
+#ifdef __cplusplus
+
+namespace ham{
+	class symbol{
+		public:
+			constexpr symbol() noexcept: m_sym(HAM_SYMBOL_NULL){}
+			constexpr explicit symbol(ham_symbol sym_) noexcept: m_sym(sym_){}
+
+			explicit symbol(str8 str_): m_sym(ham_intern(str_)){}
+
+			static symbol find(str8 str_) noexcept{ return symbol(ham_intern_find(str_)); }
+
+			constexpr explicit operator bool() const noexcept{ return m_sym != HAM_SYMBOL_NULL; }
+
+			constexpr bool operator==(const symbol &other) const noexcept{ return m_sym == other.m_sym; }
+			constexpr bool operator!=(const symbol &other) const noexcept{ return m_sym != other.m_sym; }
+
+			constexpr ham_symbol id() const noexcept{ return m_sym; }
+
+			str8 str() const noexcept{ return ham_symbol_str(m_sym); }
+			const char *c_str() const noexcept{ return ham_symbol_str(m_sym).ptr; }
+
+		private:
+			ham_symbol m_sym;
+	};
+}
+
+#endif // __cplusplus
+
+/**
+ * @}
+ */
+
+#endif // !HAM_INTERN_H
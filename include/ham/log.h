@@ -56,9 +56,61 @@ ham_constexpr ham_nothrow static inline const char *ham_log_level_str(ham_log_le
 
 typedef ham_usize(*ham_log_fn)(ham_timepoint tp, ham_log_level level, const char *api, const char *message, void *user);
 
+/**
+ * @defgroup HAM_LOG_STRUCTURED Structured logging
+ * Records that carry the format string and raw arguments instead of a formatted message,
+ * so the cost of formatting is paid by whoever reads the log rather than the thread logging.
+ * @{
+ */
+
+//! Argument kinds of a structured record, each encoded as a single tag byte followed by its payload.
+typedef enum ham_log_arg_kind{
+	HAM_LOG_ARG_I64,  //!< 8 byte signed integer
+	HAM_LOG_ARG_U64,  //!< 8 byte unsigned integer
+	HAM_LOG_ARG_F32,  //!< 4 byte float
+	HAM_LOG_ARG_F64,  //!< 8 byte double
+	HAM_LOG_ARG_BOOL, //!< 1 byte, 0 or 1
+	HAM_LOG_ARG_CHAR, //!< 1 byte character
+	HAM_LOG_ARG_PTR,  //!< 8 byte address
+	HAM_LOG_ARG_STR,  //!< 4 byte length followed by that many bytes, not null-terminated
+
+	HAM_LOG_ARG_KIND_COUNT,
+} ham_log_arg_kind;
+
+/**
+ * Header of a structured record. In memory it is immediately followed by the api name if `api_static` is false,
+ * then `args_size` bytes of encoded arguments. Unaligned payloads are read with `memcpy`.
+ */
+typedef struct ham_log_structured{
+	const char *fmt; //!< fmtlib format string, loggers that keep the record past the call copy it
+	const char *api; //!< api name if `api_static` is true, otherwise the name follows the header
+	ham_u32 fmt_len, api_len;
+	ham_u32 num_args, args_size;
+	bool api_static;
+} ham_log_structured;
+
+typedef ham_usize(*ham_log_structured_fn)(ham_timepoint tp, ham_log_level level, const ham_log_structured *record, void *user);
+
+/**
+ * @brief Format the arguments of a structured record.
+ * @param fmt format string of the record
+ * @param num_args number of encoded arguments
+ * @param args_size bytes of encoded arguments
+ * @param args encoded arguments
+ * @param buf_len size of \p buf including space for the null terminator
+ * @param buf buffer to write the null-terminated message into
+ * @returns length of the formatted message or `(ham_usize)-1` if the arguments are malformed; a format string that doesn't match the arguments is copied as-is
+ */
+ham_api ham_nothrow ham_usize ham_log_format_structured(ham_str8 fmt, ham_u32 num_args, ham_usize args_size, const void *args, ham_usize buf_len, char *buf);
+
+/**
+ * @}
+ */
+
 typedef struct ham_logger{
 	ham_log_fn log;
 	void *user;
+	ham_log_structured_fn log_structured; //!< Optional, if set the C++ logging functions hand it unformatted records where they can
 } ham_logger;
 
 //! @cond ignore
@@ -91,6 +143,85 @@ ham_nothrow static inline void ham_set_global_logger(const ham_logger *logger){
 	ham_impl_global_logger = logger ? logger : ham_impl_default_logger;
 }
 
+/**
+ * @defgroup HAM_LOG_ASYNC Asynchronous logging
+ * Loggers that hand records off to a background thread instead of writing them on the calling thread.
+ * Every producing thread gets its own lock-free ring buffer, so logging never takes a lock or blocks on I/O;
+ * when a ring is full the record is dropped and counted. Fatal records are never dropped and flush the logger before returning.
+ * @{
+ */
+
+#define HAM_ASYNC_LOGGER_DEFAULT_RING_SIZE (64 * 1024)
+#define HAM_ASYNC_LOGGER_DEFAULT_MAX_THREADS 64
+
+typedef struct ham_async_logger ham_async_logger;
+
+/**
+ * @brief Create an asynchronous logger and start its writer thread.
+ * @param sink logger the writer thread passes records on to or `NULL` for the default logger
+ * @param ring_size bytes of ring buffer per producing thread, rounded up to a power of 2
+ * @param max_threads maximum number of threads logging at once, records from any others are dropped
+ * @returns newly created logger or `NULL` on error
+ */
+ham_api ham_async_logger *ham_async_logger_create(const ham_logger *sink, ham_usize ring_size, ham_u32 max_threads);
+
+/**
+ * @brief Create an asynchronous logger that writes a binary log file instead of passing records on to a sink.
+ * Structured records are stored unformatted and formatted when the file is decoded with `ham_log_decode_file`.
+ * @param path path of the file to create or truncate
+ * @param ring_size bytes of ring buffer per producing thread, rounded up to a power of 2
+ * @param max_threads maximum number of threads logging at once, records from any others are dropped
+ * @returns newly created logger or `NULL` on error
+ */
+ham_api ham_async_logger *ham_async_logger_create_binary(ham_str8 path, ham_usize ring_size, ham_u32 max_threads);
+
+/**
+ * @brief Flush and destroy an asynchronous logger.
+ * Nothing may log through \p logger once this is called, so uninstall it before destroying it.
+ * @param logger logger to destroy
+ */
+ham_api ham_nothrow void ham_async_logger_destroy(ham_async_logger *logger);
+
+/**
+ * @brief Get the logger interface of an asynchronous logger, e.g. to pass to `ham_set_global_logger`.
+ * @param logger logger to get the interface of
+ * @returns logger interface or `NULL` on error
+ */
+ham_api ham_nothrow const ham_logger *ham_async_logger_get(const ham_async_logger *logger);
+
+/**
+ * @brief Wait until every record logged before this call has been written to the sink.
+ * @param logger logger to flush
+ * @returns whether the logger was flushed
+ */
+ham_api ham_nothrow bool ham_async_logger_flush(ham_async_logger *logger);
+
+/**
+ * @brief Flush every asynchronous logger that hasn't been destroyed, e.g. before unloading code records may have come from.
+ * @returns whether every logger was flushed
+ */
+ham_api ham_nothrow bool ham_async_logger_flush_all();
+
+/**
+ * @brief Get the number of records dropped because a ring buffer was full or no ring was free.
+ * @param logger logger to query
+ * @returns total number of dropped records
+ */
+ham_api ham_nothrow ham_usize ham_async_logger_num_dropped(const ham_async_logger *logger);
+
+/**
+ * @brief Decode a binary log file written by a logger from `ham_async_logger_create_binary`.
+ * Every record is formatted and passed on to \p out in the order it was written.
+ * @param path path of the file to decode
+ * @param out logger to pass decoded records on to or `NULL` for the default logger
+ * @returns number of records decoded or `(ham_usize)-1` on error
+ */
+ham_api ham_usize ham_log_decode_file(ham_str8 path, const ham_logger *out);
+
+/**
+ * @}
+ */
+
 #ifdef __GNUC__
 __attribute__((format(printf, 3, 4)))
 #endif
@@ -163,6 +294,8 @@ HAM_C_API_END
 
 #include "str_buffer.h"
 
+#include <utility>
+
 #if defined(__clang__) && !(__has_builtin(__builtin_source_location))
 #	include <experimental/source_location>
 	namespace ham::detail{ using source_location = std::experimental::source_location; };
@@ -183,6 +316,128 @@ namespace ham{
 		fatal = HAM_LOG_FATAL,
 	};
 
+	namespace detail{
+		template<typename T>
+		consteval ham_log_arg_kind log_arg_kind() noexcept{
+			using U = std::remove_cvref_t<T>;
+
+			if constexpr(std::is_same_v<U, bool>) return HAM_LOG_ARG_BOOL;
+			else if constexpr(std::is_same_v<U, char>) return HAM_LOG_ARG_CHAR;
+			else if constexpr(std::is_same_v<U, char8_t> || std::is_same_v<U, char16_t> || std::is_same_v<U, char32_t> || std::is_same_v<U, wchar_t>){
+				return HAM_LOG_ARG_KIND_COUNT;
+			}
+			else if constexpr(std::is_integral_v<U> && sizeof(U) <= sizeof(i64)){
+				return std::is_signed_v<U> ? HAM_LOG_ARG_I64 : HAM_LOG_ARG_U64;
+			}
+			else if constexpr(std::is_same_v<U, float>) return HAM_LOG_ARG_F32;
+			else if constexpr(std::is_same_v<U, double>) return HAM_LOG_ARG_F64;
+			else if constexpr(
+				std::is_convertible_v<const U&, const char*> ||
+				std::is_same_v<U, str8> || std::is_same_v<U, ham_str8> || std::is_same_v<U, str_buffer8> ||
+				std::is_same_v<U, std::string_view> || std::is_same_v<U, std::string> || std::is_same_v<U, fmt::string_view>
+			){
+				return HAM_LOG_ARG_STR;
+			}
+			else if constexpr(std::is_same_v<U, const void*> || std::is_same_v<U, void*> || std::is_null_pointer_v<U>) return HAM_LOG_ARG_PTR;
+			else return HAM_LOG_ARG_KIND_COUNT;
+		}
+
+		//! Whether every argument can be stored raw, anything else has to be formatted on the spot.
+		template<typename ... Args>
+		constexpr inline bool log_args_structured = ((log_arg_kind<Args>() != HAM_LOG_ARG_KIND_COUNT) && ...);
+
+		struct log_encoder{
+			char *cur, *end;
+
+			bool put(const void *data, usize len) noexcept{
+				if(len > usize(end - cur)) return false;
+				memcpy(cur, data, len);
+				cur += len;
+				return true;
+			}
+
+			template<typename T>
+			bool put_val(const T &val) noexcept{ return put(&val, sizeof(T)); }
+
+			bool put_str(std::string_view str) noexcept{
+				return put_val((u32)str.size()) && put(str.data(), str.size());
+			}
+		};
+
+		template<typename T>
+		static inline bool log_encode_arg(log_encoder &enc, const T &arg) noexcept{
+			using U = std::remove_cvref_t<T>;
+			constexpr ham_log_arg_kind kind = log_arg_kind<T>();
+
+			if(!enc.put_val((u8)kind)) return false;
+
+			if constexpr(kind == HAM_LOG_ARG_I64) return enc.put_val((i64)arg);
+			else if constexpr(kind == HAM_LOG_ARG_U64) return enc.put_val((u64)arg);
+			else if constexpr(kind == HAM_LOG_ARG_F32 || kind == HAM_LOG_ARG_F64 || kind == HAM_LOG_ARG_CHAR) return enc.put_val(arg);
+			else if constexpr(kind == HAM_LOG_ARG_BOOL) return enc.put_val((u8)arg);
+			else if constexpr(kind == HAM_LOG_ARG_PTR) return enc.put_val((u64)(uptr)arg);
+			else if constexpr(std::is_convertible_v<const U&, const char*>){
+				const char *const str = arg;
+				return enc.put_str(str ? std::string_view(str) : std::string_view());
+			}
+			else if constexpr(std::is_same_v<U, ham_str8>) return enc.put_str(std::string_view(arg.ptr, arg.len));
+			else if constexpr(std::is_same_v<U, str8> || std::is_same_v<U, str_buffer8>) return enc.put_str(std::string_view(arg.ptr(), arg.len()));
+			else return enc.put_str(std::string_view(arg.data(), arg.size()));
+		}
+
+		//! Formatted messages of the calling thread, short ones stay inline and long ones grow it rather than being cut off.
+		inline thread_local str_buffer8 log_message_buf;
+
+		/**
+		 * Format a message straight into the thread's message buffer.
+		 * Only falls back to the fixed size buffer, truncating the message, if the buffer can't grow.
+		 */
+		static inline const char *log_format(fmt::string_view fmt_str, fmt::format_args args) noexcept{
+			log_message_buf.clear();
+
+			if(log_message_buf.append_vformat(fmt_str, args)){
+				return log_message_buf.c_str();
+			}
+
+			const auto fmt_res = fmt::vformat_to_n(ham_impl_message_buf, sizeof(ham_impl_message_buf)-1, fmt_str, args);
+			*fmt_res.out = '\0';
+			return ham_impl_message_buf;
+		}
+
+		/**
+		 * Encode a structured record into the thread's message buffer and hand it to the logger.
+		 * Returns false without logging anything if the record doesn't fit, then the caller formats as usual.
+		 */
+		template<typename ... Args>
+		static inline bool log_structured(
+			const ham_logger *logger, ham_timepoint tp, log_level level,
+			fmt::string_view fmt_str, std::string_view api, bool api_static,
+			const Args &... args
+		) noexcept{
+			log_encoder enc{ ham_impl_message_buf + sizeof(ham_log_structured), ham_impl_message_buf + sizeof(ham_impl_message_buf) };
+
+			if(!api_static && !enc.put(api.data(), api.size())) return false;
+
+			const auto args_begin = enc.cur;
+			if(!(log_encode_arg(enc, args) && ...)) return false;
+
+			const ham_log_structured header{
+				.fmt = fmt_str.data(),
+				.api = api.data(),
+				.fmt_len = (u32)fmt_str.size(),
+				.api_len = (u32)api.size(),
+				.num_args = (u32)sizeof...(Args),
+				.args_size = (u32)(enc.cur - args_begin),
+				.api_static = api_static,
+			};
+
+			memcpy(ham_impl_message_buf, &header, sizeof(header));
+
+			logger->log_structured(tp, static_cast<ham_log_level>(level), (const ham_log_structured*)ham_impl_message_buf, logger->user);
+			return true;
+		}
+	}
+
 	template<typename ... Args>
 	static inline void log(log_level level, const char8 *api, const fmt::format_string<Args...> &fmt_str, Args &&... args) noexcept{
 		ham_timepoint log_tp = (ham_timepoint){ 0, 0 };
@@ -195,11 +450,24 @@ namespace ham{
 			return;
 		}
 
-		format_buffered(sizeof(ham_impl_message_buf), ham_impl_message_buf, fmt_str, std::forward<Args>(args)...);
+		if constexpr(detail::log_args_structured<Args...>){
+			const ham_logger *logger = ham_current_logger();
+
+			if(logger->log_structured && detail::log_structured(logger, log_tp, level, fmt::string_view(fmt_str), api ? api : "", false, args...)){
+			#ifdef HAM_DEBUG
+				if(static_cast<int>(level) > HAM_LOG_WARNING){
+					ham_breakpoint();
+				}
+			#endif
+				return;
+			}
+		}
+
+		const auto msg = detail::log_format(fmt_str, fmt::make_format_args(args...));
 
 		const ham_logger *logger = ham_current_logger();
 
-		logger->log(log_tp, static_cast<ham_log_level>(level), api, ham_impl_message_buf, logger->user);
+		logger->log(log_tp, static_cast<ham_log_level>(level), api, msg, logger->user);
 
 	#ifdef HAM_DEBUG
 		if(static_cast<int>(level) > HAM_LOG_WARNING){
@@ -292,17 +560,24 @@ namespace ham{
 			return;
 		}
 
-		// TODO: make this work without vformat
-		const auto fmt_res = fmt::vformat_to_n(
-			ham_impl_message_buf, sizeof(ham_impl_message_buf)-1,
-			fmt_str, fmt::make_format_args(std::forward<Args>(args)...)
-		);
+		if constexpr(detail::log_args_structured<Args...>){
+			const ham_logger *logger = ham_current_logger();
 
-		*fmt_res.out = '\0';
+			if(logger->log_structured && detail::log_structured(logger, log_tp, level, fmt_str.fmt_str(), fmt_str.loc().function_name(), true, args...)){
+			#ifdef HAM_DEBUG
+				if(static_cast<int>(level) > HAM_LOG_WARNING){
+					ham_breakpoint();
+				}
+			#endif
+				return;
+			}
+		}
+
+		const auto msg = detail::log_format(fmt_str.fmt_str(), fmt::make_format_args(args...));
 
 		const ham_logger *logger = ham_current_logger();
 
-		logger->log(log_tp, static_cast<ham_log_level>(level), fmt_str.loc().function_name(), ham_impl_message_buf, logger->user);
+		logger->log(log_tp, static_cast<ham_log_level>(level), fmt_str.loc().function_name(), msg, logger->user);
 
 	#ifdef HAM_DEBUG
 		if(static_cast<int>(level) > HAM_LOG_WARNING){
@@ -340,6 +615,41 @@ namespace ham{
 	static inline void logapifatal(const logapi_format_string &fmt_str, Args &&... args) noexcept{
 		logapi(log_level::fatal, fmt_str, std::forward<Args>(args)...);
 	}
+
+	class async_logger{
+		public:
+			async_logger(
+				const ham_logger *sink = nullptr,
+				usize ring_size = HAM_ASYNC_LOGGER_DEFAULT_RING_SIZE,
+				u32 max_threads = HAM_ASYNC_LOGGER_DEFAULT_MAX_THREADS
+			)
+				: m_handle(ham_async_logger_create(sink, ring_size, max_threads)){}
+
+			//! Create a logger writing a binary log to `path`, see `ham_async_logger_create_binary`.
+			explicit async_logger(
+				str8 path,
+				usize ring_size = HAM_ASYNC_LOGGER_DEFAULT_RING_SIZE,
+				u32 max_threads = HAM_ASYNC_LOGGER_DEFAULT_MAX_THREADS
+			)
+				: m_handle(ham_async_logger_create_binary(path, ring_size, max_threads)){}
+
+			async_logger(async_logger&&) noexcept = default;
+
+			async_logger &operator=(async_logger&&) noexcept = default;
+
+			explicit operator bool() const noexcept{ return (bool)m_handle; }
+
+			const ham_logger *get() const noexcept{ return ham_async_logger_get(m_handle.get()); }
+
+			bool flush() noexcept{ return ham_async_logger_flush(m_handle.get()); }
+
+			usize num_dropped() const noexcept{ return ham_async_logger_num_dropped(m_handle.get()); }
+
+			ham_async_logger *handle() const noexcept{ return m_handle.get(); }
+
+		private:
+			unique_handle<ham_async_logger*, ham_async_logger_destroy> m_handle;
+	};
 }
 
 #endif // __cplusplus
@@ -61,6 +61,27 @@ ham_api ham_object_manager *ham_object_manager_create(const ham_object_vtable *v
  */
 ham_api void ham_object_manager_destroy(ham_object_manager *manager);
 
+/**
+ * @brief Get the vtable objects in a manager are created with.
+ * @param manager manager to query
+ * @returns vtable of the managed object type or ``NULL`` on error
+ */
+ham_api const ham_object_vtable *ham_object_manager_vtable(const ham_object_manager *manager);
+
+typedef bool(*ham_object_migrate_fn)(ham_object *obj, const ham_object_vtable *old_vtable, void *user);
+
+/**
+ * @brief Switch every object in a manager over to a new vtable for the same type.
+ * This is how objects survive their plugin being reloaded, nothing may use the objects while it runs.
+ * @note The object layout can't change: \p vtable must have the same type id, size and alignment as the current one.
+ * @param manager manager to update
+ * @param vtable replacement vtable
+ * @param migrate optional function called on each object after its vtable was swapped, returns ``false`` on error
+ * @param user data passed in each call to \p migrate
+ * @returns whether every object was switched over and migrated
+ */
+ham_api bool ham_object_manager_set_vtable(ham_object_manager *manager, const ham_object_vtable *vtable, ham_object_migrate_fn migrate, void *user);
+
 /**
  * @brief Check if an object is managed by a given manager.
  * @param manager manager to query
@@ -137,6 +158,23 @@ ham_used static inline ham_object *ham_impl_object_new_init(
  */
 #define ham_object_new(manager, ...) (ham_impl_object_new_init(manager, nullptr, nullptr, HAM_NARGS(__VA_ARGS__) __VA_OPT__(,) __VA_ARGS__))
 
+/**
+ * @brief Create objects in bulk without constructing them.
+ * Every object is zeroed and given the vtable of \p manager before \p init_fn is called on it,
+ * the caller is responsible for bringing each one into a state its destructor accepts.
+ * @param manager manager to create the new objects with
+ * @param n number of objects to create
+ * @param init_fn initialization function, returns ``false`` to signal an error
+ * @param user data passed to \p init_fn
+ * @param ret array of at least \p n pointers receiving the new objects
+ * @returns number of objects created, on error every object after the last one created is released again
+ */
+ham_api ham_usize ham_object_new_uninit_n(
+	ham_object_manager *manager, ham_usize n,
+	ham_object_manager_iterate_fn init_fn, void *user,
+	ham_object **ret
+);
+
 /**
  * @brief Destroy a managed object.
  * @param manager manager \p obj belongs to
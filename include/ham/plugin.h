@@ -53,6 +53,43 @@ ham_api bool ham_plugin_find(const char *id, ham_str8 path, ham_plugin **plugin_
 
 ham_api ham_plugin *ham_plugin_load(ham_dso_handle dso, const char *plugin_id);
 
+/**
+ * @defgroup HAM_PLUGIN_DEFERRED Deferred loading
+ * @ingroup HAM_PLUGIN
+ * Optional plugins can be found on first use instead of at startup.
+ * @{
+ */
+
+typedef struct ham_plugin_deferred ham_plugin_deferred;
+
+/**
+ * Remember a plugin to find later, without searching for or opening anything yet.
+ * @param id an identifier to match with the plugin, see \ref ham_plugin_find
+ * @param path path to the directory to search or an empty string for \ref ham_plugin_default_path
+ * @returns newly created deferred plugin or ``NULL`` on error
+ */
+ham_api ham_plugin_deferred *ham_plugin_deferred_create(const char *id, ham_str8 path);
+
+/**
+ * Destroy a deferred plugin, unloading the plugin and closing its DSO if it was found.
+ * @param deferred deferred plugin to destroy
+ */
+ham_api void ham_plugin_deferred_destroy(ham_plugin_deferred *deferred);
+
+/**
+ * Get a deferred plugin, searching for it on the first call.
+ * The DSO is opened with every symbol bound like \ref ham_plugin_find does. If that fails,
+ * it is opened again with lazy binding and a warning is logged, so only calls needing a missing symbol fail.
+ * A plugin that couldn't be found isn't searched for again.
+ * @param deferred deferred plugin to get
+ * @returns the plugin, owned by \p deferred; or ``NULL`` if it couldn't be found
+ */
+ham_api ham_plugin *ham_plugin_deferred_get(ham_plugin_deferred *deferred);
+
+/**
+ * @}
+ */
+
 ham_api void ham_plugin_unload(ham_plugin *plugin);
 
 ham_api ham_str8    ham_plugin_dir(const ham_plugin *plugin);
@@ -68,12 +105,83 @@ ham_api ham_str8    ham_plugin_description(const ham_plugin *plugin);
 ham_api bool ham_plugin_init(ham_plugin *plugin);
 ham_api bool ham_plugin_fini(ham_plugin *plugin);
 
+/**
+ * Get an object vtable from a plugin by type id.
+ * Vtables are resolved the first time they are asked for, so plugins with many objects only pay for the ones used.
+ * @param plugin plugin to search
+ * @param name type id of the object
+ * @returns object vtable or ``NULL`` if \p plugin has no object \p name
+ */
 ham_api const ham_object_vtable *ham_plugin_object(const ham_plugin *plugin, ham_str8 name);
 
 typedef bool(*ham_plugin_iterate_objects_fn)(const ham_object_vtable *vtable, void *user);
 
+/**
+ * Iterate every object vtable in a plugin.
+ * The first call resolves all of them, which costs a walk of the DSO symbol table unless the plugin came from a cached manifest.
+ * @param plugin plugin to iterate
+ * @param fn function to call on each iteration or ``NULL`` to only count objects
+ * @param user data passed on each call to \p fn
+ * @returns number of objects iterated when \p fn returned ``false`` or we reached the end; or ``(ham_usize)-1`` on error
+ */
 ham_api ham_usize ham_plugin_iterate_objects(const ham_plugin *plugin, ham_plugin_iterate_objects_fn fn, void *user);
 
+/**
+ * @defgroup HAM_PLUGIN_RELOAD Hot reloading
+ * @ingroup HAM_PLUGIN
+ * A rebuilt plugin can be swapped in while the program is running.
+ * Objects in managers registered with \ref ham_plugin_add_object_manager keep their state and are switched over to the new vtables.
+ * Reloading only works for plugins whose object layouts didn't change.
+ * @{
+ */
+
+/**
+ * Register a manager of objects created from a plugin's vtables, so they're moved over when the plugin is reloaded.
+ * Registering a manager again replaces its migrate function.
+ * @param plugin plugin the objects came from
+ * @param manager manager holding the objects
+ * @param migrate optional function called on each object after a reload, see \ref ham_object_manager_set_vtable
+ * @param user data passed in each call to \p migrate
+ * @returns whether \p manager was registered
+ */
+ham_api bool ham_plugin_add_object_manager(ham_plugin *plugin, ham_object_manager *manager, ham_object_migrate_fn migrate, void *user);
+
+/**
+ * Stop moving a manager's objects over on reload, this must be done before destroying the manager.
+ * @param plugin plugin \p manager was registered with
+ * @param manager manager to remove
+ * @returns whether \p manager was registered
+ */
+ham_api bool ham_plugin_remove_object_manager(ham_plugin *plugin, ham_object_manager *manager);
+
+/**
+ * Check whether the DSO a plugin came from has changed on disk since it was loaded.
+ * @param plugin plugin to check
+ * @returns whether the plugin was rebuilt
+ */
+ham_api bool ham_plugin_changed(const ham_plugin *plugin);
+
+/**
+ * Reload a plugin from its rebuilt DSO.
+ * Nothing may use the plugin or its objects while this runs.
+ * Every registered manager is switched over to the new vtables, then if the plugin was initialized,
+ * the old copy is finished and the new copy initialized.
+ * If the new DSO can't be loaded, doesn't match the old one, an object fails to migrate or the new copy fails to initialize,
+ * every manager is switched back and the old copy keeps running. Migrations already done are not undone.
+ * Vtables, functions and strings from the old copy stay valid until the old DSO is closed,
+ * so callers holding any should take \p old_dso_ret and close it once they've let go of them.
+ * @param plugin plugin to reload
+ * @param[in,out] dso handle the plugin was loaded from, replaced by the new handle once the new copy is swapped in
+ * @param[out] old_dso_ret where to store the old handle for the caller to close, set to ``NULL`` if nothing was swapped;
+ *                         or ``NULL`` to close it straight away once every async logger is flushed
+ * @returns whether the new copy was swapped in
+ */
+ham_api bool ham_plugin_reload(ham_plugin *plugin, ham_dso_handle *dso, ham_dso_handle *old_dso_ret);
+
+/**
+ * @}
+ */
+
 typedef ham_uuid(*ham_plugin_uuid_fn)();
 typedef ham_str8(*ham_plugin_name_fn)();
 typedef ham_version(*ham_plugin_version_fn)();
@@ -212,6 +212,23 @@ ham_api bool ham_draw_group_instance_visit(
 	void *user
 );
 
+typedef bool(*ham_draw_group_instance_write_fn)(ham_draw_group_instance_data *insts, ham_u32 num, void *user);
+
+/**
+ * @brief Write many instances in place under a single lock.
+ * \p fn is handed the whole instance buffer, so values can be computed straight into it without staging them first.
+ * The buffer is only valid for the duration of the call.
+ * @param group group to modify
+ * @param fn function to write the instances
+ * @param user data passed to \p fn
+ * @returns result of \p fn or `false` on error
+ */
+ham_api bool ham_draw_group_instance_write(
+	ham_draw_group *group,
+	ham_draw_group_instance_write_fn fn,
+	void *user
+);
+
 ham_api ham_u32 ham_draw_group_num_instances(const ham_draw_group *group);
 
 ham_api const ham_image *ham_draw_group_image(const ham_draw_group *group, ham_usize idx);
@@ -398,6 +415,12 @@ namespace ham{
 				return ham_draw_group_instance_visit(m_ptr, idx, view_fn, user);
 			}
 
+			bool instance_write(ham_draw_group_instance_write_fn write_fn, void *user)
+				requires is_mutable
+			{
+				return ham_draw_group_instance_write(m_ptr, write_fn, user);
+			}
+
 		private:
 			pointer m_ptr;
 	};
@@ -444,6 +467,10 @@ namespace ham{
 				return ham_draw_group_instance_visit(m_handle.get(), idx, view_fn, user);
 			}
 
+			bool instance_write(ham_draw_group_instance_write_fn write_fn, void *user){
+				return ham_draw_group_instance_write(m_handle.get(), write_fn, user);
+			}
+
 		private:
 			explicit draw_group(ham_draw_group *group) noexcept
 				: m_handle(group){}
@@ -82,6 +82,28 @@ ham_api ham_shape *ham_shape_create_triangle_mesh(
 	const ham_shape_bone *bones
 );
 
+/**
+ * Create a triangle mesh that reads its data straight from memory owned by the caller.
+ * Unlike `ham_shape_create_triangle_mesh` nothing is copied or filled in, so every array must be given.
+ * @param num_points number of elements in each of \p verts \p norms \p uvs \p bone_indices and \p bone_weights
+ * @param num_indices number of elements in \p indices
+ * @param num_bones number of elements in \p bones , at least 1
+ * @returns newly created shape or ``NULL`` on error
+ * @note all arrays must outlive the shape
+ */
+ham_api ham_shape *ham_shape_create_triangle_mesh_view(
+	ham_u32 num_points,
+	const ham_vec3 *verts,
+	const ham_vec3 *norms,
+	const ham_vec2 *uvs,
+	const ham_vec4i *bone_indices,
+	const ham_vec4 *bone_weights,
+	ham_u32 num_indices,
+	const ham_u32 *indices,
+	ham_u32 num_bones,
+	const ham_shape_bone *bones
+);
+
 /**
  * Create a quadrilateral shape.
  * @param points points given in order top-left, top-right, bottom-left, bottom-right
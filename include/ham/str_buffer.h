@@ -34,6 +34,67 @@ typedef struct ham_str_buffer_utf8  ham_str_buffer_utf8;
 typedef struct ham_str_buffer_utf16 ham_str_buffer_utf16;
 typedef struct ham_str_buffer_utf32 ham_str_buffer_utf32;
 
+//! Bytes of string data stored inside the buffer object before spilling to the heap.
+#define HAM_STR_BUFFER_INLINE_BYTES 24
+
+//! Maximum inline string lengths, excluding the null terminator.
+#define HAM_STR_BUFFER_INLINE_CAPACITY_UTF8  ((HAM_STR_BUFFER_INLINE_BYTES / sizeof(ham_char8))  - 1)
+#define HAM_STR_BUFFER_INLINE_CAPACITY_UTF16 ((HAM_STR_BUFFER_INLINE_BYTES / sizeof(ham_char16)) - 1)
+#define HAM_STR_BUFFER_INLINE_CAPACITY_UTF32 ((HAM_STR_BUFFER_INLINE_BYTES / sizeof(ham_char32)) - 1)
+
+//! @cond ignore
+// `capacity` equal to the inline capacity means the string lives in `inline_mem`
+struct ham_str_buffer_utf8{
+	const ham_allocator *allocator;
+	ham_usize stored, capacity;
+	union{
+		ham_char8 *mem;
+		ham_char8 inline_mem[HAM_STR_BUFFER_INLINE_BYTES / sizeof(ham_char8)];
+	};
+};
+
+struct ham_str_buffer_utf16{
+	const ham_allocator *allocator;
+	ham_usize stored, capacity;
+	union{
+		ham_char16 *mem;
+		ham_char16 inline_mem[HAM_STR_BUFFER_INLINE_BYTES / sizeof(ham_char16)];
+	};
+};
+
+struct ham_str_buffer_utf32{
+	const ham_allocator *allocator;
+	ham_usize stored, capacity;
+	union{
+		ham_char32 *mem;
+		ham_char32 inline_mem[HAM_STR_BUFFER_INLINE_BYTES / sizeof(ham_char32)];
+	};
+};
+//! @endcond
+
+/**
+ * @brief Initialize a string buffer in-place.
+ * The buffer is always left valid (and empty on failure), so it must be finished either way.
+ * @param str_buf buffer to initialize
+ * @param allocator allocator for storage that doesn't fit inline
+ * @param str initial contents
+ * @returns whether the initial contents could be stored
+ */
+ham_api bool ham_str_buffer_init_allocator_utf8 (ham_str_buffer_utf8  *str_buf, const ham_allocator *allocator, ham_str8  str);
+ham_api bool ham_str_buffer_init_allocator_utf16(ham_str_buffer_utf16 *str_buf, const ham_allocator *allocator, ham_str16 str);
+ham_api bool ham_str_buffer_init_allocator_utf32(ham_str_buffer_utf32 *str_buf, const ham_allocator *allocator, ham_str32 str);
+
+static inline bool ham_str_buffer_init_utf8 (ham_str_buffer_utf8  *str_buf, ham_str8  str){ return ham_str_buffer_init_allocator_utf8 (str_buf, ham_current_allocator(), str); }
+static inline bool ham_str_buffer_init_utf16(ham_str_buffer_utf16 *str_buf, ham_str16 str){ return ham_str_buffer_init_allocator_utf16(str_buf, ham_current_allocator(), str); }
+static inline bool ham_str_buffer_init_utf32(ham_str_buffer_utf32 *str_buf, ham_str32 str){ return ham_str_buffer_init_allocator_utf32(str_buf, ham_current_allocator(), str); }
+
+/**
+ * @brief Free any storage owned by a string buffer initialized with ``ham_str_buffer_init_*``.
+ */
+ham_api ham_nothrow void ham_str_buffer_finish_utf8 (ham_str_buffer_utf8  *str_buf);
+ham_api ham_nothrow void ham_str_buffer_finish_utf16(ham_str_buffer_utf16 *str_buf);
+ham_api ham_nothrow void ham_str_buffer_finish_utf32(ham_str_buffer_utf32 *str_buf);
+
 ham_api ham_str_buffer_utf8  *ham_str_buffer_create_allocator_utf8 (const ham_allocator *allocator, ham_str8 str);
 ham_api ham_str_buffer_utf16 *ham_str_buffer_create_allocator_utf16(const ham_allocator *allocator, ham_str16 str);
 ham_api ham_str_buffer_utf32 *ham_str_buffer_create_allocator_utf32(const ham_allocator *allocator, ham_str32 str);
@@ -103,6 +164,25 @@ namespace ham{
 		template<typename Char>
 		using str_buffer_ctype_t = typename str_buffer_ctype<Char>::type;
 
+		template<typename Char>
+		constexpr inline usize str_buffer_inline_capacity = (HAM_STR_BUFFER_INLINE_BYTES / sizeof(Char)) - 1;
+
+		template<typename Char>
+		constexpr inline auto str_buffer_ctype_init_allocator = utf_conditional_t<
+			Char,
+			meta::static_fn<ham_str_buffer_init_allocator_utf8>,
+			meta::static_fn<ham_str_buffer_init_allocator_utf16>,
+			meta::static_fn<ham_str_buffer_init_allocator_utf32>
+		>{};
+
+		template<typename Char>
+		constexpr inline auto str_buffer_ctype_finish = utf_conditional_t<
+			Char,
+			meta::static_fn<ham_str_buffer_finish_utf8>,
+			meta::static_fn<ham_str_buffer_finish_utf16>,
+			meta::static_fn<ham_str_buffer_finish_utf32>
+		>{};
+
 		template<typename Char>
 		constexpr inline auto str_buffer_ctype_create_allocator = utf_conditional_t<
 			Char,
@@ -192,6 +272,11 @@ namespace ham{
 		>{};
 	}
 
+	/**
+	 * @brief Owning string buffer.
+	 * Strings of up to `HAM_STR_BUFFER_INLINE_BYTES` bytes (including the null terminator) are stored
+	 * inline without allocating. Because of this, views into a buffer are invalidated when it is moved.
+	 */
 	template<typename Char>
 	class basic_str_buffer{
 		public:
@@ -202,19 +287,25 @@ namespace ham{
 			using char_type = Char;
 			using str_type = basic_str<Char>;
 
-			basic_str_buffer(): m_handle(detail::str_buffer_ctype_create_allocator<Char>(ham_current_allocator(), str_type{})){}
+			static constexpr usize inline_capacity = detail::str_buffer_inline_capacity<Char>;
+
+			basic_str_buffer() noexcept
+				: basic_str_buffer(ham_current_allocator()){}
 
 			basic_str_buffer(const basic_str_buffer &other)
-				: m_handle(detail::str_buffer_ctype_create_allocator<Char>(ham_current_allocator(), other.get())){}
+				: basic_str_buffer(other.get(), ham_current_allocator()){}
 
-			explicit basic_str_buffer(const ham_allocator *allocator_)
-				: m_handle(detail::str_buffer_ctype_create_allocator<Char>(allocator_, str_type{})){}
+			explicit basic_str_buffer(const ham_allocator *allocator_) noexcept{
+				detail::str_buffer_ctype_init_allocator<Char>(&m_buf, allocator_, cstr_type{ nullptr, 0 });
+			}
 
-			basic_str_buffer(const str_type &str_ , const ham_allocator *allocator_ = ham_current_allocator())
-				: m_handle(detail::str_buffer_ctype_create_allocator<Char>(allocator_, str_)){}
+			basic_str_buffer(const str_type &str_ , const ham_allocator *allocator_ = ham_current_allocator()){
+				detail::str_buffer_ctype_init_allocator<Char>(&m_buf, allocator_, str_);
+			}
 
-			basic_str_buffer(const cstr_type &str_, const ham_allocator *allocator_ = ham_current_allocator())
-				: m_handle(detail::str_buffer_ctype_create_allocator<Char>(allocator_, str_)){}
+			basic_str_buffer(const cstr_type &str_, const ham_allocator *allocator_ = ham_current_allocator()){
+				detail::str_buffer_ctype_init_allocator<Char>(&m_buf, allocator_, str_);
+			}
 
 			template<usize N>
 			basic_str_buffer(const Char(&arr)[N], const ham_allocator *allocator_ = ham_current_allocator())
@@ -223,9 +314,24 @@ namespace ham{
 			basic_str_buffer(const Char *c_str_, const ham_allocator *allocator_ = ham_current_allocator())
 				: basic_str_buffer(str_type(c_str_), allocator_){}
 
-			basic_str_buffer(basic_str_buffer&&) noexcept = default;
+			basic_str_buffer(basic_str_buffer &&other) noexcept{
+				memcpy(&m_buf, &other.m_buf, sizeof(ctype));
+				other.reset_inline();
+			}
+
+			~basic_str_buffer(){
+				detail::str_buffer_ctype_finish<Char>(&m_buf);
+			}
 
-			basic_str_buffer &operator=(basic_str_buffer&&) noexcept = default;
+			basic_str_buffer &operator=(basic_str_buffer &&other) noexcept{
+				if(this != &other){
+					detail::str_buffer_ctype_finish<Char>(&m_buf);
+					memcpy(&m_buf, &other.m_buf, sizeof(ctype));
+					other.reset_inline();
+				}
+
+				return *this;
+			}
 
 			basic_str_buffer &operator=(const basic_str_buffer &other){
 				if(this != &other){
@@ -282,60 +388,102 @@ namespace ham{
 				return ret;
 			}
 
+			const ham_allocator *allocator() const noexcept{ return m_buf.allocator; }
+
 			bool reserve(usize req_capacity){
-				return detail::str_buffer_ctype_reserve<Char>(m_handle.get(), req_capacity);
+				return detail::str_buffer_ctype_reserve<Char>(&m_buf, req_capacity);
 			}
 
 			bool resize(usize req_size, char_type fill = char_type(' ')){
-				return detail::str_buffer_ctype_resize<Char>(m_handle.get(), req_size, fill);
+				return detail::str_buffer_ctype_resize<Char>(&m_buf, req_size, fill);
 			}
 
 			bool append(const str_type &str){
-				return detail::str_buffer_ctype_append<Char>(m_handle.get(), str);
+				return detail::str_buffer_ctype_append<Char>(&m_buf, str);
 			}
 
 			bool prepend(const str_type &str){
-				return detail::str_buffer_ctype_prepend<Char>(m_handle.get(), str);
+				return detail::str_buffer_ctype_prepend<Char>(&m_buf, str);
 			}
 
-			str_type get() const noexcept{
-				return detail::str_buffer_ctype_get<Char>(m_handle.get());
+			/**
+			 * @brief Format straight into the end of the buffer.
+			 * Nothing is allocated if the result fits into the spare capacity, otherwise the buffer grows once.
+			 * @returns whether the formatted string could be appended
+			 */
+			template<typename ... Args>
+				requires std::is_same_v<Char, char8>
+			bool append_format(fmt::format_string<Args...> fmt_str, Args &&... args){
+				return append_vformat(fmt_str, fmt::make_format_args(args...));
 			}
 
-			bool set(const str_type &str_){
-				return detail::str_buffer_ctype_set<Char>(m_handle.get(), str_);
+			bool append_vformat(fmt::string_view fmt_str, fmt::format_args args)
+				requires std::is_same_v<Char, char8>
+			{
+				const usize old_len = m_buf.stored;
+				const usize spare = m_buf.capacity - old_len;
+
+				const auto res = fmt::vformat_to_n(ptr() + old_len, spare, fmt_str, args);
+
+				if(res.size > spare){
+					const usize req_len = old_len + res.size;
+
+					// grow geometrically so repeated appends stay amortized
+					if(!reserve(req_len > m_buf.capacity * 2 ? req_len : m_buf.capacity * 2)){
+						ptr()[old_len] = Char(0);
+						return false;
+					}
+
+					fmt::vformat_to_n(ptr() + old_len, res.size, fmt_str, args);
+				}
+
+				m_buf.stored = old_len + res.size;
+				ptr()[m_buf.stored] = Char(0);
+				return true;
 			}
 
-			const Char *c_str() const noexcept{
-				return detail::str_buffer_ctype_c_str<Char>(m_handle.get());
+			void clear() noexcept{
+				m_buf.stored = 0;
+				ptr()[0] = Char(0);
 			}
 
-			Char *ptr() noexcept{
-				return detail::str_buffer_ctype_ptr<Char>(m_handle.get());
+			str_type get() const noexcept{ return str_type(ptr(), m_buf.stored); }
+
+			bool set(const str_type &str_){
+				return detail::str_buffer_ctype_set<Char>(&m_buf, str_);
 			}
 
-			const Char *ptr() const noexcept{ return c_str(); }
+			const Char *c_str() const noexcept{ return ptr(); }
 
-			usize len() const noexcept{ return get().len(); }
+			Char *ptr() noexcept{ return is_inline() ? m_buf.inline_mem : m_buf.mem; }
+			const Char *ptr() const noexcept{ return is_inline() ? m_buf.inline_mem : m_buf.mem; }
+
+			usize len() const noexcept{ return m_buf.stored; }
+			usize capacity() const noexcept{ return m_buf.capacity; }
+			bool empty() const noexcept{ return m_buf.stored == 0; }
+
+			//! Whether the string is stored inside the buffer object itself.
+			bool is_inline() const noexcept{ return m_buf.capacity == inline_capacity; }
 
 			bool push_back(Char ch){ return append(str_type(&ch, 1)); }
 
 			Char *begin() noexcept{ return ptr(); }
-
-			Char *end() noexcept{
-				const auto str_ = get();
-				return str_.ptr + str_.len;
-			}
+			Char *end() noexcept{ return ptr() + m_buf.stored; }
 
 			const Char *begin() const noexcept{ return ptr(); }
+			const Char *end() const noexcept{ return ptr() + m_buf.stored; }
 
-			const Char *end() const noexcept{
-				const auto str_ = get();
-				return str_.ptr + str_.len;
-			}
+			ctype *handle() noexcept{ return &m_buf; }
+			const ctype *handle() const noexcept{ return &m_buf; }
 
 		private:
-			unique_handle<ctype*, detail::str_buffer_ctype_destroy<Char>> m_handle;
+			void reset_inline() noexcept{
+				m_buf.stored = 0;
+				m_buf.capacity = inline_capacity;
+				m_buf.inline_mem[0] = Char(0);
+			}
+
+			ctype m_buf;
 	};
 
 	using str_buffer8  = basic_str_buffer<char8>;
@@ -362,10 +510,7 @@ namespace ham{
 	template<typename ... Args>
 	str_buffer8 format(fmt::format_string<Args...> fmt_str, Args &&... args){
 		str_buffer8 ret;
-		fmt::format_to(
-			std::back_inserter(ret),
-			fmt_str, std::forward<Args>(args)...
-		);
+		ret.append_vformat(fmt_str, fmt::make_format_args(args...));
 		return ret;
 	}
 
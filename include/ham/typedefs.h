@@ -721,7 +721,7 @@ typedef struct ham_str32{ const ham_char32 *ptr; ham_uptr len; } ham_str32;
 
 #	define HAM_IMPL_STR_NEQ(a, b) \
 		({	const ham_auto a__ = (a); const ham_auto b__ = (b); \
-			(a__.len == b__.len) ? false : HAM_IMPL_STR_CMP(a__, b__) != 0; })
+			(a__.len != b__.len) ? true : HAM_IMPL_STR_CMP(a__, b__) != 0; })
 
 #else // __cplusplus
 
@@ -747,7 +747,7 @@ typedef struct ham_str32{ const ham_char32 *ptr; ham_uptr len; } ham_str32;
 
 #	define HAM_IMPL_STR_NEQ(a, b) \
 		([](const auto a__, const auto b__) constexpr{ \
-			return (a__.len == b__.len) ? false : HAM_IMPL_STR_CMP(a__, b__) != 0; \
+			return (a__.len != b__.len) ? true : HAM_IMPL_STR_CMP(a__, b__) != 0; \
 		}((a), (b)))
 
 #endif // __GNUC__
@@ -954,79 +954,57 @@ ham_constexpr ham_nothrow static inline ham_uuid ham_str_to_uuid_utf8(ham_str8 u
 	return ret;
 }
 
-ham_used
-ham_nothrow static inline ham_usize ham_str_conv_utf16_utf8(ham_str16 str, ham_char8 *buf, ham_usize buf_len){
-	if(!buf || buf_len == 0){
-		return (ham_usize)-1;
-	}
-	else if(!str.ptr || !str.len){
-		buf[0] = '\0';
-		return 0;
-	}
+/**
+ * @brief Check a string is well-formed UTF-8.
+ * Overlong encodings, surrogates and code points past U+10FFFF are rejected.
+ * @param str string to check
+ * @returns whether \p str is valid
+ */
+ham_api ham_nothrow bool ham_str_validate_utf8(ham_str8 str);
 
-	ham_usize written = 0;
-	ham_char8 mb_buf[4];
-	mbstate_t mbstate;
-	memset(&mbstate, 0, sizeof(mbstate));
-
-	for(ham_usize i = 0; i < str.len; i++){
-		const ham_usize res = c16rtomb(mb_buf, str.ptr[i], &mbstate);
-		if(res == (ham_usize)-1){
-			// bad string
-			return (ham_usize)-1;
-		}
-		else if(res > 0){
-			const ham_usize total = written + res;
-			if(total >= buf_len){
-				// string too long
-				return (ham_usize)-1;
-			}
+//! @cond ignore
+#define HAM_IMPL_UTF8_KERNEL_SCALAR 0
+#define HAM_IMPL_UTF8_KERNEL_SSSE3  1
+#define HAM_IMPL_UTF8_KERNEL_AVX2   2
+#define HAM_IMPL_UTF8_KERNEL_COUNT  3
 
-			memcpy(buf + written, mb_buf, res);
-			written = total;
-		}
-	}
+/**
+ * Validate UTF-8 with one particular kernel instead of the one picked for this CPU, so every kernel can be tested.
+ * Returns whether \p kernel is available on this CPU and build, the result is written to \p ret .
+ */
+ham_api ham_nothrow bool ham_impl_str_validate_utf8_kernel(ham_u32 kernel, ham_str8 str, bool *ret);
+//! @endcond
 
-	buf[written] = '\0';
-	return written;
-}
+/**
+ * @brief Check a string is well-formed UTF-16, i.e. every surrogate is correctly paired.
+ * @param str string to check
+ * @returns whether \p str is valid
+ */
+ham_api ham_nothrow bool ham_str_validate_utf16(ham_str16 str);
 
-ham_used
-ham_nothrow static inline ham_usize ham_str_conv_utf32_utf8(ham_str32 str, ham_char8 *buf, ham_usize buf_len){
-	if(!buf || buf_len == 0){
-		return (ham_usize)-1;
-	}
-	else if(!str.ptr || !str.len){
-		buf[0] = '\0';
-		return 0;
-	}
+/**
+ * @brief Check every code point in a string is a Unicode scalar value.
+ * @param str string to check
+ * @returns whether \p str is valid
+ */
+ham_api ham_nothrow bool ham_str_validate_utf32(ham_str32 str);
 
-	ham_usize written = 0;
-	ham_char8 mb_buf[4];
-	mbstate_t mbstate;
-	memset(&mbstate, 0, sizeof(mbstate));
-
-	for(ham_usize i = 0; i < str.len; i++){
-		const ham_usize res = c32rtomb(mb_buf, str.ptr[i], &mbstate);
-		if(res == (ham_usize)-1){
-			// bad string
-			return (ham_usize)-1;
-		}
-		else if(res > 0){
-			const ham_usize total = written + res;
-			if(total >= buf_len){
-				// string too long
-				return (ham_usize)-1;
-			}
+/**
+ * @defgroup HAM_STR_CONV String conversion
+ * Every function writes a null-terminated string to \p buf and returns the number of characters written,
+ * not counting the terminator. If the source string is invalid or the result (plus terminator) doesn't fit in
+ * \p buf_len characters, `(ham_usize)-1` is returned.
+ * @{
+ */
 
-			memcpy(buf + written, mb_buf, res);
-			written = total;
-		}
-	}
+ham_api ham_nothrow ham_usize ham_str_conv_utf8_utf16(ham_str8  str, ham_char16 *buf, ham_usize buf_len);
+ham_api ham_nothrow ham_usize ham_str_conv_utf8_utf32(ham_str8  str, ham_char32 *buf, ham_usize buf_len);
+ham_api ham_nothrow ham_usize ham_str_conv_utf16_utf8(ham_str16 str, ham_char8  *buf, ham_usize buf_len);
+ham_api ham_nothrow ham_usize ham_str_conv_utf32_utf8(ham_str32 str, ham_char8  *buf, ham_usize buf_len);
 
-	buf[written] = '\0';
-	return written;
-}
+/**
+ * @}
+ */
 
 #define HAM_STR_CMP_UTF(n) HAM_CONCAT(ham_str_cmp_utf, n)
 #define HAM_STR_EQ_UTF(n)  HAM_CONCAT(ham_str_eq_utf, n)
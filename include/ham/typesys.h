@@ -104,6 +104,15 @@ ham_constexpr ham_nothrow static inline ham_type_info_flag ham_type_flags_info(h
 
 ham_api ham_nothrow const char *ham_type_name(const ham_type *type);
 
+/**
+ * @brief Get the precomputed structural hash of a type.
+ * Types are unique within a typeset, so two types are equal exactly when their pointers are.
+ * The hash is stable across typesets and can be used to match types between them.
+ * @param type type to get the hash of
+ * @returns 64-bit hash of \p type
+ */
+ham_api ham_nothrow ham_u64 ham_type_hash(const ham_type *type);
+
 ham_api ham_nothrow ham_usize ham_type_alignment(const ham_type *type);
 ham_api ham_nothrow ham_usize ham_type_size(const ham_type *type);
 
@@ -125,6 +134,47 @@ ham_api ham_nothrow const ham_object_vtable *ham_type_vptr(const ham_type *type)
 ham_api ham_nothrow ham_usize ham_type_num_members(const ham_type *type);
 ham_api ham_nothrow ham_usize ham_type_num_methods(const ham_type *type);
 
+/**
+ * @brief Get the byte offset of an object member.
+ * @param type object type
+ * @param idx index of the member
+ * @returns offset of the member from the start of the object or `(ham_usize)-1` on error
+ */
+ham_api ham_nothrow ham_usize ham_type_member_offset(const ham_type *type, ham_usize idx);
+
+/**
+ * @brief Get the number of padding bytes following an object member.
+ * Padding of the last member includes the tail padding of the object.
+ * @param type object type
+ * @param idx index of the member
+ * @returns number of padding bytes or `(ham_usize)-1` on error
+ */
+ham_api ham_nothrow ham_usize ham_type_member_padding(const ham_type *type, ham_usize idx);
+
+/**
+ * @brief Non-object field of a flattened object layout.
+ */
+typedef struct ham_type_field{
+	const ham_type *type;
+	ham_usize offset; //!< Offset from the start of the outermost object
+} ham_type_field;
+
+/**
+ * @brief Get the number of fields in the flattened layout of an object type.
+ * @param type object type
+ * @returns number of fields or `(ham_usize)-1` on error
+ */
+ham_api ham_nothrow ham_usize ham_type_num_fields(const ham_type *type);
+
+/**
+ * @brief Get the flattened layout of an object type.
+ * Members that are objects themselves are replaced by their own fields, so the table can be walked without recursion.
+ * Fields are in memory order and the table lives as long as the typeset.
+ * @param type object type
+ * @returns array of `ham_type_num_fields(type)` fields or `NULL` on error
+ */
+ham_api ham_nothrow const ham_type_field *ham_type_fields(const ham_type *type);
+
 typedef bool(*ham_type_members_iterate_fn)(ham_usize i, ham_str8 name, const ham_type *type, void *user);
 
 ham_api ham_usize ham_type_members_iterate(const ham_type *type, ham_type_members_iterate_fn fn, void *user);
@@ -133,6 +183,48 @@ typedef bool(*ham_type_methods_iterate_fn)(ham_usize i, ham_str8 name, ham_usize
 
 ham_api ham_usize ham_type_methods_iterate(const ham_type *type, ham_type_methods_iterate_fn fn, void *user);
 
+/**
+ * @}
+ */
+
+/**
+ * @defgroup HAM_TYPESYS_SERIALIZE Binary serialization
+ * @{
+ */
+
+typedef struct ham_buffer ham_buffer;
+
+/**
+ * @brief Check whether values of a type can be serialized.
+ * Numeric, string and object types made only of those are serializable; references are not.
+ * @param type type to check
+ * @returns whether \p type can be serialized
+ */
+ham_api bool ham_type_is_serializable(const ham_type *type);
+
+/**
+ * @brief Append the binary encoding of an array of objects to a buffer.
+ * Members are encoded in declaration order without padding; strings are encoded as a length followed by their code units.
+ * @param type type of every object
+ * @param num_objs number of objects in \p objs
+ * @param objs array of objects, laid out as described by \p type
+ * @param out initialized buffer to append to
+ * @returns number of bytes appended or `(ham_usize)-1` on error
+ */
+ham_api ham_usize ham_type_serialize(const ham_type *type, ham_usize num_objs, const void *objs, ham_buffer *out);
+
+/**
+ * @brief Decode an array of objects previously encoded with `ham_type_serialize`.
+ * Decoded strings point into \p data, so it must outlive the objects. If \p type contains UTF-16 or UTF-32 strings \p data must be aligned to their code unit size.
+ * @param type type of every object
+ * @param num_objs number of objects to decode into \p objs
+ * @param objs array to write the objects to
+ * @param len length of \p data in bytes
+ * @param data encoded data
+ * @returns number of bytes read or `(ham_usize)-1` on error
+ */
+ham_api ham_usize ham_type_deserialize(const ham_type *type, ham_usize num_objs, void *objs, ham_usize len, const void *data);
+
 /**
  * @}
  */
@@ -159,6 +251,13 @@ ham_api const ham_type *ham_typeset_bottom(const ham_typeset *ts);
 
 ham_api const ham_type *ham_typeset_void(const ham_typeset *ts);
 ham_api const ham_type *ham_typeset_unit(const ham_typeset *ts);
+/**
+ * @brief Get the reference type to another type.
+ * Derived types are hash-consed: repeated calls return the same pointer without building a name.
+ * @param ts typeset containing \p refed
+ * @param refed referenced type
+ * @returns reference type or `NULL` on error
+ */
 ham_api const ham_type *ham_typeset_ref(const ham_typeset *ts, const ham_type *refed);
 ham_api const ham_type *ham_typeset_object(const ham_typeset *ts, ham_str8 name);
 
@@ -170,6 +269,14 @@ ham_api const ham_type *ham_typeset_float(const ham_typeset *ts, ham_usize num_b
 
 ham_api const ham_type *ham_typeset_str(const ham_typeset *ts, ham_str_encoding encoding);
 
+/**
+ * @brief Get the vector type of \p n elements of type \p elem.
+ * Vectors of 2, 3 and 4 `f32` are `ham_vec2`, `ham_vec3` and `ham_vec4`.
+ * @param ts typeset containing \p elem
+ * @param elem scalar numeric element type
+ * @param n number of elements
+ * @returns vector type or `NULL` on error
+ */
 ham_api const ham_type *ham_typeset_vec(const ham_typeset *ts, const ham_type *elem, ham_usize n);
 
 /**
@@ -212,6 +319,7 @@ HAM_C_API_END
 #ifdef __cplusplus
 
 #include "meta.hpp"
+#include "buffer.h"
 
 #include <concepts>
 
@@ -257,6 +365,24 @@ namespace ham{
 
 			str8 name() const noexcept{ return ham_type_name(m_ptr); }
 
+			u64 hash() const noexcept{ return ham_type_hash(m_ptr); }
+
+			usize num_fields() const noexcept{ return ham_type_num_fields(m_ptr); }
+			const ham_type_field *fields() const noexcept{ return ham_type_fields(m_ptr); }
+
+			usize member_offset(usize idx) const noexcept{ return ham_type_member_offset(m_ptr, idx); }
+			usize member_padding(usize idx) const noexcept{ return ham_type_member_padding(m_ptr, idx); }
+
+			bool is_serializable() const{ return ham_type_is_serializable(m_ptr); }
+
+			usize serialize(usize num_objs, const void *objs, basic_buffer<char> &out) const{
+				return ham_type_serialize(m_ptr, num_objs, objs, out.handle());
+			}
+
+			usize deserialize(usize num_objs, void *objs, usize len, const void *data) const{
+				return ham_type_deserialize(m_ptr, num_objs, objs, len, data);
+			}
+
 		private:
 			pointer m_ptr;
 	};
@@ -374,6 +500,9 @@ namespace ham{
 
 			object_type get_object(str8 name) const noexcept{ return ham_typeset_object(m_ptr, name); }
 
+			type get_ref(type refed) const noexcept{ return ham_typeset_ref(m_ptr, refed); }
+			type get_vec(type elem, usize n) const noexcept{ return ham_typeset_vec(m_ptr, elem, n); }
+
 		private:
 			pointer m_ptr;
 
@@ -19,6 +19,7 @@
 #include "ham/memory.h"
 #include "ham/check.h"
 #include "ham/audio-object.h"
+#include "ham/fs.h"
 
 #include "sndfile.h"
 
@@ -35,11 +36,8 @@ struct ham_audio_data{
 	void *data;
 };
 
-ham_audio_data *ham_audio_data_load(ham_usize len, const void *data){
-	if(!ham_check(len && data)){
-		return nullptr;
-	}
-
+//! Decodes audio with libsndfile, skipping the cache.
+static ham_audio_data *ham_impl_audio_data_decode(ham_usize len, const void *data){
 	struct sf_user_data{
 		ham_usize len;
 		const unsigned char *beg, *end;
@@ -153,6 +151,114 @@ ham_audio_data *ham_audio_data_load(ham_usize len, const void *data){
 	return ptr;
 }
 
+//
+// Cooked audio
+//
+// Decoded samples behind a small header, stored in the asset cache under the source bytes.
+//
+
+struct ham_impl_audio_cooked_header{
+	ham_u32 format;
+	ham_u32 num_channels, num_frames, freq;
+};
+
+static ham_audio_data *ham_impl_audio_data_from_cooked(ham_usize len, const void *data){
+	if(len < sizeof(ham_impl_audio_cooked_header)) return nullptr;
+
+	const auto header = (const ham_impl_audio_cooked_header*)data;
+
+	const ham_usize buf_size = (ham_usize)header->num_channels * header->num_frames * sizeof(ham_f32);
+
+	if(
+		header->format != HAM_AUDIO_SAMPLE_F32 || !header->num_channels ||
+		len - sizeof(*header) != buf_size
+	){
+		return nullptr;
+	}
+
+	const auto allocator = ham_current_allocator();
+
+	const auto buf = ham_allocator_alloc(allocator, alignof(ham_f32), buf_size);
+	if(!buf){
+		ham_logapierrorf("Error allocating audio buffer");
+		return nullptr;
+	}
+
+	memcpy(buf, (const char*)data + sizeof(*header), buf_size);
+
+	const auto ptr = ham_allocator_new(allocator, ham_audio_data);
+	if(!ptr){
+		ham_logapierrorf("Error allocating ham_audio_data");
+		ham_allocator_free(allocator, buf);
+		return nullptr;
+	}
+
+	ptr->allocator    = allocator;
+	ptr->format       = HAM_AUDIO_SAMPLE_F32;
+	ptr->num_channels = header->num_channels;
+	ptr->num_frames   = header->num_frames;
+	ptr->freq         = header->freq;
+	ptr->data         = buf;
+
+	return ptr;
+}
+
+static void ham_impl_audio_data_store_cooked(ham_asset_key key, const ham_audio_data *audio){
+	const auto buf_size = ham_audio_data_size(audio);
+
+	const auto allocator = ham_current_allocator();
+
+	const auto cooked = (char*)ham_allocator_alloc(allocator, alignof(ham_impl_audio_cooked_header), sizeof(ham_impl_audio_cooked_header) + buf_size);
+	if(!cooked){
+		ham_logwarnf("ham_audio_data_load", "Error allocating %zu bytes for cooked audio", sizeof(ham_impl_audio_cooked_header) + buf_size);
+		return;
+	}
+
+	const ham_impl_audio_cooked_header header = { (ham_u32)audio->format, audio->num_channels, audio->num_frames, audio->freq };
+
+	memcpy(cooked, &header, sizeof(header));
+	memcpy(cooked + sizeof(header), audio->data, buf_size);
+
+	ham_asset_cache_store(key, sizeof(header) + buf_size, cooked);
+
+	ham_allocator_free(allocator, cooked);
+}
+
+ham_nothrow ham_asset_key ham_audio_data_cache_key(ham_usize len, const void *data){
+	const ham_u32 sample_format = HAM_AUDIO_SAMPLE_F32;
+	return ham_asset_key_from_mem(ham::str8("ham_audio/1"), sizeof(sample_format), &sample_format, len, data);
+}
+
+ham_audio_data *ham_audio_data_load(ham_usize len, const void *data){
+	if(!ham_check(len && data)){
+		return nullptr;
+	}
+
+	if(!ham_asset_cache_dir().len){
+		return ham_impl_audio_data_decode(len, data);
+	}
+
+	const auto key = ham_audio_data_cache_key(len, data);
+
+	ham_usize cooked_len;
+	const auto cooked = ham_asset_cache_map(key, &cooked_len);
+	if(cooked){
+		const auto audio = ham_impl_audio_data_from_cooked(cooked_len, cooked);
+		ham_asset_cache_unmap(cooked, cooked_len);
+
+		if(audio) return audio;
+
+		ham_logapiwarnf("Ignoring bad cooked audio");
+	}
+
+	const auto audio = ham_impl_audio_data_decode(len, data);
+	if(audio){
+		ham_impl_audio_data_store_cooked(key, audio);
+	}
+
+	return audio;
+}
+
 void ham_audio_data_destroy(ham_audio_data *data){
 	if(!data) return;
 
@@ -39,6 +39,9 @@ struct ham_colony{
 
 	mutable ham::mutex mut;
 	ham::std_vector<std::pair<ham_usize, void*>> elements;
+
+	//! No element before this index has a free slot straight after it.
+	ham_usize free_hint;
 };
 
 ham_nonnull_args(1, 2)
@@ -104,6 +107,7 @@ ham_colony *ham_colony_create(ham_usize obj_alignment, ham_usize obj_size){
 	memset(ptr->buckets + 1, 0, sizeof(ptr->buckets) - sizeof(void*));
 	ptr->buckets[0] = bucket0;
 	ptr->elements = ham::std_vector<std::pair<ham_usize, void*>>(allocator);
+	ptr->free_hint = 0;
 
 	return ptr;
 }
@@ -122,18 +126,17 @@ ham_nothrow void ham_colony_destroy(ham_colony *colony){
 	ham_allocator_delete(allocator, colony);
 }
 
-void *ham_colony_emplace(ham_colony *colony){
-	if(!ham_check(colony != NULL)) return nullptr;
-
-	ham::scoped_lock lock(colony->mut);
-
+//! Caller must hold the colony lock.
+ham_nonnull_args(1)
+static inline void *ham_impl_colony_emplace(ham_colony *colony){
 	if(colony->elements.empty()){
 		const auto elem = colony->buckets[0];
 		colony->elements.emplace_back(0, elem);
+		colony->free_hint = 0;
 		return elem;
 	}
 
-	for(ham_usize i = 0; i < colony->elements.size(); i++){
+	for(ham_usize i = colony->free_hint; i < colony->elements.size(); i++){
 		const auto &elem = colony->elements[i];
 		const auto elem_bucket = colony->buckets[elem.first];
 		const auto elem_bucket_end = (char*)elem_bucket + ham_impl_colony_get_bucket_size(elem.first);
@@ -156,6 +159,7 @@ void *ham_colony_emplace(ham_colony *colony){
 			return nullptr;
 		}
 
+		colony->free_hint = i + 1;
 		return req_ptr;
 	}
 
@@ -169,10 +173,51 @@ void *ham_colony_emplace(ham_colony *colony){
 
 	// this is a sorted insert too
 	colony->elements.emplace_back(std::make_pair(new_bucket_idx, new_elem_ptr));
+	colony->free_hint = colony->elements.size() - 1;
 
 	return new_elem_ptr;
 }
 
+//! Caller must hold the colony lock, an erased element leaves a free slot after the one before it.
+static inline void ham_impl_colony_erase_at(ham_colony *colony, ham_usize idx){
+	colony->elements.erase(colony->elements.begin() + idx);
+	colony->free_hint = ham_min(colony->free_hint, idx ? idx - 1 : 0);
+}
+
+void *ham_colony_emplace(ham_colony *colony){
+	if(!ham_check(colony != NULL)) return nullptr;
+
+	ham::scoped_lock lock(colony->mut);
+
+	return ham_impl_colony_emplace(colony);
+}
+
+bool ham_colony_emplace_n(ham_colony *colony, ham_usize n, void **ret){
+	if(!ham_check(colony != NULL) || !ham_check(n == 0 || ret != NULL)) return false;
+
+	ham::scoped_lock lock(colony->mut);
+
+	if(colony->elements.capacity() < colony->elements.size() + n){
+		colony->elements.reserve(colony->elements.size() + n);
+	}
+
+	for(ham_usize i = 0; i < n; i++){
+		ret[i] = ham_impl_colony_emplace(colony);
+		if(ret[i]) continue;
+
+		for(ham_usize j = i; j-- > 0;){
+			const auto bucket_idx = ham_impl_colony_find_bucket(colony, ret[j]);
+			const auto req_elem = std::make_pair(bucket_idx, ret[j]);
+			const auto elem_res = std::lower_bound(colony->elements.begin(), colony->elements.end(), req_elem);
+			ham_impl_colony_erase_at(colony, (ham_usize)(elem_res - colony->elements.begin()));
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
 ham_nothrow bool ham_colony_erase(ham_colony *colony, void *ptr){
 	if(!ham_check(colony != NULL)) return false;
 	else if(!ptr) return false;
@@ -191,7 +236,7 @@ ham_nothrow bool ham_colony_erase(ham_colony *colony, void *ptr){
 		return false;
 	}
 
-	colony->elements.erase(elem_res);
+	ham_impl_colony_erase_at(colony, (ham_usize)(elem_res - colony->elements.begin()));
 	return true;
 }
 
@@ -228,7 +273,7 @@ bool ham_colony_view_erase(ham_colony *colony, void *ptr, ham_colony_iterate_fn
 
 	if(view_fn) view_fn(ptr, user);
 
-	colony->elements.erase(elem_res);
+	ham_impl_colony_erase_at(colony, (ham_usize)(elem_res - colony->elements.begin()));
 	return true;
 }
 
@@ -0,0 +1,233 @@
+/*
+ * Ham Runtime
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/compress.h"
+#include "ham/check.h"
+
+using namespace ham::typedefs;
+
+//
+// LZ4 block format
+//
+// A block is a run of sequences, each a token byte (literal count in the high nibble, match
+// length minus 4 in the low nibble, 15 meaning more length bytes follow), the literals, then a
+// 2 byte little-endian offset back into the output. The last sequence has literals only, the last
+// 5 bytes are always literals and the last match starts at least 12 bytes before the end.
+//
+
+constexpr usize ham_impl_lz4_min_match = 4;
+constexpr usize ham_impl_lz4_last_literals = 5;
+constexpr usize ham_impl_lz4_match_limit = 12;
+constexpr usize ham_impl_lz4_max_offset = 65535;
+constexpr u32 ham_impl_lz4_hash_bits = 12;
+
+static inline u32 ham_impl_lz4_read32(const u8 *p){
+	u32 ret;
+	memcpy(&ret, p, sizeof(ret));
+	return ret;
+}
+
+static inline u32 ham_impl_lz4_hash(u32 seq){
+	return (seq * 2654435761u) >> (32 - ham_impl_lz4_hash_bits);
+}
+
+//! Write a length continuation after a saturated nibble.
+static inline bool ham_impl_lz4_put_len(u8 *&op, const u8 *oend, usize len){
+	while(len >= 255){
+		if(op >= oend) return false;
+		*op++ = 255;
+		len -= 255;
+	}
+
+	if(op >= oend) return false;
+	*op++ = (u8)len;
+	return true;
+}
+
+static inline bool ham_impl_lz4_put_literals(u8 *&op, const u8 *oend, u8 *token, const u8 *lit, usize num_lit){
+	if(num_lit >= 15){
+		*token = 15 << 4;
+		if(!ham_impl_lz4_put_len(op, oend, num_lit - 15)) return false;
+	}
+	else{
+		*token = (u8)(num_lit << 4);
+	}
+
+	if(num_lit > usize(oend - op)) return false;
+
+	memcpy(op, lit, num_lit);
+	op += num_lit;
+	return true;
+}
+
+HAM_C_API_BEGIN
+
+ham_usize ham_lz4_compress(ham_usize len, const void *src, ham_usize dst_cap, void *dst){
+	if(!ham_check(len == 0 || src != NULL) || !ham_check(dst != NULL) || !ham_check(len <= 0x7fffffff)){
+		return 0;
+	}
+
+	const auto ibase = (const u8*)src;
+	const auto iend = ibase + len;
+
+	auto op = (u8*)dst;
+	const auto oend = op + dst_cap;
+
+	const u8 *anchor = ibase;
+
+	if(len > ham_impl_lz4_match_limit){
+		u32 table[1u << ham_impl_lz4_hash_bits];
+		memset(table, 0, sizeof(table));
+
+		const u8 *const mflimit = iend - ham_impl_lz4_match_limit;
+		const u8 *const matchlimit = iend - ham_impl_lz4_last_literals;
+
+		const u8 *ip = ibase + 1;
+
+		while(ip < mflimit){
+			const u32 seq = ham_impl_lz4_read32(ip);
+			const u32 h = ham_impl_lz4_hash(seq);
+
+			const u8 *ref = ibase + table[h];
+			table[h] = (u32)(ip - ibase);
+
+			if(ref >= ip || usize(ip - ref) > ham_impl_lz4_max_offset || ham_impl_lz4_read32(ref) != seq){
+				++ip;
+				continue;
+			}
+
+			// grow the match backwards into the pending literals
+			while(ip > anchor && ref > ibase && ip[-1] == ref[-1]){
+				--ip;
+				--ref;
+			}
+
+			usize match_len = ham_impl_lz4_min_match;
+			while(ip + match_len < matchlimit && ip[match_len] == ref[match_len]){
+				++match_len;
+			}
+
+			if(op >= oend) return 0;
+			const auto token = op++;
+
+			if(!ham_impl_lz4_put_literals(op, oend, token, anchor, usize(ip - anchor))) return 0;
+
+			if(usize(oend - op) < 2) return 0;
+
+			const usize offset = usize(ip - ref);
+			*op++ = (u8)(offset & 0xff);
+			*op++ = (u8)(offset >> 8);
+
+			const usize extra = match_len - ham_impl_lz4_min_match;
+			if(extra >= 15){
+				*token |= 15;
+				if(!ham_impl_lz4_put_len(op, oend, extra - 15)) return 0;
+			}
+			else{
+				*token |= (u8)extra;
+			}
+
+			ip += match_len;
+			anchor = ip;
+
+			if(ip < mflimit){
+				table[ham_impl_lz4_hash(ham_impl_lz4_read32(ip - 2))] = (u32)(ip - 2 - ibase);
+			}
+		}
+	}
+
+	if(op >= oend) return 0;
+	const auto token = op++;
+
+	if(!ham_impl_lz4_put_literals(op, oend, token, anchor, usize(iend - anchor))) return 0;
+
+	return usize(op - (u8*)dst);
+}
+
+ham_usize ham_lz4_decompress(ham_usize len, const void *src, ham_usize dst_cap, void *dst){
+	if(!ham_check(len == 0 || src != NULL) || !ham_check(dst_cap == 0 || dst != NULL)){
+		return (usize)-1;
+	}
+
+	const auto ibase = (const u8*)src;
+	const auto iend = ibase + len;
+
+	const auto obase = (u8*)dst;
+	const auto oend = obase + dst_cap;
+
+	const u8 *ip = ibase;
+	u8 *op = obase;
+
+	const auto get_len = [&](usize *len_ret){
+		u8 b;
+		do{
+			if(ip >= iend) return false;
+			b = *ip++;
+			*len_ret += b;
+		} while(b == 255);
+
+		return true;
+	};
+
+	while(ip < iend){
+		const u8 token = *ip++;
+
+		usize num_lit = token >> 4;
+		if(num_lit == 15 && !get_len(&num_lit)) return (usize)-1;
+
+		if(num_lit > usize(iend - ip) || num_lit > usize(oend - op)) return (usize)-1;
+
+		memcpy(op, ip, num_lit);
+		op += num_lit;
+		ip += num_lit;
+
+		// the last sequence has no match
+		if(ip == iend) break;
+
+		if(usize(iend - ip) < 2) return (usize)-1;
+
+		const usize offset = usize(ip[0]) | (usize(ip[1]) << 8);
+		ip += 2;
+
+		if(offset == 0 || offset > usize(op - obase)) return (usize)-1;
+
+		usize match_len = token & 15;
+		if(match_len == 15 && !get_len(&match_len)) return (usize)-1;
+
+		match_len += ham_impl_lz4_min_match;
+
+		if(match_len > usize(oend - op)) return (usize)-1;
+
+		const u8 *match = op - offset;
+
+		if(offset >= match_len){
+			memcpy(op, match, match_len);
+			op += match_len;
+		}
+		else{
+			// overlapping matches repeat the last `offset` bytes
+			for(usize i = 0; i < match_len; i++){
+				*op++ = *match++;
+			}
+		}
+	}
+
+	return usize(op - obase);
+}
+
+HAM_C_API_END
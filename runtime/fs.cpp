@@ -19,6 +19,13 @@
 #include "ham/fs.h"
 #include "ham/memory.h"
 #include "ham/check.h"
+#include "ham/async.h"
+#include "ham/compress.h"
+#include "ham/hash.h"
+#include "ham/intern.h"
+#include "ham/flat_map.hpp"
+#include "ham/std_vector.hpp"
+#include "ham/str_buffer.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -35,9 +42,21 @@
 #	include <unistd.h>
 #endif
 
+#ifdef __linux__
+#	include <linux/io_uring.h>
+#	include <sys/syscall.h>
+#	include <sys/inotify.h>
+#	include <sys/eventfd.h>
+#	include <dirent.h>
+#	include <poll.h>
+#endif
+
 #include <errno.h>
 #include <magic.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <mutex>
 
 using namespace ham::typedefs;
@@ -82,15 +101,226 @@ static inline bool ham_impl_magic_init(){
 	return true;
 }
 
+//
+// Packed archives
+//
+// A pack is a single file mapped read-only in one go. Entries are sorted by the 64-bit hash of
+// their path and a table of buckets indexed by the top bits of the hash gives the range of
+// entries to check, so a lookup touches a couple of cache lines no matter how big the pack is.
+// Everything is stored in host byte order, which is little-endian on every platform we ship.
+//
+// | header | buckets | entries | strings | padding | entry data, each aligned to data_align |
+//
+
+#define HAM_IMPL_PACK_MAGIC "HAMPACK"
+constexpr u32 ham_impl_pack_version = 1;
+constexpr u32 ham_impl_pack_max_bucket_bits = 24;
+
+enum ham_impl_pack_compression: u32{
+	HAM_IMPL_PACK_STORED,
+	HAM_IMPL_PACK_LZ4,
+
+	HAM_IMPL_PACK_COMPRESSION_COUNT,
+};
+
+struct ham_impl_pack_header{
+	char magic[8];
+	u32 version;
+	u32 num_entries;
+	u32 bucket_bits;
+	u32 data_align;
+	u64 buckets_off;
+	u64 entries_off;
+	u64 strings_off;
+	u64 strings_size;
+	u64 data_off;
+};
+
+struct ham_impl_pack_entry{
+	u64 hash;
+	u64 off, size, stored_size;
+	u32 path_off, path_len;
+	u32 mime_off, mime_len;
+	u32 compression;
+	u32 reserved;
+};
+
+static_assert(sizeof(ham_impl_pack_header) == 64);
+static_assert(sizeof(ham_impl_pack_entry) == 56);
+
+struct ham_pack{
+	const ham_allocator *allocator;
+	std::atomic<u32> refs;
+
+	void *mapping;
+	usize mapping_len;
+
+	const ham_impl_pack_header *header;
+	const u32 *buckets;
+	const ham_impl_pack_entry *entries;
+	const char *strings;
+};
+
+static inline u64 ham_impl_pack_hash(ham_str8 path){
+	return ham_hash_fast_64(path.ptr, path.len);
+}
+
+static inline u32 ham_impl_pack_bucket(u64 hash, u32 bucket_bits){
+	return bucket_bits ? (u32)(hash >> (64 - bucket_bits)) : 0;
+}
+
+static inline const ham_impl_pack_entry *ham_impl_pack_find(const ham_pack *pack, ham_str8 path){
+	const u64 hash = ham_impl_pack_hash(path);
+	const u32 bucket = ham_impl_pack_bucket(hash, pack->header->bucket_bits);
+
+	for(u32 i = pack->buckets[bucket]; i < pack->buckets[bucket + 1]; i++){
+		const auto entry = pack->entries + i;
+		if(entry->hash != hash) continue;
+
+		if(entry->path_len == path.len && memcmp(pack->strings + entry->path_off, path.ptr, path.len) == 0){
+			return entry;
+		}
+	}
+
+	return nullptr;
+}
+
+static inline void ham_impl_pack_entry_info(const ham_pack *pack, const ham_impl_pack_entry *entry, ham_pack_entry_info *ret){
+	ret->path = (ham_str8){ pack->strings + entry->path_off, entry->path_len };
+	ret->mime = (ham_str8){ pack->strings + entry->mime_off, entry->mime_len };
+	ret->size = entry->size;
+	ret->stored_size = entry->stored_size;
+	ret->compressed = entry->compression != HAM_IMPL_PACK_STORED;
+}
+
+static inline void ham_impl_pack_acquire(ham_pack *pack){
+	pack->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void ham_impl_pack_release(ham_pack *pack){
+	if(pack->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+	if(munmap(pack->mapping, pack->mapping_len) != 0){
+		ham::logerror("ham_pack_close", "Error in munmap: {}", strerror(errno));
+	}
+
+	ham_allocator_delete(pack->allocator, pack);
+}
+
+//
+// Mounted packs
+//
+// Published as an immutable snapshot searched newest first, so a pack mounted later overrides the
+// same path in an earlier one. Lookups only take a reference to the current snapshot and never
+// block on each other; mounting and unmounting copy the table and swap the new one in.
+//
+
+struct ham_impl_fs_mount{
+	ham_pack *pack;
+	ham::str_buffer8 point;
+};
+
+struct ham_impl_fs_mount_snapshot{
+	ham::std_vector<ham_impl_fs_mount> mounts;
+
+	ham_impl_fs_mount_snapshot() = default;
+
+	ham_impl_fs_mount_snapshot(const ham_impl_fs_mount_snapshot &other)
+		: mounts(other.mounts)
+	{
+		for(const auto &mount : mounts){
+			ham_impl_pack_acquire(mount.pack);
+		}
+	}
+
+	// every mount holds a reference to its pack, so lookups still in a replaced snapshot stay valid
+	~ham_impl_fs_mount_snapshot(){
+		for(const auto &mount : mounts){
+			ham_impl_pack_release(mount.pack);
+		}
+	}
+};
+
+struct ham_impl_fs_mount_table{
+	std::mutex mut; //!< Only serializes writers
+	std::atomic<u32> num_mounts{ 0 };
+	std::atomic<std::shared_ptr<const ham_impl_fs_mount_snapshot>> snapshot;
+};
+
+static inline ham_impl_fs_mount_table &ham_impl_fs_mounts(){
+	static ham_impl_fs_mount_table inst;
+	return inst;
+}
+
+/**
+ * Find a path in the mounted packs.
+ * On success the returned pack has been acquired and must be released by the caller.
+ */
+static ham_pack *ham_impl_fs_mount_find(ham_str8 path, const ham_impl_pack_entry **entry_ret){
+	auto &table = ham_impl_fs_mounts();
+	if(table.num_mounts.load(std::memory_order_acquire) == 0) return nullptr;
+
+	const auto snapshot = table.snapshot.load(std::memory_order_acquire);
+	if(!snapshot) return nullptr;
+
+	for(auto it = snapshot->mounts.rbegin(); it != snapshot->mounts.rend(); ++it){
+		const auto &mount = *it;
+		const usize point_len = mount.point.len();
+
+		ham_str8 rel = path;
+
+		if(point_len){
+			if(
+				path.len <= point_len ||
+				memcmp(path.ptr, mount.point.ptr(), point_len) != 0 ||
+				path.ptr[point_len] != '/'
+			){
+				continue;
+			}
+
+			rel = (ham_str8){ path.ptr + point_len + 1, path.len - point_len - 1 };
+		}
+
+		const auto entry = ham_impl_pack_find(mount.pack, rel);
+		if(entry){
+			ham_impl_pack_acquire(mount.pack);
+			*entry_ret = entry;
+			return mount.pack;
+		}
+	}
+
+	return nullptr;
+}
+
 struct ham_file{
 	const ham_allocator *allocator;
 	int fd;
+
+	// only set for files inside a mounted pack, which have no descriptor
+	ham_pack *pack = nullptr;
+	const ham_impl_pack_entry *entry = nullptr;
+	const char *data = nullptr;
+	char *decompressed = nullptr;
+	usize pos = 0;
 };
 
+static inline void ham_impl_pack_file_info(const ham_impl_pack_entry *entry, const ham_pack *pack, ham_file_info *ret){
+	ret->kind = HAM_FILE_REGULAR;
+	ret->size = entry->size;
+	ret->mime = (ham_str8){ pack->strings + entry->mime_off, entry->mime_len };
+}
+
 bool ham_path_exists_utf8(ham_str8 path){
 	ham_path_buffer_utf8 path_buf;
 	if(path.len >= HAM_PATH_BUFFER_SIZE) return false;
 
+	const ham_impl_pack_entry *entry;
+	const auto pack = ham_impl_fs_mount_find(path, &entry);
+	if(pack){
+		ham_impl_pack_release(pack);
+		return true;
+	}
+
 	memcpy(path_buf, path.ptr, path.len);
 	path_buf[path.len] = '\0';
 
@@ -103,7 +333,7 @@ bool ham_path_exists_utf16(ham_str16 path){
 	const usize path_len = ham_str_conv_utf16_utf8(path, path_buf, sizeof(path_buf)-1);
 	if(path_len == (usize)-1) return false;
 
-	return access(path_buf, F_OK) == 0;
+	return ham_path_exists_utf8((ham_str8){ path_buf, path_len });
 }
 
 bool ham_path_exists_utf32(ham_str32 path){
@@ -112,7 +342,364 @@ bool ham_path_exists_utf32(ham_str32 path){
 	const usize path_len = ham_str_conv_utf32_utf8(path, path_buf, sizeof(path_buf)-1);
 	if(path_len == (usize)-1) return false;
 
-	return access(path_buf, F_OK) == 0;
+	return ham_path_exists_utf8((ham_str8){ path_buf, path_len });
+}
+
+//
+// Built-in type detection
+//
+// The formats we load all the time are recognised by their leading bytes before asking libmagic.
+// Results are string literals spelled exactly as libmagic spells them, so callers comparing mime
+// strings can't tell the difference, and nothing is locked. Only a miss goes to libmagic, which
+// shares one cookie between every thread and has to be serialized.
+//
+
+constexpr usize ham_impl_mime_head_size = 4096;
+
+//! Bytes being probed, either all in memory or read from a file on demand.
+struct ham_impl_mime_probe{
+	const u8 *mem;
+	int fd;
+	usize size;
+
+	const u8 *head;
+	usize head_len;
+};
+
+static inline bool ham_impl_mime_probe_read(const ham_impl_mime_probe *probe, usize off, usize len, void *buf){
+	if(off > probe->size || len > probe->size - off) return false;
+
+	if(probe->mem){
+		memcpy(buf, probe->mem + off, len);
+		return true;
+	}
+
+	return pread(probe->fd, buf, len, (off_t)off) == (ssize_t)len;
+}
+
+static inline u64 ham_impl_mime_read_le(const u8 *bytes, usize size){
+	u64 ret = 0;
+	for(usize i = 0; i < size; i++){
+		ret |= u64(bytes[i]) << (i * 8);
+	}
+	return ret;
+}
+
+static inline bool ham_impl_mime_has_prefix(const ham_impl_mime_probe *probe, usize off, ham_str8 bytes){
+	return off <= probe->head_len && bytes.len <= probe->head_len - off && memcmp(probe->head + off, bytes.ptr, bytes.len) == 0;
+}
+
+//! Shared objects and position independent executables only differ by a flag in the dynamic section.
+static bool ham_impl_mime_elf_is_pie(const ham_impl_mime_probe *probe, bool is_64){
+	constexpr u32 pt_dynamic = 2;
+	constexpr u64 dt_flags_1 = 0x6ffffffb;
+	constexpr u64 df_1_pie = 0x08000000;
+
+	const auto head = probe->head;
+
+	const u64 phoff     = is_64 ? ham_impl_mime_read_le(head + 32, 8) : ham_impl_mime_read_le(head + 28, 4);
+	const usize phentsize = ham_impl_mime_read_le(head + (is_64 ? 54 : 42), 2);
+	const usize phnum     = ham_impl_mime_read_le(head + (is_64 ? 56 : 44), 2);
+
+	const usize word_size = is_64 ? 8 : 4;
+
+	if(phentsize < (is_64 ? 56 : 32)) return false;
+
+	for(usize i = 0; i < phnum; i++){
+		u8 phdr[56];
+		if(!ham_impl_mime_probe_read(probe, phoff + i * phentsize, is_64 ? 56 : 32, phdr)) return false;
+
+		if(ham_impl_mime_read_le(phdr, 4) != pt_dynamic) continue;
+
+		const u64 dyn_off  = is_64 ? ham_impl_mime_read_le(phdr + 8, 8)  : ham_impl_mime_read_le(phdr + 4, 4);
+		const u64 dyn_size = is_64 ? ham_impl_mime_read_le(phdr + 32, 8) : ham_impl_mime_read_le(phdr + 16, 4);
+
+		u8 dyns[64 * 16];
+		const usize dyn_entry_size = word_size * 2;
+
+		for(u64 off = 0; off + dyn_entry_size <= dyn_size; off += sizeof(dyns)){
+			const usize chunk_len = (usize)std::min<u64>(sizeof(dyns), (dyn_size - off) / dyn_entry_size * dyn_entry_size);
+			if(!ham_impl_mime_probe_read(probe, dyn_off + off, chunk_len, dyns)) return false;
+
+			for(usize j = 0; j < chunk_len; j += dyn_entry_size){
+				const u64 tag = ham_impl_mime_read_le(dyns + j, word_size);
+				if(tag == 0) return false;
+				else if(tag == dt_flags_1) return ham_impl_mime_read_le(dyns + j + word_size, word_size) & df_1_pie;
+			}
+		}
+
+		return false;
+	}
+
+	return false;
+}
+
+static const char *ham_impl_mime_elf(const ham_impl_mime_probe *probe){
+	if(probe->head_len < 64) return nullptr;
+
+	const u8 ei_class = probe->head[4], ei_data = probe->head[5];
+
+	// big-endian objects are rare enough to leave to libmagic
+	if((ei_class != 1 && ei_class != 2) || ei_data != 1) return nullptr;
+
+	switch(ham_impl_mime_read_le(probe->head + 16, 2)){
+		case 1: return "application/x-object; " HAM_MIME_ENCODING_BINARY;
+		case 2: return "application/x-executable; " HAM_MIME_ENCODING_BINARY;
+		case 4: return "application/x-coredump; " HAM_MIME_ENCODING_BINARY;
+
+		case 3:{
+			return ham_impl_mime_elf_is_pie(probe, ei_class == 2)
+				? "application/x-pie-executable; " HAM_MIME_ENCODING_BINARY
+				: HAM_MIME(HAM_MIME_TYPE_SO, HAM_MIME_ENCODING_BINARY);
+		}
+
+		default: return nullptr;
+	}
+}
+
+static const char *ham_impl_mime_ogg(const ham_impl_mime_probe *probe){
+	// the first packet of the first page says what the stream holds
+	if(
+		ham_impl_mime_has_prefix(probe, 28, HAM_LIT_UTF8("\x01vorbis")) ||
+		ham_impl_mime_has_prefix(probe, 28, HAM_LIT_UTF8("OpusHead")) ||
+		ham_impl_mime_has_prefix(probe, 28, HAM_LIT_UTF8("\x7f" "FLAC")) ||
+		ham_impl_mime_has_prefix(probe, 28, HAM_LIT_UTF8("Speex   "))
+	){
+		return HAM_MIME(HAM_MIME_TYPE_OGA, HAM_MIME_ENCODING_BINARY);
+	}
+	else if(ham_impl_mime_has_prefix(probe, 28, HAM_LIT_UTF8("\x80theora"))){
+		return HAM_MIME(HAM_MIME_TYPE_OGV, HAM_MIME_ENCODING_BINARY);
+	}
+
+	return HAM_MIME(HAM_MIME_TYPE_OGX, HAM_MIME_ENCODING_BINARY);
+}
+
+static inline bool ham_impl_mime_is_space(u8 c){
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool ham_impl_mime_is_ascii(const u8 *bytes, usize len){
+	u64 acc = 0;
+	usize i = 0;
+
+	for(; i + 8 <= len; i += 8){
+		u64 word;
+		memcpy(&word, bytes + i, sizeof(word));
+		acc |= word;
+	}
+
+	for(; i < len; i++){
+		acc |= bytes[i];
+	}
+
+	return (acc & 0x8080808080808080ull) == 0;
+}
+
+//! Documents bigger than this go to libmagic rather than being read whole here.
+constexpr usize ham_impl_mime_json_max_size = 64 * 1024;
+
+//! Nesting beyond this is left to libmagic rather than recursing any deeper.
+constexpr u32 ham_impl_mime_json_max_depth = 64;
+
+struct ham_impl_mime_json_parser{
+	const u8 *cur, *end;
+};
+
+static inline void ham_impl_mime_json_skip_space(ham_impl_mime_json_parser *p){
+	while(p->cur < p->end && ham_impl_mime_is_space(*p->cur)) ++p->cur;
+}
+
+static inline bool ham_impl_mime_json_consume(ham_impl_mime_json_parser *p, u8 c){
+	if(p->cur == p->end || *p->cur != c) return false;
+	++p->cur;
+	return true;
+}
+
+static inline bool ham_impl_mime_json_digits(ham_impl_mime_json_parser *p){
+	const auto start = p->cur;
+	while(p->cur < p->end && *p->cur >= '0' && *p->cur <= '9') ++p->cur;
+	return p->cur != start;
+}
+
+static bool ham_impl_mime_json_string(ham_impl_mime_json_parser *p){
+	if(!ham_impl_mime_json_consume(p, '"')) return false;
+
+	while(p->cur < p->end){
+		const u8 c = *p->cur++;
+
+		if(c == '"') return true;
+		else if(c < 0x20) return false;
+		else if(c != '\\') continue;
+
+		if(p->cur == p->end) return false;
+
+		const u8 esc = *p->cur++;
+		if(esc != 'u'){
+			if(!strchr("\"\\/bfnrt", esc) || esc == '\0') return false;
+			continue;
+		}
+
+		for(int i = 0; i < 4; i++, p->cur++){
+			const u8 h = p->cur == p->end ? 0 : (*p->cur | 0x20);
+			if(!((h >= '0' && h <= '9') || (h >= 'a' && h <= 'f'))) return false;
+		}
+	}
+
+	return false;
+}
+
+static bool ham_impl_mime_json_number(ham_impl_mime_json_parser *p){
+	ham_impl_mime_json_consume(p, '-');
+
+	if(!ham_impl_mime_json_consume(p, '0') && !ham_impl_mime_json_digits(p)) return false;
+
+	if(ham_impl_mime_json_consume(p, '.') && !ham_impl_mime_json_digits(p)) return false;
+
+	if(ham_impl_mime_json_consume(p, 'e') || ham_impl_mime_json_consume(p, 'E')){
+		if(!ham_impl_mime_json_consume(p, '+')) ham_impl_mime_json_consume(p, '-');
+		if(!ham_impl_mime_json_digits(p)) return false;
+	}
+
+	return true;
+}
+
+static inline bool ham_impl_mime_json_literal(ham_impl_mime_json_parser *p, ham_str8 lit){
+	if(usize(p->end - p->cur) < lit.len || memcmp(p->cur, lit.ptr, lit.len) != 0) return false;
+	p->cur += lit.len;
+	return true;
+}
+
+//! Syntax of a single value, nothing is decoded.
+static bool ham_impl_mime_json_value(ham_impl_mime_json_parser *p, u32 depth){
+	ham_impl_mime_json_skip_space(p);
+	if(p->cur == p->end) return false;
+
+	switch(*p->cur){
+		case '{':
+		case '[':{
+			if(depth == ham_impl_mime_json_max_depth) return false;
+
+			const bool is_object = *p->cur++ == '{';
+			const u8 close = is_object ? '}' : ']';
+
+			ham_impl_mime_json_skip_space(p);
+			if(ham_impl_mime_json_consume(p, close)) return true;
+
+			while(true){
+				if(is_object){
+					ham_impl_mime_json_skip_space(p);
+					if(!ham_impl_mime_json_string(p)) return false;
+
+					ham_impl_mime_json_skip_space(p);
+					if(!ham_impl_mime_json_consume(p, ':')) return false;
+				}
+
+				if(!ham_impl_mime_json_value(p, depth + 1)) return false;
+
+				ham_impl_mime_json_skip_space(p);
+
+				if(ham_impl_mime_json_consume(p, close)) return true;
+				else if(!ham_impl_mime_json_consume(p, ',')) return false;
+			}
+		}
+
+		case '"': return ham_impl_mime_json_string(p);
+		case 't': return ham_impl_mime_json_literal(p, HAM_LIT_UTF8("true"));
+		case 'f': return ham_impl_mime_json_literal(p, HAM_LIT_UTF8("false"));
+		case 'n': return ham_impl_mime_json_literal(p, HAM_LIT_UTF8("null"));
+		default:  return ham_impl_mime_json_number(p);
+	}
+}
+
+/**
+ * Documents are checked against the JSON grammar, and the charset comes from every byte, so nothing
+ * that libmagic wouldn't call JSON is called JSON here. Anything too big or too deep to check cheaply
+ * is left to libmagic.
+ */
+static const char *ham_impl_mime_json(const ham_impl_mime_probe *probe){
+	if(probe->size > ham_impl_mime_json_max_size) return nullptr;
+
+	const u8 *text = probe->mem ? probe->mem : probe->head;
+	u8 *text_buf = nullptr;
+
+	const auto allocator = ham_current_allocator();
+
+	if(!probe->mem && probe->head_len < probe->size){
+		text_buf = (u8*)ham_allocator_alloc(allocator, alignof(u64), (probe->size + alignof(u64) - 1) & ~usize(alignof(u64) - 1));
+		if(!text_buf) return nullptr;
+
+		if(!ham_impl_mime_probe_read(probe, 0, probe->size, text_buf)){
+			ham_allocator_free(allocator, text_buf);
+			return nullptr;
+		}
+
+		text = text_buf;
+	}
+
+	const char *ret = nullptr;
+
+	ham_impl_mime_json_parser parser{ text, text + probe->size };
+
+	bool is_json = ham_impl_mime_json_value(&parser, 0);
+	if(is_json){
+		ham_impl_mime_json_skip_space(&parser);
+		is_json = parser.cur == parser.end;
+	}
+
+	if(is_json){
+		if(ham_impl_mime_is_ascii(text, probe->size)){
+			ret = HAM_MIME(HAM_MIME_TYPE_JSON, HAM_MIME_ENCODING_ASCII);
+		}
+		else if(ham_str_validate_utf8((ham_str8){ (const char*)text, probe->size })){
+			ret = HAM_MIME(HAM_MIME_TYPE_JSON, HAM_MIME_ENCODING_UTF8);
+		}
+	}
+
+	if(text_buf){
+		ham_allocator_free(allocator, text_buf);
+	}
+
+	return ret;
+}
+
+//! Returns a string literal or null if the contents aren't recognised.
+static const char *ham_impl_mime_builtin(const ham_impl_mime_probe *probe){
+	if(probe->size == 0) return "inode/x-empty; " HAM_MIME_ENCODING_BINARY;
+
+	if(ham_impl_mime_has_prefix(probe, 0, HAM_LIT_UTF8("\x89PNG\r\n\x1a\n"))){
+		return HAM_MIME(HAM_MIME_TYPE_PNG, HAM_MIME_ENCODING_BINARY);
+	}
+	else if(ham_impl_mime_has_prefix(probe, 0, HAM_LIT_UTF8("\xff\xd8\xff"))){
+		return HAM_MIME(HAM_MIME_TYPE_JPEG, HAM_MIME_ENCODING_BINARY);
+	}
+	else if(ham_impl_mime_has_prefix(probe, 0, HAM_LIT_UTF8("glTF\x02\0\0\0"))){
+		return HAM_MIME(HAM_MIME_TYPE_GLB, HAM_MIME_ENCODING_BINARY);
+	}
+	else if(ham_impl_mime_has_prefix(probe, 0, HAM_LIT_UTF8("\x7f" "ELF"))){
+		return ham_impl_mime_elf(probe);
+	}
+	else if(ham_impl_mime_has_prefix(probe, 0, HAM_LIT_UTF8("RIFF")) && ham_impl_mime_has_prefix(probe, 8, HAM_LIT_UTF8("WAVE"))){
+		// libmagic still uses the old name, not HAM_MIME_TYPE_WAV
+		return "audio/x-wav; " HAM_MIME_ENCODING_BINARY;
+	}
+	else if(ham_impl_mime_has_prefix(probe, 0, HAM_LIT_UTF8("OggS\0"))){
+		return ham_impl_mime_ogg(probe);
+	}
+
+	usize first = 0;
+	while(first < probe->head_len && ham_impl_mime_is_space(probe->head[first])) ++first;
+
+	if(first < probe->head_len && (probe->head[first] == '{' || probe->head[first] == '[')){
+		return ham_impl_mime_json(probe);
+	}
+
+	return nullptr;
+}
+
+//! Copies the result out of libmagic's cookie, which the next call overwrites.
+static ham_str8 ham_impl_mime_intern(const char *mime_str){
+	const ham_symbol sym = ham_intern(ham::str8(mime_str));
+	return sym ? ham_symbol_str(sym) : HAM_EMPTY_STR8;
 }
 
 static inline bool ham_impl_fstat(int fd, ham_file_info *ret){
@@ -148,14 +735,31 @@ static inline bool ham_impl_fstat(int fd, ham_file_info *ret){
 
 	ret->size = (usize)stat_buf.st_size;
 
+	if(ret->kind == HAM_FILE_REGULAR){
+		u8 head[ham_impl_mime_head_size];
+
+		const ssize_t head_len = pread(fd, head, std::min(sizeof(head), ret->size), 0);
+		if(head_len >= 0){
+			const ham_impl_mime_probe probe{ .mem = nullptr, .fd = fd, .size = ret->size, .head = head, .head_len = (usize)head_len };
+
+			const char *mime_str = ham_impl_mime_builtin(&probe);
+			if(mime_str){
+				ret->mime = ham::str8(mime_str);
+				return true;
+			}
+		}
+	}
+
 	if(ham_impl_magic_init()){
+		std::scoped_lock lock(ham_impl_magic_mutex);
+
 		const char *mime_str = magic_descriptor(ham_impl_magic_cookie, fd);
 		if(!mime_str){
 			ham_logapiwarnf("Error in magic_descriptor: %s", magic_error(ham_impl_magic_cookie));
 			ret->mime = HAM_EMPTY_STR8;
 		}
 		else{
-			ret->mime = ham::str8(mime_str);
+			ret->mime = ham_impl_mime_intern(mime_str);
 		}
 	}
 	else{
@@ -190,12 +794,28 @@ ham_str8 ham_mime_from_mem(ham_usize len, const void *buf){
 		return HAM_EMPTY_STR8;
 	}
 
+	const ham_impl_mime_probe probe{
+		.mem = (const u8*)buf, .fd = -1, .size = len,
+		.head = (const u8*)buf, .head_len = std::min(len, ham_impl_mime_head_size)
+	};
+
+	const char *builtin = ham_impl_mime_builtin(&probe);
+	if(builtin) return ham::str8(builtin);
+
 	if(!ham_impl_magic_init()){
 		ham_logapiwarnf("Failed to initialize libmagic, no mime info returned.");
 		return HAM_EMPTY_STR8;
 	}
 
-	return ham::str8(magic_buffer(ham_impl_magic_cookie, buf, len));
+	std::scoped_lock lock(ham_impl_magic_mutex);
+
+	const char *mime_str = magic_buffer(ham_impl_magic_cookie, buf, len);
+	if(!mime_str){
+		ham_logapiwarnf("Error in magic_buffer: %s", magic_error(ham_impl_magic_cookie));
+		return HAM_EMPTY_STR8;
+	}
+
+	return ham_impl_mime_intern(mime_str);
 }
 
 bool ham_path_file_info_utf8 (ham_str8  path, ham_file_info *ret){
@@ -204,6 +824,14 @@ bool ham_path_file_info_utf8 (ham_str8  path, ham_file_info *ret){
 	ham_path_buffer_utf8 path_buf;
 	if(path.len >= HAM_PATH_BUFFER_SIZE) return false;
 
+	const ham_impl_pack_entry *entry;
+	const auto pack = ham_impl_fs_mount_find(path, &entry);
+	if(pack){
+		ham_impl_pack_file_info(entry, pack, ret);
+		ham_impl_pack_release(pack);
+		return true;
+	}
+
 	memcpy(path_buf, path.ptr, path.len);
 	path_buf[path.len] = '\0';
 
@@ -223,12 +851,7 @@ bool ham_path_file_info_utf16(ham_str16 path, ham_file_info *ret){
 	const usize path_len = ham_str_conv_utf16_utf8(path, path_buf, sizeof(path_buf)-1);
 	if(path_len == (usize)-1) return false;
 
-	if(!ham_impl_stat(path_buf, ret)){
-		ham_logapierrorf("Internal error in ham_impl_stat");
-		return false;
-	}
-
-	return true;
+	return ham_path_file_info_utf8((ham_str8){ path_buf, path_len }, ret);
 }
 
 bool ham_path_file_info_utf32(ham_str32 path, ham_file_info *ret){
@@ -239,12 +862,54 @@ bool ham_path_file_info_utf32(ham_str32 path, ham_file_info *ret){
 	const usize path_len = ham_str_conv_utf32_utf8(path, path_buf, sizeof(path_buf)-1);
 	if(path_len == (usize)-1) return false;
 
-	if(!ham_impl_stat(path_buf, ret)){
-		ham_logapierrorf("Internal error in ham_impl_stat");
-		return false;
+	return ham_path_file_info_utf8((ham_str8){ path_buf, path_len }, ret);
+}
+
+//! Takes ownership of the caller's reference to \p pack on success.
+static ham_file *ham_impl_pack_file_open(ham_pack *pack, const ham_impl_pack_entry *entry){
+	const auto allocator = ham_current_allocator();
+
+	const auto file = ham_allocator_new(allocator, ham_file);
+	if(!file){
+		ham::logerror("ham_file_open_utf8", "Error allocating ham_file");
+		return nullptr;
 	}
 
-	return true;
+	file->allocator = allocator;
+	file->fd = -1;
+	file->pack = pack;
+	file->entry = entry;
+
+	const auto stored = (const char*)pack->mapping + pack->header->data_off + entry->off;
+
+	if(entry->compression == HAM_IMPL_PACK_STORED){
+		file->data = stored;
+		return file;
+	}
+
+	// everything opening a file goes on to read it, so there's nothing to gain decompressing lazily
+	// aligned the same as stored entries so loaders can rely on it either way
+	const usize alloc_size = std::max<usize>((entry->size + HAM_PACK_DATA_ALIGNMENT - 1) & ~usize(HAM_PACK_DATA_ALIGNMENT - 1), HAM_PACK_DATA_ALIGNMENT);
+
+	file->decompressed = (char*)ham_allocator_alloc(allocator, HAM_PACK_DATA_ALIGNMENT, alloc_size);
+	if(!file->decompressed){
+		ham::logerror("ham_file_open_utf8", "Error allocating {} bytes for a compressed entry", entry->size);
+		ham_allocator_delete(allocator, file);
+		return nullptr;
+	}
+
+	if(ham_lz4_decompress(entry->stored_size, stored, entry->size, file->decompressed) != entry->size){
+		ham::logerror(
+			"ham_file_open_utf8", "Corrupt compressed entry '{}' in pack",
+			ham::str8(pack->strings + entry->path_off, entry->path_len)
+		);
+		ham_allocator_free(allocator, file->decompressed);
+		ham_allocator_delete(allocator, file);
+		return nullptr;
+	}
+
+	file->data = file->decompressed;
+	return file;
 }
 
 ham_file *ham_file_open_utf8(ham_str8 path, ham_u32 flags){
@@ -253,6 +918,17 @@ ham_file *ham_file_open_utf8(ham_str8 path, ham_u32 flags){
 	ham_path_buffer_utf8 path_buf;
 	if(!ham_check(path.len < HAM_PATH_BUFFER_SIZE)) return nullptr;
 
+	// mounted packs are read-only and shadow the real filesystem
+	if((flags & (HAM_OPEN_RDWR | HAM_OPEN_CREATE)) == HAM_OPEN_READ){
+		const ham_impl_pack_entry *entry;
+		const auto pack = ham_impl_fs_mount_find(path, &entry);
+		if(pack){
+			const auto file = ham_impl_pack_file_open(pack, entry);
+			if(!file) ham_impl_pack_release(pack);
+			return file;
+		}
+	}
+
 	memcpy(path_buf, path.ptr, path.len);
 	path_buf[path.len] = '\0';
 
@@ -272,7 +948,11 @@ ham_file *ham_file_open_utf8(ham_str8 path, ham_u32 flags){
 		open_flags |= O_RDWR;
 	}
 
-	int fd = open(path_buf, open_flags);
+	if(flags & HAM_OPEN_CREATE){
+		open_flags |= O_CREAT | O_TRUNC;
+	}
+
+	int fd = open(path_buf, open_flags, 0644);
 	if(fd == -1){
 		ham_logapierrorf("Error in open: %s", strerror(errno));
 		return nullptr;
@@ -309,7 +989,11 @@ ham_file *ham_file_open_utf8(ham_str8 path, ham_u32 flags){
 void ham_file_close(ham_file *file){
 	if(!ham_check(file != NULL)) return;
 
-	if(close(file->fd) != 0){
+	if(file->pack){
+		if(file->decompressed) ham_allocator_free(file->allocator, file->decompressed);
+		ham_impl_pack_release(file->pack);
+	}
+	else if(close(file->fd) != 0){
 		ham_logapiwarnf("Error in close: %s", strerror(errno));
 	}
 
@@ -322,6 +1006,11 @@ void ham_file_close(ham_file *file){
 bool ham_file_get_info(const ham_file *file, ham_file_info *ret){
 	if(!ham_check(file != NULL) || !ham_check(ret != NULL)) return false;
 
+	if(file->pack){
+		ham_impl_pack_file_info(file->entry, file->pack, ret);
+		return true;
+	}
+
 	if(!ham_impl_fstat(file->fd, ret)){
 		ham_logapierrorf("Internal error in ham_impl_stat");
 		return false;
@@ -334,7 +1023,16 @@ ham_usize ham_file_read(ham_file *file, void *buf, ham_usize max_len){
 	if(!ham_check(file != NULL) || !ham_check(buf != NULL)) return (usize)-1;
 	else if(!max_len) return 0;
 
-	const ssize_t res = read(file->fd, buf, max_len);
+	if(file->pack){
+		if(file->pos >= file->entry->size) return 0;
+
+		const usize len = std::min(max_len, file->entry->size - file->pos);
+		memcpy(buf, file->data + file->pos, len);
+		file->pos += len;
+		return len;
+	}
+
+	const ssize_t res = read(file->fd, buf, max_len);
 	if(res == -1){
 		ham_logapierrorf("Error in read: %s", strerror(errno));
 		return (usize)-1;
@@ -348,6 +1046,11 @@ ham_usize ham_file_write(ham_file *file, const void *buf, ham_usize len){
 	else if(!len) return 0;
 	else if(!buf) return (usize)-1;
 
+	if(file->pack){
+		ham_logapierrorf("Files in packs are read-only");
+		return (usize)-1;
+	}
+
 	const ssize_t res = write(file->fd, buf, len);
 	if(res == -1){
 		// TODO: signal error
@@ -360,6 +1063,11 @@ ham_usize ham_file_write(ham_file *file, const void *buf, ham_usize len){
 ham_usize ham_file_seek(ham_file *file, ham_usize off){
 	if(!ham_check(file != NULL)) return (usize)-1;
 
+	if(file->pack){
+		file->pos = off;
+		return off;
+	}
+
 	const off_t res = lseek(file->fd, off, SEEK_SET);
 	if(res == (off_t)-1){
 		// TODO: signal error
@@ -372,6 +1080,8 @@ ham_usize ham_file_seek(ham_file *file, ham_usize off){
 ham_usize ham_file_tell(const ham_file *file){
 	if(!ham_check(file != NULL)) return (usize)-1;
 
+	if(file->pack) return file->pos;
+
 	const off_t res = lseek(file->fd, 0, SEEK_CUR);
 	if(res == (off_t)-1){
 		// TODO: signal error
@@ -384,6 +1094,20 @@ ham_usize ham_file_tell(const ham_file *file){
 void *ham_file_map(ham_file *file, ham_file_open_flags flags, ham_usize from, ham_usize len){
 	if(!ham_check(file != NULL)) return nullptr;
 
+	// the entry is already in memory, mapped along with the rest of the pack
+	if(file->pack){
+		if(flags & HAM_OPEN_WRITE){
+			ham_logapierrorf("Files in packs are read-only");
+			return nullptr;
+		}
+		else if(from > file->entry->size || len > file->entry->size - from){
+			ham::logapierror("Mapping [{}, {}) out of bounds of entry of {} bytes", from, from + len, file->entry->size);
+			return nullptr;
+		}
+
+		return const_cast<char*>(file->data + from);
+	}
+
 	int prot = 0;
 
 	if(flags & HAM_OPEN_READ)  prot |= PROT_READ;
@@ -403,6 +1127,8 @@ void *ham_file_map(ham_file *file, ham_file_open_flags flags, ham_usize from, ha
 bool ham_file_unmap(ham_file *file, void *mapping, ham_usize len){
 	if(!ham_check(file != NULL)) return false;
 
+	if(file->pack) return true;
+
 	const auto res = munmap(mapping, len);
 	if(res != 0){
 		ham_logapierrorf("Error in munmap: %s", strerror(errno));
@@ -413,3 +1139,1889 @@ bool ham_file_unmap(ham_file *file, void *mapping, ham_usize len){
 }
 
 HAM_C_API_END
+
+//
+// Pack files and the builder that writes them
+//
+
+static bool ham_impl_pack_validate(const void *mapping, usize len){
+	const auto base = (const char*)mapping;
+	const auto header = (const ham_impl_pack_header*)mapping;
+
+	const auto in_bounds = [len](u64 off, u64 size){ return off <= len && size <= len - off; };
+
+	if(memcmp(header->magic, HAM_IMPL_PACK_MAGIC, sizeof(header->magic)) != 0){
+		ham::logerror("ham_pack_open", "Bad magic number, not a pack");
+		return false;
+	}
+	else if(header->version != ham_impl_pack_version){
+		ham::logerror("ham_pack_open", "Unsupported pack version {}", header->version);
+		return false;
+	}
+	else if(header->bucket_bits > ham_impl_pack_max_bucket_bits){
+		ham::logerror("ham_pack_open", "Bad bucket table size 2^{}", header->bucket_bits);
+		return false;
+	}
+	else if(header->data_align < HAM_PACK_DATA_ALIGNMENT || (header->data_align & (header->data_align - 1)) != 0){
+		ham::logerror("ham_pack_open", "Bad data alignment {}", header->data_align);
+		return false;
+	}
+
+	const u64 num_buckets = (u64(1) << header->bucket_bits) + 1;
+
+	if(
+		(header->buckets_off % alignof(u32)) != 0 || (header->entries_off % alignof(ham_impl_pack_entry)) != 0 ||
+		!in_bounds(header->buckets_off, num_buckets * sizeof(u32)) ||
+		!in_bounds(header->entries_off, u64(header->num_entries) * sizeof(ham_impl_pack_entry)) ||
+		!in_bounds(header->strings_off, header->strings_size) ||
+		header->data_off > len || (header->data_off % header->data_align) != 0
+	){
+		ham::logerror("ham_pack_open", "Pack tables out of bounds");
+		return false;
+	}
+
+	const auto buckets = (const u32*)(base + header->buckets_off);
+
+	if(buckets[0] != 0 || buckets[num_buckets - 1] != header->num_entries){
+		ham::logerror("ham_pack_open", "Corrupt bucket table");
+		return false;
+	}
+
+	for(u64 i = 1; i < num_buckets; i++){
+		if(buckets[i] < buckets[i - 1]){
+			ham::logerror("ham_pack_open", "Corrupt bucket table");
+			return false;
+		}
+	}
+
+	const auto entries = (const ham_impl_pack_entry*)(base + header->entries_off);
+	const auto strings = base + header->strings_off;
+	const u64 data_len = len - header->data_off;
+
+	// strings are handed out as C strings too, so each must end in a terminator inside the string table
+	const auto is_terminated = [&](u32 off, u32 str_len){
+		return u64(off) + str_len < header->strings_size && strings[u64(off) + str_len] == '\0';
+	};
+
+	for(u32 i = 0; i < header->num_entries; i++){
+		const auto entry = entries + i;
+
+		if(
+			entry->compression >= HAM_IMPL_PACK_COMPRESSION_COUNT ||
+			(entry->compression == HAM_IMPL_PACK_STORED && entry->stored_size != entry->size) ||
+			!is_terminated(entry->path_off, entry->path_len) ||
+			!is_terminated(entry->mime_off, entry->mime_len) ||
+			entry->off > data_len || entry->stored_size > data_len - entry->off ||
+			(entry->off % header->data_align) != 0
+		){
+			ham::logerror("ham_pack_open", "Corrupt entry {}", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+struct ham_impl_pack_builder_entry{
+	u64 hash;
+	usize path_off, path_len;
+	usize mime_off, mime_len;
+	usize data_off, size, stored_size;
+	u32 compression;
+};
+
+struct ham_pack_builder{
+	const ham_allocator *allocator;
+	ham::std_vector<ham_impl_pack_builder_entry> entries;
+	ham::std_vector<char> strings; //!< Paths and mime types, each null-terminated, copied into the pack as-is
+	ham::std_vector<char> data; //!< Entry data back to back, aligned when written
+};
+
+static bool ham_impl_pack_write_all(ham_file *file, const void *buf, usize len){
+	auto bytes = (const char*)buf;
+
+	while(len){
+		const usize res = ham_file_write(file, bytes, len);
+		if(res == (usize)-1 || res == 0) return false;
+
+		bytes += res;
+		len -= res;
+	}
+
+	return true;
+}
+
+static inline bool ham_impl_pack_write_padding(ham_file *file, usize len){
+	static constexpr char zeros[HAM_PACK_DATA_ALIGNMENT] = {};
+	return ham_impl_pack_write_all(file, zeros, len);
+}
+
+HAM_C_API_BEGIN
+
+ham_pack *ham_pack_open(ham_str8 path){
+	if(!ham_check(path.ptr && path.len) || !ham_check(path.len < HAM_PATH_BUFFER_SIZE)) return nullptr;
+
+	ham_path_buffer_utf8 path_buf;
+	memcpy(path_buf, path.ptr, path.len);
+	path_buf[path.len] = '\0';
+
+	const int fd = open(path_buf, O_RDONLY);
+	if(fd == -1){
+		ham::logapierror("Error opening pack '{}': {}", path, strerror(errno));
+		return nullptr;
+	}
+
+	struct stat stat_buf;
+	if(fstat(fd, &stat_buf) != 0){
+		ham::logapierror("Error in fstat: {}", strerror(errno));
+		close(fd);
+		return nullptr;
+	}
+
+	const usize len = (usize)stat_buf.st_size;
+	if(len < sizeof(ham_impl_pack_header)){
+		ham::logapierror("Pack '{}' is too small to be a pack", path);
+		close(fd);
+		return nullptr;
+	}
+
+	const auto mapping = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// the mapping keeps the file alive
+	if(close(fd) != 0){
+		ham_logapiwarnf("Error in close: %s", strerror(errno));
+	}
+
+	if(mapping == MAP_FAILED){
+		ham::logapierror("Error in mmap: {}", strerror(errno));
+		return nullptr;
+	}
+
+	if(!ham_impl_pack_validate(mapping, len)){
+		ham::logapierror("Invalid pack '{}'", path);
+		munmap(mapping, len);
+		return nullptr;
+	}
+
+	const auto allocator = ham_current_allocator();
+
+	const auto pack = ham_allocator_new(allocator, ham_pack);
+	if(!pack){
+		ham::logapierror("Error allocating ham_pack");
+		munmap(mapping, len);
+		return nullptr;
+	}
+
+	const auto base = (const char*)mapping;
+
+	pack->allocator = allocator;
+	pack->refs.store(1, std::memory_order_relaxed);
+	pack->mapping = mapping;
+	pack->mapping_len = len;
+	pack->header = (const ham_impl_pack_header*)mapping;
+	pack->buckets = (const u32*)(base + pack->header->buckets_off);
+	pack->entries = (const ham_impl_pack_entry*)(base + pack->header->entries_off);
+	pack->strings = base + pack->header->strings_off;
+
+	return pack;
+}
+
+void ham_pack_close(ham_pack *pack){
+	if(!pack) return;
+	ham_impl_pack_release(pack);
+}
+
+ham_u32 ham_pack_num_entries(const ham_pack *pack){
+	if(!ham_check(pack != NULL)) return 0;
+	return pack->header->num_entries;
+}
+
+bool ham_pack_get_entry(const ham_pack *pack, ham_u32 idx, ham_pack_entry_info *ret){
+	if(!ham_check(pack != NULL) || !ham_check(ret != NULL) || !ham_check(idx < pack->header->num_entries)) return false;
+
+	ham_impl_pack_entry_info(pack, pack->entries + idx, ret);
+	return true;
+}
+
+bool ham_pack_find(const ham_pack *pack, ham_str8 path, ham_pack_entry_info *ret){
+	if(!ham_check(pack != NULL) || !ham_check(ret != NULL)) return false;
+
+	const auto entry = ham_impl_pack_find(pack, path);
+	if(!entry) return false;
+
+	ham_impl_pack_entry_info(pack, entry, ret);
+	return true;
+}
+
+bool ham_fs_mount_pack(ham_pack *pack, ham_str8 mount_point){
+	if(!ham_check(pack != NULL) || !ham_check(mount_point.len == 0 || mount_point.ptr != NULL)) return false;
+
+	while(mount_point.len && mount_point.ptr[mount_point.len - 1] == '/'){
+		--mount_point.len;
+	}
+
+	if(!ham_check(mount_point.len < HAM_PATH_BUFFER_SIZE)) return false;
+
+	auto &table = ham_impl_fs_mounts();
+
+	std::scoped_lock lock(table.mut);
+
+	const auto old_snapshot = table.snapshot.load(std::memory_order_relaxed);
+
+	std::shared_ptr<ham_impl_fs_mount_snapshot> new_snapshot;
+
+	try{
+		new_snapshot = old_snapshot ? std::make_shared<ham_impl_fs_mount_snapshot>(*old_snapshot) : std::make_shared<ham_impl_fs_mount_snapshot>();
+		new_snapshot->mounts.emplace_back(ham_impl_fs_mount{ pack, ham::str_buffer8(mount_point) });
+	}
+	catch(const std::bad_alloc&){
+		ham::logapierror("Failed to allocate mount table");
+		return false;
+	}
+
+	ham_impl_pack_acquire(pack);
+
+	table.snapshot.store(std::move(new_snapshot), std::memory_order_release);
+	table.num_mounts.fetch_add(1, std::memory_order_release);
+	return true;
+}
+
+bool ham_fs_unmount_pack(ham_pack *pack){
+	if(!ham_check(pack != NULL)) return false;
+
+	auto &table = ham_impl_fs_mounts();
+
+	std::scoped_lock lock(table.mut);
+
+	const auto old_snapshot = table.snapshot.load(std::memory_order_relaxed);
+	if(!old_snapshot){
+		ham::logapierror("Pack is not mounted");
+		return false;
+	}
+
+	const auto &old_mounts = old_snapshot->mounts;
+	const auto mount_res = std::find_if(old_mounts.rbegin(), old_mounts.rend(), [pack](const ham_impl_fs_mount &mount){ return mount.pack == pack; });
+
+	if(mount_res == old_mounts.rend()){
+		ham::logapierror("Pack is not mounted");
+		return false;
+	}
+
+	std::shared_ptr<ham_impl_fs_mount_snapshot> new_snapshot;
+
+	try{
+		new_snapshot = std::make_shared<ham_impl_fs_mount_snapshot>(*old_snapshot);
+	}
+	catch(const std::bad_alloc&){
+		ham::logapierror("Failed to allocate mount table");
+		return false;
+	}
+
+	auto &new_mounts = new_snapshot->mounts;
+	const auto idx = (usize)(old_mounts.rend() - mount_res) - 1;
+
+	// the copy took its own reference
+	ham_impl_pack_release(new_mounts[idx].pack);
+	new_mounts.erase(new_mounts.begin() + idx);
+
+	table.num_mounts.fetch_sub(1, std::memory_order_release);
+
+	// the mount's reference goes when the last lookup is done with the old snapshot,
+	// files opened from the pack hold their own references
+	table.snapshot.store(std::move(new_snapshot), std::memory_order_release);
+	return true;
+}
+
+ham_pack_builder *ham_pack_builder_create(){
+	const auto allocator = ham_current_allocator();
+
+	const auto builder = ham_allocator_new(allocator, ham_pack_builder);
+	if(!builder){
+		ham::logapierror("Error allocating ham_pack_builder");
+		return nullptr;
+	}
+
+	builder->allocator = allocator;
+	return builder;
+}
+
+void ham_pack_builder_destroy(ham_pack_builder *builder){
+	if(!builder) return;
+	ham_allocator_delete(builder->allocator, builder);
+}
+
+ham_usize ham_pack_builder_num_entries(const ham_pack_builder *builder){
+	if(!ham_check(builder != NULL)) return (usize)-1;
+	return builder->entries.size();
+}
+
+bool ham_pack_builder_add(ham_pack_builder *builder, ham_str8 path, ham_str8 mime, ham_usize len, const void *data, ham_u32 flags){
+	if(
+		!ham_check(builder != NULL) || !ham_check(path.ptr && path.len) ||
+		!ham_check(mime.len == 0 || mime.ptr != NULL) || !ham_check(len == 0 || data != NULL)
+	){
+		return false;
+	}
+
+	if(!mime.len && len){
+		mime = ham_mime_from_mem(len, data);
+	}
+
+	ham_impl_pack_builder_entry entry;
+	entry.hash = ham_impl_pack_hash(path);
+	entry.size = len;
+
+	auto &strings = builder->strings;
+
+	entry.path_off = strings.size();
+	entry.path_len = path.len;
+	strings.insert(strings.end(), path.ptr, path.ptr + path.len);
+	strings.push_back('\0');
+
+	entry.mime_off = strings.size();
+	entry.mime_len = mime.len;
+	strings.insert(strings.end(), mime.ptr, mime.ptr + mime.len);
+	strings.push_back('\0');
+
+	auto &bytes = builder->data;
+	entry.data_off = bytes.size();
+
+	if((flags & HAM_PACK_COMPRESS) && len){
+		const usize bound = ham_lz4_compress_bound(len);
+		bytes.resize(entry.data_off + bound);
+
+		const usize res = ham_lz4_compress(len, data, bound, bytes.data() + entry.data_off);
+
+		// not worth decompressing unless it saves at least an eighth
+		if(res && res <= len - (len / 8)){
+			bytes.resize(entry.data_off + res);
+			entry.stored_size = res;
+			entry.compression = HAM_IMPL_PACK_LZ4;
+			builder->entries.push_back(entry);
+			return true;
+		}
+
+		bytes.resize(entry.data_off);
+	}
+
+	const auto src = (const char*)data;
+	bytes.insert(bytes.end(), src, src + len);
+
+	entry.stored_size = len;
+	entry.compression = HAM_IMPL_PACK_STORED;
+	builder->entries.push_back(entry);
+	return true;
+}
+
+bool ham_pack_builder_add_file(ham_pack_builder *builder, ham_str8 path, ham_str8 file_path, ham_u32 flags){
+	if(!ham_check(builder != NULL) || !ham_check(path.ptr && path.len) || !ham_check(file_path.ptr && file_path.len)) return false;
+
+	const auto file = ham_file_open_utf8(file_path, HAM_OPEN_READ);
+	if(!file){
+		ham::logapierror("Error opening '{}'", file_path);
+		return false;
+	}
+
+	ham_file_info info;
+	if(!ham_file_get_info(file, &info)){
+		ham::logapierror("Error getting info for '{}'", file_path);
+		ham_file_close(file);
+		return false;
+	}
+
+	if(!info.size){
+		ham_file_close(file);
+		return ham_pack_builder_add(builder, path, info.mime, 0, nullptr, flags);
+	}
+
+	const auto mapping = ham_file_map(file, HAM_OPEN_READ, 0, info.size);
+	if(!mapping){
+		ham::logapierror("Error mapping '{}'", file_path);
+		ham_file_close(file);
+		return false;
+	}
+
+	const bool res = ham_pack_builder_add(builder, path, info.mime, info.size, mapping, flags);
+
+	ham_file_unmap(file, mapping, info.size);
+	ham_file_close(file);
+	return res;
+}
+
+bool ham_pack_builder_write(const ham_pack_builder *builder, ham_str8 path){
+	if(!ham_check(builder != NULL) || !ham_check(path.ptr && path.len)) return false;
+
+	const auto &entries = builder->entries;
+	const auto &strings = builder->strings;
+
+	if(entries.size() > UINT32_MAX || strings.size() > UINT32_MAX){
+		ham::logapierror("Too many entries for one pack");
+		return false;
+	}
+
+	const u32 num_entries = (u32)entries.size();
+
+	const auto entry_path = [&](const ham_impl_pack_builder_entry &entry){
+		return ham::str8(strings.data() + entry.path_off, entry.path_len);
+	};
+
+	ham::std_vector<u32> order(num_entries);
+	for(u32 i = 0; i < num_entries; i++) order[i] = i;
+
+	std::sort(order.begin(), order.end(), [&](u32 a, u32 b){
+		const auto &lhs = entries[a], &rhs = entries[b];
+		if(lhs.hash != rhs.hash) return lhs.hash < rhs.hash;
+		return entry_path(lhs) < entry_path(rhs);
+	});
+
+	for(u32 i = 1; i < num_entries; i++){
+		const auto &prev = entries[order[i - 1]], &cur = entries[order[i]];
+		if(prev.hash == cur.hash && entry_path(prev) == entry_path(cur)){
+			ham::logapierror("Duplicate path '{}' in pack", entry_path(cur));
+			return false;
+		}
+	}
+
+	// about one entry per bucket
+	u32 bucket_bits = 0;
+	while(bucket_bits < ham_impl_pack_max_bucket_bits && (u32(1) << bucket_bits) < num_entries){
+		++bucket_bits;
+	}
+
+	const u32 num_buckets = (u32(1) << bucket_bits) + 1;
+
+	ham::std_vector<u32> buckets(num_buckets, 0);
+	for(u32 i = 0; i < num_entries; i++){
+		++buckets[ham_impl_pack_bucket(entries[order[i]].hash, bucket_bits) + 1];
+	}
+
+	for(u32 i = 1; i < num_buckets; i++){
+		buckets[i] += buckets[i - 1];
+	}
+
+	const auto align = [](u64 off, u64 alignment){ return (off + alignment - 1) & ~(alignment - 1); };
+
+	ham_impl_pack_header header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, HAM_IMPL_PACK_MAGIC, sizeof(header.magic));
+	header.version = ham_impl_pack_version;
+	header.num_entries = num_entries;
+	header.bucket_bits = bucket_bits;
+	header.data_align = HAM_PACK_DATA_ALIGNMENT;
+	header.buckets_off = sizeof(header);
+	header.entries_off = align(header.buckets_off + u64(num_buckets) * sizeof(u32), alignof(ham_impl_pack_entry));
+	header.strings_off = header.entries_off + u64(num_entries) * sizeof(ham_impl_pack_entry);
+	header.strings_size = strings.size();
+	header.data_off = align(header.strings_off + header.strings_size, HAM_PACK_DATA_ALIGNMENT);
+
+	ham::std_vector<ham_impl_pack_entry> packed(num_entries);
+
+	u64 data_off = 0;
+	for(u32 i = 0; i < num_entries; i++){
+		const auto &src = entries[order[i]];
+		auto &dst = packed[i];
+
+		memset(&dst, 0, sizeof(dst));
+		dst.hash = src.hash;
+		dst.off = data_off;
+		dst.size = src.size;
+		dst.stored_size = src.stored_size;
+		dst.path_off = (u32)src.path_off;
+		dst.path_len = (u32)src.path_len;
+		dst.mime_off = (u32)src.mime_off;
+		dst.mime_len = (u32)src.mime_len;
+		dst.compression = src.compression;
+
+		data_off = align(data_off + src.stored_size, HAM_PACK_DATA_ALIGNMENT);
+	}
+
+	const auto file = ham_file_open_utf8(path, HAM_OPEN_WRITE | HAM_OPEN_CREATE);
+	if(!file){
+		ham::logapierror("Error opening '{}' for writing", path);
+		return false;
+	}
+
+	bool res =
+		ham_impl_pack_write_all(file, &header, sizeof(header)) &&
+		ham_impl_pack_write_all(file, buckets.data(), buckets.size() * sizeof(u32)) &&
+		ham_impl_pack_write_padding(file, header.entries_off - (header.buckets_off + buckets.size() * sizeof(u32))) &&
+		ham_impl_pack_write_all(file, packed.data(), packed.size() * sizeof(ham_impl_pack_entry)) &&
+		ham_impl_pack_write_all(file, strings.data(), strings.size()) &&
+		ham_impl_pack_write_padding(file, header.data_off - (header.strings_off + header.strings_size));
+
+	for(u32 i = 0; res && i < num_entries; i++){
+		const auto &src = entries[order[i]];
+		res =
+			ham_impl_pack_write_all(file, builder->data.data() + src.data_off, src.stored_size) &&
+			ham_impl_pack_write_padding(file, align(src.stored_size, HAM_PACK_DATA_ALIGNMENT) - src.stored_size);
+	}
+
+	ham_file_close(file);
+
+	if(!res){
+		ham::logapierror("Error writing pack '{}'", path);
+		return false;
+	}
+
+	return true;
+}
+
+HAM_C_API_END
+
+//
+// Asynchronous file I/O
+//
+// The io_uring backend talks to the kernel through the raw syscalls and the mapped rings, so
+// there's no dependency on liburing. Requests never outnumber the submission queue entries and
+// the completion queue is twice that size, so completions can't overflow.
+//
+// The thread backend keeps a ring of queued requests and a ring of results under one mutex;
+// workers do a single pread/pwrite per request, the same as the kernel would.
+//
+// Requests on files inside mounted packs are plain copies out of memory, so they complete during
+// submission and wait in a ring of their own until collected.
+//
+
+constexpr u32 ham_impl_file_io_num_workers = 4;
+
+#ifdef __linux__
+
+struct ham_impl_uring{
+	int fd = -1;
+
+	u32 *sq_head, *sq_tail, *sq_mask, *sq_array;
+	io_uring_sqe *sqes;
+
+	u32 *cq_head, *cq_tail, *cq_mask;
+	io_uring_cqe *cqes;
+
+	void *sq_map = nullptr, *cq_map = nullptr;
+	usize sq_map_len = 0, cq_map_len = 0, sqes_map_len = 0;
+
+	u32 num_unsubmitted = 0;
+};
+
+static inline int ham_impl_uring_enter(int fd, u32 to_submit, u32 min_complete, u32 flags){
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static void ham_impl_uring_finish(ham_impl_uring *ring){
+	if(ring->sqes) munmap(ring->sqes, ring->sqes_map_len);
+	if(ring->cq_map && ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_len);
+	if(ring->sq_map) munmap(ring->sq_map, ring->sq_map_len);
+	if(ring->fd != -1) close(ring->fd);
+}
+
+//! Fails quietly so the caller can fall back to threads.
+static bool ham_impl_uring_init(ham_impl_uring *ring, u32 entries){
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = entries * 2;
+
+	ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+	if(ring->fd < 0){
+		ring->fd = -1;
+		return false;
+	}
+
+	ring->sq_map_len = params.sq_off.array + params.sq_entries * sizeof(u32);
+	ring->cq_map_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+	const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if(single_mmap){
+		ring->sq_map_len = ring->cq_map_len = std::max(ring->sq_map_len, ring->cq_map_len);
+	}
+
+	ring->sq_map = mmap(nullptr, ring->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if(ring->sq_map == MAP_FAILED){
+		ring->sq_map = nullptr;
+		ham_impl_uring_finish(ring);
+		return false;
+	}
+
+	if(single_mmap){
+		ring->cq_map = ring->sq_map;
+	}
+	else{
+		ring->cq_map = mmap(nullptr, ring->cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if(ring->cq_map == MAP_FAILED){
+			ring->cq_map = nullptr;
+			ham_impl_uring_finish(ring);
+			return false;
+		}
+	}
+
+	ring->sqes_map_len = params.sq_entries * sizeof(io_uring_sqe);
+	ring->sqes = (io_uring_sqe*)mmap(nullptr, ring->sqes_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if(ring->sqes == MAP_FAILED){
+		ring->sqes = nullptr;
+		ham_impl_uring_finish(ring);
+		return false;
+	}
+
+	const auto sq = (char*)ring->sq_map;
+	ring->sq_head  = (u32*)(sq + params.sq_off.head);
+	ring->sq_tail  = (u32*)(sq + params.sq_off.tail);
+	ring->sq_mask  = (u32*)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (u32*)(sq + params.sq_off.array);
+
+	const auto cq = (char*)ring->cq_map;
+	ring->cq_head = (u32*)(cq + params.cq_off.head);
+	ring->cq_tail = (u32*)(cq + params.cq_off.tail);
+	ring->cq_mask = (u32*)(cq + params.cq_off.ring_mask);
+	ring->cqes    = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	return true;
+}
+
+#endif // __linux__
+
+struct ham_impl_file_io_pool{
+	ham_mutex mut;
+	ham_cond work_cond, done_cond;
+
+	ham_file_io_request *queue;
+	u32 queue_head = 0, queue_count = 0;
+
+	ham_file_io_result *done;
+	u32 done_head = 0, done_count = 0;
+
+	bool stopping = false;
+
+	ham_thread *workers[ham_impl_file_io_num_workers] = {};
+};
+
+struct ham_file_io{
+	const ham_allocator *allocator;
+	ham_file_io_backend backend;
+	u32 depth;
+	u32 num_pending = 0;
+
+	u32 num_bufs = 0;
+	iovec *bufs = nullptr;
+
+	ham_file_io_result *ready = nullptr;
+	u32 ready_head = 0, ready_count = 0;
+
+#ifdef __linux__
+	ham_impl_uring uring;
+#endif
+
+	ham_impl_file_io_pool pool;
+};
+
+static ham_isize ham_impl_file_io_perform(const ham_file_io_request *req){
+	const ssize_t res = req->op == HAM_FILE_IO_WRITE
+		? pwrite(req->file->fd, req->buf, req->len, (off_t)req->off)
+		: pread(req->file->fd, req->buf, req->len, (off_t)req->off);
+
+	return res < 0 ? -(ham_isize)errno : (ham_isize)res;
+}
+
+//! Complete a request on a file in a pack right away.
+static void ham_impl_file_io_complete_now(ham_file_io *io, const ham_file_io_request *req){
+	const auto file = req->file;
+
+	ham_isize res;
+
+	if(req->op == HAM_FILE_IO_WRITE){
+		res = -EBADF;
+	}
+	else if(req->off >= file->entry->size){
+		res = 0;
+	}
+	else{
+		const usize len = std::min<usize>(req->len, file->entry->size - req->off);
+		memcpy(req->buf, file->data + req->off, len);
+		res = (ham_isize)len;
+	}
+
+	io->ready[(io->ready_head + io->ready_count) % io->depth] = (ham_file_io_result){ .user = req->user, .res = res };
+	++io->ready_count;
+}
+
+static ham_uptr ham_impl_file_io_worker(void *user){
+	const auto io = (ham_file_io*)user;
+	auto &pool = io->pool;
+
+	ham::scoped_lock lock(&pool.mut);
+
+	while(true){
+		while(!pool.queue_count && !pool.stopping){
+			ham_cond_wait(&pool.work_cond, &pool.mut);
+		}
+
+		if(!pool.queue_count) break;
+
+		const ham_file_io_request req = pool.queue[pool.queue_head];
+		pool.queue_head = (pool.queue_head + 1) % io->depth;
+		--pool.queue_count;
+
+		ham_mutex_unlock(&pool.mut);
+		const ham_isize res = ham_impl_file_io_perform(&req);
+		ham_mutex_lock(&pool.mut);
+
+		pool.done[(pool.done_head + pool.done_count) % io->depth] = (ham_file_io_result){ .user = req.user, .res = res };
+		++pool.done_count;
+
+		ham_cond_signal(&pool.done_cond);
+	}
+
+	return 0;
+}
+
+static void ham_impl_file_io_pool_finish(ham_file_io *io){
+	auto &pool = io->pool;
+
+	{
+		ham::scoped_lock lock(&pool.mut);
+		pool.stopping = true;
+		ham_cond_broadcast(&pool.work_cond);
+	}
+
+	for(auto thd : pool.workers){
+		if(!thd) continue;
+		ham_thread_join(thd, nullptr);
+		ham_thread_destroy(thd);
+	}
+
+	ham_allocator_free(io->allocator, pool.queue);
+	ham_allocator_free(io->allocator, pool.done);
+
+	ham_cond_finish(&pool.done_cond);
+	ham_cond_finish(&pool.work_cond);
+	ham_mutex_finish(&pool.mut);
+}
+
+static bool ham_impl_file_io_pool_init(ham_file_io *io){
+	auto &pool = io->pool;
+
+	pool.queue = (ham_file_io_request*)ham_allocator_alloc(io->allocator, alignof(ham_file_io_request), sizeof(ham_file_io_request) * io->depth);
+	pool.done = (ham_file_io_result*)ham_allocator_alloc(io->allocator, alignof(ham_file_io_result), sizeof(ham_file_io_result) * io->depth);
+
+	if(!pool.queue || !pool.done){
+		ham::logapierror("Error allocating queues for {} requests", io->depth);
+		if(pool.queue) ham_allocator_free(io->allocator, pool.queue);
+		if(pool.done) ham_allocator_free(io->allocator, pool.done);
+		return false;
+	}
+
+	if(!ham_mutex_init(&pool.mut, HAM_MUTEX_NORMAL)){
+		ham::logapierror("Error in ham_mutex_init");
+		ham_allocator_free(io->allocator, pool.queue);
+		ham_allocator_free(io->allocator, pool.done);
+		return false;
+	}
+
+	if(!ham_cond_init(&pool.work_cond)){
+		ham::logapierror("Error in ham_cond_init");
+		ham_mutex_finish(&pool.mut);
+		ham_allocator_free(io->allocator, pool.queue);
+		ham_allocator_free(io->allocator, pool.done);
+		return false;
+	}
+
+	if(!ham_cond_init(&pool.done_cond)){
+		ham::logapierror("Error in ham_cond_init");
+		ham_cond_finish(&pool.work_cond);
+		ham_mutex_finish(&pool.mut);
+		ham_allocator_free(io->allocator, pool.queue);
+		ham_allocator_free(io->allocator, pool.done);
+		return false;
+	}
+
+	const u32 num_workers = std::min(io->depth, ham_impl_file_io_num_workers);
+
+	for(u32 i = 0; i < num_workers; i++){
+		pool.workers[i] = ham_thread_create(ham_impl_file_io_worker, io);
+		if(!pool.workers[i]){
+			ham::logapierror("Error in ham_thread_create");
+			ham_impl_file_io_pool_finish(io);
+			return false;
+		}
+
+		ham_thread_set_name(pool.workers[i], HAM_LIT_UTF8("ham-file-io"));
+	}
+
+	return true;
+}
+
+//! Returns the iovec of the registered buffer the request lies in or null if it is out of bounds.
+static inline const iovec *ham_impl_file_io_req_buf(const ham_file_io *io, const ham_file_io_request *req){
+	if(req->buf_index >= io->num_bufs) return nullptr;
+
+	const auto vec = io->bufs + req->buf_index;
+	const auto base = (const char*)vec->iov_base;
+	const auto buf = (const char*)req->buf;
+
+	if(buf < base || buf + req->len > base + vec->iov_len) return nullptr;
+
+	return vec;
+}
+
+HAM_C_API_BEGIN
+
+ham_file_io *ham_file_io_create(ham_u32 queue_depth, ham_u32 flags){
+	if(!ham_check(queue_depth > 0)) return nullptr;
+
+	// io_uring wants a power of 2
+	queue_depth = queue_depth <= 1 ? 1 : (u32(1) << (32 - __builtin_clz(queue_depth - 1)));
+
+	const auto allocator = ham_current_allocator();
+
+	const auto io = ham_allocator_new(allocator, ham_file_io);
+	if(!io){
+		ham::logapierror("Error allocating ham_file_io");
+		return nullptr;
+	}
+
+	io->allocator = allocator;
+	io->depth = queue_depth;
+
+	io->ready = (ham_file_io_result*)ham_allocator_alloc(allocator, alignof(ham_file_io_result), sizeof(ham_file_io_result) * queue_depth);
+	if(!io->ready){
+		ham::logapierror("Error allocating queues for {} requests", queue_depth);
+		ham_allocator_delete(allocator, io);
+		return nullptr;
+	}
+
+#ifdef __linux__
+	if(!(flags & HAM_FILE_IO_FORCE_THREADS) && ham_impl_uring_init(&io->uring, queue_depth)){
+		io->backend = HAM_FILE_IO_BACKEND_IO_URING;
+		return io;
+	}
+#endif
+
+	io->backend = HAM_FILE_IO_BACKEND_THREADS;
+
+	if(!ham_impl_file_io_pool_init(io)){
+		ham_allocator_free(allocator, io->ready);
+		ham_allocator_delete(allocator, io);
+		return nullptr;
+	}
+
+	return io;
+}
+
+void ham_file_io_destroy(ham_file_io *io){
+	if(!io) return;
+
+	ham_file_io_result results[32];
+	while(io->num_pending){
+		if(ham_file_io_complete(io, 1, (u32)std::size(results), results) == (u32)-1) break;
+	}
+
+#ifdef __linux__
+	if(io->backend == HAM_FILE_IO_BACKEND_IO_URING){
+		ham_impl_uring_finish(&io->uring);
+	}
+	else
+#endif
+	{
+		ham_impl_file_io_pool_finish(io);
+	}
+
+	if(io->bufs) ham_allocator_free(io->allocator, io->bufs);
+
+	ham_allocator_free(io->allocator, io->ready);
+	ham_allocator_delete(io->allocator, io);
+}
+
+ham_file_io_backend ham_file_io_get_backend(const ham_file_io *io){
+	if(!ham_check(io != NULL)) return HAM_FILE_IO_BACKEND_COUNT;
+	return io->backend;
+}
+
+ham_u32 ham_file_io_num_pending(const ham_file_io *io){
+	if(!ham_check(io != NULL)) return 0;
+	return io->num_pending;
+}
+
+bool ham_file_io_register_buffers(ham_file_io *io, ham_u32 num_bufs, void *const *bufs, const ham_usize *lens){
+	if(!ham_check(io != NULL) || !ham_check(num_bufs == 0 || (bufs && lens)) || !ham_check(io->num_pending == 0)){
+		return false;
+	}
+
+	iovec *new_bufs = nullptr;
+
+	if(num_bufs){
+		new_bufs = (iovec*)ham_allocator_alloc(io->allocator, alignof(iovec), sizeof(iovec) * num_bufs);
+		if(!new_bufs){
+			ham::logapierror("Error allocating {} buffer descriptors", num_bufs);
+			return false;
+		}
+
+		for(u32 i = 0; i < num_bufs; i++){
+			new_bufs[i] = (iovec){ .iov_base = bufs[i], .iov_len = lens[i] };
+		}
+	}
+
+#ifdef __linux__
+	if(io->backend == HAM_FILE_IO_BACKEND_IO_URING){
+		if(io->num_bufs){
+			syscall(__NR_io_uring_register, io->uring.fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+		}
+
+		if(num_bufs && syscall(__NR_io_uring_register, io->uring.fd, IORING_REGISTER_BUFFERS, new_bufs, num_bufs) != 0){
+			ham::logapierror("Error registering buffers: {}", strerror(errno));
+			ham_allocator_free(io->allocator, new_bufs);
+
+			if(io->bufs) ham_allocator_free(io->allocator, io->bufs);
+			io->bufs = nullptr;
+			io->num_bufs = 0;
+			return false;
+		}
+	}
+#endif
+
+	if(io->bufs) ham_allocator_free(io->allocator, io->bufs);
+
+	io->bufs = new_bufs;
+	io->num_bufs = num_bufs;
+	return true;
+}
+
+ham_u32 ham_file_io_submit(ham_file_io *io, ham_u32 num_reqs, const ham_file_io_request *reqs){
+	if(!ham_check(io != NULL) || !ham_check(num_reqs == 0 || reqs != NULL)) return (u32)-1;
+
+	const u32 num = std::min(num_reqs, io->depth - io->num_pending);
+
+	for(u32 i = 0; i < num; i++){
+		const auto req = reqs + i;
+
+		if(
+			!ham_check(req->file != NULL) || !ham_check(req->buf != NULL) || !ham_check(req->op < HAM_FILE_IO_OP_COUNT) ||
+			!ham_check(req->buf_index == HAM_FILE_IO_NO_BUFFER || ham_impl_file_io_req_buf(io, req) != NULL)
+		){
+			return (u32)-1;
+		}
+	}
+
+	if(!num) return 0;
+
+#ifdef __linux__
+	if(io->backend == HAM_FILE_IO_BACKEND_IO_URING){
+		auto &ring = io->uring;
+
+		const u32 mask = *ring.sq_mask;
+		const u32 first_tail = *ring.sq_tail;
+		u32 tail = first_tail;
+
+		// pack reads complete immediately, but only once it is known how many requests the kernel took
+
+		for(u32 i = 0; i < num; i++){
+			const auto req = reqs + i;
+			if(req->file->pack) continue;
+
+			const u32 idx = tail & mask;
+			const bool fixed = req->buf_index != HAM_FILE_IO_NO_BUFFER;
+
+			const auto sqe = ring.sqes + idx;
+			memset(sqe, 0, sizeof(*sqe));
+
+			if(req->op == HAM_FILE_IO_WRITE){
+				sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+			}
+			else{
+				sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+			}
+
+			sqe->fd = req->file->fd;
+			sqe->addr = (u64)(uptr)req->buf;
+			sqe->len = req->len;
+			sqe->off = req->off;
+			sqe->user_data = (u64)(uptr)req->user;
+			if(fixed) sqe->buf_index = (u16)req->buf_index;
+
+			ring.sq_array[idx] = idx;
+			++tail;
+		}
+
+		__atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+		u32 num_queued = tail - first_tail;
+		ring.num_unsubmitted += num_queued;
+
+		bool failed = false;
+
+		if(ring.num_unsubmitted){
+			// anything the kernel doesn't take now stays in the ring and goes with the next call
+			const int res = ham_impl_uring_enter(ring.fd, ring.num_unsubmitted, 0, 0);
+			if(res > 0){
+				ring.num_unsubmitted -= (u32)res;
+			}
+			else if(res < 0 && errno != EAGAIN && errno != EBUSY && errno != EINTR){
+				ham::logapierror("Error in io_uring_enter: {}", strerror(errno));
+
+				// the kernel never saw this call's entries, take them back out so they aren't reported as submitted
+				const u32 head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+				const u32 num_dropped = std::min(tail - head, num_queued);
+
+				tail -= num_dropped;
+				__atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+				ring.num_unsubmitted -= num_dropped;
+				num_queued -= num_dropped;
+				failed = num_dropped > 0;
+			}
+		}
+
+		// requests are taken front to back, so everything before the first dropped ring entry was accepted
+
+		u32 num_accepted = 0;
+
+		for(u32 num_ring = 0; num_accepted < num; num_accepted++){
+			const auto req = reqs + num_accepted;
+
+			if(req->file->pack){
+				ham_impl_file_io_complete_now(io, req);
+			}
+			else if(num_ring++ == num_queued){
+				break;
+			}
+		}
+
+		io->num_pending += num_accepted;
+
+		return failed && !num_accepted ? (u32)-1 : num_accepted;
+	}
+#endif
+
+	auto &pool = io->pool;
+
+	{
+		ham::scoped_lock lock(&pool.mut);
+
+		u32 num_queued = 0;
+
+		for(u32 i = 0; i < num; i++){
+			if(reqs[i].file->pack){
+				ham_impl_file_io_complete_now(io, reqs + i);
+				continue;
+			}
+
+			pool.queue[(pool.queue_head + pool.queue_count) % io->depth] = reqs[i];
+			++pool.queue_count;
+			++num_queued;
+		}
+
+		if(num_queued == 1) ham_cond_signal(&pool.work_cond);
+		else if(num_queued > 1) ham_cond_broadcast(&pool.work_cond);
+	}
+
+	io->num_pending += num;
+	return num;
+}
+
+ham_u32 ham_file_io_complete(ham_file_io *io, ham_u32 min_results, ham_u32 max_results, ham_file_io_result *results){
+	if(!ham_check(io != NULL) || !ham_check(max_results == 0 || results != NULL)) return (u32)-1;
+
+	min_results = std::min({ min_results, max_results, io->num_pending });
+
+	u32 num = 0;
+
+	while(io->ready_count && num < max_results){
+		results[num++] = io->ready[io->ready_head];
+		io->ready_head = (io->ready_head + 1) % io->depth;
+		--io->ready_count;
+	}
+
+#ifdef __linux__
+	if(io->backend == HAM_FILE_IO_BACKEND_IO_URING){
+		auto &ring = io->uring;
+
+		const u32 mask = *ring.cq_mask;
+
+		while(true){
+			u32 head = *ring.cq_head;
+			const u32 tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+			while(head != tail && num < max_results){
+				const auto cqe = ring.cqes + (head & mask);
+				results[num++] = (ham_file_io_result){ .user = (void*)(uptr)cqe->user_data, .res = (ham_isize)cqe->res };
+				++head;
+			}
+
+			__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+			if(num >= min_results) break;
+
+			const int res = ham_impl_uring_enter(ring.fd, ring.num_unsubmitted, min_results - num, IORING_ENTER_GETEVENTS);
+			if(res < 0){
+				if(errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+
+				ham::logapierror("Error in io_uring_enter: {}", strerror(errno));
+				io->num_pending -= num;
+				return num ? num : (u32)-1;
+			}
+
+			ring.num_unsubmitted -= (u32)res;
+		}
+
+		io->num_pending -= num;
+		return num;
+	}
+#endif
+
+	auto &pool = io->pool;
+
+	ham::scoped_lock lock(&pool.mut);
+
+	while(num + pool.done_count < min_results){
+		if(!ham_cond_wait(&pool.done_cond, &pool.mut)){
+			return (u32)-1;
+		}
+	}
+
+	while(pool.done_count && num < max_results){
+		results[num++] = pool.done[pool.done_head];
+		pool.done_head = (pool.done_head + 1) % io->depth;
+		--pool.done_count;
+	}
+
+	io->num_pending -= num;
+	return num;
+}
+
+HAM_C_API_END
+
+//
+// File watching
+//
+// Each watch owns an inotify instance and a thread reading it. Raw events are merged into a table
+// of pending changes keyed by path, which only the thread touches, and a change is published once
+// its path has been quiet for the debounce interval. Published events go through a single
+// producer, single consumer ring so polling never takes a lock; changes that don't fit stay pending
+// until the poller makes room. Each ring slot keeps its own path buffer, which is reused as the ring
+// wraps around, so file paths are never interned. A poll only hands its slots back at the start of
+// the next one, which is what keeps the paths it returned valid until then.
+//
+
+constexpr u32 ham_impl_fs_watch_ring_size = 1024;
+
+static_assert((ham_impl_fs_watch_ring_size & (ham_impl_fs_watch_ring_size - 1)) == 0, "ring size must be a power of 2");
+
+#ifdef __linux__
+
+// IN_CLOSE_WRITE rather than IN_MODIFY, nobody wants to reload a file halfway through being written
+constexpr u32 ham_impl_fs_watch_mask = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+struct ham_impl_fs_watch_dir{
+	ham_symbol path;
+	ham_symbol root; //!< Directory this one was found under, as passed to `ham_fs_watch_add`
+	bool recursive;
+};
+
+struct ham_impl_fs_watch_change{
+	ham_fs_watch_event_kind kind;
+	i64 deadline_ns;
+};
+
+struct ham_fs_watch{
+	const ham_allocator *allocator;
+	i64 debounce_ns;
+
+	int inotify_fd = -1, wake_fd = -1;
+	ham_thread *thread = nullptr;
+
+	std::mutex dirs_mut;
+	ham::flat_map<int, ham_impl_fs_watch_dir> dirs; // by watch descriptor
+
+	ham::flat_map<ham::str_buffer8, ham_impl_fs_watch_change> pending;
+
+	alignas(64) std::atomic<u64> head{ 0 }; // advanced by the poller
+	u32 num_polled = 0; // slots after head handed out by the last poll, only touched by the poller
+
+	alignas(64) std::atomic<u64> tail{ 0 }; // advanced by the thread
+	ham_fs_watch_event ring[ham_impl_fs_watch_ring_size];
+	ham::str_buffer8 ring_paths[ham_impl_fs_watch_ring_size];
+};
+
+static inline i64 ham_impl_fs_watch_now_ns(){
+	ham_timepoint tp = (ham_timepoint){ 0, 0 };
+	ham_timepoint_now(&tp, CLOCK_MONOTONIC);
+	return (i64)tp.tv_sec * 1000000000 + tp.tv_nsec;
+}
+
+using ham_impl_fs_watch_path_buffer = char[PATH_MAX];
+
+//! Writes `dir/name` into \p buf, returns an empty string if that's too long.
+static ham::str8 ham_impl_fs_watch_join(ham_symbol dir, const char *name, ham_impl_fs_watch_path_buffer &buf){
+	const auto dir_str = ham_symbol_str(dir);
+	const usize name_len = strlen(name);
+	const bool needs_sep = dir_str.len && dir_str.ptr[dir_str.len - 1] != '/';
+
+	const usize len = dir_str.len + needs_sep + name_len;
+	if(len >= sizeof(buf)) return ham::str8();
+
+	memcpy(buf, dir_str.ptr, dir_str.len);
+	if(needs_sep) buf[dir_str.len] = '/';
+	memcpy(buf + dir_str.len + needs_sep, name, name_len);
+	buf[len] = '\0';
+
+	return ham::str8(buf, len);
+}
+
+//! Strips trailing separators so event paths don't end up with doubled ones.
+static inline ham_str8 ham_impl_fs_watch_trim(ham_str8 dir){
+	while(dir.len > 1 && dir.ptr[dir.len - 1] == '/') --dir.len;
+	return dir;
+}
+
+/**
+ * Watches a directory and, if recursive, every directory below it. Files found along the way are
+ * appended to \p found_files if it isn't null. Expects `dirs_mut` to be held.
+ */
+static bool ham_impl_fs_watch_add_dir(ham_fs_watch *watch, ham_symbol path, ham_symbol root, bool recursive, ham::std_vector<ham::str_buffer8> *found_files){
+	const auto path_str = ham_symbol_str(path);
+
+	const int wd = inotify_add_watch(watch->inotify_fd, path_str.ptr, ham_impl_fs_watch_mask);
+	if(wd < 0){
+		ham::logapiwarn("Error in inotify_add_watch for '{}': {}", path_str, strerror(errno));
+		return false;
+	}
+
+	try{
+		const auto dir = ham_impl_fs_watch_dir{ path, root, recursive };
+
+		const auto existing = watch->dirs.get(wd);
+		if(existing) *existing = dir;
+		else watch->dirs.try_emplace(wd, dir);
+	}
+	catch(const ham::flat_map_alloc_error&){
+		ham::logapiwarn("Error allocating entry for '{}'", path_str);
+		inotify_rm_watch(watch->inotify_fd, wd);
+		return false;
+	}
+
+	if(!recursive && !found_files) return true;
+
+	const auto dir_handle = opendir(path_str.ptr);
+	if(!dir_handle){
+		// gone again already, inotify will tell us
+		return true;
+	}
+
+	while(const auto ent = readdir(dir_handle)){
+		if(!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) continue;
+
+		ham_impl_fs_watch_path_buffer child_buf;
+
+		const auto child = ham_impl_fs_watch_join(path, ent->d_name, child_buf);
+		if(child.is_empty()) continue;
+
+		bool is_dir = ent->d_type == DT_DIR;
+		if(ent->d_type == DT_UNKNOWN){
+			struct stat st;
+			is_dir = stat(child.ptr(), &st) == 0 && S_ISDIR(st.st_mode);
+		}
+
+		if(is_dir){
+			if(!recursive) continue;
+
+			// directories stay watched, so they're worth interning
+			const auto child_sym = ham_intern(child);
+			if(child_sym != HAM_SYMBOL_NULL) ham_impl_fs_watch_add_dir(watch, child_sym, root, true, found_files);
+		}
+		else if(found_files){
+			found_files->emplace_back(child);
+		}
+	}
+
+	closedir(dir_handle);
+	return true;
+}
+
+//! Merges a change into whatever is pending for the same path and pushes back its deadline.
+static void ham_impl_fs_watch_add_change(ham_fs_watch *watch, ham::str8 path, ham_fs_watch_event_kind kind, i64 now_ns){
+	const i64 deadline_ns = now_ns + watch->debounce_ns;
+
+	const auto pending = watch->pending.get(path);
+	if(!pending){
+		try{
+			watch->pending.try_emplace(path, ham_impl_fs_watch_change{ kind, deadline_ns });
+		}
+		catch(const ham::flat_map_alloc_error&){
+			ham::logapiwarn("Error allocating pending change, dropped event for '{}'", path);
+		}
+
+		return;
+	}
+
+	switch(pending->kind){
+		case HAM_FS_WATCH_CREATED:{
+			// still new to the poller, unless it's already gone again like a temporary file
+			if(kind == HAM_FS_WATCH_REMOVED){
+				watch->pending.erase(path);
+				return;
+			}
+
+			break;
+		}
+
+		case HAM_FS_WATCH_REMOVED:{
+			// replaced
+			if(kind != HAM_FS_WATCH_REMOVED) pending->kind = HAM_FS_WATCH_MODIFIED;
+			break;
+		}
+
+		default:{
+			if(kind == HAM_FS_WATCH_REMOVED) pending->kind = kind;
+			break;
+		}
+	}
+
+	pending->deadline_ns = deadline_ns;
+}
+
+//! Moves settled changes into the ring, returns whether they all fit.
+static bool ham_impl_fs_watch_publish(ham_fs_watch *watch, i64 now_ns){
+	const u64 head = watch->head.load(std::memory_order_acquire);
+	u64 tail = watch->tail.load(std::memory_order_relaxed);
+
+	bool all_fit = true;
+
+	for(auto it = watch->pending.begin(); it != watch->pending.end();){
+		if(it->second.deadline_ns > now_ns){
+			++it;
+			continue;
+		}
+
+		if(tail - head == ham_impl_fs_watch_ring_size){
+			all_fit = false;
+			break;
+		}
+
+		// the slot's buffer keeps its capacity, so once the ring has wrapped this rarely allocates
+		const u64 slot = tail & (ham_impl_fs_watch_ring_size - 1);
+
+		auto &path = watch->ring_paths[slot];
+		if(!path.set(it->first.get())){
+			ham::logapiwarn("Error allocating path, dropped event for '{}'", it->first.get());
+			it = watch->pending.erase(it);
+			continue;
+		}
+
+		watch->ring[slot] = ham_fs_watch_event{ it->second.kind, path.get() };
+		++tail;
+
+		it = watch->pending.erase(it);
+	}
+
+	watch->tail.store(tail, std::memory_order_release);
+	return all_fit;
+}
+
+static void ham_impl_fs_watch_handle(ham_fs_watch *watch, const inotify_event *ev, i64 now_ns, ham::std_vector<ham::str_buffer8> &found_files){
+	if(ev->mask & IN_Q_OVERFLOW){
+		ham::logapiwarn("inotify queue overflowed, some changes were missed");
+		return;
+	}
+
+	ham_impl_fs_watch_dir dir;
+
+	{
+		std::scoped_lock lock(watch->dirs_mut);
+
+		const auto watched = watch->dirs.get(ev->wd);
+		if(!watched) return;
+
+		if(ev->mask & IN_IGNORED){
+			watch->dirs.erase(ev->wd);
+			return;
+		}
+
+		dir = *watched;
+	}
+
+	if(!ev->len) return;
+
+	ham_impl_fs_watch_path_buffer path_buf;
+
+	const auto path = ham_impl_fs_watch_join(dir.path, ev->name, path_buf);
+	if(path.is_empty()) return;
+
+	if(ev->mask & IN_ISDIR){
+		if(!dir.recursive || !(ev->mask & (IN_CREATE | IN_MOVED_TO))) return;
+
+		const auto path_sym = ham_intern(path);
+		if(path_sym == HAM_SYMBOL_NULL){
+			ham::logapiwarn("Error in ham_intern, not watching '{}'", path);
+			return;
+		}
+
+		// anything written before the watch was in place would be missed otherwise
+		found_files.clear();
+
+		{
+			std::scoped_lock lock(watch->dirs_mut);
+			ham_impl_fs_watch_add_dir(watch, path_sym, dir.root, true, &found_files);
+		}
+
+		for(const auto &file : found_files){
+			ham_impl_fs_watch_add_change(watch, file, HAM_FS_WATCH_CREATED, now_ns);
+		}
+
+		return;
+	}
+
+	ham_fs_watch_event_kind kind;
+	if(ev->mask & (IN_CREATE | IN_MOVED_TO)) kind = HAM_FS_WATCH_CREATED;
+	else if(ev->mask & IN_CLOSE_WRITE) kind = HAM_FS_WATCH_MODIFIED;
+	else if(ev->mask & (IN_DELETE | IN_MOVED_FROM)) kind = HAM_FS_WATCH_REMOVED;
+	else return;
+
+	ham_impl_fs_watch_add_change(watch, path, kind, now_ns);
+}
+
+static ham_uptr ham_impl_fs_watch_thread(void *user){
+	const auto watch = (ham_fs_watch*)user;
+
+	alignas(inotify_event) char buf[4096];
+
+	pollfd fds[2] = {
+		{ watch->inotify_fd, POLLIN, 0 },
+		{ watch->wake_fd, POLLIN, 0 },
+	};
+
+	ham::std_vector<ham::str_buffer8> found_files;
+
+	bool ring_full = false;
+
+	while(true){
+		int timeout_ms = -1;
+
+		if(!watch->pending.empty()){
+			i64 earliest_ns = INT64_MAX;
+			for(const auto &change : watch->pending){
+				earliest_ns = std::min(earliest_ns, change.second.deadline_ns);
+			}
+
+			const i64 wait_ns = std::max<i64>(earliest_ns - ham_impl_fs_watch_now_ns(), 0);
+			timeout_ms = (int)((wait_ns + 999999) / 1000000);
+
+			// give the poller a chance to make room
+			if(ring_full) timeout_ms = std::max(timeout_ms, (int)std::max<i64>(watch->debounce_ns / 1000000, 1));
+		}
+
+		const int res = poll(fds, 2, timeout_ms);
+		if(res < 0){
+			if(errno == EINTR) continue;
+
+			ham::logapierror("Error in poll: {}", strerror(errno));
+			return 1;
+		}
+
+		if(fds[1].revents) break;
+
+		if(fds[0].revents & POLLIN){
+			const ssize_t len = read(watch->inotify_fd, buf, sizeof(buf));
+			if(len < 0 && errno != EAGAIN && errno != EINTR){
+				ham::logapierror("Error in read: {}", strerror(errno));
+				return 1;
+			}
+
+			const i64 now_ns = ham_impl_fs_watch_now_ns();
+
+			for(ssize_t off = 0; off < len;){
+				const auto ev = (const inotify_event*)(buf + off);
+				ham_impl_fs_watch_handle(watch, ev, now_ns, found_files);
+				off += sizeof(inotify_event) + ev->len;
+			}
+		}
+
+		ring_full = !ham_impl_fs_watch_publish(watch, ham_impl_fs_watch_now_ns());
+	}
+
+	return 0;
+}
+
+static void ham_impl_fs_watch_finish(ham_fs_watch *watch){
+	if(watch->wake_fd != -1) close(watch->wake_fd);
+	if(watch->inotify_fd != -1) close(watch->inotify_fd);
+	ham_allocator_delete(watch->allocator, watch);
+}
+
+HAM_C_API_BEGIN
+
+ham_fs_watch *ham_fs_watch_create(ham_u32 debounce_ms){
+	const auto allocator = ham_current_allocator();
+
+	const auto watch = ham_allocator_new(allocator, ham_fs_watch);
+	if(!watch){
+		ham::logapierror("Error allocating ham_fs_watch");
+		return nullptr;
+	}
+
+	watch->allocator = allocator;
+	watch->debounce_ns = (i64)debounce_ms * 1000000;
+
+	watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(watch->inotify_fd < 0){
+		ham::logapierror("Error in inotify_init1: {}", strerror(errno));
+		watch->inotify_fd = -1;
+		ham_impl_fs_watch_finish(watch);
+		return nullptr;
+	}
+
+	watch->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(watch->wake_fd < 0){
+		ham::logapierror("Error in eventfd: {}", strerror(errno));
+		watch->wake_fd = -1;
+		ham_impl_fs_watch_finish(watch);
+		return nullptr;
+	}
+
+	watch->thread = ham_thread_create(ham_impl_fs_watch_thread, watch);
+	if(!watch->thread){
+		ham::logapierror("Error in ham_thread_create");
+		ham_impl_fs_watch_finish(watch);
+		return nullptr;
+	}
+
+	ham_thread_set_name(watch->thread, HAM_LIT_UTF8("ham-fs-watch"));
+
+	return watch;
+}
+
+ham_nothrow void ham_fs_watch_destroy(ham_fs_watch *watch){
+	if(!watch) return;
+
+	const u64 wake = 1;
+	if(write(watch->wake_fd, &wake, sizeof(wake)) != sizeof(wake)){
+		ham::logapiwarn("Error in write: {}", strerror(errno));
+	}
+
+	ham_thread_destroy(watch->thread);
+
+	ham_impl_fs_watch_finish(watch);
+}
+
+bool ham_fs_watch_add(ham_fs_watch *watch, ham_str8 dir, ham_u32 flags){
+	if(!ham_check(watch != NULL) || !ham_check(dir.ptr && dir.len)) return false;
+
+	const auto path = ham_intern(ham_impl_fs_watch_trim(dir));
+	if(path == HAM_SYMBOL_NULL){
+		ham::logapierror("Error in ham_intern");
+		return false;
+	}
+
+	std::scoped_lock lock(watch->dirs_mut);
+	return ham_impl_fs_watch_add_dir(watch, path, path, flags & HAM_FS_WATCH_RECURSIVE, nullptr);
+}
+
+bool ham_fs_watch_remove(ham_fs_watch *watch, ham_str8 dir){
+	if(!ham_check(watch != NULL)) return false;
+
+	const auto root = ham_intern_find(ham_impl_fs_watch_trim(dir));
+	if(root == HAM_SYMBOL_NULL) return false;
+
+	std::scoped_lock lock(watch->dirs_mut);
+
+	bool found = false;
+
+	for(auto it = watch->dirs.begin(); it != watch->dirs.end();){
+		if(it->second.root != root){
+			++it;
+			continue;
+		}
+
+		inotify_rm_watch(watch->inotify_fd, it->first);
+		it = watch->dirs.erase(it);
+		found = true;
+	}
+
+	return found;
+}
+
+ham_nothrow ham_u32 ham_fs_watch_poll(ham_fs_watch *watch, ham_u32 max_events, ham_fs_watch_event *events){
+	if(!ham_check(watch != NULL) || !ham_check(events || !max_events)) return 0;
+
+	// the slots handed out last time are given back now, their paths were only valid until this call
+	const u64 head = watch->head.load(std::memory_order_relaxed) + watch->num_polled;
+	const u64 tail = watch->tail.load(std::memory_order_acquire);
+
+	const u32 num = (u32)std::min<u64>(tail - head, max_events);
+
+	for(u32 i = 0; i < num; i++){
+		events[i] = watch->ring[(head + i) & (ham_impl_fs_watch_ring_size - 1)];
+	}
+
+	watch->num_polled = num;
+	watch->head.store(head, std::memory_order_release);
+	return num;
+}
+
+HAM_C_API_END
+
+#else // !__linux__
+
+HAM_C_API_BEGIN
+
+ham_fs_watch *ham_fs_watch_create(ham_u32 debounce_ms){
+	(void)debounce_ms;
+	ham::logapierror("File watching is only implemented on Linux");
+	return nullptr;
+}
+
+ham_nothrow void ham_fs_watch_destroy(ham_fs_watch *watch){ (void)watch; }
+
+bool ham_fs_watch_add(ham_fs_watch *watch, ham_str8 dir, ham_u32 flags){
+	(void)watch; (void)dir; (void)flags;
+	return false;
+}
+
+bool ham_fs_watch_remove(ham_fs_watch *watch, ham_str8 dir){
+	(void)watch; (void)dir;
+	return false;
+}
+
+ham_nothrow ham_u32 ham_fs_watch_poll(ham_fs_watch *watch, ham_u32 max_events, ham_fs_watch_event *events){
+	(void)watch; (void)max_events; (void)events;
+	return 0;
+}
+
+HAM_C_API_END
+
+#endif // __linux__
+
+//
+// Cooked asset cache
+//
+// One file per entry, named by the hex digits of its key and fanned out over 256 directories by
+// the first byte. Each file starts with a header repeating the key and size, so a truncated or
+// misplaced entry is ignored instead of trusted. The directory is kept as an interned symbol, so
+// it can be read without a lock.
+//
+
+#define HAM_IMPL_ASSET_CACHE_MAGIC "HAMCOOK"
+constexpr u32 ham_impl_asset_cache_version = 1;
+
+struct ham_impl_asset_cache_header{
+	char magic[8];
+	u32 version;
+	u32 reserved;
+	u64 key_lo, key_hi;
+	u64 len;
+	char padding[HAM_ASSET_CACHE_DATA_ALIGNMENT - 40];
+};
+
+static_assert(sizeof(ham_impl_asset_cache_header) == HAM_ASSET_CACHE_DATA_ALIGNMENT);
+
+static std::atomic<ham_symbol> ham_impl_asset_cache_dir_sym{ HAM_SYMBOL_NULL };
+static std::atomic<u32> ham_impl_asset_cache_tmp_counter{ 0 };
+
+//! Writes the path of an entry to \p buf, returns the length of its directory or 0 if caching is off.
+static usize ham_impl_asset_cache_path(ham_asset_key key, char (&buf)[PATH_MAX]){
+	const auto dir = ham_symbol_str(ham_impl_asset_cache_dir_sym.load(std::memory_order_acquire));
+	if(!dir.len) return 0;
+
+	const int res = snprintf(buf, sizeof(buf), "%.*s/%02x/%014llx%016llx", (int)dir.len, dir.ptr, (u32)(key.hi >> 56), (unsigned long long)(key.hi & ((u64(1) << 56) - 1)), (unsigned long long)key.lo);
+	if(res < 0 || (usize)res >= sizeof(buf)) return 0;
+
+	return dir.len + 3;
+}
+
+static bool ham_impl_asset_cache_write_all(int fd, const void *data, usize len){
+	auto bytes = (const char*)data;
+
+	while(len){
+		const ssize_t res = write(fd, bytes, len);
+		if(res < 0){
+			if(errno == EINTR) continue;
+			return false;
+		}
+
+		bytes += res;
+		len -= (usize)res;
+	}
+
+	return true;
+}
+
+HAM_C_API_BEGIN
+
+bool ham_asset_cache_set_dir(ham_str8 dir){
+	if(!dir.ptr) dir.len = 0;
+
+	while(dir.len > 1 && dir.ptr[dir.len - 1] == '/') --dir.len;
+
+	if(!dir.len){
+		ham_impl_asset_cache_dir_sym.store(HAM_SYMBOL_NULL, std::memory_order_release);
+		return true;
+	}
+
+	const auto sym = ham_intern(dir);
+	if(sym == HAM_SYMBOL_NULL){
+		ham::logapierror("Error in ham_intern");
+		return false;
+	}
+
+	const auto path = ham_symbol_str(sym);
+
+	// every missing parent too
+	char buf[PATH_MAX];
+	if(path.len >= sizeof(buf)){
+		ham::logapierror("Cache directory path too long: {}", path);
+		return false;
+	}
+
+	memcpy(buf, path.ptr, path.len + 1);
+
+	for(usize i = 1; i <= path.len; i++){
+		if(i != path.len && buf[i] != '/') continue;
+
+		buf[i] = '\0';
+
+		if(mkdir(buf, 0755) != 0 && errno != EEXIST){
+			ham::logapierror("Error creating cache directory '{}': {}", (const char*)buf, strerror(errno));
+			return false;
+		}
+
+		buf[i] = path.ptr[i];
+	}
+
+	struct stat st;
+	if(stat(path.ptr, &st) != 0 || !S_ISDIR(st.st_mode) || access(path.ptr, W_OK) != 0){
+		ham::logapierror("Cache directory '{}' isn't a writable directory", path);
+		return false;
+	}
+
+	ham_impl_asset_cache_dir_sym.store(sym, std::memory_order_release);
+	return true;
+}
+
+ham_nothrow ham_str8 ham_asset_cache_dir(){
+	return ham_symbol_str(ham_impl_asset_cache_dir_sym.load(std::memory_order_acquire));
+}
+
+ham_nothrow ham_asset_key ham_asset_key_from_mem(ham_str8 cooker, ham_usize settings_len, const void *settings, ham_usize len, const void *data){
+	const u64 cooker_hash = ham_hash_fast_64(cooker.ptr, cooker.len);
+	const u64 seed = ham_hash_fast_64_seeded((const char*)settings, settings ? settings_len : 0, cooker_hash);
+
+	const auto hash = ham_hash_fast_128_seeded((const char*)data, data ? len : 0, seed);
+	return ham_asset_key{ hash.lo, hash.hi };
+}
+
+const void *ham_asset_cache_map(ham_asset_key key, ham_usize *len_ret){
+	if(!ham_check(len_ret != NULL)) return nullptr;
+
+	char path[PATH_MAX];
+	if(!ham_impl_asset_cache_path(key, path)) return nullptr;
+
+	const int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0){
+		if(errno != ENOENT){
+			ham::logapiwarn("Error opening cache entry '{}': {}", (const char*)path, strerror(errno));
+		}
+
+		return nullptr;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (usize)st.st_size < sizeof(ham_impl_asset_cache_header)){
+		ham::logapiwarn("Ignoring truncated cache entry '{}'", (const char*)path);
+		close(fd);
+		return nullptr;
+	}
+
+	const usize map_len = (usize)st.st_size;
+
+	// the mapping outlives the descriptor
+	const auto mapping = mmap(nullptr, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(mapping == MAP_FAILED){
+		ham::logapiwarn("Error in mmap: {}", strerror(errno));
+		return nullptr;
+	}
+
+	const auto header = (const ham_impl_asset_cache_header*)mapping;
+
+	if(
+		memcmp(header->magic, HAM_IMPL_ASSET_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != ham_impl_asset_cache_version ||
+		header->key_lo != key.lo || header->key_hi != key.hi ||
+		header->len != map_len - sizeof(ham_impl_asset_cache_header)
+	){
+		ham::logapiwarn("Ignoring bad cache entry '{}'", (const char*)path);
+		munmap(mapping, map_len);
+		return nullptr;
+	}
+
+	*len_ret = header->len;
+	return (const char*)mapping + sizeof(ham_impl_asset_cache_header);
+}
+
+ham_nothrow void ham_asset_cache_unmap(const void *data, ham_usize len){
+	if(!data) return;
+
+	const auto mapping = (char*)data - sizeof(ham_impl_asset_cache_header);
+
+	if(munmap(mapping, len + sizeof(ham_impl_asset_cache_header)) != 0){
+		ham::logapiwarn("Error in munmap: {}", strerror(errno));
+	}
+}
+
+bool ham_asset_cache_store(ham_asset_key key, ham_usize len, const void *data){
+	if(!ham_check(data || !len)) return false;
+
+	char path[PATH_MAX];
+
+	const usize dir_len = ham_impl_asset_cache_path(key, path);
+	if(!dir_len) return false;
+
+	path[dir_len] = '\0';
+	if(mkdir(path, 0755) != 0 && errno != EEXIST){
+		ham::logapiwarn("Error creating cache directory '{}': {}", (const char*)path, strerror(errno));
+		return false;
+	}
+
+	path[dir_len] = '/';
+
+	char tmp_path[PATH_MAX];
+
+	const int tmp_res = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp-%d-%u", path, (int)getpid(), ham_impl_asset_cache_tmp_counter.fetch_add(1, std::memory_order_relaxed));
+	if(tmp_res < 0 || (usize)tmp_res >= sizeof(tmp_path)){
+		ham::logapiwarn("Cache entry path too long");
+		return false;
+	}
+
+	const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if(fd < 0){
+		ham::logapiwarn("Error creating cache entry '{}': {}", (const char*)tmp_path, strerror(errno));
+		return false;
+	}
+
+	ham_impl_asset_cache_header header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, HAM_IMPL_ASSET_CACHE_MAGIC, sizeof(header.magic));
+	header.version = ham_impl_asset_cache_version;
+	header.key_lo = key.lo;
+	header.key_hi = key.hi;
+	header.len = len;
+
+	const bool written =
+		ham_impl_asset_cache_write_all(fd, &header, sizeof(header)) &&
+		ham_impl_asset_cache_write_all(fd, data, len);
+
+	if(close(fd) != 0 || !written){
+		ham::logapiwarn("Error writing cache entry '{}': {}", (const char*)tmp_path, strerror(errno));
+		unlink(tmp_path);
+		return false;
+	}
+
+	if(rename(tmp_path, path) != 0){
+		ham::logapiwarn("Error moving cache entry into place '{}': {}", (const char*)path, strerror(errno));
+		unlink(tmp_path);
+		return false;
+	}
+
+	return true;
+}
+
+HAM_C_API_END
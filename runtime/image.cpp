@@ -60,6 +60,7 @@ union ham_image_data{
 struct ham_image{
 	const ham_allocator *allocator;
 	bool is_stored;
+	bool owns_pixels;
 	ham_image_data data;
 };
 
@@ -120,6 +121,7 @@ ham_image *ham_image_create_alloc(const ham_allocator *allocator, ham_color_form
 
 	img->allocator = allocator;
 	img->is_stored = true;
+	img->owns_pixels = true;
 
 	img->data = ham_image_data{
 		.stored = {
@@ -141,16 +143,42 @@ ham_image *ham_image_create_view(const ham_image *img){
 
 	ret->allocator = allocator;
 	ret->is_stored = false;
+	ret->owns_pixels = false;
 	ret->data.view = img;
 
 	return ret;
 }
 
-ham_image *ham_image_load_from_mem(ham_color_format format, ham_usize len, const void *data){
-	if(!ham_check(len > 0) || !ham_check(data != NULL)){
+ham_image *ham_image_create_pixels_view(ham_color_format format, ham_u32 w, ham_u32 h, const void *pixels){
+	if(!ham_check(format < HAM_COLOR_FORMAT_COUNT) || !ham_check(w != 0) || !ham_check(h != 0) || !ham_check(pixels != NULL)){
 		return nullptr;
 	}
 
+	const auto allocator = ham_current_allocator();
+
+	const auto img = ham_allocator_new(allocator, ham_image);
+	if(!img) return nullptr;
+
+	img->allocator = allocator;
+	img->is_stored = true;
+	img->owns_pixels = false;
+
+	img->data = ham_image_data{
+		.stored = {
+			.format = format,
+			.w = w,
+			.h = h,
+			.pixels = const_cast<void*>(pixels),
+		}
+	};
+
+	return img;
+}
+
+HAM_C_API_END
+
+//! Decodes an image with FreeImage, skipping the cache.
+static ham_image *ham_impl_image_decode(ham_color_format format, ham_usize len, const void *data){
 	if(format != HAM_RGBA8U){
 		ham_logapierrorf("Only RGBA8 color format currently supported");
 		return nullptr;
@@ -307,6 +335,7 @@ ham_image *ham_image_load_from_mem(ham_color_format format, ham_usize len, const
 
 	img->allocator = allocator;
 	img->is_stored = true;
+	img->owns_pixels = true;
 
 	img->data = ham_image_data{
 		.stored = {
@@ -323,6 +352,110 @@ ham_image *ham_image_load_from_mem(ham_color_format format, ham_usize len, const
 	return img;
 }
 
+//
+// Cooked images
+//
+// Decoded pixels behind a small header, stored in the asset cache under the source bytes and
+// everything that changes how they decode.
+//
+
+struct ham_impl_image_cooked_header{
+	u32 format;
+	u32 w, h;
+	u32 reserved;
+};
+
+struct ham_impl_image_import_settings{
+	u32 format;
+	u32 debug; // JPEGs decode faster but worse in debug builds
+};
+
+static inline usize ham_impl_image_pixels_size(ham_color_format format, u32 w, u32 h){
+	return (usize)w * h * ham_color_format_num_components(format) * ham_color_format_component_size(format);
+}
+
+static ham_image *ham_impl_image_from_cooked(ham_color_format format, usize len, const void *data){
+	if(len < sizeof(ham_impl_image_cooked_header)) return nullptr;
+
+	const auto header = (const ham_impl_image_cooked_header*)data;
+
+	if(
+		header->format != (u32)format || !header->w || !header->h ||
+		len - sizeof(*header) != ham_impl_image_pixels_size(format, header->w, header->h)
+	){
+		return nullptr;
+	}
+
+	return ham_image_create(format, header->w, header->h, (const char*)data + sizeof(*header));
+}
+
+static void ham_impl_image_store_cooked(ham_asset_key key, const ham_image *img){
+	const auto format = ham_image_format(img);
+	const u32 w = ham_image_width(img), h = ham_image_height(img);
+	const usize pixels_size = ham_impl_image_pixels_size(format, w, h);
+
+	const auto allocator = ham_current_allocator();
+
+	const auto cooked = (char*)ham_allocator_alloc(allocator, alignof(ham_impl_image_cooked_header), sizeof(ham_impl_image_cooked_header) + pixels_size);
+	if(!cooked){
+		ham::logwarn("ham_image_load_from_mem", "Error allocating {} bytes for cooked image", sizeof(ham_impl_image_cooked_header) + pixels_size);
+		return;
+	}
+
+	const ham_impl_image_cooked_header header = { (u32)format, w, h, 0 };
+
+	memcpy(cooked, &header, sizeof(header));
+	memcpy(cooked + sizeof(header), ham_image_pixels(img), pixels_size);
+
+	ham_asset_cache_store(key, sizeof(header) + pixels_size, cooked);
+
+	ham_allocator_free(allocator, cooked);
+}
+
+HAM_C_API_BEGIN
+
+ham_nothrow ham_asset_key ham_image_cache_key(ham_color_format format, ham_usize len, const void *data){
+	ham_impl_image_import_settings settings;
+	memset(&settings, 0, sizeof(settings));
+
+	settings.format = (u32)format;
+#ifdef HAM_DEBUG
+	settings.debug = 1;
+#endif
+
+	return ham_asset_key_from_mem(ham::str8("ham_image/1"), sizeof(settings), &settings, len, data);
+}
+
+ham_image *ham_image_load_from_mem(ham_color_format format, ham_usize len, const void *data){
+	if(!ham_check(len > 0) || !ham_check(data != NULL)){
+		return nullptr;
+	}
+
+	if(!ham_asset_cache_dir().len){
+		return ham_impl_image_decode(format, len, data);
+	}
+
+	const auto key = ham_image_cache_key(format, len, data);
+
+	usize cooked_len;
+	const auto cooked = ham_asset_cache_map(key, &cooked_len);
+	if(cooked){
+		const auto img = ham_impl_image_from_cooked(format, cooked_len, cooked);
+		ham_asset_cache_unmap(cooked, cooked_len);
+
+		if(img) return img;
+
+		ham_logapiwarnf("Ignoring bad cooked image");
+	}
+
+	const auto img = ham_impl_image_decode(format, len, data);
+	if(img){
+		ham_impl_image_store_cooked(key, img);
+	}
+
+	return img;
+}
+
 ham_image *ham_image_load(ham_color_format format, ham_str8 filepath){
 	if(!ham_check(filepath.len > 0) || !ham_check(filepath.ptr != NULL)){
 		return nullptr;
@@ -354,7 +487,7 @@ void ham_image_destroy(ham_image *img){
 
 	const auto allocator = img->allocator;
 
-	if(img->is_stored){
+	if(img->is_stored && img->owns_pixels){
 		ham_allocator_free(allocator, img->data.stored.pixels);
 	}
 
@@ -376,4 +509,9 @@ ham_u32 ham_image_height(const ham_image *img){
 	return img->is_stored ? img->data.stored.h : ham_image_height(img->data.view);
 }
 
+ham_color_format ham_image_format(const ham_image *img){
+	if(!ham_check(img != NULL)) return HAM_COLOR_FORMAT_COUNT;
+	return img->is_stored ? img->data.stored.format : ham_image_format(img->data.view);
+}
+
 HAM_C_API_END
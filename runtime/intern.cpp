@@ -0,0 +1,306 @@
+/*
+ * Ham Runtime
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/intern.h"
+#include "ham/hash.h"
+#include "ham/async.h"
+#include "ham/memory.h"
+#include "ham/check.h"
+
+#include <atomic>
+#include <new>
+
+using namespace ham::typedefs;
+
+//
+// String interning
+//
+// Lookups are lock-free: strings are placed in an insert-only open addressing table of entry
+// pointers that readers probe with acquire loads, the same scheme as the typeset index.
+// Writers serialize on a single mutex, copy the string into an arena block, give it the next
+// symbol and then publish it in both the symbol directory and the table. Nothing is ever freed,
+// not even at exit, so views returned by `ham_symbol_str` stay valid for the lifetime of the process.
+//
+
+struct ham_impl_symbol_entry{
+	u64 hash;
+	ham_symbol sym;
+	u32 len;
+
+	// followed by `len` characters and a null terminator
+	const char *str() const noexcept{ return reinterpret_cast<const char*>(this + 1); }
+};
+
+using ham_impl_symbol_slot = std::atomic<const ham_impl_symbol_entry*>;
+
+struct ham_impl_symbol_table{
+	usize mask;
+	ham_impl_symbol_slot *slots;
+	ham_impl_symbol_table *prev; //!< Kept alive for readers still probing it
+};
+
+struct ham_impl_intern_block{
+	ham_impl_intern_block *next;
+	usize used, capacity;
+
+	char *data() noexcept{ return reinterpret_cast<char*>(this + 1); }
+};
+
+constexpr usize ham_impl_intern_block_size = 64 * 1024;
+constexpr usize ham_impl_intern_min_table_capacity = 1024;
+
+constexpr usize ham_impl_intern_page_shift = 12;
+constexpr usize ham_impl_intern_page_size  = usize(1) << ham_impl_intern_page_shift;
+constexpr usize ham_impl_intern_max_pages  = 1024;
+
+struct ham_impl_interner{
+	ham::mutex mut;
+
+	std::atomic<const ham_impl_symbol_table*> table{ nullptr };
+	usize num_entries = 0;
+
+	std::atomic<usize> num_symbols{ 0 };
+	std::atomic<const ham_impl_symbol_entry**> pages[ham_impl_intern_max_pages] = {};
+
+	ham_impl_intern_block *blocks = nullptr;
+};
+
+static inline ham_impl_interner &ham_impl_interner_get(){
+	// never destroyed, symbols may still be looked up from other static destructors
+	alignas(ham_impl_interner) static char storage[sizeof(ham_impl_interner)];
+	static const auto inst = new(storage) ham_impl_interner;
+	return *inst;
+}
+
+static inline u64 ham_impl_intern_hash(ham::str8 str){
+	return ham_str_hash_utf8(str);
+}
+
+ham_nonnull_args(1)
+static inline const ham_impl_symbol_entry *ham_impl_intern_find(const ham_impl_symbol_table *table, u64 hash, ham::str8 str){
+	// load factor is kept at or below 1/2 so there is always an empty slot to stop on
+	for(usize i = hash & table->mask;; i = (i + 1) & table->mask){
+		const auto entry = table->slots[i].load(std::memory_order_acquire);
+		if(!entry){
+			return nullptr;
+		}
+		else if(entry->hash == hash && entry->len == str.len() && memcmp(entry->str(), str.ptr(), str.len()) == 0){
+			return entry;
+		}
+	}
+}
+
+ham_nonnull_args(1, 2)
+static inline void ham_impl_intern_place(ham_impl_symbol_table *table, const ham_impl_symbol_entry *entry){
+	usize i = entry->hash & table->mask;
+	while(table->slots[i].load(std::memory_order_relaxed)){
+		i = (i + 1) & table->mask;
+	}
+
+	table->slots[i].store(entry, std::memory_order_release);
+}
+
+//! Caller must hold `interner->mut`.
+ham_nonnull_args(1)
+static ham_impl_symbol_table *ham_impl_intern_table_create(ham_impl_interner *interner, usize capacity){
+	const auto allocator = &ham_impl_default_allocator;
+
+	const auto slots = (ham_impl_symbol_slot*)ham_allocator_alloc(allocator, alignof(ham_impl_symbol_slot), capacity * sizeof(ham_impl_symbol_slot));
+	if(!slots) return nullptr;
+
+	for(usize i = 0; i < capacity; i++){
+		new(slots + i) ham_impl_symbol_slot(nullptr);
+	}
+
+	const auto ret = ham_allocator_new(allocator, ham_impl_symbol_table);
+	if(!ret){
+		ham_allocator_free(allocator, slots);
+		return nullptr;
+	}
+
+	const auto old_table = const_cast<ham_impl_symbol_table*>(interner->table.load(std::memory_order_relaxed));
+
+	ret->mask  = capacity - 1;
+	ret->slots = slots;
+	ret->prev  = old_table;
+
+	if(old_table){
+		for(usize i = 0; i <= old_table->mask; i++){
+			const auto entry = old_table->slots[i].load(std::memory_order_relaxed);
+			if(entry) ham_impl_intern_place(ret, entry);
+		}
+	}
+
+	interner->table.store(ret, std::memory_order_release);
+	return ret;
+}
+
+//! Caller must hold `interner->mut`.
+ham_nonnull_args(1)
+static void *ham_impl_intern_arena_alloc(ham_impl_interner *interner, usize size){
+	constexpr usize alignment = alignof(ham_impl_symbol_entry);
+
+	size = ((size + alignment - 1) / alignment) * alignment;
+
+	auto block = interner->blocks;
+
+	if(!block || (block->capacity - block->used) < size){
+		// big strings get a block of their own, the current block keeps filling up
+		const usize capacity = ham_max(size, ham_impl_intern_block_size - sizeof(ham_impl_intern_block));
+
+		block = (ham_impl_intern_block*)ham_allocator_alloc(&ham_impl_default_allocator, alignof(ham_impl_intern_block), sizeof(ham_impl_intern_block) + capacity);
+		if(!block) return nullptr;
+
+		block->used = 0;
+		block->capacity = capacity;
+
+		if(interner->blocks && capacity > ham_impl_intern_block_size){
+			block->next = interner->blocks->next;
+			interner->blocks->next = block;
+		}
+		else{
+			block->next = interner->blocks;
+			interner->blocks = block;
+		}
+	}
+
+	const auto ret = block->data() + block->used;
+	block->used += size;
+	return ret;
+}
+
+ham_nonnull_args(1)
+static inline const ham_impl_symbol_entry *ham_impl_intern_entry(const ham_impl_interner *interner, ham_symbol sym){
+	if(sym == HAM_SYMBOL_NULL || sym > interner->num_symbols.load(std::memory_order_acquire)){
+		return nullptr;
+	}
+
+	const usize idx = sym - 1;
+
+	const auto page = interner->pages[idx >> ham_impl_intern_page_shift].load(std::memory_order_acquire);
+	return page ? page[idx & (ham_impl_intern_page_size - 1)] : nullptr;
+}
+
+HAM_C_API_BEGIN
+
+ham_symbol ham_intern(ham_str8 str_){
+	const ham::str8 str = str_;
+	if(str.len() == 0) return HAM_SYMBOL_NULL;
+
+	if(str.len() > (usize)UINT32_MAX){
+		ham::logapierror("String too long to intern: {} bytes", str.len());
+		return HAM_SYMBOL_NULL;
+	}
+
+	auto &interner = ham_impl_interner_get();
+
+	const auto hash = ham_impl_intern_hash(str);
+
+	{
+		const auto table = interner.table.load(std::memory_order_acquire);
+		if(table){
+			const auto existing = ham_impl_intern_find(table, hash, str);
+			if(existing) return existing->sym;
+		}
+	}
+
+	ham::scoped_lock lock(interner.mut);
+
+	auto table = const_cast<ham_impl_symbol_table*>(interner.table.load(std::memory_order_relaxed));
+
+	if(table){
+		// somebody may have beaten us to it
+		const auto existing = ham_impl_intern_find(table, hash, str);
+		if(existing) return existing->sym;
+	}
+
+	const usize idx = interner.num_symbols.load(std::memory_order_relaxed);
+	if(idx >= (ham_impl_intern_max_pages * ham_impl_intern_page_size)){
+		ham::logapierror("Too many interned strings");
+		return HAM_SYMBOL_NULL;
+	}
+
+	if(!table || (interner.num_entries + 1) * 2 > (table->mask + 1)){
+		table = ham_impl_intern_table_create(&interner, table ? (table->mask + 1) * 2 : ham_impl_intern_min_table_capacity);
+		if(!table){
+			ham::logapierror("Failed to grow intern table");
+			return HAM_SYMBOL_NULL;
+		}
+	}
+
+	auto &page_slot = interner.pages[idx >> ham_impl_intern_page_shift];
+
+	auto page = const_cast<const ham_impl_symbol_entry**>(page_slot.load(std::memory_order_relaxed));
+	if(!page){
+		page = (const ham_impl_symbol_entry**)ham_allocator_alloc(&ham_impl_default_allocator, alignof(void*), ham_impl_intern_page_size * sizeof(void*));
+		if(!page){
+			ham::logapierror("Failed to allocate symbol page");
+			return HAM_SYMBOL_NULL;
+		}
+
+		page_slot.store(page, std::memory_order_release);
+	}
+
+	const auto mem = ham_impl_intern_arena_alloc(&interner, sizeof(ham_impl_symbol_entry) + str.len() + 1);
+	if(!mem){
+		ham::logapierror("Failed to allocate interned string");
+		return HAM_SYMBOL_NULL;
+	}
+
+	const auto entry = new(mem) ham_impl_symbol_entry;
+	entry->hash = hash;
+	entry->sym  = (ham_symbol)(idx + 1);
+	entry->len  = (u32)str.len();
+
+	const auto entry_str = const_cast<char*>(entry->str());
+	memcpy(entry_str, str.ptr(), str.len());
+	entry_str[str.len()] = '\0';
+
+	page[idx & (ham_impl_intern_page_size - 1)] = entry;
+	interner.num_symbols.store(idx + 1, std::memory_order_release);
+
+	ham_impl_intern_place(table, entry);
+	++interner.num_entries;
+
+	return entry->sym;
+}
+
+ham_nothrow ham_symbol ham_intern_find(ham_str8 str_){
+	const ham::str8 str = str_;
+	if(str.len() == 0) return HAM_SYMBOL_NULL;
+
+	const auto &interner = ham_impl_interner_get();
+
+	const auto table = interner.table.load(std::memory_order_acquire);
+	if(!table) return HAM_SYMBOL_NULL;
+
+	const auto entry = ham_impl_intern_find(table, ham_impl_intern_hash(str), str);
+	return entry ? entry->sym : HAM_SYMBOL_NULL;
+}
+
+ham_nothrow ham_str8 ham_symbol_str(ham_symbol sym){
+	const auto entry = ham_impl_intern_entry(&ham_impl_interner_get(), sym);
+	if(!entry) return ham_str8{ "", 0 };
+	return ham_str8{ entry->str(), entry->len };
+}
+
+ham_nothrow ham_usize ham_intern_num_symbols(){
+	return ham_impl_interner_get().num_symbols.load(std::memory_order_acquire);
+}
+
+HAM_C_API_END
@@ -17,6 +17,19 @@
  */
 
 #include "ham/log.h"
+#include "ham/async.h"
+#include "ham/memory.h"
+#include "ham/check.h"
+#include "ham/fs.h"
+#include "ham/hash.h"
+#include "ham/flat_map.hpp"
+#include "ham/std_vector.hpp"
+
+#include "fmt/args.h"
+
+#include <atomic>
+
+using namespace ham::typedefs;
 
 HAM_C_API_BEGIN
 
@@ -51,6 +64,7 @@ static inline ham_usize ham_impl_default_log_fn(
 static const ham_logger ham_impl_default_logger_inst{
 	.log = ham_impl_default_log_fn,
 	.user = nullptr,
+	.log_structured = nullptr,
 };
 
 bool ham_impl_verbose_flag =
@@ -66,4 +80,1112 @@ ham_thread_local ham_message_buffer ham_impl_message_buf = { 0 };
 ham_thread_local const ham_logger *ham_impl_thread_logger = ham_null;
 ham_thread_local const ham_logger *const *ham_impl_current_logger = &ham_impl_global_logger;
 
+ham_usize ham_log_format_structured(ham_str8 fmt_str, ham_u32 num_args, ham_usize args_size, const void *args, ham_usize buf_len, char *buf){
+	if(!ham_check(buf != NULL) || !ham_check(buf_len > 0)) return (usize)-1;
+
+	buf[0] = '\0';
+
+	if(!ham_check(fmt_str.ptr != NULL) || !ham_check(args_size == 0 || args != NULL)) return (usize)-1;
+
+	const auto bytes = (const char*)args;
+	usize off = 0;
+
+	const auto read = [&](void *dst, usize len){
+		if(len > args_size - off) return false;
+		memcpy(dst, bytes + off, len);
+		off += len;
+		return true;
+	};
+
+	fmt::dynamic_format_arg_store<fmt::format_context> store;
+	store.reserve(num_args, 0);
+
+	for(u32 i = 0; i < num_args; i++){
+		u8 kind;
+		if(!read(&kind, 1)) return (usize)-1;
+
+		switch(kind){
+			case HAM_LOG_ARG_I64:{
+				i64 val;
+				if(!read(&val, sizeof(val))) return (usize)-1;
+				store.push_back((long long)val);
+				break;
+			}
+
+			case HAM_LOG_ARG_U64:{
+				u64 val;
+				if(!read(&val, sizeof(val))) return (usize)-1;
+				store.push_back((unsigned long long)val);
+				break;
+			}
+
+			case HAM_LOG_ARG_F32:{
+				f32 val;
+				if(!read(&val, sizeof(val))) return (usize)-1;
+				store.push_back(val);
+				break;
+			}
+
+			case HAM_LOG_ARG_F64:{
+				f64 val;
+				if(!read(&val, sizeof(val))) return (usize)-1;
+				store.push_back(val);
+				break;
+			}
+
+			case HAM_LOG_ARG_BOOL:{
+				u8 val;
+				if(!read(&val, sizeof(val))) return (usize)-1;
+				store.push_back(val != 0);
+				break;
+			}
+
+			case HAM_LOG_ARG_CHAR:{
+				char val;
+				if(!read(&val, sizeof(val))) return (usize)-1;
+				store.push_back(val);
+				break;
+			}
+
+			case HAM_LOG_ARG_PTR:{
+				u64 val;
+				if(!read(&val, sizeof(val))) return (usize)-1;
+				store.push_back((const void*)(uptr)val);
+				break;
+			}
+
+			case HAM_LOG_ARG_STR:{
+				u32 len;
+				if(!read(&len, sizeof(len)) || len > args_size - off) return (usize)-1;
+				store.push_back(fmt::string_view(bytes + off, len));
+				off += len;
+				break;
+			}
+
+			default: return (usize)-1;
+		}
+	}
+
+	usize len;
+
+	try{
+		const auto res = fmt::vformat_to_n(buf, buf_len - 1, fmt::string_view(fmt_str.ptr, fmt_str.len), store);
+		len = res.size < buf_len - 1 ? res.size : buf_len - 1;
+	}
+	catch(const fmt::format_error&){
+		// keep what we can rather than losing the record
+		len = fmt_str.len < buf_len - 1 ? fmt_str.len : buf_len - 1;
+		memcpy(buf, fmt_str.ptr, len);
+	}
+
+	buf[len] = '\0';
+	return len;
+}
+
+HAM_C_API_END
+
+//
+// Asynchronous logging
+//
+// Each producing thread claims a ring from the logger on first use and is the only writer of it,
+// so enqueueing a record is a copy and a release store. The writer thread drains every ring into
+// the sink and sleeps on a semaphore once they are all empty; producers only touch the semaphore
+// when they see the writer asleep. A thread gives its ring back when it exits or switches to
+// another async logger, which goes through a registry of live loggers so a thread outliving its
+// logger never touches freed memory.
+//
+// Structured records are copied into the ring as they are and only formatted by the writer thread,
+// or not at all when writing a binary log. A binary log is a magic number followed by a stream of
+// tagged records; format strings and api names are written once the first time they are seen and
+// referred to by an id derived from their contents after that.
+//
+
+//! Record header, followed by the null-terminated api name and message. Records never wrap.
+struct ham_impl_async_log_record{
+	u32 size; //!< Total bytes including padding
+	u32 level; //!< `ham_log_level`, optionally with `ham_impl_async_log_structured_bit`, or `ham_impl_async_log_skip` for padding up to the end of the ring
+	u32 api_len, msg_len; //!< For structured records `msg_len` is the size of the record following the header
+	ham_timepoint tp;
+
+	const char *api() const noexcept{ return reinterpret_cast<const char*>(this + 1); }
+	const char *msg() const noexcept{ return api() + api_len + 1; }
+
+	const ham_log_structured *structured() const noexcept{ return reinterpret_cast<const ham_log_structured*>(this + 1); }
+};
+
+constexpr u32 ham_impl_async_log_skip = (u32)-1;
+constexpr u32 ham_impl_async_log_structured_bit = 0x80000000;
+constexpr usize ham_impl_async_log_min_ring_size = 4 * 1024;
+
+struct ham_impl_async_log_ring{
+	std::atomic<bool> claimed{ false };
+	std::atomic<char*> buf{ nullptr };
+	std::atomic<u64> dropped{ 0 };
+
+	alignas(64) std::atomic<u64> head{ 0 }; //!< Only written by the writer thread
+	alignas(64) std::atomic<u64> tail{ 0 }; //!< Only written by the claiming thread
+};
+
+struct ham_async_logger{
+	const ham_allocator *allocator;
+	u64 id;
+
+	ham_logger iface;
+	const ham_logger *sink;
+
+	//! Binary log output, only touched by the writer thread once it is running
+	ham_file *out_file = nullptr;
+	char *out_buf = nullptr;
+	usize out_len = 0;
+	bool out_failed = false;
+	ham::flat_map<u64, bool> out_strs;
+
+	usize ring_size;
+	u32 num_rings;
+	ham_impl_async_log_ring *rings;
+
+	std::atomic<u64> unclaimed_drops{ 0 };
+	std::atomic<u64> num_dropped{ 0 };
+
+	std::atomic<bool> writer_asleep{ false };
+	std::atomic<bool> stopping{ false };
+	ham_sem wake_sem;
+
+	std::atomic<u64> flush_req{ 0 };
+	u64 flush_done = 0; //!< Guarded by `flush_mut`
+	ham_mutex flush_mut;
+	ham_cond flush_cond;
+
+	ham_thread *writer;
+};
+
+struct ham_impl_async_log_registry{
+	ham::mutex mut;
+	ham_async_logger *live[64] = {};
+	usize num_live = 0;
+	u64 next_id = 1;
+};
+
+static inline ham_impl_async_log_registry &ham_impl_async_log_registry_get(){
+	static ham_impl_async_log_registry inst;
+	return inst;
+}
+
+//! Caller must hold the registry lock.
+static inline bool ham_impl_async_log_is_live(const ham_impl_async_log_registry &reg, const ham_async_logger *logger, u64 id){
+	for(usize i = 0; i < reg.num_live; i++){
+		if(reg.live[i] == logger && logger->id == id) return true;
+	}
+
+	return false;
+}
+
+struct ham_impl_async_log_thread{
+	ham_async_logger *logger = nullptr;
+	u64 logger_id = 0;
+	ham_impl_async_log_ring *ring = nullptr;
+
+	void release() noexcept{
+		if(!ring) return;
+
+		auto &reg = ham_impl_async_log_registry_get();
+
+		{
+			ham::scoped_lock lock(reg.mut);
+			if(ham_impl_async_log_is_live(reg, logger, logger_id)){
+				ring->claimed.store(false, std::memory_order_release);
+			}
+		}
+
+		logger = nullptr;
+		logger_id = 0;
+		ring = nullptr;
+	}
+
+	~ham_impl_async_log_thread(){ release(); }
+};
+
+static thread_local ham_impl_async_log_thread ham_impl_async_log_tls;
+
+static ham_impl_async_log_ring *ham_impl_async_log_claim(ham_async_logger *logger){
+	auto &tls = ham_impl_async_log_tls;
+
+	if(tls.logger == logger && tls.logger_id == logger->id){
+		return tls.ring;
+	}
+
+	tls.release();
+
+	for(u32 i = 0; i < logger->num_rings; i++){
+		const auto ring = logger->rings + i;
+
+		bool expected = false;
+		if(!ring->claimed.compare_exchange_strong(expected, true, std::memory_order_acq_rel)){
+			continue;
+		}
+
+		if(!ring->buf.load(std::memory_order_acquire)){
+			const auto buf = (char*)ham_allocator_alloc(logger->allocator, alignof(ham_impl_async_log_record), logger->ring_size);
+			if(!buf){
+				ring->claimed.store(false, std::memory_order_release);
+				return nullptr;
+			}
+
+			ring->buf.store(buf, std::memory_order_release);
+		}
+
+		tls.logger = logger;
+		tls.logger_id = logger->id;
+		tls.ring = ring;
+		return ring;
+	}
+
+	return nullptr;
+}
+
+static inline void ham_impl_async_log_wake(ham_async_logger *logger){
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if(logger->writer_asleep.load(std::memory_order_relaxed) && logger->writer_asleep.exchange(false, std::memory_order_acq_rel)){
+		ham_sem_post(&logger->wake_sem);
+	}
+}
+
+//! Reserve space for a record with `payload` bytes following the header, the record is published by `ham_impl_async_log_commit`.
+static ham_impl_async_log_record *ham_impl_async_log_reserve(ham_async_logger *logger, ham_impl_async_log_ring *ring, usize payload, u64 *ret_tail){
+	const usize unpadded = sizeof(ham_impl_async_log_record) + payload;
+	const usize size = (unpadded + alignof(ham_impl_async_log_record) - 1) & ~(alignof(ham_impl_async_log_record) - 1);
+
+	const usize mask = logger->ring_size - 1;
+	const u64 tail = ring->tail.load(std::memory_order_relaxed);
+	const u64 head = ring->head.load(std::memory_order_acquire);
+
+	const usize off = tail & mask;
+	const usize contiguous = logger->ring_size - off;
+	const usize req = size + (contiguous < size ? contiguous : 0);
+
+	if((tail - head) + req > logger->ring_size){
+		ring->dropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	const auto buf = ring->buf.load(std::memory_order_relaxed);
+
+	usize rec_off = off;
+
+	if(contiguous < size){
+		// contiguous is always a multiple of the record alignment so the skip header fits
+		const auto skip = (ham_impl_async_log_record*)(buf + off);
+		skip->size = (u32)contiguous;
+		skip->level = ham_impl_async_log_skip;
+		rec_off = 0;
+	}
+
+	const auto rec = (ham_impl_async_log_record*)(buf + rec_off);
+	rec->size = (u32)size;
+
+	*ret_tail = tail + req;
+	return rec;
+}
+
+static inline void ham_impl_async_log_commit(ham_async_logger *logger, ham_impl_async_log_ring *ring, u64 tail){
+	ring->tail.store(tail, std::memory_order_release);
+	ham_impl_async_log_wake(logger);
+}
+
+static bool ham_impl_async_log_push(
+	ham_async_logger *logger, ham_impl_async_log_ring *ring,
+	ham_timepoint tp, ham_log_level level, const char *api, const char *msg
+){
+	const usize api_len = strnlen(api, HAM_MESSAGE_BUFFER_SIZE - 1);
+	const usize msg_len = strnlen(msg, HAM_MESSAGE_BUFFER_SIZE - 1);
+
+	u64 tail;
+	const auto rec = ham_impl_async_log_reserve(logger, ring, api_len + msg_len + 2, &tail);
+	if(!rec) return false;
+
+	rec->level = (u32)level;
+	rec->api_len = (u32)api_len;
+	rec->msg_len = (u32)msg_len;
+	rec->tp = tp;
+
+	const auto rec_api = const_cast<char*>(rec->api());
+	memcpy(rec_api, api, api_len);
+	rec_api[api_len] = '\0';
+
+	const auto rec_msg = const_cast<char*>(rec->msg());
+	memcpy(rec_msg, msg, msg_len);
+	rec_msg[msg_len] = '\0';
+
+	ham_impl_async_log_commit(logger, ring, tail);
+	return true;
+}
+
+static inline usize ham_impl_log_structured_size(const ham_log_structured *record){
+	return sizeof(ham_log_structured) + (record->api_static ? 0 : record->api_len) + record->args_size;
+}
+
+/**
+ * Structured records in the ring carry their own copy of every string, the format string and api name
+ * may live in a plugin that is unloaded before the writer thread gets to them.
+ * Laid out as the header, api name, encoded arguments then format string; the header pointers are unused.
+ */
+struct ham_impl_async_log_structured_view{
+	const char *api, *args, *fmt;
+};
+
+static inline ham_impl_async_log_structured_view ham_impl_async_log_structured_view_of(const ham_log_structured *record){
+	const auto api = reinterpret_cast<const char*>(record + 1);
+	return { api, api + record->api_len, api + record->api_len + record->args_size };
+}
+
+static bool ham_impl_async_log_push_structured(
+	ham_async_logger *logger, ham_impl_async_log_ring *ring,
+	ham_timepoint tp, ham_log_level level, const ham_log_structured *record
+){
+	const char *const api = record->api_static ? record->api : reinterpret_cast<const char*>(record + 1);
+	const char *const args = reinterpret_cast<const char*>(record + 1) + (record->api_static ? 0 : record->api_len);
+
+	const usize record_size = sizeof(ham_log_structured) + record->api_len + record->args_size + record->fmt_len;
+
+	u64 tail;
+	const auto rec = ham_impl_async_log_reserve(logger, ring, record_size, &tail);
+	if(!rec) return false;
+
+	rec->level = (u32)level | ham_impl_async_log_structured_bit;
+	rec->api_len = 0;
+	rec->msg_len = (u32)record_size;
+	rec->tp = tp;
+
+	ham_log_structured header = *record;
+	header.fmt = nullptr;
+	header.api = nullptr;
+	header.api_static = false;
+
+	const auto dst = const_cast<ham_log_structured*>(rec->structured());
+	memcpy(dst, &header, sizeof(header));
+
+	const auto view = ham_impl_async_log_structured_view_of(dst);
+	memcpy(const_cast<char*>(view.api),  api,         record->api_len);
+	memcpy(const_cast<char*>(view.args), args,        record->args_size);
+	memcpy(const_cast<char*>(view.fmt),  record->fmt, record->fmt_len);
+
+	ham_impl_async_log_commit(logger, ring, tail);
+	return true;
+}
+
+//
+// Binary log output
+//
+
+constexpr char ham_impl_binary_log_magic[8] = { 'H', 'A', 'M', 'L', 'O', 'G', '\0', '\1' };
+constexpr usize ham_impl_binary_log_buf_size = 64 * 1024;
+
+enum ham_impl_binary_log_tag: u8{
+	HAM_IMPL_BINARY_LOG_STR = 1, //!< u64 id, u32 len, bytes
+	HAM_IMPL_BINARY_LOG_TEXT,    //!< i64 sec, i64 nsec, u32 level, u32 api_len, u32 msg_len, api bytes, msg bytes
+	HAM_IMPL_BINARY_LOG_EVENT,   //!< i64 sec, i64 nsec, u32 level, u64 fmt id, u64 api id (0 for u32 api_len and api bytes after the header), u32 num_args, u32 args_size, args
+};
+
+//! Strings are identified by content, `0` is reserved for an api name stored inline in the event.
+static inline u64 ham_impl_binary_log_str_id(const char *ptr, u32 len){
+	const u64 id = ham_hash_fast_64(ptr, len);
+	return id ? id : 1;
+}
+
+static bool ham_impl_binary_log_write(ham_file *file, const char *data, usize len){
+	while(len){
+		const usize res = ham_file_write(file, data, len);
+		if(res == (usize)-1 || res == 0) return false;
+
+		data += res;
+		len -= res;
+	}
+
+	return true;
+}
+
+//! Write out everything buffered, after a failed write the rest of the log is discarded.
+static void ham_impl_binary_log_flush(ham_async_logger *logger){
+	if(!logger->out_failed && !ham_impl_binary_log_write(logger->out_file, logger->out_buf, logger->out_len)){
+		logger->out_failed = true;
+	}
+
+	logger->out_len = 0;
+}
+
+static void ham_impl_binary_log_put(ham_async_logger *logger, const void *data, usize len){
+	if(logger->out_len + len > ham_impl_binary_log_buf_size){
+		ham_impl_binary_log_flush(logger);
+
+		if(len > ham_impl_binary_log_buf_size){
+			if(!logger->out_failed && !ham_impl_binary_log_write(logger->out_file, (const char*)data, len)){
+				logger->out_failed = true;
+			}
+
+			return;
+		}
+	}
+
+	memcpy(logger->out_buf + logger->out_len, data, len);
+	logger->out_len += len;
+}
+
+template<typename T>
+static inline void ham_impl_binary_log_put_val(ham_async_logger *logger, const T &val){
+	ham_impl_binary_log_put(logger, &val, sizeof(T));
+}
+
+static u64 ham_impl_binary_log_put_str(ham_async_logger *logger, const char *ptr, u32 len){
+	const u64 id = ham_impl_binary_log_str_id(ptr, len);
+
+	try{
+		if(!logger->out_strs.try_emplace(id, true).second) return id;
+	}
+	catch(const ham::flat_map_alloc_error&){
+		// writing the string again next time is harmless
+	}
+
+	ham_impl_binary_log_put_val(logger, (u8)HAM_IMPL_BINARY_LOG_STR);
+	ham_impl_binary_log_put_val(logger, id);
+	ham_impl_binary_log_put_val(logger, len);
+	ham_impl_binary_log_put(logger, ptr, len);
+	return id;
+}
+
+static inline void ham_impl_binary_log_put_time(ham_async_logger *logger, ham_timepoint tp, ham_log_level level){
+	ham_impl_binary_log_put_val(logger, (i64)tp.tv_sec);
+	ham_impl_binary_log_put_val(logger, (i64)tp.tv_nsec);
+	ham_impl_binary_log_put_val(logger, (u32)level);
+}
+
+//! Only called from the writer thread.
+static void ham_impl_async_log_emit(ham_async_logger *logger, ham_timepoint tp, ham_log_level level, const char *api, const char *msg){
+	if(!logger->out_file){
+		logger->sink->log(tp, level, api, msg, logger->sink->user);
+		return;
+	}
+
+	const u32 api_len = (u32)strlen(api);
+	const u32 msg_len = (u32)strlen(msg);
+
+	ham_impl_binary_log_put_val(logger, (u8)HAM_IMPL_BINARY_LOG_TEXT);
+	ham_impl_binary_log_put_time(logger, tp, level);
+	ham_impl_binary_log_put_val(logger, api_len);
+	ham_impl_binary_log_put_val(logger, msg_len);
+	ham_impl_binary_log_put(logger, api, api_len);
+	ham_impl_binary_log_put(logger, msg, msg_len);
+}
+
+//! Only called from the writer thread.
+static void ham_impl_async_log_emit_structured(ham_async_logger *logger, ham_timepoint tp, ham_log_level level, const ham_log_structured *record){
+	const auto view = ham_impl_async_log_structured_view_of(record);
+
+	if(!logger->out_file){
+		char api_buf[HAM_MESSAGE_BUFFER_SIZE];
+		const usize api_len = record->api_len < sizeof(api_buf) - 1 ? record->api_len : sizeof(api_buf) - 1;
+		memcpy(api_buf, view.api, api_len);
+		api_buf[api_len] = '\0';
+
+		char msg_buf[HAM_MESSAGE_BUFFER_SIZE];
+		ham_log_format_structured(ham_str8{ view.fmt, record->fmt_len }, record->num_args, record->args_size, view.args, sizeof(msg_buf), msg_buf);
+
+		logger->sink->log(tp, level, api_buf, msg_buf, logger->sink->user);
+		return;
+	}
+
+	// api names are deduplicated by content too, so function names logged from different places share one string
+	const u64 fmt_id = ham_impl_binary_log_put_str(logger, view.fmt, record->fmt_len);
+	const u64 api_id = ham_impl_binary_log_put_str(logger, view.api, record->api_len);
+
+	ham_impl_binary_log_put_val(logger, (u8)HAM_IMPL_BINARY_LOG_EVENT);
+	ham_impl_binary_log_put_time(logger, tp, level);
+	ham_impl_binary_log_put_val(logger, fmt_id);
+	ham_impl_binary_log_put_val(logger, api_id);
+	ham_impl_binary_log_put_val(logger, record->num_args);
+	ham_impl_binary_log_put_val(logger, record->args_size);
+	ham_impl_binary_log_put(logger, view.args, record->args_size);
+}
+
+//! Only called from the writer thread. Returns the number of records written.
+static usize ham_impl_async_log_drain(ham_async_logger *logger){
+	const usize mask = logger->ring_size - 1;
+
+	usize num_written = 0;
+
+	for(u32 i = 0; i < logger->num_rings; i++){
+		const auto ring = logger->rings + i;
+
+		const auto buf = ring->buf.load(std::memory_order_acquire);
+		if(!buf) continue;
+
+		u64 head = ring->head.load(std::memory_order_relaxed);
+		const u64 tail = ring->tail.load(std::memory_order_acquire);
+
+		while(head != tail){
+			const auto rec = (const ham_impl_async_log_record*)(buf + (head & mask));
+
+			if(rec->level == ham_impl_async_log_skip){}
+			else if(rec->level & ham_impl_async_log_structured_bit){
+				ham_impl_async_log_emit_structured(logger, rec->tp, (ham_log_level)(rec->level & ~ham_impl_async_log_structured_bit), rec->structured());
+				++num_written;
+			}
+			else{
+				ham_impl_async_log_emit(logger, rec->tp, (ham_log_level)rec->level, rec->api(), rec->msg());
+				++num_written;
+			}
+
+			head += rec->size;
+
+			// hand the space back straight away so producers stall on a full ring as briefly as possible
+			ring->head.store(head, std::memory_order_release);
+		}
+	}
+
+	u64 dropped = logger->unclaimed_drops.exchange(0, std::memory_order_relaxed);
+
+	for(u32 i = 0; i < logger->num_rings; i++){
+		dropped += logger->rings[i].dropped.exchange(0, std::memory_order_relaxed);
+	}
+
+	if(dropped){
+		logger->num_dropped.fetch_add(dropped, std::memory_order_relaxed);
+
+		ham_timepoint tp = (ham_timepoint){ 0, 0 };
+		ham_timepoint_now(&tp, CLOCK_REALTIME);
+
+		char msg[64];
+		snprintf(msg, sizeof(msg), "Dropped %llu log messages", (unsigned long long)dropped);
+
+		ham_impl_async_log_emit(logger, tp, HAM_LOG_WARNING, "ham_async_logger", msg);
+	}
+
+	return num_written;
+}
+
+static inline bool ham_impl_async_log_pending(const ham_async_logger *logger){
+	for(u32 i = 0; i < logger->num_rings; i++){
+		const auto ring = logger->rings + i;
+		if(ring->head.load(std::memory_order_relaxed) != ring->tail.load(std::memory_order_relaxed)) return true;
+	}
+
+	return false;
+}
+
+static ham_uptr ham_impl_async_log_writer(void *user){
+	const auto logger = (ham_async_logger*)user;
+
+	// anything the writer logs itself goes straight to the sink
+	ham_set_logger(logger->sink);
+
+	while(true){
+		const bool stopping = logger->stopping.load(std::memory_order_acquire);
+		const u64 flush_req = logger->flush_req.load(std::memory_order_acquire);
+
+		const usize num_written = ham_impl_async_log_drain(logger);
+
+		// write out before sleeping or answering a flush so nothing is left sitting in the buffer
+		if(logger->out_file && logger->out_len && (!num_written || flush_req != logger->flush_done)){
+			ham_impl_binary_log_flush(logger);
+		}
+
+		if(flush_req){
+			ham::scoped_lock lock(&logger->flush_mut);
+			if(logger->flush_done != flush_req){
+				logger->flush_done = flush_req;
+				ham_cond_broadcast(&logger->flush_cond);
+			}
+		}
+
+		if(num_written) continue;
+		else if(stopping) break;
+
+		logger->writer_asleep.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if(
+			ham_impl_async_log_pending(logger) ||
+			logger->flush_req.load(std::memory_order_relaxed) != flush_req ||
+			logger->stopping.load(std::memory_order_relaxed)
+		){
+			if(logger->writer_asleep.exchange(false, std::memory_order_acq_rel)) continue;
+		}
+
+		ham_sem_wait(&logger->wake_sem);
+		logger->writer_asleep.store(false, std::memory_order_relaxed);
+	}
+
+	return 0;
+}
+
+static ham_usize ham_impl_async_log_fn(ham_timepoint tp, ham_log_level level, const char *api, const char *msg, void *user){
+	const auto logger = (ham_async_logger*)user;
+
+	if(!api) api = "";
+	if(!msg) msg = "";
+
+	const auto ring = ham_impl_async_log_claim(logger);
+
+	bool pushed = false;
+
+	if(ring){
+		pushed = ham_impl_async_log_push(logger, ring, tp, level, api, msg);
+
+		if(!pushed && level == HAM_LOG_FATAL){
+			ham_async_logger_flush(logger);
+			pushed = ham_impl_async_log_push(logger, ring, tp, level, api, msg);
+		}
+	}
+	else{
+		logger->unclaimed_drops.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if(level == HAM_LOG_FATAL){
+		if(pushed){
+			ham_async_logger_flush(logger);
+		}
+		else{
+			// the process is probably about to go down, so get this out at any cost
+			ham_async_logger_flush(logger);
+			return logger->sink->log(tp, level, api, msg, logger->sink->user);
+		}
+	}
+
+	return pushed ? strlen(msg) : 0;
+}
+
+static ham_usize ham_impl_async_log_structured_fn(ham_timepoint tp, ham_log_level level, const ham_log_structured *record, void *user){
+	const auto logger = (ham_async_logger*)user;
+
+	const auto ring = ham_impl_async_log_claim(logger);
+
+	bool pushed = false;
+
+	if(ring){
+		pushed = ham_impl_async_log_push_structured(logger, ring, tp, level, record);
+
+		if(!pushed && level == HAM_LOG_FATAL){
+			ham_async_logger_flush(logger);
+			pushed = ham_impl_async_log_push_structured(logger, ring, tp, level, record);
+		}
+	}
+	else{
+		logger->unclaimed_drops.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if(level == HAM_LOG_FATAL){
+		ham_async_logger_flush(logger);
+
+		if(!pushed){
+			char api_buf[HAM_MESSAGE_BUFFER_SIZE];
+			const char *const api = record->api_static ? record->api : reinterpret_cast<const char*>(record + 1);
+			const usize api_len = record->api_len < sizeof(api_buf) - 1 ? record->api_len : sizeof(api_buf) - 1;
+			memcpy(api_buf, api, api_len);
+			api_buf[api_len] = '\0';
+
+			char msg_buf[HAM_MESSAGE_BUFFER_SIZE];
+			const char *const args = reinterpret_cast<const char*>(record + 1) + (record->api_static ? 0 : record->api_len);
+			ham_log_format_structured(ham_str8{ record->fmt, record->fmt_len }, record->num_args, record->args_size, args, sizeof(msg_buf), msg_buf);
+
+			return logger->sink->log(tp, level, api_buf, msg_buf, logger->sink->user);
+		}
+	}
+
+	return pushed ? ham_impl_log_structured_size(record) : 0;
+}
+
+//! Takes ownership of `out_file`, closing it on error.
+static ham_async_logger *ham_impl_async_logger_create(const ham_logger *sink, ham_usize ring_size, ham_u32 max_threads, ham_file *out_file){
+	if(ring_size < ham_impl_async_log_min_ring_size){
+		ring_size = ham_impl_async_log_min_ring_size;
+	}
+
+	// round up to a power of 2 so ring offsets are a mask away
+	ring_size = usize(1) << (64 - __builtin_clzll(ring_size - 1));
+
+	const auto allocator = ham_current_allocator();
+
+	const auto logger = ham_allocator_new(allocator, ham_async_logger);
+	if(!logger){
+		ham::logapierror("Error allocating ham_async_logger");
+		if(out_file) ham_file_close(out_file);
+		return nullptr;
+	}
+
+	logger->allocator = allocator;
+	logger->iface = (ham_logger){ .log = ham_impl_async_log_fn, .user = logger, .log_structured = ham_impl_async_log_structured_fn };
+	logger->sink = sink;
+	logger->ring_size = ring_size;
+	logger->num_rings = max_threads;
+
+	logger->rings = (ham_impl_async_log_ring*)ham_allocator_alloc(allocator, alignof(ham_impl_async_log_ring), sizeof(ham_impl_async_log_ring) * max_threads);
+	if(!logger->rings){
+		ham::logapierror("Error allocating {} log rings", max_threads);
+		ham_allocator_delete(allocator, logger);
+		if(out_file) ham_file_close(out_file);
+		return nullptr;
+	}
+
+	for(u32 i = 0; i < max_threads; i++){
+		new(logger->rings + i) ham_impl_async_log_ring;
+	}
+
+	if(!ham_sem_init(&logger->wake_sem, 0)){
+		ham::logapierror("Error in ham_sem_init");
+		ham_allocator_free(allocator, logger->rings);
+		ham_allocator_delete(allocator, logger);
+		if(out_file) ham_file_close(out_file);
+		return nullptr;
+	}
+
+	if(!ham_mutex_init(&logger->flush_mut, HAM_MUTEX_NORMAL)){
+		ham::logapierror("Error in ham_mutex_init");
+		ham_sem_finish(&logger->wake_sem);
+		ham_allocator_free(allocator, logger->rings);
+		ham_allocator_delete(allocator, logger);
+		if(out_file) ham_file_close(out_file);
+		return nullptr;
+	}
+
+	if(!ham_cond_init(&logger->flush_cond)){
+		ham::logapierror("Error in ham_cond_init");
+		ham_mutex_finish(&logger->flush_mut);
+		ham_sem_finish(&logger->wake_sem);
+		ham_allocator_free(allocator, logger->rings);
+		ham_allocator_delete(allocator, logger);
+		if(out_file) ham_file_close(out_file);
+		return nullptr;
+	}
+
+	logger->writer = nullptr;
+
+	if(out_file){
+		// from here on destroying the logger closes the file
+		logger->out_file = out_file;
+
+		logger->out_buf = (char*)ham_allocator_alloc(allocator, alignof(u64), ham_impl_binary_log_buf_size);
+		if(!logger->out_buf){
+			ham::logapierror("Error allocating binary log buffer");
+			ham_async_logger_destroy(logger);
+			return nullptr;
+		}
+
+		memcpy(logger->out_buf, ham_impl_binary_log_magic, sizeof(ham_impl_binary_log_magic));
+		logger->out_len = sizeof(ham_impl_binary_log_magic);
+	}
+
+	bool registered = false;
+
+	{
+		auto &reg = ham_impl_async_log_registry_get();
+
+		ham::scoped_lock lock(reg.mut);
+
+		if(reg.num_live < std::size(reg.live)){
+			logger->id = reg.next_id++;
+			reg.live[reg.num_live++] = logger;
+			registered = true;
+		}
+	}
+
+	if(!registered){
+		ham::logapierror("Too many async loggers, max {}", std::size(ham_impl_async_log_registry_get().live));
+		ham_async_logger_destroy(logger);
+		return nullptr;
+	}
+
+	logger->writer = ham_thread_create(ham_impl_async_log_writer, logger);
+	if(!logger->writer){
+		ham::logapierror("Error in ham_thread_create");
+		ham_async_logger_destroy(logger);
+		return nullptr;
+	}
+
+	ham_thread_set_name(logger->writer, HAM_LIT_UTF8("ham-log"));
+
+	return logger;
+}
+
+HAM_C_API_BEGIN
+
+ham_async_logger *ham_async_logger_create(const ham_logger *sink, ham_usize ring_size, ham_u32 max_threads){
+	if(!sink) sink = ham_impl_default_logger;
+
+	if(!ham_check(sink->log != NULL) || !ham_check(max_threads > 0)){
+		return nullptr;
+	}
+
+	return ham_impl_async_logger_create(sink, ring_size, max_threads, nullptr);
+}
+
+ham_async_logger *ham_async_logger_create_binary(ham_str8 path, ham_usize ring_size, ham_u32 max_threads){
+	if(!ham_check(path.ptr && path.len) || !ham_check(max_threads > 0)){
+		return nullptr;
+	}
+
+	const auto out_file = ham_file_open_utf8(path, HAM_OPEN_WRITE | HAM_OPEN_CREATE);
+	if(!out_file){
+		ham::logapierror("Error opening binary log '{}'", path);
+		return nullptr;
+	}
+
+	return ham_impl_async_logger_create(ham_impl_default_logger, ring_size, max_threads, out_file);
+}
+
+void ham_async_logger_destroy(ham_async_logger *logger){
+	if(!logger) return;
+
+	{
+		auto &reg = ham_impl_async_log_registry_get();
+
+		ham::scoped_lock lock(reg.mut);
+
+		for(usize i = 0; i < reg.num_live; i++){
+			if(reg.live[i] == logger){
+				reg.live[i] = reg.live[--reg.num_live];
+				break;
+			}
+		}
+	}
+
+	if(logger->writer){
+		logger->stopping.store(true, std::memory_order_release);
+		ham_sem_post(&logger->wake_sem);
+
+		ham_thread_join(logger->writer, nullptr);
+		ham_thread_destroy(logger->writer);
+	}
+
+	const auto allocator = logger->allocator;
+
+	if(logger->out_file){
+		if(logger->out_buf){
+			ham_impl_binary_log_flush(logger);
+			ham_allocator_free(allocator, logger->out_buf);
+		}
+
+		ham_file_close(logger->out_file);
+	}
+
+	for(u32 i = 0; i < logger->num_rings; i++){
+		const auto buf = logger->rings[i].buf.load(std::memory_order_relaxed);
+		if(buf) ham_allocator_free(allocator, buf);
+
+		std::destroy_at(logger->rings + i);
+	}
+
+	ham_allocator_free(allocator, logger->rings);
+
+	ham_cond_finish(&logger->flush_cond);
+	ham_mutex_finish(&logger->flush_mut);
+	ham_sem_finish(&logger->wake_sem);
+
+	ham_allocator_delete(allocator, logger);
+}
+
+const ham_logger *ham_async_logger_get(const ham_async_logger *logger){
+	if(!ham_check(logger != NULL)) return nullptr;
+	return &logger->iface;
+}
+
+bool ham_async_logger_flush(ham_async_logger *logger){
+	if(!ham_check(logger != NULL)) return false;
+
+	const u64 ticket = logger->flush_req.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(logger->writer_asleep.exchange(false, std::memory_order_acq_rel)){
+		ham_sem_post(&logger->wake_sem);
+	}
+
+	ham::scoped_lock lock(&logger->flush_mut);
+
+	while(logger->flush_done < ticket){
+		if(!ham_cond_wait(&logger->flush_cond, &logger->flush_mut)) return false;
+	}
+
+	return true;
+}
+
+bool ham_async_logger_flush_all(){
+	auto &reg = ham_impl_async_log_registry_get();
+
+	// held throughout so none of them can be destroyed mid-flush
+	ham::scoped_lock lock(reg.mut);
+
+	bool result = true;
+
+	for(usize i = 0; i < reg.num_live; i++){
+		if(!ham_async_logger_flush(reg.live[i])) result = false;
+	}
+
+	return result;
+}
+
+ham_usize ham_async_logger_num_dropped(const ham_async_logger *logger){
+	if(!ham_check(logger != NULL)) return 0;
+	return logger->num_dropped.load(std::memory_order_relaxed);
+}
+
+ham_usize ham_log_decode_file(ham_str8 path, const ham_logger *out){
+	if(!ham_check(path.ptr && path.len)) return (usize)-1;
+
+	if(!out) out = ham_impl_default_logger;
+
+	const auto file = ham_file_open_utf8(path, HAM_OPEN_READ);
+	if(!file){
+		ham::logapierror("Error opening binary log '{}'", path);
+		return (usize)-1;
+	}
+
+	ham::std_vector<char> contents;
+
+	constexpr usize chunk_size = 64 * 1024;
+
+	while(true){
+		const usize prev_size = contents.size();
+		contents.resize(prev_size + chunk_size);
+
+		const usize res = ham_file_read(file, contents.data() + prev_size, chunk_size);
+		if(res == (usize)-1){
+			ham::logapierror("Error reading binary log '{}'", path);
+			ham_file_close(file);
+			return (usize)-1;
+		}
+
+		contents.resize(prev_size + res);
+		if(res == 0) break;
+	}
+
+	ham_file_close(file);
+
+	const char *const data = contents.data();
+	const usize size = contents.size();
+	usize off = 0;
+
+	const auto read = [&](void *dst, usize len){
+		if(len > size - off) return false;
+		memcpy(dst, data + off, len);
+		off += len;
+		return true;
+	};
+
+	const auto read_str = [&](u32 len, ham::str8 *ret){
+		if(len > size - off) return false;
+		*ret = ham::str8(data + off, len);
+		off += len;
+		return true;
+	};
+
+	usize num_decoded = (usize)-1;
+
+	char magic[sizeof(ham_impl_binary_log_magic)];
+	if(!read(magic, sizeof(magic)) || memcmp(magic, ham_impl_binary_log_magic, sizeof(magic)) != 0){
+		ham::logapierror("Not a binary log or unsupported version: '{}'", path);
+	}
+	else{
+		ham::flat_map<u64, ham::str8> strs;
+
+		char api_buf[HAM_MESSAGE_BUFFER_SIZE];
+		char msg_buf[HAM_MESSAGE_BUFFER_SIZE];
+
+		const auto copy_str = [](ham::str8 str, char *buf, usize buf_len){
+			const usize len = str.len() < buf_len - 1 ? str.len() : buf_len - 1;
+			memcpy(buf, str.ptr(), len);
+			buf[len] = '\0';
+		};
+
+		usize num_records = 0;
+		bool ok = true;
+
+		while(ok && off < size){
+			u8 tag;
+			read(&tag, 1);
+
+			if(tag == HAM_IMPL_BINARY_LOG_STR){
+				u64 id;
+				u32 len;
+				ham::str8 str;
+				ok = read(&id, sizeof(id)) && read(&len, sizeof(len)) && read_str(len, &str);
+
+				if(ok){
+					try{
+						strs.insert_or_assign(id, str);
+					}
+					catch(const ham::flat_map_alloc_error&){
+						ham::logapierror("Error allocating string table");
+						ok = false;
+					}
+				}
+
+				continue;
+			}
+
+			i64 sec, nsec;
+			u32 level;
+			ok = read(&sec, sizeof(sec)) && read(&nsec, sizeof(nsec)) && read(&level, sizeof(level)) && level < HAM_LOG_LEVEL_COUNT;
+			if(!ok) break;
+
+			const ham_timepoint tp{ .tv_sec = (time_t)sec, .tv_nsec = (long)nsec };
+
+			if(tag == HAM_IMPL_BINARY_LOG_TEXT){
+				u32 api_len, msg_len;
+				ham::str8 api, msg;
+				ok = read(&api_len, sizeof(api_len)) && read(&msg_len, sizeof(msg_len)) && read_str(api_len, &api) && read_str(msg_len, &msg);
+				if(!ok) break;
+
+				copy_str(api, api_buf, sizeof(api_buf));
+				copy_str(msg, msg_buf, sizeof(msg_buf));
+			}
+			else if(tag == HAM_IMPL_BINARY_LOG_EVENT){
+				u64 fmt_id, api_id;
+				u32 num_args, args_size;
+				ok = read(&fmt_id, sizeof(fmt_id)) && read(&api_id, sizeof(api_id)) && read(&num_args, sizeof(num_args)) && read(&args_size, sizeof(args_size));
+				if(!ok) break;
+
+				ham::str8 api;
+
+				if(api_id){
+					const auto api_ptr = strs.get(api_id);
+					ok = api_ptr != nullptr;
+					if(ok) api = *api_ptr;
+				}
+				else{
+					u32 api_len;
+					ok = read(&api_len, sizeof(api_len)) && read_str(api_len, &api);
+				}
+
+				const auto fmt_ptr = strs.get(fmt_id);
+
+				ham::str8 args;
+				ok = ok && fmt_ptr && read_str(args_size, &args);
+				if(!ok) break;
+
+				copy_str(api, api_buf, sizeof(api_buf));
+
+				if(ham_log_format_structured(*fmt_ptr, num_args, args_size, args.ptr(), sizeof(msg_buf), msg_buf) == (usize)-1){
+					ok = false;
+					break;
+				}
+			}
+			else{
+				ok = false;
+				break;
+			}
+
+			out->log(tp, (ham_log_level)level, api_buf, msg_buf, out->user);
+			++num_records;
+		}
+
+		if(ok){
+			num_decoded = num_records;
+		}
+		else{
+			ham::logapierror("Malformed record at offset {} in binary log '{}'", off, path);
+		}
+	}
+
+	return num_decoded;
+}
+
 HAM_C_API_END
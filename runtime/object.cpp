@@ -116,6 +116,68 @@ ham_usize ham_object_manager_iterate(ham_object_manager *manager, ham_object_man
 	}
 }
 
+const ham_object_vtable *ham_object_manager_vtable(const ham_object_manager *manager){
+	if(!ham_check(manager != NULL)) return nullptr;
+	return manager->obj_vtable;
+}
+
+bool ham_object_manager_set_vtable(ham_object_manager *manager, const ham_object_vtable *vtable, ham_object_migrate_fn migrate, void *user){
+	if(!ham_check(manager != NULL) || !ham_check(vtable != NULL)){
+		return false;
+	}
+
+	const auto old_info = manager->obj_info;
+	const auto new_info = vtable->info;
+
+	if(strcmp(old_info->type_id, new_info->type_id) != 0){
+		ham_logapierrorf("Object type mismatch: %s replaced by %s", old_info->type_id, new_info->type_id);
+		return false;
+	}
+	else if(old_info->size != new_info->size || old_info->alignment != new_info->alignment){
+		ham_logapierrorf(
+			"Layout of object %s changed from %zu (align %zu) to %zu (align %zu)",
+			old_info->type_id,
+			old_info->size, old_info->alignment,
+			new_info->size, new_info->alignment
+		);
+		return false;
+	}
+
+	struct swap_data{
+		const ham_object_vtable *old_vtable, *new_vtable;
+		ham_object_migrate_fn migrate;
+		void *user;
+		bool result;
+	} data{ manager->obj_vtable, vtable, migrate, user, true };
+
+	// every object is switched over even if one fails to migrate, they must all agree with the manager
+	ham_colony_iterate(
+		manager->instances,
+		[](void *mem, void *user) -> bool{
+			const auto obj  = (ham_object*)mem;
+			const auto data = (swap_data*)user;
+
+			obj->vptr = data->new_vtable;
+
+			if(data->migrate && !data->migrate(obj, data->old_vtable, data->user)){
+				data->result = false;
+			}
+
+			return true;
+		},
+		&data
+	);
+
+	manager->obj_vtable = vtable;
+	manager->obj_info = new_info;
+
+	if(!data.result){
+		ham_logapiwarnf("Some objects of type %s failed to migrate", new_info->type_id);
+	}
+
+	return data.result;
+}
+
 bool ham_object_manager_contains(const ham_object_manager *manager, const ham_object *obj){
 	if(!ham_check(manager != NULL) || !obj){
 		return false;
@@ -159,6 +221,40 @@ ham_api ham_object *ham_object_vnew_init(
 	return ret;
 }
 
+ham_usize ham_object_new_uninit_n(
+	ham_object_manager *manager, ham_usize n,
+	ham_object_manager_iterate_fn init_fn, void *user,
+	ham_object **ret
+){
+	if(!ham_check(manager != NULL) || !ham_check(n == 0 || ret != NULL)) return 0;
+
+	if(!ham_colony_emplace_n(manager->instances, n, (void**)ret)){
+		ham_logapierrorf("Failed to emplace %zu new objects in storage", n);
+		return 0;
+	}
+
+	const auto vtable = manager->obj_vtable;
+
+	for(ham_usize i = 0; i < n; i++){
+		const auto mem = ret[i];
+
+		memset(mem, 0, manager->obj_info->size);
+		mem->vptr = vtable;
+
+		if(init_fn && !init_fn(mem, user)){
+			ham_logapierrorf("Failed to initialize object memory");
+
+			for(ham_usize j = i; j < n; j++){
+				ham_colony_erase(manager->instances, ret[j]);
+			}
+
+			return i;
+		}
+	}
+
+	return n;
+}
+
 bool ham_object_delete(ham_object_manager *manager, ham_object *obj){
 	if(!ham_check(manager != NULL) || !ham_check(obj != NULL)){
 		return false;
@@ -19,10 +19,11 @@
 #include "ham/parse.h"
 #include "ham/hash.h" // IWYU pragma: keep
 #include "ham/str_buffer.h"
+#include "ham/intern.h"
 
 #include "ham/std_vector.hpp"
-
-#include "robin_hood.h"
+#include "ham/flat_map.hpp"
+#include "ham/colony.h"
 
 #include <stdarg.h>
 #include <uchar.h>
@@ -36,6 +37,10 @@ namespace ham{
 		// Scope implementation
 		//
 
+		// utf-8 names are interned so scope lookups compare symbols, other encodings are keyed on the string
+		template<typename Char>
+		using parse_scope_key_t = std::conditional_t<std::is_same_v<Char, char8>, ham_symbol, basic_str<Char>>;
+
 		template<typename Char>
 		static inline parse_scope_ctype_t<Char> *impl_parse_scope_create(parse_context_ctype_t<Char> *ctx, parse_scope_ctype_t<Char> *parent){
 			if(!ctx) return nullptr;
@@ -108,9 +113,24 @@ namespace ham{
 		static inline const expr_binding_ctype_t<Char> *impl_parse_scope_resolve(const parse_scope_ctype_t<Char> *scope, str_ctype_t<Char> name){
 			if(!scope || !name.ptr || !name.len) return nullptr;
 
-			const auto ret_vec = scope->bindings.find(name);
-			if(ret_vec != scope->bindings.end()) return ret_vec->second.back();
-			else return scope->parent ? impl_parse_scope_resolve<Char>(scope->parent, name) : nullptr;
+			parse_scope_key_t<Char> key;
+
+			if constexpr(std::is_same_v<Char, char8>){
+				key = ham_intern_find(name);
+
+				// never interned, so never bound in any scope
+				if(key == HAM_SYMBOL_NULL) return nullptr;
+			}
+			else{
+				key = name;
+			}
+
+			for(; scope; scope = scope->parent){
+				const auto ret_vec = scope->bindings.get(key);
+				if(ret_vec) return ret_vec->back();
+			}
+
+			return nullptr;
 		}
 
 		template<typename Char>
@@ -119,7 +139,17 @@ namespace ham{
 				return false;
 			}
 
-			auto &binding_vec = scope->bindings[binding->name];
+			parse_scope_key_t<Char> key;
+
+			if constexpr(std::is_same_v<Char, char8>){
+				key = ham_intern(binding->name);
+				if(key == HAM_SYMBOL_NULL) return false;
+			}
+			else{
+				key = binding->name;
+			}
+
+			auto &binding_vec = scope->bindings[key];
 			binding_vec.emplace_back(binding);
 			return true;
 		}
@@ -142,7 +172,6 @@ namespace ham{
 			}
 
 			ptr->exprs = std_vector<expr_base_ctype_t<Char>*>(ctx_allocator);
-			ptr->error_messages = std_vector<str_buffer8>(ctx_allocator);
 			ptr->root_scope.ctx = ptr;
 
 			return ptr;
@@ -282,14 +311,16 @@ namespace ham{
 			auto new_err = ctx.template new_expr<expr_kind::error>(tokens);
 			if(!new_err) return nullptr;
 
-			new_err.set_message(msg_buf.get());
+			// short messages live inside the buffer object, so it has to stay put for the view to stay valid
+			const auto stored_msg = ctx.handle()->error_messages.emplace(std::move(msg_buf));
+			if(!stored_msg) return nullptr;
+
+			new_err.set_message(stored_msg->get());
 			if(!new_err.message().ptr() || !new_err.message().len()){
 				fprintf(stderr, "! INTERNAL ERROR ! could not create new error message\n");
 				return nullptr;
 			}
 
-			ctx.handle()->error_messages.emplace_back(std::move(msg_buf));
-
 			return new_err;
 		}
 
@@ -714,7 +745,7 @@ namespace ham::detail{
 		parse_context_ctype_t<Char> *ctx = nullptr;
 		parse_scope_ctype_t<Char> *parent = nullptr;
 		str_type indent;
-		robin_hood::unordered_flat_map<str_type, ham::std_vector<const expr_binding_ctype_t<Char>*>> bindings;
+		ham::flat_map<parse_scope_key_t<Char>, ham::std_vector<const expr_binding_ctype_t<Char>*>> bindings;
 	};
 
 	//
@@ -722,7 +753,7 @@ namespace ham::detail{
 	struct parse_context_data_utf{
 		ham::std_vector<expr_base_ctype_t<Char>*> exprs; // use allocator from here
 		ham::std_vector<const expr_base_ctype_t<Char>*> root_exprs; // use allocator from here
-		ham::std_vector<ham::str_buffer8> error_messages; // parsing errors are always utf-8
+		ham::colony<ham::str_buffer8> error_messages; // parsing errors are always utf-8
 		parse_scope_ctype_t<Char> root_scope;
 	};
 }
@@ -21,24 +21,301 @@
 #include "ham/check.h"
 #include "ham/fs.h"
 #include "ham/std_vector.hpp"
+#include "ham/str_buffer.h"
 
 #include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <mutex>
 
 using namespace ham::typedefs;
 
 HAM_C_API_BEGIN
 
+struct ham_impl_plugin_manager{
+	ham_object_manager *manager;
+	ham_object_migrate_fn migrate;
+	void *user;
+};
+
 struct ham_plugin{
 	const ham_allocator *allocator = nullptr;
-	ham_path_buffer_utf8 dir_path = { 0 };
+	ham_path_buffer_utf8 dso_path = { 0 }, dir_path = { 0 };
+	ham_dso_handle dso = nullptr;
 	const ham_plugin_vtable *plugin_vtable = nullptr;
-	ham::std_vector<const ham_object_vtable*> object_vtables;
 	std::mutex mut;
 	bool init_flag = false;
+
+	// what the DSO on disk looked like when it was loaded, for spotting rebuilds
+	i64 dso_mtime_ns = 0;
+	u64 dso_size = 0;
+
+	// managers holding objects made from this plugin's vtables, updated on reload
+	ham::std_vector<ham_impl_plugin_manager> managers;
+
+	// object vtables are resolved as they're asked for, so these are filled in lazily
+	mutable std::mutex objects_mut;
+	mutable ham::std_vector<const ham_object_vtable*> object_vtables;
+	ham::std_vector<ham::str_buffer8> object_symbols; //!< Known from a manifest, otherwise found by scanning
+	bool object_symbols_known = false;
+	mutable bool objects_complete = false;
+};
+
+//
+// Manifest cache
+//
+// Scanning a plugin directory opens every DSO in it and walks each symbol table, which is most of
+// the time spent starting up. What a scan finds is kept in a cache file in the directory, keyed by
+// file name, modification time and size, so a later search can open only the plugin it wants and
+// look its vtables up by name. Anything stale or missing falls back to scanning.
+//
+// The cache is a text file of one record per line:
+//
+//   ham-plugin-cache <version>
+//   dso <mtime ns> <size> <file name>
+//   plugin <name> <vtable symbol>
+//   object <vtable symbol>
+//
+// where plugin and object lines belong to the dso line before them. File and plugin names may
+// contain spaces, so they take the rest of the line around the fields that can't.
+//
+
+#define HAM_IMPL_PLUGIN_CACHE_NAME ".ham-plugin-cache"
+#define HAM_IMPL_PLUGIN_CACHE_MAGIC "ham-plugin-cache"
+
+constexpr u32 ham_impl_plugin_cache_version = 2;
+
+struct ham_impl_plugin_manifest_plugin{
+	ham::str_buffer8 name, symbol;
 };
 
+struct ham_impl_plugin_manifest{
+	ham::str_buffer8 file_name;
+	i64 mtime_ns = 0;
+	u64 size = 0;
+	ham::std_vector<ham_impl_plugin_manifest_plugin> plugins;
+	ham::std_vector<ham::str_buffer8> object_symbols;
+	bool seen = false;
+};
+
+using ham_impl_plugin_cache = ham::std_vector<ham_impl_plugin_manifest>;
+
+static inline bool ham_impl_plugin_file_stamp(const char *path, i64 *mtime_ret, u64 *size_ret){
+	struct stat stat_buf;
+	if(stat(path, &stat_buf) != 0) return false;
+
+#ifdef __APPLE__
+	*mtime_ret = (i64)stat_buf.st_mtimespec.tv_sec * 1000000000 + stat_buf.st_mtimespec.tv_nsec;
+#else
+	*mtime_ret = (i64)stat_buf.st_mtim.tv_sec * 1000000000 + stat_buf.st_mtim.tv_nsec;
+#endif
+
+	*size_ret = (u64)stat_buf.st_size;
+	return true;
+}
+
+static inline ham::str8 ham_impl_plugin_cache_next_word(ham::str8 &line){
+	const usize end = line.find(" ");
+	const auto word = line.substr(0, end);
+	line = end == ham::str8::npos ? ham::str8() : line.substr(end + 1);
+	return word;
+}
+
+static inline ham::str8 ham_impl_plugin_cache_last_word(ham::str8 &line){
+	const usize begin = line.rfind(" ");
+	if(begin == ham::str8::npos){
+		const auto word = line;
+		line = ham::str8();
+		return word;
+	}
+
+	const auto word = line.substr(begin + 1);
+	line = line.substr(0, begin);
+	return word;
+}
+
+//! A missing or unreadable cache is the same as an empty one.
+static void ham_impl_plugin_cache_load(const char *dir, ham_impl_plugin_cache &ret){
+	ham_path_buffer_utf8 cache_path;
+	const int path_len = snprintf(cache_path, sizeof(cache_path), "%s/" HAM_IMPL_PLUGIN_CACHE_NAME, dir);
+	if(path_len < 0 || (usize)path_len >= sizeof(cache_path)) return;
+
+	FILE *const file = fopen(cache_path, "r");
+	if(!file) return;
+
+	ham_impl_plugin_cache cache;
+	bool valid = false;
+
+	char line_buf[HAM_PATH_BUFFER_SIZE + 64];
+
+	while(fgets(line_buf, sizeof(line_buf), file)){
+		ham::str8 line = (const char*)line_buf;
+		if(line.len() && line[line.len() - 1] == '\n') line = line.substr(0, line.len() - 1);
+
+		const auto kind = ham_impl_plugin_cache_next_word(line);
+
+		if(!valid){
+			valid = kind == ham::str8(HAM_IMPL_PLUGIN_CACHE_MAGIC) && strtoul(line.ptr(), nullptr, 10) == ham_impl_plugin_cache_version;
+			if(!valid) break;
+		}
+		else if(kind == ham::str8("dso")){
+			ham_impl_plugin_manifest manifest;
+
+			const auto mtime_str = ham_impl_plugin_cache_next_word(line);
+			const auto size_str = ham_impl_plugin_cache_next_word(line);
+
+			manifest.mtime_ns = strtoll(ham::str_buffer8(mtime_str).c_str(), nullptr, 10);
+			manifest.size = strtoull(ham::str_buffer8(size_str).c_str(), nullptr, 10);
+			manifest.file_name = line;
+
+			if(manifest.file_name.empty()){
+				valid = false;
+				break;
+			}
+
+			cache.emplace_back(std::move(manifest));
+		}
+		else if(kind == ham::str8("plugin") && !cache.empty()){
+			const auto symbol = ham_impl_plugin_cache_last_word(line);
+			if(line.is_empty() || symbol.is_empty()){
+				valid = false;
+				break;
+			}
+
+			cache.back().plugins.push_back({ ham::str_buffer8(line), ham::str_buffer8(symbol) });
+		}
+		else if(kind == ham::str8("object") && !cache.empty()){
+			cache.back().object_symbols.emplace_back(line);
+		}
+		else{
+			valid = false;
+			break;
+		}
+	}
+
+	fclose(file);
+
+	if(valid){
+		ret = std::move(cache);
+	}
+	else{
+		ham::logapiverbose("Ignoring malformed plugin cache {}", (const char*)cache_path);
+	}
+}
+
+//! Plugin directories are often read-only, so failing to write the cache isn't an error.
+static void ham_impl_plugin_cache_save(const char *dir, const ham_impl_plugin_cache &cache){
+	ham::str_buffer8 contents;
+	contents.append_format(HAM_IMPL_PLUGIN_CACHE_MAGIC " {}\n", ham_impl_plugin_cache_version);
+
+	for(const auto &manifest : cache){
+		// placeholders for files that couldn't be opened
+		if(manifest.file_name.empty()) continue;
+
+		contents.append_format("dso {} {} {}\n", manifest.mtime_ns, manifest.size, manifest.file_name.get());
+
+		for(const auto &plugin : manifest.plugins){
+			contents.append_format("plugin {} {}\n", plugin.name.get(), plugin.symbol.get());
+		}
+
+		for(const auto &sym : manifest.object_symbols){
+			contents.append_format("object {}\n", sym.get());
+		}
+	}
+
+	ham_path_buffer_utf8 cache_path, tmp_path;
+
+	const int path_len = snprintf(cache_path, sizeof(cache_path), "%s/" HAM_IMPL_PLUGIN_CACHE_NAME, dir);
+	const int tmp_len = snprintf(tmp_path, sizeof(tmp_path), "%s/" HAM_IMPL_PLUGIN_CACHE_NAME ".%d", dir, (int)getpid());
+
+	if(path_len < 0 || (usize)path_len >= sizeof(cache_path) || tmp_len < 0 || (usize)tmp_len >= sizeof(tmp_path)) return;
+
+	// written to the side and renamed over the old one, so nobody reads half a cache
+	FILE *const file = fopen(tmp_path, "w");
+	if(!file){
+		ham::logapiverbose("Could not write plugin cache {}: {}", (const char*)tmp_path, strerror(errno));
+		return;
+	}
+
+	const bool written = fwrite(contents.ptr(), 1, contents.len(), file) == contents.len();
+
+	if(fclose(file) != 0 || !written || rename(tmp_path, cache_path) != 0){
+		ham::logapiverbose("Could not write plugin cache {}: {}", (const char*)cache_path, strerror(errno));
+		unlink(tmp_path);
+	}
+}
+
+//! Record every plugin and object vtable a DSO exports.
+static bool ham_impl_plugin_scan_dso(ham_dso_handle dso, ham_impl_plugin_manifest &ret){
+	const usize num_syms = ham_dso_iterate_symbols(
+		dso,
+		[](ham_dso_handle dso, ham_str8 sym_name, void *user){
+			const auto manifest = reinterpret_cast<ham_impl_plugin_manifest*>(user);
+
+			constexpr ham::str8 obj_vtable_prefix = HAM_STRINGIFY(ham_object_vptr_prefix);
+			constexpr ham::str8 vtable_prefix = HAM_STRINGIFY(HAM_IMPL_PLUGIN_VTABLE_NAME_PREFIX);
+
+			const auto sym_str = ham::str8(sym_name);
+
+			if(sym_str.len() > obj_vtable_prefix.len() && strncmp(sym_str.ptr(), obj_vtable_prefix.ptr(), obj_vtable_prefix.len()) == 0){
+				manifest->object_symbols.emplace_back(sym_str);
+			}
+			else if(sym_str.len() > vtable_prefix.len() && strncmp(sym_str.ptr(), vtable_prefix.ptr(), vtable_prefix.len()) == 0){
+				using plug_vtable_fn = const ham_plugin_vtable*(*)();
+
+				const auto plug_vtable_fptr = reinterpret_cast<plug_vtable_fn>(ham_dso_symbol_c(dso, sym_name.ptr));
+				const auto plug_vtable = plug_vtable_fptr ? plug_vtable_fptr() : nullptr;
+				if(!plug_vtable){
+					ham_logwarnf("ham_plugin_find", "Bad plugin vtable: %s", sym_name.ptr);
+					return true;
+				}
+
+				manifest->plugins.push_back({ ham::str_buffer8(plug_vtable->name()), ham::str_buffer8(sym_str) });
+			}
+
+			return true;
+		},
+		&ret
+	);
+
+	return num_syms != (usize)-1;
+}
+
+static ham_plugin *ham_impl_plugin_create(ham_dso_handle dso, const ham_plugin_vtable *plugin_vtable, const ham::std_vector<ham::str_buffer8> *object_symbols);
+
+//! Resolve the plugin vtable a manifest lists without touching the symbol table; object vtables are left for later.
+static ham_plugin *ham_impl_plugin_load_manifest(ham_dso_handle dso, const ham_impl_plugin_manifest &manifest, const char *id){
+	const ham_plugin_vtable *plug_vtable = nullptr;
+
+	for(const auto &plugin : manifest.plugins){
+		if(plugin.name != ham::str8(id)) continue;
+
+		using plug_vtable_fn = const ham_plugin_vtable*(*)();
+
+		const auto plug_vtable_fptr = reinterpret_cast<plug_vtable_fn>(ham_dso_symbol_c(dso, plugin.symbol.c_str()));
+		if(!plug_vtable_fptr) return nullptr;
+
+		plug_vtable = plug_vtable_fptr();
+		break;
+	}
+
+	if(!plug_vtable || ham::str8(plug_vtable->name()) != ham::str8(id)) return nullptr;
+
+	return ham_impl_plugin_create(dso, plug_vtable, &manifest.object_symbols);
+}
+
+static inline bool ham_impl_plugin_manifest_has(const ham_impl_plugin_manifest &manifest, const char *id){
+	for(const auto &plugin : manifest.plugins){
+		if(plugin.name == ham::str8(id)) return true;
+	}
+
+	return false;
+}
+
 ham_str8 ham_plugin_default_path(){
 	const char *path = getenv("HAM_PLUGIN_PATH");
 	if(!path){
@@ -49,16 +326,25 @@ ham_str8 ham_plugin_default_path(){
 	return (ham_str8){ path, strlen(path) };
 }
 
-bool ham_plugin_find(const char *id, ham_str8 path, ham_plugin **plugin_ret, ham_dso_handle *dso_ret){
-	if(
-		!ham_check(id != NULL) ||
-		!ham_check(plugin_ret != NULL) ||
-		!ham_check(dso_ret != NULL) ||
-		!ham_check(!path.len || path.ptr)
-	){
-		return false;
+//! @cond ignore
+/**
+ * Open a plugin with every symbol bound up front, so a plugin that can't run is turned away here.
+ * Plugins loaded on first use may instead be opened again with lazy binding, so only calls needing a missing symbol fail.
+ */
+static ham_dso_handle ham_impl_plugin_open(const char *path, bool lazy_fallback){
+	const ham_dso_handle dso = ham_dso_open_c(path, HAM_DSO_GLOBAL | HAM_DSO_NOW);
+	if(dso || !lazy_fallback) return dso;
+
+	const ham_dso_handle lazy_dso = ham_dso_open_c(path, HAM_DSO_GLOBAL | HAM_DSO_LAZY);
+	if(lazy_dso){
+		ham_logwarnf("ham_plugin_deferred_get", "Plugin has unresolved symbols, they are bound as they are called: %s", path);
 	}
 
+	return lazy_dso;
+}
+
+static bool ham_impl_plugin_find(const char *id, ham_str8 path, bool lazy_fallback, ham_plugin **plugin_ret, ham_dso_handle *dso_ret){
+
 	//ham_path_buffer_utf8 cwd_buf;
 
 	if(!path.len){
@@ -81,6 +367,50 @@ bool ham_plugin_find(const char *id, ham_str8 path, ham_plugin **plugin_ret, ham
 	memcpy(path_buf, path.ptr, path.len);
 	path_buf[path.len] = '\0';
 
+	ham_impl_plugin_cache cache;
+	ham_impl_plugin_cache_load(path_buf, cache);
+
+	path_buf[path.len] = '/';
+
+	char *plugin_name_subpath = path_buf + path.len + 1;
+
+	const auto set_subpath = [&](ham::str8 plugin_name){
+		if(path.len + plugin_name.len() + 1 >= HAM_PATH_BUFFER_SIZE){
+			ham_logapiwarnf("Plugin path too long: %zu, max %d", path.len + plugin_name.len() + 1, HAM_PATH_BUFFER_SIZE-1);
+			return false;
+		}
+
+		memcpy(plugin_name_subpath, plugin_name.ptr(), plugin_name.len());
+		plugin_name_subpath[plugin_name.len()] = '\0';
+		return true;
+	};
+
+	// plugins in the cache are opened straight away
+	for(const auto &manifest : cache){
+		if(!ham_impl_plugin_manifest_has(manifest, id) || !set_subpath(manifest.file_name.get())) continue;
+
+		i64 mtime_ns;
+		u64 size;
+		if(!ham_impl_plugin_file_stamp(path_buf, &mtime_ns, &size) || mtime_ns != manifest.mtime_ns || size != manifest.size){
+			continue;
+		}
+
+		const ham_dso_handle plugin_dso = ham_impl_plugin_open(path_buf, lazy_fallback);
+		if(!plugin_dso) continue;
+
+		ham_plugin *const plugin = ham_impl_plugin_load_manifest(plugin_dso, manifest, id);
+		if(!plugin){
+			ham_dso_close(plugin_dso);
+			continue;
+		}
+
+		*plugin_ret = plugin;
+		*dso_ret = plugin_dso;
+		return true;
+	}
+
+	path_buf[path.len] = '\0';
+
 	DIR *plugin_dir = opendir(path_buf);
 	if(!plugin_dir){
 		ham_logapierrorf("Error in opendir: %s", strerror(errno));
@@ -89,31 +419,46 @@ bool ham_plugin_find(const char *id, ham_str8 path, ham_plugin **plugin_ret, ham
 
 	path_buf[path.len] = '/';
 
-	char *plugin_name_subpath = path_buf + path.len + 1;
+	bool cache_dirty = false;
 
-	struct plugin_iter_data{
-		const char *id = nullptr;
-		const char *category = nullptr;
-		const ham_plugin_vtable *vtable = nullptr;
-	};
+	for(const struct dirent *plugin_dirent = readdir(plugin_dir); plugin_dirent != nullptr; plugin_dirent = readdir(plugin_dir)){
+		// hidden files include the cache itself
+		if(plugin_dirent->d_type != DT_REG || plugin_dirent->d_name[0] == '.'){
+			continue;
+		}
 
-	plugin_iter_data data;
-	data.id = id;
+		const ham::str8 plugin_name = (const char*)plugin_dirent->d_name;
 
-	for(const struct dirent *plugin_dirent = readdir(plugin_dir); plugin_dirent != nullptr; plugin_dirent = readdir(plugin_dir)){
-		if(plugin_dirent->d_type != DT_REG){
+		if(!set_subpath(plugin_name)){
 			continue;
 		}
 
-		ham::str8 plugin_name = plugin_dirent->d_name;
+		ham_impl_plugin_manifest scanned;
+		scanned.file_name = plugin_name;
+		scanned.seen = true;
 
-		if(path.len + plugin_name.len() + 1 >= HAM_PATH_BUFFER_SIZE){
-			ham_logapiwarnf("Plugin path too long: %zu, max %d", path.len + plugin_name.len() + 1, HAM_PATH_BUFFER_SIZE-1);
+		if(!ham_impl_plugin_file_stamp(path_buf, &scanned.mtime_ns, &scanned.size)){
+			ham_logapiwarnf("Could not get file info: %s", path_buf);
 			continue;
 		}
 
-		memcpy(plugin_name_subpath, plugin_name.ptr(), plugin_name.len());
-		plugin_name_subpath[plugin_name.len()] = '\0';
+		usize cache_idx = 0;
+		while(cache_idx < cache.size() && cache[cache_idx].file_name != plugin_name){
+			++cache_idx;
+		}
+
+		if(cache_idx < cache.size()){
+			auto &manifest = cache[cache_idx];
+
+			// unchanged files known not to hold the plugin aren't opened at all
+			if(manifest.mtime_ns == scanned.mtime_ns && manifest.size == scanned.size){
+				manifest.seen = true;
+				if(!ham_impl_plugin_manifest_has(manifest, id)) continue;
+			}
+		}
+		else{
+			cache.emplace_back();
+		}
 
 		ham_file_info file_info;
 		if(!ham_path_file_info_utf8(ham::str8((const char*)path_buf), &file_info)){
@@ -122,16 +467,32 @@ bool ham_plugin_find(const char *id, ham_str8 path, ham_plugin **plugin_ret, ham
 		}
 		else if(ham::str8(file_info.mime).substr(0, plugin_mime.len()) != plugin_mime){
 			ham_logapiwarnf("Non-plugin found in plugins folder: %s", path_buf);
+
+			// remembered with no plugins so it's skipped from now on
+			cache[cache_idx] = std::move(scanned);
+			cache_dirty = true;
 			continue;
 		}
 
-		const ham_dso_handle plugin_dso = ham_dso_open_c(path_buf, HAM_DSO_GLOBAL | HAM_DSO_NOW);
+		const ham_dso_handle plugin_dso = ham_impl_plugin_open(path_buf, lazy_fallback);
 		if(!plugin_dso){
 			ham_logapiwarnf("Failed to open plugin: %s", path_buf);
 			continue;
 		}
 
-		ham_plugin *const plugin = ham_plugin_load(plugin_dso, id);
+		if(!ham_impl_plugin_scan_dso(plugin_dso, scanned)){
+			ham_logapiwarnf("Failed to iterate symbols of plugin: %s", path_buf);
+			ham_dso_close(plugin_dso);
+			continue;
+		}
+
+		cache[cache_idx] = std::move(scanned);
+		cache_dirty = true;
+
+		ham_plugin *const plugin = ham_impl_plugin_manifest_has(cache[cache_idx], id)
+			? ham_impl_plugin_load_manifest(plugin_dso, cache[cache_idx], id)
+			: nullptr;
+
 		if(!plugin){
 			ham_dso_close(plugin_dso);
 			continue;
@@ -140,12 +501,108 @@ bool ham_plugin_find(const char *id, ham_str8 path, ham_plugin **plugin_ret, ham
 		*plugin_ret = plugin;
 		*dso_ret = plugin_dso;
 		closedir(plugin_dir);
+
+		path_buf[path.len] = '\0';
+		ham_impl_plugin_cache_save(path_buf, cache);
 		return true;
 	}
 
 	closedir(plugin_dir);
+
+	// every file was visited, so anything not seen is gone
+	const auto num_cached = cache.size();
+
+	std::erase_if(cache, [](const ham_impl_plugin_manifest &manifest){ return !manifest.seen || manifest.file_name.empty(); });
+
+	if(cache_dirty || cache.size() != num_cached){
+		path_buf[path.len] = '\0';
+		ham_impl_plugin_cache_save(path_buf, cache);
+	}
+
 	return false;
 }
+//! @endcond
+
+bool ham_plugin_find(const char *id, ham_str8 path, ham_plugin **plugin_ret, ham_dso_handle *dso_ret){
+	if(
+		!ham_check(id != NULL) ||
+		!ham_check(plugin_ret != NULL) ||
+		!ham_check(dso_ret != NULL) ||
+		!ham_check(!path.len || path.ptr)
+	){
+		return false;
+	}
+
+	return ham_impl_plugin_find(id, path, false, plugin_ret, dso_ret);
+}
+
+//
+// Deferred loading
+//
+
+struct ham_plugin_deferred{
+	const ham_allocator *allocator = nullptr;
+	ham::str_buffer8 id, path;
+
+	std::mutex mut;
+	bool searched = false;
+	ham_plugin *plugin = nullptr;
+	ham_dso_handle dso = nullptr;
+};
+
+ham_plugin_deferred *ham_plugin_deferred_create(const char *id, ham_str8 path){
+	if(
+		!ham_check(id != NULL) ||
+		!ham_check(!path.len || path.ptr)
+	){
+		return nullptr;
+	}
+
+	const ham_allocator *allocator = ham_current_allocator();
+
+	const auto ptr = ham_allocator_new(allocator, ham_plugin_deferred);
+	if(!ptr){
+		ham_logapierrorf("Error allocating ham_plugin_deferred");
+		return nullptr;
+	}
+
+	ptr->allocator = allocator;
+	ptr->id = ham::str8(id);
+	ptr->path = ham::str8(path);
+
+	return ptr;
+}
+
+void ham_plugin_deferred_destroy(ham_plugin_deferred *deferred){
+	if(ham_unlikely(!deferred)) return;
+
+	if(deferred->plugin){
+		ham_plugin_unload(deferred->plugin);
+		ham_dso_close(deferred->dso);
+	}
+
+	const ham_allocator *allocator = deferred->allocator;
+
+	ham_allocator_delete(allocator, deferred);
+}
+
+ham_plugin *ham_plugin_deferred_get(ham_plugin_deferred *deferred){
+	if(!ham_check(deferred != NULL)) return nullptr;
+
+	std::scoped_lock lock(deferred->mut);
+
+	if(!deferred->searched){
+		deferred->searched = true;
+
+		if(!ham_impl_plugin_find(deferred->id.c_str(), deferred->path.get(), true, &deferred->plugin, &deferred->dso)){
+			ham_logapiwarnf("Failed to find plugin: %s", deferred->id.c_str());
+			deferred->plugin = nullptr;
+			deferred->dso = nullptr;
+		}
+	}
+
+	return deferred->plugin;
+}
 
 ham_plugin *ham_plugin_load(ham_dso_handle dso, const char *plugin_id){
 	if(!dso){
@@ -156,46 +613,24 @@ ham_plugin *ham_plugin_load(ham_dso_handle dso, const char *plugin_id){
 		}
 	}
 
-	const ham_allocator *allocator = ham_current_allocator();
-
-	ham::std_vector<const ham_plugin_vtable*> plug_vtables(allocator);
-
 	struct iter_data{
 		const char *req_id;
 		const ham_plugin_vtable *plug_vtable = nullptr;
-		ham::std_vector<const ham_object_vtable*> obj_vtables;
 	} data;
 
 	data.req_id = plugin_id;
 
+	// object vtables are resolved on demand, so the walk stops as soon as the plugin turns up
 	ham_usize total_num_syms = ham_dso_iterate_symbols(
 		dso,
 		[](ham_dso_handle dso, ham_str8 sym_name, void *user){
 			const auto data = reinterpret_cast<iter_data*>(user);
 
-			constexpr ham::str8 obj_vtable_prefix = HAM_STRINGIFY(ham_object_vptr_prefix);
 			constexpr ham::str8 vtable_prefix = HAM_STRINGIFY(HAM_IMPL_PLUGIN_VTABLE_NAME_PREFIX);
 
 			const auto sym_str = ham::str8(sym_name);
 
-			if(sym_str.len() > obj_vtable_prefix.len() && strncmp(sym_str.ptr(), obj_vtable_prefix.ptr(), obj_vtable_prefix.len()) == 0){
-				using obj_vtable_fn = const ham_object_vtable*(*)();
-
-				const auto obj_vtable_fptr = reinterpret_cast<obj_vtable_fn>(ham_dso_symbol_c(dso, sym_name.ptr));
-				if(!obj_vtable_fptr){
-					ham_logwarnf("ham_plugin_load", "Failed to load object vtable: %s", sym_name.ptr);
-					return true;
-				}
-
-				const auto obj_vtable = obj_vtable_fptr();
-				if(!obj_vtable){
-					ham_logwarnf("ham_plugin_load", "Bad object vtable: %s", sym_name.ptr);
-					return true;
-				}
-
-				data->obj_vtables.emplace_back(obj_vtable);
-			}
-			else if(!data->plug_vtable && sym_str.len() > vtable_prefix.len() && strncmp(sym_str.ptr(), vtable_prefix.ptr(), vtable_prefix.len()) == 0){
+			if(sym_str.len() > vtable_prefix.len() && strncmp(sym_str.ptr(), vtable_prefix.ptr(), vtable_prefix.len()) == 0){
 				using plug_vtable_fn = const ham_plugin_vtable*(*)();
 
 				const auto plug_vtable_fptr = reinterpret_cast<plug_vtable_fn>(ham_dso_symbol_c(dso, sym_name.ptr));
@@ -213,6 +648,7 @@ ham_plugin *ham_plugin_load(ham_dso_handle dso, const char *plugin_id){
 				if(strcmp(plug_vtable->name().ptr, data->req_id) == 0){
 					ham_logdebugf("ham_plugin_load", "Found plugin vtable: %s", sym_name.ptr);
 					data->plug_vtable = plug_vtable;
+					return false;
 				}
 			}
 
@@ -230,20 +666,35 @@ ham_plugin *ham_plugin_load(ham_dso_handle dso, const char *plugin_id){
 		return nullptr;
 	}
 
+	return ham_impl_plugin_create(dso, data.plug_vtable, nullptr);
+}
+
+static ham_plugin *ham_impl_plugin_create(ham_dso_handle dso, const ham_plugin_vtable *plugin_vtable, const ham::std_vector<ham::str_buffer8> *object_symbols){
+	const ham_allocator *allocator = ham_current_allocator();
+
 	const auto ptr = ham_allocator_new(allocator, ham_plugin);
 	if(!ptr){
-		ham_logapierrorf("Error allocating ham_plugin");
+		ham::logerror("ham_plugin_load", "Error allocating ham_plugin");
 		return nullptr;
 	}
 
 	ptr->allocator = allocator;
-	ptr->plugin_vtable = data.plug_vtable;
-	ptr->object_vtables = std::move(data.obj_vtables);
+	ptr->dso = dso;
+	ptr->plugin_vtable = plugin_vtable;
+
+	if(object_symbols){
+		ptr->object_symbols = *object_symbols;
+		ptr->object_symbols_known = true;
+	}
 
-	if(!ham_dso_path(dso, sizeof(ptr->dir_path), ptr->dir_path)){
-		ham_logapiwarnf("Failed to find DSO path");
+	if(!ham_dso_path(dso, sizeof(ptr->dso_path), ptr->dso_path)){
+		ham_logwarnf("ham_plugin_load", "Failed to find DSO path");
 	}
 	else{
+		ham_impl_plugin_file_stamp(ptr->dso_path, &ptr->dso_mtime_ns, &ptr->dso_size);
+
+		memcpy(ptr->dir_path, ptr->dso_path, sizeof(ptr->dir_path));
+
 		const auto slash_idx = ham::str8((const char*)ptr->dir_path).rfind("/");
 		if(slash_idx != ham::str8::npos){
 			ptr->dir_path[slash_idx] = '\0';
@@ -306,6 +757,51 @@ bool ham_plugin_fini(ham_plugin *plugin){
 	return true;
 }
 
+//! @cond ignore
+static const ham_object_vtable *ham_impl_plugin_loaded_object(const ham_plugin *plugin, ham_str8 name){
+	for(auto obj_vt : plugin->object_vtables){
+		const ham::str8 obj_type_id = ham::str8(obj_vt->info->type_id);
+		if(obj_type_id == name) return obj_vt;
+	}
+
+	return nullptr;
+}
+
+//! Resolve every object vtable in the plugin, called with `objects_mut` held.
+static void ham_impl_plugin_resolve_objects(const ham_plugin *plugin){
+	if(plugin->objects_complete) return;
+
+	ham_impl_plugin_manifest scanned;
+	const ham::std_vector<ham::str_buffer8> *object_symbols = &plugin->object_symbols;
+
+	if(!plugin->object_symbols_known){
+		if(!ham_impl_plugin_scan_dso(plugin->dso, scanned)){
+			ham_logerrorf("ham_plugin_object", "Failed to iterate dll symbols");
+			return;
+		}
+
+		object_symbols = &scanned.object_symbols;
+	}
+
+	for(const auto &sym : *object_symbols){
+		using obj_vtable_fn = const ham_object_vtable*(*)();
+
+		const auto obj_vtable_fptr = reinterpret_cast<obj_vtable_fn>(ham_dso_symbol_c(plugin->dso, sym.c_str()));
+		const auto obj_vtable = obj_vtable_fptr ? obj_vtable_fptr() : nullptr;
+		if(!obj_vtable){
+			ham_logwarnf("ham_plugin_object", "Bad object vtable: %s", sym.c_str());
+			continue;
+		}
+
+		if(!ham_impl_plugin_loaded_object(plugin, ham::str8(obj_vtable->info->type_id))){
+			plugin->object_vtables.emplace_back(obj_vtable);
+		}
+	}
+
+	plugin->objects_complete = true;
+}
+//! @endcond
+
 const ham_object_vtable *ham_plugin_object(const ham_plugin *plugin, ham_str8 name){
 	if(
 	   !ham_check(plugin != NULL) ||
@@ -314,17 +810,46 @@ const ham_object_vtable *ham_plugin_object(const ham_plugin *plugin, ham_str8 na
 		return nullptr;
 	}
 
-	for(auto obj_vt : plugin->object_vtables){
-		const ham::str8 obj_type_id = ham::str8(obj_vt->info->type_id);
-		if(obj_type_id == name) return obj_vt;
+	std::scoped_lock lock(plugin->objects_mut);
+
+	const auto loaded = ham_impl_plugin_loaded_object(plugin, name);
+	if(loaded || plugin->objects_complete) return loaded;
+
+	// objects defined with ham_define_object export their vtable under their type id
+	constexpr ham::str8 obj_vtable_prefix = HAM_STRINGIFY(ham_object_vptr_prefix);
+
+	ham_name_buffer_utf8 sym_buf;
+	if(obj_vtable_prefix.len() + name.len < sizeof(sym_buf)){
+		memcpy(sym_buf, obj_vtable_prefix.ptr(), obj_vtable_prefix.len());
+		memcpy(sym_buf + obj_vtable_prefix.len(), name.ptr, name.len);
+		sym_buf[obj_vtable_prefix.len() + name.len] = '\0';
+
+		using obj_vtable_fn = const ham_object_vtable*(*)();
+
+		const auto obj_vtable_fptr = reinterpret_cast<obj_vtable_fn>(ham_dso_symbol_c(plugin->dso, sym_buf));
+		const auto obj_vtable = obj_vtable_fptr ? obj_vtable_fptr() : nullptr;
+
+		if(obj_vtable && ham::str8(obj_vtable->info->type_id) == ham::str8(name)){
+			plugin->object_vtables.emplace_back(obj_vtable);
+			return obj_vtable;
+		}
 	}
 
-	return nullptr;
+	// anything else has to be found the slow way
+	ham_impl_plugin_resolve_objects(plugin);
+	return ham_impl_plugin_loaded_object(plugin, name);
 }
 
 ham_usize ham_plugin_iterate_objects(const ham_plugin *plugin, ham_plugin_iterate_objects_fn fn, void *user){
 	if(!ham_check(plugin != NULL)) return (usize)-1;
 
+	{
+		std::scoped_lock lock(plugin->objects_mut);
+		ham_impl_plugin_resolve_objects(plugin);
+		if(!plugin->objects_complete) return (usize)-1;
+	}
+
+	// the list doesn't change once every vtable is resolved, so no lock is held calling back
 	if(fn){
 		for(usize i = 0; i < plugin->object_vtables.size(); i++){
 			if(!fn(plugin->object_vtables[i], user)){
@@ -336,4 +861,283 @@ ham_usize ham_plugin_iterate_objects(const ham_plugin *plugin, ham_plugin_iterat
 	return plugin->object_vtables.size();
 }
 
+//
+// Hot reloading
+//
+
+bool ham_plugin_add_object_manager(ham_plugin *plugin, ham_object_manager *manager, ham_object_migrate_fn migrate, void *user){
+	if(!ham_check(plugin != NULL) || !ham_check(manager != NULL)) return false;
+
+	std::scoped_lock lock(plugin->mut);
+
+	for(auto &&entry : plugin->managers){
+		if(entry.manager == manager){
+			entry.migrate = migrate;
+			entry.user = user;
+			return true;
+		}
+	}
+
+	plugin->managers.push_back({ manager, migrate, user });
+	return true;
+}
+
+bool ham_plugin_remove_object_manager(ham_plugin *plugin, ham_object_manager *manager){
+	if(!ham_check(plugin != NULL) || !ham_check(manager != NULL)) return false;
+
+	std::scoped_lock lock(plugin->mut);
+
+	return std::erase_if(plugin->managers, [manager](const ham_impl_plugin_manager &entry){ return entry.manager == manager; }) > 0;
+}
+
+bool ham_plugin_changed(const ham_plugin *plugin){
+	if(!ham_check(plugin != NULL)) return false;
+
+	i64 mtime_ns;
+	u64 size;
+
+	// a DSO that is being written out can go missing for a moment, which isn't a change yet
+	if(!ham_impl_plugin_file_stamp(plugin->dso_path, &mtime_ns, &size)) return false;
+
+	return mtime_ns != plugin->dso_mtime_ns || size != plugin->dso_size;
+}
+
+//! @cond ignore
+static bool ham_impl_plugin_copy_file(const char *from, const char *to){
+	FILE *const src = fopen(from, "rb");
+	if(!src) return false;
+
+	FILE *const dst = fopen(to, "wb");
+	if(!dst){
+		fclose(src);
+		return false;
+	}
+
+	char buf[64 * 1024];
+	bool result = true;
+
+	for(usize num_read; (num_read = fread(buf, 1, sizeof(buf), src)) > 0;){
+		if(fwrite(buf, 1, num_read, dst) != num_read){
+			result = false;
+			break;
+		}
+	}
+
+	result = result && !ferror(src);
+
+	fclose(src);
+	if(fclose(dst) != 0) result = false;
+
+	if(!result) unlink(to);
+	return result;
+}
+//! @endcond
+
+bool ham_plugin_reload(ham_plugin *plugin, ham_dso_handle *dso, ham_dso_handle *old_dso_ret){
+	if(
+	   !ham_check(plugin != NULL) ||
+	   !ham_check(dso != NULL) ||
+	   !ham_check(*dso == plugin->dso)
+	){
+		return false;
+	}
+
+	if(old_dso_ret) *old_dso_ret = nullptr;
+
+	std::scoped_lock lock(plugin->mut, plugin->objects_mut);
+
+	if(!plugin->dso_path[0]){
+		ham_logapierrorf("Plugin has no DSO path to reload from");
+		return false;
+	}
+
+	i64 mtime_ns;
+	u64 size;
+	if(!ham_impl_plugin_file_stamp(plugin->dso_path, &mtime_ns, &size)){
+		ham_logapierrorf("Could not get file info: %s", plugin->dso_path);
+		return false;
+	}
+
+	// the loader hands back the DSO it already has for a known path, so the rebuilt one is opened from a copy
+	static std::atomic<u32> reload_counter = 0;
+
+	const usize dir_len = strlen(plugin->dir_path);
+	const char *const file_name = plugin->dso_path + (dir_len ? dir_len + 1 : 0);
+
+	ham_path_buffer_utf8 copy_path;
+	const int copy_len = snprintf(
+		copy_path, sizeof(copy_path), "%s%s.%s.reload-%d-%u",
+		plugin->dir_path, dir_len ? "/" : "", file_name, (int)getpid(), reload_counter.fetch_add(1, std::memory_order_relaxed)
+	);
+
+	if(copy_len < 0 || (usize)copy_len >= sizeof(copy_path)){
+		ham_logapierrorf("Plugin path too long: %s", plugin->dso_path);
+		return false;
+	}
+
+	if(!ham_impl_plugin_copy_file(plugin->dso_path, copy_path)){
+		ham_logapierrorf("Error copying %s to %s: %s", plugin->dso_path, copy_path, strerror(errno));
+		return false;
+	}
+
+	// local, so the new copy's symbols don't get mixed up with the old one's
+	const ham_dso_handle new_dso = ham_dso_open_c(copy_path, HAM_DSO_LOCAL | HAM_DSO_NOW);
+	if(!new_dso){
+		ham_logapiwarnf("Error opening rebuilt plugin: %s", plugin->dso_path);
+		unlink(copy_path);
+		return false;
+	}
+
+	ham_impl_plugin_manifest scanned;
+	const bool scan_result = ham_impl_plugin_scan_dso(new_dso, scanned);
+
+	// symbols are read from the file, but the mapping outlives it
+	unlink(copy_path);
+
+	if(!scan_result){
+		ham_logapiwarnf("Failed to iterate symbols of rebuilt plugin: %s", plugin->dso_path);
+		ham_dso_close(new_dso);
+		return false;
+	}
+
+	// everything the swap needs is looked up before anything changes, so a bad build only warns and leaves the old one running
+	const ham::str8 plugin_name = plugin->plugin_vtable->name();
+	const ham_plugin_vtable *new_plug_vtable = nullptr;
+
+	for(const auto &entry : scanned.plugins){
+		if(entry.name != plugin_name) continue;
+
+		using plug_vtable_fn = const ham_plugin_vtable*(*)();
+
+		const auto plug_vtable_fptr = reinterpret_cast<plug_vtable_fn>(ham_dso_symbol_c(new_dso, entry.symbol.c_str()));
+		new_plug_vtable = plug_vtable_fptr ? plug_vtable_fptr() : nullptr;
+		break;
+	}
+
+	if(!new_plug_vtable){
+		ham_logapiwarnf("Rebuilt plugin no longer provides %.*s", (int)plugin_name.len(), plugin_name.ptr());
+		ham_dso_close(new_dso);
+		return false;
+	}
+
+	ham::std_vector<const ham_object_vtable*> new_objects;
+	new_objects.reserve(scanned.object_symbols.size());
+
+	for(const auto &sym : scanned.object_symbols){
+		using obj_vtable_fn = const ham_object_vtable*(*)();
+
+		const auto obj_vtable_fptr = reinterpret_cast<obj_vtable_fn>(ham_dso_symbol_c(new_dso, sym.c_str()));
+		const auto obj_vtable = obj_vtable_fptr ? obj_vtable_fptr() : nullptr;
+		if(!obj_vtable){
+			ham_logapiwarnf("Bad object vtable: %s", sym.c_str());
+			continue;
+		}
+
+		new_objects.emplace_back(obj_vtable);
+	}
+
+	ham::std_vector<const ham_object_vtable*> manager_vtables;
+	manager_vtables.reserve(plugin->managers.size());
+
+	for(const auto &entry : plugin->managers){
+		const auto old_info = ham_object_manager_vtable(entry.manager)->info;
+
+		const auto new_vtable_it = std::find_if(
+			new_objects.begin(), new_objects.end(),
+			[old_info](const ham_object_vtable *vtable){ return strcmp(vtable->info->type_id, old_info->type_id) == 0; }
+		);
+
+		if(new_vtable_it == new_objects.end()){
+			ham_logapiwarnf("Rebuilt plugin no longer provides object %s", old_info->type_id);
+			ham_dso_close(new_dso);
+			return false;
+		}
+
+		const auto new_info = (*new_vtable_it)->info;
+
+		if(new_info->size != old_info->size || new_info->alignment != old_info->alignment){
+			ham_logapiwarnf("Layout of object %s changed, it can't be reloaded", old_info->type_id);
+			ham_dso_close(new_dso);
+			return false;
+		}
+
+		manager_vtables.emplace_back(*new_vtable_it);
+	}
+
+	ham::std_vector<const ham_object_vtable*> old_manager_vtables;
+	old_manager_vtables.reserve(plugin->managers.size());
+
+	for(const auto &entry : plugin->managers){
+		old_manager_vtables.emplace_back(ham_object_manager_vtable(entry.manager));
+	}
+
+	// layouts were checked above, so switching a manager back never fails; migrations already done aren't undone
+	const auto roll_back_managers = [&](usize num_swapped){
+		for(usize i = 0; i < num_swapped; i++){
+			ham_object_manager_set_vtable(plugin->managers[i].manager, old_manager_vtables[i], nullptr, nullptr);
+		}
+	};
+
+	// objects are switched over while the old copy is still running, so a failed migration leaves it untouched
+	for(usize i = 0; i < plugin->managers.size(); i++){
+		const auto &entry = plugin->managers[i];
+		if(!ham_object_manager_set_vtable(entry.manager, manager_vtables[i], entry.migrate, entry.user)){
+			ham_logapiwarnf("Failed to migrate objects of type %s, keeping the old plugin", manager_vtables[i]->info->type_id);
+			roll_back_managers(i + 1);
+			ham_dso_close(new_dso);
+			return false;
+		}
+	}
+
+	const ham_plugin_vtable *const old_plug_vtable = plugin->plugin_vtable;
+	const bool was_init = plugin->init_flag;
+
+	if(was_init){
+		old_plug_vtable->fini();
+		plugin->init_flag = false;
+
+		if(!new_plug_vtable->init()){
+			ham_logapiwarnf("Error initializing rebuilt plugin %.*s, keeping the old plugin", (int)plugin_name.len(), plugin_name.ptr());
+
+			roll_back_managers(plugin->managers.size());
+			ham_dso_close(new_dso);
+
+			plugin->init_flag = old_plug_vtable->init();
+			if(!plugin->init_flag){
+				ham_logapierrorf("Error initializing plugin %.*s again", (int)plugin_name.len(), plugin_name.ptr());
+			}
+
+			return false;
+		}
+
+		plugin->init_flag = true;
+	}
+
+	plugin->plugin_vtable = new_plug_vtable;
+	plugin->dso = new_dso;
+	plugin->dso_mtime_ns = mtime_ns;
+	plugin->dso_size = size;
+
+	plugin->object_vtables = std::move(new_objects);
+	plugin->object_symbols = std::move(scanned.object_symbols);
+	plugin->object_symbols_known = true;
+	plugin->objects_complete = true;
+
+	ham_logapiverbosef("Reloaded plugin %.*s", (int)plugin_name.len(), plugin_name.ptr());
+
+	const ham_dso_handle old_dso = *dso;
+	*dso = new_dso;
+
+	if(old_dso_ret){
+		*old_dso_ret = old_dso;
+	}
+	else{
+		// queued records may still point into the old copy
+		ham_async_logger_flush_all();
+		ham_dso_close(old_dso);
+	}
+
+	return true;
+}
+
 HAM_C_API_END
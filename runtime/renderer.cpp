@@ -542,7 +542,7 @@ ham_u32 ham_draw_group_instance_iterate(
 
 		for(result = 0; result < n; result++){
 			const auto inst = data + result;
-			if(!fn(inst, data)) break;
+			if(!fn(inst, user)) break;
 		}
 	}
 
@@ -579,6 +579,30 @@ bool ham_draw_group_instance_visit(
 	return result;
 }
 
+bool ham_draw_group_instance_write(
+	ham_draw_group *group,
+	ham_draw_group_instance_write_fn fn,
+	void *user
+){
+	if(!ham_check(group != NULL) || !ham_check(fn != NULL)) return false;
+
+	if(!ham_mutex_lock(&group->mut)){
+		ham::logapierror("Error in ham_mutex_lock");
+		return false;
+	}
+
+	const auto vptr = (const ham_draw_group_vtable*)ham_super(group)->vptr;
+	const auto data = vptr->instance_data(group);
+
+	const bool result = fn(data, group->num_instances, user);
+
+	if(!ham_mutex_unlock(&group->mut)){
+		ham::logapiwarn("Error in ham_mutex_unlock");
+	}
+
+	return result;
+}
+
 //
 // Light groups
 //
@@ -662,7 +686,7 @@ ham_u32 ham_light_group_instance_iterate(
 
 		for(result = 0; result < n; result++){
 			const auto inst = data + result;
-			if(!fn(inst, data)) break;
+			if(!fn(inst, user)) break;
 		}
 	}
 
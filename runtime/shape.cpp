@@ -33,6 +33,7 @@ struct ham_shape{
 	ham_vec4 *bone_weights;
 	ham_u32 *indices;
 	ham_shape_bone *bones;
+	bool owns_data;
 };
 
 static inline ham_shape *ham_shape_create(
@@ -164,6 +165,7 @@ static inline ham_shape *ham_shape_create(
 	ptr->bone_weights = (ham_vec4*)new_bone_weights;
 	ptr->indices = (ham_u32*)new_indices;
 	ptr->bones = (ham_shape_bone*)new_bones;
+	ptr->owns_data = true;
 
 	return ptr;
 }
@@ -226,6 +228,7 @@ const ham_shape *ham_shape_unit_square(){
 		.bone_weights = bone_weights,
 		.indices = indices,
 		.bones = bones,
+		.owns_data = false,
 	};
 
 	return &ret;
@@ -264,6 +267,56 @@ ham_shape *ham_shape_create_triangle_mesh(
 	);
 }
 
+ham_shape *ham_shape_create_triangle_mesh_view(
+	ham_u32 num_points,
+	const ham_vec3 *verts,
+	const ham_vec3 *norms,
+	const ham_vec2 *uvs,
+	const ham_vec4i *bone_indices,
+	const ham_vec4 *bone_weights,
+	ham_u32 num_indices,
+	const ham_u32 *indices,
+	ham_u32 num_bones,
+	const ham_shape_bone *bones
+){
+	if(
+	   !ham_check(num_points > 0) ||
+	   !ham_check(num_indices > 0) ||
+	   !ham_check(num_bones > 0) ||
+	   !ham_check(verts != NULL) ||
+	   !ham_check(norms != NULL) ||
+	   !ham_check(uvs != NULL) ||
+	   !ham_check(bone_indices != NULL) ||
+	   !ham_check(bone_weights != NULL) ||
+	   !ham_check(indices != NULL) ||
+	   !ham_check(bones != NULL)
+	){
+		return nullptr;
+	}
+
+	const auto allocator = ham_current_allocator();
+
+	const auto ptr = ham_allocator_new(allocator, ham_shape);
+	if(!ptr) return nullptr;
+
+	ptr->allocator = allocator;
+	ptr->kind = HAM_SHAPE_TRIANGLE_MESH;
+	ptr->vertex_order = HAM_VERTEX_TRIANGLES;
+	ptr->num_points = num_points;
+	ptr->num_indices = num_indices;
+	ptr->num_bones = num_bones;
+	ptr->verts   = const_cast<ham_vec3*>(verts);
+	ptr->norms   = const_cast<ham_vec3*>(norms);
+	ptr->uvs     = const_cast<ham_vec2*>(uvs);
+	ptr->bone_indices = const_cast<ham_vec4i*>(bone_indices);
+	ptr->bone_weights = const_cast<ham_vec4*>(bone_weights);
+	ptr->indices = const_cast<ham_u32*>(indices);
+	ptr->bones = const_cast<ham_shape_bone*>(bones);
+	ptr->owns_data = false;
+
+	return ptr;
+}
+
 ham_shape *ham_shape_create_quad(const ham_vec2 *points){
 	const ham_vec3 verts[] = {
 		ham_vec3{ .data = { points[0].x, points[0].y, 0.f } },
@@ -518,13 +571,15 @@ void ham_shape_destroy(ham_shape *shape){
 
 	const auto allocator = shape->allocator;
 
-	ham_allocator_free(allocator, shape->verts);
-	ham_allocator_free(allocator, shape->norms);
-	ham_allocator_free(allocator, shape->uvs);
-	ham_allocator_free(allocator, shape->bone_indices);
-	ham_allocator_free(allocator, shape->bone_weights);
-	ham_allocator_free(allocator, shape->indices);
-	ham_allocator_free(allocator, shape->bones);
+	if(shape->owns_data){
+		ham_allocator_free(allocator, shape->verts);
+		ham_allocator_free(allocator, shape->norms);
+		ham_allocator_free(allocator, shape->uvs);
+		ham_allocator_free(allocator, shape->bone_indices);
+		ham_allocator_free(allocator, shape->bone_weights);
+		ham_allocator_free(allocator, shape->indices);
+		ham_allocator_free(allocator, shape->bones);
+	}
 
 	ham_allocator_delete(allocator, shape);
 }
@@ -15,18 +15,33 @@
  * You should have received a copy of the GNU Lesser General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
-
 #include "ham/str_buffer.h"
 #include "ham/memory.h"
 
 namespace ham{
 	namespace detail{
 		template<typename Char>
-		struct str_buffer_ctype_impl{
-			class allocator<Char> allocator;
-			Char *mem;
-			usize capacity, stored;
-		};
+		inline bool str_buffer_impl_is_inline(const str_buffer_ctype_t<Char> *buf){
+			return buf->capacity == str_buffer_inline_capacity<Char>;
+		}
+
+		template<typename Char>
+		inline Char *str_buffer_impl_data(str_buffer_ctype_t<Char> *buf){
+			return str_buffer_impl_is_inline<Char>(buf) ? buf->inline_mem : buf->mem;
+		}
+
+		template<typename Char>
+		inline const Char *str_buffer_impl_data(const str_buffer_ctype_t<Char> *buf){
+			return str_buffer_impl_is_inline<Char>(buf) ? buf->inline_mem : buf->mem;
+		}
+
+		template<typename Char>
+		inline void str_buffer_impl_reset(str_buffer_ctype_t<Char> *buf, const ham_allocator *allocator){
+			buf->allocator = allocator;
+			buf->stored = 0;
+			buf->capacity = str_buffer_inline_capacity<Char>;
+			buf->inline_mem[0] = Char(0);
+		}
 
 		template<typename Char>
 		inline bool str_buffer_impl_reserve(str_buffer_ctype_t<Char> *buf, usize req_capacity){
@@ -34,148 +49,172 @@ namespace ham{
 
 			if(buf->capacity >= req_capacity) return true;
 
-			Char *new_mem = buf->allocator.allocate(req_capacity + 1);
+			Char *const new_mem = (Char*)ham_allocator_alloc(buf->allocator, alignof(Char), sizeof(Char) * (req_capacity + 1));
 			if(!new_mem) return false;
 
-			if(buf->mem && buf->stored){
-				memcpy(new_mem, buf->mem, sizeof(Char) * buf->stored);
-				new_mem[buf->stored] = Char(0);
+			// copies the null terminator too
+			memcpy(new_mem, str_buffer_impl_data<Char>(buf), sizeof(Char) * (buf->stored + 1));
+
+			if(!str_buffer_impl_is_inline<Char>(buf)){
+				ham_allocator_free(buf->allocator, buf->mem);
 			}
 
-			buf->allocator.deallocate(buf->mem, buf->capacity + 1);
 			buf->mem = new_mem;
 			buf->capacity = req_capacity;
 			return true;
 		}
 
+		//! Like `str_buffer_impl_reserve` but grows geometrically, for incremental appends.
+		template<typename Char>
+		inline bool str_buffer_impl_grow(str_buffer_ctype_t<Char> *buf, usize req_capacity){
+			if(!buf) return false;
+
+			if(buf->capacity >= req_capacity) return true;
+
+			const usize grown = buf->capacity + (buf->capacity / 2);
+			return str_buffer_impl_reserve<Char>(buf, grown > req_capacity ? grown : req_capacity);
+		}
+
 		template<typename Char>
 		inline bool str_buffer_impl_resize(str_buffer_ctype_t<Char> *buf, usize req_size, Char fill){
 			if(!str_buffer_impl_reserve<Char>(buf, req_size)) return false;
 
-			if(req_size > buf->stored){
-				const usize fill_len = req_size - buf->stored;
-				for(usize i = 0; i < fill_len; i++){
-					buf->mem[buf->stored + i] = fill;
-				}
+			const auto data = str_buffer_impl_data<Char>(buf);
+
+			for(usize i = buf->stored; i < req_size; i++){
+				data[i] = fill;
 			}
 
-			buf->mem[req_size] = '\0';
+			data[req_size] = Char(0);
 			buf->stored = req_size;
 			return true;
 		}
 
 		template<typename Char>
 		inline bool str_buffer_impl_append(str_buffer_ctype_t<Char> *buf, str_ctype_t<Char> str){
-			if(!buf || !str_buffer_impl_reserve<Char>(buf, buf->stored + str.len)) return false;
+			if(!buf || !str_buffer_impl_grow<Char>(buf, buf->stored + str.len)) return false;
 
 			if(!str.len) return true;
 			else if(!str.ptr) return false;
 
-			memcpy(buf->mem + buf->stored, str.ptr, str.len);
+			const auto data = str_buffer_impl_data<Char>(buf);
+
+			memcpy(data + buf->stored, str.ptr, sizeof(Char) * str.len);
 			buf->stored += str.len;
-			buf->mem[buf->stored] = '\0';
+			data[buf->stored] = Char(0);
 			return true;
 		}
 
 		template<typename Char>
 		inline bool str_buffer_impl_prepend(str_buffer_ctype_t<Char> *buf, str_ctype_t<Char> str){
-			if(!buf || !str_buffer_impl_reserve<Char>(buf, buf->stored + str.len)) return false;
+			if(!buf || !str_buffer_impl_grow<Char>(buf, buf->stored + str.len)) return false;
 
 			if(!str.len) return true;
 			else if(!str.ptr) return false;
 
-			memmove(buf->mem + str.len, buf->mem, buf->stored);
-			memcpy(buf->mem, str.ptr, str.len);
+			const auto data = str_buffer_impl_data<Char>(buf);
+
+			memmove(data + str.len, data, sizeof(Char) * buf->stored);
+			memcpy(data, str.ptr, sizeof(Char) * str.len);
 			buf->stored += str.len;
-			buf->mem[buf->stored] = '\0';
+			data[buf->stored] = Char(0);
 			return true;
 		}
 
 		template<typename Char>
-		inline str_buffer_ctype_t<Char> *str_buffer_impl_create_allocator(const ham_allocator *allocator_, str_ctype_t<Char> str){
-			using ctype = str_buffer_ctype_t<Char>;
+		inline bool str_buffer_impl_set(str_buffer_ctype_t<Char> *buf, str_ctype_t<Char> str){
+			if(!buf) return false;
 
-			allocator<ctype> allocator(allocator_);
+			if(!str.ptr || !str.len){
+				str_buffer_impl_data<Char>(buf)[0] = Char(0);
+				buf->stored = 0;
+				return true;
+			}
 
-			const auto buf_mem = allocator.template allocate<ctype>(1);
-			if(!buf_mem) return nullptr;
+			// the old contents are about to be overwritten, so don't bother copying them over
+			buf->stored = 0;
 
-			const auto buf = allocator.template construct<ctype>(buf_mem);
-			if(!buf){
-				allocator.deallocate(buf_mem);
-				return nullptr;
+			if(!str_buffer_impl_reserve<Char>(buf, str.len)){
+				str_buffer_impl_data<Char>(buf)[0] = Char(0);
+				return false;
 			}
 
-			buf->allocator = allocator;
-			buf->mem = nullptr;
-			buf->capacity = 0;
-			buf->stored = 0;
+			const auto data = str_buffer_impl_data<Char>(buf);
 
-			if(str.ptr && str.len){
-				if(!str_buffer_ctype_reserve<Char>(buf, str.len)){
-					allocator.destroy(buf);
-					allocator.deallocate(buf_mem);
-					return nullptr;
-				}
+			// str may be a view into this buffer
+			memmove(data, str.ptr, sizeof(Char) * str.len);
+			data[str.len] = Char(0);
 
-				memcpy(buf->mem, str.ptr, str.len * sizeof(Char));
-				buf->mem[str.len] = '\0';
+			buf->stored = str.len;
 
-				buf->stored = str.len;
-			}
+			return true;
+		}
 
-			return buf;
+		template<typename Char>
+		inline bool str_buffer_impl_init_allocator(str_buffer_ctype_t<Char> *buf, const ham_allocator *allocator, str_ctype_t<Char> str){
+			if(!buf) return false;
+
+			str_buffer_impl_reset<Char>(buf, allocator ? allocator : ham_current_allocator());
+
+			return str_buffer_impl_set<Char>(buf, str);
 		}
 
 		template<typename Char>
-		inline void str_buffer_impl_destroy(str_buffer_ctype_t<Char> *buf){
+		inline void str_buffer_impl_finish(str_buffer_ctype_t<Char> *buf){
 			if(!buf) return;
 
-			const auto allocator = buf->allocator;
-
-			if(buf->mem){
-				allocator.deallocate(buf->mem, buf->capacity + 1);
+			if(!str_buffer_impl_is_inline<Char>(buf)){
+				ham_allocator_free(buf->allocator, buf->mem);
 			}
 
-			allocator.destroy(buf);
-			allocator.deallocate(buf);
+			str_buffer_impl_reset<Char>(buf, buf->allocator);
 		}
 
 		template<typename Char>
-		inline str_ctype_t<Char> str_buffer_impl_get(const str_buffer_ctype_t<Char> *buf){
-			if(buf) return { buf->mem, buf->stored };
-			else    return { nullptr,  0 };
-		}
+		inline str_buffer_ctype_t<Char> *str_buffer_impl_create_allocator(const ham_allocator *allocator_, str_ctype_t<Char> str){
+			using ctype = str_buffer_ctype_t<Char>;
 
-		template<typename Char>
-		inline bool str_buffer_impl_set(str_buffer_ctype_t<Char> *buf, str_ctype_t<Char> str){
-			if(!buf) return false;
+			const auto allocator = allocator_ ? allocator_ : ham_current_allocator();
 
-			if(!str.ptr || !str.len){
-				if(buf->mem) buf->mem[0] = '\0';
-				buf->stored = 0;
-				return true;
-			}
+			const auto buf = (ctype*)ham_allocator_alloc(allocator, alignof(ctype), sizeof(ctype));
+			if(!buf) return nullptr;
 
-			if(!str_buffer_impl_reserve<Char>(buf, str.len)){
-				return false;
+			if(!str_buffer_impl_init_allocator<Char>(buf, allocator, str)){
+				str_buffer_impl_finish<Char>(buf);
+				ham_allocator_free(allocator, buf);
+				return nullptr;
 			}
 
-			memcpy(buf->mem, str.ptr, str.len * sizeof(Char));
-			buf->mem[str.len] = Char(0);
+			return buf;
+		}
 
-			buf->stored = str.len;
+		template<typename Char>
+		inline void str_buffer_impl_destroy(str_buffer_ctype_t<Char> *buf){
+			if(!buf) return;
 
-			return true;
+			const auto allocator = buf->allocator;
+
+			str_buffer_impl_finish<Char>(buf);
+			ham_allocator_free(allocator, buf);
+		}
+
+		template<typename Char>
+		inline str_ctype_t<Char> str_buffer_impl_get(const str_buffer_ctype_t<Char> *buf){
+			if(buf) return { str_buffer_impl_data<Char>(buf), buf->stored };
+			else    return { nullptr,  0 };
 		}
 	}
 }
 
 HAM_C_API_BEGIN
 
-struct ham_str_buffer_utf8:  ham::detail::str_buffer_ctype_impl<ham_char8 >{};
-struct ham_str_buffer_utf16: ham::detail::str_buffer_ctype_impl<ham_char16>{};
-struct ham_str_buffer_utf32: ham::detail::str_buffer_ctype_impl<ham_char32>{};
+bool ham_str_buffer_init_allocator_utf8 (ham_str_buffer_utf8  *str_buf, const ham_allocator *allocator, ham_str8  str){ return ham::detail::str_buffer_impl_init_allocator<ham_char8> (str_buf, allocator, str); }
+bool ham_str_buffer_init_allocator_utf16(ham_str_buffer_utf16 *str_buf, const ham_allocator *allocator, ham_str16 str){ return ham::detail::str_buffer_impl_init_allocator<ham_char16>(str_buf, allocator, str); }
+bool ham_str_buffer_init_allocator_utf32(ham_str_buffer_utf32 *str_buf, const ham_allocator *allocator, ham_str32 str){ return ham::detail::str_buffer_impl_init_allocator<ham_char32>(str_buf, allocator, str); }
+
+void ham_str_buffer_finish_utf8 (ham_str_buffer_utf8  *str_buf){ ham::detail::str_buffer_impl_finish<ham_char8> (str_buf); }
+void ham_str_buffer_finish_utf16(ham_str_buffer_utf16 *str_buf){ ham::detail::str_buffer_impl_finish<ham_char16>(str_buf); }
+void ham_str_buffer_finish_utf32(ham_str_buffer_utf32 *str_buf){ ham::detail::str_buffer_impl_finish<ham_char32>(str_buf); }
 
 ham_str_buffer_utf8  *ham_str_buffer_create_allocator_utf8 (const ham_allocator *allocator, ham_str8 str) { return ham::detail::str_buffer_impl_create_allocator<ham_char8> (allocator, str); }
 ham_str_buffer_utf16 *ham_str_buffer_create_allocator_utf16(const ham_allocator *allocator, ham_str16 str){ return ham::detail::str_buffer_impl_create_allocator<ham_char16>(allocator, str); }
@@ -201,13 +240,13 @@ bool ham_str_buffer_prepend_utf8 (ham_str_buffer_utf8  *str_buf, ham_str8  str){
 bool ham_str_buffer_prepend_utf16(ham_str_buffer_utf16 *str_buf, ham_str16 str){ return ham::detail::str_buffer_impl_prepend<ham_char16>(str_buf, str); }
 bool ham_str_buffer_prepend_utf32(ham_str_buffer_utf32 *str_buf, ham_str32 str){ return ham::detail::str_buffer_impl_prepend<ham_char32>(str_buf, str); }
 
-ham_char8  *ham_str_buffer_ptr_utf8 (ham_str_buffer_utf8  *str_buf){ return str_buf ? str_buf->mem : nullptr; }
-ham_char16 *ham_str_buffer_ptr_utf16(ham_str_buffer_utf16 *str_buf){ return str_buf ? str_buf->mem : nullptr; }
-ham_char32 *ham_str_buffer_ptr_utf32(ham_str_buffer_utf32 *str_buf){ return str_buf ? str_buf->mem : nullptr; }
+ham_char8  *ham_str_buffer_ptr_utf8 (ham_str_buffer_utf8  *str_buf){ return str_buf ? ham::detail::str_buffer_impl_data<ham_char8> (str_buf) : nullptr; }
+ham_char16 *ham_str_buffer_ptr_utf16(ham_str_buffer_utf16 *str_buf){ return str_buf ? ham::detail::str_buffer_impl_data<ham_char16>(str_buf) : nullptr; }
+ham_char32 *ham_str_buffer_ptr_utf32(ham_str_buffer_utf32 *str_buf){ return str_buf ? ham::detail::str_buffer_impl_data<ham_char32>(str_buf) : nullptr; }
 
-const ham_char8  *ham_str_buffer_c_str_utf8 (const ham_str_buffer_utf8  *str_buf){ return str_buf ? str_buf->mem : nullptr; }
-const ham_char16 *ham_str_buffer_c_str_utf16(const ham_str_buffer_utf16 *str_buf){ return str_buf ? str_buf->mem : nullptr; }
-const ham_char32 *ham_str_buffer_c_str_utf32(const ham_str_buffer_utf32 *str_buf){ return str_buf ? str_buf->mem : nullptr; }
+const ham_char8  *ham_str_buffer_c_str_utf8 (const ham_str_buffer_utf8  *str_buf){ return str_buf ? ham::detail::str_buffer_impl_data<ham_char8> (str_buf) : nullptr; }
+const ham_char16 *ham_str_buffer_c_str_utf16(const ham_str_buffer_utf16 *str_buf){ return str_buf ? ham::detail::str_buffer_impl_data<ham_char16>(str_buf) : nullptr; }
+const ham_char32 *ham_str_buffer_c_str_utf32(const ham_str_buffer_utf32 *str_buf){ return str_buf ? ham::detail::str_buffer_impl_data<ham_char32>(str_buf) : nullptr; }
 
 ham_str8  ham_str_buffer_get_utf8 (const ham_str_buffer_utf8  *str_buf){ return ham::detail::str_buffer_impl_get<ham_char8> (str_buf); }
 ham_str16 ham_str_buffer_get_utf16(const ham_str_buffer_utf16 *str_buf){ return ham::detail::str_buffer_impl_get<ham_char16>(str_buf); }
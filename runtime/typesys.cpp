@@ -21,12 +21,18 @@
 #include "ham/check.h"
 #include "ham/buffer.h"
 #include "ham/colony.h"
+#include "ham/hash.h"
+#include "ham/intern.h"
+#include "ham/async.h"
 #include "ham/transform.h"
 
 #include "ham/std_vector.hpp"
 
 #include "robin_hood.h"
 
+#include <atomic>
+#include <bit>
+
 using namespace ham::typedefs;
 
 HAM_C_API_BEGIN
@@ -37,6 +43,8 @@ HAM_C_API_BEGIN
 #define HAM_METADATA(key, value) \
 	HAM_METADATA_IMPL(#key, value)
 
+struct ham_impl_type_program;
+
 struct ham_type{
 	const ham_typeset *ts;
 	const char *name, *metadata;
@@ -44,11 +52,18 @@ struct ham_type{
 	usize alignment, size;
 	const void *data;
 	uptr n0, n1;
+
+	//! Structural hash, equal types are always the same pointer within a typeset.
+	u64 hash;
+
+	//! Serialization program, compiled on first use. See `ham_impl_type_get_program`.
+	mutable std::atomic<const ham_impl_type_program*> program;
 };
 
 struct ham_type_member{
 	ham_str8 name;
 	const ham_type *type;
+	usize offset, padding;
 };
 
 struct ham_type_method{
@@ -62,14 +77,100 @@ struct ham_type_object{
 	const ham_type *super;
 	ham::std_vector<ham_type_member> members;
 	ham::std_vector<ham_type_method> methods;
+
+	//! Every non-object member reachable through `members`, nested objects expanded in place.
+	ham::std_vector<ham_type_field> fields;
+};
+
+//
+// Type index
+//
+// Lookups by name happen from every thread while new types are only ever added, so the
+// index is an insert-only open addressing table that readers probe without taking any lock.
+// Writers serialize on `ham_typeset::mut`, fill an entry completely and then publish it with a
+// release store into an empty slot. Growing copies every entry into a fresh table and publishes
+// that; old tables are kept alive until the typeset is destroyed as readers may still be probing them.
+//
+// Derived types (refs, vectors) are hash-consed through a second table of the same kind keyed on
+// their structure, so constructing one that already exists is a single probe and never builds a name.
+//
+
+struct ham_impl_typeset_entry{
+	ham_u64 hash;
+
+	// named entries
+	ham_symbol sym;
+
+	// structural entries
+	u32 flags;
+	const ham_type *operand;
+	usize n;
+
+	const ham_type *type;
+};
+
+using ham_impl_typeset_slot = std::atomic<const ham_impl_typeset_entry*>;
+
+static_assert(ham_impl_typeset_slot::is_always_lock_free);
+
+struct ham_impl_typeset_index{
+	usize mask;
+	ham_impl_typeset_slot *slots;
+};
+
+struct ham_impl_typeset_table{
+	std::atomic<const ham_impl_typeset_index*> index;
+	usize num_entries;
+};
+
+constexpr usize ham_impl_typeset_index_min_capacity = 128;
+
+//
+// Serialization programs
+//
+// Every serializable type gets flattened once into a list of ops over the object memory.
+// Adjacent scalar members are merged into a single copy so trivially copyable spans are one memcpy.
+//
+
+enum ham_impl_type_op_kind: u32{
+	HAM_IMPL_TYPE_OP_COPY, //!< `size` raw bytes at `offset`
+	HAM_IMPL_TYPE_OP_STR,  //!< length prefixed string at `offset` made of `size` byte code units
+};
+
+struct ham_impl_type_op{
+	ham_impl_type_op_kind kind;
+	usize offset, size;
+};
+
+struct ham_impl_type_program{
+	ham::basic_buffer<ham_impl_type_op> ops;
+
+	//! Encoded bytes written by all copy ops, strings excluded.
+	usize fixed_size;
+
+	//! Largest string code unit, the required alignment of encoded data.
+	usize str_alignment;
+
+	//! Object is a single copy op without padding, so arrays of them are copied in one go.
+	bool trivial;
+
+	//! Type can't be serialized, cached so the compile and its error aren't repeated on every call.
+	bool failed;
 };
 
 struct ham_typeset{
 	const ham_allocator *allocator;
-	mutable ham::colony<ham_type> types;
-	mutable robin_hood::unordered_flat_map<ham::str8, const ham_type*> type_map;
+	ham::colony<ham_type> types;
+
+	//! Guards every modification of the typeset, never taken by readers.
+	ham::mutex mut;
+
+	ham_impl_typeset_table names, derived;
+	ham::colony<ham_impl_typeset_entry> entries;
+	ham::std_vector<ham_impl_typeset_index*> indices;
 
-	ham::std_vector<ham::str_buffer8> interned;
+	//! Compiled serialization programs, published through `ham_type::program`.
+	ham::colony<ham_impl_type_program> programs;
 
 	robin_hood::unordered_node_map<ham::str8, ham_type_object> obj_types;
 
@@ -99,15 +200,170 @@ struct ham_typeset{
 	const ham_type *vec_types[3];
 };
 
+static inline ham::str8 ham_impl_typeset_intern(ham::str8 str_){
+	return ham_symbol_str(ham_intern(str_));
+}
+
+static inline ham_u64 ham_impl_typeset_hash(ham::str8 name){
+	return ham_str_hash_utf8(name);
+}
+
+static inline ham_u64 ham_impl_typeset_sym_hash(ham_symbol sym){
+	const u64 h = (u64)sym * 0x9E3779B97F4A7C15ull;
+	return h ^ (h >> 32);
+}
+
+static inline ham_u64 ham_impl_type_hash_mix(ham_u64 h, ham_u64 val){
+	return h ^ (val + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2));
+}
+
+static inline ham_u64 ham_impl_type_named_hash(u32 flags, ham::str8 name){
+	return ham_impl_type_hash_mix(ham_impl_typeset_hash(name), flags);
+}
+
+static inline ham_u64 ham_impl_type_derived_hash(u32 flags, const ham_type *operand, usize n){
+	return ham_impl_type_hash_mix(ham_impl_type_hash_mix(operand->hash, flags), n);
+}
+
+typedef bool(*ham_impl_typeset_entry_eq_fn)(const ham_impl_typeset_entry *entry, const ham_impl_typeset_entry *key);
+
+ham_nonnull_args(1, 2, 3)
+static inline const ham_type *ham_impl_typeset_table_find(const ham_impl_typeset_table *table, const ham_impl_typeset_entry *key, ham_impl_typeset_entry_eq_fn eq){
+	const auto index = table->index.load(std::memory_order_acquire);
+
+	// load factor is kept at or below 1/2 so there is always an empty slot to stop on
+	for(usize i = key->hash & index->mask;; i = (i + 1) & index->mask){
+		const auto entry = index->slots[i].load(std::memory_order_acquire);
+		if(!entry){
+			return nullptr;
+		}
+		else if(entry->hash == key->hash && eq(entry, key)){
+			return entry->type;
+		}
+	}
+}
+
+static inline bool ham_impl_typeset_entry_name_eq(const ham_impl_typeset_entry *entry, const ham_impl_typeset_entry *key){
+	return entry->sym == key->sym;
+}
+
+static inline bool ham_impl_typeset_entry_derived_eq(const ham_impl_typeset_entry *entry, const ham_impl_typeset_entry *key){
+	return entry->flags == key->flags && entry->operand == key->operand && entry->n == key->n;
+}
+
 ham_nonnull_args(1)
-static inline ham::str8 ham_typeset_intern_str(ham_typeset *ts, ham::str8 str_){
-	return ts->interned.emplace_back(str_);
+static inline const ham_type *ham_impl_typeset_find(const ham_typeset *ts, ham::str8 name){
+	// a string that was never interned can not name a type
+	const auto sym = ham_intern_find(name);
+	if(sym == HAM_SYMBOL_NULL) return nullptr;
+
+	const ham_impl_typeset_entry key{ ham_impl_typeset_sym_hash(sym), sym, 0, nullptr, 0, nullptr };
+	return ham_impl_typeset_table_find(&ts->names, &key, ham_impl_typeset_entry_name_eq);
+}
+
+ham_nonnull_args(1, 3)
+static inline const ham_type *ham_impl_typeset_find_derived(const ham_typeset *ts, u32 flags, const ham_type *operand, usize n){
+	const ham_impl_typeset_entry key{ ham_impl_type_derived_hash(flags, operand, n), HAM_SYMBOL_NULL, flags, operand, n, nullptr };
+	return ham_impl_typeset_table_find(&ts->derived, &key, ham_impl_typeset_entry_derived_eq);
+}
+
+ham_nonnull_args(1)
+static inline ham_impl_typeset_index *ham_impl_typeset_index_create(ham_typeset *ts, usize capacity){
+	const auto slots = (ham_impl_typeset_slot*)ham_allocator_alloc(ts->allocator, alignof(ham_impl_typeset_slot), capacity * sizeof(ham_impl_typeset_slot));
+	if(!slots) return nullptr;
+
+	for(usize i = 0; i < capacity; i++){
+		new(slots + i) ham_impl_typeset_slot(nullptr);
+	}
+
+	const auto ret = ham_allocator_new(ts->allocator, ham_impl_typeset_index);
+	if(!ret){
+		ham_allocator_free(ts->allocator, slots);
+		return nullptr;
+	}
+
+	ret->mask  = capacity - 1;
+	ret->slots = slots;
+
+	ts->indices.emplace_back(ret);
+
+	return ret;
+}
+
+ham_nonnull_args(1, 2)
+static inline void ham_impl_typeset_index_place(ham_impl_typeset_index *index, const ham_impl_typeset_entry *entry){
+	usize i = entry->hash & index->mask;
+	while(index->slots[i].load(std::memory_order_relaxed)){
+		i = (i + 1) & index->mask;
+	}
+
+	index->slots[i].store(entry, std::memory_order_release);
+}
+
+//! Caller must hold `ts->mut` and the type referenced by \p entry must be completely initialized.
+ham_nonnull_args(1, 2)
+static inline bool ham_impl_typeset_table_publish(ham_typeset *ts, ham_impl_typeset_table *table, const ham_impl_typeset_entry &entry){
+	auto index = const_cast<ham_impl_typeset_index*>(table->index.load(std::memory_order_relaxed));
+
+	if((table->num_entries + 1) * 2 > (index->mask + 1)){
+		const auto new_index = ham_impl_typeset_index_create(ts, (index->mask + 1) * 2);
+		if(!new_index){
+			ham::logapierror("Failed to grow typeset index");
+			return false;
+		}
+
+		for(usize i = 0; i <= index->mask; i++){
+			const auto old_entry = index->slots[i].load(std::memory_order_relaxed);
+			if(old_entry) ham_impl_typeset_index_place(new_index, old_entry);
+		}
+
+		table->index.store(new_index, std::memory_order_release);
+		index = new_index;
+	}
+
+	const auto new_entry = ts->entries.emplace(entry);
+	if(!new_entry){
+		ham::logapierror("Failed to allocate typeset index entry");
+		return false;
+	}
+
+	ham_impl_typeset_index_place(index, new_entry);
+	++table->num_entries;
+
+	return true;
+}
+
+//! Caller must hold `ts->mut` and \p type must be completely initialized.
+ham_nonnull_args(1, 3)
+static inline bool ham_impl_typeset_publish(ham_typeset *ts, ham::str8 name, const ham_type *type){
+	const auto sym = ham_intern(name);
+	if(sym == HAM_SYMBOL_NULL){
+		ham::logapierror("Failed to intern type name '{}'", name);
+		return false;
+	}
+
+	return ham_impl_typeset_table_publish(ts, &ts->names, ham_impl_typeset_entry{ ham_impl_typeset_sym_hash(sym), sym, 0, nullptr, 0, type });
+}
+
+//! Caller must hold `ts->mut` and \p type must be completely initialized with its derived hash.
+ham_nonnull_args(1, 3, 5)
+static inline bool ham_impl_typeset_publish_derived(ham_typeset *ts, u32 flags, const ham_type *operand, usize n, const ham_type *type){
+	return ham_impl_typeset_table_publish(ts, &ts->derived, ham_impl_typeset_entry{ type->hash, HAM_SYMBOL_NULL, flags, operand, n, type });
 }
 
 //
 // Type introspection
 //
 
+ham_constexpr static inline usize ham_impl_type_align_up(usize size, usize alignment){
+	return ((size + alignment - 1) / alignment) * alignment;
+}
+
+ham_nothrow ham_u64 ham_type_hash(const ham_type *type){
+	if(!ham_check(type != NULL)) return 0;
+	return type->hash;
+}
+
 ham_nothrow ham_u32 ham_type_get_flags(const ham_type *type){
 	if(!ham_check(type != NULL)) return (ham_u32)-1;
 	return type->flags;
@@ -153,19 +409,32 @@ ham_nothrow ham_usize ham_type_num_methods(const ham_type *type){
 	return type->n1;
 }
 
-ham_usize ham_type_members_iterate(const ham_type *type, ham_type_members_iterate_fn fn, void *user){
+ham_nothrow ham_usize ham_type_member_offset(const ham_type *type, ham_usize idx){
+	if(!ham_check(type != NULL) || !ham_check(ham_type_is_object(type)) || !ham_check(idx < type->n0)) return (ham_usize)-1;
+	return ((const ham_type_object*)type)->members[idx].offset;
+}
+
+ham_nothrow ham_usize ham_type_member_padding(const ham_type *type, ham_usize idx){
+	if(!ham_check(type != NULL) || !ham_check(ham_type_is_object(type)) || !ham_check(idx < type->n0)) return (ham_usize)-1;
+	return ((const ham_type_object*)type)->members[idx].padding;
+}
+
+ham_nothrow ham_usize ham_type_num_fields(const ham_type *type){
 	if(!ham_check(type != NULL) || !ham_check(ham_type_is_object(type))) return (ham_usize)-1;
+	return ((const ham_type_object*)type)->fields.size();
+}
 
-	if(fn && type->n0 != (ham_uptr)-1){
-		const auto &obj_type_map = type->ts->obj_types;
+ham_nothrow const ham_type_field *ham_type_fields(const ham_type *type){
+	if(!ham_check(type != NULL) || !ham_check(ham_type_is_object(type))) return nullptr;
+	return ((const ham_type_object*)type)->fields.data();
+}
 
-		const auto obj_res = obj_type_map.find(ham::str8(type->name));
-		if(obj_res == obj_type_map.end()){
-			ham::logapierror("Could not find object type within it's typeset");
-			return (ham_usize)-1;
-		}
+ham_usize ham_type_members_iterate(const ham_type *type, ham_type_members_iterate_fn fn, void *user){
+	if(!ham_check(type != NULL) || !ham_check(ham_type_is_object(type))) return (ham_usize)-1;
 
-		const auto &members = obj_res->second.members;
+	if(fn && type->n0 != (ham_uptr)-1){
+		// object types are immutable once published, no need to go through the typeset
+		const auto &members = ((const ham_type_object*)type)->members;
 
 		for(ham_usize i = 0; i < type->n0; i++){
 			if(!fn(i, members[i].name, members[i].type, user)){
@@ -181,15 +450,7 @@ ham_usize ham_type_methods_iterate(const ham_type *type, ham_type_methods_iterat
 	if(!ham_check(type != NULL) || !ham_check(ham_type_is_object(type))) return (ham_usize)-1;
 
 	if(fn && type->n1 != (ham_uptr)-1){
-		const auto &obj_type_map = type->ts->obj_types;
-
-		const auto obj_res = obj_type_map.find(ham::str8(type->name));
-		if(obj_res == obj_type_map.end()){
-			ham::logapierror("Could not find object type within it's typeset");
-			return (ham_usize)-1;
-		}
-
-		const auto &methods = obj_res->second.methods;
+		const auto &methods = ((const ham_type_object*)type)->methods;
 
 		for(ham_usize i = 0; i < type->n1; i++){
 			const auto &param_names = methods[i].param_names;
@@ -230,6 +491,8 @@ static inline const ham_type *ham_impl_type_reset(
 	type->data = data;
 	type->n0 = n0;
 	type->n1 = n1;
+	type->hash = ham_impl_type_named_hash(type->flags, name);
+	type->program.store(nullptr, std::memory_order_relaxed);
 	return type;
 }
 
@@ -248,8 +511,9 @@ static inline const ham_type *ham_impl_typeset_new_type(
 ){
 	const auto name_str = ham::str8(name);
 
-	const auto name_res = ts->type_map.find(name_str);
-	if(name_res != ts->type_map.end()){
+	ham::scoped_lock lock(ts->mut);
+
+	if(ham_impl_typeset_find(ts, name_str)){
 		ham::logapierror("Type by name '{}' already exists in typeset", name);
 		return nullptr;
 	}
@@ -257,8 +521,66 @@ static inline const ham_type *ham_impl_typeset_new_type(
 	const auto new_type = ts->types.emplace();
 	ham_impl_type_reset(new_type, ts, name, metadata, kind, info, alignment, size, data, n0, n1);
 
-	if(!ts->type_map.try_emplace(name_str, new_type).second){
-		ham::logapiwarn("Type by name '{}' could not be emplaced in typeset map", name);
+	if(!ham_impl_typeset_publish(ts, name_str, new_type)){
+		ham::logapiwarn("Type by name '{}' could not be added to the typeset index", name);
+	}
+
+	return new_type;
+}
+
+//! Make an existing type the structural instance of (\p kind, \p info, \p operand, \p n).
+ham_nonnull_args(1, 2, 5)
+static inline bool ham_impl_typeset_adopt_derived(ham_typeset *ts, const ham_type *type, ham_type_kind_flag kind, ham_type_info_flag info, const ham_type *operand, usize n){
+	const auto flags = ham_make_type_flags(kind, info);
+
+	ham::scoped_lock lock(ts->mut);
+
+	const auto mut_type = const_cast<ham_type*>(type);
+	mut_type->hash = ham_impl_type_derived_hash(flags, operand, n);
+
+	return ham_impl_typeset_publish_derived(ts, flags, operand, n, type);
+}
+
+//! Get or create the structural type (\p kind, \p info, \p operand, \p n), \p name is only used for new types.
+ham_nonnull_args(1, 5)
+static const ham_type *ham_impl_typeset_derive(
+	ham_typeset *ts,
+	ham_type_kind_flag kind,
+	ham_type_info_flag info,
+	ham::str8 name,
+	const ham_type *operand,
+	usize n,
+	usize alignment,
+	usize size
+){
+	const auto flags = ham_make_type_flags(kind, info);
+
+	ham::scoped_lock lock(ts->mut);
+
+	// somebody may have beaten us to it
+	const auto existing = ham_impl_typeset_find_derived(ts, flags, operand, n);
+	if(existing) return existing;
+
+	const auto type_name = ham_impl_typeset_intern(name);
+
+	const auto new_type = ts->types.emplace();
+	if(!new_type){
+		ham::logapierror("Failed to allocate type '{}'", type_name);
+		return nullptr;
+	}
+
+	ham_impl_type_reset(new_type, ts, type_name.ptr(), nullptr, kind, info, alignment, size, operand, n);
+	new_type->hash = ham_impl_type_derived_hash(flags, operand, n);
+
+	if(!ham_impl_typeset_publish_derived(ts, flags, operand, n, new_type)){
+		ham::logapierror("Failed to add type '{}' to typeset index", type_name);
+		ts->types.erase(new_type);
+		return nullptr;
+	}
+
+	// derived types are also reachable by name, unless that name was already taken
+	if(!ham_impl_typeset_find(ts, type_name) && !ham_impl_typeset_publish(ts, type_name, new_type)){
+		ham::logapiwarn("Type by name '{}' could not be added to the typeset index", type_name);
 	}
 
 	return new_type;
@@ -270,6 +592,17 @@ ham_typeset *ham_typeset_create_alloc(const ham_allocator *allocator){
 
 	ptr->allocator = allocator;
 
+	for(auto table : { &ptr->names, &ptr->derived }){
+		const auto index = ham_impl_typeset_index_create(ptr, ham_impl_typeset_index_min_capacity);
+		if(!index){
+			ham_typeset_destroy(ptr);
+			return nullptr;
+		}
+
+		table->num_entries = 0;
+		table->index.store(index, std::memory_order_release);
+	}
+
 	ptr->void_type   = ham_impl_typeset_new_type(ptr, "void", nullptr,       HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_VOID,    0, 0);
 	ptr->unit_type   = ham_impl_typeset_new_type(ptr, "ham_unit", nullptr,   HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_UNIT,    1, 1);
 	ptr->top_type    = ham_impl_typeset_new_type(ptr, "ham_top", nullptr,    HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_TOP,     0, 0);
@@ -289,7 +622,7 @@ ham_typeset *ham_typeset_create_alloc(const ham_allocator *allocator){
 	// int types
 	for(usize i = 0; i < std::size(ptr->int_types); i++){
 		const auto size = 1UL << i;
-		ptr->nat_types[i] = ham_impl_typeset_new_type(ptr, int_names[i], nullptr, HAM_TYPE_NUMERIC, HAM_TYPE_INFO_NUMERIC_INTEGER, size, size);
+		ptr->int_types[i] = ham_impl_typeset_new_type(ptr, int_names[i], nullptr, HAM_TYPE_NUMERIC, HAM_TYPE_INFO_NUMERIC_INTEGER, size, size);
 	}
 
 	constexpr const char *rat_names[] = { "ham_rat8", "ham_rat16", "ham_rat32", "ham_rat64", "ham_rat128", "ham_rat256" };
@@ -297,7 +630,7 @@ ham_typeset *ham_typeset_create_alloc(const ham_allocator *allocator){
 	// rat types
 	for(usize i = 0; i < std::size(ptr->rat_types); i++){
 		const auto size = 1UL << i;
-		ptr->nat_types[i] = ham_impl_typeset_new_type(ptr, rat_names[i], nullptr, HAM_TYPE_NUMERIC, HAM_TYPE_INFO_NUMERIC_RATIONAL, size, size);
+		ptr->rat_types[i] = ham_impl_typeset_new_type(ptr, rat_names[i], nullptr, HAM_TYPE_NUMERIC, HAM_TYPE_INFO_NUMERIC_RATIONAL, size, size);
 	}
 
 	constexpr const char *float_names[] = { "f16", "f32", "f64", "f128" };
@@ -338,7 +671,8 @@ ham_typeset *ham_typeset_create_alloc(const ham_allocator *allocator){
 	};
 
 	for(usize i = 0; i < std::size(vec_sizes); i++){
-		ptr->vec_types[i] = ham_impl_typeset_new_type(ptr, vec_names[i], nullptr, HAM_TYPE_NUMERIC, HAM_TYPE_INFO_NUMERIC_VECTOR, vec_aligns[i], vec_sizes[i]);
+		ptr->vec_types[i] = ham_impl_typeset_new_type(ptr, vec_names[i], nullptr, HAM_TYPE_NUMERIC, HAM_TYPE_INFO_NUMERIC_VECTOR, vec_aligns[i], vec_sizes[i], ptr->float_types[1], i + 2);
+		ham_impl_typeset_adopt_derived(ptr, ptr->vec_types[i], HAM_TYPE_NUMERIC, HAM_TYPE_INFO_NUMERIC_VECTOR, ptr->float_types[1], i + 2);
 	}
 
 	// Special C types
@@ -348,6 +682,7 @@ ham_typeset *ham_typeset_create_alloc(const ham_allocator *allocator){
 	const auto c_str_ty    = ham_impl_typeset_new_type(ptr, ham::meta::type_name_v<const char*>, "cref", HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF, alignof(void*), sizeof(void*));
 
 	const auto void_ptr_ty = ham_impl_typeset_new_type(ptr, ham::meta::type_name_v<void*>, nullptr, HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF, alignof(void*), sizeof(void*), ptr->void_type);
+	ham_impl_typeset_adopt_derived(ptr, void_ptr_ty, HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF, ptr->void_type, 0);
 
 	const auto usize_ty = [&]{
 		switch(sizeof(usize)){
@@ -386,6 +721,7 @@ ham_typeset *ham_typeset_create_alloc(const ham_allocator *allocator){
 	}
 
 	const auto allocator_ptr_ty = ham_impl_typeset_new_type(ptr, ham::meta::type_name_v<const ham_allocator*>, "cref", HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF, alignof(void*), sizeof(void*), allocator_ty);
+	ham_impl_typeset_adopt_derived(ptr, allocator_ptr_ty, HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF, allocator_ty, 0);
 
 	// Compound types
 
@@ -481,6 +817,7 @@ ham_typeset *ham_typeset_create_alloc(const ham_allocator *allocator){
 	}
 
 	const auto obj_info_ptr_ty = ham_impl_typeset_new_type(ptr, ham::meta::type_name_v<const ham_object_info*>, "cref", HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF, alignof(void*), sizeof(void*), obj_info_ty);
+	ham_impl_typeset_adopt_derived(ptr, obj_info_ptr_ty, HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF, obj_info_ty, 0);
 
 	const ham_type *vtable_ty = nullptr;
 
@@ -504,6 +841,7 @@ ham_typeset *ham_typeset_create_alloc(const ham_allocator *allocator){
 	}
 
 	const auto vtable_ptr_ty = ham_impl_typeset_new_type(ptr, ham::meta::type_name_v<const ham_object_vtable*>, "cref", HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF, alignof(void*), sizeof(void*), vtable_ty);
+	ham_impl_typeset_adopt_derived(ptr, vtable_ptr_ty, HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF, vtable_ty, 0);
 
 	const ham_type *obj_ty = nullptr;
 
@@ -530,18 +868,19 @@ ham_typeset *ham_typeset_create_alloc(const ham_allocator *allocator){
 void ham_typeset_destroy(ham_typeset *ts){
 	if(ham_unlikely(ts == NULL)) return;
 
-	ham_allocator_delete(ts->allocator, ts);
+	const auto allocator = ts->allocator;
+
+	for(const auto index : ts->indices){
+		ham_allocator_free(allocator, index->slots);
+		ham_allocator_delete(allocator, index);
+	}
+
+	ham_allocator_delete(allocator, ts);
 }
 
 ham_nothrow const ham_type *ham_typeset_get(const ham_typeset *ts, ham_str8 name){
 	if(!ham_check(ts != NULL)) return nullptr;
-
-	const auto res = ts->type_map.find(name);
-	if(res != ts->type_map.end()){
-		return res->second;
-	}
-
-	return nullptr;
+	return ham_impl_typeset_find(ts, name);
 }
 
 const ham_type *ham_typeset_void(const ham_typeset *ts){ return ts->void_type; }
@@ -624,22 +963,38 @@ const ham_type *ham_typeset_str(const ham_typeset *ts, ham_str_encoding encoding
 	}
 }
 
+const ham_type *ham_typeset_ref(const ham_typeset *ts, const ham_type *refed){
+	if(!ham_check(ts != NULL) || !ham_check(refed != NULL) || !ham_check(refed->ts == ts)) return nullptr;
+
+	constexpr auto flags = ham_make_type_flags(HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF);
+
+	const auto existing = ham_impl_typeset_find_derived(ts, flags, refed, 0);
+	if(existing) return existing;
+
+	// interning a derived type does not change the meaning of the typeset
+	return ham_impl_typeset_derive(
+		const_cast<ham_typeset*>(ts), HAM_TYPE_THEORETIC, HAM_TYPE_INFO_THEORETIC_REF,
+		ham::format("{}*", refed->name), refed, 0, alignof(void*), sizeof(void*)
+	);
+}
+
 const ham_type *ham_typeset_vec(const ham_typeset *ts, const ham_type *elem, ham_usize n){
-	if(elem != ts->float_types[1]){
-		ham_logapierrorf("Only vec2<f32> vec3<f32> and vec4<f32> currently supported");
-		return nullptr;
-	}
+	if(!ham_check(ts != NULL) || !ham_check(elem != NULL) || !ham_check(elem->ts == ts) || !ham_check(n > 0)) return nullptr;
 
-	switch(n){
-		case 8:  return ts->vec_types[0]; // vec2
-		case 12: return ts->vec_types[1]; // vec3
-		case 16: return ts->vec_types[2]; // vec4
+	constexpr auto flags = ham_make_type_flags(HAM_TYPE_NUMERIC, HAM_TYPE_INFO_NUMERIC_VECTOR);
 
-		default:{
-			ham_logapierrorf("Only vec2<f32> vec3<f32> and vec4<f32> currently supported");
-			return nullptr;
-		}
+	const auto existing = ham_impl_typeset_find_derived(ts, flags, elem, n);
+	if(existing) return existing;
+
+	if(ham_type_flags_kind(elem->flags) != HAM_TYPE_NUMERIC || ham_type_flags_info(elem->flags) == HAM_TYPE_INFO_NUMERIC_VECTOR){
+		ham::logapierror("Vector elements must be scalar numeric types, got '{}'", elem->name);
+		return nullptr;
 	}
+
+	return ham_impl_typeset_derive(
+		const_cast<ham_typeset*>(ts), HAM_TYPE_NUMERIC, HAM_TYPE_INFO_NUMERIC_VECTOR,
+		ham::format("ham_vec{}<{}>", n, elem->name), elem, n, elem->alignment, elem->size * n
+	);
 }
 
 const ham_type *ham_typeset_object(const ham_typeset *ts, ham_str8 name){
@@ -649,12 +1004,8 @@ const ham_type *ham_typeset_object(const ham_typeset *ts, ham_str8 name){
 		return ts->object_type;
 	}
 
-	const auto res = ts->obj_types.find(name);
-	if(res != ts->obj_types.end()){
-		return ham_super(&res->second);
-	}
-
-	return nullptr;
+	const auto type = ham_impl_typeset_find(ts, name);
+	return type && ham_type_is_object(type) ? type : nullptr;
 }
 
 //
@@ -723,13 +1074,15 @@ const ham_type *ham_type_builder_instantiate(ham_type_builder *builder, ham_type
 		return nullptr;
 	}
 
-	const auto existing = ham_typeset_get(ts, ham::str8((const char*)builder->name_buf));
+	ham::scoped_lock lock(ts->mut);
+
+	const auto existing = ham_impl_typeset_find(ts, ham::str8((const char*)builder->name_buf));
 	if(existing){
 		ham::logapierror("Typeset already contains type by name '{}'", ham::str8((const char*)builder->name_buf));
 		return nullptr;
 	}
 
-	const auto type_name = ham_typeset_intern_str(ts, (const char*)builder->name_buf);
+	const auto type_name = ham_impl_typeset_intern((const char*)builder->name_buf);
 
 	switch(builder->kind){
 		case HAM_TYPE_OBJECT:{
@@ -742,47 +1095,64 @@ const ham_type *ham_type_builder_instantiate(ham_type_builder *builder, ham_type
 			auto obj_type = &obj_emplace.first->second;
 			auto type = ham_super(obj_type);
 
-			const auto emplace_res = ts->type_map.try_emplace(type_name, type);
-			if(!emplace_res.second){
-				ham::logapierror("failed to emplace type '{}' in typeset type map");
-				ts->obj_types.erase(obj_emplace.first);
-				return nullptr;
-			}
-
 			type->ts        = ts;
-			type->name      = ham_typeset_intern_str(ts, type_name).ptr();
+			type->name      = type_name.ptr();
 			type->flags     = ham_make_type_flags(builder->kind, builder->info);
 			type->alignment = 1;
 			type->size      = 0;
-			type->data      = nullptr;
+			type->data      = builder->vptr;
 			type->n0        = builder->members.size();
 			type->n1        = builder->methods.size();
+			type->hash      = ham_impl_type_named_hash(type->flags, type_name);
+			type->program.store(nullptr, std::memory_order_relaxed);
 
 			obj_type->super = builder->parent;
 			obj_type->members.reserve(type->n0);
 			obj_type->methods.reserve(type->n1);
 
 			for(auto &&member : builder->members){
-				type->size += type->size % member.type->alignment;
+				const auto member_align = ham_max(member.type->alignment, (usize)1);
+				const auto member_offset = ham_impl_type_align_up(type->size, member_align);
 
-				type->alignment = ham_max(type->alignment, member.type->alignment);
+				if(!obj_type->members.empty()){
+					obj_type->members.back().padding = member_offset - type->size;
+				}
 
-				type->size += member.type->size;
+				type->alignment = ham_max(type->alignment, member_align);
 
 				auto &new_member = obj_type->members.emplace_back();
 
-				new_member.name = ham_typeset_intern_str(ts, member.name);
-				new_member.type = member.type;
+				new_member.name    = ham_impl_typeset_intern(member.name);
+				new_member.type    = member.type;
+				new_member.offset  = member_offset;
+				new_member.padding = 0;
+
+				if(ham_type_is_object(member.type)){
+					for(auto &&field : ((const ham_type_object*)member.type)->fields){
+						obj_type->fields.emplace_back(ham_type_field{ field.type, member_offset + field.offset });
+					}
+				}
+				else{
+					obj_type->fields.emplace_back(ham_type_field{ member.type, member_offset });
+				}
+
+				type->size = member_offset + member.type->size;
 			}
 
-			if(type->size){
-				type->size += (type->size % type->alignment);
+			{
+				const auto unpadded_size = type->size;
+
+				type->size = ham_impl_type_align_up(type->size, type->alignment);
+
+				if(!obj_type->members.empty()){
+					obj_type->members.back().padding = type->size - unpadded_size;
+				}
 			}
 
 			for(auto &&method : builder->methods){
 				auto &new_method = obj_type->methods.emplace_back();
 
-				new_method.name = ham_typeset_intern_str(ts, method.name);
+				new_method.name = ham_impl_typeset_intern(method.name);
 				new_method.param_types = method.param_types;
 
 				const auto num_params = method.param_types.size();
@@ -790,10 +1160,17 @@ const ham_type *ham_type_builder_instantiate(ham_type_builder *builder, ham_type
 				new_method.param_names.resize(num_params);
 
 				for(usize i = 0; i < num_params; i++){
-					new_method.param_names[i] = ham_typeset_intern_str(ts, method.param_names[i]);
+					new_method.param_names[i] = ham_impl_typeset_intern(method.param_names[i]);
 				}
 			}
 
+			// only visible to other threads once every field above is written
+			if(!ham_impl_typeset_publish(ts, type_name, type)){
+				ham::logapierror("Failed to add type '{}' to typeset index", type_name);
+				ts->obj_types.erase(obj_emplace.first);
+				return nullptr;
+			}
+
 			builder->instance = type;
 
 			return type;
@@ -945,4 +1322,339 @@ bool ham_type_builder_add_method(ham_type_builder *builder, ham_str8 name, ham_u
 	return true;
 }
 
+//
+// Serialization
+//
+
+static_assert(std::endian::native == std::endian::little, "Serialized types are little-endian, big-endian hosts need byte swapping");
+
+//! Caller must hold `ts->mut`.
+ham_nonnull_args(1, 2)
+static bool ham_impl_type_program_emit(ham_impl_type_program *prog, const ham_type *type, usize offset){
+	const auto kind = ham_type_flags_kind(type->flags);
+	const auto info = ham_type_flags_info(type->flags);
+
+	switch(kind){
+		case HAM_TYPE_NUMERIC:{
+			if(type->size == 0) return true;
+
+			const auto num_ops = prog->ops.size();
+			if(num_ops){
+				auto &last = prog->ops[num_ops - 1];
+				if(last.kind == HAM_IMPL_TYPE_OP_COPY && (last.offset + last.size) == offset){
+					last.size += type->size;
+					prog->fixed_size += type->size;
+					return true;
+				}
+			}
+
+			prog->ops.emplace_back(ham_impl_type_op{ HAM_IMPL_TYPE_OP_COPY, offset, type->size });
+			prog->fixed_size += type->size;
+			return true;
+		}
+
+		case HAM_TYPE_STRING:{
+			usize unit_size;
+			switch(info){
+				case HAM_TYPE_INFO_STRING_UTF8:  unit_size = sizeof(ham_char8); break;
+				case HAM_TYPE_INFO_STRING_UTF16: unit_size = sizeof(ham_char16); break;
+				case HAM_TYPE_INFO_STRING_UTF32: unit_size = sizeof(ham_char32); break;
+
+				default:{
+					ham::logapierror("Unrecognized string type '{}'", type->name);
+					return false;
+				}
+			}
+
+			prog->ops.emplace_back(ham_impl_type_op{ HAM_IMPL_TYPE_OP_STR, offset, unit_size });
+			prog->str_alignment = ham_max(prog->str_alignment, unit_size);
+			return true;
+		}
+
+		case HAM_TYPE_OBJECT:{
+			// already flattened at instantiation
+			for(auto &&field : ((const ham_type_object*)type)->fields){
+				if(!ham_impl_type_program_emit(prog, field.type, offset + field.offset)){
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		case HAM_TYPE_THEORETIC:{
+			// no state to encode
+			if(info == HAM_TYPE_INFO_THEORETIC_VOID || info == HAM_TYPE_INFO_THEORETIC_UNIT){
+				return true;
+			}
+
+			ham::logapierror("Type '{}' is a reference and can not be serialized", type->name);
+			return false;
+		}
+
+		default:{
+			ham::logapierror("Type '{}' can not be serialized", type->name);
+			return false;
+		}
+	}
+}
+
+ham_nonnull_args(1)
+static const ham_impl_type_program *ham_impl_type_get_program(const ham_type *type){
+	const auto cached = type->program.load(std::memory_order_acquire);
+	if(cached) return cached->failed ? nullptr : cached;
+
+	// programs are a cache, so compiling one does not count as modifying the typeset
+	const auto ts = const_cast<ham_typeset*>(type->ts);
+
+	ham::scoped_lock lock(ts->mut);
+
+	const auto raced = type->program.load(std::memory_order_relaxed);
+	if(raced) return raced->failed ? nullptr : raced;
+
+	const auto prog = ts->programs.emplace();
+	if(!prog){
+		ham::logapierror("Failed to allocate serialization program for type '{}'", type->name);
+		return nullptr;
+	}
+
+	prog->fixed_size = 0;
+	prog->str_alignment = 1;
+	prog->trivial = false;
+	prog->failed = false;
+
+	if(!ham_impl_type_program_emit(prog, type, 0)){
+		// types are immutable, so it would only fail again
+		(void)prog->ops.resize(0);
+		prog->failed = true;
+		type->program.store(prog, std::memory_order_release);
+		return nullptr;
+	}
+
+	prog->trivial =
+		prog->fixed_size == type->size &&
+		(prog->ops.empty() || (prog->ops.size() == 1 && prog->ops[0].kind == HAM_IMPL_TYPE_OP_COPY));
+
+	type->program.store(prog, std::memory_order_release);
+	return prog;
+}
+
+static inline usize ham_impl_varint_size(u64 val){
+	usize n = 1;
+	while(val >= 0x80){
+		val >>= 7;
+		++n;
+	}
+	return n;
+}
+
+static inline char *ham_impl_varint_write(char *it, u64 val){
+	while(val >= 0x80){
+		*it++ = (char)((val & 0x7F) | 0x80);
+		val >>= 7;
+	}
+
+	*it++ = (char)val;
+	return it;
+}
+
+//! Returns `nullptr` on truncated or overlong input.
+static inline const char *ham_impl_varint_read(const char *it, const char *end, u64 *ret){
+	u64 val = 0;
+
+	for(u32 shift = 0; shift < 64; shift += 7){
+		if(it == end) return nullptr;
+
+		const auto byte = (u8)*it++;
+		val |= (u64)(byte & 0x7F) << shift;
+
+		if(!(byte & 0x80)){
+			*ret = val;
+			return it;
+		}
+	}
+
+	return nullptr;
+}
+
+bool ham_type_is_serializable(const ham_type *type){
+	if(!ham_check(type != NULL)) return false;
+	return !!ham_impl_type_get_program(type);
+}
+
+ham_usize ham_type_serialize(const ham_type *type, ham_usize num_objs, const void *objs, ham_buffer *out){
+	if(
+		!ham_check(type != NULL) ||
+		!ham_check(num_objs == 0 || objs != NULL) ||
+		!ham_check(out != NULL && out->mem != NULL)
+	){
+		return (usize)-1;
+	}
+
+	const auto prog = ham_impl_type_get_program(type);
+	if(!prog) return (usize)-1;
+
+	const usize start = out->allocated;
+
+	if(num_objs == 0) return 0;
+
+	if(prog->trivial){
+		const usize num_bytes = num_objs * type->size;
+
+		if(!ham_buffer_resize(out, start + num_bytes)){
+			ham::logapierror("Failed to resize output buffer");
+			return (usize)-1;
+		}
+
+		memcpy((char*)out->mem + start, objs, num_bytes);
+		return num_bytes;
+	}
+
+	// enough for everything but strings
+	const usize min_size = start + (num_objs * prog->fixed_size);
+	if(min_size && !ham_buffer_reserve(out, min_size)){
+		ham::logapierror("Failed to reserve output buffer");
+		return (usize)-1;
+	}
+
+	const auto ops     = prog->ops.data();
+	const auto num_ops = prog->ops.size();
+
+	for(usize i = 0; i < num_objs; i++){
+		const auto obj = (const char*)objs + (i * type->size);
+
+		for(usize j = 0; j < num_ops; j++){
+			const auto &op = ops[j];
+			const auto field = obj + op.offset;
+
+			const usize pos = out->allocated;
+
+			switch(op.kind){
+				case HAM_IMPL_TYPE_OP_COPY:{
+					if(!ham_buffer_resize(out, pos + op.size)){
+						ham::logapierror("Failed to resize output buffer");
+						return (usize)-1;
+					}
+
+					memcpy((char*)out->mem + pos, field, op.size);
+					break;
+				}
+
+				case HAM_IMPL_TYPE_OP_STR:{
+					// every string type is laid out as { ptr, len }
+					ham_str8 str;
+					memcpy(&str, field, sizeof(str));
+
+					const usize num_bytes = str.len * op.size;
+					const usize len_size  = ham_impl_varint_size(str.len);
+
+					// keep wide code units aligned relative to the start of the encoding
+					const usize data_pos = ham_impl_type_align_up(pos + len_size - start, op.size) + start;
+					const usize pad = data_pos - (pos + len_size);
+
+					if(!ham_buffer_resize(out, data_pos + num_bytes)){
+						ham::logapierror("Failed to resize output buffer");
+						return (usize)-1;
+					}
+
+					const auto it = ham_impl_varint_write((char*)out->mem + pos, str.len);
+					memset(it, 0, pad);
+
+					if(num_bytes) memcpy((char*)out->mem + data_pos, str.ptr, num_bytes);
+					break;
+				}
+			}
+		}
+	}
+
+	return out->allocated - start;
+}
+
+ham_usize ham_type_deserialize(const ham_type *type, ham_usize num_objs, void *objs, ham_usize len, const void *data){
+	if(
+		!ham_check(type != NULL) ||
+		!ham_check(num_objs == 0 || objs != NULL) ||
+		!ham_check(len == 0 || data != NULL)
+	){
+		return (usize)-1;
+	}
+
+	const auto prog = ham_impl_type_get_program(type);
+	if(!prog) return (usize)-1;
+
+	if(num_objs == 0) return 0;
+
+	if(prog->trivial){
+		const usize num_bytes = num_objs * type->size;
+
+		if(len < num_bytes){
+			ham::logapierror("Not enough data for {} objects of type '{}': {} bytes, expected {}", num_objs, type->name, len, num_bytes);
+			return (usize)-1;
+		}
+
+		memcpy(objs, data, num_bytes);
+		return num_bytes;
+	}
+
+	if(((uptr)data % prog->str_alignment) != 0){
+		ham::logapierror("Data for type '{}' must be aligned to {} bytes", type->name, prog->str_alignment);
+		return (usize)-1;
+	}
+
+	const auto beg = (const char*)data;
+	const auto end = beg + len;
+
+	const auto ops     = prog->ops.data();
+	const auto num_ops = prog->ops.size();
+
+	const char *it = beg;
+
+	for(usize i = 0; i < num_objs; i++){
+		const auto obj = (char*)objs + (i * type->size);
+
+		for(usize j = 0; j < num_ops; j++){
+			const auto &op = ops[j];
+			const auto field = obj + op.offset;
+
+			switch(op.kind){
+				case HAM_IMPL_TYPE_OP_COPY:{
+					if((usize)(end - it) < op.size){
+						ham::logapierror("Unexpected end of data for type '{}'", type->name);
+						return (usize)-1;
+					}
+
+					memcpy(field, it, op.size);
+					it += op.size;
+					break;
+				}
+
+				case HAM_IMPL_TYPE_OP_STR:{
+					u64 str_len;
+					it = ham_impl_varint_read(it, end, &str_len);
+					if(!it){
+						ham::logapierror("Invalid string length for type '{}'", type->name);
+						return (usize)-1;
+					}
+
+					const usize data_pos = ham_impl_type_align_up((usize)(it - beg), op.size);
+
+					if(data_pos > len || str_len > ((len - data_pos) / op.size)){
+						ham::logapierror("Unexpected end of data for type '{}'", type->name);
+						return (usize)-1;
+					}
+
+					// strings reference the encoded data directly
+					const ham_str8 str{ beg + data_pos, (uptr)str_len };
+					memcpy(field, &str, sizeof(str));
+
+					it = beg + data_pos + (str_len * op.size);
+					break;
+				}
+			}
+		}
+	}
+
+	return (usize)(it - beg);
+}
+
 HAM_C_API_END
@@ -0,0 +1,698 @@
+/*
+ * Ham Runtime
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/typedefs.h"
+
+// SSE2 is part of the x86-64 baseline, wider kernels are picked at run-time
+#if defined(__x86_64__) && defined(__GNUC__)
+#	include <immintrin.h>
+#	define HAM_UTF_X86 1
+#endif
+
+using namespace ham::typedefs;
+
+namespace ham{
+	namespace detail{
+		//
+		// Scalar kernels
+		//
+
+		static inline bool utf8_is_cont(u8 b) noexcept{ return (b & 0xC0) == 0x80; }
+
+		//! Decode a single code point, returns the number of bytes consumed or 0 if the sequence is ill-formed.
+		static inline usize utf8_decode(const u8 *s, usize n, utf_cp *cp) noexcept{
+			const u8 b0 = s[0];
+
+			if(b0 < 0x80){
+				*cp = b0;
+				return 1;
+			}
+			else if(b0 < 0xC2){
+				// stray continuation or overlong 2 byte lead
+				return 0;
+			}
+			else if(b0 < 0xE0){
+				if(n < 2 || !utf8_is_cont(s[1])) return 0;
+				*cp = ((b0 & 0x1Fu) << 6) | (s[1] & 0x3Fu);
+				return 2;
+			}
+			else if(b0 < 0xF0){
+				if(n < 3 || !utf8_is_cont(s[1]) || !utf8_is_cont(s[2])) return 0;
+				else if(b0 == 0xE0 && s[1] < 0xA0) return 0; // overlong
+				else if(b0 == 0xED && s[1] >= 0xA0) return 0; // surrogate
+
+				*cp = ((b0 & 0x0Fu) << 12) | ((s[1] & 0x3Fu) << 6) | (s[2] & 0x3Fu);
+				return 3;
+			}
+			else if(b0 < 0xF5){
+				if(n < 4 || !utf8_is_cont(s[1]) || !utf8_is_cont(s[2]) || !utf8_is_cont(s[3])) return 0;
+				else if(b0 == 0xF0 && s[1] < 0x90) return 0; // overlong
+				else if(b0 == 0xF4 && s[1] >= 0x90) return 0; // past U+10FFFF
+
+				*cp = ((b0 & 0x07u) << 18) | ((s[1] & 0x3Fu) << 12) | ((s[2] & 0x3Fu) << 6) | (s[3] & 0x3Fu);
+				return 4;
+			}
+			else{
+				return 0;
+			}
+		}
+
+		static inline usize utf8_num_bytes(utf_cp cp) noexcept{
+			if(cp < 0x80) return 1;
+			else if(cp < 0x800) return 2;
+			else if(cp < 0x10000) return 3;
+			else return 4;
+		}
+
+		//! `cp` must be a valid scalar value.
+		static inline usize utf8_encode(utf_cp cp, char8 *out) noexcept{
+			if(cp < 0x80){
+				out[0] = (char8)cp;
+				return 1;
+			}
+			else if(cp < 0x800){
+				out[0] = (char8)(0xC0 | (cp >> 6));
+				out[1] = (char8)(0x80 | (cp & 0x3F));
+				return 2;
+			}
+			else if(cp < 0x10000){
+				out[0] = (char8)(0xE0 | (cp >> 12));
+				out[1] = (char8)(0x80 | ((cp >> 6) & 0x3F));
+				out[2] = (char8)(0x80 | (cp & 0x3F));
+				return 3;
+			}
+			else{
+				out[0] = (char8)(0xF0 | (cp >> 18));
+				out[1] = (char8)(0x80 | ((cp >> 12) & 0x3F));
+				out[2] = (char8)(0x80 | ((cp >> 6) & 0x3F));
+				out[3] = (char8)(0x80 | (cp & 0x3F));
+				return 4;
+			}
+		}
+
+		static inline bool utf_is_scalar_value(utf_cp cp) noexcept{
+			return cp <= 0x10FFFF && (cp < 0xD800 || cp > 0xDFFF);
+		}
+
+		//! Number of leading ASCII bytes in `s`.
+		static inline usize utf8_ascii_prefix(const u8 *s, usize n) noexcept{
+			usize i = 0;
+
+		#ifdef HAM_UTF_X86
+			for(; i + 16 <= n; i += 16){
+				const int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i)));
+				if(mask) return i + (usize)__builtin_ctz((unsigned)mask);
+			}
+		#endif
+
+			for(; i + 8 <= n; i += 8){
+				u64 word;
+				memcpy(&word, s + i, sizeof(word));
+				if(word & 0x8080808080808080ull) break;
+			}
+
+			while(i < n && s[i] < 0x80) ++i;
+			return i;
+		}
+
+		static bool utf8_validate_scalar(const u8 *s, usize n) noexcept{
+			usize i = 0;
+
+			while(i < n){
+				if(s[i] < 0x80){
+					i += utf8_ascii_prefix(s + i, n - i);
+					continue;
+				}
+
+				utf_cp cp;
+				const usize len = utf8_decode(s + i, n - i, &cp);
+				if(!len) return false;
+
+				i += len;
+			}
+
+			return true;
+		}
+
+		/**
+		 * Where the vector kernels hand the remainder of a string to `utf8_validate_scalar`.
+		 * Backs up to the lead byte of a sequence that may run past `i` so the scalar path sees all of it.
+		 */
+		static inline usize utf8_tail_start(const u8 *s, usize i) noexcept{
+			for(usize k = 1; k <= 3 && k <= i; k++){
+				const u8 b = s[i - k];
+				if(b >= 0xC0) return i - k;
+				else if(b < 0x80) break;
+			}
+
+			return i;
+		}
+
+	#ifdef HAM_UTF_X86
+
+		//
+		// Vectorised UTF-8 validation
+		//
+		// Classifies every byte pair with three nibble lookups, so each block is checked without branching on its contents.
+		// See "Validating UTF-8 In Less Than One Instruction Per Byte" (Keiser, Lemire 2021).
+		//
+
+		namespace utf8_err{
+			constexpr u8 too_short      = 1 << 0; // 11______ 0_______ or 11______ 11______
+			constexpr u8 too_long       = 1 << 1; // 0_______ 10______
+			constexpr u8 overlong_3     = 1 << 2; // 11100000 100_____
+			constexpr u8 too_large      = 1 << 3; // 11110100 1001____ or 11110100 101_____ or 11110101+ ________
+			constexpr u8 surrogate      = 1 << 4; // 11101101 101_____
+			constexpr u8 overlong_2     = 1 << 5; // 1100000_ 10______
+			constexpr u8 too_large_1000 = 1 << 6; // 11110101+ 1000____
+			constexpr u8 overlong_4     = 1 << 6; // 11110000 1000____
+			constexpr u8 two_conts      = 1 << 7; // 10______ 10______
+			constexpr u8 carry          = too_short | too_long | two_conts;
+		}
+
+		alignas(16) static constexpr u8 utf8_byte_1_high[16] = {
+			// 0_______ ASCII
+			utf8_err::too_long, utf8_err::too_long, utf8_err::too_long, utf8_err::too_long,
+			utf8_err::too_long, utf8_err::too_long, utf8_err::too_long, utf8_err::too_long,
+			// 10______ continuation
+			utf8_err::two_conts, utf8_err::two_conts, utf8_err::two_conts, utf8_err::two_conts,
+			// 1100____ 2 byte lead
+			utf8_err::too_short | utf8_err::overlong_2,
+			// 1101____ 2 byte lead
+			utf8_err::too_short,
+			// 1110____ 3 byte lead
+			utf8_err::too_short | utf8_err::overlong_3 | utf8_err::surrogate,
+			// 1111____ 4 byte lead
+			utf8_err::too_short | utf8_err::too_large | utf8_err::too_large_1000 | utf8_err::overlong_4,
+		};
+
+		alignas(16) static constexpr u8 utf8_byte_1_low[16] = {
+			// ____0000
+			utf8_err::carry | utf8_err::overlong_3 | utf8_err::overlong_2 | utf8_err::overlong_4,
+			// ____0001
+			utf8_err::carry | utf8_err::overlong_2,
+			// ____001_
+			utf8_err::carry,
+			utf8_err::carry,
+			// ____0100
+			utf8_err::carry | utf8_err::too_large,
+			// ____0101 to ____1100
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+			// ____1101
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000 | utf8_err::surrogate,
+			// ____111_
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+			utf8_err::carry | utf8_err::too_large | utf8_err::too_large_1000,
+		};
+
+		alignas(16) static constexpr u8 utf8_byte_2_high[16] = {
+			// ________ 0_______ ASCII
+			utf8_err::too_short, utf8_err::too_short, utf8_err::too_short, utf8_err::too_short,
+			utf8_err::too_short, utf8_err::too_short, utf8_err::too_short, utf8_err::too_short,
+			// ________ 1000____
+			utf8_err::too_long | utf8_err::overlong_2 | utf8_err::two_conts | utf8_err::overlong_3 | utf8_err::too_large_1000 | utf8_err::overlong_4,
+			// ________ 1001____
+			utf8_err::too_long | utf8_err::overlong_2 | utf8_err::two_conts | utf8_err::overlong_3 | utf8_err::too_large,
+			// ________ 101_____
+			utf8_err::too_long | utf8_err::overlong_2 | utf8_err::two_conts | utf8_err::surrogate | utf8_err::too_large,
+			utf8_err::too_long | utf8_err::overlong_2 | utf8_err::two_conts | utf8_err::surrogate | utf8_err::too_large,
+			// ________ 11______
+			utf8_err::too_short, utf8_err::too_short, utf8_err::too_short, utf8_err::too_short,
+		};
+
+		__attribute__((target("ssse3")))
+		static bool utf8_validate_ssse3(const u8 *s, usize n) noexcept{
+			const __m128i byte_1_high = _mm_load_si128((const __m128i*)utf8_byte_1_high);
+			const __m128i byte_1_low  = _mm_load_si128((const __m128i*)utf8_byte_1_low);
+			const __m128i byte_2_high = _mm_load_si128((const __m128i*)utf8_byte_2_high);
+
+			const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+			const __m128i third_min   = _mm_set1_epi8((char)(0xE0 - 0x80));
+			const __m128i fourth_min  = _mm_set1_epi8((char)(0xF0 - 0x80));
+			const __m128i high_bit    = _mm_set1_epi8((char)0x80);
+
+			// anything at or above these in the last 3 bytes still expects continuation bytes
+			const __m128i incomplete_max = _mm_setr_epi8(
+				-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+				(char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1)
+			);
+
+			__m128i err = _mm_setzero_si128();
+			__m128i prev_input = _mm_setzero_si128();
+			__m128i prev_incomplete = _mm_setzero_si128();
+
+			usize i = 0;
+			for(; i + 16 <= n; i += 16){
+				const __m128i input = _mm_loadu_si128((const __m128i*)(s + i));
+
+				if(!_mm_movemask_epi8(input)){
+					err = _mm_or_si128(err, prev_incomplete);
+					prev_incomplete = _mm_setzero_si128();
+					prev_input = input;
+					continue;
+				}
+
+				const __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+				const __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+				const __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+
+				const __m128i special = _mm_and_si128(
+					_mm_and_si128(
+						_mm_shuffle_epi8(byte_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble_mask)),
+						_mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, nibble_mask))
+					),
+					_mm_shuffle_epi8(byte_2_high, _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask))
+				);
+
+				const __m128i must_23 = _mm_and_si128(
+					_mm_or_si128(_mm_subs_epu8(prev2, third_min), _mm_subs_epu8(prev3, fourth_min)),
+					high_bit
+				);
+
+				err = _mm_or_si128(err, _mm_xor_si128(must_23, special));
+				prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+				prev_input = input;
+			}
+
+			if(_mm_movemask_epi8(_mm_cmpeq_epi8(err, _mm_setzero_si128())) != 0xFFFF){
+				return false;
+			}
+
+			const usize tail = utf8_tail_start(s, i);
+			return utf8_validate_scalar(s + tail, n - tail);
+		}
+
+		__attribute__((target("avx2")))
+		static bool utf8_validate_avx2(const u8 *s, usize n) noexcept{
+			const __m256i byte_1_high = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)utf8_byte_1_high));
+			const __m256i byte_1_low  = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)utf8_byte_1_low));
+			const __m256i byte_2_high = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)utf8_byte_2_high));
+
+			const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+			const __m256i third_min   = _mm256_set1_epi8((char)(0xE0 - 0x80));
+			const __m256i fourth_min  = _mm256_set1_epi8((char)(0xF0 - 0x80));
+			const __m256i high_bit    = _mm256_set1_epi8((char)0x80);
+
+			const __m256i incomplete_max = _mm256_setr_epi8(
+				-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+				-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+				(char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1)
+			);
+
+			__m256i err = _mm256_setzero_si256();
+			__m256i prev_input = _mm256_setzero_si256();
+			__m256i prev_incomplete = _mm256_setzero_si256();
+
+			usize i = 0;
+			for(; i + 32 <= n; i += 32){
+				const __m256i input = _mm256_loadu_si256((const __m256i*)(s + i));
+
+				if(!_mm256_movemask_epi8(input)){
+					err = _mm256_or_si256(err, prev_incomplete);
+					prev_incomplete = _mm256_setzero_si256();
+					prev_input = input;
+					continue;
+				}
+
+				// alignr works per 128-bit lane, so line the previous bytes up across the lane boundary first
+				const __m256i straddle = _mm256_permute2x128_si256(prev_input, input, 0x21);
+				const __m256i prev1 = _mm256_alignr_epi8(input, straddle, 15);
+				const __m256i prev2 = _mm256_alignr_epi8(input, straddle, 14);
+				const __m256i prev3 = _mm256_alignr_epi8(input, straddle, 13);
+
+				const __m256i special = _mm256_and_si256(
+					_mm256_and_si256(
+						_mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble_mask)),
+						_mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble_mask))
+					),
+					_mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble_mask))
+				);
+
+				const __m256i must_23 = _mm256_and_si256(
+					_mm256_or_si256(_mm256_subs_epu8(prev2, third_min), _mm256_subs_epu8(prev3, fourth_min)),
+					high_bit
+				);
+
+				err = _mm256_or_si256(err, _mm256_xor_si256(must_23, special));
+				prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+				prev_input = input;
+			}
+
+			if(!_mm256_testz_si256(err, err)){
+				return false;
+			}
+
+			const usize tail = utf8_tail_start(s, i);
+			return utf8_validate_scalar(s + tail, n - tail);
+		}
+
+	#endif // HAM_UTF_X86
+
+		using utf8_validate_fn = bool(*)(const u8*, usize) noexcept;
+
+		static utf8_validate_fn utf8_validate_kernel() noexcept{
+		#ifdef HAM_UTF_X86
+			__builtin_cpu_init();
+
+			if(__builtin_cpu_supports("avx2")) return utf8_validate_avx2;
+			else if(__builtin_cpu_supports("ssse3")) return utf8_validate_ssse3;
+		#endif
+
+			return utf8_validate_scalar;
+		}
+	}
+}
+
+using namespace ham::detail;
+
+HAM_C_API_BEGIN
+
+//
+// Validation
+//
+
+bool ham_str_validate_utf8(ham_str8 str){
+	if(!str.ptr || !str.len) return true;
+
+	static const auto kernel = utf8_validate_kernel();
+	return kernel((const u8*)str.ptr, str.len);
+}
+
+bool ham_impl_str_validate_utf8_kernel(ham_u32 kernel, ham_str8 str, bool *ret){
+	utf8_validate_fn fn = nullptr;
+
+#ifdef HAM_UTF_X86
+	__builtin_cpu_init();
+#endif
+
+	switch(kernel){
+		case HAM_IMPL_UTF8_KERNEL_SCALAR: fn = utf8_validate_scalar; break;
+
+	#ifdef HAM_UTF_X86
+		case HAM_IMPL_UTF8_KERNEL_SSSE3: if(__builtin_cpu_supports("ssse3")) fn = utf8_validate_ssse3; break;
+		case HAM_IMPL_UTF8_KERNEL_AVX2:  if(__builtin_cpu_supports("avx2"))  fn = utf8_validate_avx2;  break;
+	#endif
+
+		default: break;
+	}
+
+	if(!fn) return false;
+
+	*ret = !str.ptr || !str.len || fn((const u8*)str.ptr, str.len);
+	return true;
+}
+
+bool ham_str_validate_utf16(ham_str16 str){
+	if(!str.ptr || !str.len) return true;
+
+	const usize n = str.len;
+	usize i = 0;
+
+	while(i < n){
+	#ifdef HAM_UTF_X86
+		// skip over blocks without any surrogates
+		while(i + 8 <= n){
+			const __m128i units = _mm_loadu_si128((const __m128i*)(str.ptr + i));
+			const __m128i is_surrogate = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16((short)0xF800)), _mm_set1_epi16((short)0xD800));
+			if(_mm_movemask_epi8(is_surrogate)) break;
+			i += 8;
+		}
+
+		if(i == n) break;
+	#endif
+
+		const ham_char16 unit = str.ptr[i];
+
+		if(unit < 0xD800 || unit > 0xDFFF){
+			++i;
+		}
+		else if(unit <= 0xDBFF && (i + 1) < n && str.ptr[i + 1] >= 0xDC00 && str.ptr[i + 1] <= 0xDFFF){
+			i += 2;
+		}
+		else{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ham_str_validate_utf32(ham_str32 str){
+	if(!str.ptr || !str.len) return true;
+
+	const usize n = str.len;
+	usize i = 0;
+
+#ifdef HAM_UTF_X86
+	const __m128i surrogate_mask = _mm_set1_epi32((int)0xFFFFF800);
+	const __m128i surrogate_min  = _mm_set1_epi32(0xD800);
+	const __m128i plane_max      = _mm_set1_epi32(0x10);
+
+	__m128i err = _mm_setzero_si128();
+
+	for(; i + 4 <= n; i += 4){
+		const __m128i cps = _mm_loadu_si128((const __m128i*)(str.ptr + i));
+		err = _mm_or_si128(err, _mm_cmpgt_epi32(_mm_srli_epi32(cps, 16), plane_max));
+		err = _mm_or_si128(err, _mm_cmpeq_epi32(_mm_and_si128(cps, surrogate_mask), surrogate_min));
+	}
+
+	if(_mm_movemask_epi8(err)) return false;
+#endif
+
+	for(; i < n; i++){
+		if(!utf_is_scalar_value(str.ptr[i])) return false;
+	}
+
+	return true;
+}
+
+//
+// Conversion
+//
+
+ham_usize ham_str_conv_utf8_utf16(ham_str8 str, ham_char16 *buf, ham_usize buf_len){
+	if(!buf || buf_len == 0){
+		return (usize)-1;
+	}
+	else if(!str.ptr || !str.len){
+		buf[0] = u'\0';
+		return 0;
+	}
+
+	const auto s = (const u8*)str.ptr;
+	const usize n = str.len;
+
+	usize i = 0, written = 0;
+
+	while(i < n){
+	#ifdef HAM_UTF_X86
+		// widen ASCII runs 16 bytes at a time
+		while(i + 16 <= n && written + 16 < buf_len){
+			const __m128i bytes = _mm_loadu_si128((const __m128i*)(s + i));
+			if(_mm_movemask_epi8(bytes)) break;
+
+			const __m128i zero = _mm_setzero_si128();
+			_mm_storeu_si128((__m128i*)(buf + written),     _mm_unpacklo_epi8(bytes, zero));
+			_mm_storeu_si128((__m128i*)(buf + written + 8), _mm_unpackhi_epi8(bytes, zero));
+
+			i += 16;
+			written += 16;
+		}
+
+		if(i == n) break;
+	#endif
+
+		utf_cp cp;
+		const usize len = utf8_decode(s + i, n - i, &cp);
+		if(!len) return (usize)-1;
+
+		if(cp < 0x10000){
+			if(written + 1 >= buf_len) return (usize)-1;
+			buf[written++] = (ham_char16)cp;
+		}
+		else{
+			if(written + 2 >= buf_len) return (usize)-1;
+
+			cp -= 0x10000;
+			buf[written++] = (ham_char16)(0xD800 | (cp >> 10));
+			buf[written++] = (ham_char16)(0xDC00 | (cp & 0x3FF));
+		}
+
+		i += len;
+	}
+
+	buf[written] = u'\0';
+	return written;
+}
+
+ham_usize ham_str_conv_utf8_utf32(ham_str8 str, ham_char32 *buf, ham_usize buf_len){
+	if(!buf || buf_len == 0){
+		return (usize)-1;
+	}
+	else if(!str.ptr || !str.len){
+		buf[0] = U'\0';
+		return 0;
+	}
+
+	const auto s = (const u8*)str.ptr;
+	const usize n = str.len;
+
+	usize i = 0, written = 0;
+
+	while(i < n){
+	#ifdef HAM_UTF_X86
+		while(i + 16 <= n && written + 16 < buf_len){
+			const __m128i bytes = _mm_loadu_si128((const __m128i*)(s + i));
+			if(_mm_movemask_epi8(bytes)) break;
+
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+			const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+
+			_mm_storeu_si128((__m128i*)(buf + written),      _mm_unpacklo_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*)(buf + written + 4),  _mm_unpackhi_epi16(lo, zero));
+			_mm_storeu_si128((__m128i*)(buf + written + 8),  _mm_unpacklo_epi16(hi, zero));
+			_mm_storeu_si128((__m128i*)(buf + written + 12), _mm_unpackhi_epi16(hi, zero));
+
+			i += 16;
+			written += 16;
+		}
+
+		if(i == n) break;
+	#endif
+
+		if(written + 1 >= buf_len) return (usize)-1;
+
+		utf_cp cp;
+		const usize len = utf8_decode(s + i, n - i, &cp);
+		if(!len) return (usize)-1;
+
+		buf[written++] = cp;
+		i += len;
+	}
+
+	buf[written] = U'\0';
+	return written;
+}
+
+ham_usize ham_str_conv_utf16_utf8(ham_str16 str, ham_char8 *buf, ham_usize buf_len){
+	if(!buf || buf_len == 0){
+		return (usize)-1;
+	}
+	else if(!str.ptr || !str.len){
+		buf[0] = '\0';
+		return 0;
+	}
+
+	const usize n = str.len;
+
+	usize i = 0, written = 0;
+
+	while(i < n){
+	#ifdef HAM_UTF_X86
+		// narrow ASCII runs 8 units at a time
+		while(i + 8 <= n && written + 8 < buf_len){
+			const __m128i units = _mm_loadu_si128((const __m128i*)(str.ptr + i));
+			const __m128i is_ascii = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16((short)0xFF80)), _mm_setzero_si128());
+			if(_mm_movemask_epi8(is_ascii) != 0xFFFF) break;
+
+			_mm_storel_epi64((__m128i*)(buf + written), _mm_packus_epi16(units, units));
+
+			i += 8;
+			written += 8;
+		}
+
+		if(i == n) break;
+	#endif
+
+		utf_cp cp = str.ptr[i];
+		usize len = 1;
+
+		if(cp >= 0xD800 && cp <= 0xDFFF){
+			if(cp > 0xDBFF || (i + 1) >= n) return (usize)-1;
+
+			const utf_cp lo = str.ptr[i + 1];
+			if(lo < 0xDC00 || lo > 0xDFFF) return (usize)-1;
+
+			cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+			len = 2;
+		}
+
+		if(written + utf8_num_bytes(cp) >= buf_len) return (usize)-1;
+
+		written += utf8_encode(cp, buf + written);
+		i += len;
+	}
+
+	buf[written] = '\0';
+	return written;
+}
+
+ham_usize ham_str_conv_utf32_utf8(ham_str32 str, ham_char8 *buf, ham_usize buf_len){
+	if(!buf || buf_len == 0){
+		return (usize)-1;
+	}
+	else if(!str.ptr || !str.len){
+		buf[0] = '\0';
+		return 0;
+	}
+
+	const usize n = str.len;
+
+	usize i = 0, written = 0;
+
+	while(i < n){
+	#ifdef HAM_UTF_X86
+		while(i + 8 <= n && written + 8 < buf_len){
+			const __m128i cps0 = _mm_loadu_si128((const __m128i*)(str.ptr + i));
+			const __m128i cps1 = _mm_loadu_si128((const __m128i*)(str.ptr + i + 4));
+
+			const __m128i non_ascii = _mm_and_si128(_mm_or_si128(cps0, cps1), _mm_set1_epi32((int)0xFFFFFF80));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(non_ascii, _mm_setzero_si128())) != 0xFFFF) break;
+
+			const __m128i units = _mm_packs_epi32(cps0, cps1);
+			_mm_storel_epi64((__m128i*)(buf + written), _mm_packus_epi16(units, units));
+
+			i += 8;
+			written += 8;
+		}
+
+		if(i == n) break;
+	#endif
+
+		const utf_cp cp = str.ptr[i];
+		if(!utf_is_scalar_value(cp)) return (usize)-1;
+
+		if(written + utf8_num_bytes(cp) >= buf_len) return (usize)-1;
+
+		written += utf8_encode(cp, buf + written);
+		++i;
+	}
+
+	buf[written] = '\0';
+	return written;
+}
+
+HAM_C_API_END
@@ -41,6 +41,17 @@ int main(int argc, char *argv[]){
 		{"transform",  ham_test_transform, check_true},
 		{"camera",     ham_test_camera,    check_true},
 		{"typesys",    ham_test_typesys,   check_true},
+		{"intern",     ham_test_intern,    check_true},
+		{"hash",       ham_test_hash,      check_true},
+		{"flat_map",   ham_test_flat_map,  check_true},
+		{"str_buffer", ham_test_str_buffer, check_true},
+		{"log",        ham_test_log,        check_true},
+		{"fs",         ham_test_fs,         check_true},
+		{"plugin",     ham_test_plugin,     check_true},
+#ifdef HAM_TEST_ENGINE
+		{"world",      ham_test_world,      check_true},
+		{"model",      ham_test_model,      check_true},
+#endif
 	};
 
 	constexpr usize num_tests = std::size(tests);
@@ -0,0 +1,61 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "test-plugin.h"
+
+static bool ham_test_plugin_on_load(){ return true; }
+static void ham_test_plugin_on_unload(){}
+
+HAM_PLUGIN(
+	ham_test_plugin,
+	HAM_TEST_PLUGIN_UUID,
+	HAM_TEST_PLUGIN_NAME,
+	((ham_version){ 0, 1, HAM_TEST_PLUGIN_VARIANT }),
+	"Test Plugin",
+	"Keith Hammond",
+	"GPLv3+",
+	"test",
+	"Plugin loaded by the runtime tests",
+	ham_test_plugin_on_load,
+	ham_test_plugin_on_unload
+)
+
+static ham_test_plugin_counter *ham_test_plugin_counter_ctor(ham_test_plugin_counter *mem, ham_u32 nargs, va_list va){
+	(void)nargs; (void)va;
+	mem->value = 0;
+#if HAM_TEST_PLUGIN_VARIANT == 2
+	mem->extra = 0;
+#endif
+	return mem;
+}
+
+static void ham_test_plugin_counter_dtor(ham_test_plugin_counter *self){ (void)self; }
+
+static ham_i32 ham_test_plugin_counter_step(ham_test_plugin_counter *self){
+	return self->value += HAM_TEST_PLUGIN_STEP(HAM_TEST_PLUGIN_VARIANT);
+}
+
+ham_define_object(
+	ham_test_plugin_counter,
+	ham_test_plugin_counter_vtable,
+	ham_test_plugin_counter_ctor,
+	ham_test_plugin_counter_dtor,
+	(
+		.step = ham_test_plugin_counter_step,
+	)
+)
@@ -0,0 +1,57 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAM_TEST_PLUGIN_TEST_PLUGIN_H
+#define HAM_TEST_PLUGIN_TEST_PLUGIN_H 1
+
+#include "ham/plugin.h"
+
+//! Name of the test plugin, with spaces to check they survive the manifest cache.
+#define HAM_TEST_PLUGIN_NAME "ham test plugin"
+#define HAM_TEST_PLUGIN_UUID "7b3c5e0a-2f4d-4c61-9a8e-6d1f0b2c4e57"
+
+/**
+ * Which build of the test plugin this is, so reloading can be tested:
+ * 0 is the original, 1 a rebuild with new code and 2 a rebuild whose object layout changed.
+ */
+#ifndef HAM_TEST_PLUGIN_VARIANT
+#	define HAM_TEST_PLUGIN_VARIANT 0
+#endif
+
+//! How much each build steps a counter by.
+#define HAM_TEST_PLUGIN_STEP(variant) ((variant) == 1 ? 10 : 1)
+
+HAM_C_API_BEGIN
+
+typedef struct ham_test_plugin_counter{
+	ham_derive(ham_object)
+	ham_i32 value;
+#if HAM_TEST_PLUGIN_VARIANT == 2
+	ham_i64 extra;
+#endif
+} ham_test_plugin_counter;
+
+typedef struct ham_test_plugin_counter_vtable{
+	ham_derive(ham_object_vtable)
+
+	ham_i32(*step)(ham_test_plugin_counter *self);
+} ham_test_plugin_counter_vtable;
+
+HAM_C_API_END
+
+#endif // !HAM_TEST_PLUGIN_TEST_PLUGIN_H
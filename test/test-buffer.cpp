@@ -61,6 +61,31 @@ bool ham_test_buffer(){
 		}
 	}
 
+	// growth and middle insertion test
+	{
+		ham::basic_buffer<int> test_buf;
+
+		constexpr int num_vals = 4096;
+
+		for(int i = 0; i < num_vals; i++){
+			if(!test_buf.insert(test_buf.size(), i * 2)){
+				std::cerr << "Insert error on " << i << "'th value\n";
+				return false;
+			}
+		}
+
+		for(int i = 0; i < num_vals; i++){
+			test_buf.insert((usize)(i * 2) + 1, (i * 2) + 1);
+		}
+
+		for(int i = 0; i < (int)test_buf.size(); i++){
+			if(test_buf[i] != i){
+				std::cerr << "Growth error on " << i << "'th value: expected " << i << ", got " << test_buf[i] << '\n';
+				return false;
+			}
+		}
+	}
+
 	// copy constructor test
 	{
 		ham::basic_buffer<int> test0 = { 1, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5 };
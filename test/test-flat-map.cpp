@@ -0,0 +1,181 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/flat_map.hpp"
+#include "ham/str_buffer.h"
+
+#include "tests.hpp"
+
+using namespace ham::typedefs;
+
+namespace {
+	struct counting_allocator_state{
+		usize num_allocs = 0, num_frees = 0;
+	};
+
+	void *counting_alloc(usize alignment, usize size, void *user){
+		++((counting_allocator_state*)user)->num_allocs;
+		return ham_allocator_alloc(&ham_impl_default_allocator, alignment, size);
+	}
+
+	void counting_free(void *mem, void *user){
+		++((counting_allocator_state*)user)->num_frees;
+		ham_allocator_free(&ham_impl_default_allocator, mem);
+	}
+
+	// tracks live instances to check every value gets destroyed exactly once
+	struct tracked{
+		static inline iptr num_live = 0;
+
+		tracked(u32 val_ = 0) noexcept: val(val_){ ++num_live; }
+		tracked(const tracked &other) noexcept: val(other.val){ ++num_live; }
+		tracked(tracked &&other) noexcept: val(other.val){ ++num_live; }
+		~tracked(){ --num_live; }
+
+		tracked &operator=(const tracked&) noexcept = default;
+
+		u32 val;
+	};
+}
+
+bool ham_test_flat_map(){
+	constexpr u32 num_keys = 10000;
+
+	// integer keys through growth, erasure and reinsertion
+	{
+		ham::flat_map<u32, u32> map;
+
+		ham_test_assert(map.empty());
+		ham_test_assert(map.find(0u) == map.end());
+		ham_test_assert(map.begin() == map.end());
+
+		for(u32 i = 0; i < num_keys; i++){
+			ham_test_assert(map.try_emplace(i, i * 3).second);
+		}
+
+		ham_test_assert(map.size() == num_keys);
+		ham_test_assert(!map.try_emplace(7u, 0u).second);
+
+		for(u32 i = 0; i < num_keys; i++){
+			const auto val = map.get(i);
+			ham_test_assert(val && *val == i * 3);
+		}
+
+		for(u32 i = 0; i < num_keys; i += 2){
+			ham_test_assert(map.erase(i));
+		}
+
+		ham_test_assert(!map.erase(0u));
+		ham_test_assert(map.size() == num_keys / 2);
+
+		for(u32 i = 0; i < num_keys; i++){
+			ham_test_assert(map.contains(i) == ((i % 2) == 1));
+		}
+
+		u64 key_sum = 0;
+		usize num_iterated = 0;
+
+		for(const auto &[key, val] : map){
+			ham_test_assert(val == key * 3);
+			key_sum += key;
+			++num_iterated;
+		}
+
+		ham_test_assert(num_iterated == map.size());
+		ham_test_assert(key_sum == u64(num_keys / 2) * u64(num_keys / 2));
+
+		for(auto it = map.begin(); it != map.end();){
+			if(it->first % 4 == 1) it = map.erase(it);
+			else ++it;
+		}
+
+		ham_test_assert(map.size() == num_keys / 4);
+		ham_test_assert(!map.contains(1u) && map.contains(3u));
+
+		map[1u] = 42;
+		ham_test_assert(*map.get(1u) == 42);
+		ham_test_assert(!map.insert_or_assign(1u, 43u).second && map[1u] == 43);
+	}
+
+	// churn at a fixed size recycles tombstones instead of growing forever
+	{
+		ham::flat_map<u32, u32> map;
+		map.reserve(64);
+
+		const auto initial_cap = map.capacity();
+
+		for(u32 i = 0; i < 100000; i++){
+			map.try_emplace(i, i);
+			if(i >= 32) ham_test_assert(map.erase(i - 32));
+		}
+
+		ham_test_assert(map.size() == 32);
+		ham_test_assert(map.capacity() == initial_cap);
+	}
+
+	// string keys with heterogeneous lookup
+	{
+		ham::flat_map<ham::str_buffer8, u32> map;
+
+		for(u32 i = 0; i < 1000; i++){
+			map.try_emplace(ham::format("ham_test_flat_map_{}", i), i);
+		}
+
+		const auto key = ham::format("ham_test_flat_map_{}", 123);
+
+		ham_test_assert(map.contains(ham::str8(key)));
+		ham_test_assert(map.contains(key));
+		ham_test_assert(map.contains("ham_test_flat_map_999"));
+		ham_test_assert(!map.contains("ham_test_flat_map_1000"));
+		ham_test_assert(*map.get(ham::str8("ham_test_flat_map_456")) == 456);
+	}
+
+	// storage comes from the given allocator and values are destroyed exactly once
+	{
+		counting_allocator_state state;
+		const ham_allocator allocator{ counting_alloc, counting_free, &state };
+
+		{
+			ham::flat_map<u32, tracked> map(&allocator);
+			ham_test_assert(map.allocator() == &allocator);
+
+			for(u32 i = 0; i < 1000; i++){
+				map.try_emplace(i, i);
+			}
+
+			ham_test_assert(state.num_allocs > 0);
+			ham_test_assert(tracked::num_live == 1000);
+
+			auto copy = map;
+			ham_test_assert(copy.size() == map.size() && copy.get(500u)->val == 500);
+			ham_test_assert(tracked::num_live == 2000);
+
+			auto moved = std::move(copy);
+			ham_test_assert(copy.empty() && moved.size() == 1000);
+
+			moved.clear();
+			ham_test_assert(moved.empty() && !moved.contains(1u));
+			ham_test_assert(tracked::num_live == 1000);
+		}
+
+		ham_test_assert(tracked::num_live == 0);
+		ham_test_assert(state.num_allocs == state.num_frees);
+	}
+
+	return true;
+}
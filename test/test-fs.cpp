@@ -0,0 +1,742 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/fs.h"
+#include "ham/async.h"
+#include "ham/compress.h"
+#include "ham/intern.h"
+
+#include "tests.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace ham::typedefs;
+
+namespace {
+	constexpr u32 test_num_assets = 256;
+	constexpr u32 test_asset_size = 4096;
+
+	inline u8 asset_byte(u32 asset_idx, u32 off){ return (u8)((asset_idx * 31 + off * 7) ^ (off >> 8)); }
+
+	std::string asset_path(const std::filesystem::path &dir, u32 idx){
+		return (dir / ("asset-" + std::to_string(idx) + ".bin")).string();
+	}
+
+	bool check_asset(u32 asset_idx, const u8 *data){
+		for(u32 i = 0; i < test_asset_size; i++){
+			if(data[i] != asset_byte(asset_idx, i)) return false;
+		}
+
+		return true;
+	}
+
+	//! Read every asset through `io`, using registered buffers if `registered`.
+	bool load_assets_async(ham::file_io &io, const std::filesystem::path &dir, std::vector<u8> &arena, bool registered){
+		std::vector<ham_file*> files(test_num_assets);
+
+		for(u32 i = 0; i < test_num_assets; i++){
+			files[i] = ham_file_open_utf8(ham::str8(asset_path(dir, i).c_str()), HAM_OPEN_READ);
+			if(!files[i]) return false;
+		}
+
+		std::vector<ham_file_io_request> reqs(test_num_assets);
+
+		for(u32 i = 0; i < test_num_assets; i++){
+			reqs[i] = (ham_file_io_request){
+				.op = HAM_FILE_IO_READ,
+				.file = files[i],
+				.buf = arena.data() + (usize)i * test_asset_size,
+				// ask for more than there is to see the short read at the end of the file
+				.len = i == 0 ? test_asset_size * 2 : test_asset_size,
+				.buf_index = registered ? 0 : HAM_FILE_IO_NO_BUFFER,
+				.off = 0,
+				.user = (void*)(uptr)i,
+			};
+		}
+
+		// the first request would overrun the arena when registered
+		if(registered) reqs[0].len = test_asset_size;
+
+		u32 num_submitted = 0, num_completed = 0;
+		bool ok = true;
+
+		ham_file_io_result results[64];
+
+		while(num_completed < test_num_assets){
+			if(num_submitted < test_num_assets){
+				const u32 res = io.submit(test_num_assets - num_submitted, reqs.data() + num_submitted);
+				if(res == (u32)-1) return false;
+				num_submitted += res;
+			}
+
+			const u32 num = io.complete(1, (u32)std::size(results), results);
+			if(num == (u32)-1) return false;
+
+			for(u32 i = 0; i < num; i++){
+				if(results[i].res != (isize)test_asset_size) ok = false;
+			}
+
+			num_completed += num;
+		}
+
+		for(auto file : files) ham_file_close(file);
+
+		return ok && io.num_pending() == 0;
+	}
+
+	bool load_assets_sync(const std::filesystem::path &dir, std::vector<u8> &arena){
+		for(u32 i = 0; i < test_num_assets; i++){
+			const auto file = ham_file_open_utf8(ham::str8(asset_path(dir, i).c_str()), HAM_OPEN_READ);
+			if(!file) return false;
+
+			const usize res = ham_file_read(file, arena.data() + (usize)i * test_asset_size, test_asset_size);
+			ham_file_close(file);
+
+			if(res != test_asset_size) return false;
+		}
+
+		return true;
+	}
+
+	bool lz4_round_trip(const std::vector<u8> &data){
+		std::vector<u8> compressed(ham_lz4_compress_bound(data.size()));
+
+		const usize compressed_len = ham_lz4_compress(data.size(), data.data(), compressed.size(), compressed.data());
+		if(!compressed_len) return false;
+
+		std::vector<u8> decompressed(data.size());
+		if(ham_lz4_decompress(compressed_len, compressed.data(), decompressed.size(), decompressed.data()) != data.size()) return false;
+
+		return decompressed == data;
+	}
+
+	std::string test_config_text(){
+		std::string ret;
+		for(u32 i = 0; i < 128; i++){
+			ret += "{ \"name\": \"entity-" + std::to_string(i) + "\", \"mesh\": \"meshes/crate.obj\", \"scale\": 1.0 },\n";
+		}
+		return ret;
+	}
+
+	struct watch_event{
+		ham_fs_watch_event_kind kind;
+		std::string path;
+	};
+
+	//! Poll `watch` until `num_wanted` events arrived or `timeout` passed, paths are copied before the next poll.
+	std::vector<watch_event> collect_watch_events(ham::fs_watch &watch, usize num_wanted, std::chrono::milliseconds timeout = std::chrono::seconds(1)){
+		std::vector<watch_event> events;
+
+		const auto give_up = std::chrono::steady_clock::now() + timeout;
+
+		while(events.size() < num_wanted && std::chrono::steady_clock::now() < give_up){
+			ham_fs_watch_event batch[16];
+			const u32 num = watch.poll((u32)std::size(batch), batch);
+
+			for(u32 i = 0; i < num; i++){
+				// null-terminated like every other path handed out
+				if(batch[i].path.ptr[batch[i].path.len] != '\0') return {};
+				events.push_back({ batch[i].kind, std::string(batch[i].path.ptr, batch[i].path.len) });
+			}
+
+			if(!num) usleep(1000);
+		}
+
+		return events;
+	}
+
+	bool has_watch_event(const std::vector<watch_event> &events, ham_fs_watch_event_kind kind, const std::string &path){
+		return std::any_of(events.begin(), events.end(), [&](const watch_event &ev){
+			return ev.kind == kind && ev.path == path;
+		});
+	}
+}
+
+bool ham_test_fs(){
+	const auto dir = std::filesystem::temp_directory_path() / ("ham-test-fs-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+
+	// asynchronous writes
+	{
+		ham::file_io io(16);
+		ham_test_assert(io);
+
+		std::vector<u8> data(test_asset_size);
+		std::vector<ham_file*> files(test_num_assets);
+		std::vector<ham_file_io_request> reqs;
+
+		for(u32 i = 0; i < test_num_assets; i++){
+			files[i] = ham_file_open_utf8(ham::str8(asset_path(dir, i).c_str()), HAM_OPEN_WRITE | HAM_OPEN_CREATE);
+			ham_test_assert(files[i]);
+		}
+
+		// every asset has different contents, so write them a page at a time from a scratch buffer per asset
+		std::vector<std::vector<u8>> contents(test_num_assets, std::vector<u8>(test_asset_size));
+
+		for(u32 i = 0; i < test_num_assets; i++){
+			for(u32 j = 0; j < test_asset_size; j++){
+				contents[i][j] = asset_byte(i, j);
+			}
+
+			reqs.push_back((ham_file_io_request){
+				.op = HAM_FILE_IO_WRITE,
+				.file = files[i],
+				.buf = contents[i].data(),
+				.len = test_asset_size,
+				.buf_index = HAM_FILE_IO_NO_BUFFER,
+				.off = 0,
+				.user = nullptr,
+			});
+		}
+
+		u32 num_submitted = 0, num_completed = 0;
+		ham_file_io_result results[16];
+
+		while(num_completed < test_num_assets){
+			const u32 res = io.submit(test_num_assets - num_submitted, reqs.data() + num_submitted);
+			ham_test_assert(res != (u32)-1);
+			ham_test_assert(io.num_pending() <= 16);
+			num_submitted += res;
+
+			const u32 num = io.complete(1, (u32)std::size(results), results);
+			ham_test_assert(num != (u32)-1 && num > 0);
+
+			for(u32 i = 0; i < num; i++){
+				ham_test_assert(results[i].res == (isize)test_asset_size);
+			}
+
+			num_completed += num;
+		}
+
+		for(auto file : files) ham_file_close(file);
+	}
+
+	std::vector<u8> arena((usize)test_num_assets * test_asset_size);
+
+	ham_test_assert(load_assets_sync(dir, arena));
+
+	for(u32 i = 0; i < test_num_assets; i++){
+		ham_test_assert(check_asset(i, arena.data() + (usize)i * test_asset_size));
+	}
+
+	// both backends, with and without registered buffers
+	for(const u32 flags : { 0u, (u32)HAM_FILE_IO_FORCE_THREADS }){
+		ham::file_io io(HAM_FILE_IO_DEFAULT_QUEUE_DEPTH, flags);
+		ham_test_assert(io);
+
+		if(flags & HAM_FILE_IO_FORCE_THREADS){
+			ham_test_assert(io.backend() == ham::file_io_backend::threads);
+		}
+
+		for(const bool registered : { false, true }){
+			std::fill(arena.begin(), arena.end(), 0);
+
+			if(registered){
+				void *const buf = arena.data();
+				const usize len = arena.size();
+				ham_test_assert(io.register_buffers(1, &buf, &len));
+			}
+
+			ham_test_assert(load_assets_async(io, dir, arena, registered));
+
+			for(u32 i = 0; i < test_num_assets; i++){
+				ham_test_assert(check_asset(i, arena.data() + (usize)i * test_asset_size));
+			}
+		}
+
+		ham_test_assert(io.register_buffers(0, nullptr, nullptr));
+	}
+
+	// loading hundreds of small assets, files are in the page cache by now so this is mostly syscall overhead
+	{
+		constexpr u32 num_rounds = 20;
+
+		const auto time_us = [&](auto &&fn){
+			const auto start = std::chrono::steady_clock::now();
+			for(u32 i = 0; i < num_rounds; i++) fn();
+			const auto end = std::chrono::steady_clock::now();
+			return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / num_rounds;
+		};
+
+		const auto sync_us = time_us([&]{ load_assets_sync(dir, arena); });
+
+		ham::file_io uring_io, threads_io(HAM_FILE_IO_DEFAULT_QUEUE_DEPTH, HAM_FILE_IO_FORCE_THREADS);
+		ham_test_assert(uring_io && threads_io);
+
+		const auto default_us = time_us([&]{ load_assets_async(uring_io, dir, arena, false); });
+		const auto threads_us = time_us([&]{ load_assets_async(threads_io, dir, arena, false); });
+
+		void *const buf = arena.data();
+		const usize len = arena.size();
+		ham_test_assert(uring_io.register_buffers(1, &buf, &len));
+
+		const auto registered_us = time_us([&]{ load_assets_async(uring_io, dir, arena, true); });
+
+#ifdef HAM_TEST_BENCHMARKS
+		std::cout << "    " << test_num_assets << " assets of " << test_asset_size << " bytes: "
+			<< "sync " << sync_us << " us, "
+			<< (uring_io.backend() == ham::file_io_backend::io_uring ? "io_uring " : "default ") << default_us << " us, "
+			<< "registered " << registered_us << " us, "
+			<< "threads " << threads_us << " us\n";
+#else
+		(void)sync_us; (void)default_us; (void)threads_us; (void)registered_us;
+#endif
+	}
+
+	// types recognised without libmagic, spelled the same as libmagic would
+	{
+		const auto mime_of = [](const std::string &bytes){ return ham::str8(ham_mime_from_mem(bytes.size(), bytes.data())); };
+
+		using namespace std::string_literals;
+
+		ham_test_assert(mime_of("\x89PNG\r\n\x1a\n\0\0\0\rIHDR"s) == ham::str8("image/png; charset=binary"));
+		ham_test_assert(mime_of("\xff\xd8\xff\xe0\0\x10JFIF\0"s) == ham::str8("image/jpeg; charset=binary"));
+		ham_test_assert(mime_of("glTF\x02\0\0\0\x20\0\0\0"s) == ham::str8("model/gltf-binary; charset=binary"));
+		ham_test_assert(mime_of("RIFF\x24\0\0\0WAVEfmt "s) == ham::str8("audio/x-wav; charset=binary"));
+		ham_test_assert(mime_of("OggS\0\x02"s + std::string(20, '\0') + "\x01\x1e\x01vorbis\0\0\0\0"s) == ham::str8("audio/ogg; charset=binary"));
+		ham_test_assert(mime_of("  { \"a\": [1, 2] }\n") == ham::str8("application/json; charset=us-ascii"));
+		ham_test_assert(mime_of("[\"\xc3\xa9\"]") == ham::str8("application/json; charset=utf-8"));
+
+		// only whole, well formed documents are json and every byte counts towards the charset
+		ham_test_assert(mime_of("[section]\nkey=1\n[other]\n") != ham::str8("application/json; charset=us-ascii"));
+		ham_test_assert(mime_of("{ \"a\": }") != ham::str8("application/json; charset=us-ascii"));
+		ham_test_assert(mime_of("[\"" + std::string(8192, 'a') + "\xc3\xa9\"]") == ham::str8("application/json; charset=utf-8"));
+		ham_test_assert(mime_of("{\"n\": -1.5e+3, \"s\": \"\\u00e9\\n\", \"l\": [true, false, null]}") == ham::str8("application/json; charset=us-ascii"));
+
+		// files are read past the head, the non-ascii bytes here only show up at the end
+		{
+			const auto json_path = (dir / "late-utf8.json").string();
+			const auto json_bytes = "[\"" + std::string(8192, 'a') + "\xc3\xa9\"]";
+
+			std::ofstream(json_path, std::ios::binary) << json_bytes;
+
+			ham_file_info json_info;
+			ham_test_assert(ham_path_file_info_utf8(ham::str8(json_path.c_str()), &json_info));
+			ham_test_assert(json_info.mime == ham::str8("application/json; charset=utf-8"));
+
+			std::filesystem::remove(json_path);
+		}
+
+		// whatever isn't recognised still goes to libmagic
+		ham_test_assert(mime_of("just some text\n") == ham::str8("text/plain; charset=us-ascii"));
+
+		// the test itself, which is either kind of executable depending on how it was linked
+		ham_file_info info;
+		ham_test_assert(ham_path_file_info_utf8(ham::str8("/proc/self/exe"), &info));
+		const ham::str8 exe_mime = info.mime;
+		ham_test_assert(exe_mime == ham::str8("application/x-pie-executable; charset=binary") || exe_mime == ham::str8("application/x-executable; charset=binary"));
+
+#ifdef HAM_TEST_BENCHMARKS
+		constexpr u32 num_probes = 10000;
+
+		const auto probe_ns = [&](const std::string &bytes){
+			const auto start = std::chrono::steady_clock::now();
+			for(u32 i = 0; i < num_probes; i++) mime_of(bytes);
+			const auto end = std::chrono::steady_clock::now();
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / num_probes;
+		};
+
+		const auto builtin_ns = probe_ns("\x89PNG\r\n\x1a\n\0\0\0\rIHDR"s);
+		const auto libmagic_ns = probe_ns("just some text\n");
+
+		std::cout << "    mime probe: built-in " << builtin_ns << " ns, libmagic " << libmagic_ns << " ns\n";
+#endif
+	}
+
+	// lz4 blocks
+	{
+		std::vector<u8> data;
+		ham_test_assert(lz4_round_trip(data));
+
+		data = { 'a', 'b', 'c' };
+		ham_test_assert(lz4_round_trip(data));
+
+		// long runs are overlapping matches
+		data.assign(100000, 'x');
+		ham_test_assert(lz4_round_trip(data));
+
+		const auto text = test_config_text();
+		data.assign(text.begin(), text.end());
+		ham_test_assert(lz4_round_trip(data));
+
+		// incompressible and further apart than a match can reach
+		data.resize(200000);
+		u64 state = 0x9e3779b97f4a7c15;
+		for(auto &b : data){
+			state = state * 6364136223846793005 + 1442695040888963407;
+			b = (u8)(state >> 56);
+		}
+		ham_test_assert(lz4_round_trip(data));
+
+		// matches reaching back before the start of the output
+		const u8 bad_offset[] = { 0x00, 0x01, 0x00 };
+		u8 out[16];
+		ham_test_assert(ham_lz4_decompress(sizeof(bad_offset), bad_offset, sizeof(out), out) == (usize)-1);
+
+		// not enough room for the output
+		const u8 literals[] = { 0x50, 'h', 'e', 'l', 'l', 'o' };
+		ham_test_assert(ham_lz4_decompress(sizeof(literals), literals, 4, out) == (usize)-1);
+		ham_test_assert(ham_lz4_decompress(sizeof(literals), literals, sizeof(out), out) == 5);
+	}
+
+	// packs mounted over the assets on disk
+	{
+		const auto pack_path = (dir / "assets.hampack").string();
+		const auto config = test_config_text();
+
+		{
+			ham::pack_builder builder;
+			ham_test_assert(builder);
+
+			std::vector<u8> contents(test_asset_size);
+
+			for(u32 i = 0; i < test_num_assets; i++){
+				for(u32 j = 0; j < test_asset_size; j++) contents[j] = asset_byte(i, j);
+
+				const auto path = "asset-" + std::to_string(i) + ".bin";
+				ham_test_assert(builder.add(ham::str8(path.c_str()), ham::str8("application/octet-stream"), contents.size(), contents.data(), i % 2 ? HAM_PACK_COMPRESS : 0));
+			}
+
+			ham_test_assert(builder.add("config/entities.json", "application/json", config.size(), config.data(), HAM_PACK_COMPRESS));
+			ham_test_assert(builder.add("empty.txt", "text/plain", 0, nullptr));
+			ham_test_assert(builder.add_file("copied/asset-0.bin", ham::str8(asset_path(dir, 0).c_str()), HAM_PACK_COMPRESS));
+
+			ham_test_assert(builder.num_entries() == test_num_assets + 3);
+			ham_test_assert(builder.write(ham::str8(pack_path.c_str())));
+		}
+
+		ham::pack pack(ham::str8(pack_path.c_str()));
+		ham_test_assert(pack);
+		ham_test_assert(pack.num_entries() == test_num_assets + 3);
+
+		ham_pack_entry_info info;
+		ham_test_assert(pack.find("config/entities.json", &info));
+		ham_test_assert(info.compressed && info.size == config.size() && info.stored_size < config.size());
+		ham_test_assert(info.mime == ham::str8("application/json"));
+		ham_test_assert(info.path.ptr[info.path.len] == '\0');
+
+		ham_test_assert(pack.find("copied/asset-0.bin", &info) && info.size == test_asset_size);
+		ham_test_assert(!pack.find("config/missing.json", &info));
+
+		for(u32 i = 0; i < pack.num_entries(); i++){
+			ham_test_assert(pack.get_entry(i, &info));
+
+			ham_pack_entry_info found;
+			ham_test_assert(pack.find(info.path, &found) && found.path.ptr == info.path.ptr);
+		}
+
+		const auto dir_str = dir.string();
+		const auto config_path = (dir / "config/entities.json").string();
+
+		ham_test_assert(!ham::path_exists(ham::str8(config_path.c_str())));
+
+		ham_test_assert(pack.mount(ham::str8(dir_str.c_str())));
+
+		ham_test_assert(ham::path_exists(ham::str8(config_path.c_str())));
+
+		ham_file_info file_info;
+		ham_test_assert(ham_path_file_info_utf8(ham::str8(config_path.c_str()), &file_info));
+		ham_test_assert(file_info.kind == HAM_FILE_REGULAR && file_info.size == config.size());
+		ham_test_assert(file_info.mime == ham::str8("application/json"));
+
+		{
+			ham::file file(ham::str8(config_path.c_str()), ham::file_open_flags::read);
+			ham_test_assert(file);
+			ham_test_assert(file.size() == config.size());
+
+			std::string contents(config.size(), '\0');
+			ham_test_assert(file.read(contents.data(), 10) == 10);
+			ham_test_assert(file.tell() == 10);
+			ham_test_assert(file.read(contents.data() + 10, contents.size()) == contents.size() - 10);
+			ham_test_assert(contents == config);
+			ham_test_assert(file.read(contents.data(), 1) == 0);
+
+			ham_test_assert(file.seek(2) == 2);
+			char c;
+			ham_test_assert(file.read(&c, 1) == 1 && c == config[2]);
+
+			const auto mapping = (const char*)ham_file_map(file.ptr(), HAM_OPEN_READ, 0, config.size());
+			ham_test_assert(mapping && std::memcmp(mapping, config.data(), config.size()) == 0);
+			ham_test_assert(ham_file_unmap(file.ptr(), (void*)mapping, config.size()));
+		}
+
+		{
+			const auto empty_path = (dir / "empty.txt").string();
+			ham::file file(ham::str8(empty_path.c_str()), ham::file_open_flags::read);
+			ham_test_assert(file && file.size() == 0);
+
+			char c;
+			ham_test_assert(file.read(&c, 1) == 0);
+		}
+
+		// stored entries are read straight out of the pack's mapping
+		{
+			const auto file = ham_file_open_utf8(ham::str8(asset_path(dir, 0).c_str()), HAM_OPEN_READ);
+			ham_test_assert(file);
+
+			const auto mapping = (const u8*)ham_file_map(file, HAM_OPEN_READ, 0, test_asset_size);
+			ham_test_assert(mapping && ((uptr)mapping % HAM_PACK_DATA_ALIGNMENT) == 0);
+			ham_test_assert(check_asset(0, mapping));
+
+			ham_file_close(file);
+		}
+
+		// lookups keep finding the pack while another pack is mounted and unmounted over it
+		{
+			const auto other_path = (dir / "other.hampack").string();
+
+			{
+				ham::pack_builder builder;
+				ham_test_assert(builder);
+				ham_test_assert(builder.add("other.txt", "text/plain", 5, "other"));
+				ham_test_assert(builder.write(ham::str8(other_path.c_str())));
+			}
+
+			ham::pack other(ham::str8(other_path.c_str()));
+			ham_test_assert(other);
+
+			std::atomic<bool> done{ false };
+			std::atomic<u32> num_missed{ 0 };
+
+			// ham::thread must not move once started
+			std::vector<ham::thread> threads;
+			threads.reserve(4);
+
+			for(u32 t = 0; t < 4; t++){
+				threads.emplace_back([&]{
+					while(!done.load(std::memory_order_relaxed)){
+						if(!ham::path_exists(ham::str8(config_path.c_str()))){
+							num_missed.fetch_add(1, std::memory_order_relaxed);
+						}
+					}
+				});
+			}
+
+			for(u32 i = 0; i < 200; i++){
+				ham_test_assert(other.mount(ham::str8(dir_str.c_str())));
+				ham_test_assert(ham::path_exists(ham::str8((dir / "other.txt").string().c_str())));
+				ham_test_assert(other.unmount());
+			}
+
+			done = true;
+
+			for(auto &&thd : threads){
+				ham_test_assert(thd.join());
+			}
+
+			ham_test_assert(num_missed == 0);
+			ham_test_assert(!ham::path_exists(ham::str8((dir / "other.txt").string().c_str())));
+		}
+
+		// asynchronous reads through both backends, none of which reach the disk
+		for(const u32 flags : { 0u, (u32)HAM_FILE_IO_FORCE_THREADS }){
+			ham::file_io io(HAM_FILE_IO_DEFAULT_QUEUE_DEPTH, flags);
+			ham_test_assert(io);
+
+			std::fill(arena.begin(), arena.end(), 0);
+			ham_test_assert(load_assets_async(io, dir, arena, false));
+
+			for(u32 i = 0; i < test_num_assets; i++){
+				ham_test_assert(check_asset(i, arena.data() + (usize)i * test_asset_size));
+			}
+		}
+
+		// opening assets from the pack against the same assets on disk
+		{
+			constexpr u32 num_rounds = 20;
+
+			const auto time_us = [&](auto &&fn){
+				const auto start = std::chrono::steady_clock::now();
+				for(u32 i = 0; i < num_rounds; i++) fn();
+				const auto end = std::chrono::steady_clock::now();
+				return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / num_rounds;
+			};
+
+			const auto packed_us = time_us([&]{ load_assets_sync(dir, arena); });
+
+			ham_test_assert(pack.unmount());
+
+			const auto loose_us = time_us([&]{ load_assets_sync(dir, arena); });
+
+#ifdef HAM_TEST_BENCHMARKS
+			std::cout << "    " << test_num_assets << " assets opened and read: loose " << loose_us << " us, packed " << packed_us << " us\n";
+#else
+			(void)loose_us; (void)packed_us;
+#endif
+		}
+
+		ham_test_assert(!ham::path_exists(ham::str8(config_path.c_str())));
+	}
+
+	std::filesystem::remove_all(dir);
+
+	// cooked assets are found again by what they were cooked from
+	{
+		const auto cache_root = std::filesystem::temp_directory_path() / ("ham-test-fs-cache-" + std::to_string(getpid()));
+		const auto cache_dir = (cache_root / "nested").string();
+
+		const std::string source = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+		const u32 settings = 1, other_settings = 2;
+
+		const auto key = ham_asset_key_from_mem(ham::str8("test/1"), sizeof(settings), &settings, source.size(), source.data());
+
+		usize len = 0;
+		ham_test_assert(!ham_asset_cache_map(key, &len));
+		ham_test_assert(!ham_asset_cache_store(key, source.size(), source.data()));
+
+		ham_test_assert(ham_asset_cache_set_dir(ham::str8(cache_dir.c_str())));
+		ham_test_assert(ham_asset_cache_dir() == ham::str8(cache_dir.c_str()));
+		ham_test_assert(std::filesystem::is_directory(cache_dir));
+
+		const auto same_key = ham_asset_key_from_mem(ham::str8("test/1"), sizeof(settings), &settings, source.size(), source.data());
+		const auto settings_key = ham_asset_key_from_mem(ham::str8("test/1"), sizeof(other_settings), &other_settings, source.size(), source.data());
+		const auto cooker_key = ham_asset_key_from_mem(ham::str8("test/2"), sizeof(settings), &settings, source.size(), source.data());
+		const auto source_key = ham_asset_key_from_mem(ham::str8("test/1"), sizeof(settings), &settings, source.size() - 1, source.data());
+
+		const auto key_eq = [](ham_asset_key a, ham_asset_key b){ return a.lo == b.lo && a.hi == b.hi; };
+		ham_test_assert(key_eq(key, same_key));
+		ham_test_assert(!key_eq(key, settings_key) && !key_eq(key, cooker_key) && !key_eq(key, source_key));
+
+		ham_test_assert(!ham_asset_cache_map(key, &len));
+
+		std::vector<u8> cooked(3000);
+		for(usize i = 0; i < cooked.size(); i++) cooked[i] = (u8)(i * 13);
+
+		ham_test_assert(ham_asset_cache_store(key, cooked.size(), cooked.data()));
+
+		const auto mapped = ham_asset_cache_map(key, &len);
+		ham_test_assert(mapped && len == cooked.size());
+		ham_test_assert(((uptr)mapped % HAM_ASSET_CACHE_DATA_ALIGNMENT) == 0);
+		ham_test_assert(std::memcmp(mapped, cooked.data(), len) == 0);
+		ham_asset_cache_unmap(mapped, len);
+
+		ham_test_assert(!ham_asset_cache_map(settings_key, &len));
+
+		// storing again replaces the entry
+		cooked.resize(100);
+		ham_test_assert(ham_asset_cache_store(key, cooked.size(), cooked.data()));
+
+		const auto replaced = ham_asset_cache_map(key, &len);
+		ham_test_assert(replaced && len == cooked.size() && std::memcmp(replaced, cooked.data(), len) == 0);
+		ham_asset_cache_unmap(replaced, len);
+
+		// a damaged entry is ignored
+		usize num_entries = 0;
+		for(const auto &entry : std::filesystem::recursive_directory_iterator(cache_dir)){
+			if(!entry.is_regular_file()) continue;
+
+			++num_entries;
+			std::filesystem::resize_file(entry.path(), entry.file_size() - 1);
+		}
+
+		ham_test_assert(num_entries == 1);
+		ham_test_assert(!ham_asset_cache_map(key, &len));
+
+		ham_test_assert(ham_asset_cache_set_dir(ham::str8()));
+		ham_test_assert(ham_asset_cache_dir().len == 0);
+
+		std::filesystem::remove_all(cache_root);
+	}
+
+#ifdef __linux__
+	// changes are coalesced per path and only delivered once they settle
+	{
+		const auto watch_dir = std::filesystem::temp_directory_path() / ("ham-test-fs-watch-" + std::to_string(getpid()));
+		std::filesystem::create_directories(watch_dir / "textures");
+
+		const auto write_file = [](const std::filesystem::path &path, const std::string &contents){
+			const auto file = fopen(path.c_str(), "wb");
+			if(!file) return false;
+			const bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+			return fclose(file) == 0 && written;
+		};
+
+		const auto shader_path = (watch_dir / "basic.glsl").string();
+		const auto model_path = (watch_dir / "crate.obj").string();
+		const auto texture_path = (watch_dir / "textures" / "crate.png").string();
+		ham_test_assert(write_file(model_path, "v 0 0 0"));
+
+		constexpr u32 debounce_ms = 100;
+
+		ham::fs_watch watch(debounce_ms);
+		ham_test_assert(watch);
+		ham_test_assert(watch.add(ham::str8(watch_dir.c_str()), HAM_FS_WATCH_RECURSIVE));
+
+		const auto start = std::chrono::steady_clock::now();
+
+		// saved in pieces, then replaced through a temporary file the way editors do
+		for(int i = 0; i < 4; i++){
+			ham_test_assert(write_file(shader_path, "void main(){} // " + std::to_string(i)));
+		}
+
+		const auto tmp_path = model_path + ".tmp";
+		ham_test_assert(write_file(tmp_path, "v 1 1 1"));
+		std::filesystem::rename(tmp_path, model_path);
+
+		ham_test_assert(write_file(texture_path, "not really a png"));
+
+		const auto events = collect_watch_events(watch, 3);
+
+		ham_test_assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(debounce_ms));
+		ham_test_assert(events.size() == 3);
+		ham_test_assert(has_watch_event(events, HAM_FS_WATCH_CREATED, shader_path));
+		ham_test_assert(has_watch_event(events, HAM_FS_WATCH_CREATED, model_path));
+		ham_test_assert(has_watch_event(events, HAM_FS_WATCH_CREATED, texture_path));
+
+		// file paths never reach the interner, they live in the watch
+		ham_test_assert(ham_intern_find(ham::str8(tmp_path.c_str())) == HAM_SYMBOL_NULL);
+		ham_test_assert(ham_intern_find(ham::str8(shader_path.c_str())) == HAM_SYMBOL_NULL);
+
+		// nothing else shows up later
+		ham_test_assert(collect_watch_events(watch, 1, std::chrono::milliseconds(debounce_ms * 3)).empty());
+
+		ham_test_assert(write_file(shader_path, "void main(){ discard; }"));
+		std::filesystem::remove(model_path);
+
+		// a new directory is watched too, along with anything written before the watch caught up
+		std::filesystem::create_directories(watch_dir / "meshes" / "props");
+		const auto mesh_path = (watch_dir / "meshes" / "props" / "barrel.obj").string();
+		ham_test_assert(write_file(mesh_path, "v 2 2 2"));
+
+		const auto more_events = collect_watch_events(watch, 3);
+		ham_test_assert(more_events.size() == 3);
+		ham_test_assert(has_watch_event(more_events, HAM_FS_WATCH_MODIFIED, shader_path));
+		ham_test_assert(has_watch_event(more_events, HAM_FS_WATCH_REMOVED, model_path));
+		ham_test_assert(has_watch_event(more_events, HAM_FS_WATCH_CREATED, mesh_path));
+
+		ham_test_assert(watch.remove(ham::str8(watch_dir.c_str())));
+		ham_test_assert(!watch.remove(ham::str8(watch_dir.c_str())));
+
+		ham_test_assert(write_file(shader_path, "void main(){}"));
+		ham_test_assert(collect_watch_events(watch, 1, std::chrono::milliseconds(debounce_ms * 3)).empty());
+
+		std::filesystem::remove_all(watch_dir);
+	}
+#endif
+
+	return true;
+}
@@ -0,0 +1,145 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/hash.h"
+
+#include "tests.hpp"
+
+#include <array>
+#include <bit>
+#include <vector>
+
+using namespace ham::typedefs;
+
+namespace {
+	constexpr usize test_data_len = 4096 + 77;
+
+	constexpr std::array<char, test_data_len> make_test_data() noexcept{
+		std::array<char, test_data_len> ret{};
+		u32 state = 0x12345678u;
+
+		for(usize i = 0; i < test_data_len; i++){
+			state = (state * 1664525u) + 1013904223u;
+			ret[i] = (char)(state >> 24);
+		}
+
+		return ret;
+	}
+
+	constexpr auto test_data = make_test_data();
+
+	// covers every short-input branch plus both sides of the bulk threshold and block scrambling
+	constexpr usize test_lens[] = {
+		0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 33, 48, 49, 97,
+		HAM_HASH_FAST_BULK_THRESHOLD - 1, HAM_HASH_FAST_BULK_THRESHOLD, HAM_HASH_FAST_BULK_THRESHOLD + 1,
+		1023, 1024, 1025, 2049, test_data_len
+	};
+
+	constexpr usize num_test_lens = std::size(test_lens);
+
+	constexpr auto make_compile_time_hashes() noexcept{
+		std::array<ham_hash128, num_test_lens> ret{};
+
+		for(usize i = 0; i < num_test_lens; i++){
+			ret[i] = ham_hash_fast_128(test_data.data(), test_lens[i]);
+		}
+
+		return ret;
+	}
+
+	// average number of output bits changed by flipping a single input bit
+	f64 avalanche_bits(usize len){
+		std::vector<char> buf(test_data.begin(), test_data.begin() + len);
+		const u64 base = ham_hash_fast_64(buf.data(), len);
+
+		usize total = 0, num_flips = 0;
+
+		for(usize i = 0; i < len; i += (len / 16) + 1){
+			for(int bit = 0; bit < 8; bit++){
+				buf[i] ^= (char)(1 << bit);
+				total += (usize)std::popcount(base ^ ham_hash_fast_64(buf.data(), len));
+				buf[i] ^= (char)(1 << bit);
+				++num_flips;
+			}
+		}
+
+		return f64(total) / f64(num_flips);
+	}
+}
+
+bool ham_test_hash(){
+	// FNV-1a reference values
+	static_assert(ham_hash_fnv1a_64("", 0) == 0xcbf29ce484222325ull);
+	static_assert(ham_hash_fnv1a_64("a", 1) == 0xaf63dc4c8601ec8cull);
+	static_assert(ham_hash_fnv1a_64("foobar", 6) == 0x85944171f73967e8ull);
+	static_assert(ham_hash_fnv1a_32("foobar", 6) == 0xbf9cf968u);
+
+	// str8 keys hash with the fast hash by default
+	static_assert(ham::hash(ham::str8("foobar")) == ham_hash_fast_64("foobar", 6));
+	static_assert(ham::hash_fnv1a("foobar") == ham_hash_fnv1a_64("foobar", 6));
+
+	// compile-time (scalar) and run-time (vectorized) results are identical
+	{
+		constexpr auto compile_time_hashes = make_compile_time_hashes();
+
+		for(usize i = 0; i < num_test_lens; i++){
+			const auto len = test_lens[i];
+			const auto h = ham_hash_fast_128(test_data.data(), len);
+
+			ham_test_assert(h.lo == compile_time_hashes[i].lo);
+			ham_test_assert(h.hi == compile_time_hashes[i].hi);
+			ham_test_assert(h.lo == ham_hash_fast_64(test_data.data(), len));
+			ham_test_assert(h.lo != h.hi);
+
+			// distinct lengths of the same data must not collide
+			for(usize j = 0; j < i; j++){
+				ham_test_assert(compile_time_hashes[j].lo != h.lo);
+			}
+		}
+	}
+
+	// results don't depend on alignment
+	{
+		std::vector<char> buf(test_data_len + 8);
+
+		for(usize off = 1; off < 8; off++){
+			std::copy(test_data.begin(), test_data.end(), buf.begin() + off);
+
+			for(const auto len : test_lens){
+				ham_test_assert(ham_hash_fast_64(buf.data() + off, len) == ham_hash_fast_64(test_data.data(), len));
+			}
+		}
+	}
+
+	// seeds give independent hashes
+	{
+		const auto str = ham::str8("ham_test_hash_seeded");
+		ham_test_assert(ham::hash_fast(str) == ham::hash(str));
+		ham_test_assert(ham::hash_fast(str, 1) != ham::hash_fast(str));
+		ham_test_assert(ham::hash_fast(str, 1) == ham::fast_hash_functor{1}(str));
+		ham_test_assert(ham::hash_fast128(str, 1).lo == ham::hash_fast(str, 1));
+	}
+
+	// single bit flips change roughly half of the output
+	for(const usize len : { 8, 40, 200, 300, 2000 }){
+		const auto bits = avalanche_bits(len);
+		ham_test_assert_msg(bits > 28.0 && bits < 36.0, "Poor avalanche for %zu bytes: %f bits", len, bits);
+	}
+
+	return true;
+}
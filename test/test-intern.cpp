@@ -0,0 +1,87 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/intern.h"
+
+#include "tests.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace ham::typedefs;
+
+bool ham_test_intern(){
+	const auto foo = ham::symbol(HAM_LIT("ham_test_intern_foo"));
+	const auto bar = ham::symbol(HAM_LIT("ham_test_intern_bar"));
+
+	ham_test_assert(foo && bar);
+	ham_test_assert(foo != bar);
+
+	// interning is idempotent and views are stable
+	ham_test_assert(ham::symbol(HAM_LIT("ham_test_intern_foo")) == foo);
+	ham_test_assert(ham::symbol::find(HAM_LIT("ham_test_intern_bar")) == bar);
+	ham_test_assert(foo.str() == HAM_LIT("ham_test_intern_foo"));
+	ham_test_assert(foo.c_str() == foo.str().ptr());
+	ham_test_assert(foo.c_str()[foo.str().len()] == '\0');
+
+	ham_test_assert(!ham::symbol::find(HAM_LIT("ham_test_intern_never_interned")));
+	ham_test_assert(ham_intern(HAM_EMPTY_STR8) == HAM_SYMBOL_NULL);
+	ham_test_assert(ham_symbol_str(HAM_SYMBOL_NULL).len == 0);
+
+	// concurrent interning of overlapping strings hands out one symbol per string
+
+	{
+		constexpr usize num_threads = 4;
+		constexpr usize num_strs = 2048;
+
+		std::vector<std::vector<ham_symbol>> results(num_threads);
+		std::vector<std::thread> threads;
+
+		for(usize t = 0; t < num_threads; t++){
+			threads.emplace_back([&, t]{
+				auto &syms = results[t];
+				syms.resize(num_strs);
+
+				// every thread walks the strings from a different starting point
+				for(usize i = 0; i < num_strs; i++){
+					const usize idx = (i + t * (num_strs / num_threads)) % num_strs;
+					const auto str = ham::format("ham_test_intern_{}", idx);
+					syms[idx] = ham_intern(str);
+				}
+			});
+		}
+
+		for(auto &&thd : threads){
+			thd.join();
+		}
+
+		for(usize i = 0; i < num_strs; i++){
+			const auto sym = results[0][i];
+			ham_test_assert(sym != HAM_SYMBOL_NULL);
+
+			for(usize t = 1; t < num_threads; t++){
+				ham_test_assert(results[t][i] == sym);
+			}
+
+			ham_test_assert(ham::str8(ham_symbol_str(sym)) == ham::format("ham_test_intern_{}", i));
+		}
+	}
+
+	return true;
+}
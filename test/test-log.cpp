@@ -0,0 +1,341 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/log.h"
+#include "ham/async.h"
+
+#include "tests.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <sched.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace ham::typedefs;
+
+namespace {
+	constexpr u32 test_num_threads = 4;
+	constexpr u32 test_num_msgs = 2000;
+
+	// records what reaches the sink, only ever called from the writer thread
+	struct capture_sink{
+		std::atomic<bool> blocked{ false };
+		std::atomic<usize> num_received{ 0 };
+		std::atomic<usize> num_dropped_warnings{ 0 };
+		usize num_fatal = 0;
+		u32 next_idx[test_num_threads] = {};
+		bool in_order = true;
+		std::string last_api, last_msg;
+	};
+
+	ham_usize capture_log(ham_timepoint, ham_log_level level, const char *api, const char *msg, void *user){
+		const auto sink = (capture_sink*)user;
+
+		while(sink->blocked.load(std::memory_order_acquire)){
+			sched_yield();
+		}
+
+		if(level == HAM_LOG_FATAL){
+			++sink->num_fatal;
+		}
+		else if(ham::str8(api) == ham::str8("ham_async_logger")){
+			++sink->num_dropped_warnings;
+			return 0;
+		}
+
+		u32 thread_idx, msg_idx;
+		if(sscanf(msg, "thread %u message %u", &thread_idx, &msg_idx) == 2 && thread_idx < test_num_threads){
+			// records from a single thread come out in the order they went in
+			if(msg_idx < sink->next_idx[thread_idx]) sink->in_order = false;
+			sink->next_idx[thread_idx] = msg_idx + 1;
+		}
+
+		sink->last_api = api;
+		sink->last_msg = msg;
+
+		sink->num_received.fetch_add(1, std::memory_order_release);
+		return 0;
+	}
+
+	struct decoded_record{
+		ham_log_level level;
+		std::string api, msg;
+	};
+
+	ham_usize collect_log(ham_timepoint, ham_log_level level, const char *api, const char *msg, void *user){
+		((std::vector<decoded_record>*)user)->push_back({ level, api, msg });
+		return 0;
+	}
+
+	void log_structured_event(u32 i){
+		ham::logapiinfo("event {} at {:.2f} named {} ok {}", i, i * 0.5, "spawn", i % 2 == 0);
+	}
+}
+
+bool ham_test_log(){
+	// many threads, nothing dropped
+	{
+		capture_sink sink;
+		const ham_logger sink_logger{ capture_log, &sink };
+
+		ham::async_logger logger(&sink_logger, 256 * 1024, 8);
+		ham_test_assert(logger);
+
+		// ham::thread must not move once started
+		std::vector<ham::thread> threads;
+		threads.reserve(test_num_threads);
+
+		for(u32 t = 0; t < test_num_threads; t++){
+			threads.emplace_back([&logger, t]{
+				ham_set_logger(logger.get());
+
+				for(u32 i = 0; i < test_num_msgs; i++){
+					ham_logf(HAM_LOG_INFO, "ham_test_log", "thread %u message %u", t, i);
+
+					// give the writer a chance to keep up
+					if(i % 64 == 63) sched_yield();
+				}
+
+				ham_set_logger(nullptr);
+			});
+		}
+
+		for(auto &&thd : threads){
+			ham_test_assert(thd.join());
+		}
+
+		ham_test_assert(logger.flush());
+		ham_test_assert(sink.num_received + logger.num_dropped() == test_num_threads * test_num_msgs);
+		ham_test_assert(sink.in_order);
+
+		// fatal records are written before the call returns
+		logger.get()->log((ham_timepoint){ 0, 0 }, HAM_LOG_FATAL, "ham_test_log", "fatal", logger.get()->user);
+		ham_test_assert(sink.num_fatal == 1);
+	}
+
+	// a stalled sink drops records instead of blocking the caller
+	{
+		capture_sink sink;
+		const ham_logger sink_logger{ capture_log, &sink };
+
+		ham::async_logger logger(&sink_logger, 4096, 1);
+		ham_test_assert(logger);
+
+		sink.blocked = true;
+
+		const auto iface = logger.get();
+
+		constexpr usize num_sent = 1000;
+
+		for(usize i = 0; i < num_sent; i++){
+			iface->log((ham_timepoint){ 0, 0 }, HAM_LOG_INFO, "ham_test_log", "this message is going nowhere fast", iface->user);
+		}
+
+		sink.blocked = false;
+
+		ham_test_assert(logger.flush());
+		ham_test_assert(logger.num_dropped() > 0);
+		ham_test_assert(sink.num_dropped_warnings > 0);
+		ham_test_assert(sink.num_received + logger.num_dropped() == num_sent);
+
+		// a second thread finds no free ring
+		const auto dropped_before = logger.num_dropped();
+
+		ham::thread other([&iface]{
+			iface->log((ham_timepoint){ 0, 0 }, HAM_LOG_INFO, "ham_test_log", "no ring for me", iface->user);
+		});
+
+		ham_test_assert(other.join());
+
+		ham_test_assert(logger.flush());
+		ham_test_assert(logger.num_dropped() == dropped_before + 1);
+	}
+
+	// structured records are formatted by the writer thread
+	{
+		capture_sink sink;
+		const ham_logger sink_logger{ capture_log, &sink };
+
+		ham::async_logger logger(&sink_logger, 64 * 1024, 1);
+		ham_test_assert(logger);
+		ham_test_assert(logger.get()->log_structured);
+
+		ham_set_logger(logger.get());
+
+		log_structured_event(4);
+		ham_test_assert(logger.flush());
+		ham_test_assert(sink.last_msg == "event 4 at 2.00 named spawn ok true");
+		ham_test_assert(ham::str8(sink.last_api.c_str()).find(ham::str8("log_structured_event")) != (usize)-1);
+
+		const ham::str8 name = "entity";
+		ham::loginfo("ham_test_log", "{:>8}|{:x}|{}|{}", name, 255u, 'c', 1.5f);
+		ham_test_assert(logger.flush());
+		ham_test_assert(sink.last_api == "ham_test_log");
+		ham_test_assert(sink.last_msg == "  entity|ff|c|1.5");
+
+		ham_set_logger(nullptr);
+	}
+
+	// binary logs round trip through the decoder
+	{
+		const auto path = (std::filesystem::temp_directory_path() / ("ham-test-log-" + std::to_string(getpid()) + ".hamlog")).string();
+		const ham::str8 path_str(path.c_str());
+
+		constexpr u32 num_events = 1000;
+
+		{
+			ham::async_logger logger(path_str, 1024 * 1024, 1);
+			ham_test_assert(logger);
+
+			ham_set_logger(logger.get());
+
+			for(u32 i = 0; i < num_events; i++){
+				log_structured_event(i);
+			}
+
+			ham::loginfo("ham_test_log", "inline api {}", std::string("and string"));
+			ham_logf(HAM_LOG_WARNING, "ham_test_log", "formatted %d", 42);
+
+			// strings that are gone before the writer sees them, like those of an unloaded plugin;
+			// the allocator tends to hand the second pair of buffers the same addresses as the first
+			for(u32 i = 0; i < 2; i++){
+				const std::string fmt_src = i == 0 ? "heap first {}" : "heap other {}";
+				const std::string api_src = i == 0 ? "heap_api_one" : "heap_api_two";
+
+				const auto fmt_buf = new char[fmt_src.size()];
+				const auto api_buf = new char[api_src.size()];
+				memcpy(fmt_buf, fmt_src.data(), fmt_src.size());
+				memcpy(api_buf, api_src.data(), api_src.size());
+
+				ham_test_assert(ham::detail::log_structured(
+					logger.get(), ham_timepoint{ 0, 0 }, ham::log_level::info,
+					fmt::string_view(fmt_buf, fmt_src.size()), std::string_view(api_buf, api_src.size()), true,
+					i
+				));
+
+				memset(fmt_buf, '?', fmt_src.size());
+				memset(api_buf, '?', api_src.size());
+				delete[] fmt_buf;
+				delete[] api_buf;
+			}
+
+			ham_set_logger(nullptr);
+
+			ham_test_assert(logger.flush());
+			ham_test_assert(logger.num_dropped() == 0);
+		}
+
+		std::vector<decoded_record> records;
+		const ham_logger collector{ collect_log, &records };
+
+		ham_test_assert(ham_log_decode_file(path_str, &collector) == num_events + 4);
+		ham_test_assert(records.size() == num_events + 4);
+
+		for(u32 i = 0; i < num_events; i++){
+			ham_test_assert(records[i].level == HAM_LOG_INFO);
+			ham_test_assert(records[i].msg == fmt::format("event {} at {:.2f} named spawn ok {}", i, i * 0.5, i % 2 == 0));
+		}
+
+		ham_test_assert(records[num_events].api == "ham_test_log");
+		ham_test_assert(records[num_events].msg == "inline api and string");
+		ham_test_assert(records[num_events + 1].level == HAM_LOG_WARNING);
+		ham_test_assert(records[num_events + 1].msg == "formatted 42");
+
+		ham_test_assert(records[num_events + 2].api == "heap_api_one");
+		ham_test_assert(records[num_events + 2].msg == "heap first 0");
+		ham_test_assert(records[num_events + 3].api == "heap_api_two");
+		ham_test_assert(records[num_events + 3].msg == "heap other 1");
+
+		std::filesystem::remove(path);
+	}
+
+	// messages longer than the fixed message buffer reach the logger whole
+	{
+		std::vector<decoded_record> records;
+		const ham_logger collector{ collect_log, &records };
+
+		const std::string long_str(HAM_MESSAGE_BUFFER_SIZE * 2, 'x');
+
+		ham_set_logger(&collector);
+		ham::logapiinfo("short {}", 1);
+		ham::logapiinfo("long {} end", long_str);
+		ham::loginfo("ham_test_log", "short again {}", 2);
+		ham_set_logger(nullptr);
+
+		ham_test_assert(records.size() == 3);
+		ham_test_assert(records[0].msg == "short 1");
+		ham_test_assert(records[1].msg == "long " + long_str + " end");
+		ham_test_assert(records[2].msg == "short again 2");
+	}
+
+	// cost on the logging thread, the writer thread's time isn't counted
+	{
+		const auto path = (std::filesystem::temp_directory_path() / ("ham-test-log-bench-" + std::to_string(getpid()) + ".hamlog")).string();
+
+		constexpr u32 num_events = 100000;
+
+		const auto thread_time_ns = []{
+			ham_timepoint tp = (ham_timepoint){ 0, 0 };
+			ham_timepoint_now(&tp, CLOCK_THREAD_CPUTIME_ID);
+			return (i64)tp.tv_sec * 1000000000 + tp.tv_nsec;
+		};
+
+		const ham_logger discard_logger{ [](ham_timepoint, ham_log_level, const char*, const char*, void*) -> ham_usize { return 0; }, nullptr, nullptr };
+
+		ham_set_logger(&discard_logger);
+
+		const auto format_start = thread_time_ns();
+
+		for(u32 i = 0; i < num_events; i++){
+			log_structured_event(i);
+		}
+
+		const auto format_ns = thread_time_ns() - format_start;
+
+		ham::async_logger logger(ham::str8(path.c_str()), 8 * 1024 * 1024, 1);
+		ham_test_assert(logger);
+
+		ham_set_logger(logger.get());
+
+		const auto structured_start = thread_time_ns();
+
+		for(u32 i = 0; i < num_events; i++){
+			log_structured_event(i);
+		}
+
+		const auto structured_ns = thread_time_ns() - structured_start;
+
+		ham_set_logger(nullptr);
+		ham_test_assert(logger.flush());
+
+#ifdef HAM_TEST_BENCHMARKS
+		std::cout << "    formatted: " << (format_ns / num_events) << " ns/record, structured: " << (structured_ns / num_events) << " ns/record\n";
+#else
+		(void)format_ns; (void)structured_ns;
+#endif
+
+		std::filesystem::remove(path);
+	}
+
+	return true;
+}
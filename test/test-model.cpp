@@ -0,0 +1,214 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/fs.h"
+#include "ham/shape.h"
+#include "ham/engine/model.h"
+
+#include "tests.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+using namespace ham::typedefs;
+
+namespace {
+	constexpr std::string_view test_obj =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vn 0 0 1\n"
+		"f 1//1 2//1 3//1\nf 1//1 3//1 4//1\n";
+
+	void collect_dep(ham_str8 path, void *user){
+		reinterpret_cast<std::vector<std::string>*>(user)->emplace_back(path.ptr, path.len);
+	}
+
+	void write_file(const std::filesystem::path &path, std::string_view contents){
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(contents.data(), contents.size());
+	}
+
+	ham_usize append_bytes(ham_usize len, const void *bytes, void *user){
+		const auto out = reinterpret_cast<std::vector<u8>*>(user);
+		out->insert(out->end(), (const u8*)bytes, (const u8*)bytes + len);
+		return len;
+	}
+
+	bool shapes_match(const ham_model *a, const ham_model *b){
+		const usize num_shapes = ham_model_num_shapes(a);
+		if(!num_shapes || num_shapes != ham_model_num_shapes(b)) return false;
+
+		for(usize i = 0; i < num_shapes; i++){
+			const auto a_shape = ham_model_shapes(a)[i];
+			const auto b_shape = ham_model_shapes(b)[i];
+
+			const u32 num_points = ham_shape_num_points(a_shape);
+			const u32 num_indices = ham_shape_num_indices(a_shape);
+
+			if(
+				num_points != ham_shape_num_points(b_shape) ||
+				num_indices != ham_shape_num_indices(b_shape) ||
+				memcmp(ham_shape_vertices(a_shape), ham_shape_vertices(b_shape), sizeof(ham_vec3) * num_points) != 0 ||
+				memcmp(ham_shape_indices(a_shape), ham_shape_indices(b_shape), sizeof(u32) * num_indices) != 0
+			){
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//! Overwrite 4 bytes at `off` into the cooked model held by the only entry in `cache_dir`.
+	bool patch_cached(const std::filesystem::path &cache_dir, const std::vector<u8> &cooked, u64 off, u32 val){
+		std::filesystem::path entry_path;
+		usize num_entries = 0;
+
+		for(const auto &entry : std::filesystem::recursive_directory_iterator(cache_dir)){
+			if(!entry.is_regular_file()) continue;
+
+			entry_path = entry.path();
+			++num_entries;
+		}
+
+		if(num_entries != 1) return false;
+
+		std::string contents;
+
+		{
+			std::ifstream in(entry_path, std::ios::binary);
+			contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		}
+
+		const auto model_pos = contents.find(std::string_view((const char*)cooked.data(), sizeof(ham_model_cooked_header)));
+		if(model_pos == std::string::npos || model_pos + off + sizeof(val) > contents.size()) return false;
+
+		memcpy(contents.data() + model_pos + off, &val, sizeof(val));
+
+		std::ofstream out(entry_path, std::ios::binary | std::ios::trunc);
+		out.write(contents.data(), contents.size());
+		return (bool)out.flush();
+	}
+}
+
+bool ham_test_model(){
+	std::vector<u8> cooked;
+	ham_test_assert(ham_model_cook(test_obj.size(), test_obj.data(), append_bytes, &cooked) == cooked.size());
+	ham_test_assert(ham_model_is_cooked(cooked.size(), cooked.data()));
+
+	const auto imported = ham_model_load_from_mem(test_obj.size(), test_obj.data());
+	ham_test_assert(imported != nullptr);
+
+	// cooked models load in place, ham_vec4i keeps the copy aligned
+	{
+		std::vector<ham_vec4i> aligned((cooked.size() + sizeof(ham_vec4i) - 1) / sizeof(ham_vec4i));
+		memcpy(aligned.data(), cooked.data(), cooked.size());
+
+		const auto loaded = ham_model_load_cooked(cooked.size(), aligned.data());
+		ham_test_assert(loaded != nullptr);
+		ham_test_assert(shapes_match(imported, loaded));
+		ham_model_destroy(loaded);
+
+		const auto copied = ham_model_load_from_mem(cooked.size(), cooked.data());
+		ham_test_assert(copied != nullptr);
+		ham_test_assert(shapes_match(imported, copied));
+		ham_model_destroy(copied);
+	}
+
+	// a cached model pointing out of its own arrays is imported again instead of used
+	{
+		const auto cache_dir = std::filesystem::temp_directory_path() / ("ham-test-model-cache-" + std::to_string(getpid()));
+		ham_test_assert(ham_asset_cache_set_dir(ham::str8(cache_dir.c_str())));
+
+		const auto cached = ham_model_load_from_mem(test_obj.size(), test_obj.data());
+		ham_test_assert(cached != nullptr);
+		ham_test_assert(shapes_match(imported, cached));
+		ham_model_destroy(cached);
+
+		const auto header = (const ham_model_cooked_header*)cooked.data();
+		const auto shape = (const ham_model_cooked_shape*)(cooked.data() + header->shapes_off);
+
+		ham_test_assert(patch_cached(cache_dir, cooked, shape->indices_off, shape->num_points));
+
+		const auto bad_index = ham_model_load_from_mem(test_obj.size(), test_obj.data());
+		ham_test_assert(bad_index != nullptr);
+		ham_test_assert(shapes_match(imported, bad_index));
+		ham_model_destroy(bad_index);
+
+		ham_test_assert(patch_cached(cache_dir, cooked, shape->bone_indices_off, shape->num_bones));
+
+		const auto bad_bone = ham_model_load_from_mem(test_obj.size(), test_obj.data());
+		ham_test_assert(bad_bone != nullptr);
+		ham_test_assert(shapes_match(imported, bad_bone));
+		ham_test_assert(ham_shape_indices(ham_model_shapes(bad_bone)[0])[0] < ham_shape_num_points(ham_model_shapes(bad_bone)[0]));
+		ham_model_destroy(bad_bone);
+
+		ham_test_assert(ham_asset_cache_set_dir(ham::str8()));
+		std::filesystem::remove_all(cache_dir);
+	}
+
+	// models loaded from a file find the material libraries next to them, and editing one changes the cached model
+	{
+		const auto dir = std::filesystem::temp_directory_path() / ("ham-test-model-deps-" + std::to_string(getpid()));
+		std::filesystem::create_directories(dir);
+
+		const auto mdl_path = (dir / "test.obj").string();
+		const auto mtl_path = (std::filesystem::canonical(dir) / "test.mtl").string();
+
+		write_file(mdl_path, std::string("mtllib test.mtl\nusemtl red\n").append(test_obj));
+		write_file(mtl_path, "newmtl red\nKd 1 0 0\n");
+
+		ham_test_assert(ham_asset_cache_set_dir(ham::str8((dir / "cache").c_str())));
+
+		std::vector<std::string> deps;
+		ham_asset_key key;
+
+		const auto first = ham_model_load_with_deps(ham::str8(mdl_path.c_str()), collect_dep, &deps, &key);
+		ham_test_assert(first != nullptr);
+		ham_test_assert(shapes_match(imported, first));
+		ham_test_assert(key.lo || key.hi);
+		ham_test_assert(std::find(deps.begin(), deps.end(), mtl_path) != deps.end());
+		ham_model_destroy(first);
+
+		// unchanged files give the same key
+		ham_asset_key same_key;
+		const auto again = ham_model_load_with_deps(ham::str8(mdl_path.c_str()), nullptr, nullptr, &same_key);
+		ham_test_assert(again != nullptr);
+		ham_test_assert(same_key.lo == key.lo && same_key.hi == key.hi);
+		ham_model_destroy(again);
+
+		write_file(mtl_path, "newmtl red\nKd 0 1 0\n");
+
+		ham_asset_key edited_key;
+		const auto edited = ham_model_load_with_deps(ham::str8(mdl_path.c_str()), nullptr, nullptr, &edited_key);
+		ham_test_assert(edited != nullptr);
+		ham_test_assert(edited_key.lo != key.lo || edited_key.hi != key.hi);
+		ham_model_destroy(edited);
+
+		ham_test_assert(ham_asset_cache_set_dir(ham::str8()));
+		std::filesystem::remove_all(dir);
+	}
+
+	ham_model_destroy(imported);
+	return true;
+}
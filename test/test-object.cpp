@@ -118,6 +118,39 @@ bool ham_test_object(){
 		}
 	}
 
+	// swapping vtables keeps object state, like a plugin reload does
+	{
+		static ham_object_test_vtable reloaded_vtable = *(const ham_object_test_vtable*)obj_vtable;
+		reloaded_vtable.foo = +[](ham_object_test *obj) -> int{ return obj->test_val += 3; };
+
+		ham_usize num_migrated = 0;
+
+		const bool swapped = ham_object_manager_set_vtable(
+			obj_man, (const ham_object_vtable*)&reloaded_vtable,
+			[](ham_object *obj, const ham_object_vtable *old_vtable, void *user){
+				++*(ham_usize*)user;
+				return obj->vptr != old_vtable;
+			},
+			&num_migrated
+		);
+
+		if(!swapped || num_migrated != std::size(objs) || ham_object_manager_vtable(obj_man) != (const ham_object_vtable*)&reloaded_vtable){
+			std::cerr << "Error in ham_object_manager_set_vtable, " << num_migrated << " objects migrated\n";
+			ham_object_manager_destroy(obj_man);
+			return false;
+		}
+
+		for(ham_usize i = 0; i < std::size(objs); i++){
+			const auto test_obj = (ham_object_test*)objs[i];
+			const auto test_vt  = (const ham_object_test_vtable*)objs[i]->vptr;
+			if(test_vt->foo(test_obj) != (int)(i + 6)){
+				std::cerr << "Function call bad result from object " << i << " after swapping vtables\n";
+				ham_object_manager_destroy(obj_man);
+				return false;
+			}
+		}
+	}
+
 	for(ham_usize i = std::size(objs); i >= 1; i--){
 		const auto idx = i - 1;
 		if(!ham_object_delete(obj_man, objs[idx])){
@@ -0,0 +1,354 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/plugin.h"
+#include "ham/object.h"
+
+#include "plugin/test-plugin.h"
+#include "tests.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ham::typedefs;
+
+#if !defined(HAM_TEST_PLUGIN_PATH) || !defined(HAM_TEST_PLUGIN_REBUILT_PATH) || !defined(HAM_TEST_PLUGIN_RELAYOUT_PATH)
+#	error "HAM_TEST_PLUGIN_PATH, HAM_TEST_PLUGIN_REBUILT_PATH and HAM_TEST_PLUGIN_RELAYOUT_PATH must be defined as paths of the built test plugins"
+#endif
+
+namespace {
+	std::string read_text(const std::filesystem::path &path){
+		std::ifstream file(path);
+		std::stringstream ss;
+		ss << file.rdbuf();
+		return ss.str();
+	}
+
+	void write_text(const std::filesystem::path &path, const std::string &contents){
+		std::ofstream file(path, std::ios::trunc);
+		file << contents;
+	}
+
+	//! Find and immediately unload the test plugin from `dir`.
+	bool find_test_plugin(const std::filesystem::path &dir){
+		const std::string dir_str = dir.string();
+
+		ham_plugin *plugin = nullptr;
+		ham_dso_handle dso = nullptr;
+
+		if(!ham_plugin_find(HAM_TEST_PLUGIN_NAME, ham::str8(dir_str.c_str()), &plugin, &dso)){
+			return false;
+		}
+
+		const bool name_matches = ham::str8(ham_plugin_name(plugin)) == ham::str8(HAM_TEST_PLUGIN_NAME);
+
+		ham_plugin_unload(plugin);
+		ham_dso_close(dso);
+		return name_matches;
+	}
+
+	//! Move the modification time of `path` so it no longer matches what was cached.
+	bool touch_file(const std::filesystem::path &path, i64 offset_s){
+		struct stat stat_buf;
+		if(stat(path.c_str(), &stat_buf) != 0) return false;
+
+		struct timespec times[2] = { stat_buf.st_atim, stat_buf.st_mtim };
+		times[1].tv_sec += offset_s;
+		return utimensat(AT_FDCWD, path.c_str(), times, 0) == 0;
+	}
+
+	//! Swap a build in over `path` the way a build system does, without writing into the mapped file.
+	bool replace_file(const std::filesystem::path &from, const std::filesystem::path &path, i64 offset_s){
+		const auto tmp_path = path.parent_path() / ".ham-test-plugin-replace";
+		std::filesystem::copy_file(from, tmp_path, std::filesystem::copy_options::overwrite_existing);
+		if(!touch_file(tmp_path, offset_s)) return false;
+
+		std::filesystem::rename(tmp_path, path);
+		return true;
+	}
+
+	bool count_migrated(ham_object *obj, const ham_object_vtable *old_vtable, void *user){
+		(void)obj; (void)old_vtable;
+		++*reinterpret_cast<u32*>(user);
+		return true;
+	}
+
+	bool fail_migrate(ham_object *obj, const ham_object_vtable *old_vtable, void *user){
+		(void)obj; (void)old_vtable;
+		++*reinterpret_cast<u32*>(user);
+		return false;
+	}
+
+	bool test_plugin_reload(const std::filesystem::path &dir, const std::filesystem::path &dso_path){
+		const std::string dir_str = dir.string();
+		constexpr ham::str8 counter_id = "ham_test_plugin_counter";
+
+		ham_plugin *plugin = nullptr;
+		ham_dso_handle dso = nullptr;
+
+		ham_test_assert(ham_plugin_find(HAM_TEST_PLUGIN_NAME, ham::str8(dir_str.c_str()), &plugin, &dso));
+		ham_test_assert(ham_plugin_init(plugin));
+		ham_test_assert(ham_plugin_version(plugin).patch == 0);
+		ham_test_assert(!ham_plugin_changed(plugin));
+
+		const auto counter_vtable = ham_plugin_object(plugin, counter_id);
+		ham_test_assert(counter_vtable != nullptr);
+
+		const auto manager = ham_object_manager_create(counter_vtable);
+		ham_test_assert(manager != nullptr);
+
+		const auto counter = (ham_test_plugin_counter*)ham_object_new(manager);
+		ham_test_assert(counter != nullptr);
+
+		const auto step = [counter]{ return ((const ham_test_plugin_counter_vtable*)ham_super(counter)->vptr)->step(counter); };
+
+		ham_test_assert(step() == 1);
+
+		// registering again only replaces the migrate function
+		u32 num_migrated = 0;
+		ham_test_assert(ham_plugin_add_object_manager(plugin, manager, nullptr, nullptr));
+		ham_test_assert(ham_plugin_add_object_manager(plugin, manager, count_migrated, &num_migrated));
+		ham_test_assert(ham_plugin_remove_object_manager(plugin, manager));
+		ham_test_assert(!ham_plugin_remove_object_manager(plugin, manager));
+		ham_test_assert(ham_plugin_add_object_manager(plugin, manager, count_migrated, &num_migrated));
+
+		// a rebuild that changed the object layout is turned away and the old copy keeps running
+		{
+			ham_test_assert(replace_file(HAM_TEST_PLUGIN_RELAYOUT_PATH, dso_path, 4));
+			ham_test_assert(ham_plugin_changed(plugin));
+
+			const ham_dso_handle loaded_dso = dso;
+			ham_dso_handle old_dso = loaded_dso;
+
+			ham_test_assert(!ham_plugin_reload(plugin, &dso, &old_dso));
+			ham_test_assert(dso == loaded_dso);
+			ham_test_assert(old_dso == nullptr);
+			ham_test_assert(num_migrated == 0);
+			ham_test_assert(ham_object_manager_vtable(manager) == counter_vtable);
+			ham_test_assert(ham_plugin_version(plugin).patch == 0);
+			ham_test_assert(step() == 2);
+		}
+
+		// a failed migration switches every object back and the old copy keeps running
+		{
+			ham_test_assert(ham_plugin_add_object_manager(plugin, manager, fail_migrate, &num_migrated));
+			ham_test_assert(replace_file(HAM_TEST_PLUGIN_REBUILT_PATH, dso_path, 5));
+
+			const ham_dso_handle loaded_dso = dso;
+			ham_dso_handle old_dso = loaded_dso;
+
+			ham_test_assert(!ham_plugin_reload(plugin, &dso, &old_dso));
+			ham_test_assert(dso == loaded_dso);
+			ham_test_assert(old_dso == nullptr);
+			ham_test_assert(num_migrated == 1);
+			ham_test_assert(ham_object_manager_vtable(manager) == counter_vtable);
+			ham_test_assert(ham_super(counter)->vptr == counter_vtable);
+			ham_test_assert(ham_plugin_object(plugin, counter_id) == counter_vtable);
+			ham_test_assert(ham_plugin_version(plugin).patch == 0);
+			ham_test_assert(step() == 3);
+
+			num_migrated = 0;
+			ham_test_assert(ham_plugin_add_object_manager(plugin, manager, count_migrated, &num_migrated));
+		}
+
+		// a compatible rebuild is swapped in and the counter keeps its value but runs the new code
+		{
+			ham_test_assert(replace_file(HAM_TEST_PLUGIN_REBUILT_PATH, dso_path, 6));
+			ham_test_assert(ham_plugin_changed(plugin));
+
+			const ham_dso_handle loaded_dso = dso;
+			ham_dso_handle old_dso = nullptr;
+
+			ham_test_assert(ham_plugin_reload(plugin, &dso, &old_dso));
+			ham_test_assert(dso != loaded_dso);
+			ham_test_assert(old_dso == loaded_dso);
+			ham_test_assert(!ham_plugin_changed(plugin));
+			ham_test_assert(num_migrated == 1);
+			ham_test_assert(ham_plugin_version(plugin).patch == 1);
+
+			const auto rebuilt_vtable = ham_plugin_object(plugin, counter_id);
+			ham_test_assert(rebuilt_vtable != nullptr && rebuilt_vtable != counter_vtable);
+			ham_test_assert(ham_object_manager_vtable(manager) == rebuilt_vtable);
+			ham_test_assert(ham_super(counter)->vptr == rebuilt_vtable);
+			ham_test_assert(step() == 13);
+
+			// nothing points into the old copy anymore
+			ham_dso_close(old_dso);
+		}
+
+		// with nowhere to hand the old copy back to, it is closed by the reload
+		{
+			ham_test_assert(replace_file(HAM_TEST_PLUGIN_REBUILT_PATH, dso_path, 8));
+			ham_test_assert(ham_plugin_reload(plugin, &dso, nullptr));
+			ham_test_assert(num_migrated == 2);
+			ham_test_assert(step() == 23);
+		}
+
+		ham_test_assert(ham_plugin_remove_object_manager(plugin, manager));
+		ham_object_manager_destroy(manager);
+
+		ham_plugin_unload(plugin);
+		ham_dso_close(dso);
+		return true;
+	}
+}
+
+bool ham_test_plugin(){
+	const auto dir = std::filesystem::temp_directory_path() / ("ham-test-plugin-" + std::to_string(getpid()));
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir);
+
+	const auto dso_path = dir / ("libham-test-plugin" HAM_PLATFORM_DSO_EXT);
+	const auto cache_path = dir / ".ham-plugin-cache";
+
+	std::filesystem::copy_file(HAM_TEST_PLUGIN_PATH, dso_path);
+
+	const std::string dir_str = dir.string();
+
+	// a deferred plugin isn't searched for until it's asked for
+	{
+		const auto deferred = ham_plugin_deferred_create(HAM_TEST_PLUGIN_NAME, ham::str8(dir_str.c_str()));
+		ham_test_assert(deferred != nullptr);
+		ham_test_assert(!std::filesystem::exists(cache_path));
+
+		const auto plugin = ham_plugin_deferred_get(deferred);
+		ham_test_assert(plugin != nullptr);
+		ham_test_assert(std::filesystem::exists(cache_path));
+		ham_test_assert(ham_plugin_deferred_get(deferred) == plugin);
+		ham_test_assert(ham_plugin_object(plugin, ham::str8("ham_test_plugin_counter")) != nullptr);
+
+		ham_plugin_deferred_destroy(deferred);
+		std::filesystem::remove(cache_path);
+	}
+
+	// one that isn't there is only searched for once
+	{
+		const auto deferred = ham_plugin_deferred_create("ham-test-plugin-missing", ham::str8(dir_str.c_str()));
+		ham_test_assert(deferred != nullptr);
+		ham_test_assert(ham_plugin_deferred_get(deferred) == nullptr);
+
+		std::filesystem::remove(cache_path);
+		ham_test_assert(ham_plugin_deferred_get(deferred) == nullptr);
+		ham_test_assert(!std::filesystem::exists(cache_path));
+
+		ham_plugin_deferred_destroy(deferred);
+	}
+
+	// a scan finds the plugin and saves what it found
+	{
+		ham_test_assert(!std::filesystem::exists(cache_path));
+		ham_test_assert(find_test_plugin(dir));
+		ham_test_assert(std::filesystem::exists(cache_path));
+
+		const auto cache = read_text(cache_path);
+		ham_test_assert(cache.find("plugin " HAM_TEST_PLUGIN_NAME " ham_impl_vtable_ham_test_plugin\n") != std::string::npos);
+		ham_test_assert(cache.find("object ham_impl_vptr_ham_test_plugin_counter\n") != std::string::npos);
+	}
+
+	// the name with spaces in it is read back from the cache
+	ham_test_assert(find_test_plugin(dir));
+
+	// an up to date cache is trusted, so a file it says holds no plugins isn't opened
+	{
+		const auto cache = read_text(cache_path);
+		const auto plugin_line = cache.find("plugin ");
+		ham_test_assert(plugin_line != std::string::npos);
+
+		write_text(cache_path, cache.substr(0, plugin_line));
+		ham_test_assert(!find_test_plugin(dir));
+	}
+
+	// changing the file invalidates its entry, so it's scanned and cached again
+	{
+		ham_test_assert(touch_file(dso_path, 2));
+		ham_test_assert(find_test_plugin(dir));
+
+		const auto cache = read_text(cache_path);
+		ham_test_assert(cache.find("plugin " HAM_TEST_PLUGIN_NAME " ham_impl_vtable_ham_test_plugin\n") != std::string::npos);
+	}
+
+	// caches written by another version are ignored
+	{
+		const auto cache = read_text(cache_path);
+		const auto plugin_line = cache.find("plugin ");
+		const auto version_end = cache.find('\n');
+		ham_test_assert(plugin_line != std::string::npos && version_end != std::string::npos);
+
+		write_text(cache_path, "ham-plugin-cache 1" + cache.substr(version_end, plugin_line - version_end));
+		ham_test_assert(find_test_plugin(dir));
+		ham_test_assert(read_text(cache_path).find("plugin " HAM_TEST_PLUGIN_NAME " ") != std::string::npos);
+	}
+
+#ifdef HAM_TEST_BENCHMARKS
+	// what startup pays for the plugin: nothing when deferred, otherwise a cached lookup or a directory scan
+	{
+		constexpr u32 num_loads = 100;
+
+		const auto load_us = [&](bool cold){
+			i64 total_ns = 0;
+
+			for(u32 i = 0; i < num_loads; i++){
+				if(cold) std::filesystem::remove(cache_path);
+
+				const auto start = std::chrono::steady_clock::now();
+				const bool found = find_test_plugin(dir);
+				const auto end = std::chrono::steady_clock::now();
+
+				if(!found) return -1.0;
+				total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+			}
+
+			return (total_ns / num_loads) / 1000.0;
+		};
+
+		const auto deferred_start = std::chrono::steady_clock::now();
+
+		for(u32 i = 0; i < num_loads; i++){
+			ham_plugin_deferred_destroy(ham_plugin_deferred_create(HAM_TEST_PLUGIN_NAME, ham::str8(dir_str.c_str())));
+		}
+
+		const auto deferred_end = std::chrono::steady_clock::now();
+		const auto deferred_us = std::chrono::duration_cast<std::chrono::nanoseconds>(deferred_end - deferred_start).count() / num_loads / 1000.0;
+
+		const auto scan_us = load_us(true);
+		const auto cached_us = load_us(false);
+		ham_test_assert(scan_us >= 0.0 && cached_us >= 0.0);
+
+		std::cout << "    plugin startup: deferred " << deferred_us << " us, cached " << cached_us << " us, scanned " << scan_us << " us\n";
+	}
+#endif
+
+	ham_test_assert(test_plugin_reload(dir, dso_path));
+
+	// files that are gone are dropped from the cache
+	{
+		std::filesystem::remove(dso_path);
+		ham_test_assert(!find_test_plugin(dir));
+		ham_test_assert(read_text(cache_path).find("dso ") == std::string::npos);
+	}
+
+	std::filesystem::remove_all(dir);
+	return true;
+}
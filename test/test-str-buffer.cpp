@@ -0,0 +1,148 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/str_buffer.h"
+
+#include "tests.hpp"
+
+using namespace ham::typedefs;
+
+namespace {
+	struct counting_allocator_state{
+		usize num_allocs = 0, num_frees = 0;
+	};
+
+	void *counting_alloc(usize alignment, usize size, void *user){
+		++((counting_allocator_state*)user)->num_allocs;
+		return ham_allocator_alloc(&ham_impl_default_allocator, alignment, size);
+	}
+
+	void counting_free(void *mem, void *user){
+		++((counting_allocator_state*)user)->num_frees;
+		ham_allocator_free(&ham_impl_default_allocator, mem);
+	}
+}
+
+bool ham_test_str_buffer(){
+	counting_allocator_state state;
+	const ham_allocator allocator{ counting_alloc, counting_free, &state };
+
+	// short strings never touch the allocator
+	{
+		ham::str_buffer8 empty(&allocator);
+		ham_test_assert(empty.is_inline() && empty.empty());
+		ham_test_assert(empty.c_str() && empty.c_str()[0] == '\0');
+
+		ham::str_buffer8 name(ham::str8("entity.player.spawn"), &allocator);
+		ham_test_assert(name.is_inline());
+		ham_test_assert(name == ham::str8("entity.player.spawn"));
+		ham_test_assert(name != ham::str8("entity.player.spawm"));
+		ham_test_assert(name.c_str()[name.len()] == '\0');
+
+		ham_test_assert(name.append_format(":{}", 7));
+		ham_test_assert(name == ham::str8("entity.player.spawn:7"));
+		ham_test_assert(name.is_inline());
+
+		ham_test_assert(state.num_allocs == 0);
+
+		// moves carry inline contents over and leave an empty buffer behind
+		auto moved = std::move(name);
+		ham_test_assert(moved == ham::str8("entity.player.spawn:7"));
+		ham_test_assert(name.empty() && name.c_str()[0] == '\0');
+
+		ham_test_assert(state.num_allocs == 0);
+	}
+
+	// spilling to the heap and back through moves
+	{
+		ham::str_buffer8 buf(&allocator);
+
+		for(u32 i = 0; i < 64; i++){
+			ham_test_assert(buf.append_format("{},", i));
+		}
+
+		ham_test_assert(!buf.is_inline());
+		ham_test_assert(buf.get().substr(0, 8) == ham::str8("0,1,2,3,"));
+		ham_test_assert(buf.get().substr(buf.len() - 3) == ham::str8("63,"));
+		ham_test_assert(buf.c_str()[buf.len()] == '\0');
+
+		// appends grow geometrically
+		ham_test_assert(state.num_allocs < 8);
+
+		const auto heap_ptr = buf.ptr();
+
+		ham::str_buffer8 moved(&allocator);
+		moved = std::move(buf);
+		ham_test_assert(moved.ptr() == heap_ptr);
+		ham_test_assert(buf.is_inline() && buf.empty());
+
+		ham_test_assert(moved.prepend(ham::str8("[")) && moved.append(ham::str8("]")));
+		ham_test_assert(moved.get().substr(0, 3) == ham::str8("[0,"));
+		ham_test_assert(moved.get().substr(moved.len() - 4) == ham::str8("63,]"));
+
+		// set from a view of itself
+		ham_test_assert(moved.set(moved.get().substr(1, 4)));
+		ham_test_assert(moved == ham::str8("0,1,"));
+
+		moved.clear();
+		ham_test_assert(moved.empty() && moved.c_str()[0] == '\0');
+	}
+
+	ham_test_assert(state.num_allocs > 0);
+	ham_test_assert(state.num_allocs == state.num_frees);
+
+	// a long format result spills over in one step
+	{
+		const auto line = ham::format("[{}] ({}) {}", "INFO", "ham_test_str_buffer", "a log line that is far longer than the inline storage");
+		ham_test_assert(!line.is_inline());
+		ham_test_assert(line == ham::str8("[INFO] (ham_test_str_buffer) a log line that is far longer than the inline storage"));
+	}
+
+	// wide strings
+	{
+		ham::str_buffer16 wide(ham::str16(u"abc"));
+		ham_test_assert(wide.is_inline());
+
+		for(int i = 0; i < 8; i++){
+			ham_test_assert(wide.append(ham::str16(u"def")));
+		}
+
+		ham_test_assert(!wide.is_inline());
+		ham_test_assert(wide.len() == 27);
+		ham_test_assert(wide.get().substr(21) == ham::str16(u"defdef"));
+
+		ham_test_assert(wide.prepend(ham::str16(u"xyz")));
+		ham_test_assert(wide.get().substr(0, 6) == ham::str16(u"xyzabc"));
+		ham_test_assert(wide.c_str()[wide.len()] == u'\0');
+
+		ham::str_buffer32 wider(ham::str32(U"abcd"));
+		ham_test_assert(wider.resize(12, U'z'));
+		ham_test_assert(wider == ham::str32(U"abcdzzzzzzzz"));
+	}
+
+	// the C API keeps working on heap-allocated buffers
+	{
+		const auto buf = ham_str_buffer_create_utf8(ham::str8("abc"));
+		ham_test_assert(buf);
+		ham_test_assert(ham_str_buffer_append_utf8(buf, ham::str8("def")));
+		ham_test_assert(ham::str8(ham_str_buffer_get_utf8(buf)) == ham::str8("abcdef"));
+		ham_str_buffer_destroy_utf8(buf);
+	}
+
+	return true;
+}
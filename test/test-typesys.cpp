@@ -20,6 +20,10 @@
 
 #include "tests.hpp"
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 using namespace ham::typedefs;
 
 struct ham_typesys_test_type{
@@ -28,6 +32,18 @@ struct ham_typesys_test_type{
 	ham_vec3 v3;
 };
 
+struct ham_typesys_test_nested{
+	u8 tag;
+	ham_typesys_test_type inner;
+	u64 stamp;
+};
+
+struct ham_typesys_test_named{
+	u32 id;
+	ham_str8 name;
+	f32 weight;
+};
+
 bool ham_test_typesys(){
 	ham::typeset ts;
 
@@ -52,6 +68,210 @@ bool ham_test_typesys(){
 
 		ham_test_assert(ham_type_alignment(test_ty) == alignof(ham_typesys_test_type));
 		ham_test_assert(ham_type_size(test_ty) == sizeof(ham_typesys_test_type));
+
+		ham_test_assert(test_ty.member_offset(0) == offsetof(ham_typesys_test_type, b));
+		ham_test_assert(test_ty.member_offset(1) == offsetof(ham_typesys_test_type, f));
+		ham_test_assert(test_ty.member_offset(2) == offsetof(ham_typesys_test_type, v3));
+		ham_test_assert(test_ty.member_padding(0) == offsetof(ham_typesys_test_type, f) - sizeof(bool));
+		ham_test_assert(test_ty.member_padding(2) == sizeof(ham_typesys_test_type) - (offsetof(ham_typesys_test_type, v3) + sizeof(ham_vec3)));
+
+		// padded members are packed in the encoding
+
+		const ham_typesys_test_type objs[] = {
+			{ true,  1.5f, ham_make_vec3(1.f, 2.f, 3.f) },
+			{ false, -2.f, ham_make_vec3(4.f, 5.f, 6.f) },
+		};
+
+		ham::basic_buffer<char> encoded;
+		ham_test_assert(test_ty.serialize(2, objs, encoded) == 2 * (sizeof(bool) + sizeof(f32) + sizeof(ham_vec3)));
+
+		ham_typesys_test_type decoded[2];
+		ham_test_assert(test_ty.deserialize(2, decoded, encoded.size(), encoded.data()) == encoded.size());
+
+		for(usize i = 0; i < 2; i++){
+			ham_test_assert(decoded[i].b == objs[i].b);
+			ham_test_assert(decoded[i].f == objs[i].f);
+			ham_test_assert(memcmp(&decoded[i].v3, &objs[i].v3, sizeof(ham_vec3)) == 0);
+		}
+	}
+
+	// nested objects are flattened in place
+
+	{
+		const auto inner_ty = ts.get(ham::meta::type_name_v<ham_typesys_test_type>);
+		ham_test_assert(inner_ty);
+
+		ham::type_builder builder;
+		ham_test_assert(builder.set_name(ham::meta::type_name_v<ham_typesys_test_nested>));
+		ham_test_assert(builder.add_member("tag",   ham::get_type<u8>(ts)));
+		ham_test_assert(builder.add_member("inner", inner_ty));
+		ham_test_assert(builder.add_member("stamp", ham::get_type<u64>(ts)));
+
+		const auto nested_ty = builder.instantiate(ts);
+		ham_test_assert(nested_ty);
+		ham_test_assert(ham_type_size(nested_ty) == sizeof(ham_typesys_test_nested));
+		ham_test_assert(ham_type_alignment(nested_ty) == alignof(ham_typesys_test_nested));
+
+		const usize expected_offsets[] = {
+			offsetof(ham_typesys_test_nested, tag),
+			offsetof(ham_typesys_test_nested, inner) + offsetof(ham_typesys_test_type, b),
+			offsetof(ham_typesys_test_nested, inner) + offsetof(ham_typesys_test_type, f),
+			offsetof(ham_typesys_test_nested, inner) + offsetof(ham_typesys_test_type, v3),
+			offsetof(ham_typesys_test_nested, stamp),
+		};
+
+		ham_test_assert(nested_ty.num_fields() == std::size(expected_offsets));
+
+		const auto fields = nested_ty.fields();
+		for(usize i = 0; i < std::size(expected_offsets); i++){
+			ham_test_assert(fields[i].offset == expected_offsets[i]);
+			ham_test_assert(!ham_type_is_object(fields[i].type));
+		}
+	}
+
+	{
+		ham::type_builder builder;
+		ham_test_assert(builder.set_name(ham::meta::type_name_v<ham_typesys_test_named>));
+		ham_test_assert(builder.add_member("id",     ham::get_type<u32>(ts)));
+		ham_test_assert(builder.add_member("name",   ham_typeset_str(ts.handle(), HAM_STR_UTF8)));
+		ham_test_assert(builder.add_member("weight", ham::get_type<f32>(ts)));
+
+		const auto named_ty = builder.instantiate(ts);
+		ham_test_assert(named_ty);
+		ham_test_assert(ham_type_size(named_ty) == sizeof(ham_typesys_test_named));
+		ham_test_assert(named_ty.is_serializable());
+
+		const ham_typesys_test_named objs[] = {
+			{ 1, HAM_LIT("first"), 0.25f },
+			{ 2, HAM_LIT(""),      4.f },
+			{ 3, HAM_LIT("third"), -1.f },
+		};
+
+		ham::basic_buffer<char> encoded;
+
+		const auto num_written = named_ty.serialize(3, objs, encoded);
+		ham_test_assert(num_written != (usize)-1 && num_written == encoded.size());
+
+		ham_typesys_test_named decoded[3];
+		ham_test_assert(named_ty.deserialize(3, decoded, encoded.size(), encoded.data()) == encoded.size());
+
+		for(usize i = 0; i < 3; i++){
+			ham_test_assert(decoded[i].id == objs[i].id);
+			ham_test_assert(ham::str8(decoded[i].name) == ham::str8(objs[i].name));
+			ham_test_assert(decoded[i].weight == objs[i].weight);
+		}
+	}
+
+	// derived types are hash-consed
+
+	{
+		const auto f32_ty = ham::get_type<f32>(ts);
+		const auto i32_ty = ham::get_type<i32>(ts);
+
+		ham_test_assert(ham_typeset_vec(ts.handle(), f32_ty, 3) == ts.get(ham::meta::type_name_v<ham_vec3>).ptr());
+
+		const auto ivec3_ty = ham_typeset_vec(ts.handle(), i32_ty, 3);
+		ham_test_assert(ivec3_ty);
+		ham_test_assert(ham_type_size(ivec3_ty) == sizeof(ham_vec3i));
+		ham_test_assert(ham_typeset_vec(ts.handle(), i32_ty, 3) == ivec3_ty);
+		ham_test_assert(ham_type_hash(ivec3_ty) != ham_type_hash(ham_typeset_vec(ts.handle(), f32_ty, 3)));
+
+		const auto void_ptr_ty = ham_typeset_ref(ts.handle(), ham_typeset_void(ts.handle()));
+		ham_test_assert(void_ptr_ty == ts.get(ham::meta::type_name_v<void*>).ptr());
+
+		const auto ivec3_ptr_ty = ham_typeset_ref(ts.handle(), ivec3_ty);
+		ham_test_assert(ivec3_ptr_ty && ivec3_ptr_ty != void_ptr_ty);
+		ham_test_assert(ham_typeset_ref(ts.handle(), ivec3_ty) == ivec3_ptr_ty);
+		ham_test_assert(ts.get(ham_type_name(ivec3_ptr_ty)).ptr() == ivec3_ptr_ty);
+
+		// hashes only depend on structure, so they match across typesets
+		ham::typeset other_ts;
+		const auto other_ivec3_ty = ham_typeset_vec(other_ts.handle(), ham::get_type<i32>(other_ts), 3);
+		ham_test_assert(ham_type_hash(ham_typeset_ref(other_ts.handle(), other_ivec3_ty)) == ham_type_hash(ivec3_ptr_ty));
+	}
+
+	// contention test: readers hammer lookups while writers keep adding types
+
+	{
+		constexpr usize num_readers = 4;
+		constexpr usize num_writers = 2;
+		constexpr usize types_per_writer = 512;
+
+		std::atomic<usize> num_published = 0;
+		std::atomic<bool> done = false;
+		std::atomic<usize> num_lookups = 0;
+		std::atomic<bool> failed = false;
+
+		const auto bool_ty = ham::get_type<bool>(ts);
+		const auto ts_ptr  = ts.handle();
+
+		const ham::str8 test_ty_name = ham::meta::type_name_v<ham_typesys_test_type>;
+
+		std::vector<std::thread> threads;
+
+		for(usize w = 0; w < num_writers; w++){
+			threads.emplace_back([&, w]{
+				for(usize i = 0; i < types_per_writer; i++){
+					const auto name = ham::format("ham_typesys_contention_{}_{}", w, i);
+
+					ham::type_builder builder;
+					builder.set_name(name);
+					builder.add_member("b", bool_ty);
+
+					if(!builder.instantiate(ts)){
+						failed = true;
+						return;
+					}
+
+					++num_published;
+				}
+			});
+		}
+
+		for(usize r = 0; r < num_readers; r++){
+			threads.emplace_back([&]{
+				usize n = 0;
+
+				do{
+					// builtins must always be found, mid-insert or mid-grow
+					if(!ham_typeset_get(ts_ptr, HAM_LIT("f32")) || !ham_typeset_get(ts_ptr, test_ty_name)){
+						failed = true;
+						return;
+					}
+
+					const auto ty = ham_typeset_get(ts_ptr, HAM_LIT("ham_typesys_contention_0_0"));
+					if(ty && ham_type_num_members(ty) != 1){
+						failed = true;
+						return;
+					}
+
+					n += 3;
+				} while(!done.load(std::memory_order_relaxed));
+
+				num_lookups += n;
+			});
+		}
+
+		while(num_published.load() < num_writers * types_per_writer && !failed.load()){
+			std::this_thread::yield();
+		}
+
+		done = true;
+
+		for(auto &&thd : threads){
+			thd.join();
+		}
+
+		ham_test_assert(!failed.load());
+		ham_test_assert(num_lookups.load() > 0);
+
+		for(usize w = 0; w < num_writers; w++){
+			for(usize i = 0; i < types_per_writer; i++){
+				const auto name = ham::format("ham_typesys_contention_{}_{}", w, i);
+				const auto ty = ts.get(name);
+				ham_test_assert(ty && name == ty.name());
+			}
+		}
 	}
 
 	return true;
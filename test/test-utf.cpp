@@ -20,7 +20,10 @@
 
 #include "tests.hpp"
 
+#include <chrono>
 #include <iostream>
+#include <string>
+#include <vector>
 
 using namespace ham::typedefs;
 
@@ -45,5 +48,138 @@ bool ham_test_utf(){
 		++u32idx;
 	}
 
+	// validation
+
+	ham_test_assert(ham_str_validate_utf8(ham::str8(u8str)));
+	ham_test_assert(ham_str_validate_utf32(ham::str32(u32str)));
+
+	constexpr const char *invalid_utf8[] = {
+		"\x80",             // stray continuation
+		"\xC0\xAF",         // overlong '/'
+		"\xE0\x80\xAF",     // overlong '/'
+		"\xED\xA0\x80",     // surrogate
+		"\xF4\x90\x80\x80", // past U+10FFFF
+		"\xF8\x88\x80\x80", // 5 byte lead
+		"\xE2\x82",         // truncated
+	};
+
+	for(const auto bad : invalid_utf8){
+		ham_test_assert(!ham_str_validate_utf8(ham::str8(bad)));
+	}
+
+	// every kernel directly, not just the one dispatched on this CPU
+
+	constexpr const char *kernel_names[HAM_IMPL_UTF8_KERNEL_COUNT] = { "scalar", "SSSE3", "AVX2" };
+
+	std::string long_valid;
+	for(usize i = 0; i < 64; i++){
+		long_valid += (i % 5 == 4) ? HAM_TEST_UTF_STR : "ham_test_utf_kernel";
+	}
+
+	for(u32 kernel = 0; kernel < HAM_IMPL_UTF8_KERNEL_COUNT; kernel++){
+		bool res;
+		if(!ham_impl_str_validate_utf8_kernel(kernel, ham::str8(u8str), &res)){
+			std::cout << "UTF-8 " << kernel_names[kernel] << " kernel not supported, skipping\n";
+			continue;
+		}
+
+		const auto validate = [kernel](const std::string &str){
+			bool ret = false;
+			return ham_impl_str_validate_utf8_kernel(kernel, ham::str8(str.c_str(), str.size()), &ret) && ret;
+		};
+
+		ham_test_assert(res);
+		ham_test_assert(validate(long_valid));
+
+		for(const auto bad : invalid_utf8){
+			ham_test_assert(!validate(bad));
+
+			// at every offset relative to the vector block boundaries
+			for(usize pad = 0; pad < 70; pad++){
+				std::string str(pad, 'x');
+				str += bad;
+				str.append(pad % 7, 'y');
+				ham_test_assert(!validate(str));
+			}
+
+			// and inside a long multibyte string where the vector path is hot
+			for(usize pos = 0; pos < 96; pos += 5){
+				std::string str = long_valid;
+				str.insert(pos, bad);
+				ham_test_assert(!validate(str));
+			}
+		}
+
+		for(usize pad = 0; pad < 70; pad++){
+			std::string str(pad, 'x');
+			str += u8str;
+			str.append(pad % 7, 'y');
+			ham_test_assert(validate(str));
+		}
+	}
+
+	constexpr char16 unpaired_hi[] = { u'a', 0xD83C, u'b' };
+	constexpr char16 unpaired_lo[] = { u'a', 0xDF56 };
+	ham_test_assert(!ham_str_validate_utf16(ham::str16(unpaired_hi, 3)));
+	ham_test_assert(!ham_str_validate_utf16(ham::str16(unpaired_lo, 2)));
+
+	constexpr char32 bad_cps[] = { U'a', 0x110000 };
+	ham_test_assert(!ham_str_validate_utf32(ham::str32(bad_cps, 2)));
+
+	// conversion round trips through a long, mostly ASCII string
+
+	std::string src;
+	for(usize i = 0; i < 4096; i++){
+		src += (i % 64 == 63) ? HAM_TEST_UTF_STR : "ham_test_utf";
+	}
+
+	const ham::str8 src_str(src.c_str(), src.size());
+
+	std::vector<char16> buf16(src.size() + 1);
+	std::vector<char32> buf32(src.size() + 1);
+	std::vector<char8>  buf8(src.size() + 1);
+
+	const usize len16 = ham_str_conv_utf8_utf16(src_str, buf16.data(), buf16.size());
+	const usize len32 = ham_str_conv_utf8_utf32(src_str, buf32.data(), buf32.size());
+	ham_test_assert(len16 != (usize)-1 && len32 != (usize)-1);
+	ham_test_assert(ham_str_validate_utf16(ham::str16(buf16.data(), len16)));
+
+	ham_test_assert(ham_str_conv_utf16_utf8(ham::str16(buf16.data(), len16), buf8.data(), buf8.size()) == src.size());
+	ham_test_assert(ham::str8(buf8.data(), src.size()) == src_str);
+
+	ham_test_assert(ham_str_conv_utf32_utf8(ham::str32(buf32.data(), len32), buf8.data(), buf8.size()) == src.size());
+	ham_test_assert(ham::str8(buf8.data(), src.size()) == src_str);
+
+	// no room for the null terminator
+	ham_test_assert(ham_str_conv_utf32_utf8(ham::str32(buf32.data(), len32), buf8.data(), src.size()) == (usize)-1);
+
+	// throughput
+
+	constexpr usize num_iters = 64;
+
+	const auto t0 = std::chrono::steady_clock::now();
+
+	for(usize i = 0; i < num_iters; i++){
+		ham_test_assert(ham_str_validate_utf8(src_str));
+	}
+
+	const auto t1 = std::chrono::steady_clock::now();
+
+	for(usize i = 0; i < num_iters; i++){
+		ham_test_assert(ham_str_conv_utf8_utf16(src_str, buf16.data(), buf16.size()) == len16);
+	}
+
+	const auto t2 = std::chrono::steady_clock::now();
+
+#ifdef HAM_TEST_BENCHMARKS
+	const auto mib_per_sec = [total = f64(src.size() * num_iters) / (1024.0 * 1024.0)](auto dt){
+		return total / std::chrono::duration<f64>(dt).count();
+	};
+
+	std::cout << "UTF-8 validation: " << mib_per_sec(t1 - t0) << " MiB/s, UTF-8 to UTF-16: " << mib_per_sec(t2 - t1) << " MiB/s\n";
+#else
+	(void)t0; (void)t1; (void)t2;
+#endif
+
 	return true;
 }
@@ -0,0 +1,754 @@
+/*
+ * Ham Runtime Tests
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/engine/world.h"
+#include "ham/engine/entity/draw-instance-component.h"
+#include "ham/renderer-object.h"
+
+#include "tests.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace ham::typedefs;
+
+ham_declare_object(ham_test_entity, ham_entity)
+
+struct ham_test_entity{
+	ham_derive(ham_entity)
+
+	ham_u32 tag;
+	ham_f32 health;
+	ham_str8 name;
+};
+
+struct ham_test_entity_vtable{
+	ham_derive(ham_entity_vtable)
+};
+
+// snapshots restore entities without constructing them
+static usize ham_test_entity_num_ctors = 0, ham_test_entity_num_restores = 0;
+
+static ham_test_entity *ham_test_entity_ctor(ham_test_entity *ent, ham_u32 nargs, va_list va){
+	++ham_test_entity_num_ctors;
+
+	ent->tag    = nargs > 0 ? va_arg(va, ham_u32) : 0;
+	ent->health = 100.f;
+	ent->name   = HAM_EMPTY_STR8;
+	return ent;
+}
+
+static void ham_test_entity_dtor(ham_test_entity *ent){ (void)ent; }
+
+static bool ham_test_entity_restore(ham_entity *ent){
+	(void)ent;
+	++ham_test_entity_num_restores;
+	return true;
+}
+
+ham_define_object_x(
+	2, ham_test_entity,
+	1, ham_entity_vtable,
+	ham_test_entity_ctor,
+	ham_test_entity_dtor,
+	(
+		.tick = nullptr,
+		.restore = ham_test_entity_restore,
+	)
+)
+
+ham_declare_object(ham_test_component, ham_entity_component)
+
+struct ham_test_component{
+	ham_derive(ham_entity_component)
+
+	ham_u32 value;
+	ham_vec3 offset;
+};
+
+struct ham_test_component_vtable{
+	ham_derive(ham_entity_component_vtable)
+};
+
+static ham_test_component *ham_test_component_ctor(ham_test_component *comp, ham_u32 nargs, va_list va){
+	comp->value  = nargs > 0 ? va_arg(va, ham_u32) : 0;
+	comp->offset = ham_make_vec3(0.f, 0.f, 0.f);
+	return comp;
+}
+
+static void ham_test_component_dtor(ham_test_component *comp){ (void)comp; }
+
+ham_define_object_x(
+	2, ham_test_component,
+	1, ham_entity_component_vtable,
+	ham_test_component_ctor,
+	ham_test_component_dtor,
+	(
+		.update = nullptr,
+	)
+)
+
+// Draw group without a renderer, instance data lives in plain memory
+
+ham_declare_object(ham_test_draw_group, ham_draw_group)
+
+struct ham_test_draw_group{
+	ham_derive(ham_draw_group)
+
+	std::vector<ham_draw_group_instance_data> instances;
+};
+
+struct ham_test_draw_group_vtable{
+	ham_derive(ham_draw_group_vtable)
+};
+
+static ham_test_draw_group *ham_test_draw_group_ctor(ham_test_draw_group *mem, ham_u32 nargs, va_list va){
+	(void)nargs; (void)va;
+
+	const auto group = new(mem) ham_test_draw_group;
+	if(!ham_mutex_init(&ham_super(group)->mut, HAM_MUTEX_NORMAL)){
+		std::destroy_at(group);
+		return nullptr;
+	}
+
+	return group;
+}
+
+static void ham_test_draw_group_dtor(ham_test_draw_group *group){
+	ham_mutex_finish(&ham_super(group)->mut);
+	std::destroy_at(group);
+}
+
+static bool ham_test_draw_group_set_num_instances(ham_test_draw_group *group, ham_u32 n){
+	group->instances.resize(n, ham_draw_group_instance_data{ .trans = ham_mat4_identity(), .normal_mat = ham_mat4_identity() });
+	return true;
+}
+
+static ham_draw_group_instance_data *ham_test_draw_group_instance_data(ham_test_draw_group *group){
+	return group->instances.data();
+}
+
+ham_define_draw_group(ham_test_draw_group)
+
+namespace {
+	const ham_entity_vtable *test_entity_vptr(){
+		return (const ham_entity_vtable*)ham_impl_vptr_ham_test_entity();
+	}
+
+	ham_entity *create_test_entity(ham_world *world, ham_u32 tag){
+		return ham_entity_create(world, test_entity_vptr(), tag);
+	}
+
+	const ham_entity_component_vtable *test_component_vptr(){
+		return (const ham_entity_component_vtable*)ham_impl_vptr_ham_test_component();
+	}
+
+	//! Snapshot types for the test entity and component, members after their bases.
+	bool make_snapshot_types(ham::typeset &ts, const ham_type **ret){
+		{
+			ham::type_builder builder;
+			ham_test_assert(builder.set_kind(HAM_TYPE_OBJECT));
+			ham_test_assert(builder.set_name("ham_test_entity"));
+			ham_test_assert(builder.set_vptr(ham_impl_vptr_ham_test_entity()));
+			ham_test_assert(builder.add_member("tag",    ham::get_type<u32>(ts)));
+			ham_test_assert(builder.add_member("health", ham::get_type<f32>(ts)));
+			ham_test_assert(builder.add_member("name",   ham_typeset_str(ts.handle(), HAM_STR_UTF8)));
+
+			ret[0] = builder.instantiate(ts);
+			ham_test_assert(ret[0] != nullptr);
+		}
+
+		{
+			ham::type_builder builder;
+			ham_test_assert(builder.set_kind(HAM_TYPE_OBJECT));
+			ham_test_assert(builder.set_name("ham_test_component"));
+			ham_test_assert(builder.set_vptr(ham_impl_vptr_ham_test_component()));
+			ham_test_assert(builder.add_member("value",  ham::get_type<u32>(ts)));
+			ham_test_assert(builder.add_member("offset", ham::get_type<ham_vec3>(ts)));
+
+			ret[1] = builder.instantiate(ts);
+			ham_test_assert(ret[1] != nullptr);
+		}
+
+		return true;
+	}
+
+	//! Entities of a world by tag, tags must be unique.
+	std::vector<ham_test_entity*> entities_by_tag(ham_world *world, u32 max_tag){
+		std::vector<ham_test_entity*> ret(max_tag, nullptr);
+
+		const auto num_ents = ham_world_num_transforms(world);
+		const auto ents = ham_world_transform_entities(world);
+
+		for(usize i = 0; i < num_ents; i++){
+			const auto ent = (ham_test_entity*)ents[i];
+			if(ent && ent->tag < max_tag) ret[ent->tag] = ent;
+		}
+
+		return ret;
+	}
+
+	bool check_same_entity(ham_test_entity *a, ham_test_entity *b){
+		const auto a_ent = ham_super(a);
+		const auto b_ent = ham_super(b);
+
+		ham_test_assert(a->tag == b->tag);
+		ham_test_assert(a->health == b->health);
+		ham_test_assert(ham::str8(a->name) == ham::str8(b->name));
+
+		ham_test_assert(memcmp(&a_ent->transform.pos,   &b_ent->transform.pos,   sizeof(ham_vec3)) == 0);
+		ham_test_assert(memcmp(&a_ent->transform.scale, &b_ent->transform.scale, sizeof(ham_vec3)) == 0);
+		ham_test_assert(memcmp(&a_ent->transform.pyr,   &b_ent->transform.pyr,   sizeof(ham_vec3)) == 0);
+
+		ham_test_assert((a_ent->parent == nullptr) == (b_ent->parent == nullptr));
+		if(a_ent->parent){
+			ham_test_assert(((ham_test_entity*)a_ent->parent)->tag == ((ham_test_entity*)b_ent->parent)->tag);
+		}
+
+		const auto num_comps = ham_buffer_size(&a_ent->components) / sizeof(ham_entity_component*);
+		ham_test_assert(ham_buffer_size(&b_ent->components) / sizeof(ham_entity_component*) == num_comps);
+
+		const auto a_comps = (ham_test_component**)ham_buffer_data(&a_ent->components);
+		const auto b_comps = (ham_test_component**)ham_buffer_data(&b_ent->components);
+
+		for(usize i = 0; i < num_comps; i++){
+			ham_test_assert(ham_super(b_comps[i])->ent == b_ent);
+			ham_test_assert(a_comps[i]->value == b_comps[i]->value);
+			ham_test_assert(memcmp(&a_comps[i]->offset, &b_comps[i]->offset, sizeof(ham_vec3)) == 0);
+		}
+
+		return true;
+	}
+
+	bool mat_eq(const ham_mat4 &a, const ham_mat4 &b){
+		for(usize i = 0; i < 16; i++){
+			if(std::fabs(a.data[i] - b.data[i]) > DEFAULT_EPSILON) return false;
+		}
+
+		return true;
+	}
+
+	//! World matrix of `ent` composed up the parent chain without the hierarchy.
+	ham_mat4 expected_world_matrix(const ham_entity *ent){
+		ham_mat4 ret = ham_transform_matrix(&ent->transform);
+
+		for(auto it = ent->parent; it; it = it->parent){
+			ret = ham_mat4_mul(ham_transform_matrix(&it->transform), ret);
+		}
+
+		return ret;
+	}
+
+	bool check_parent_order(ham_world *world){
+		const auto num_ents = ham_world_num_transforms(world);
+		const auto ents = ham_world_transform_entities(world);
+
+		for(usize i = 0; i < num_ents; i++){
+			if(!ents[i]) return false;
+
+			const auto parent = ents[i]->parent;
+			if(!parent) continue;
+
+			// every parent has to be visited before its children
+			if(std::find(ents, ents + i, parent) == ents + i) return false;
+		}
+
+		return true;
+	}
+
+	bool test_world_hierarchy(){
+		const auto world = ham_world_create(HAM_LIT_UTF8("test-world"));
+		ham_test_assert(world != nullptr);
+
+		// create children before their parents so the rebuild has to reorder
+
+		ham_entity *leaves[8];
+		for(u32 i = 0; i < std::size(leaves); i++){
+			leaves[i] = create_test_entity(world, 100 + i);
+			ham_test_assert(leaves[i] != nullptr);
+		}
+
+		const auto mid = create_test_entity(world, 1);
+		const auto root = create_test_entity(world, 0);
+		ham_test_assert(mid && root);
+
+		ham_test_assert(ham_entity_set_parent(mid, root));
+
+		for(u32 i = 0; i < std::size(leaves); i++){
+			ham_test_assert(ham_entity_set_parent(leaves[i], mid));
+			ham_transform_set_position(&leaves[i]->transform, ham_make_vec3((f32)i, 1.f, -2.f));
+			ham_transform_set_rotation(&leaves[i]->transform, ham_make_vec3(0.1f * (f32)i, 0.f, 0.25f));
+		}
+
+		ham_transform_set_position(&root->transform, ham_make_vec3(4.f, 5.f, 6.f));
+		ham_transform_set_scale(&mid->transform, ham_make_vec3(2.f, 2.f, 2.f));
+
+		const usize num_ents = std::size(leaves) + 2;
+
+		ham_test_assert(ham_world_update_transforms(world) == num_ents);
+		ham_test_assert(ham_world_num_transforms(world) == num_ents);
+		ham_test_assert(check_parent_order(world));
+
+		for(const auto ent : leaves){
+			ham_test_assert(mat_eq(ham_entity_world_matrix(ent), expected_world_matrix(ent)));
+		}
+
+		// nothing changed, nothing recomputed
+		ham_test_assert(ham_world_update_transforms(world) == 0);
+
+		// flipping the sign of a zero isn't a change
+		ham_transform_set_rotation(&leaves[0]->transform, ham_make_vec3(-0.f, -0.f, 0.25f));
+		ham_test_assert(ham_world_update_transforms(world) == 0);
+
+		// moving a single leaf only touches that leaf
+		ham_transform_translate(&leaves[3]->transform, ham_make_vec3(0.f, 0.f, 1.f));
+		ham_test_assert(ham_world_update_transforms(world) == 1);
+		ham_test_assert(mat_eq(ham_entity_world_matrix(leaves[3]), expected_world_matrix(leaves[3])));
+
+		{
+			const auto changes = ham_world_transform_changes(world);
+			const auto ents = ham_world_transform_entities(world);
+
+			for(usize i = 0; i < num_ents; i++){
+				ham_test_assert((changes[i] != 0) == (ents[i] == leaves[3]));
+			}
+		}
+
+		// moving the root dirties the whole subtree
+		ham_transform_set_rotation(&root->transform, ham_make_vec3(0.f, 0.5f, 0.f));
+		ham_test_assert(ham_world_update_transforms(world) == num_ents);
+
+		for(const auto ent : leaves){
+			ham_test_assert(mat_eq(ham_entity_world_matrix(ent), expected_world_matrix(ent)));
+		}
+
+		// re-parenting forces the moved subtree and removal compacts the arrays
+
+		ham_test_assert(ham_entity_set_parent(leaves[0], root));
+		ham_entity_destroy(leaves[7]);
+
+		ham_test_assert(ham_world_update_transforms(world) == 1);
+		ham_test_assert(ham_world_num_transforms(world) == num_ents - 1);
+		ham_test_assert(check_parent_order(world));
+
+		for(u32 i = 0; i < 7; i++){
+			ham_test_assert(mat_eq(ham_entity_world_matrix(leaves[i]), expected_world_matrix(leaves[i])));
+		}
+
+		// destroying a parent takes its children with it
+		ham_entity_destroy(mid);
+
+		ham_test_assert(ham_world_update_transforms(world) == 0);
+		ham_test_assert(ham_world_num_transforms(world) == 2);
+		ham_test_assert(check_parent_order(world));
+
+		ham_world_destroy(world);
+		return true;
+	}
+
+	bool test_world_snapshot(){
+		ham::typeset ts;
+
+		const ham_type *snapshot_types[2];
+		ham_test_assert(make_snapshot_types(ts, snapshot_types));
+
+		const auto dir = std::filesystem::temp_directory_path() / ("ham-test-world-" + std::to_string(getpid()));
+		std::filesystem::create_directories(dir);
+
+		const auto path = (dir / "world.hamw").string();
+
+		constexpr u32 num_ents = 20000;
+
+		const auto src = ham_world_create(HAM_LIT_UTF8("test-world-src"));
+		ham_test_assert(src != nullptr);
+
+		// loaded names must not point into these or the file
+		std::vector<std::string> names(num_ents);
+
+		{
+			std::vector<ham_entity*> ents(num_ents);
+
+			for(u32 i = 0; i < num_ents; i++){
+				const auto ent = create_test_entity(src, i);
+				ham_test_assert(ent != nullptr);
+
+				const auto test_ent = (ham_test_entity*)ent;
+				test_ent->health = 0.5f * (f32)i;
+
+				if(i % 3 == 0){
+					names[i] = "entity-" + std::to_string(i);
+					test_ent->name = ham::str8(names[i].c_str());
+				}
+
+				ham_transform_set_position(&ent->transform, ham_make_vec3((f32)i, (f32)(i % 17), -(f32)i));
+				ham_transform_set_rotation(&ent->transform, ham_make_vec3(0.f, 0.001f * (f32)i, 0.f));
+
+				// every fifth entity gets two components in a known order
+				if(i % 5 == 0){
+					const auto first  = (ham_test_component*)ham_entity_component_create(ent, test_component_vptr(), i * 2);
+					const auto second = (ham_test_component*)ham_entity_component_create(ent, test_component_vptr(), i * 2 + 1);
+					ham_test_assert(first && second);
+
+					second->offset = ham_make_vec3(1.f, 2.f, (f32)i);
+				}
+
+				// binary trees of 8 entities
+				const auto tree_idx = i % 8;
+				if(tree_idx != 0){
+					ham_test_assert(ham_entity_set_parent(ent, ents[(i - tree_idx) + (tree_idx - 1) / 2]));
+				}
+
+				ents[i] = ent;
+			}
+
+			ham_test_assert(ham_world_update_transforms(src) == num_ents);
+
+			const auto start = std::chrono::steady_clock::now();
+			ham_test_assert(ham_world_save_snapshot(src, ham::str8(path.c_str()), std::size(snapshot_types), snapshot_types));
+			const auto end = std::chrono::steady_clock::now();
+
+#ifdef HAM_TEST_BENCHMARKS
+			const auto save_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+			std::cout << "    saved " << num_ents << " entities (" << std::filesystem::file_size(path) << " bytes) in " << save_us << " us\n";
+#else
+			(void)start; (void)end;
+#endif
+		}
+
+		const auto dst = ham_world_create(HAM_LIT_UTF8("test-world-dst"));
+		ham_test_assert(dst != nullptr);
+
+		{
+			const auto num_ctors = ham_test_entity_num_ctors;
+			ham_test_entity_num_restores = 0;
+
+			const auto start = std::chrono::steady_clock::now();
+			ham_test_assert(ham_world_load_snapshot(dst, ham::str8(path.c_str()), std::size(snapshot_types), snapshot_types) == num_ents);
+			const auto end = std::chrono::steady_clock::now();
+
+			ham_test_assert(ham_test_entity_num_ctors == num_ctors);
+			ham_test_assert(ham_test_entity_num_restores == num_ents);
+
+#ifdef HAM_TEST_BENCHMARKS
+			const auto load_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+			std::cout << "    loaded " << num_ents << " entities in " << load_us << " us\n";
+
+			// target is a million entities a second, one per microsecond
+			ham_test_assert((u64)load_us <= (u64)num_ents);
+#else
+			(void)start; (void)end;
+#endif
+		}
+
+		std::filesystem::remove_all(dir);
+
+		ham_test_assert(ham_world_update_transforms(dst) == num_ents);
+
+		const auto src_ents = entities_by_tag(src, num_ents);
+		const auto dst_ents = entities_by_tag(dst, num_ents);
+
+		for(u32 i = 0; i < num_ents; i++){
+			ham_test_assert(src_ents[i] && dst_ents[i]);
+			ham_test_assert(check_same_entity(src_ents[i], dst_ents[i]));
+			ham_test_assert(mat_eq(ham_entity_world_matrix(ham_super(src_ents[i])), ham_entity_world_matrix(ham_super(dst_ents[i]))));
+		}
+
+		ham_world_destroy(src);
+		names = {};
+
+		for(u32 i = 0; i < num_ents; i += 3){
+			const auto expected = "entity-" + std::to_string(i);
+			ham_test_assert(ham::str8(dst_ents[i]->name) == ham::str8(expected.c_str()));
+		}
+
+		ham_world_destroy(dst);
+		return true;
+	}
+
+	bool test_world_draw_instances(){
+		constexpr u32 num_insts = 16;
+
+		const auto group_man = ham_object_manager_create(ham_impl_vptr_ham_test_draw_group());
+		ham_test_assert(group_man != nullptr);
+
+		const auto group = (ham_test_draw_group*)ham_object_new(group_man);
+		ham_test_assert(group != nullptr);
+		ham_test_assert(ham_draw_group_set_num_instances(ham_super(group), num_insts));
+
+		const auto world = ham_world_create(HAM_LIT_UTF8("test-world-draw"));
+		ham_test_assert(world != nullptr);
+
+		const auto group_handle = ham_world_add_draw_group(world, ham_super(group));
+		ham_test_assert(group_handle != HAM_WORLD_DRAW_GROUP_NONE);
+		ham_test_assert(ham_world_add_draw_group(world, ham_super(group)) == group_handle);
+
+		const auto draw_vptr = (const ham_entity_component_vtable*)ham_impl_vptr_ham_entity_component_draw_instance();
+
+		// pairs of root and child, instance ids in reverse creation order
+		std::vector<ham_entity*> ents(num_insts);
+		std::vector<ham_entity_component_draw_instance*> comps(num_insts);
+
+		for(u32 i = 0; i < num_insts; i++){
+			ents[i] = create_test_entity(world, i);
+			ham_test_assert(ents[i] != nullptr);
+
+			ham_transform_set_position(&ents[i]->transform, ham_make_vec3((f32)i, 1.f, -2.f));
+			ham_transform_set_scale(&ents[i]->transform, ham_make_vec3(1.f, 2.f, 1.f));
+
+			if(i % 2 == 1){
+				ham_test_assert(ham_entity_set_parent(ents[i], ents[i - 1]));
+			}
+
+			comps[i] = (ham_entity_component_draw_instance*)ham_entity_component_create(ents[i], draw_vptr, group_handle, num_insts - 1 - i);
+			ham_test_assert(comps[i] != nullptr);
+		}
+
+		//! Every instance holds the world matrix of its entity.
+		const auto check_synced = [&]{
+			for(u32 i = 0; i < num_insts; i++){
+				const auto world_mat = ham_entity_world_matrix(ents[i]);
+				const auto &inst = group->instances[comps[i]->id];
+
+				ham_test_assert(mat_eq(inst.trans, world_mat));
+				ham_test_assert(mat_eq(inst.normal_mat, ham_mat4_transpose(ham_mat4_inverse(world_mat))));
+			}
+
+			return true;
+		};
+
+		// nothing is written before the first transform update places the entities
+		ham_test_assert(ham_world_sync_draw_instances(world) == 0);
+
+		ham_test_assert(ham_world_update_transforms(world) == num_insts);
+		ham_test_assert(ham_world_sync_draw_instances(world) == num_insts);
+		ham_test_assert(check_synced());
+
+		// unchanged entities are skipped
+		ham_test_assert(ham_world_update_transforms(world) == 0);
+		ham_test_assert(ham_world_sync_draw_instances(world) == 0);
+
+		// moving a root moves its child's instance too
+		ham_transform_set_position(&ents[4]->transform, ham_make_vec3(10.f, 20.f, 30.f));
+		ham_transform_set_rotation(&ents[4]->transform, ham_make_vec3(0.f, 0.5f, 0.25f));
+
+		ham_test_assert(ham_world_update_transforms(world) == 2);
+		ham_test_assert(ham_world_sync_draw_instances(world) == 2);
+		ham_test_assert(check_synced());
+
+		// a moved component writes its new instance even though its entity stayed put
+		ham_test_assert(ham_entity_component_draw_instance_set(comps[0], group_handle, num_insts - 1));
+		ham_test_assert(ham_entity_component_draw_instance_set(comps[num_insts - 1], group_handle, 0));
+
+		ham_test_assert(ham_world_update_transforms(world) == 0);
+		ham_test_assert(ham_world_sync_draw_instances(world) == 2);
+		ham_test_assert(check_synced());
+
+		// destroyed entities drop out of their batch
+		ham_entity_destroy(ents[2]);
+		ents.erase(ents.begin() + 2, ents.begin() + 4);
+		comps.erase(comps.begin() + 2, comps.begin() + 4);
+
+		ham_transform_set_position(&ents[0]->transform, ham_make_vec3(-5.f, 0.f, 0.f));
+
+		ham_test_assert(ham_world_update_transforms(world) == 2);
+		ham_test_assert(ham_world_sync_draw_instances(world) == 2);
+
+		// a removed group is never touched again, even by components still holding its handle
+		const auto saved = group->instances[comps[0]->id];
+
+		ham_test_assert(ham_world_remove_draw_group(world, group_handle));
+
+		ham_transform_set_position(&ents[0]->transform, ham_make_vec3(5.f, 0.f, 0.f));
+
+		ham_test_assert(ham_world_update_transforms(world) == 2);
+		ham_test_assert(ham_world_sync_draw_instances(world) == 0);
+		ham_test_assert(mat_eq(group->instances[comps[0]->id].trans, saved.trans));
+
+		// and its handle isn't handed out again
+		ham_test_assert(ham_world_add_draw_group(world, ham_super(group)) != group_handle);
+
+		ham_world_destroy(world);
+
+		ham_object_delete(group_man, ham_super(ham_super(group)));
+		ham_object_manager_destroy(group_man);
+		return true;
+	}
+
+	//! Number of live test entities in `world`.
+	usize count_entities(ham_world *world, u32 max_tag){
+		ham_world_update_transforms(world);
+
+		const auto ents = entities_by_tag(world, max_tag);
+		return (usize)std::count_if(ents.begin(), ents.end(), [](ham_test_entity *ent){ return ent != nullptr; });
+	}
+
+	//! Update `streamer` around `pois` until `num_expected` entities are resident.
+	bool stream_in(ham_world_streamer *streamer, ham_world *world, u32 max_tag, usize num_pois, const ham_vec3 *pois, usize num_expected){
+		for(usize i = 0; i < 5000; i++){
+			ham_test_assert(ham_world_streamer_update(streamer, num_pois, pois) != (usize)-1);
+			if(count_entities(world, max_tag) == num_expected) return true;
+			usleep(1000);
+		}
+
+		return false;
+	}
+
+	bool test_world_streaming(){
+		ham::typeset ts;
+
+		const ham_type *types[2];
+		ham_test_assert(make_snapshot_types(ts, types));
+
+		const auto dir = std::filesystem::temp_directory_path() / ("ham-test-world-stream-" + std::to_string(getpid()));
+		std::filesystem::create_directories(dir);
+
+		constexpr f64 region_size = 100.0;
+		constexpr u32 num_regions = 4;
+		constexpr u32 num_ents = 64;
+
+		const auto region_center = [](u32 region){ return ham_make_vec3(50.f + 100.f * (f32)region, 50.f, 50.f); };
+
+		const auto world = ham_world_create(HAM_LIT_UTF8("test-world-stream"));
+		ham_test_assert(world != nullptr);
+
+		// root and child pairs spread over the first few regions
+		for(u32 i = 0; i < num_ents; i += 2){
+			const auto root  = create_test_entity(world, i);
+			const auto child = create_test_entity(world, i + 1);
+			ham_test_assert(root && child);
+
+			((ham_test_entity*)root)->health  = 0.25f * (f32)i;
+			((ham_test_entity*)child)->health = 0.25f * (f32)(i + 1);
+			((ham_test_entity*)root)->name    = HAM_LIT_UTF8("streamed");
+
+			ham_transform_set_position(&root->transform, region_center((i / 2) % num_regions));
+			ham_transform_set_position(&child->transform, ham_make_vec3(1.f, 2.f, (f32)i));
+			ham_test_assert(ham_entity_set_parent(child, root));
+
+			if(i % 8 == 0){
+				ham_test_assert(ham_entity_component_create(root, test_component_vptr(), i));
+			}
+		}
+
+		const auto streamer = ham_world_streamer_create(world, ham::str8(dir.c_str()), region_size, std::size(types), types);
+		ham_test_assert(streamer != nullptr);
+		ham_test_assert(ham_world_streamer_set_prefetch_radius(streamer, 0.0));
+
+		// only the first region is tracked, everything else is stored by where it is when evicted
+		{
+			const auto poi = region_center(0);
+			ham_test_assert(stream_in(streamer, world, num_ents, 1, &poi, num_ents));
+		}
+
+		ham_test_assert(ham_world_streamer_flush(streamer));
+		ham_test_assert(count_entities(world, num_ents) == 0);
+
+		for(u32 i = 0; i < num_regions; i++){
+			const auto file = dir / ("region." + std::to_string(i) + ".0.0.hamw");
+			ham_test_assert(std::filesystem::exists(file));
+		}
+
+		// region files are written to the side and renamed into place, nothing else is left behind
+		for(const auto &entry : std::filesystem::directory_iterator(dir)){
+			ham_test_assert(entry.path().extension() == ".hamw");
+		}
+
+		// stream everything back in
+		{
+			ham_vec3 pois[num_regions];
+			for(u32 i = 0; i < num_regions; i++) pois[i] = region_center(i);
+
+			ham_test_assert(stream_in(streamer, world, num_ents, num_regions, pois, num_ents));
+			ham_test_assert(ham_world_streamer_resident_bytes(streamer) == num_ents * sizeof(ham_test_entity));
+		}
+
+		{
+			const auto ents = entities_by_tag(world, num_ents);
+
+			for(u32 i = 0; i < num_ents; i++){
+				const auto ent = ents[i];
+				ham_test_assert(ent != nullptr);
+				ham_test_assert(ent->health == 0.25f * (f32)i);
+
+				const auto base = ham_super(ent);
+				const auto num_comps = ham_buffer_size(&base->components) / sizeof(ham_entity_component*);
+
+				if(i % 2 == 0){
+					const auto expected = region_center((i / 2) % num_regions);
+					ham_test_assert(memcmp(&base->transform.pos, &expected, sizeof(ham_vec3)) == 0);
+					ham_test_assert(base->parent == nullptr);
+					ham_test_assert(ham::str8(ent->name) == "streamed");
+					ham_test_assert(num_comps == (i % 8 == 0 ? 1 : 0));
+				}
+				else{
+					ham_test_assert(base->parent == ham_super(ents[i - 1]));
+					ham_test_assert(num_comps == 0);
+				}
+			}
+
+			// move two trees into a region nobody is tracking, in separate evictions so its file gets appended twice
+			ham_transform_set_position(&ham_super(ents[0])->transform, region_center(7));
+		}
+
+		ham_test_assert(ham_world_streamer_flush(streamer));
+		ham_test_assert(count_entities(world, num_ents) == 0);
+
+		{
+			const auto poi = region_center(1);
+			ham_test_assert(stream_in(streamer, world, num_ents, 1, &poi, num_ents / num_regions));
+
+			const auto ents = entities_by_tag(world, num_ents);
+			ham_test_assert(ents[2] != nullptr);
+			ham_transform_set_position(&ham_super(ents[2])->transform, region_center(7));
+		}
+
+		ham_test_assert(ham_world_streamer_flush(streamer));
+		ham_test_assert(count_entities(world, num_ents) == 0);
+
+		{
+			const auto poi = region_center(7);
+			ham_test_assert(stream_in(streamer, world, num_ents, 1, &poi, 4));
+
+			const auto ents = entities_by_tag(world, num_ents);
+			for(u32 i = 0; i < 4; i++){
+				ham_test_assert(ents[i] != nullptr);
+			}
+
+			ham_test_assert(ham_super(ents[1])->parent == ham_super(ents[0]));
+			ham_test_assert(ham_super(ents[3])->parent == ham_super(ents[2]));
+		}
+
+		ham_test_assert(ham_world_streamer_flush(streamer));
+		ham_world_streamer_destroy(streamer);
+
+		ham_world_destroy(world);
+		std::filesystem::remove_all(dir);
+		return true;
+	}
+}
+
+bool ham_test_world(){
+	return test_world_hierarchy() && test_world_snapshot() && test_world_streaming() && test_world_draw_instances();
+}
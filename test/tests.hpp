@@ -47,6 +47,18 @@ ham_declare_test(quat)
 ham_declare_test(transform)
 ham_declare_test(camera)
 ham_declare_test(typesys)
+ham_declare_test(intern)
+ham_declare_test(hash)
+ham_declare_test(flat_map)
+ham_declare_test(str_buffer)
+ham_declare_test(log)
+ham_declare_test(fs)
+ham_declare_test(plugin)
+
+#ifdef HAM_TEST_ENGINE
+ham_declare_test(world)
+ham_declare_test(model)
+#endif
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_LEFT_HANDED
@@ -0,0 +1,571 @@
+/*
+ * Ham Asset Cooker
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/fs.h"
+#include "ham/async.h"
+#include "ham/audio.h"
+#include "ham/image.h"
+
+#include "ham/engine/model.h"
+#include "ham/engine/graph.h"
+#include "ham/engine/types.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ham::typedefs;
+
+namespace fs = std::filesystem;
+
+// bump whenever the manifest layout changes
+#define HAM_COOK_MANIFEST_VERSION 3
+
+#define HAM_COOK_MANIFEST_NAME "cook-manifest"
+
+enum class asset_kind: u32{
+	image, model, audio, graph,
+
+	count
+};
+
+static const char *const asset_kind_names[] = { "image", "model", "audio", "graph" };
+
+struct file_stamp{
+	i64 mtime_ns = -1; // -1 means the file is missing
+	u64 size = 0;
+
+	bool operator==(const file_stamp&) const noexcept = default;
+};
+
+struct cook_dep{
+	std::string path; // relative to the project directory
+	file_stamp stamp;
+};
+
+struct cook_entry{
+	asset_kind kind;
+	std::string path; // relative to the project directory
+	file_stamp stamp;
+	ham_asset_key key = { 0, 0 }; // of the cache entry holding the cooked asset, zero if nothing is stored
+	std::vector<cook_dep> deps;
+};
+
+struct cook_job{
+	cook_entry entry;
+	bool up_to_date = false;
+	bool ok = false;
+};
+
+static void print_usage(const char *argv0){
+	fprintf(stderr, "Usage: %s [-h|--help] [-j JOBS] [-o OUT_DIR] [-f|--force] [-v|--verbose] PROJECT_DIR\n", argv0);
+	fprintf(stderr, "Cook the images, models, audio and graphs in a project into the asset cache used at runtime.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  -j JOBS     number of cooking threads, defaults to the number of cores\n");
+	fprintf(stderr, "  -o OUT_DIR  cache directory, defaults to PROJECT_DIR/.ham-cache\n");
+	fprintf(stderr, "  -f          cook everything, even if it looks up to date\n");
+	fprintf(stderr, "  -v          print every asset as it is cooked\n");
+}
+
+static file_stamp stat_file(const fs::path &path){
+	struct stat st;
+	if(stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)){
+		return {};
+	}
+
+	return { (i64)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec, (u64)st.st_size };
+}
+
+static bool classify_asset(const fs::path &rel_path, asset_kind *ret){
+	static const char *const image_exts[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".gif", ".psd", ".hdr", ".exr", ".tif", ".tiff", ".dds", ".webp" };
+	static const char *const model_exts[] = { ".obj", ".fbx", ".gltf", ".glb", ".dae", ".3ds", ".blend", ".ply", ".stl" };
+	static const char *const audio_exts[] = { ".wav", ".ogg", ".flac", ".aif", ".aiff", ".opus", ".mp3" };
+
+	const auto ext = rel_path.extension().string();
+
+	const auto match = [&ext](const auto &exts){
+		for(auto &&e : exts){
+			if(strcasecmp(ext.c_str(), e) == 0) return true;
+		}
+		return false;
+	};
+
+	if(match(image_exts)){ *ret = asset_kind::image; return true; }
+	if(match(model_exts)){ *ret = asset_kind::model; return true; }
+	if(match(audio_exts)){ *ret = asset_kind::audio; return true; }
+
+	// graphs are the json files the editor saves under graphs/
+	if(strcasecmp(ext.c_str(), ".json") == 0){
+		for(auto &&part : rel_path.parent_path()){
+			if(part == "graphs"){
+				*ret = asset_kind::graph;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+//
+// Manifest
+//
+// One line per cooked source, "<kind> <mtime> <size> <key> <path>", followed by one tab-indented
+// "<mtime> <size> <path>" line per file it depends on. Paths come last so they may contain spaces.
+//
+// The key is that of the cache entry the source was cooked into, so an entry that has since been
+// evicted or deleted gets cooked again.
+//
+
+static std::string manifest_stamp(){
+	std::string ret = fmt::format("ham-cook {} {}.{}.{}", HAM_COOK_MANIFEST_VERSION, HAM_VERSION_MAJOR, HAM_VERSION_MINOR, HAM_VERSION_PATCH);
+#ifdef HAM_DEBUG
+	ret += " debug";
+#endif
+	return ret;
+}
+
+static bool parse_stamp(std::istringstream &in, file_stamp *ret){
+	return (bool)(in >> ret->mtime_ns >> ret->size);
+}
+
+static bool parse_key(std::istringstream &in, ham_asset_key *ret){
+	std::string key_str;
+	if(!(in >> key_str) || key_str.size() != 32) return false;
+
+	char *end;
+
+	ret->hi = strtoull(key_str.substr(0, 16).c_str(), &end, 16);
+	if(*end) return false;
+
+	ret->lo = strtoull(key_str.substr(16).c_str(), &end, 16);
+	return !*end;
+}
+
+static std::string rest_of_line(std::istringstream &in){
+	std::string ret;
+	std::getline(in >> std::ws, ret);
+	return ret;
+}
+
+static std::unordered_map<std::string, cook_entry> read_manifest(const fs::path &path){
+	std::unordered_map<std::string, cook_entry> ret;
+
+	std::ifstream in(path);
+	if(!in) return ret;
+
+	std::string line;
+
+	// anything cooked by another version of the loaders is stale
+	if(!std::getline(in, line) || line != manifest_stamp()){
+		return ret;
+	}
+
+	cook_entry *cur = nullptr;
+
+	while(std::getline(in, line)){
+		if(line.empty()) continue;
+
+		std::istringstream line_in(line);
+
+		if(line[0] == '\t'){
+			cook_dep dep;
+			if(!cur || !parse_stamp(line_in, &dep.stamp)) return {};
+
+			dep.path = rest_of_line(line_in);
+			cur->deps.emplace_back(std::move(dep));
+			continue;
+		}
+
+		std::string kind_str;
+		cook_entry entry;
+
+		if(!(line_in >> kind_str) || !parse_stamp(line_in, &entry.stamp) || !parse_key(line_in, &entry.key)) return {};
+
+		entry.kind = asset_kind::count;
+		for(u32 i = 0; i < (u32)asset_kind::count; i++){
+			if(kind_str == asset_kind_names[i]) entry.kind = (asset_kind)i;
+		}
+
+		if(entry.kind == asset_kind::count) return {};
+
+		entry.path = rest_of_line(line_in);
+
+		auto emplaced = ret.try_emplace(entry.path, std::move(entry));
+		cur = &emplaced.first->second;
+	}
+
+	return ret;
+}
+
+static bool write_manifest(const fs::path &path, const std::vector<cook_job> &jobs){
+	const auto tmp_path = fs::path(path).concat(fmt::format(".tmp-{}", getpid()));
+
+	{
+		std::ofstream out(tmp_path, std::ios::trunc);
+		if(!out) return false;
+
+		out << manifest_stamp() << '\n';
+
+		for(auto &&job : jobs){
+			// failed assets are left out so they get another go next time
+			if(!job.up_to_date && !job.ok) continue;
+
+			const auto &entry = job.entry;
+			out << asset_kind_names[(u32)entry.kind] << ' ' << entry.stamp.mtime_ns << ' ' << entry.stamp.size << ' ';
+			out << fmt::format("{:016x}{:016x}", entry.key.hi, entry.key.lo) << ' ' << entry.path << '\n';
+
+			for(auto &&dep : entry.deps){
+				out << '\t' << dep.stamp.mtime_ns << ' ' << dep.stamp.size << ' ' << dep.path << '\n';
+			}
+		}
+
+		if(!out.flush()){
+			fs::remove(tmp_path);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	fs::rename(tmp_path, path, ec);
+	if(ec){
+		fs::remove(tmp_path, ec);
+		return false;
+	}
+
+	return true;
+}
+
+static bool is_up_to_date(const fs::path &project_dir, const cook_entry &entry, const cook_entry &prev){
+	if(prev.kind != entry.kind || prev.stamp != entry.stamp) return false;
+
+	for(auto &&dep : prev.deps){
+		if(stat_file(project_dir / dep.path) != dep.stamp) return false;
+	}
+
+	// the cache may have been cleared or had the entry evicted since
+	if(prev.key.lo || prev.key.hi){
+		usize cooked_len;
+		const auto cooked = ham_asset_cache_map(prev.key, &cooked_len);
+		if(!cooked) return false;
+
+		ham_asset_cache_unmap(cooked, cooked_len);
+	}
+
+	return true;
+}
+
+//
+// Cooking
+//
+// Every kind goes through the same loader the runtime uses, so whatever ends up in the cache is
+// exactly what a running engine would have produced and will find there.
+//
+
+struct cook_context{
+	fs::path project_dir;
+	std::vector<cook_job*> queue;
+	std::atomic<usize> next{0};
+	bool verbose = false;
+};
+
+static void add_model_dep(ham_str8 path, void *user){
+	((std::vector<std::string>*)user)->emplace_back(path.ptr, path.len);
+}
+
+//! Models are loaded by path so the files they name are found and tracked.
+static bool cook_model(const cook_context &ctx, cook_entry &entry){
+	const auto full_path = (ctx.project_dir / entry.path).string();
+
+	std::vector<std::string> dep_paths;
+
+	const auto mdl = ham_model_load_with_deps(ham::str8(full_path.c_str()), add_model_dep, &dep_paths, &entry.key);
+	if(!mdl) return false;
+
+	ham_model_destroy(mdl);
+
+	entry.deps.clear();
+	entry.deps.reserve(dep_paths.size());
+
+	for(auto &&dep_path : dep_paths){
+		// files outside the project keep their full path
+		auto rel_path = fs::path(dep_path).lexically_relative(ctx.project_dir);
+		if(rel_path.empty()) rel_path = dep_path;
+
+		entry.deps.push_back({ rel_path.string(), stat_file(dep_path) });
+	}
+
+	return true;
+}
+
+static bool cook_one(const cook_context &ctx, const ham_typeset *ts, cook_job &job){
+	auto &entry = job.entry;
+
+	bool ok = false;
+
+	if(entry.kind == asset_kind::model){
+		ok = cook_model(ctx, entry);
+	}
+	else{
+		const auto file_path = (ctx.project_dir / entry.path).string();
+
+		ham::file file(ham::str8(file_path.c_str()), ham::file_open_flags::read);
+		if(!file){
+			fprintf(stderr, "Error opening '%s'\n", entry.path.c_str());
+			return false;
+		}
+
+		ham_file_info info;
+		if(!ham_file_get_info(file.ptr(), &info) || !info.size){
+			fprintf(stderr, "Error reading '%s'\n", entry.path.c_str());
+			return false;
+		}
+
+		const auto data = ham_file_map(file.ptr(), HAM_OPEN_READ, 0, info.size);
+		if(!data){
+			fprintf(stderr, "Error mapping '%s'\n", entry.path.c_str());
+			return false;
+		}
+
+		switch(entry.kind){
+			case asset_kind::image:{
+				const auto img = ham_image_load_from_mem(HAM_RGBA8U, info.size, data);
+				ok = img != nullptr;
+				ham_image_destroy(img);
+
+				entry.key = ham_image_cache_key(HAM_RGBA8U, info.size, data);
+				break;
+			}
+
+			case asset_kind::audio:{
+				const auto audio = ham_audio_data_load(info.size, data);
+				ok = audio != nullptr;
+				ham_audio_data_destroy(audio);
+
+				entry.key = ham_audio_data_cache_key(info.size, data);
+				break;
+			}
+
+			case asset_kind::graph:{
+				// there is no binary graph format yet, so graphs are only checked to load and nothing is stored
+				const auto graph = ham_graph_deserialize(HAM_DESERIALIZE_JSON, ts, info.size, data);
+				ok = graph != nullptr;
+				ham_graph_destroy(graph);
+				break;
+			}
+
+			default: break;
+		}
+
+		ham_file_unmap(file.ptr(), data, info.size);
+	}
+
+	if(!ok){
+		fprintf(stderr, "Error cooking %s '%s'\n", asset_kind_names[(u32)entry.kind], entry.path.c_str());
+	}
+	else if(ctx.verbose){
+		printf("Cooked %s '%s'\n", asset_kind_names[(u32)entry.kind], entry.path.c_str());
+	}
+
+	return ok;
+}
+
+static void cook_worker(cook_context *ctx){
+	ham::typeset ts;
+	if(!ham::engine::ensure_types(ts)){
+		fprintf(stderr, "Error creating engine types\n");
+		return;
+	}
+
+	while(true){
+		const auto idx = ctx->next.fetch_add(1, std::memory_order_relaxed);
+		if(idx >= ctx->queue.size()) break;
+
+		const auto job = ctx->queue[idx];
+		job->ok = cook_one(*ctx, ts.handle(), *job);
+	}
+}
+
+int main(int argc, char *argv[]){
+	const char *project_arg = nullptr;
+	const char *out_arg = nullptr;
+	long num_threads = 0;
+	bool force = false;
+	bool verbose = false;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0){
+			print_usage(argv[0]);
+			return 0;
+		}
+		else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+			num_threads = strtol(argv[++i], nullptr, 10);
+			if(num_threads <= 0){
+				fprintf(stderr, "Invalid number of jobs '%s'\n", argv[i]);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc){
+			out_arg = argv[++i];
+		}
+		else if(strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--force") == 0){
+			force = true;
+		}
+		else if(strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0){
+			verbose = true;
+		}
+		else if(!project_arg && argv[i][0] != '-'){
+			project_arg = argv[i];
+		}
+		else{
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if(!project_arg){
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	std::error_code ec;
+
+	const auto project_dir = fs::canonical(project_arg, ec);
+	if(ec || !fs::is_directory(project_dir)){
+		fprintf(stderr, "Project directory does not exist: '%s'\n", project_arg);
+		return 1;
+	}
+
+	const auto out_dir = out_arg ? fs::absolute(out_arg).lexically_normal() : project_dir / ".ham-cache";
+
+	if(!ham_asset_cache_set_dir(ham::str8(out_dir.c_str()))){
+		fprintf(stderr, "Error using '%s' as the cache directory\n", out_dir.c_str());
+		return 1;
+	}
+
+	if(num_threads <= 0){
+		num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+		if(num_threads <= 0) num_threads = 1;
+	}
+
+	ham_timepoint start_tp;
+	ham_timepoint_now(&start_tp, CLOCK_MONOTONIC);
+
+	const auto manifest_path = out_dir / HAM_COOK_MANIFEST_NAME;
+	const auto manifest = force ? decltype(read_manifest(manifest_path)){} : read_manifest(manifest_path);
+
+	std::vector<cook_job> jobs;
+
+	for(auto it = fs::recursive_directory_iterator(project_dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)){
+		const auto &path = it->path();
+
+		if(path.filename().string()[0] == '.' || path == out_dir){
+			if(it->is_directory(ec)) it.disable_recursion_pending();
+			continue;
+		}
+
+		if(!it->is_regular_file(ec)) continue;
+
+		const auto rel_path = path.lexically_relative(project_dir);
+
+		asset_kind kind;
+		if(!classify_asset(rel_path, &kind)) continue;
+
+		cook_job job;
+		job.entry.kind = kind;
+		job.entry.path = rel_path.string();
+		job.entry.stamp = stat_file(path);
+
+		const auto prev = manifest.find(job.entry.path);
+		if(prev != manifest.end() && is_up_to_date(project_dir, job.entry, prev->second)){
+			job.entry.key = prev->second.key;
+			job.entry.deps = prev->second.deps;
+			job.up_to_date = true;
+		}
+
+		jobs.emplace_back(std::move(job));
+	}
+
+	if(ec){
+		fprintf(stderr, "Error scanning '%s': %s\n", project_dir.c_str(), ec.message().c_str());
+		return 1;
+	}
+
+	cook_context ctx;
+	ctx.project_dir = project_dir;
+	ctx.verbose = verbose;
+
+	for(auto &&job : jobs){
+		if(!job.up_to_date) ctx.queue.emplace_back(&job);
+	}
+
+	// biggest first so one huge model doesn't start last and hold everything up
+	std::stable_sort(ctx.queue.begin(), ctx.queue.end(), [](const cook_job *lhs, const cook_job *rhs){
+		return lhs->entry.stamp.size > rhs->entry.stamp.size;
+	});
+
+	num_threads = std::min<long>(num_threads, (long)ctx.queue.size());
+
+	{
+		// ham::thread must not move once started
+		std::vector<ham::thread> threads;
+		threads.reserve(num_threads);
+
+		for(long i = 0; i < num_threads; i++){
+			threads.emplace_back(cook_worker, &ctx);
+		}
+
+		for(auto &&thd : threads){
+			thd.join();
+		}
+	}
+
+	usize num_cooked = 0, num_failed = 0;
+	for(auto &&job : ctx.queue){
+		if(job->ok) ++num_cooked;
+		else ++num_failed;
+	}
+
+	if(!write_manifest(manifest_path, jobs)){
+		fprintf(stderr, "Error writing manifest '%s'\n", manifest_path.c_str());
+		return 1;
+	}
+
+	ham_timepoint end_tp;
+	ham_timepoint_now(&end_tp, CLOCK_MONOTONIC);
+
+	const auto elapsed_ms = (end_tp.tv_sec - start_tp.tv_sec) * 1000 + (end_tp.tv_nsec - start_tp.tv_nsec) / 1000000;
+
+	printf(
+		"%zu cooked, %zu up to date, %zu failed in %ld ms using %ld threads\n",
+		num_cooked, jobs.size() - ctx.queue.size(), num_failed, (long)elapsed_ms, num_threads
+	);
+
+	return num_failed ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Ham Log Decoder
+ * Copyright (C) 2022 Keith Hammond
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ham/log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void print_usage(const char *argv0){
+	fprintf(stderr, "Usage: %s [-h|--help] FILE...\n", argv0);
+	fprintf(stderr, "Decode binary logs written by ham_async_logger_create_binary and print them to stdout.\n");
+}
+
+// every record goes to stdout so the output can be piped as a whole
+static ham_usize print_record(ham_timepoint tp, ham_log_level level, const char *api, const char *msg, void*){
+	struct tm tm_val;
+	const struct tm *const time_info = localtime_r(&tp.tv_sec, &tm_val);
+
+	const int ret = printf(
+		"[%02d/%02d/%02d %02d:%02d:%02d.%06ld] [%s] (%s) %s\n",
+		time_info->tm_mday, time_info->tm_mon + 1, time_info->tm_year % 100,
+		time_info->tm_hour, time_info->tm_min, time_info->tm_sec, tp.tv_nsec / 1000,
+		ham_log_level_str(level),
+		api, msg
+	);
+
+	return ret < 0 ? 0 : (ham_usize)ret;
+}
+
+int main(int argc, char *argv[]){
+	if(argc < 2){
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	const ham_logger out{ print_record, nullptr, nullptr };
+
+	int ret = 0;
+
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0){
+			print_usage(argv[0]);
+			return 0;
+		}
+
+		if(ham_log_decode_file(ham::str8(argv[i]), &out) == (ham_usize)-1){
+			fprintf(stderr, "Error decoding '%s'\n", argv[i]);
+			ret = 1;
+		}
+	}
+
+	return ret;
+}